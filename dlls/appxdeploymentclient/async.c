@@ -0,0 +1,616 @@
+/* WinRT Windows.Management.Deployment Async Implementation
+ *
+ * Copyright 2022 Bernhard Kölbl for CodeWeavers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "private.h"
+#include "wine/debug.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(appx);
+
+#define Closed 4
+#define HANDLER_NOT_SET ((void *)~(ULONG_PTR)0)
+
+/*
+ *
+ * IDeploymentResult
+ *
+ */
+
+struct deployment_result
+{
+    IDeploymentResult IDeploymentResult_iface;
+    LONG ref;
+
+    HRESULT hr;
+    HSTRING error_text;
+    GUID activity_id;
+};
+
+static inline struct deployment_result *impl_from_IDeploymentResult( IDeploymentResult *iface )
+{
+    return CONTAINING_RECORD( iface, struct deployment_result, IDeploymentResult_iface );
+}
+
+static HRESULT WINAPI deployment_result_QueryInterface( IDeploymentResult *iface, REFIID iid, void **out )
+{
+    struct deployment_result *impl = impl_from_IDeploymentResult( iface );
+
+    TRACE( "iface %p, iid %s, out %p.\n", iface, debugstr_guid( iid ), out );
+
+    if (IsEqualGUID( iid, &IID_IUnknown ) ||
+        IsEqualGUID( iid, &IID_IInspectable ) ||
+        IsEqualGUID( iid, &IID_IAgileObject ) ||
+        IsEqualGUID( iid, &IID_IDeploymentResult ))
+    {
+        *out = &impl->IDeploymentResult_iface;
+        IInspectable_AddRef( *out );
+        return S_OK;
+    }
+
+    FIXME( "%s not implemented, returning E_NOINTERFACE.\n", debugstr_guid( iid ) );
+    *out = NULL;
+    return E_NOINTERFACE;
+}
+
+static ULONG WINAPI deployment_result_AddRef( IDeploymentResult *iface )
+{
+    struct deployment_result *impl = impl_from_IDeploymentResult( iface );
+    ULONG ref = InterlockedIncrement( &impl->ref );
+    TRACE( "iface %p increasing refcount to %lu.\n", iface, ref );
+    return ref;
+}
+
+static ULONG WINAPI deployment_result_Release( IDeploymentResult *iface )
+{
+    struct deployment_result *impl = impl_from_IDeploymentResult( iface );
+    ULONG ref = InterlockedDecrement( &impl->ref );
+
+    TRACE( "iface %p decreasing refcount to %lu.\n", iface, ref );
+
+    if (!ref)
+    {
+        WindowsDeleteString( impl->error_text );
+        free( impl );
+    }
+    return ref;
+}
+
+static HRESULT WINAPI deployment_result_GetIids( IDeploymentResult *iface, ULONG *iid_count, IID **iids )
+{
+    FIXME( "iface %p, iid_count %p, iids %p stub!\n", iface, iid_count, iids );
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI deployment_result_GetRuntimeClassName( IDeploymentResult *iface, HSTRING *class_name )
+{
+    FIXME( "iface %p, class_name %p stub!\n", iface, class_name );
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI deployment_result_GetTrustLevel( IDeploymentResult *iface, TrustLevel *trust_level )
+{
+    FIXME( "iface %p, trust_level %p stub!\n", iface, trust_level );
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI deployment_result_get_ErrorText( IDeploymentResult *iface, HSTRING *value )
+{
+    struct deployment_result *impl = impl_from_IDeploymentResult( iface );
+    TRACE( "iface %p, value %p.\n", iface, value );
+    return WindowsDuplicateString( impl->error_text, value );
+}
+
+static HRESULT WINAPI deployment_result_get_ActivityId( IDeploymentResult *iface, GUID *value )
+{
+    struct deployment_result *impl = impl_from_IDeploymentResult( iface );
+    TRACE( "iface %p, value %p.\n", iface, value );
+    *value = impl->activity_id;
+    return S_OK;
+}
+
+static HRESULT WINAPI deployment_result_get_ExtendedErrorCode( IDeploymentResult *iface, HRESULT *value )
+{
+    struct deployment_result *impl = impl_from_IDeploymentResult( iface );
+    TRACE( "iface %p, value %p.\n", iface, value );
+    *value = impl->hr;
+    return S_OK;
+}
+
+static const struct IDeploymentResultVtbl deployment_result_vtbl =
+{
+    deployment_result_QueryInterface,
+    deployment_result_AddRef,
+    deployment_result_Release,
+    /* IInspectable methods */
+    deployment_result_GetIids,
+    deployment_result_GetRuntimeClassName,
+    deployment_result_GetTrustLevel,
+    /* IDeploymentResult methods */
+    deployment_result_get_ErrorText,
+    deployment_result_get_ActivityId,
+    deployment_result_get_ExtendedErrorCode,
+};
+
+static HRESULT deployment_result_create( HRESULT hr, IDeploymentResult **out )
+{
+    struct deployment_result *impl;
+    WCHAR *text = NULL;
+    DWORD len;
+
+    if (!(impl = calloc( 1, sizeof(*impl) ))) return E_OUTOFMEMORY;
+
+    impl->IDeploymentResult_iface.lpVtbl = &deployment_result_vtbl;
+    impl->ref = 1;
+    impl->hr = hr;
+    CoCreateGuid( &impl->activity_id );
+
+    if (FAILED(hr) && (len = FormatMessageW( FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_IGNORE_INSERTS,
+                                             NULL, hr, 0, (WCHAR *)&text, 0, NULL )))
+    {
+        while (len && (text[len - 1] == '\n' || text[len - 1] == '\r')) len--;
+        WindowsCreateString( text, len, &impl->error_text );
+        LocalFree( text );
+    }
+
+    *out = &impl->IDeploymentResult_iface;
+    return S_OK;
+}
+
+/*
+ *
+ * IAsyncOperationWithProgress<DeploymentResult *, DeploymentProgress>
+ *
+ */
+
+struct async_deployment
+{
+    IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress_iface;
+    IAsyncInfo IAsyncInfo_iface;
+    LONG ref;
+
+    IAsyncOperationWithProgressCompletedHandler_DeploymentResult_DeploymentProgress *handler;
+    IAsyncOperationProgressHandler_DeploymentResult_DeploymentProgress *progress;
+    IDeploymentResult *result;
+
+    async_deployment_callback callback;
+    void *param;
+    TP_WORK *async_run_work;
+
+    CRITICAL_SECTION cs;
+    AsyncStatus status;
+    HRESULT hr;
+};
+
+static inline struct async_deployment *impl_from_IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress(
+    IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress *iface )
+{
+    return CONTAINING_RECORD( iface, struct async_deployment, IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress_iface );
+}
+
+static HRESULT WINAPI async_deployment_QueryInterface( IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress *iface, REFIID iid, void **out )
+{
+    struct async_deployment *impl = impl_from_IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress( iface );
+
+    TRACE( "iface %p, iid %s, out %p.\n", iface, debugstr_guid( iid ), out );
+
+    if (IsEqualGUID( iid, &IID_IUnknown ) ||
+        IsEqualGUID( iid, &IID_IInspectable ) ||
+        IsEqualGUID( iid, &IID_IAgileObject ) ||
+        IsEqualGUID( iid, &IID_IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress ))
+    {
+        *out = &impl->IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress_iface;
+        IInspectable_AddRef( *out );
+        return S_OK;
+    }
+
+    if (IsEqualGUID( iid, &IID_IAsyncInfo ))
+    {
+        *out = &impl->IAsyncInfo_iface;
+        IInspectable_AddRef( *out );
+        return S_OK;
+    }
+
+    FIXME( "%s not implemented, returning E_NOINTERFACE.\n", debugstr_guid( iid ) );
+    *out = NULL;
+    return E_NOINTERFACE;
+}
+
+static ULONG WINAPI async_deployment_AddRef( IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress *iface )
+{
+    struct async_deployment *impl = impl_from_IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress( iface );
+    ULONG ref = InterlockedIncrement( &impl->ref );
+    TRACE( "iface %p increasing refcount to %lu.\n", iface, ref );
+    return ref;
+}
+
+static ULONG WINAPI async_deployment_Release( IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress *iface )
+{
+    struct async_deployment *impl = impl_from_IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress( iface );
+    ULONG ref = InterlockedDecrement( &impl->ref );
+
+    TRACE( "iface %p decreasing refcount to %lu.\n", iface, ref );
+
+    if (!ref)
+    {
+        IAsyncInfo_Close( &impl->IAsyncInfo_iface );
+
+        if (impl->handler && impl->handler != HANDLER_NOT_SET)
+            IAsyncOperationWithProgressCompletedHandler_DeploymentResult_DeploymentProgress_Release( impl->handler );
+        if (impl->progress && impl->progress != HANDLER_NOT_SET)
+            IAsyncOperationProgressHandler_DeploymentResult_DeploymentProgress_Release( impl->progress );
+        if (impl->result) IDeploymentResult_Release( impl->result );
+
+        impl->cs.DebugInfo->Spare[0] = 0;
+        DeleteCriticalSection( &impl->cs );
+        free( impl );
+    }
+
+    return ref;
+}
+
+static HRESULT WINAPI async_deployment_GetIids( IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress *iface, ULONG *iid_count, IID **iids )
+{
+    FIXME( "iface %p, iid_count %p, iids %p stub!\n", iface, iid_count, iids );
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI async_deployment_GetRuntimeClassName( IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress *iface, HSTRING *class_name )
+{
+    FIXME( "iface %p, class_name %p stub!\n", iface, class_name );
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI async_deployment_GetTrustLevel( IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress *iface, TrustLevel *trust_level )
+{
+    FIXME( "iface %p, trust_level %p stub!\n", iface, trust_level );
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI async_deployment_put_Progress( IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress *iface,
+                                                     IAsyncOperationProgressHandler_DeploymentResult_DeploymentProgress *handler )
+{
+    struct async_deployment *impl = impl_from_IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress( iface );
+    HRESULT hr = S_OK;
+
+    TRACE( "iface %p, handler %p.\n", iface, handler );
+
+    EnterCriticalSection( &impl->cs );
+    if (impl->status == Closed)
+        hr = E_ILLEGAL_METHOD_CALL;
+    else if (impl->progress != HANDLER_NOT_SET)
+        hr = E_ILLEGAL_DELEGATE_ASSIGNMENT;
+    else if ((impl->progress = handler))
+        IAsyncOperationProgressHandler_DeploymentResult_DeploymentProgress_AddRef( impl->progress );
+    LeaveCriticalSection( &impl->cs );
+
+    return hr;
+}
+
+static HRESULT WINAPI async_deployment_get_Progress( IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress *iface,
+                                                     IAsyncOperationProgressHandler_DeploymentResult_DeploymentProgress **handler )
+{
+    struct async_deployment *impl = impl_from_IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress( iface );
+    HRESULT hr = S_OK;
+
+    TRACE( "iface %p, handler %p.\n", iface, handler );
+
+    EnterCriticalSection( &impl->cs );
+    if (impl->status == Closed)
+        hr = E_ILLEGAL_METHOD_CALL;
+    *handler = (impl->progress != HANDLER_NOT_SET) ? impl->progress : NULL;
+    if (*handler) IAsyncOperationProgressHandler_DeploymentResult_DeploymentProgress_AddRef( *handler );
+    LeaveCriticalSection( &impl->cs );
+
+    return hr;
+}
+
+static HRESULT WINAPI async_deployment_put_Completed( IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress *iface,
+                                                      IAsyncOperationWithProgressCompletedHandler_DeploymentResult_DeploymentProgress *handler )
+{
+    struct async_deployment *impl = impl_from_IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress( iface );
+    HRESULT hr = S_OK;
+
+    TRACE( "iface %p, handler %p.\n", iface, handler );
+
+    EnterCriticalSection( &impl->cs );
+    if (impl->status == Closed)
+        hr = E_ILLEGAL_METHOD_CALL;
+    else if (impl->handler != HANDLER_NOT_SET)
+        hr = E_ILLEGAL_DELEGATE_ASSIGNMENT;
+    else if ((impl->handler = handler))
+    {
+        IAsyncOperationWithProgressCompletedHandler_DeploymentResult_DeploymentProgress_AddRef( impl->handler );
+
+        if (impl->status > Started)
+        {
+            AsyncStatus status = impl->status;
+            impl->handler = NULL; /* Prevent concurrent invoke. */
+            LeaveCriticalSection( &impl->cs );
+
+            IAsyncOperationWithProgressCompletedHandler_DeploymentResult_DeploymentProgress_Invoke( handler, iface, status );
+            IAsyncOperationWithProgressCompletedHandler_DeploymentResult_DeploymentProgress_Release( handler );
+
+            return S_OK;
+        }
+    }
+    LeaveCriticalSection( &impl->cs );
+
+    return hr;
+}
+
+static HRESULT WINAPI async_deployment_get_Completed( IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress *iface,
+                                                      IAsyncOperationWithProgressCompletedHandler_DeploymentResult_DeploymentProgress **handler )
+{
+    struct async_deployment *impl = impl_from_IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress( iface );
+    HRESULT hr = S_OK;
+
+    FIXME( "iface %p, handler %p semi stub!\n", iface, handler );
+
+    EnterCriticalSection( &impl->cs );
+    if (impl->status == Closed)
+        hr = E_ILLEGAL_METHOD_CALL;
+    *handler = (impl->handler != HANDLER_NOT_SET) ? impl->handler : NULL;
+    LeaveCriticalSection( &impl->cs );
+
+    return hr;
+}
+
+static HRESULT WINAPI async_deployment_GetResults( IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress *iface, IDeploymentResult **results )
+{
+    struct async_deployment *impl = impl_from_IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress( iface );
+    HRESULT hr;
+
+    TRACE( "iface %p, results %p.\n", iface, results );
+
+    EnterCriticalSection( &impl->cs );
+    if (impl->status == Closed || impl->status == Started || !impl->result)
+    {
+        *results = NULL;
+        hr = E_ILLEGAL_METHOD_CALL;
+    }
+    else
+    {
+        /* A failed deployment still hands out its result, the error is described there. */
+        IDeploymentResult_AddRef( (*results = impl->result) );
+        hr = S_OK;
+    }
+    LeaveCriticalSection( &impl->cs );
+
+    return hr;
+}
+
+static const struct IAsyncOperationWithProgress_DeploymentResult_DeploymentProgressVtbl async_deployment_vtbl =
+{
+    /* IUnknown methods */
+    async_deployment_QueryInterface,
+    async_deployment_AddRef,
+    async_deployment_Release,
+    /* IInspectable methods */
+    async_deployment_GetIids,
+    async_deployment_GetRuntimeClassName,
+    async_deployment_GetTrustLevel,
+    /* IAsyncOperationWithProgress<DeploymentResult *, DeploymentProgress> methods */
+    async_deployment_put_Progress,
+    async_deployment_get_Progress,
+    async_deployment_put_Completed,
+    async_deployment_get_Completed,
+    async_deployment_GetResults,
+};
+
+/*
+ *
+ * IAsyncInfo for IAsyncOperationWithProgress<DeploymentResult *, DeploymentProgress>
+ *
+ */
+
+DEFINE_IINSPECTABLE_( async_deployment_info, IAsyncInfo, struct async_deployment, impl_from_async_deployment_IAsyncInfo, IAsyncInfo_iface,
+                      &impl->IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress_iface )
+
+static HRESULT WINAPI async_deployment_info_get_Id( IAsyncInfo *iface, UINT32 *id )
+{
+    FIXME( "iface %p, id %p stub!\n", iface, id );
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI async_deployment_info_get_Status( IAsyncInfo *iface, AsyncStatus *status )
+{
+    struct async_deployment *impl = impl_from_async_deployment_IAsyncInfo( iface );
+    HRESULT hr = S_OK;
+
+    TRACE( "iface %p, status %p.\n", iface, status );
+
+    EnterCriticalSection( &impl->cs );
+    if (impl->status == Closed)
+        hr = E_ILLEGAL_METHOD_CALL;
+    *status = impl->status;
+    LeaveCriticalSection( &impl->cs );
+
+    return hr;
+}
+
+static HRESULT WINAPI async_deployment_info_get_ErrorCode( IAsyncInfo *iface, HRESULT *error_code )
+{
+    struct async_deployment *impl = impl_from_async_deployment_IAsyncInfo( iface );
+    HRESULT hr = S_OK;
+
+    TRACE( "iface %p, error_code %p.\n", iface, error_code );
+
+    EnterCriticalSection( &impl->cs );
+    if (impl->status == Closed)
+        *error_code = hr = E_ILLEGAL_METHOD_CALL;
+    else
+        *error_code = impl->hr;
+    LeaveCriticalSection( &impl->cs );
+
+    return hr;
+}
+
+static HRESULT WINAPI async_deployment_info_Cancel( IAsyncInfo *iface )
+{
+    struct async_deployment *impl = impl_from_async_deployment_IAsyncInfo( iface );
+    HRESULT hr = S_OK;
+
+    TRACE( "iface %p.\n", iface );
+
+    EnterCriticalSection( &impl->cs );
+    if (impl->status == Closed)
+        hr = E_ILLEGAL_METHOD_CALL;
+    else if (impl->status == Started)
+        impl->status = Canceled;
+    LeaveCriticalSection( &impl->cs );
+
+    return hr;
+}
+
+static HRESULT WINAPI async_deployment_info_Close( IAsyncInfo *iface )
+{
+    struct async_deployment *impl = impl_from_async_deployment_IAsyncInfo( iface );
+    HRESULT hr = S_OK;
+
+    TRACE( "iface %p.\n", iface );
+
+    EnterCriticalSection( &impl->cs );
+    if (impl->status == Started)
+        hr = E_ILLEGAL_STATE_CHANGE;
+    else if (impl->status != Closed)
+    {
+        CloseThreadpoolWork( impl->async_run_work );
+        impl->async_run_work = NULL;
+        impl->status = Closed;
+    }
+    LeaveCriticalSection( &impl->cs );
+
+    return hr;
+}
+
+static const struct IAsyncInfoVtbl async_deployment_info_vtbl =
+{
+    /* IUnknown methods */
+    async_deployment_info_QueryInterface,
+    async_deployment_info_AddRef,
+    async_deployment_info_Release,
+    /* IInspectable methods */
+    async_deployment_info_GetIids,
+    async_deployment_info_GetRuntimeClassName,
+    async_deployment_info_GetTrustLevel,
+    /* IAsyncInfo */
+    async_deployment_info_get_Id,
+    async_deployment_info_get_Status,
+    async_deployment_info_get_ErrorCode,
+    async_deployment_info_Cancel,
+    async_deployment_info_Close
+};
+
+static void CALLBACK async_deployment_run_cb( TP_CALLBACK_INSTANCE *instance, void *data, TP_WORK *work )
+{
+    IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress *operation = data;
+    struct async_deployment *impl = impl_from_IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress( operation );
+    IDeploymentResult *result = NULL;
+    HRESULT hr;
+
+    hr = impl->callback( impl->param, operation );
+    deployment_result_create( hr, &result );
+
+    EnterCriticalSection( &impl->cs );
+    if (impl->status < Closed)
+        impl->status = FAILED(hr) ? Error : Completed;
+
+    impl->hr = hr;
+    impl->result = result;
+
+    if (impl->handler != NULL && impl->handler != HANDLER_NOT_SET)
+    {
+        IAsyncOperationWithProgressCompletedHandler_DeploymentResult_DeploymentProgress *handler = impl->handler;
+        AsyncStatus status = impl->status;
+        impl->handler = NULL; /* Prevent concurrent invoke. */
+        LeaveCriticalSection( &impl->cs );
+
+        IAsyncOperationWithProgressCompletedHandler_DeploymentResult_DeploymentProgress_Invoke( handler, operation, status );
+        IAsyncOperationWithProgressCompletedHandler_DeploymentResult_DeploymentProgress_Release( handler );
+    }
+    else LeaveCriticalSection( &impl->cs );
+
+    IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress_Release( operation );
+}
+
+/*
+ * Reports progress from the deployment callback, may be called from any thread.
+ */
+void async_deployment_report( IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress *operation, UINT32 percentage )
+{
+    struct async_deployment *impl = impl_from_IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress( operation );
+    IAsyncOperationProgressHandler_DeploymentResult_DeploymentProgress *handler = NULL;
+    DeploymentProgress progress = { DeploymentProgressState_Processing, percentage };
+
+    EnterCriticalSection( &impl->cs );
+    if (impl->status == Started && impl->progress && impl->progress != HANDLER_NOT_SET)
+        IAsyncOperationProgressHandler_DeploymentResult_DeploymentProgress_AddRef( (handler = impl->progress) );
+    LeaveCriticalSection( &impl->cs );
+
+    if (!handler) return;
+    IAsyncOperationProgressHandler_DeploymentResult_DeploymentProgress_Invoke( handler, operation, progress );
+    IAsyncOperationProgressHandler_DeploymentResult_DeploymentProgress_Release( handler );
+}
+
+BOOL async_deployment_is_canceled( IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress *operation )
+{
+    struct async_deployment *impl = impl_from_IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress( operation );
+    return ReadNoFence( (LONG *)&impl->status ) == Canceled;
+}
+
+HRESULT async_deployment_create( async_deployment_callback callback, void *param,
+                                 IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress **out )
+{
+    struct async_deployment *impl;
+
+    TRACE( "callback %p, param %p, out %p.\n", callback, param, out );
+
+    if (!(impl = calloc( 1, sizeof(*impl) )))
+    {
+        *out = NULL;
+        return E_OUTOFMEMORY;
+    }
+
+    impl->IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress_iface.lpVtbl = &async_deployment_vtbl;
+    impl->IAsyncInfo_iface.lpVtbl = &async_deployment_info_vtbl;
+    impl->ref = 1;
+
+    impl->handler = HANDLER_NOT_SET;
+    impl->progress = HANDLER_NOT_SET;
+    impl->callback = callback;
+    impl->param = param;
+    impl->status = Started;
+
+    if (!(impl->async_run_work = CreateThreadpoolWork( async_deployment_run_cb, &impl->IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress_iface, NULL )))
+    {
+        free( impl );
+        *out = NULL;
+        return HRESULT_FROM_WIN32( GetLastError() );
+    }
+
+    InitializeCriticalSectionEx( &impl->cs, 0, RTL_CRITICAL_SECTION_FLAG_FORCE_DEBUG_INFO );
+    impl->cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": async_deployment.cs");
+
+    /* AddRef to keep the obj alive in the callback. */
+    IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress_AddRef( &impl->IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress_iface );
+    SubmitThreadpoolWork( impl->async_run_work );
+
+    *out = &impl->IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress_iface;
+    TRACE( "created %p\n", *out );
+    return S_OK;
+}
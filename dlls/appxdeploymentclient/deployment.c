@@ -0,0 +1,1040 @@
+/* WinRT Windows.Management.Deployment Package Deployer Implementation
+ *
+ * Copyright 2026 the Wine project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <zlib.h>
+
+#include "private.h"
+#include "bcrypt.h"
+#include "shlwapi.h"
+#include "xmllite.h"
+#include "winreg.h"
+
+#include "wine/debug.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(appx);
+
+/*
+ * The package is deployed by a pool of workers pulling tasks from a shared list. Every task is
+ * a run of blocks of a single file: it reads the compressed data with positional reads,
+ * inflates it, checks every block against the hash from AppxBlockMap.xml and writes it at its
+ * final offset. Packages flush their deflate streams at every block boundary, so a file is
+ * split into independent runs whenever the block map gives the compressed size of its blocks.
+ */
+
+#define DEPLOYMENT_BLOCK_SIZE       0x10000
+#define DEPLOYMENT_TASK_BLOCKS      64
+#define DEPLOYMENT_BUFFER_SIZE      (16 * DEPLOYMENT_BLOCK_SIZE)
+#define DEPLOYMENT_MAX_WORKERS      16
+
+#define ZIP_LOCAL_HEADER_SIGNATURE      0x04034b50
+#define ZIP_CENTRAL_HEADER_SIGNATURE    0x02014b50
+#define ZIP_END_SIGNATURE               0x06054b50
+#define ZIP64_END_SIGNATURE             0x06064b50
+#define ZIP64_LOCATOR_SIGNATURE         0x07064b50
+#define ZIP_METHOD_STORED               0
+#define ZIP_METHOD_DEFLATED             8
+
+static const WCHAR packages_key[] = L"Software\\Classes\\Local Settings\\Software\\Microsoft\\Windows\\CurrentVersion\\AppModel\\Repository\\Packages";
+
+struct deployment_block
+{
+    BYTE hash[32];
+    UINT32 size;
+};
+
+struct deployment_file
+{
+    WCHAR *name;
+    UINT16 method;
+    UINT32 crc;
+    UINT64 header_offset;
+    UINT64 data_offset;
+    UINT64 compressed_size;
+    UINT64 size;
+    UINT32 header_size;
+
+    struct deployment_block *blocks;
+    UINT32 block_count;
+    BOOL in_block_map;
+
+    INIT_ONCE open_once;
+    HANDLE handle;
+    LONG pending_tasks;
+};
+
+struct deployment_task
+{
+    struct deployment_file *file;
+    UINT32 first_block;
+    UINT64 input_offset;
+    UINT64 input_size;
+    UINT64 output_offset;
+    UINT64 output_size;
+};
+
+struct deployment
+{
+    WCHAR *package_path;
+    BOOL register_package;
+    IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress *operation;
+
+    HANDLE package;
+    UINT64 package_size;
+    WCHAR destination[MAX_PATH];
+    WCHAR full_name[MAX_PATH];
+
+    struct deployment_file *files;
+    UINT32 file_count;
+    struct deployment_task *tasks;
+    UINT32 task_count;
+
+    BCRYPT_ALG_HANDLE sha256;
+    LONG next_task;
+    LONG64 total_bytes;
+    LONG64 written_bytes;
+    LONG reported;
+    LONG hr;
+};
+
+static inline UINT16 read_u16( const BYTE *data ) { return data[0] | (data[1] << 8); }
+static inline UINT32 read_u32( const BYTE *data ) { return read_u16( data ) | ((UINT32)read_u16( data + 2 ) << 16); }
+static inline UINT64 read_u64( const BYTE *data ) { return read_u32( data ) | ((UINT64)read_u32( data + 4 ) << 32); }
+
+static HRESULT read_package( struct deployment *deployment, UINT64 offset, void *buffer, UINT32 size )
+{
+    OVERLAPPED overlapped = {0};
+    DWORD read;
+
+    overlapped.Offset = offset;
+    overlapped.OffsetHigh = offset >> 32;
+    if (!ReadFile( deployment->package, buffer, size, &read, &overlapped )) return HRESULT_FROM_WIN32( GetLastError() );
+    return read == size ? S_OK : APPX_E_CORRUPT_CONTENT;
+}
+
+static void deployment_fail( struct deployment *deployment, HRESULT hr )
+{
+    InterlockedCompareExchange( &deployment->hr, hr, S_OK );
+}
+
+static HRESULT deployment_status( struct deployment *deployment )
+{
+    if (async_deployment_is_canceled( deployment->operation )) deployment_fail( deployment, E_ABORT );
+    return ReadNoFence( &deployment->hr );
+}
+
+/* Package item names are percent encoded UTF-8 with forward slashes, separators are converted
+ * after decoding so that an encoded one can't escape the checks of is_safe_item_name. */
+static WCHAR *decode_item_name( const BYTE *name, UINT32 length )
+{
+    char *decoded;
+    WCHAR *result, *p;
+    UINT32 i, j;
+    int size;
+
+    if (!(decoded = malloc( length + 1 ))) return NULL;
+    for (i = j = 0; i < length; i++)
+    {
+        if (name[i] == '%' && i + 2 < length && isxdigit( name[i + 1] ) && isxdigit( name[i + 2] ))
+        {
+            char hex[3] = { name[i + 1], name[i + 2], 0 };
+            decoded[j++] = strtoul( hex, NULL, 16 );
+            i += 2;
+        }
+        else decoded[j++] = name[i];
+    }
+
+    size = MultiByteToWideChar( CP_UTF8, 0, decoded, j, NULL, 0 );
+    if ((result = malloc( (size + 1) * sizeof(WCHAR) )))
+    {
+        MultiByteToWideChar( CP_UTF8, 0, decoded, j, result, size );
+        result[size] = 0;
+        for (p = result; *p; p++) if (*p == '/') *p = '\\';
+    }
+    free( decoded );
+    return result;
+}
+
+static inline BOOL is_item_separator( WCHAR c )
+{
+    return c == '\\' || c == '/';
+}
+
+/* the name must stay below the destination: no root, drive, device or parent directory */
+static BOOL is_safe_item_name( const WCHAR *name )
+{
+    const WCHAR *part;
+
+    if (!name[0] || is_item_separator( name[0] ) || wcschr( name, ':' )) return FALSE;
+    for (part = name; part; part = wcspbrk( part, L"\\/" ), part = part ? part + 1 : NULL)
+    {
+        if (part[0] == '.' && part[1] == '.' && (!part[2] || is_item_separator( part[2] ))) return FALSE;
+        if (part[0] == '?' && (!part[1] || is_item_separator( part[1] ))) return FALSE;
+    }
+    return TRUE;
+}
+
+static HRESULT deployment_read_central_directory( struct deployment *deployment )
+{
+    UINT64 directory_offset, directory_size, entry_count, value;
+    BYTE *tail, *directory, *entry, *extra, *end;
+    UINT32 tail_size, name_length, extra_length, comment_length, i;
+    LARGE_INTEGER size;
+    BYTE locator[20], end64[56];
+    const BYTE *eocd = NULL;
+    HRESULT hr;
+
+    if (!GetFileSizeEx( deployment->package, &size )) return HRESULT_FROM_WIN32( GetLastError() );
+    deployment->package_size = size.QuadPart;
+    if (deployment->package_size < 22) return APPX_E_CORRUPT_CONTENT;
+
+    tail_size = min( deployment->package_size, 22 + 0xffff );
+    if (!(tail = malloc( tail_size ))) return E_OUTOFMEMORY;
+    if (FAILED(hr = read_package( deployment, deployment->package_size - tail_size, tail, tail_size )))
+    {
+        free( tail );
+        return hr;
+    }
+
+    for (i = tail_size - 22; i != ~0u && !eocd; i--)
+        if (read_u32( tail + i ) == ZIP_END_SIGNATURE) eocd = tail + i;
+    if (!eocd)
+    {
+        free( tail );
+        return APPX_E_CORRUPT_CONTENT;
+    }
+
+    entry_count = read_u16( eocd + 10 );
+    directory_size = read_u32( eocd + 12 );
+    directory_offset = read_u32( eocd + 16 );
+    value = deployment->package_size - tail_size + (eocd - tail);
+    free( tail );
+
+    /* Packages are always written as ZIP64, the classic record only holds placeholders then. */
+    if (value >= sizeof(locator) && SUCCEEDED(read_package( deployment, value - sizeof(locator), locator, sizeof(locator) ))
+        && read_u32( locator ) == ZIP64_LOCATOR_SIGNATURE)
+    {
+        if (FAILED(hr = read_package( deployment, read_u64( locator + 8 ), end64, sizeof(end64) ))) return hr;
+        if (read_u32( end64 ) != ZIP64_END_SIGNATURE) return APPX_E_CORRUPT_CONTENT;
+        entry_count = read_u64( end64 + 32 );
+        directory_size = read_u64( end64 + 40 );
+        directory_offset = read_u64( end64 + 48 );
+    }
+
+    if (directory_offset > deployment->package_size || directory_size > deployment->package_size - directory_offset
+        || directory_size > 0x7fffffff || entry_count > directory_size / 46)
+        return APPX_E_CORRUPT_CONTENT;
+
+    if (!(directory = malloc( directory_size ))) return E_OUTOFMEMORY;
+    if (!(deployment->files = calloc( entry_count, sizeof(*deployment->files) )))
+    {
+        free( directory );
+        return E_OUTOFMEMORY;
+    }
+    if (FAILED(hr = read_package( deployment, directory_offset, directory, directory_size )))
+    {
+        free( directory );
+        return hr;
+    }
+
+    end = directory + directory_size;
+    for (entry = directory, i = 0; i < entry_count; i++, entry += 46 + name_length + extra_length + comment_length)
+    {
+        struct deployment_file *file = &deployment->files[deployment->file_count];
+
+        if (end - entry < 46 || read_u32( entry ) != ZIP_CENTRAL_HEADER_SIGNATURE) break;
+        name_length = read_u16( entry + 28 );
+        extra_length = read_u16( entry + 30 );
+        comment_length = read_u16( entry + 32 );
+        if (end - entry - 46 < name_length + extra_length + comment_length) break;
+
+        file->method = read_u16( entry + 10 );
+        file->crc = read_u32( entry + 16 );
+        file->compressed_size = read_u32( entry + 20 );
+        file->size = read_u32( entry + 24 );
+        file->header_offset = read_u32( entry + 42 );
+
+        for (extra = entry + 46 + name_length; extra + 4 <= entry + 46 + name_length + extra_length; extra += 4 + read_u16( extra + 2 ))
+        {
+            BYTE *field = extra + 4, *field_end = field + read_u16( extra + 2 );
+
+            if (read_u16( extra ) != 0x0001) continue;
+            if (file->size == 0xffffffff && field + 8 <= field_end) { file->size = read_u64( field ); field += 8; }
+            if (file->compressed_size == 0xffffffff && field + 8 <= field_end) { file->compressed_size = read_u64( field ); field += 8; }
+            if (file->header_offset == 0xffffffff && field + 8 <= field_end) { file->header_offset = read_u64( field ); field += 8; }
+        }
+
+        /* Directories are implied by the files they contain. */
+        if (!name_length || entry[46 + name_length - 1] == '/') continue;
+
+        if (!(file->name = decode_item_name( entry + 46, name_length )))
+        {
+            free( directory );
+            return E_OUTOFMEMORY;
+        }
+        if (!is_safe_item_name( file->name ) || (file->method != ZIP_METHOD_STORED && file->method != ZIP_METHOD_DEFLATED)
+            || file->header_offset > deployment->package_size || file->compressed_size > deployment->package_size)
+        {
+            WARN( "Rejecting item %s, method %u.\n", debugstr_w(file->name), file->method );
+            free( file->name );
+            file->name = NULL;
+            free( directory );
+            return APPX_E_CORRUPT_CONTENT;
+        }
+
+        InitOnceInitialize( &file->open_once );
+        deployment->file_count++;
+    }
+
+    free( directory );
+    return i == entry_count ? S_OK : APPX_E_CORRUPT_CONTENT;
+}
+
+static struct deployment_file *deployment_find_file( struct deployment *deployment, const WCHAR *name )
+{
+    UINT32 i;
+
+    for (i = 0; i < deployment->file_count; i++)
+        if (!wcsicmp( deployment->files[i].name, name )) return &deployment->files[i];
+    return NULL;
+}
+
+/* Reads a small item entirely, used for the manifest and the block map. */
+static HRESULT deployment_read_item( struct deployment *deployment, struct deployment_file *file, BYTE **data )
+{
+    z_stream stream = {0};
+    BYTE header[30], *input;
+    HRESULT hr;
+    int ret;
+
+    if (file->size > 0x4000000 || file->compressed_size > 0x4000000) return APPX_E_CORRUPT_CONTENT;
+
+    if (FAILED(hr = read_package( deployment, file->header_offset, header, sizeof(header) ))) return hr;
+    if (read_u32( header ) != ZIP_LOCAL_HEADER_SIGNATURE) return APPX_E_CORRUPT_CONTENT;
+
+    if (!(input = malloc( file->compressed_size + 1 ))) return E_OUTOFMEMORY;
+    if (!(*data = malloc( file->size + 1 )))
+    {
+        free( input );
+        return E_OUTOFMEMORY;
+    }
+
+    hr = read_package( deployment, file->header_offset + sizeof(header) + read_u16( header + 26 ) + read_u16( header + 28 ),
+                       input, file->compressed_size );
+    if (SUCCEEDED(hr) && file->method == ZIP_METHOD_STORED)
+    {
+        if (file->size == file->compressed_size) memcpy( *data, input, file->size );
+        else hr = APPX_E_CORRUPT_CONTENT;
+    }
+    else if (SUCCEEDED(hr))
+    {
+        stream.next_in = input;
+        stream.avail_in = file->compressed_size;
+        stream.next_out = *data;
+        stream.avail_out = file->size;
+        if (inflateInit2( &stream, -MAX_WBITS ) != Z_OK) hr = E_OUTOFMEMORY;
+        else
+        {
+            ret = inflate( &stream, Z_FINISH );
+            if (ret != Z_STREAM_END || stream.total_out != file->size) hr = APPX_E_CORRUPT_CONTENT;
+            inflateEnd( &stream );
+        }
+    }
+
+    free( input );
+    if (SUCCEEDED(hr) && crc32( 0, *data, file->size ) != file->crc) hr = APPX_E_CORRUPT_CONTENT;
+    if (FAILED(hr))
+    {
+        free( *data );
+        *data = NULL;
+        return hr;
+    }
+
+    (*data)[file->size] = 0;
+    return S_OK;
+}
+
+static HRESULT create_xml_reader( const BYTE *data, UINT32 size, IXmlReader **reader )
+{
+    IStream *stream;
+    HRESULT hr;
+
+    if (!(stream = SHCreateMemStream( data, size ))) return E_OUTOFMEMORY;
+    if (SUCCEEDED(hr = CreateXmlReader( &IID_IXmlReader, (void **)reader, NULL )))
+    {
+        hr = IXmlReader_SetInput( *reader, (IUnknown *)stream );
+        if (FAILED(hr)) IXmlReader_Release( *reader );
+    }
+    IStream_Release( stream );
+    return hr;
+}
+
+static BOOL decode_base64( const WCHAR *text, BYTE *output, UINT32 size )
+{
+    UINT32 bits = 0, count = 0, written = 0;
+    const WCHAR *c;
+    int value;
+
+    for (c = text; *c && *c != '='; c++)
+    {
+        if (*c >= 'A' && *c <= 'Z') value = *c - 'A';
+        else if (*c >= 'a' && *c <= 'z') value = *c - 'a' + 26;
+        else if (*c >= '0' && *c <= '9') value = *c - '0' + 52;
+        else if (*c == '+') value = 62;
+        else if (*c == '/') value = 63;
+        else return FALSE;
+
+        bits = (bits << 6) | value;
+        if ((count += 6) >= 8)
+        {
+            if (written == size) return FALSE;
+            output[written++] = bits >> (count -= 8);
+        }
+    }
+
+    return written == size;
+}
+
+static HRESULT deployment_read_block_map( struct deployment *deployment )
+{
+    struct deployment_file *file = NULL, *map_file;
+    struct deployment_block *blocks;
+    const WCHAR *name, *value;
+    UINT32 capacity = 0;
+    XmlNodeType type;
+    IXmlReader *reader;
+    BYTE *data;
+    HRESULT hr;
+
+    if (!(map_file = deployment_find_file( deployment, L"AppxBlockMap.xml" ))) return APPX_E_MISSING_REQUIRED_FILE;
+    if (FAILED(hr = deployment_read_item( deployment, map_file, &data ))) return hr;
+    if (FAILED(hr = create_xml_reader( data, map_file->size, &reader )))
+    {
+        free( data );
+        return hr;
+    }
+
+    while (SUCCEEDED(hr) && IXmlReader_Read( reader, &type ) == S_OK)
+    {
+        if (type != XmlNodeType_Element) continue;
+        IXmlReader_GetLocalName( reader, &name, NULL );
+
+        if (!wcscmp( name, L"File" ))
+        {
+            file = NULL;
+            capacity = 0;
+            if (IXmlReader_MoveToAttributeByName( reader, L"Name", NULL ) != S_OK) hr = APPX_E_INVALID_BLOCKMAP;
+            else if (IXmlReader_GetValue( reader, &value, NULL ), !(file = deployment_find_file( deployment, value )))
+            {
+                WARN( "Block map lists %s which is not in the package.\n", debugstr_w(value) );
+                hr = APPX_E_MISSING_REQUIRED_FILE;
+            }
+            else
+            {
+                file->in_block_map = TRUE;
+                if (IXmlReader_MoveToAttributeByName( reader, L"Size", NULL ) == S_OK
+                    && (IXmlReader_GetValue( reader, &value, NULL ), _wcstoui64( value, NULL, 10 ) != file->size))
+                    hr = APPX_E_INVALID_BLOCKMAP;
+                if (IXmlReader_MoveToAttributeByName( reader, L"LfhSize", NULL ) == S_OK)
+                {
+                    IXmlReader_GetValue( reader, &value, NULL );
+                    file->header_size = wcstoul( value, NULL, 10 );
+                }
+            }
+        }
+        else if (!wcscmp( name, L"Block" ) && file)
+        {
+            if (file->block_count == capacity)
+            {
+                capacity = max( 16, capacity * 2 );
+                if (!(blocks = realloc( file->blocks, capacity * sizeof(*blocks) )))
+                {
+                    hr = E_OUTOFMEMORY;
+                    break;
+                }
+                file->blocks = blocks;
+            }
+
+            blocks = &file->blocks[file->block_count++];
+            blocks->size = 0;
+            if (IXmlReader_MoveToAttributeByName( reader, L"Hash", NULL ) != S_OK
+                || (IXmlReader_GetValue( reader, &value, NULL ), !decode_base64( value, blocks->hash, sizeof(blocks->hash) )))
+                hr = APPX_E_INVALID_BLOCKMAP;
+            if (IXmlReader_MoveToAttributeByName( reader, L"Size", NULL ) == S_OK)
+            {
+                IXmlReader_GetValue( reader, &value, NULL );
+                blocks->size = wcstoul( value, NULL, 10 );
+            }
+        }
+    }
+
+    IXmlReader_Release( reader );
+    free( data );
+    return hr;
+}
+
+/* The publisher id is the first 64 bits of the SHA-256 of the publisher, in Crockford's base32. */
+static HRESULT get_publisher_id( struct deployment *deployment, const WCHAR *publisher, WCHAR id[14] )
+{
+    static const WCHAR alphabet[] = L"0123456789abcdefghjkmnpqrstvwxyz";
+    BYTE hash[32];
+    UINT64 bits;
+    NTSTATUS status;
+    int i;
+
+    status = BCryptHash( deployment->sha256, NULL, 0, (BYTE *)publisher, wcslen( publisher ) * sizeof(WCHAR), hash, sizeof(hash) );
+    if (status) return HRESULT_FROM_NT( status );
+
+    for (bits = 0, i = 0; i < 8; i++) bits = (bits << 8) | hash[i];
+    for (i = 0; i < 13; i++) id[i] = alphabet[i < 12 ? (bits >> (59 - 5 * i)) & 0x1f : (bits << 1) & 0x1f];
+    id[13] = 0;
+    return S_OK;
+}
+
+/* The identity fields become part of the installation path, Windows only allows these characters in them. */
+static BOOL is_valid_identity_field( const WCHAR *value )
+{
+    for (; *value; value++)
+        if ((*value < 'a' || *value > 'z') && (*value < 'A' || *value > 'Z') &&
+            (*value < '0' || *value > '9') && *value != '.' && *value != '-') return FALSE;
+    return TRUE;
+}
+
+static HRESULT deployment_read_manifest( struct deployment *deployment )
+{
+    WCHAR identity[5][MAX_PATH] = {{0}}, publisher_id[14];
+    static const WCHAR *attributes[] = { L"Name", L"Version", L"ProcessorArchitecture", L"ResourceId", L"Publisher" };
+    struct deployment_file *file;
+    const WCHAR *name, *value;
+    XmlNodeType type;
+    IXmlReader *reader;
+    BOOL found = FALSE;
+    BYTE *data;
+    HRESULT hr;
+    int i;
+
+    if (!(file = deployment_find_file( deployment, L"AppxManifest.xml" )))
+    {
+        if (deployment_find_file( deployment, L"AppxMetadata\\AppxBundleManifest.xml" ))
+            FIXME( "Package bundles are not supported.\n" );
+        return APPX_E_MISSING_REQUIRED_FILE;
+    }
+
+    if (FAILED(hr = deployment_read_item( deployment, file, &data ))) return hr;
+    if (FAILED(hr = create_xml_reader( data, file->size, &reader )))
+    {
+        free( data );
+        return hr;
+    }
+
+    while (!found && IXmlReader_Read( reader, &type ) == S_OK)
+    {
+        if (type != XmlNodeType_Element) continue;
+        IXmlReader_GetLocalName( reader, &name, NULL );
+        if (wcscmp( name, L"Identity" )) continue;
+
+        for (i = 0; i < ARRAY_SIZE(attributes); i++)
+        {
+            if (IXmlReader_MoveToAttributeByName( reader, attributes[i], NULL ) != S_OK) continue;
+            IXmlReader_GetValue( reader, &value, NULL );
+            lstrcpynW( identity[i], value, MAX_PATH );
+        }
+        found = TRUE;
+    }
+
+    IXmlReader_Release( reader );
+    free( data );
+
+    if (!found || !identity[0][0] || !identity[1][0] || !identity[4][0]) return APPX_E_CORRUPT_CONTENT;
+    if (!identity[2][0]) wcscpy( identity[2], L"neutral" );
+    for (i = 0; i < 4; i++)
+    {
+        if (is_valid_identity_field( identity[i] )) continue;
+        WARN( "Invalid %s %s in the package identity.\n", debugstr_w(attributes[i]), debugstr_w(identity[i]) );
+        return APPX_E_CORRUPT_CONTENT;
+    }
+    if (FAILED(hr = get_publisher_id( deployment, identity[4], publisher_id ))) return hr;
+
+    swprintf( deployment->full_name, ARRAY_SIZE(deployment->full_name), L"%s_%s_%s_%s_%s",
+              identity[0], identity[1], wcslwr( identity[2] ), identity[3], publisher_id );
+
+    if (!GetEnvironmentVariableW( L"ProgramFiles", deployment->destination, ARRAY_SIZE(deployment->destination) ))
+        return HRESULT_FROM_WIN32( GetLastError() );
+    if (wcslen( deployment->destination ) + wcslen( deployment->full_name ) + 14 >= ARRAY_SIZE(deployment->destination))
+        return HRESULT_FROM_WIN32( ERROR_FILENAME_EXCED_RANGE );
+    wcscat( deployment->destination, L"\\WindowsApps" );
+    CreateDirectoryW( deployment->destination, NULL );
+    wcscat( deployment->destination, L"\\" );
+    wcscat( deployment->destination, deployment->full_name );
+
+    TRACE( "Deploying %s to %s.\n", debugstr_w(deployment->full_name), debugstr_w(deployment->destination) );
+    return S_OK;
+}
+
+static HRESULT deployment_add_task( struct deployment *deployment, UINT32 *capacity, const struct deployment_task *task )
+{
+    struct deployment_task *tasks;
+
+    if (deployment->task_count == *capacity)
+    {
+        *capacity = max( 64, *capacity * 2 );
+        if (!(tasks = realloc( deployment->tasks, *capacity * sizeof(*tasks) ))) return E_OUTOFMEMORY;
+        deployment->tasks = tasks;
+    }
+
+    deployment->tasks[deployment->task_count++] = *task;
+    task->file->pending_tasks++;
+    return S_OK;
+}
+
+/* Splits every file into runs of blocks that can be inflated independently. */
+static HRESULT deployment_plan( struct deployment *deployment )
+{
+    struct deployment_task task;
+    struct deployment_file *file;
+    UINT32 capacity = 0, i, block;
+    BOOL splittable;
+    HRESULT hr;
+
+    for (i = 0; i < deployment->file_count; i++)
+    {
+        file = &deployment->files[i];
+
+        /* Packaging metadata, not part of the installed package. */
+        if (!wcsicmp( file->name, L"[Content_Types].xml" )) continue;
+
+        if (file->in_block_map && file->block_count != (file->size + DEPLOYMENT_BLOCK_SIZE - 1) / DEPLOYMENT_BLOCK_SIZE)
+            return APPX_E_INVALID_BLOCKMAP;
+
+        splittable = file->in_block_map && file->header_size && file->block_count > DEPLOYMENT_TASK_BLOCKS;
+        for (block = 0; splittable && file->method == ZIP_METHOD_DEFLATED && block < file->block_count; block++)
+            if (!file->blocks[block].size) splittable = FALSE;
+
+        if (!splittable)
+        {
+            task.file = file;
+            task.first_block = 0;
+            task.input_offset = 0;
+            task.input_size = file->compressed_size;
+            task.output_offset = 0;
+            task.output_size = file->size;
+            if (FAILED(hr = deployment_add_task( deployment, &capacity, &task ))) return hr;
+        }
+        else
+        {
+            UINT64 input_offset = 0;
+
+            for (block = 0; block < file->block_count; block += DEPLOYMENT_TASK_BLOCKS)
+            {
+                UINT32 count = min( DEPLOYMENT_TASK_BLOCKS, file->block_count - block ), j;
+
+                task.file = file;
+                task.first_block = block;
+                task.input_offset = input_offset;
+                task.output_offset = (UINT64)block * DEPLOYMENT_BLOCK_SIZE;
+                task.output_size = min( (UINT64)count * DEPLOYMENT_BLOCK_SIZE, file->size - task.output_offset );
+                if (file->method == ZIP_METHOD_STORED) task.input_size = task.output_size;
+                else for (task.input_size = 0, j = 0; j < count; j++) task.input_size += file->blocks[block + j].size;
+
+                /* The final block also carries the end of the deflate stream. */
+                if (block + count == file->block_count) task.input_size = file->compressed_size - input_offset;
+                if (input_offset + task.input_size > file->compressed_size) return APPX_E_INVALID_BLOCKMAP;
+
+                input_offset += task.input_size;
+                if (FAILED(hr = deployment_add_task( deployment, &capacity, &task ))) return hr;
+            }
+        }
+
+        deployment->total_bytes += file->size;
+    }
+
+    return S_OK;
+}
+
+static BOOL WINAPI deployment_open_file( INIT_ONCE *once, void *param, void **context )
+{
+    struct deployment *deployment = param;
+    struct deployment_file *file = CONTAINING_RECORD( once, struct deployment_file, open_once );
+    WCHAR path[MAX_PATH], *separator;
+    LARGE_INTEGER size;
+    BYTE header[30];
+    HRESULT hr;
+
+    if (FAILED(hr = read_package( deployment, file->header_offset, header, sizeof(header) ))
+        || read_u32( header ) != ZIP_LOCAL_HEADER_SIGNATURE)
+    {
+        deployment_fail( deployment, FAILED(hr) ? hr : APPX_E_CORRUPT_CONTENT );
+        return TRUE;
+    }
+    file->data_offset = file->header_offset + sizeof(header) + read_u16( header + 26 ) + read_u16( header + 28 );
+    if (file->header_size && file->header_size != file->data_offset - file->header_offset)
+    {
+        deployment_fail( deployment, APPX_E_INVALID_BLOCKMAP );
+        return TRUE;
+    }
+
+    if (swprintf( path, ARRAY_SIZE(path), L"%s\\%s", deployment->destination, file->name ) < 0)
+    {
+        deployment_fail( deployment, HRESULT_FROM_WIN32( ERROR_FILENAME_EXCED_RANGE ) );
+        return TRUE;
+    }
+
+    for (separator = wcschr( path + wcslen( deployment->destination ) + 1, '\\' ); separator; separator = wcschr( separator + 1, '\\' ))
+    {
+        *separator = 0;
+        CreateDirectoryW( path, NULL );
+        *separator = '\\';
+    }
+
+    file->handle = CreateFileW( path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL );
+    if (file->handle == INVALID_HANDLE_VALUE)
+    {
+        file->handle = NULL;
+        deployment_fail( deployment, HRESULT_FROM_WIN32( GetLastError() ) );
+        return TRUE;
+    }
+
+    /* Runs of the same file complete out of order, allocate it up front. */
+    size.QuadPart = file->size;
+    if (file->size > DEPLOYMENT_BUFFER_SIZE && SetFilePointerEx( file->handle, size, NULL, FILE_BEGIN ))
+        SetEndOfFile( file->handle );
+
+    return TRUE;
+}
+
+struct deployment_worker
+{
+    struct deployment *deployment;
+    BCRYPT_HASH_HANDLE hash;
+    z_stream stream;
+    BOOL stream_initialized;
+    BYTE *input;
+    BYTE *output;
+};
+
+static void deployment_report( struct deployment *deployment, UINT64 bytes )
+{
+    LONG64 written = InterlockedAdd64( &deployment->written_bytes, bytes );
+    LONG percentage, reported;
+
+    /* The last percent is only reported once the package has been registered. */
+    percentage = deployment->total_bytes ? min( 99, written * 100 / deployment->total_bytes ) : 99;
+    reported = ReadNoFence( &deployment->reported );
+    if (percentage > reported && InterlockedCompareExchange( &deployment->reported, percentage, reported ) == reported)
+        async_deployment_report( deployment->operation, percentage );
+}
+
+/* Checks the block hashes of an output run, then writes it at its offset in the file. */
+static HRESULT deployment_flush( struct deployment_worker *worker, const struct deployment_task *task, UINT32 block, UINT64 offset, UINT32 size )
+{
+    struct deployment_file *file = task->file;
+    OVERLAPPED overlapped = {0};
+    BYTE hash[32];
+    UINT32 done, length;
+    DWORD written;
+    NTSTATUS status;
+
+    for (done = 0; file->in_block_map && done < size; done += length, block++)
+    {
+        length = min( DEPLOYMENT_BLOCK_SIZE, size - done );
+        if ((status = BCryptHashData( worker->hash, worker->output + done, length, 0 ))) return HRESULT_FROM_NT( status );
+        if ((status = BCryptFinishHash( worker->hash, hash, sizeof(hash), 0 ))) return HRESULT_FROM_NT( status );
+        if (memcmp( hash, file->blocks[block].hash, sizeof(hash) ))
+        {
+            WARN( "Block %u of %s does not match the block map.\n", block, debugstr_w(file->name) );
+            return APPX_E_BLOCK_HASH_INVALID;
+        }
+    }
+
+    overlapped.Offset = offset;
+    overlapped.OffsetHigh = offset >> 32;
+    if (!WriteFile( file->handle, worker->output, size, &written, &overlapped )) return HRESULT_FROM_WIN32( GetLastError() );
+    if (written != size) return HRESULT_FROM_WIN32( ERROR_DISK_FULL );
+
+    deployment_report( worker->deployment, size );
+    return S_OK;
+}
+
+static HRESULT deployment_run_task( struct deployment_worker *worker, const struct deployment_task *task )
+{
+    struct deployment *deployment = worker->deployment;
+    struct deployment_file *file = task->file;
+    UINT64 input_offset = file->data_offset + task->input_offset, input_left = task->input_size;
+    UINT64 output_offset = task->output_offset, output_left = task->output_size;
+    UINT32 block = task->first_block, used = 0, count;
+    BOOL verify_crc = !file->in_block_map && !task->output_offset;
+    UINT32 crc = 0;
+    HRESULT hr;
+    int ret;
+
+    if (file->method == ZIP_METHOD_STORED)
+    {
+        if (task->input_size != task->output_size) return APPX_E_CORRUPT_CONTENT;
+
+        while (output_left)
+        {
+            if (FAILED(hr = deployment_status( deployment ))) return hr;
+
+            count = min( output_left, DEPLOYMENT_BUFFER_SIZE );
+            if (FAILED(hr = read_package( deployment, input_offset, worker->output, count ))) return hr;
+            if (verify_crc) crc = crc32( crc, worker->output, count );
+            if (FAILED(hr = deployment_flush( worker, task, block, output_offset, count ))) return hr;
+
+            input_offset += count;
+            output_offset += count;
+            output_left -= count;
+            block += count / DEPLOYMENT_BLOCK_SIZE;
+        }
+
+        return verify_crc && crc != file->crc ? APPX_E_CORRUPT_CONTENT : S_OK;
+    }
+
+    if (!worker->stream_initialized)
+    {
+        if (inflateInit2( &worker->stream, -MAX_WBITS ) != Z_OK) return E_OUTOFMEMORY;
+        worker->stream_initialized = TRUE;
+    }
+    else inflateReset( &worker->stream );
+
+    worker->stream.avail_in = 0;
+    while (output_left)
+    {
+        if (FAILED(hr = deployment_status( deployment ))) return hr;
+
+        if (!worker->stream.avail_in)
+        {
+            if (!input_left) return APPX_E_CORRUPT_CONTENT;
+            count = min( input_left, DEPLOYMENT_BUFFER_SIZE );
+            if (FAILED(hr = read_package( deployment, input_offset, worker->input, count ))) return hr;
+            worker->stream.next_in = worker->input;
+            worker->stream.avail_in = count;
+            input_offset += count;
+            input_left -= count;
+        }
+
+        worker->stream.next_out = worker->output + used;
+        worker->stream.avail_out = min( DEPLOYMENT_BUFFER_SIZE - used, output_left - used );
+        count = worker->stream.avail_out;
+
+        ret = inflate( &worker->stream, Z_NO_FLUSH );
+        if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) return APPX_E_CORRUPT_CONTENT;
+        used += count - worker->stream.avail_out;
+        if (ret == Z_STREAM_END && used < output_left) return APPX_E_CORRUPT_CONTENT;
+        if (ret == Z_BUF_ERROR && count == worker->stream.avail_out && !input_left && !worker->stream.avail_in)
+            return APPX_E_CORRUPT_CONTENT;
+
+        if (used == DEPLOYMENT_BUFFER_SIZE || used == output_left)
+        {
+            if (verify_crc) crc = crc32( crc, worker->output, used );
+            if (FAILED(hr = deployment_flush( worker, task, block, output_offset, used ))) return hr;
+            output_offset += used;
+            output_left -= used;
+            block += used / DEPLOYMENT_BLOCK_SIZE;
+            used = 0;
+        }
+    }
+
+    return verify_crc && crc != file->crc ? APPX_E_CORRUPT_CONTENT : S_OK;
+}
+
+static void CALLBACK deployment_worker_cb( TP_CALLBACK_INSTANCE *instance, void *context, TP_WORK *work )
+{
+    struct deployment_worker worker = { .deployment = context };
+    struct deployment *deployment = context;
+    struct deployment_task *task;
+    NTSTATUS status;
+    HRESULT hr;
+    LONG index;
+
+    worker.input = malloc( DEPLOYMENT_BUFFER_SIZE );
+    worker.output = malloc( DEPLOYMENT_BUFFER_SIZE );
+    if (!worker.input || !worker.output) deployment_fail( deployment, E_OUTOFMEMORY );
+    else if ((status = BCryptCreateHash( deployment->sha256, &worker.hash, NULL, 0, NULL, 0, BCRYPT_HASH_REUSABLE_FLAG )))
+        deployment_fail( deployment, HRESULT_FROM_NT( status ) );
+
+    while (SUCCEEDED(deployment_status( deployment )) && (index = InterlockedIncrement( &deployment->next_task ) - 1) < deployment->task_count)
+    {
+        task = &deployment->tasks[index];
+
+        InitOnceExecuteOnce( &task->file->open_once, deployment_open_file, deployment, NULL );
+        if (!task->file->handle) break;
+
+        if (FAILED(hr = deployment_run_task( &worker, task ))) deployment_fail( deployment, hr );
+
+        if (!InterlockedDecrement( &task->file->pending_tasks ))
+        {
+            CloseHandle( task->file->handle );
+            task->file->handle = NULL;
+        }
+    }
+
+    if (worker.stream_initialized) inflateEnd( &worker.stream );
+    if (worker.hash) BCryptDestroyHash( worker.hash );
+    free( worker.input );
+    free( worker.output );
+}
+
+static HRESULT deployment_extract( struct deployment *deployment )
+{
+    SYSTEM_INFO info;
+    UINT32 workers, i;
+    TP_WORK *work;
+
+    GetSystemInfo( &info );
+    workers = max( 1, min( min( info.dwNumberOfProcessors, DEPLOYMENT_MAX_WORKERS ), deployment->task_count ) );
+
+    TRACE( "Extracting %u files in %u tasks, %I64u bytes, %u workers.\n", deployment->file_count, deployment->task_count,
+           deployment->total_bytes, workers );
+
+    if (!(work = CreateThreadpoolWork( deployment_worker_cb, deployment, NULL ))) return HRESULT_FROM_WIN32( GetLastError() );
+    for (i = 0; i < workers; i++) SubmitThreadpoolWork( work );
+    WaitForThreadpoolWorkCallbacks( work, FALSE );
+    CloseThreadpoolWork( work );
+
+    /* Files whose first task never ran after a failure still hold their handle. */
+    for (i = 0; i < deployment->file_count; i++)
+        if (deployment->files[i].handle) CloseHandle( deployment->files[i].handle );
+
+    return deployment->hr;
+}
+
+static void delete_tree( const WCHAR *path )
+{
+    WIN32_FIND_DATAW data;
+    WCHAR child[MAX_PATH];
+    HANDLE find;
+
+    swprintf( child, ARRAY_SIZE(child), L"%s\\*", path );
+    if ((find = FindFirstFileW( child, &data )) != INVALID_HANDLE_VALUE)
+    {
+        do
+        {
+            if (!wcscmp( data.cFileName, L"." ) || !wcscmp( data.cFileName, L".." )) continue;
+            swprintf( child, ARRAY_SIZE(child), L"%s\\%s", path, data.cFileName );
+            if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) delete_tree( child );
+            else DeleteFileW( child );
+        } while (FindNextFileW( find, &data ));
+        FindClose( find );
+    }
+    RemoveDirectoryW( path );
+}
+
+static HRESULT deployment_register( struct deployment *deployment )
+{
+    HKEY key;
+    LSTATUS ret;
+
+    if ((ret = RegCreateKeyExW( HKEY_CURRENT_USER, packages_key, 0, NULL, 0, KEY_ALL_ACCESS, NULL, &key, NULL )))
+        return HRESULT_FROM_WIN32( ret );
+    ret = RegSetKeyValueW( key, deployment->full_name, L"PackageRootFolder", REG_SZ, deployment->destination,
+                           (wcslen( deployment->destination ) + 1) * sizeof(WCHAR) );
+    RegCloseKey( key );
+
+    return HRESULT_FROM_WIN32( ret );
+}
+
+static void deployment_free( struct deployment *deployment )
+{
+    UINT32 i;
+
+    if (deployment->sha256) BCryptCloseAlgorithmProvider( deployment->sha256, 0 );
+    if (deployment->package && deployment->package != INVALID_HANDLE_VALUE) CloseHandle( deployment->package );
+    for (i = 0; i < deployment->file_count; i++)
+    {
+        free( deployment->files[i].name );
+        free( deployment->files[i].blocks );
+    }
+    free( deployment->files );
+    free( deployment->tasks );
+    free( deployment->package_path );
+    free( deployment );
+}
+
+static HRESULT deploy_package_async( void *param, IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress *operation )
+{
+    struct deployment *deployment = param;
+    WCHAR manifest[MAX_PATH];
+    NTSTATUS status;
+    HRESULT hr;
+
+    deployment->operation = operation;
+
+    deployment->package = CreateFileW( deployment->package_path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                                       FILE_FLAG_RANDOM_ACCESS, NULL );
+    if (deployment->package == INVALID_HANDLE_VALUE) hr = HRESULT_FROM_WIN32( GetLastError() );
+    else if ((status = BCryptOpenAlgorithmProvider( &deployment->sha256, BCRYPT_SHA256_ALGORITHM, NULL, 0 ))) hr = HRESULT_FROM_NT( status );
+    else if (SUCCEEDED(hr = deployment_read_central_directory( deployment ))
+             && SUCCEEDED(hr = deployment_read_manifest( deployment ))
+             && SUCCEEDED(hr = deployment_read_block_map( deployment ))
+             && SUCCEEDED(hr = deployment_plan( deployment )))
+    {
+        /* A package that is already staged is left as it is. */
+        swprintf( manifest, ARRAY_SIZE(manifest), L"%s\\AppxManifest.xml", deployment->destination );
+        if (GetFileAttributesW( manifest ) == INVALID_FILE_ATTRIBUTES)
+        {
+            CreateDirectoryW( deployment->destination, NULL );
+            if (FAILED(hr = deployment_extract( deployment ))) delete_tree( deployment->destination );
+        }
+
+        if (SUCCEEDED(hr) && deployment->register_package) hr = deployment_register( deployment );
+        if (SUCCEEDED(hr)) async_deployment_report( operation, 100 );
+    }
+
+    if (FAILED(hr)) WARN( "Failed to deploy %s, hr %#lx.\n", debugstr_w(deployment->package_path), hr );
+    deployment_free( deployment );
+    return hr;
+}
+
+HRESULT deploy_package( IUriRuntimeClass *uri, BOOL register_package,
+                        IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress **operation )
+{
+    struct deployment *deployment;
+    DWORD length = MAX_PATH;
+    HSTRING scheme, text;
+    BOOL is_file;
+    HRESULT hr;
+
+    if (!uri || !operation) return E_POINTER;
+
+    if (FAILED(hr = IUriRuntimeClass_get_SchemeName( uri, &scheme ))) return hr;
+    is_file = !wcsicmp( WindowsGetStringRawBuffer( scheme, NULL ), L"file" );
+    WindowsDeleteString( scheme );
+    if (!is_file)
+    {
+        FIXME( "Only local packages are supported.\n" );
+        return E_INVALIDARG;
+    }
+
+    if (!(deployment = calloc( 1, sizeof(*deployment) ))) return E_OUTOFMEMORY;
+    deployment->register_package = register_package;
+    if (!(deployment->package_path = malloc( length * sizeof(WCHAR) )))
+    {
+        free( deployment );
+        return E_OUTOFMEMORY;
+    }
+
+    if (SUCCEEDED(hr = IUriRuntimeClass_get_AbsoluteUri( uri, &text )))
+    {
+        hr = PathCreateFromUrlW( WindowsGetStringRawBuffer( text, NULL ), deployment->package_path, &length, 0 );
+        WindowsDeleteString( text );
+    }
+
+    if (FAILED(hr) || FAILED(hr = async_deployment_create( deploy_package_async, deployment, operation )))
+        deployment_free( deployment );
+    return hr;
+}
@@ -102,8 +102,13 @@ static HRESULT WINAPI package_manager_GetTrustLevel( IPackageManager *iface, Tru
 static HRESULT WINAPI package_manager_AddPackageAsync( IPackageManager *iface, IUriRuntimeClass *uri,
     IIterable_Uri *dependencies, DeploymentOptions options, IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress **operation )
 {
-    FIXME( "iface %p, uri %p, dependencies %p, options %d, operation %p stub!\n", iface, uri, dependencies, options, operation );
-    return E_NOTIMPL;
+    TRACE( "iface %p, uri %p, dependencies %p, options %d, operation %p.\n", iface, uri, dependencies, options, operation );
+
+    if (options & DeploymentOptions_DevelopmentMode) return E_INVALIDARG;
+    if (dependencies) FIXME( "Ignoring dependencies %p.\n", dependencies );
+    if (options & ~DeploymentOptions_ForceApplicationShutdown) FIXME( "Ignoring options %#x.\n", options );
+
+    return deploy_package( uri, TRUE, operation );
 }
 
 static HRESULT WINAPI package_manager_UpdatePackageAsync( IPackageManager *iface, IUriRuntimeClass *uri, IIterable_Uri *dependencies,
@@ -123,8 +128,11 @@ static HRESULT WINAPI package_manager_RemovePackageAsync( IPackageManager *iface
 static HRESULT WINAPI package_manager_StagePackageAsync( IPackageManager *iface, IUriRuntimeClass *uri, IIterable_Uri *dependencies,
     IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress **operation )
 {
-    FIXME( "iface %p, uri %p, dependencies %p, operation %p stub!\n", iface, uri, dependencies, operation );
-    return E_NOTIMPL;
+    TRACE( "iface %p, uri %p, dependencies %p, operation %p.\n", iface, uri, dependencies, operation );
+
+    if (dependencies) FIXME( "Ignoring dependencies %p.\n", dependencies );
+
+    return deploy_package( uri, FALSE, operation );
 }
 
 static HRESULT WINAPI package_manager_RegisterPackageAsync( IPackageManager *iface, IUriRuntimeClass *uri, IIterable_Uri *dependencies,
@@ -246,8 +254,12 @@ static HRESULT WINAPI package_manager2_RemovePackageWithOptionsAsync( IPackageMa
 static HRESULT WINAPI package_manager2_StagePackageWithOptionsAsync( IPackageManager2 *iface, IUriRuntimeClass *uri, IIterable_Uri *dependencies,
     DeploymentOptions options, IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress **operation )
 {
-    FIXME( "iface %p, uri %p, dependencies %p, options %d, operation %p stub!\n", iface, uri, dependencies, options, operation );
-    return E_NOTIMPL;
+    TRACE( "iface %p, uri %p, dependencies %p, options %d, operation %p.\n", iface, uri, dependencies, options, operation );
+
+    if (dependencies) FIXME( "Ignoring dependencies %p.\n", dependencies );
+    if (options) FIXME( "Ignoring options %#x.\n", options );
+
+    return deploy_package( uri, FALSE, operation );
 }
 
 static HRESULT WINAPI package_manager2_RegisterPackageByFullNameAsync( IPackageManager2 *iface, HSTRING name, IIterable_HSTRING *dependencies,
@@ -38,6 +38,16 @@
 
 extern IActivationFactory *package_manager_factory;
 
+typedef HRESULT (*async_deployment_callback)( void *param, IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress *operation );
+
+HRESULT async_deployment_create( async_deployment_callback callback, void *param,
+                                 IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress **out );
+void async_deployment_report( IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress *operation, UINT32 percentage );
+BOOL async_deployment_is_canceled( IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress *operation );
+
+HRESULT deploy_package( IUriRuntimeClass *uri, BOOL register_package,
+                        IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress **operation );
+
 #define DEFINE_IINSPECTABLE_( pfx, iface_type, impl_type, impl_from, iface_mem, expr )             \
     static inline impl_type *impl_from( iface_type *iface )                                        \
     {                                                                                              \
@@ -3374,6 +3374,7 @@ BOOL WINAPI DllMain(HINSTANCE hinstDLL, DWORD reason, LPVOID reserved)
     case DLL_PROCESS_DETACH:
         com_revoke_local_servers();
         if (reserved) break;
+        activation_factory_cache_cleanup();
         apartment_global_cleanup();
         DeleteCriticalSection(&registered_classes_cs);
         rpc_unregister_channel_hooks();
@@ -118,6 +118,8 @@ void apartment_global_cleanup(void);
 OXID apartment_getoxid(const struct apartment *apt);
 HRESULT apartment_disconnectproxies(struct apartment *apt);
 
+void activation_factory_cache_cleanup(void);
+
 /* RpcSs interface */
 HRESULT rpcss_get_next_seqid(DWORD *id);
 HRESULT rpc_get_local_class_object(REFCLSID rclsid, REFIID riid, void **obj);
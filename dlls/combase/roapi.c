@@ -27,6 +27,7 @@
 #include "combase_private.h"
 
 #include "wine/debug.h"
+#include "wine/rbtree.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(combase);
 
@@ -39,9 +40,8 @@ struct activatable_class_data
     DWORD threading_model;
 };
 
-static HRESULT get_library_for_classid(const WCHAR *classid, WCHAR **out)
+static HRESULT get_library_for_classid(const WCHAR *classid, const ACTCTX_SECTION_KEYED_DATA *data, WCHAR **out)
 {
-    ACTCTX_SECTION_KEYED_DATA data;
     HKEY hkey_root, hkey_class;
     DWORD type, size;
     HRESULT hr;
@@ -50,12 +50,10 @@ static HRESULT get_library_for_classid(const WCHAR *classid, WCHAR **out)
     *out = NULL;
 
     /* search activation context first */
-    data.cbSize = sizeof(data);
-    if (FindActCtxSectionStringW(FIND_ACTCTX_SECTION_KEY_RETURN_HACTCTX, NULL,
-            ACTIVATION_CONTEXT_SECTION_WINRT_ACTIVATABLE_CLASSES, classid, &data))
+    if (data->hActCtx)
     {
-        struct activatable_class_data *activatable_class = (struct activatable_class_data *)data.lpData;
-        void *ptr = (BYTE *)data.lpSectionBase + activatable_class->module_offset;
+        struct activatable_class_data *activatable_class = (struct activatable_class_data *)data->lpData;
+        void *ptr = (BYTE *)data->lpSectionBase + activatable_class->module_offset;
         *out = wcsdup(ptr);
         return S_OK;
     }
@@ -107,6 +105,7 @@ static HRESULT get_library_for_classid(const WCHAR *classid, WCHAR **out)
         buf = expanded;
     }
 
+    RegCloseKey(hkey_class);
     *out = buf;
     return S_OK;
 
@@ -117,6 +116,265 @@ done:
 }
 
 
+/* Activation factories are cached per class, so that activating the same class again does not go
+ * through the registry, the loader and DllGetActivationFactory. Unregistered classes are cached too.
+ * The cache is flushed whenever something changes under the ActivatableClassId key. */
+struct activation_factory_entry
+{
+    struct rb_entry entry;
+    HRESULT hr;
+    HANDLE actctx;
+    PFNGETACTIVATIONFACTORY get_factory;
+    IActivationFactory *factory;
+    WCHAR classid[1];
+};
+
+struct activation_factory_cache_stats
+{
+    LONG hits;
+    LONG module_hits;
+    LONG negative_hits;
+    LONG misses;
+    LONG flushes;
+};
+
+static int activation_factory_entry_compare(const void *key, const struct rb_entry *entry)
+{
+    const struct activation_factory_entry *factory_entry = RB_ENTRY_VALUE(entry, const struct activation_factory_entry, entry);
+    return wcscmp(key, factory_entry->classid);
+}
+
+static struct rb_tree activation_factory_cache = { activation_factory_entry_compare };
+static SRWLOCK activation_factory_cache_lock = SRWLOCK_INIT;
+static INIT_ONCE activation_factory_cache_once = INIT_ONCE_STATIC_INIT;
+static struct activation_factory_cache_stats activation_factory_cache_stats;
+static HKEY activation_factory_cache_key;
+static HANDLE activation_factory_cache_event;
+static TP_WAIT *activation_factory_cache_wait;
+static LONG activation_factory_cache_generation;
+
+static void activation_factory_entry_destroy(struct rb_entry *entry, void *context)
+{
+    struct activation_factory_entry *factory_entry = RB_ENTRY_VALUE(entry, struct activation_factory_entry, entry);
+
+    /* modules are never unloaded, the factories they hand out may still be in use */
+    if (factory_entry->factory && context) IActivationFactory_Release(factory_entry->factory);
+    if (factory_entry->actctx) ReleaseActCtx(factory_entry->actctx);
+    free(factory_entry);
+}
+
+static void activation_factory_cache_trace(const char *reason)
+{
+    TRACE("%s: %ld hits, %ld module hits, %ld negative hits, %ld misses, %ld flushes\n", reason,
+          ReadNoFence(&activation_factory_cache_stats.hits), ReadNoFence(&activation_factory_cache_stats.module_hits),
+          ReadNoFence(&activation_factory_cache_stats.negative_hits), ReadNoFence(&activation_factory_cache_stats.misses),
+          ReadNoFence(&activation_factory_cache_stats.flushes));
+}
+
+static BOOL activation_factory_cache_arm(void)
+{
+    return !RegNotifyChangeKeyValue(activation_factory_cache_key, TRUE,
+                                    REG_NOTIFY_CHANGE_NAME | REG_NOTIFY_CHANGE_LAST_SET | REG_NOTIFY_THREAD_AGNOSTIC,
+                                    activation_factory_cache_event, TRUE);
+}
+
+static void CALLBACK activation_factory_cache_changed(TP_CALLBACK_INSTANCE *instance, void *context, TP_WAIT *wait,
+                                                      TP_WAIT_RESULT result)
+{
+    AcquireSRWLockExclusive(&activation_factory_cache_lock);
+    activation_factory_cache_generation++;
+    rb_destroy(&activation_factory_cache, activation_factory_entry_destroy, (void *)TRUE);
+    InterlockedIncrement(&activation_factory_cache_stats.flushes);
+    ReleaseSRWLockExclusive(&activation_factory_cache_lock);
+
+    activation_factory_cache_trace("ActivatableClassId changed");
+
+    if (activation_factory_cache_arm()) SetThreadpoolWait(wait, activation_factory_cache_event, NULL);
+    else WARN("Failed to watch ActivatableClassId, unregistered classes will no longer be cached\n");
+}
+
+static BOOL WINAPI activation_factory_cache_init(INIT_ONCE *once, void *param, void **context)
+{
+    if (RegOpenKeyExW(HKEY_LOCAL_MACHINE, L"Software\\Microsoft\\WindowsRuntime\\ActivatableClassId", 0,
+                      KEY_NOTIFY, &activation_factory_cache_key))
+        return TRUE;
+
+    if (!(activation_factory_cache_event = CreateEventW(NULL, FALSE, FALSE, NULL))
+            || !(activation_factory_cache_wait = CreateThreadpoolWait(activation_factory_cache_changed, NULL, NULL))
+            || !activation_factory_cache_arm())
+    {
+        if (activation_factory_cache_wait) CloseThreadpoolWait(activation_factory_cache_wait);
+        if (activation_factory_cache_event) CloseHandle(activation_factory_cache_event);
+        RegCloseKey(activation_factory_cache_key);
+        activation_factory_cache_wait = NULL;
+        return TRUE;
+    }
+
+    SetThreadpoolWait(activation_factory_cache_wait, activation_factory_cache_event, NULL);
+    return TRUE;
+}
+
+/* Only returns entries resolved through the same activation context, or through the registry. */
+static struct activation_factory_entry *activation_factory_cache_get(const WCHAR *classid, HANDLE actctx)
+{
+    struct activation_factory_entry *factory_entry;
+    struct rb_entry *entry;
+
+    if (!(entry = rb_get(&activation_factory_cache, classid))) return NULL;
+    factory_entry = RB_ENTRY_VALUE(entry, struct activation_factory_entry, entry);
+    return factory_entry->actctx == actctx ? factory_entry : NULL;
+}
+
+/* Entries resolved before a flush are dropped, they may describe the registry from before the change. */
+static void activation_factory_cache_put(const WCHAR *classid, HANDLE actctx, LONG generation, HRESULT hr,
+                                         PFNGETACTIVATIONFACTORY get_factory, IActivationFactory *factory)
+{
+    struct activation_factory_entry *factory_entry;
+    struct rb_entry *entry;
+    SIZE_T len = wcslen(classid);
+    IAgileObject *agile;
+
+    /* without a change notification, unregistered classes could never be found again */
+    if (FAILED(hr) && !activation_factory_cache_wait) return;
+
+    if (!(factory_entry = calloc(1, offsetof(struct activation_factory_entry, classid[len + 1])))) return;
+    factory_entry->hr = hr;
+    factory_entry->get_factory = get_factory;
+    memcpy(factory_entry->classid, classid, (len + 1) * sizeof(WCHAR));
+    if (actctx)
+    {
+        AddRefActCtx(actctx);
+        factory_entry->actctx = actctx;
+    }
+
+    /* only agile factories may be handed out to other apartments */
+    if (factory && SUCCEEDED(IActivationFactory_QueryInterface(factory, &IID_IAgileObject, (void **)&agile)))
+    {
+        IAgileObject_Release(agile);
+        IActivationFactory_AddRef(factory);
+        factory_entry->factory = factory;
+    }
+
+    AcquireSRWLockExclusive(&activation_factory_cache_lock);
+    if (generation != activation_factory_cache_generation)
+    {
+        ReleaseSRWLockExclusive(&activation_factory_cache_lock);
+        activation_factory_entry_destroy(&factory_entry->entry, (void *)TRUE);
+        return;
+    }
+    if ((entry = rb_get(&activation_factory_cache, classid)))
+    {
+        rb_remove(&activation_factory_cache, entry);
+        activation_factory_entry_destroy(entry, (void *)TRUE);
+    }
+    rb_put(&activation_factory_cache, classid, &factory_entry->entry);
+    ReleaseSRWLockExclusive(&activation_factory_cache_lock);
+}
+
+void activation_factory_cache_cleanup(void)
+{
+    activation_factory_cache_trace("cleanup");
+
+    if (activation_factory_cache_wait)
+    {
+        SetThreadpoolWait(activation_factory_cache_wait, NULL, NULL);
+        WaitForThreadpoolWaitCallbacks(activation_factory_cache_wait, TRUE);
+        CloseThreadpoolWait(activation_factory_cache_wait);
+        CloseHandle(activation_factory_cache_event);
+        RegCloseKey(activation_factory_cache_key);
+    }
+
+    /* the modules owning the factories may already be gone */
+    rb_destroy(&activation_factory_cache, activation_factory_entry_destroy, NULL);
+}
+
+static HRESULT get_activation_factory(HSTRING classid, IActivationFactory **factory)
+{
+    const WCHAR *name = WindowsGetStringRawBuffer(classid, NULL);
+    PFNGETACTIVATIONFACTORY get_factory = NULL;
+    struct activation_factory_entry *entry;
+    ACTCTX_SECTION_KEYED_DATA data;
+    WCHAR *library;
+    HMODULE module;
+    HRESULT hr = S_OK;
+    LONG generation;
+
+    InitOnceExecuteOnce(&activation_factory_cache_once, activation_factory_cache_init, NULL, NULL);
+
+    /* activation contexts are resolved in process, the cache only saves the rest */
+    data.cbSize = sizeof(data);
+    if (!FindActCtxSectionStringW(FIND_ACTCTX_SECTION_KEY_RETURN_HACTCTX, NULL,
+            ACTIVATION_CONTEXT_SECTION_WINRT_ACTIVATABLE_CLASSES, name, &data))
+        data.hActCtx = NULL;
+
+    *factory = NULL;
+    AcquireSRWLockShared(&activation_factory_cache_lock);
+    generation = activation_factory_cache_generation;
+    if ((entry = activation_factory_cache_get(name, data.hActCtx)))
+    {
+        if (FAILED(hr = entry->hr)) InterlockedIncrement(&activation_factory_cache_stats.negative_hits);
+        else if ((*factory = entry->factory))
+        {
+            IActivationFactory_AddRef(*factory);
+            InterlockedIncrement(&activation_factory_cache_stats.hits);
+        }
+        else
+        {
+            get_factory = entry->get_factory;
+            InterlockedIncrement(&activation_factory_cache_stats.module_hits);
+        }
+    }
+    ReleaseSRWLockShared(&activation_factory_cache_lock);
+
+    if (entry)
+    {
+        if (data.hActCtx) ReleaseActCtx(data.hActCtx);
+        if (FAILED(hr) || *factory) return hr;
+        return get_factory(classid, factory);
+    }
+
+    InterlockedIncrement(&activation_factory_cache_stats.misses);
+
+    hr = get_library_for_classid(name, &data, &library);
+    if (FAILED(hr))
+    {
+        ERR("Failed to find library for %s\n", debugstr_hstring(classid));
+        if (hr == REGDB_E_CLASSNOTREG) activation_factory_cache_put(name, data.hActCtx, generation, hr, NULL, NULL);
+        goto done;
+    }
+
+    if (!(module = LoadLibraryW(library)))
+    {
+        ERR("Failed to load module %s\n", debugstr_w(library));
+        hr = HRESULT_FROM_WIN32(GetLastError());
+        free(library);
+        goto done;
+    }
+
+    if (!(get_factory = (void *)GetProcAddress(module, "DllGetActivationFactory")))
+    {
+        ERR("Module %s does not implement DllGetActivationFactory\n", debugstr_w(library));
+        FreeLibrary(module);
+        free(library);
+        hr = E_FAIL;
+        goto done;
+    }
+
+    TRACE("Found library %s for class %s\n", debugstr_w(library), debugstr_hstring(classid));
+    free(library);
+
+    /* the module stays loaded once it handed out a factory */
+    if (SUCCEEDED(hr = get_factory(classid, factory)))
+        activation_factory_cache_put(name, data.hActCtx, generation, hr, get_factory, *factory);
+    else
+        FreeLibrary(module);
+
+done:
+    if (data.hActCtx) ReleaseActCtx(data.hActCtx);
+    return hr;
+}
+
+
 /***********************************************************************
  *      RoInitialize (combase.@)
  */
@@ -145,13 +403,10 @@ void WINAPI RoUninitialize(void)
  */
 HRESULT WINAPI DECLSPEC_HOTPATCH RoGetActivationFactory(HSTRING classid, REFIID iid, void **class_factory)
 {
-    PFNGETACTIVATIONFACTORY pDllGetActivationFactory;
     IActivationFactory *factory;
-    WCHAR *library;
-    HMODULE module;
     HRESULT hr;
 
-    FIXME("(%s, %s, %p): semi-stub\n", debugstr_hstring(classid), debugstr_guid(iid), class_factory);
+    TRACE("(%s, %s, %p)\n", debugstr_hstring(classid), debugstr_guid(iid), class_factory);
 
     if (!iid || !class_factory)
         return E_INVALIDARG;
@@ -159,44 +414,12 @@ HRESULT WINAPI DECLSPEC_HOTPATCH RoGetActivationFactory(HSTRING classid, REFIID
     if (FAILED(hr = ensure_mta()))
         return hr;
 
-    hr = get_library_for_classid(WindowsGetStringRawBuffer(classid, NULL), &library);
-    if (FAILED(hr))
-    {
-        ERR("Failed to find library for %s\n", debugstr_hstring(classid));
+    if (FAILED(hr = get_activation_factory(classid, &factory)))
         return hr;
-    }
-
-    if (!(module = LoadLibraryW(library)))
-    {
-        ERR("Failed to load module %s\n", debugstr_w(library));
-        hr = HRESULT_FROM_WIN32(GetLastError());
-        goto done;
-    }
 
-    if (!(pDllGetActivationFactory = (void *)GetProcAddress(module, "DllGetActivationFactory")))
-    {
-        ERR("Module %s does not implement DllGetActivationFactory\n", debugstr_w(library));
-        hr = E_FAIL;
-        goto done;
-    }
-
-    TRACE("Found library %s for class %s\n", debugstr_w(library), debugstr_hstring(classid));
-
-    hr = pDllGetActivationFactory(classid, &factory);
-    if (SUCCEEDED(hr))
-    {
-        hr = IActivationFactory_QueryInterface(factory, iid, class_factory);
-        if (SUCCEEDED(hr))
-        {
-            TRACE("Created interface %p\n", *class_factory);
-            module = NULL;
-        }
-        IActivationFactory_Release(factory);
-    }
-
-done:
-    free(library);
-    if (module) FreeLibrary(module);
+    hr = IActivationFactory_QueryInterface(factory, iid, class_factory);
+    if (SUCCEEDED(hr)) TRACE("Created interface %p\n", *class_factory);
+    IActivationFactory_Release(factory);
     return hr;
 }
 
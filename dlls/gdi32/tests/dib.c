@@ -3529,11 +3529,186 @@ static void test_simple_graphics(void)
     DeleteDC(mem_dc);
 }
 
+static const char *perf_op_names[] =
+{
+    "PatBlt PATCOPY", "PatBlt PATINVERT", "BitBlt SRCCOPY", "BitBlt SRCINVERT", "BitBlt convert",
+    "AlphaBlend per-pixel", "AlphaBlend constant", "StretchBlt x2"
+};
+
+static void do_perf_op( HDC dst_dc, HDC src_dc, HDC conv_dc, HDC argb_dc, int width, int height, int op )
+{
+    BLENDFUNCTION blend;
+
+    blend.BlendOp = AC_SRC_OVER;
+    blend.BlendFlags = 0;
+
+    switch (op)
+    {
+    case 0: PatBlt( dst_dc, 0, 0, width, height, PATCOPY ); break;
+    case 1: PatBlt( dst_dc, 0, 0, width, height, PATINVERT ); break;
+    case 2: BitBlt( dst_dc, 0, 0, width, height, src_dc, 0, 0, SRCCOPY ); break;
+    case 3: BitBlt( dst_dc, 0, 0, width, height, src_dc, 0, 0, SRCINVERT ); break;
+    case 4: BitBlt( dst_dc, 0, 0, width, height, conv_dc, 0, 0, SRCCOPY ); break;
+    case 5:
+        blend.SourceConstantAlpha = 255;
+        blend.AlphaFormat = AC_SRC_ALPHA;
+        GdiAlphaBlend( dst_dc, 0, 0, width, height, argb_dc, 0, 0, width, height, blend );
+        break;
+    case 6:
+        blend.SourceConstantAlpha = 0x80;
+        blend.AlphaFormat = 0;
+        GdiAlphaBlend( dst_dc, 0, 0, width, height, argb_dc, 0, 0, width, height, blend );
+        break;
+    case 7: StretchBlt( dst_dc, 0, 0, width, height, src_dc, 0, 0, width / 2, height / 2, SRCCOPY ); break;
+    }
+}
+
+static HDC create_perf_dc( int bpp, int width, int height, BYTE fill )
+{
+    char bmibuf[sizeof(BITMAPINFO) + 256 * sizeof(RGBQUAD)];
+    BITMAPINFO *bmi = (BITMAPINFO *)bmibuf;
+    HDC dc = CreateCompatibleDC( 0 );
+    HBITMAP dib;
+    BYTE *bits;
+    int i;
+
+    memset( bmi, 0, sizeof(bmibuf) );
+    bmi->bmiHeader.biSize = sizeof(bmi->bmiHeader);
+    bmi->bmiHeader.biWidth = width;
+    bmi->bmiHeader.biHeight = -height;
+    bmi->bmiHeader.biPlanes = 1;
+    bmi->bmiHeader.biBitCount = bpp;
+    bmi->bmiHeader.biCompression = BI_RGB;
+
+    dib = CreateDIBSection( 0, bmi, DIB_RGB_COLORS, (void **)&bits, NULL, 0 );
+    ok( dib != NULL, "ret NULL\n" );
+    for (i = 0; i < (width * bpp + 31) / 32 * 4 * height; i++) bits[i] = fill + i * 7;
+    SelectObject( dc, dib );
+    SelectObject( dc, CreateSolidBrush( RGB(0x12, 0x34, 0x56) ));
+    SetStretchBltMode( dc, COLORONCOLOR );
+    return dc;
+}
+
+static void delete_perf_dc( HDC dc )
+{
+    DeleteObject( SelectObject( dc, GetStockObject( DC_BRUSH )));
+    DeleteObject( GetCurrentObject( dc, OBJ_BITMAP ));
+    DeleteDC( dc );
+}
+
+static void test_performance(void)
+{
+    static const int bpps[] = { 32, 24, 16 };
+    const int width = 1024, height = 768;
+    LARGE_INTEGER freq, start, end;
+    HDC dst_dc, src_dc, conv_dc, argb_dc;
+    int i, op, count;
+    double secs;
+
+    if (!winetest_interactive)
+    {
+        skip( "DIB performance test, set WINETEST_INTERACTIVE to run it\n" );
+        return;
+    }
+
+    QueryPerformanceFrequency( &freq );
+    argb_dc = create_perf_dc( 32, width, height, 0x40 );
+
+    for (i = 0; i < ARRAY_SIZE(bpps); i++)
+    {
+        dst_dc = create_perf_dc( bpps[i], width, height, 0 );
+        src_dc = create_perf_dc( bpps[i], width, height, 0x80 );
+        conv_dc = create_perf_dc( bpps[i] == 32 ? 16 : 32, width, height, 0x20 );
+
+        for (op = 0; op < ARRAY_SIZE(perf_op_names); op++)
+        {
+            do_perf_op( dst_dc, src_dc, conv_dc, argb_dc, width, height, op );
+            QueryPerformanceCounter( &start );
+            count = 0;
+            do
+            {
+                do_perf_op( dst_dc, src_dc, conv_dc, argb_dc, width, height, op );
+                count++;
+                QueryPerformanceCounter( &end );
+                secs = (double)(end.QuadPart - start.QuadPart) / freq.QuadPart;
+            } while (secs < 0.5);
+
+            trace( "%2u bpp %-22s %8.1f Mpixels/s\n", bpps[i], perf_op_names[op],
+                   (double)count * width * height / secs / 1e6 );
+        }
+
+        delete_perf_dc( conv_dc );
+        delete_perf_dc( src_dc );
+        delete_perf_dc( dst_dc );
+    }
+
+    delete_perf_dc( argb_dc );
+}
+
+/* run test_simple_graphics again in a child process started with the given environment variable */
+static void run_graphics_child( const char *name, const char *value )
+{
+    char path_name[MAX_PATH + 32];
+    PROCESS_INFORMATION info;
+    STARTUPINFOA startup;
+    char **argv;
+
+    winetest_get_mainargs( &argv );
+    memset( &startup, 0, sizeof(startup) );
+    startup.cb = sizeof(startup);
+    sprintf( path_name, "%s dib graphics", argv[0] );
+
+    SetEnvironmentVariableA( name, value );
+    ok( CreateProcessA( NULL, path_name, NULL, NULL, FALSE, 0, NULL, NULL, &startup, &info ),
+        "CreateProcess failed, error %lu\n", GetLastError() );
+    SetEnvironmentVariableA( name, NULL );
+
+    wait_child_process( info.hProcess );
+    CloseHandle( info.hProcess );
+    CloseHandle( info.hThread );
+}
+
+/* Wine can render large operations in bands on several threads, run the same
+ * drawing again in a child process that has it enabled */
+static void test_banded_graphics(void)
+{
+    run_graphics_child( "WINEDIBTHREADS", "4" );
+}
+
+/* Wine picks SSE2 or AVX2 kernels for some primitives, run the same drawing
+ * with each level forced so that every kernel is checked against the C loops */
+static void test_simd_graphics(void)
+{
+    static const char *levels[] = { "0", "1", "2" };
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_SIZE(levels); i++)
+    {
+        winetest_push_context( "WINEDIBSIMD=%s", levels[i] );
+        run_graphics_child( "WINEDIBSIMD", levels[i] );
+        winetest_pop_context();
+    }
+}
+
 START_TEST(dib)
 {
+    char **argv;
+    int argc;
+
     CryptAcquireContextW(&crypt_prov, NULL, NULL, PROV_RSA_FULL, CRYPT_VERIFYCONTEXT);
 
+    argc = winetest_get_mainargs( &argv );
+    if (argc >= 3 && !strcmp( argv[2], "graphics" ))
+    {
+        test_simple_graphics();
+        CryptReleaseContext(crypt_prov, 0);
+        return;
+    }
+
     test_simple_graphics();
+    test_banded_graphics();
+    test_simd_graphics();
+    test_performance();
 
     CryptReleaseContext(crypt_prov, 0);
 }
@@ -6292,11 +6292,203 @@ static void test_eof(void)
     ok(ret, "failed to delete %s, error %lu\n", debugstr_a(filename), GetLastError());
 }
 
+static void test_overlapped_read_iops(void)
+{
+    static const unsigned int depths[] = { 1, 4, 32 };
+    const ULONGLONG file_size = 64 << 20;
+    const DWORD block_size = 4096, duration = 2000;
+    char temp_path[MAX_PATH], file_name[MAX_PATH];
+    OVERLAPPED ov[32], *pov;
+    unsigned int i, j, pending;
+    DWORD count, end, completed;
+    ULONG_PTR key;
+    HANDLE file, port;
+    BYTE *buffer;
+    BOOL ret;
+
+    if (!winetest_interactive)
+    {
+        skip( "overlapped read benchmark, set WINETEST_INTERACTIVE to run it\n" );
+        return;
+    }
+
+    GetTempPathA( MAX_PATH, temp_path );
+    GetTempFileNameA( temp_path, "iop", 0, file_name );
+    buffer = VirtualAlloc( NULL, ARRAY_SIZE(ov) * block_size, MEM_COMMIT, PAGE_READWRITE );
+
+    file = CreateFileA( file_name, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL );
+    ok( file != INVALID_HANDLE_VALUE, "failed to create file, error %lu\n", GetLastError() );
+    memset( buffer, 0x55, ARRAY_SIZE(ov) * block_size );
+    for (i = 0; i < file_size / (ARRAY_SIZE(ov) * block_size); i++)
+        WriteFile( file, buffer, ARRAY_SIZE(ov) * block_size, &count, NULL );
+    CloseHandle( file );
+
+    file = CreateFileA( file_name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                        FILE_FLAG_OVERLAPPED | FILE_FLAG_NO_BUFFERING | FILE_FLAG_RANDOM_ACCESS, NULL );
+    ok( file != INVALID_HANDLE_VALUE, "failed to open file, error %lu\n", GetLastError() );
+    port = CreateIoCompletionPort( file, NULL, 1, 0 );
+    ok( port != NULL, "failed to create port, error %lu\n", GetLastError() );
+
+    /* random 4 KiB reads, keeping a fixed number of them in flight */
+    for (i = 0; i < ARRAY_SIZE(depths); i++)
+    {
+        completed = pending = 0;
+        end = GetTickCount() + duration;
+        for (j = 0; j < depths[i]; j++)
+        {
+            ULONGLONG offset = (ULONGLONG)(rand() % (file_size / block_size)) * block_size;
+
+            memset( &ov[j], 0, sizeof(ov[j]) );
+            ov[j].Offset = offset;
+            ov[j].OffsetHigh = offset >> 32;
+            ret = ReadFile( file, buffer + j * block_size, block_size, NULL, &ov[j] );
+            ok( ret || GetLastError() == ERROR_IO_PENDING, "ReadFile failed, error %lu\n", GetLastError() );
+            pending++;
+        }
+        while (pending)
+        {
+            if (!GetQueuedCompletionStatus( port, &count, &key, &pov, 5000 )) break;
+            ok( count == block_size, "got %lu bytes\n", count );
+            pending--;
+            completed++;
+            if ((LONG)(end - GetTickCount()) > 0)
+            {
+                ULONGLONG offset = (ULONGLONG)(rand() % (file_size / block_size)) * block_size;
+
+                j = pov - ov;
+                memset( pov, 0, sizeof(*pov) );
+                pov->Offset = offset;
+                pov->OffsetHigh = offset >> 32;
+                ret = ReadFile( file, buffer + j * block_size, block_size, NULL, pov );
+                ok( ret || GetLastError() == ERROR_IO_PENDING, "ReadFile failed, error %lu\n", GetLastError() );
+                pending++;
+            }
+        }
+        ok( !pending, "%u reads still pending\n", pending );
+        trace( "queue depth %2u: %.0f IOPS\n", depths[i], completed * 1000.0 / duration );
+    }
+
+    CloseHandle( port );
+    CloseHandle( file );
+    DeleteFileA( file_name );
+    VirtualFree( buffer, 0, MEM_RELEASE );
+}
+
+/* runs in a child process started with WINEIOURING=1, so that Wine submits the reads to its io_uring */
+static void test_overlapped_read_ring(void)
+{
+    const DWORD block_size = 4096;
+    char temp_path[MAX_PATH], file_name[MAX_PATH];
+    unsigned int i, pending = 0, seen = 0;
+    HANDLE file, port, events[8];
+    OVERLAPPED ov[8], *pov;
+    DWORD count, ret;
+    ULONG_PTR key;
+    BYTE *buffer;
+
+    GetTempPathA( MAX_PATH, temp_path );
+    GetTempFileNameA( temp_path, "rng", 0, file_name );
+    buffer = VirtualAlloc( NULL, ARRAY_SIZE(ov) * block_size, MEM_COMMIT, PAGE_READWRITE );
+
+    file = CreateFileA( file_name, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL );
+    ok( file != INVALID_HANDLE_VALUE, "failed to create file, error %lu\n", GetLastError() );
+    for (i = 0; i < ARRAY_SIZE(ov); i++) memset( buffer + i * block_size, i + 1, block_size );
+    ret = WriteFile( file, buffer, ARRAY_SIZE(ov) * block_size, &count, NULL );
+    ok( ret && count == ARRAY_SIZE(ov) * block_size, "WriteFile failed, error %lu\n", GetLastError() );
+    CloseHandle( file );
+
+    file = CreateFileA( file_name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                        FILE_FLAG_OVERLAPPED | FILE_FLAG_NO_BUFFERING, NULL );
+    ok( file != INVALID_HANDLE_VALUE, "failed to open file, error %lu\n", GetLastError() );
+    port = CreateIoCompletionPort( file, NULL, 0xc0de, 0 );
+    ok( port != NULL, "failed to create port, error %lu\n", GetLastError() );
+
+    memset( buffer, 0, ARRAY_SIZE(ov) * block_size );
+    for (i = 0; i < ARRAY_SIZE(ov); i++)
+    {
+        events[i] = CreateEventA( NULL, TRUE, FALSE, NULL );
+        memset( &ov[i], 0, sizeof(ov[i]) );
+        ov[i].Offset = i * block_size;
+        ov[i].hEvent = events[i];
+        ret = ReadFile( file, buffer + i * block_size, block_size, NULL, &ov[i] );
+        ok( ret || GetLastError() == ERROR_IO_PENDING, "%u: ReadFile failed, error %lu\n", i, GetLastError() );
+        if (!ret) pending++;
+        /* the completion doesn't depend on the caller keeping its event handle */
+        if (i % 2)
+        {
+            CloseHandle( events[i] );
+            events[i] = NULL;
+        }
+    }
+
+    for (i = 0; i < ARRAY_SIZE(ov); i += 2)
+    {
+        ret = WaitForSingleObject( events[i], 5000 );
+        ok( !ret, "%u: wait failed, ret %lu\n", i, ret );
+        ret = GetOverlappedResult( file, &ov[i], &count, FALSE );
+        ok( ret && count == block_size, "%u: GetOverlappedResult returned %lu, count %lu, error %lu\n",
+            i, ret, count, GetLastError() );
+        CloseHandle( events[i] );
+    }
+
+    for (i = 0; i < ARRAY_SIZE(ov); i++)
+    {
+        pov = NULL;
+        ret = GetQueuedCompletionStatus( port, &count, &key, &pov, 5000 );
+        ok( ret, "%u: GetQueuedCompletionStatus failed, error %lu\n", i, GetLastError() );
+        if (!ret) break;
+        ok( key == 0xc0de, "got key %#Ix\n", key );
+        ok( count == block_size, "got %lu bytes\n", count );
+        ok( pov >= ov && pov < ov + ARRAY_SIZE(ov), "got overlapped %p\n", pov );
+        seen |= 1 << (pov - ov);
+    }
+    ok( seen == (1 << ARRAY_SIZE(ov)) - 1, "got completions %#x\n", seen );
+    ret = GetQueuedCompletionStatus( port, &count, &key, &pov, 0 );
+    ok( !ret && GetLastError() == WAIT_TIMEOUT, "got an extra completion, error %lu\n", GetLastError() );
+
+    for (i = 0; i < ARRAY_SIZE(ov) * block_size; i++)
+        if (buffer[i] != i / block_size + 1) break;
+    ok( i == ARRAY_SIZE(ov) * block_size, "wrong data at offset %#x\n", i );
+
+    if (!strcmp( winetest_platform, "wine" ) && !pending)
+        skip( "io_uring is not available, the reads completed synchronously\n" );
+
+    CloseHandle( port );
+    CloseHandle( file );
+    DeleteFileA( file_name );
+    VirtualFree( buffer, 0, MEM_RELEASE );
+}
+
+static void test_overlapped_read_ring_process(void)
+{
+    char cmdline[MAX_PATH + 32], **argv;
+    PROCESS_INFORMATION pi;
+    STARTUPINFOA si = { sizeof(si) };
+    BOOL ret;
+
+    winetest_get_mainargs( &argv );
+    sprintf( cmdline, "\"%s\" file ring", argv[0] );
+    SetEnvironmentVariableA( "WINEIOURING", "1" );
+    ret = CreateProcessA( NULL, cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi );
+    SetEnvironmentVariableA( "WINEIOURING", NULL );
+    ok( ret, "CreateProcess failed, error %lu\n", GetLastError() );
+    if (!ret) return;
+    wait_child_process( pi.hProcess );
+    CloseHandle( pi.hThread );
+    CloseHandle( pi.hProcess );
+}
+
 START_TEST(file)
 {
-    char temp_path[MAX_PATH];
+    char temp_path[MAX_PATH], **argv;
     DWORD ret;
 
+    if (winetest_get_mainargs( &argv ) >= 3 && !strcmp( argv[2], "ring" ))
+    {
+        test_overlapped_read_ring();
+        return;
+    }
+
     InitFunctionPointers();
 
     ret = GetTempPathA(MAX_PATH, temp_path);
@@ -6363,6 +6555,8 @@ START_TEST(file)
     test_GetFileAttributesExW();
     test_post_completion();
     test_overlapped_read();
+    test_overlapped_read_ring_process();
+    test_overlapped_read_iops();
     test_file_readonly_access();
     test_find_file_stream();
     test_SetFileTime();
@@ -54,6 +54,7 @@ static NTSTATUS (WINAPI *pNtProtectVirtualMemory)(HANDLE, PVOID *, SIZE_T *, ULO
 static NTSTATUS (WINAPI *pNtReadVirtualMemory)(HANDLE,const void *,void *,SIZE_T, SIZE_T *);
 static NTSTATUS (WINAPI *pNtWriteVirtualMemory)(HANDLE, void *, const void *, SIZE_T, SIZE_T *);
 static BOOL  (WINAPI *pPrefetchVirtualMemory)(HANDLE, ULONG_PTR, PWIN32_MEMORY_RANGE_ENTRY, ULONG);
+static SIZE_T (WINAPI *pGetLargePageMinimum)(void);
 
 /* ############################### */
 
@@ -4366,6 +4367,91 @@ static void test_PrefetchVirtualMemory(void)
         "PrefetchVirtualMemory unexpected status on 2 page-aligned entries: %ld\n", GetLastError() );
 }
 
+static void test_large_pages(void)
+{
+    MEMORY_BASIC_INFORMATION info;
+    TOKEN_PRIVILEGES privs;
+    SIZE_T size, ret_size;
+    HANDLE token;
+    void *ptr;
+    BOOL ret;
+
+    if (!pGetLargePageMinimum)
+    {
+        win_skip("GetLargePageMinimum is not available\n");
+        return;
+    }
+
+    size = pGetLargePageMinimum();
+    if (!size)
+    {
+        skip("large pages are not supported\n");
+        return;
+    }
+    ok(!(size & (size - 1)), "large page size %#Ix is not a power of two\n", size);
+    ok(size >= si.dwAllocationGranularity, "large page size %#Ix is smaller than the granularity\n", size);
+
+    SetLastError(0xdeadbeef);
+    ptr = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+    ok(!ptr, "VirtualAlloc succeeded without SeLockMemoryPrivilege\n");
+    ok(GetLastError() == ERROR_PRIVILEGE_NOT_HELD, "got %lu\n", GetLastError());
+    if (ptr) VirtualFree(ptr, 0, MEM_RELEASE);
+
+    privs.PrivilegeCount = 1;
+    privs.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES, &token) ||
+        !LookupPrivilegeValueA(NULL, SE_LOCK_MEMORY_NAME, &privs.Privileges[0].Luid) ||
+        !AdjustTokenPrivileges(token, FALSE, &privs, sizeof(privs), NULL, NULL) ||
+        GetLastError() == ERROR_NOT_ALL_ASSIGNED)
+    {
+        skip("cannot enable SE_LOCK_MEMORY_NAME privilege\n");
+        CloseHandle(token);
+        return;
+    }
+
+    SetLastError(0xdeadbeef);
+    ptr = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE);
+    ok(!ptr, "VirtualAlloc succeeded without MEM_COMMIT\n");
+    ok(GetLastError() == ERROR_INVALID_PARAMETER, "got %lu\n", GetLastError());
+
+    SetLastError(0xdeadbeef);
+    ptr = VirtualAlloc(NULL, size / 2, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+    ok(!ptr, "VirtualAlloc succeeded for half a large page\n");
+    ok(GetLastError() == ERROR_INVALID_PARAMETER, "got %lu\n", GetLastError());
+
+    SetLastError(0xdeadbeef);
+    ptr = VirtualAlloc(NULL, 2 * size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+    if (!ptr)
+    {
+        /* physical memory may be too fragmented on Windows */
+        ok(GetLastError() == ERROR_NO_SYSTEM_RESOURCES, "got %lu\n", GetLastError());
+        skip("no large pages available\n");
+    }
+    else
+    {
+        ok(!((ULONG_PTR)ptr & (size - 1)), "%p is not aligned to a large page\n", ptr);
+        memset(ptr, 0x55, 2 * size);
+
+        ret_size = VirtualQuery((char *)ptr + size, &info, sizeof(info));
+        ok(ret_size == sizeof(info), "VirtualQuery returned %Iu\n", ret_size);
+        ok(info.BaseAddress == ptr, "got BaseAddress %p, expected %p\n", info.BaseAddress, ptr);
+        ok(info.AllocationBase == ptr, "got AllocationBase %p, expected %p\n", info.AllocationBase, ptr);
+        ok(info.AllocationProtect == PAGE_READWRITE, "got AllocationProtect %#lx\n", info.AllocationProtect);
+        ok(info.RegionSize == 2 * size, "got RegionSize %#Ix, expected %#Ix\n", info.RegionSize, 2 * size);
+        ok(info.State == MEM_COMMIT, "got State %#lx\n", info.State);
+        ok(info.Protect == PAGE_READWRITE, "got Protect %#lx\n", info.Protect);
+        ok(info.Type == MEM_PRIVATE, "got Type %#lx\n", info.Type);
+
+        ret = VirtualFree(ptr, 0, MEM_RELEASE);
+        ok(ret, "VirtualFree failed %lu\n", GetLastError());
+    }
+
+    privs.Privileges[0].Attributes = 0;
+    AdjustTokenPrivileges(token, FALSE, &privs, sizeof(privs), NULL, NULL);
+    CloseHandle(token);
+}
+
 static void test_ReadProcessMemory(void)
 {
     BYTE *buf;
@@ -4465,6 +4551,7 @@ START_TEST(virtual)
     pNtReadVirtualMemory = (void *)GetProcAddress( hntdll, "NtReadVirtualMemory" );
     pNtWriteVirtualMemory = (void *)GetProcAddress( hntdll, "NtWriteVirtualMemory" );
     pPrefetchVirtualMemory = (void *)GetProcAddress( hkernelbase, "PrefetchVirtualMemory" );
+    pGetLargePageMinimum = (void *)GetProcAddress( hkernel32, "GetLargePageMinimum" );
 
     GetSystemInfo(&si);
     trace("system page size %#lx\n", si.dwPageSize);
@@ -4481,6 +4568,7 @@ START_TEST(virtual)
     test_VirtualProtect();
     test_VirtualAllocEx();
     test_VirtualAlloc();
+    test_large_pages();
     test_MapViewOfFile();
     test_NtAreMappedFilesTheSame();
     test_CreateFileMapping();
@@ -143,7 +143,7 @@ BOOL WINAPI DECLSPEC_HOTPATCH FlushInstructionCache( HANDLE process, LPCVOID add
  */
 SIZE_T WINAPI GetLargePageMinimum(void)
 {
-    return 2 * 1024 * 1024;
+    return ((const struct _KUSER_SHARED_DATA *)0x7ffe0000)->LargePageMinimum;
 }
 
 
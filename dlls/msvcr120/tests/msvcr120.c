@@ -190,6 +190,32 @@ typedef struct {
     long *cancelling;
 } _Cancellation_beacon;
 
+typedef enum {
+    SchedulerKind,
+    MaxConcurrency,
+    MinConcurrency
+} PolicyElementKey;
+
+typedef struct {
+    void *policy_container;
+} SchedulerPolicy;
+
+struct SchedulerVtbl;
+typedef struct {
+    struct SchedulerVtbl *vtable;
+} Scheduler;
+
+struct SchedulerVtbl {
+    Scheduler* (__thiscall *vector_dor)(Scheduler*);
+    unsigned int (__thiscall *Id)(Scheduler*);
+    unsigned int (__thiscall *GetNumberOfVirtualProcessors)(Scheduler*);
+    SchedulerPolicy* (__thiscall *GetPolicy)(Scheduler*);
+    unsigned int (__thiscall *Reference)(Scheduler*);
+    unsigned int (__thiscall *Release)(Scheduler*);
+    void (__thiscall *RegisterShutdownEvent)(Scheduler*,HANDLE);
+    void (__thiscall *Attach)(Scheduler*);
+};
+
 static char* (CDECL *p_setlocale)(int category, const char* locale);
 static struct MSVCRT_lconv* (CDECL *p_localeconv)(void);
 static size_t (CDECL *p_wcstombs_s)(size_t *ret, char* dest, size_t sz, const wchar_t* src, size_t max);
@@ -264,6 +290,8 @@ static void (__thiscall *p__Condition_variable_notify_all)(_Condition_variable*)
 static Context* (__cdecl *p_Context_CurrentContext)(void);
 static _Context* (__cdecl *p__Context__CurrentContext)(_Context*);
 static MSVCRT_bool (__cdecl *p_Context_IsCurrentTaskCollectionCanceling)(void);
+static void (__cdecl *p_Context_Block)(void);
+static unsigned int (__cdecl *p_Context_VirtualProcessorId)(void);
 
 static _StructuredTaskCollection* (__thiscall *p__StructuredTaskCollection_ctor)(_StructuredTaskCollection*, void*);
 static void (__thiscall *p__StructuredTaskCollection_dtor)(_StructuredTaskCollection*);
@@ -272,6 +300,12 @@ static int (__stdcall *p__StructuredTaskCollection__RunAndWait)(_StructuredTaskC
 static void (__thiscall *p__StructuredTaskCollection__Cancel)(_StructuredTaskCollection*);
 static MSVCRT_bool (__thiscall *p__StructuredTaskCollection__IsCanceling)(_StructuredTaskCollection*);
 
+static SchedulerPolicy* (WINAPIV *p_SchedulerPolicy_ctor_policies)(SchedulerPolicy*, size_t, ...);
+static void (__thiscall *p_SchedulerPolicy_dtor)(SchedulerPolicy*);
+static Scheduler* (__cdecl *p_Scheduler_Create)(SchedulerPolicy*);
+static void (__cdecl *p_CurrentScheduler_Detach)(void);
+static void (__cdecl *p_CurrentScheduler_ScheduleTask)(void (__cdecl*)(void*), void*);
+
 static _Cancellation_beacon* (__thiscall *p__Cancellation_beacon_ctor)(_Cancellation_beacon*);
 static void (__thiscall *p__Cancellation_beacon_dtor)(_Cancellation_beacon*);
 static MSVCRT_bool (__thiscall *p__Cancellation_beacon__Confirm_cancel)(_Cancellation_beacon*);
@@ -342,7 +376,18 @@ static BOOL init(void)
     SET(p_strcmp, "strcmp");
     SET(p_strncmp, "strncmp");
     SET(p_Context_IsCurrentTaskCollectionCanceling, "?IsCurrentTaskCollectionCanceling@Context@Concurrency@@SA_NXZ");
+    SET(p_CurrentScheduler_Detach, "?Detach@CurrentScheduler@Concurrency@@SAXXZ");
+    SET(p_Context_Block, "?Block@Context@Concurrency@@SAXXZ");
+    SET(p_Context_VirtualProcessorId, "?VirtualProcessorId@Context@Concurrency@@SAIXZ");
     if(sizeof(void*) == 8) { /* 64-bit initialization */
+        SET(p_SchedulerPolicy_ctor_policies,
+                "??0SchedulerPolicy@Concurrency@@QEAA@_KZZ");
+        SET(p_SchedulerPolicy_dtor,
+                "??1SchedulerPolicy@Concurrency@@QEAA@XZ");
+        SET(p_Scheduler_Create,
+                "?Create@Scheduler@Concurrency@@SAPEAV12@AEBVSchedulerPolicy@2@@Z");
+        SET(p_CurrentScheduler_ScheduleTask,
+                "?ScheduleTask@CurrentScheduler@Concurrency@@SAXP6AXPEAX@Z0@Z");
         SET(p__StructuredTaskCollection_ctor,
                 "??0_StructuredTaskCollection@details@Concurrency@@QEAA@PEAV_CancellationTokenState@12@@Z");
         SET(p__StructuredTaskCollection_dtor,
@@ -394,7 +439,15 @@ static BOOL init(void)
         SET(p__Cancellation_beacon__Confirm_cancel,
                 "?_Confirm_cancel@_Cancellation_beacon@details@Concurrency@@QEAA_NXZ");
     } else {
+        SET(p_SchedulerPolicy_ctor_policies,
+                "??0SchedulerPolicy@Concurrency@@QAA@IZZ");
+        SET(p_Scheduler_Create,
+                "?Create@Scheduler@Concurrency@@SAPAV12@ABVSchedulerPolicy@2@@Z");
+        SET(p_CurrentScheduler_ScheduleTask,
+                "?ScheduleTask@CurrentScheduler@Concurrency@@SAXP6AXPAX@Z0@Z");
 #ifdef __arm__
+        SET(p_SchedulerPolicy_dtor,
+                "??1SchedulerPolicy@Concurrency@@QAA@XZ");
         SET(p__StructuredTaskCollection_ctor,
                 "??0_StructuredTaskCollection@details@Concurrency@@QAA@PAV_CancellationTokenState@12@@Z");
         SET(p__StructuredTaskCollection_dtor,
@@ -444,6 +497,8 @@ static BOOL init(void)
         SET(p__Cancellation_beacon__Confirm_cancel,
                 "?_Confirm_cancel@_Cancellation_beacon@details@Concurrency@@QAA_NXZ");
 #else
+        SET(p_SchedulerPolicy_dtor,
+                "??1SchedulerPolicy@Concurrency@@QAE@XZ");
         SET(p__StructuredTaskCollection_ctor,
                 "??0_StructuredTaskCollection@details@Concurrency@@QAE@PAV_CancellationTokenState@12@@Z");
         SET(p__StructuredTaskCollection_dtor,
@@ -1737,6 +1792,230 @@ static void test_StructuredTaskCollection(void)
     CloseHandle(chore_evt2);
 }
 
+struct scheduler_task
+{
+    HANDLE started;
+    HANDLE done;
+    Context *context;
+    unsigned int vproc_id;
+    BOOL block;
+};
+
+static void __cdecl scheduler_task_proc(void *data)
+{
+    struct scheduler_task *task = data;
+
+    task->context = p_Context_CurrentContext();
+    task->vproc_id = p_Context_VirtualProcessorId();
+    SetEvent(task->started);
+    if (task->block)
+        p_Context_Block();
+    SetEvent(task->done);
+}
+
+static void context_unblock(Context *ctx)
+{
+    void (__thiscall *unblock)(Context*) = (void*)ctx->vtable[3];
+    call_func1(unblock, ctx);
+}
+
+static void scheduler_task_init(struct scheduler_task *task, BOOL block)
+{
+    task->started = CreateEventW(NULL, TRUE, FALSE, NULL);
+    task->done = CreateEventW(NULL, TRUE, FALSE, NULL);
+    task->context = NULL;
+    task->vproc_id = -1;
+    task->block = block;
+}
+
+static void scheduler_task_cleanup(struct scheduler_task *task)
+{
+    CloseHandle(task->started);
+    CloseHandle(task->done);
+}
+
+static Scheduler *create_scheduler(SchedulerPolicy *policy, unsigned int min, unsigned int max)
+{
+    Scheduler *scheduler;
+
+    p_SchedulerPolicy_ctor_policies(policy, 2, MinConcurrency, min, MaxConcurrency, max);
+    scheduler = p_Scheduler_Create(policy);
+    call_func1(scheduler->vtable->Attach, scheduler);
+    return scheduler;
+}
+
+static void destroy_scheduler(Scheduler *scheduler, SchedulerPolicy *policy)
+{
+    p_CurrentScheduler_Detach();
+    call_func1(scheduler->vtable->Release, scheduler);
+    call_func1(p_SchedulerPolicy_dtor, policy);
+}
+
+static void test_scheduler_virtual_processors(void)
+{
+    struct scheduler_task tasks[4];
+    SchedulerPolicy policy;
+    Scheduler *scheduler;
+    unsigned int i, count;
+    DWORD ret;
+
+    for (count = 1; count <= 3; count++)
+    {
+        scheduler = create_scheduler(&policy, count, count);
+        i = call_func1(scheduler->vtable->GetNumberOfVirtualProcessors, scheduler);
+        ok(i == count, "GetNumberOfVirtualProcessors returned %u, expected %u\n", i, count);
+
+        scheduler_task_init(&tasks[0], FALSE);
+        p_CurrentScheduler_ScheduleTask(scheduler_task_proc, &tasks[0]);
+        ret = WaitForSingleObject(tasks[0].done, 5000);
+        ok(ret == WAIT_OBJECT_0, "WaitForSingleObject returned %ld\n", ret);
+        ok(tasks[0].context != NULL && tasks[0].context != p_Context_CurrentContext(),
+                "task ran on context %p\n", tasks[0].context);
+        ok(tasks[0].vproc_id < count, "VirtualProcessorId returned %u in a task, expected less than %u\n",
+                tasks[0].vproc_id, count);
+        scheduler_task_cleanup(&tasks[0]);
+
+        destroy_scheduler(scheduler, &policy);
+    }
+
+    /* a blocked task gives its virtual processor to the queued ones */
+    scheduler = create_scheduler(&policy, 1, 1);
+    scheduler_task_init(&tasks[0], TRUE);
+    p_CurrentScheduler_ScheduleTask(scheduler_task_proc, &tasks[0]);
+    ret = WaitForSingleObject(tasks[0].started, 5000);
+    ok(ret == WAIT_OBJECT_0, "WaitForSingleObject returned %ld\n", ret);
+    if (ret != WAIT_OBJECT_0)
+    {
+        /* there is no context to unblock, the task may still start later so its events stay open */
+        destroy_scheduler(scheduler, &policy);
+        return;
+    }
+
+    for (i = 1; i < ARRAY_SIZE(tasks); i++)
+    {
+        scheduler_task_init(&tasks[i], FALSE);
+        p_CurrentScheduler_ScheduleTask(scheduler_task_proc, &tasks[i]);
+    }
+    for (i = 1; i < ARRAY_SIZE(tasks); i++)
+    {
+        ret = WaitForSingleObject(tasks[i].done, 5000);
+        ok(ret == WAIT_OBJECT_0, "task %u: WaitForSingleObject returned %ld\n", i, ret);
+        ok(tasks[i].vproc_id == 0, "task %u: VirtualProcessorId returned %u\n", i, tasks[i].vproc_id);
+    }
+    ret = WaitForSingleObject(tasks[0].done, 0);
+    ok(ret == WAIT_TIMEOUT, "blocked task finished, WaitForSingleObject returned %ld\n", ret);
+
+    context_unblock(tasks[0].context);
+    ret = WaitForSingleObject(tasks[0].done, 5000);
+    ok(ret == WAIT_OBJECT_0, "WaitForSingleObject returned %ld\n", ret);
+
+    for (i = 0; i < ARRAY_SIZE(tasks); i++)
+        scheduler_task_cleanup(&tasks[i]);
+    destroy_scheduler(scheduler, &policy);
+}
+
+#define PARALLEL_FOR_GRAIN 16
+
+struct parallel_for_chore
+{
+    _UnrealizedChore chore;
+    LONG first;
+    LONG last;
+};
+
+static unsigned int parallel_for_results[8192];
+
+static void parallel_for_range(LONG first, LONG last);
+
+static void __cdecl parallel_for_proc(_UnrealizedChore *_this)
+{
+    struct parallel_for_chore *chore = CONTAINING_RECORD(_this, struct parallel_for_chore, chore);
+    parallel_for_range(chore->first, chore->last);
+}
+
+/* splits the range the way parallel_for does on top of structured_task_group */
+static void parallel_for_range(LONG first, LONG last)
+{
+    _StructuredTaskCollection task_coll;
+    struct parallel_for_chore chore;
+    unsigned int i, x;
+
+    if (last - first <= PARALLEL_FOR_GRAIN)
+    {
+        for (; first < last; first++)
+        {
+            for (i = 0, x = first; i < 2048; i++)
+                x = x * 1103515245 + 12345;
+            parallel_for_results[first] = x;
+        }
+        return;
+    }
+
+    call_func2(p__StructuredTaskCollection_ctor, &task_coll, NULL);
+    _UnrealizedChore_ctor(&chore.chore, parallel_for_proc);
+    chore.first = first + (last - first) / 2;
+    chore.last = last;
+    call_func2(p__StructuredTaskCollection__Schedule, &task_coll, &chore.chore);
+    parallel_for_range(first, chore.first);
+    p__StructuredTaskCollection__RunAndWait(&task_coll, NULL);
+    call_func1(p__StructuredTaskCollection_dtor, &task_coll);
+}
+
+static void test_parallel_for_scaling(void)
+{
+    unsigned int concurrency, i, x, j;
+    LARGE_INTEGER freq, start, end;
+    double elapsed, base = 0;
+    SchedulerPolicy policy;
+    Scheduler *scheduler;
+    SYSTEM_INFO si;
+    int rep;
+
+    if (!winetest_interactive)
+    {
+        skip("parallel_for benchmark, set WINETEST_INTERACTIVE to run it\n");
+        return;
+    }
+
+    GetSystemInfo(&si);
+    QueryPerformanceFrequency(&freq);
+
+    for (concurrency = 1;; concurrency = min(concurrency * 2, si.dwNumberOfProcessors))
+    {
+        p_SchedulerPolicy_ctor_policies(&policy, 2, MinConcurrency, concurrency, MaxConcurrency, concurrency);
+        scheduler = p_Scheduler_Create(&policy);
+        call_func1(scheduler->vtable->Attach, scheduler);
+        i = call_func1(scheduler->vtable->GetNumberOfVirtualProcessors, scheduler);
+        ok(i == concurrency, "GetNumberOfVirtualProcessors returned %u, expected %u\n", i, concurrency);
+
+        memset(parallel_for_results, 0, sizeof(parallel_for_results));
+        parallel_for_range(0, ARRAY_SIZE(parallel_for_results));
+        QueryPerformanceCounter(&start);
+        for (rep = 0; rep < 16; rep++)
+            parallel_for_range(0, ARRAY_SIZE(parallel_for_results));
+        QueryPerformanceCounter(&end);
+
+        p_CurrentScheduler_Detach();
+        call_func1(scheduler->vtable->Release, scheduler);
+        call_func1(p_SchedulerPolicy_dtor, &policy);
+
+        for (i = 0; i < ARRAY_SIZE(parallel_for_results); i++)
+        {
+            for (j = 0, x = i; j < 2048; j++)
+                x = x * 1103515245 + 12345;
+            if (parallel_for_results[i] != x) break;
+        }
+        ok(i == ARRAY_SIZE(parallel_for_results), "iteration %u was not run\n", i);
+
+        elapsed = (double)(end.QuadPart - start.QuadPart) / freq.QuadPart;
+        if (concurrency == 1) base = elapsed;
+        trace("parallel_for with %u virtual processors: %.2f ms, speedup %.2f\n",
+                concurrency, elapsed * 1000, base / elapsed);
+
+        if (concurrency == si.dwNumberOfProcessors) break;
+    }
+}
+
 static void test_strcmp(void)
 {
     int ret = p_strcmp( "abc", "abcd" );
@@ -1899,6 +2178,8 @@ START_TEST(msvcr120)
     test_towctrans();
     test_CurrentContext();
     test_StructuredTaskCollection();
+    test_scheduler_virtual_processors();
+    test_parallel_for_scaling();
     test_strcmp();
     test_gmtime64();
     test__fsopen();
@@ -113,6 +113,7 @@ typedef struct {
     struct _StructuredTaskCollection *task_collection;
     CRITICAL_SECTION beacons_cs;
     struct list beacons;
+    struct virtual_processor *vproc;
 } ExternalContextBase;
 extern const vtable_ptr ExternalContextBase_vtable;
 static void ExternalContextBase_ctor(ExternalContextBase*);
@@ -144,7 +145,26 @@ typedef struct Scheduler {
         void, (Scheduler*,void (__cdecl*)(void*),void*), (this,proc,data))
 #endif
 
-typedef struct {
+struct scheduled_task {
+    void (__cdecl *proc)(void*); /* NULL for _UnrealizedChore */
+    void *data;
+};
+
+/* Work-stealing deque of a virtual processor: the worker owning it pushes
+ * and pops tasks at the tail, other workers and waiting contexts steal
+ * from the head. */
+struct virtual_processor {
+    SRWLOCK lock;
+    struct scheduled_task *tasks;
+    unsigned int size;
+    volatile unsigned int head;
+    volatile unsigned int tail;
+    LONG owned;
+    unsigned int id;
+    struct ThreadScheduler *scheduler;
+};
+
+typedef struct ThreadScheduler {
     Scheduler scheduler;
     LONG ref;
     unsigned int id;
@@ -154,9 +174,14 @@ typedef struct {
     int shutdown_size;
     HANDLE *shutdown_events;
     CRITICAL_SECTION cs;
-    struct list scheduled_chores;
+    struct virtual_processor *vprocs;
+    LONG workers;   /* virtual processors owned by a running worker */
+    LONG requested; /* workers submitted to the thread pool, not started yet */
+    LONG next_vproc;
+    TP_WORK *work;
 } ThreadScheduler;
 extern const vtable_ptr ThreadScheduler_vtable;
+unsigned int __thiscall ThreadScheduler_Reference(ThreadScheduler*);
 
 typedef struct {
     Scheduler *scheduler;
@@ -220,11 +245,6 @@ typedef struct _UnrealizedChore
     void *unk[6];
 } _UnrealizedChore;
 
-struct scheduled_chore {
-    struct list entry;
-    _UnrealizedChore *chore;
-};
-
 /* keep in sync with msvcp90/msvcp90.h */
 typedef struct cs_queue
 {
@@ -929,6 +949,192 @@ BOOL __thiscall _Context_IsSynchronouslyBlocked(const _Context *this)
 }
 #endif
 
+static BOOL vproc_push(struct virtual_processor *vproc, const struct scheduled_task *task)
+{
+    AcquireSRWLockExclusive(&vproc->lock);
+    if (vproc->tail - vproc->head == vproc->size)
+    {
+        unsigned int i, size = vproc->size ? vproc->size * 2 : 64;
+        struct scheduled_task *tasks = malloc(size * sizeof(*tasks));
+
+        if (!tasks)
+        {
+            ReleaseSRWLockExclusive(&vproc->lock);
+            return FALSE;
+        }
+        for (i = 0; i < vproc->size; i++)
+            tasks[i] = vproc->tasks[(vproc->head + i) & (vproc->size - 1)];
+        free(vproc->tasks);
+        vproc->tasks = tasks;
+        vproc->head = 0;
+        vproc->tail = vproc->size;
+        vproc->size = size;
+    }
+    vproc->tasks[vproc->tail & (vproc->size - 1)] = *task;
+    vproc->tail++;
+    ReleaseSRWLockExclusive(&vproc->lock);
+    return TRUE;
+}
+
+static BOOL vproc_take(struct virtual_processor *vproc, BOOL from_tail,
+        BOOL chores_only, struct scheduled_task *task)
+{
+    unsigned int i, pos, mask;
+    BOOL ret = FALSE;
+
+    if (vproc->head == vproc->tail)
+        return FALSE;
+
+    AcquireSRWLockExclusive(&vproc->lock);
+    mask = vproc->size - 1;
+    for (i = 0; i < vproc->tail - vproc->head; i++)
+    {
+        pos = from_tail ? vproc->tail - 1 - i : vproc->head + i;
+        if (chores_only && vproc->tasks[pos & mask].proc)
+            continue;
+
+        *task = vproc->tasks[pos & mask];
+        if (from_tail)
+        {
+            for (; pos != vproc->tail - 1; pos++)
+                vproc->tasks[pos & mask] = vproc->tasks[(pos + 1) & mask];
+            vproc->tail--;
+        }
+        else
+        {
+            for (; pos != vproc->head; pos--)
+                vproc->tasks[pos & mask] = vproc->tasks[(pos - 1) & mask];
+            vproc->head++;
+        }
+        ret = TRUE;
+        break;
+    }
+    ReleaseSRWLockExclusive(&vproc->lock);
+    return ret;
+}
+
+/* removes the chores of task_collection, or of all collections owned by context */
+static LONG vproc_remove_chores(struct virtual_processor *vproc,
+        _StructuredTaskCollection *task_collection, const Context *context)
+{
+    unsigned int i, j, mask;
+    LONG removed = 0;
+
+    AcquireSRWLockExclusive(&vproc->lock);
+    mask = vproc->size - 1;
+    for (i = j = vproc->head; i != vproc->tail; i++)
+    {
+        struct scheduled_task *task = &vproc->tasks[i & mask];
+        _UnrealizedChore *chore = task->data;
+
+        if (!task->proc && (task_collection ? chore->task_collection == task_collection :
+                    chore->task_collection->context == context))
+        {
+            if (task_collection)
+                chore->task_collection = NULL;
+            removed++;
+            continue;
+        }
+        vproc->tasks[j++ & mask] = *task;
+    }
+    vproc->tail = j;
+    ReleaseSRWLockExclusive(&vproc->lock);
+    return removed;
+}
+
+static BOOL scheduler_has_tasks(ThreadScheduler *scheduler)
+{
+    unsigned int i;
+
+    for (i = 0; i < scheduler->virt_proc_no; i++)
+    {
+        if (scheduler->vprocs[i].head != scheduler->vprocs[i].tail)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+static BOOL scheduler_get_task(ThreadScheduler *scheduler, struct virtual_processor *vproc,
+        BOOL chores_only, struct scheduled_task *task)
+{
+    unsigned int i, start = vproc ? vproc->id + 1 : 0;
+
+    if (vproc && vproc_take(vproc, TRUE, chores_only, task))
+        return TRUE;
+
+    for (i = 0; i < scheduler->virt_proc_no; i++)
+    {
+        struct virtual_processor *victim = &scheduler->vprocs[(start + i) % scheduler->virt_proc_no];
+
+        if (victim != vproc && vproc_take(victim, FALSE, chores_only, task))
+            return TRUE;
+    }
+    return FALSE;
+}
+
+static struct virtual_processor* scheduler_acquire_vproc(ThreadScheduler *scheduler)
+{
+    unsigned int i;
+    LONG workers;
+
+    do
+    {
+        workers = scheduler->workers;
+        if (workers >= scheduler->virt_proc_no)
+            return NULL;
+    } while (InterlockedCompareExchange(&scheduler->workers, workers + 1, workers) != workers);
+
+    /* owned is cleared before workers is decremented, so a free virtual processor exists */
+    for (i = 0;; i = (i + 1) % scheduler->virt_proc_no)
+    {
+        if (!InterlockedCompareExchange(&scheduler->vprocs[i].owned, 1, 0))
+            return &scheduler->vprocs[i];
+    }
+}
+
+static void scheduler_release_vproc(ThreadScheduler *scheduler, struct virtual_processor *vproc)
+{
+    InterlockedExchange(&vproc->owned, 0);
+    InterlockedDecrement(&scheduler->workers);
+}
+
+static void scheduler_request_worker(ThreadScheduler *scheduler)
+{
+    LONG requested;
+
+    /* pairs with the workers decrement in scheduler_release_vproc, either the
+     * new task is seen by the releasing worker or a new worker is submitted */
+    MemoryBarrier();
+    do
+    {
+        requested = scheduler->requested;
+        if (scheduler->workers + requested >= scheduler->virt_proc_no)
+            return;
+    } while (InterlockedCompareExchange(&scheduler->requested, requested + 1, requested) != requested);
+
+    ThreadScheduler_Reference(scheduler);
+    SubmitThreadpoolWork(scheduler->work);
+}
+
+static BOOL scheduler_push_task(ThreadScheduler *scheduler,
+        void (__cdecl *proc)(void*), void *data)
+{
+    ExternalContextBase *ctx = (ExternalContextBase*)try_get_current_context();
+    struct scheduled_task task = { proc, data };
+    struct virtual_processor *vproc;
+
+    if (ctx && ctx->context.vtable == &ExternalContextBase_vtable &&
+            ctx->vproc && ctx->vproc->scheduler == scheduler)
+        vproc = ctx->vproc;
+    else
+        vproc = &scheduler->vprocs[(ULONG)InterlockedIncrement(&scheduler->next_vproc) % scheduler->virt_proc_no];
+
+    if (!vproc_push(vproc, &task))
+        return FALSE;
+    scheduler_request_worker(scheduler);
+    return TRUE;
+}
+
 DEFINE_THISCALL_WRAPPER(ExternalContextBase_GetId, 4)
 unsigned int __thiscall ExternalContextBase_GetId(const ExternalContextBase *this)
 {
@@ -939,8 +1145,8 @@ unsigned int __thiscall ExternalContextBase_GetId(const ExternalContextBase *thi
 DEFINE_THISCALL_WRAPPER(ExternalContextBase_GetVirtualProcessorId, 4)
 unsigned int __thiscall ExternalContextBase_GetVirtualProcessorId(const ExternalContextBase *this)
 {
-    FIXME("(%p)->() stub\n", this);
-    return -1;
+    TRACE("(%p)->()\n", this);
+    return this->vproc ? this->vproc->id : -1;
 }
 
 DEFINE_THISCALL_WRAPPER(ExternalContextBase_GetScheduleGroupId, 4)
@@ -970,16 +1176,34 @@ bool __thiscall ExternalContextBase_IsSynchronouslyBlocked(const ExternalContext
 DEFINE_THISCALL_WRAPPER(ExternalContextBase_Block, 4)
 void __thiscall ExternalContextBase_Block(ExternalContextBase *this)
 {
+    struct virtual_processor *vproc;
+    ThreadScheduler *scheduler = NULL;
     LONG blocked;
 
     TRACE("(%p)->()\n", this);
 
     blocked = InterlockedIncrement(&this->blocked);
+    if (blocked < 1)
+        return;
+
+    /* give the virtual processor to another worker while the context is blocked */
+    if ((vproc = this->vproc))
+    {
+        scheduler = vproc->scheduler;
+        this->vproc = NULL;
+        scheduler_release_vproc(scheduler, vproc);
+        if (scheduler_has_tasks(scheduler))
+            scheduler_request_worker(scheduler);
+    }
+
     while (blocked >= 1)
     {
         RtlWaitOnAddress(&this->blocked, &blocked, sizeof(LONG), NULL);
         blocked = this->blocked;
     }
+
+    if (vproc)
+        this->vproc = scheduler_acquire_vproc(scheduler);
 }
 
 DEFINE_THISCALL_WRAPPER(ExternalContextBase_Yield, 4)
@@ -1059,20 +1283,13 @@ int __thiscall ExternalContextBase_GetContextKind(const ExternalContextBase *thi
 static void remove_scheduled_chores(Scheduler *scheduler, const ExternalContextBase *context)
 {
     ThreadScheduler *tscheduler = (ThreadScheduler*)scheduler;
-    struct scheduled_chore *sc, *next;
+    unsigned int i;
 
     if (tscheduler->scheduler.vtable != &ThreadScheduler_vtable)
         return;
 
-    EnterCriticalSection(&tscheduler->cs);
-    LIST_FOR_EACH_ENTRY_SAFE(sc, next, &tscheduler->scheduled_chores,
-                             struct scheduled_chore, entry) {
-        if (sc->chore->task_collection->context == &context->context) {
-            list_remove(&sc->entry);
-            operator_delete(sc);
-        }
-    }
-    LeaveCriticalSection(&tscheduler->cs);
+    for (i = 0; i < tscheduler->virt_proc_no; i++)
+        vproc_remove_chores(&tscheduler->vprocs[i], NULL, &context->context);
 }
 
 static void ExternalContextBase_dtor(ExternalContextBase *this)
@@ -1401,7 +1618,6 @@ void __thiscall SchedulerPolicy_dtor(SchedulerPolicy *this)
 static void ThreadScheduler_dtor(ThreadScheduler *this)
 {
     int i;
-    struct scheduled_chore *sc, *next;
 
     if(this->ref != 0) WARN("ref = %ld\n", this->ref);
     SchedulerPolicy_dtor(&this->policy);
@@ -1413,11 +1629,13 @@ static void ThreadScheduler_dtor(ThreadScheduler *this)
     this->cs.DebugInfo->Spare[0] = 0;
     DeleteCriticalSection(&this->cs);
 
-    if (!list_empty(&this->scheduled_chores))
-        ERR("scheduled chore list is not empty\n");
-    LIST_FOR_EACH_ENTRY_SAFE(sc, next, &this->scheduled_chores,
-            struct scheduled_chore, entry)
-        operator_delete(sc);
+    /* may be called from the last worker callback, closing the work object doesn't wait for it */
+    CloseThreadpoolWork(this->work);
+    if (scheduler_has_tasks(this))
+        ERR("scheduled task list is not empty\n");
+    for(i=0; i<this->virt_proc_no; i++)
+        free(this->vprocs[i].tasks);
+    operator_delete(this->vprocs);
 }
 
 DEFINE_THISCALL_WRAPPER(ThreadScheduler_Id, 4)
@@ -1527,33 +1745,62 @@ DEFINE_THISCALL_WRAPPER(ThreadScheduler_CreateScheduleGroup, 4)
     return NULL;
 }
 
-typedef struct
+void __cdecl CurrentScheduler_Detach(void);
+unsigned int __cdecl SpinCount__Value(void);
+
+static void run_task(ThreadScheduler *scheduler, const struct scheduled_task *task)
 {
-    void (__cdecl *proc)(void*);
-    void *data;
-    ThreadScheduler *scheduler;
-} schedule_task_arg;
+    if (!task->proc)
+    {
+        _UnrealizedChore *chore = task->data;
+        chore->chore_wrapper(chore);
+        return;
+    }
 
-void __cdecl CurrentScheduler_Detach(void);
+    task->proc(task->data);
+    ThreadScheduler_Release(scheduler);
+}
 
-static void WINAPI schedule_task_proc(PTP_CALLBACK_INSTANCE instance, void *context, PTP_WORK work)
+static void WINAPI scheduler_worker_proc(PTP_CALLBACK_INSTANCE instance, void *context, PTP_WORK work)
 {
-    schedule_task_arg arg;
+    ThreadScheduler *scheduler = context;
+    ExternalContextBase *ctx = (ExternalContextBase*)get_current_context();
+    unsigned int idle = 0, spin_count = SpinCount__Value();
+    struct scheduled_task task;
     BOOL detach = FALSE;
 
-    arg = *(schedule_task_arg*)context;
-    operator_delete(context);
+    InterlockedDecrement(&scheduler->requested);
 
-    if(&arg.scheduler->scheduler != get_current_scheduler()) {
-        ThreadScheduler_Attach(arg.scheduler);
+    if(&scheduler->scheduler != get_scheduler_from_context(&ctx->context)) {
+        ThreadScheduler_Attach(scheduler);
         detach = TRUE;
     }
-    ThreadScheduler_Release(arg.scheduler);
 
-    arg.proc(arg.data);
+    for(;;) {
+        /* the virtual processor is lost if a task blocked and couldn't get it back */
+        if(!ctx->vproc && !(ctx->vproc = scheduler_acquire_vproc(scheduler)))
+            break;
+
+        if(scheduler_get_task(scheduler, ctx->vproc, FALSE, &task)) {
+            run_task(scheduler, &task);
+            idle = 0;
+            continue;
+        }
+        if(idle++ < spin_count) {
+            YieldProcessor();
+            continue;
+        }
+
+        scheduler_release_vproc(scheduler, ctx->vproc);
+        ctx->vproc = NULL;
+        if(!scheduler_has_tasks(scheduler))
+            break;
+        idle = 0;
+    }
 
     if(detach)
         CurrentScheduler_Detach();
+    ThreadScheduler_Release(scheduler);
 }
 
 DEFINE_THISCALL_WRAPPER(ThreadScheduler_ScheduleTask_loc, 16)
@@ -1561,32 +1808,21 @@ void __thiscall ThreadScheduler_ScheduleTask_loc(ThreadScheduler *this,
         void (__cdecl *proc)(void*), void* data, /*location*/void *placement)
 {
     static unsigned int once;
-    schedule_task_arg *arg;
-    TP_WORK *work;
 
-    if(!once++)
-        FIXME("(%p %p %p %p) semi-stub\n", this, proc, data, placement);
+    if(placement && !once++)
+        FIXME("(%p %p %p %p) placement not supported\n", this, proc, data, placement);
     else
-        TRACE("(%p %p %p %p) semi-stub\n", this, proc, data, placement);
+        TRACE("(%p %p %p %p)\n", this, proc, data, placement);
 
-    arg = operator_new(sizeof(*arg));
-    arg->proc = proc;
-    arg->data = data;
-    arg->scheduler = this;
+    /* queued tasks keep the scheduler alive */
     ThreadScheduler_Reference(this);
-
-    work = CreateThreadpoolWork(schedule_task_proc, arg, NULL);
-    if(!work) {
+    if(!scheduler_push_task(this, proc, data)) {
         scheduler_resource_allocation_error e;
 
         ThreadScheduler_Release(this);
-        operator_delete(arg);
-        scheduler_resource_allocation_error_ctor_name(&e, NULL,
-                HRESULT_FROM_WIN32(GetLastError()));
+        scheduler_resource_allocation_error_ctor_name(&e, NULL, E_OUTOFMEMORY);
         _CxxThrowException(&e, &scheduler_resource_allocation_error_exception_type);
     }
-    SubmitThreadpoolWork(work);
-    CloseThreadpoolWork(work);
 }
 
 DEFINE_THISCALL_WRAPPER(ThreadScheduler_ScheduleTask, 12)
@@ -1628,6 +1864,7 @@ Scheduler* __thiscall ThreadScheduler_vector_dtor(ThreadScheduler *this, unsigne
 static ThreadScheduler* ThreadScheduler_ctor(ThreadScheduler *this,
         const SchedulerPolicy *policy)
 {
+    unsigned int i, min_concurrency;
     SYSTEM_INFO si;
 
     TRACE("(%p)->()\n", this);
@@ -1641,14 +1878,38 @@ static ThreadScheduler* ThreadScheduler_ctor(ThreadScheduler *this,
     this->virt_proc_no = SchedulerPolicy_GetPolicyValue(&this->policy, MaxConcurrency);
     if(this->virt_proc_no > si.dwNumberOfProcessors)
         this->virt_proc_no = si.dwNumberOfProcessors;
+    /* MinConcurrency may oversubscribe the processors, -1 stands for MaxExecutionResources */
+    min_concurrency = SchedulerPolicy_GetPolicyValue(&this->policy, MinConcurrency);
+    if(min_concurrency == -1)
+        min_concurrency = si.dwNumberOfProcessors;
+    if(this->virt_proc_no < min_concurrency)
+        this->virt_proc_no = min_concurrency;
 
     this->shutdown_count = this->shutdown_size = 0;
     this->shutdown_events = NULL;
 
+    this->vprocs = operator_new(this->virt_proc_no * sizeof(*this->vprocs));
+    memset(this->vprocs, 0, this->virt_proc_no * sizeof(*this->vprocs));
+    for(i=0; i<this->virt_proc_no; i++) {
+        InitializeSRWLock(&this->vprocs[i].lock);
+        this->vprocs[i].id = i;
+        this->vprocs[i].scheduler = this;
+    }
+    this->workers = this->requested = this->next_vproc = 0;
+
+    this->work = CreateThreadpoolWork(scheduler_worker_proc, this, NULL);
+    if(!this->work) {
+        scheduler_resource_allocation_error e;
+
+        operator_delete(this->vprocs);
+        SchedulerPolicy_dtor(&this->policy);
+        scheduler_resource_allocation_error_ctor_name(&e, NULL,
+                HRESULT_FROM_WIN32(GetLastError()));
+        _CxxThrowException(&e, &scheduler_resource_allocation_error_exception_type);
+    }
+
     InitializeCriticalSectionEx(&this->cs, 0, RTL_CRITICAL_SECTION_FLAG_FORCE_DEBUG_INFO);
     this->cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": ThreadScheduler");
-
-    list_init(&this->scheduled_chores);
     return this;
 }
 
@@ -2132,9 +2393,9 @@ void __thiscall _StructuredTaskCollection__Cancel(
 {
     ThreadScheduler *scheduler;
     void *prev_exception, *new_exception;
-    struct scheduled_chore *sc, *next;
     LONG removed = 0, finished = 1;
     struct beacon *beacon;
+    unsigned int i;
 
     TRACE("(%p)\n", this);
 
@@ -2162,17 +2423,8 @@ void __thiscall _StructuredTaskCollection__Cancel(
     }
     LeaveCriticalSection(&((ExternalContextBase*)this->context)->beacons_cs);
 
-    EnterCriticalSection(&scheduler->cs);
-    LIST_FOR_EACH_ENTRY_SAFE(sc, next, &scheduler->scheduled_chores,
-                             struct scheduled_chore, entry) {
-        if (sc->chore->task_collection != this)
-            continue;
-        sc->chore->task_collection = NULL;
-        list_remove(&sc->entry);
-        removed++;
-        operator_delete(sc);
-    }
-    LeaveCriticalSection(&scheduler->cs);
+    for (i = 0; i < scheduler->virt_proc_no; i++)
+        removed += vproc_remove_chores(&scheduler->vprocs[i], this, NULL);
     if (!removed)
         return;
 
@@ -2282,9 +2534,9 @@ static void __cdecl chore_wrapper(_UnrealizedChore *chore)
 
 static BOOL pick_and_execute_chore(ThreadScheduler *scheduler)
 {
-    struct list *entry;
-    struct scheduled_chore *sc;
-    _UnrealizedChore *chore;
+    ExternalContextBase *ctx = (ExternalContextBase*)try_get_current_context();
+    struct virtual_processor *vproc = NULL;
+    struct scheduled_task task;
 
     TRACE("(%p)\n", scheduler);
 
@@ -2294,38 +2546,26 @@ static BOOL pick_and_execute_chore(ThreadScheduler *scheduler)
         return FALSE;
     }
 
-    EnterCriticalSection(&scheduler->cs);
-    entry = list_head(&scheduler->scheduled_chores);
-    if (entry)
-        list_remove(entry);
-    LeaveCriticalSection(&scheduler->cs);
-    if (!entry)
+    /* start with the chores this context pushed itself, then steal */
+    if (ctx && ctx->context.vtable == &ExternalContextBase_vtable &&
+            ctx->vproc && ctx->vproc->scheduler == scheduler)
+        vproc = ctx->vproc;
+    if (!scheduler_get_task(scheduler, vproc, TRUE, &task))
         return FALSE;
 
-    sc = LIST_ENTRY(entry, struct scheduled_chore, entry);
-    chore = sc->chore;
-    operator_delete(sc);
-
-    chore->chore_wrapper(chore);
+    run_task(scheduler, &task);
     return TRUE;
 }
 
-static void __cdecl _StructuredTaskCollection_scheduler_cb(void *data)
-{
-    pick_and_execute_chore((ThreadScheduler*)get_current_scheduler());
-}
-
-static bool schedule_chore(_StructuredTaskCollection *this,
-        _UnrealizedChore *chore, Scheduler **pscheduler)
+static void schedule_chore(_StructuredTaskCollection *this, _UnrealizedChore *chore)
 {
-    struct scheduled_chore *sc;
     ThreadScheduler *scheduler;
 
     if (chore->task_collection) {
         invalid_multiple_scheduling e;
         invalid_multiple_scheduling_ctor_str(&e, "Chore scheduled multiple times");
         _CxxThrowException(&e, &invalid_multiple_scheduling_exception_type);
-        return FALSE;
+        return;
     }
 
     if (!this->context)
@@ -2333,21 +2573,21 @@ static bool schedule_chore(_StructuredTaskCollection *this,
     scheduler = get_thread_scheduler_from_context(this->context);
     if (!scheduler) {
         ERR("unknown context or scheduler set\n");
-        return FALSE;
+        return;
     }
 
-    sc = operator_new(sizeof(*sc));
-    sc->chore = chore;
-
     chore->task_collection = this;
     chore->chore_wrapper = chore_wrapper;
     InterlockedIncrement(&this->count);
 
-    EnterCriticalSection(&scheduler->cs);
-    list_add_head(&scheduler->scheduled_chores, &sc->entry);
-    LeaveCriticalSection(&scheduler->cs);
-    *pscheduler = &scheduler->scheduler;
-    return TRUE;
+    if (!scheduler_push_task(scheduler, NULL, chore)) {
+        scheduler_resource_allocation_error e;
+
+        InterlockedDecrement(&this->count);
+        chore->task_collection = NULL;
+        scheduler_resource_allocation_error_ctor_name(&e, NULL, E_OUTOFMEMORY);
+        _CxxThrowException(&e, &scheduler_resource_allocation_error_exception_type);
+    }
 }
 
 #if _MSVCR_VER >= 110
@@ -2360,15 +2600,8 @@ void __thiscall _StructuredTaskCollection__Schedule_loc(
         _StructuredTaskCollection *this, _UnrealizedChore *chore,
         /*location*/void *placement)
 {
-    Scheduler *scheduler;
-
     TRACE("(%p %p %p)\n", this, chore, placement);
-
-    if (schedule_chore(this, chore, &scheduler))
-    {
-        call_Scheduler_ScheduleTask_loc(scheduler,
-                _StructuredTaskCollection_scheduler_cb, NULL, placement);
-    }
+    schedule_chore(this, chore);
 }
 
 #endif /* _MSVCR_VER >= 110 */
@@ -2380,15 +2613,8 @@ DEFINE_THISCALL_WRAPPER(_StructuredTaskCollection__Schedule, 8)
 void __thiscall _StructuredTaskCollection__Schedule(
         _StructuredTaskCollection *this, _UnrealizedChore *chore)
 {
-    Scheduler *scheduler;
-
     TRACE("(%p %p)\n", this, chore);
-
-    if (schedule_chore(this, chore, &scheduler))
-    {
-        call_Scheduler_ScheduleTask(scheduler,
-                _StructuredTaskCollection_scheduler_cb, NULL);
-    }
+    schedule_chore(this, chore);
 }
 
 static void CALLBACK exception_ptr_rethrow_finally(BOOL normal, void *data)
@@ -65,11 +65,15 @@ typedef int (CDECL *MSVCRT_matherr_func)(struct _exception *);
 static MSVCRT_matherr_func MSVCRT_default_matherr_func = NULL;
 
 BOOL sse2_supported;
+BOOL avx2_supported;
 static BOOL sse2_enabled;
 
 void msvcrt_init_math( void *module )
 {
     sse2_supported = IsProcessorFeaturePresent( PF_XMMI64_INSTRUCTIONS_AVAILABLE );
+    /* the CPU feature alone isn't enough, the OS must also save the YMM registers */
+    avx2_supported = IsProcessorFeaturePresent( PF_AVX2_INSTRUCTIONS_AVAILABLE ) &&
+                     (RtlGetEnabledExtendedFeatures( XSTATE_MASK_GSSE ) & XSTATE_MASK_GSSE);
 #if _MSVCR_VER <=71
     sse2_enabled = FALSE;
 #else
@@ -28,6 +28,9 @@
 #include <limits.h>
 #include <locale.h>
 #include <float.h>
+#if defined(__x86_64__) && !defined(__arm64ec__)
+#include <immintrin.h>
+#endif
 #include "msvcrt.h"
 #include "bnum.h"
 #include "winnls.h"
@@ -1560,12 +1563,181 @@ int CDECL _atoldbl(_LDOUBLE *value, char *str)
     return _atoldbl_l( (MSVCRT__LDOUBLE*)value, str, NULL );
 }
 
+#if defined(__x86_64__) && !defined(__arm64ec__)
+
+/* The scanning functions below only do aligned loads, which never cross a page
+ * boundary, and discard the bits of the bytes in front of the string.
+ * They are x86_64 only: i386 code can't rely on the stack alignment that vector
+ * spills need, so it keeps the C loops. */
+
+static size_t __attribute__((target("sse2"))) sse2_strlen(const char *str)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const char *p = (const char *)((ULONG_PTR)str & ~15);
+    unsigned int mask;
+
+    mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i *)p), zero));
+    mask >>= (ULONG_PTR)str & 15;
+    if (mask) return __builtin_ctz(mask);
+    for (;;)
+    {
+        p += 16;
+        mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i *)p), zero));
+        if (mask) return p - str + __builtin_ctz(mask);
+    }
+}
+
+static size_t __attribute__((target("avx2"))) avx2_strlen(const char *str)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const char *p = (const char *)((ULONG_PTR)str & ~31);
+    unsigned int mask;
+
+    mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_load_si256((const __m256i *)p), zero));
+    mask >>= (ULONG_PTR)str & 31;
+    if (mask) return __builtin_ctz(mask);
+    for (;;)
+    {
+        p += 32;
+        mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_load_si256((const __m256i *)p), zero));
+        if (mask) return p - str + __builtin_ctz(mask);
+    }
+}
+
+static char * __attribute__((target("sse2"))) sse2_strchr(const char *str, char c)
+{
+    const __m128i zero = _mm_setzero_si128(), ch = _mm_set1_epi8(c);
+    const char *p = (const char *)((ULONG_PTR)str & ~15);
+    unsigned int mask;
+    __m128i v;
+
+    v = _mm_load_si128((const __m128i *)p);
+    mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, zero), _mm_cmpeq_epi8(v, ch)));
+    mask >>= (ULONG_PTR)str & 15;
+    if (mask) p = str + __builtin_ctz(mask);
+    else for (;;)
+    {
+        p += 16;
+        v = _mm_load_si128((const __m128i *)p);
+        mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, zero), _mm_cmpeq_epi8(v, ch)));
+        if (!mask) continue;
+        p += __builtin_ctz(mask);
+        break;
+    }
+    return *p == c ? (char *)p : NULL;
+}
+
+static char * __attribute__((target("avx2"))) avx2_strchr(const char *str, char c)
+{
+    const __m256i zero = _mm256_setzero_si256(), ch = _mm256_set1_epi8(c);
+    const char *p = (const char *)((ULONG_PTR)str & ~31);
+    unsigned int mask;
+    __m256i v;
+
+    v = _mm256_load_si256((const __m256i *)p);
+    mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, zero), _mm256_cmpeq_epi8(v, ch)));
+    mask >>= (ULONG_PTR)str & 31;
+    if (mask) p = str + __builtin_ctz(mask);
+    else for (;;)
+    {
+        p += 32;
+        v = _mm256_load_si256((const __m256i *)p);
+        mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, zero), _mm256_cmpeq_epi8(v, ch)));
+        if (!mask) continue;
+        p += __builtin_ctz(mask);
+        break;
+    }
+    return *p == c ? (char *)p : NULL;
+}
+
+static void * __attribute__((target("sse2"))) sse2_memchr(const unsigned char *ptr, unsigned char c, size_t n)
+{
+    const __m128i ch = _mm_set1_epi8(c);
+    const unsigned char *p = (const unsigned char *)((ULONG_PTR)ptr & ~15);
+    unsigned int mask, pos;
+
+    mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i *)p), ch));
+    mask >>= (ULONG_PTR)ptr & 15;
+    if (mask) return (pos = __builtin_ctz(mask)) < n ? (void *)(ptr + pos) : NULL;
+    if (n <= 16 - ((ULONG_PTR)ptr & 15)) return NULL;
+    n -= 16 - ((ULONG_PTR)ptr & 15);
+    for (;;)
+    {
+        p += 16;
+        mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i *)p), ch));
+        if (mask) return (pos = __builtin_ctz(mask)) < n ? (void *)(p + pos) : NULL;
+        if (n <= 16) return NULL;
+        n -= 16;
+    }
+}
+
+static void * __attribute__((target("avx2"))) avx2_memchr(const unsigned char *ptr, unsigned char c, size_t n)
+{
+    const __m256i ch = _mm256_set1_epi8(c);
+    const unsigned char *p = (const unsigned char *)((ULONG_PTR)ptr & ~31);
+    unsigned int mask, pos;
+
+    mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_load_si256((const __m256i *)p), ch));
+    mask >>= (ULONG_PTR)ptr & 31;
+    if (mask) return (pos = __builtin_ctz(mask)) < n ? (void *)(ptr + pos) : NULL;
+    if (n <= 32 - ((ULONG_PTR)ptr & 31)) return NULL;
+    n -= 32 - ((ULONG_PTR)ptr & 31);
+    for (;;)
+    {
+        p += 32;
+        mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_load_si256((const __m256i *)p), ch));
+        if (mask) return (pos = __builtin_ctz(mask)) < n ? (void *)(p + pos) : NULL;
+        if (n <= 32) return NULL;
+        n -= 32;
+    }
+}
+
+/* strings are compared 16 bytes at a time as long as neither load can cross into the next page */
+static int __attribute__((target("sse2"))) sse2_strcmp(const char *str1, const char *str2)
+{
+    const __m128i zero = _mm_setzero_si128();
+    unsigned int mask;
+    __m128i v1, v2;
+
+    for (;;)
+    {
+        if (((ULONG_PTR)str1 & 0xfff) > 0xff0 || ((ULONG_PTR)str2 & 0xfff) > 0xff0)
+        {
+            if (!*str1 || *str1 != *str2) break;
+            str1++;
+            str2++;
+            continue;
+        }
+        v1 = _mm_loadu_si128((const __m128i *)str1);
+        v2 = _mm_loadu_si128((const __m128i *)str2);
+        mask = (_mm_movemask_epi8(_mm_cmpeq_epi8(v1, v2)) ^ 0xffff) | _mm_movemask_epi8(_mm_cmpeq_epi8(v1, zero));
+        if (mask)
+        {
+            str1 += __builtin_ctz(mask);
+            str2 += __builtin_ctz(mask);
+            break;
+        }
+        str1 += 16;
+        str2 += 16;
+    }
+    if ((unsigned char)*str1 > (unsigned char)*str2) return 1;
+    if ((unsigned char)*str1 < (unsigned char)*str2) return -1;
+    return 0;
+}
+
+#endif
+
 /*********************************************************************
  *              strlen (MSVCRT.@)
  */
 size_t __cdecl strlen(const char *str)
 {
     const char *s = str;
+
+#if defined(__x86_64__) && !defined(__arm64ec__)
+    if (avx2_supported) return avx2_strlen(str);
+    if (sse2_supported) return sse2_strlen(str);
+#endif
     while (*s) s++;
     return s - str;
 }
@@ -3249,6 +3421,10 @@ void *__cdecl memset(void *dst, int c, size_t n)
  */
 char* __cdecl strchr(const char *str, int c)
 {
+#if defined(__x86_64__) && !defined(__arm64ec__)
+    if (avx2_supported) return avx2_strchr(str, c);
+    if (sse2_supported) return sse2_strchr(str, c);
+#endif
     do
     {
         if (*str == (char)c) return (char*)str;
@@ -3273,6 +3449,11 @@ void* __cdecl memchr(const void *ptr, int c, size_t n)
 {
     const unsigned char *p = ptr;
 
+#if defined(__x86_64__) && !defined(__arm64ec__)
+    if (!n) return NULL;
+    if (avx2_supported) return avx2_memchr(ptr, c, n);
+    if (sse2_supported) return sse2_memchr(ptr, c, n);
+#endif
     for (p = ptr; n; n--, p++) if (*p == (unsigned char)c) return (void *)(ULONG_PTR)p;
     return NULL;
 }
@@ -3282,6 +3463,9 @@ void* __cdecl memchr(const void *ptr, int c, size_t n)
  */
 int __cdecl strcmp(const char *str1, const char *str2)
 {
+#if defined(__x86_64__) && !defined(__arm64ec__)
+    if (sse2_supported) return sse2_strcmp(str1, str2);
+#endif
     while (*str1 && *str1 == *str2) { str1++; str2++; }
     if ((unsigned char)*str1 > (unsigned char)*str2) return 1;
     if ((unsigned char)*str1 < (unsigned char)*str2) return -1;
@@ -122,6 +122,12 @@ static unsigned int (__cdecl *p_mbsnextc_l)(const unsigned char*, _locale_t);
 static int (__cdecl *p_mbscmp_l)(const unsigned char*, const unsigned char*, _locale_t);
 static int (__cdecl *p__strnicmp_l)(const char*, const char*, size_t, _locale_t);
 static int (__cdecl *p_toupper)(int);
+static size_t (__cdecl *p_strlen)(const char*);
+static char* (__cdecl *p_strchr)(const char*, int);
+static void* (__cdecl *p_memchr)(const void*, int, size_t);
+static size_t (__cdecl *p_wcslen)(const wchar_t*);
+static wchar_t* (__cdecl *p_wcschr)(const wchar_t*, wchar_t);
+static int (__cdecl *p_wcscmp)(const wchar_t*, const wchar_t*);
 
 int CDECL __STRINGTOLD(_LDOUBLE*, char**, const char*, int);
 
@@ -5022,6 +5028,139 @@ static void test_toupper(void)
     setlocale(LC_ALL, "C");
 }
 
+static void test_string_scan_boundaries(void)
+{
+    char *page, *end, *str, *str2;
+    wchar_t *wstr, *wstr2;
+    size_t len, off, i;
+    DWORD old_prot;
+
+    page = VirtualAlloc(NULL, 0x3000, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    ok(page != NULL, "VirtualAlloc failed\n");
+    end = page + 0x2000;
+    VirtualProtect(end, 0x1000, PAGE_NOACCESS, &old_prot);
+    memset(page, 'x', 0x2000);
+
+    /* strings ending right before an inaccessible page, at every alignment */
+    for (len = 0; len < 80; len++)
+    {
+        for (off = 0; off < 40; off++)
+        {
+            str = end - len - 1 - off;
+            memset(str, 'a', len);
+            str[len] = 0;
+            if (len) str[len - 1] = 'b';
+
+            ok(p_strlen(str) == len, "len %Iu off %Iu: strlen returned %Iu\n", len, off, p_strlen(str));
+            ok(p_strchr(str, 0) == str + len, "len %Iu off %Iu: strchr(0) returned %p\n", len, off, p_strchr(str, 0));
+            ok(p_strchr(str, 'b') == (len ? str + len - 1 : NULL), "len %Iu off %Iu: strchr('b') returned %p\n",
+               len, off, p_strchr(str, 'b'));
+            ok(!p_strchr(str, 'c'), "len %Iu off %Iu: strchr('c') returned %p\n", len, off, p_strchr(str, 'c'));
+            ok(p_memchr(str, 0, len + 1) == str + len, "len %Iu off %Iu: memchr returned %p\n",
+               len, off, p_memchr(str, 0, len + 1));
+            ok(!p_memchr(str, 0, len), "len %Iu off %Iu: memchr returned %p\n", len, off, p_memchr(str, 0, len));
+
+            str2 = page + 0x1000 - off;
+            memcpy(str2, str, len + 1);
+            ok(!p_strcmp(str, str2), "len %Iu off %Iu: strings differ\n", len, off);
+            if (len)
+            {
+                str2[len - 1] = 'c';
+                ok(p_strcmp(str, str2) < 0, "len %Iu off %Iu: wrong order\n", len, off);
+                ok(p_strcmp(str2, str) > 0, "len %Iu off %Iu: wrong order\n", len, off);
+            }
+            str[len] = 'x';
+            if (len) str[len - 1] = 'x';
+        }
+    }
+
+    for (len = 0; len < 40; len++)
+    {
+        for (off = 0; off < 20; off++)
+        {
+            wstr = (wchar_t *)end - len - 1 - off;
+            for (i = 0; i < len; i++) wstr[i] = 0x100 + i;
+            wstr[len] = 0;
+
+            ok(p_wcslen(wstr) == len, "len %Iu off %Iu: wcslen returned %Iu\n", len, off, p_wcslen(wstr));
+            ok(p_wcschr(wstr, 0) == wstr + len, "len %Iu off %Iu: wcschr(0) returned %p\n",
+               len, off, p_wcschr(wstr, 0));
+            ok(p_wcschr(wstr, 0x100 + len / 2) == (len ? wstr + len / 2 : NULL),
+               "len %Iu off %Iu: wcschr returned %p\n", len, off, p_wcschr(wstr, 0x100 + len / 2));
+
+            wstr2 = (wchar_t *)(page + 0x1000) - off;
+            memcpy(wstr2, wstr, (len + 1) * sizeof(wchar_t));
+            ok(!p_wcscmp(wstr, wstr2), "len %Iu off %Iu: strings differ\n", len, off);
+            if (len)
+            {
+                wstr2[len - 1] = 0xfff0;
+                ok(p_wcscmp(wstr, wstr2) < 0, "len %Iu off %Iu: wrong order\n", len, off);
+                ok(p_wcscmp(wstr2, wstr) > 0, "len %Iu off %Iu: wrong order\n", len, off);
+            }
+            memset(wstr, 'x', (len + 1) * sizeof(wchar_t));
+        }
+    }
+
+    VirtualFree(page, 0, MEM_RELEASE);
+}
+
+static void test_string_scan_benchmark(void)
+{
+    static const size_t sizes[] = { 16, 64, 256, 4096, 65536 };
+    static const size_t aligns[] = { 0, 1, 7, 15 };
+    LARGE_INTEGER freq, start, stop;
+    size_t i, j, iter, count, total;
+    wchar_t *wbuf, *wbuf2;
+    char *buf, *buf2;
+    double secs;
+
+    if (!winetest_interactive)
+    {
+        skip("string scanning benchmark, set WINETEST_INTERACTIVE to run it\n");
+        return;
+    }
+
+    buf = malloc(65536 + 64);
+    buf2 = malloc(65536 + 64);
+    wbuf = malloc((65536 + 64) * sizeof(wchar_t));
+    wbuf2 = malloc((65536 + 64) * sizeof(wchar_t));
+    QueryPerformanceFrequency(&freq);
+
+#define BENCH(name, setup, call) \
+    for (i = 0; i < ARRAY_SIZE(sizes); i++) \
+    { \
+        for (j = 0; j < ARRAY_SIZE(aligns); j++) \
+        { \
+            size_t len = sizes[i], align = aligns[j]; \
+            setup; \
+            count = max(16, (64 << 20) / len); \
+            total = 0; \
+            QueryPerformanceCounter(&start); \
+            for (iter = 0; iter < count; iter++) total += (size_t)(call); \
+            QueryPerformanceCounter(&stop); \
+            secs = (double)(stop.QuadPart - start.QuadPart) / freq.QuadPart; \
+            trace("%-7s size %6Iu align %2Iu: %8.1f MB/s (%Iu)\n", name, len, align, \
+                  count * (double)len / secs / (1 << 20), total & 1); \
+        } \
+    }
+
+    BENCH("strlen", (memset(buf + align, 'a', len), buf[align + len] = 0), p_strlen(buf + align));
+    BENCH("strchr", (memset(buf + align, 'a', len), buf[align + len] = 0), p_strchr(buf + align, 'b'));
+    BENCH("memchr", memset(buf + align, 'a', len + 1), p_memchr(buf + align, 'b', len));
+    BENCH("strcmp", (memset(buf + align, 'a', len), buf[align + len] = 0, memcpy(buf2, buf + align, len + 1)),
+          p_strcmp(buf + align, buf2));
+    BENCH("wcslen", (wmemset(wbuf + align, 'a', len), wbuf[align + len] = 0), p_wcslen(wbuf + align));
+    BENCH("wcschr", (wmemset(wbuf + align, 'a', len), wbuf[align + len] = 0), p_wcschr(wbuf + align, 'b'));
+    BENCH("wcscmp", (wmemset(wbuf + align, 'a', len), wbuf[align + len] = 0,
+          memcpy(wbuf2, wbuf + align, (len + 1) * sizeof(wchar_t))), p_wcscmp(wbuf + align, wbuf2));
+#undef BENCH
+
+    free(buf);
+    free(buf2);
+    free(wbuf);
+    free(wbuf2);
+}
+
 START_TEST(string)
 {
     char mem[100];
@@ -5099,6 +5238,12 @@ START_TEST(string)
     p_mbscmp_l = (void*)GetProcAddress(hMsvcrt, "_mbscmp_l");
     p__strnicmp_l = (void*)GetProcAddress(hMsvcrt, "_strnicmp_l");
     p_toupper = (void*)GetProcAddress(hMsvcrt, "toupper");
+    p_strlen = (void*)GetProcAddress(hMsvcrt, "strlen");
+    p_strchr = (void*)GetProcAddress(hMsvcrt, "strchr");
+    p_memchr = (void*)GetProcAddress(hMsvcrt, "memchr");
+    p_wcslen = (void*)GetProcAddress(hMsvcrt, "wcslen");
+    p_wcschr = (void*)GetProcAddress(hMsvcrt, "wcschr");
+    p_wcscmp = (void*)GetProcAddress(hMsvcrt, "wcscmp");
 
     /* MSVCRT memcpy behaves like memmove for overlapping moves,
        MFC42 CString::Insert seems to rely on that behaviour */
@@ -5189,4 +5334,6 @@ START_TEST(string)
     test__tolower_l();
     test__strnicmp_l();
     test_toupper();
+    test_string_scan_boundaries();
+    test_string_scan_benchmark();
 }
@@ -26,6 +26,9 @@
 #include <assert.h>
 #include <wchar.h>
 #include <wctype.h>
+#if defined(__x86_64__) && !defined(__arm64ec__)
+#include <immintrin.h>
+#endif
 #include "msvcrt.h"
 #include "winnls.h"
 #include "wtypes.h"
@@ -1962,11 +1965,112 @@ int WINAPIV _swprintf_p_l(wchar_t *buffer, size_t length,
     return r;
 }
 
+#if defined(__x86_64__) && !defined(__arm64ec__)
+
+/* Like their narrow counterparts in string.c, these only do aligned loads,
+ * so they require strings aligned on a character boundary. */
+
+static size_t __attribute__((target("sse2"))) sse2_wcslen(const wchar_t *str)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const char *p = (const char *)((ULONG_PTR)str & ~15);
+    unsigned int mask;
+
+    mask = _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_load_si128((const __m128i *)p), zero));
+    mask >>= (ULONG_PTR)str & 15;
+    if (mask) return __builtin_ctz(mask) / sizeof(wchar_t);
+    for (;;)
+    {
+        p += 16;
+        mask = _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_load_si128((const __m128i *)p), zero));
+        if (mask) return (p - (const char *)str + __builtin_ctz(mask)) / sizeof(wchar_t);
+    }
+}
+
+static size_t __attribute__((target("avx2"))) avx2_wcslen(const wchar_t *str)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const char *p = (const char *)((ULONG_PTR)str & ~31);
+    unsigned int mask;
+
+    mask = _mm256_movemask_epi8(_mm256_cmpeq_epi16(_mm256_load_si256((const __m256i *)p), zero));
+    mask >>= (ULONG_PTR)str & 31;
+    if (mask) return __builtin_ctz(mask) / sizeof(wchar_t);
+    for (;;)
+    {
+        p += 32;
+        mask = _mm256_movemask_epi8(_mm256_cmpeq_epi16(_mm256_load_si256((const __m256i *)p), zero));
+        if (mask) return (p - (const char *)str + __builtin_ctz(mask)) / sizeof(wchar_t);
+    }
+}
+
+static wchar_t * __attribute__((target("sse2"))) sse2_wcschr(const wchar_t *str, wchar_t ch)
+{
+    const __m128i zero = _mm_setzero_si128(), c = _mm_set1_epi16(ch);
+    const char *p = (const char *)((ULONG_PTR)str & ~15);
+    const wchar_t *ret;
+    unsigned int mask;
+    __m128i v;
+
+    v = _mm_load_si128((const __m128i *)p);
+    mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi16(v, zero), _mm_cmpeq_epi16(v, c)));
+    mask >>= (ULONG_PTR)str & 15;
+    if (mask) ret = (const wchar_t *)((const char *)str + __builtin_ctz(mask));
+    else for (;;)
+    {
+        p += 16;
+        v = _mm_load_si128((const __m128i *)p);
+        mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi16(v, zero), _mm_cmpeq_epi16(v, c)));
+        if (!mask) continue;
+        ret = (const wchar_t *)(p + __builtin_ctz(mask));
+        break;
+    }
+    return *ret == ch ? (wchar_t *)ret : NULL;
+}
+
+/* strings are compared 8 characters at a time as long as neither load can cross into the next page */
+static int __attribute__((target("sse2"))) sse2_wcscmp(const wchar_t *str1, const wchar_t *str2)
+{
+    const __m128i zero = _mm_setzero_si128();
+    unsigned int mask;
+    __m128i v1, v2;
+
+    for (;;)
+    {
+        if (((ULONG_PTR)str1 & 0xfff) > 0xff0 || ((ULONG_PTR)str2 & 0xfff) > 0xff0)
+        {
+            if (!*str1 || *str1 != *str2) break;
+            str1++;
+            str2++;
+            continue;
+        }
+        v1 = _mm_loadu_si128((const __m128i *)str1);
+        v2 = _mm_loadu_si128((const __m128i *)str2);
+        mask = (_mm_movemask_epi8(_mm_cmpeq_epi16(v1, v2)) ^ 0xffff) | _mm_movemask_epi8(_mm_cmpeq_epi16(v1, zero));
+        if (mask)
+        {
+            str1 += __builtin_ctz(mask) / sizeof(wchar_t);
+            str2 += __builtin_ctz(mask) / sizeof(wchar_t);
+            break;
+        }
+        str1 += 8;
+        str2 += 8;
+    }
+    if (*str1 < *str2) return -1;
+    if (*str1 > *str2) return 1;
+    return 0;
+}
+
+#endif
+
 /*********************************************************************
  *              wcscmp (MSVCRT.@)
  */
 int CDECL wcscmp(const wchar_t *str1, const wchar_t *str2)
 {
+#if defined(__x86_64__) && !defined(__arm64ec__)
+    if (sse2_supported) return sse2_wcscmp(str1, str2);
+#endif
     while (*str1 && (*str1 == *str2))
     {
         str1++;
@@ -2950,6 +3054,9 @@ wint_t CDECL towupper(wint_t c)
  */
 wchar_t* CDECL wcschr(const wchar_t *str, wchar_t ch)
 {
+#if defined(__x86_64__) && !defined(__arm64ec__)
+    if (sse2_supported && !((ULONG_PTR)str & 1)) return sse2_wcschr(str, ch);
+#endif
     do { if (*str == ch) return (WCHAR *)(ULONG_PTR)str; } while (*str++);
     return NULL;
 }
@@ -2970,6 +3077,14 @@ wchar_t* CDECL wcsrchr(const wchar_t *str, wchar_t ch)
 size_t CDECL wcslen(const wchar_t *str)
 {
     const wchar_t *s = str;
+
+#if defined(__x86_64__) && !defined(__arm64ec__)
+    if (!((ULONG_PTR)str & 1))
+    {
+        if (avx2_supported) return avx2_wcslen(str);
+        if (sse2_supported) return sse2_wcslen(str);
+    }
+#endif
     while (*s) s++;
     return s - str;
 }
@@ -3319,6 +3319,17 @@ NTSTATUS WINAPI __wine_ctrl_routine( void *arg )
 }
 
 
+/***********************************************************************
+ *              __wine_io_uring_routine
+ *
+ * Thread delivering the completions of the I/O submitted through io_uring.
+ */
+NTSTATUS WINAPI __wine_io_uring_routine( void *arg )
+{
+    RtlExitUserThread( WINE_UNIX_CALL( unix_io_uring_completions, arg ));
+}
+
+
 /***********************************************************************
  *           __wine_unix_spawnvp
  */
@@ -964,6 +964,105 @@ done:
     pRtlFreeUnicodeString(&ntdirname);
 }
 
+static NTSTATUS open_lookup_file( HANDLE dir, const WCHAR *name )
+{
+    OBJECT_ATTRIBUTES attr;
+    UNICODE_STRING nameW;
+    IO_STATUS_BLOCK io;
+    NTSTATUS status;
+    HANDLE handle;
+
+    pRtlInitUnicodeString( &nameW, name );
+    InitializeObjectAttributes( &attr, &nameW, OBJ_CASE_INSENSITIVE, dir, NULL );
+    status = pNtOpenFile( &handle, FILE_GENERIC_READ, &attr, &io, FILE_SHARE_READ | FILE_SHARE_DELETE,
+                          FILE_SYNCHRONOUS_IO_NONALERT | FILE_NON_DIRECTORY_FILE );
+    if (!status) pNtClose( handle );
+    return status;
+}
+
+static void create_lookup_file( const WCHAR *dir, const WCHAR *name )
+{
+    WCHAR path[MAX_PATH];
+    HANDLE handle;
+
+    swprintf( path, ARRAY_SIZE(path), L"%s\\%s", dir, name );
+    handle = CreateFileW( path, GENERIC_WRITE, 0, NULL, CREATE_NEW, 0, NULL );
+    ok( handle != INVALID_HANDLE_VALUE, "failed to create %s, error %lu\n", debugstr_w(path), GetLastError() );
+    CloseHandle( handle );
+}
+
+/* Wine keeps the listings of the directories it had to scan for case-insensitive
+ * lookups, they must follow the files created, renamed and deleted afterwards */
+static void test_case_insensitive_lookup(void)
+{
+    WCHAR dir[MAX_PATH], path[MAX_PATH], path2[MAX_PATH], name[16];
+    NTSTATUS status;
+    HANDLE dirh;
+    unsigned int i;
+
+    GetTempPathW( ARRAY_SIZE(dir), dir );
+    wcscat( dir, L"lookup.tmp" );
+    if (!CreateDirectoryW( dir, NULL ))
+    {
+        skip( "failed to create %s, error %lu\n", debugstr_w(dir), GetLastError() );
+        return;
+    }
+    for (i = 0; i < 64; i++)
+    {
+        swprintf( name, ARRAY_SIZE(name), L"file%u.txt", i );
+        create_lookup_file( dir, name );
+    }
+    create_lookup_file( dir, L"Lookup\x00c9.txt" );
+
+    dirh = CreateFileW( dir, FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                        NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL );
+    ok( dirh != INVALID_HANDLE_VALUE, "failed to open %s, error %lu\n", debugstr_w(dir), GetLastError() );
+
+    /* the listings of directories modified within the last second are not kept */
+    Sleep( 1100 );
+
+    status = open_lookup_file( dirh, L"lookup\x00e9.TXT" );
+    ok( !status, "got %#lx\n", status );
+    status = open_lookup_file( dirh, L"LOOKUP\x00c9.txt" );
+    ok( !status, "got %#lx\n", status );
+    status = open_lookup_file( dirh, L"FILE42.TXT" );
+    ok( !status, "got %#lx\n", status );
+    status = open_lookup_file( dirh, L"missing.txt" );
+    ok( status == STATUS_OBJECT_NAME_NOT_FOUND, "got %#lx\n", status );
+
+    swprintf( path, ARRAY_SIZE(path), L"%s\\Lookup\x00c9.txt", dir );
+    swprintf( path2, ARRAY_SIZE(path2), L"%s\\Renamed.txt", dir );
+    ok( MoveFileW( path, path2 ), "MoveFileW failed, error %lu\n", GetLastError() );
+
+    status = open_lookup_file( dirh, L"lookup\x00e9.TXT" );
+    ok( status == STATUS_OBJECT_NAME_NOT_FOUND, "got %#lx\n", status );
+    status = open_lookup_file( dirh, L"rENAMED.TXT" );
+    ok( !status, "got %#lx\n", status );
+
+    Sleep( 1100 );
+
+    status = open_lookup_file( dirh, L"RENAMED.txt" );
+    ok( !status, "got %#lx\n", status );
+
+    ok( DeleteFileW( path2 ), "DeleteFileW failed, error %lu\n", GetLastError() );
+    status = open_lookup_file( dirh, L"renamed.txt" );
+    ok( status == STATUS_OBJECT_NAME_NOT_FOUND, "got %#lx\n", status );
+
+    create_lookup_file( dir, L"Added.txt" );
+    status = open_lookup_file( dirh, L"aDDED.TXT" );
+    ok( !status, "got %#lx\n", status );
+
+    CloseHandle( dirh );
+    swprintf( path, ARRAY_SIZE(path), L"%s\\Added.txt", dir );
+    DeleteFileW( path );
+    for (i = 0; i < 64; i++)
+    {
+        swprintf( path, ARRAY_SIZE(path), L"%s\\file%u.txt", dir, i );
+        DeleteFileW( path );
+    }
+    ok( RemoveDirectoryW( dir ), "RemoveDirectoryW failed, error %lu\n", GetLastError() );
+}
+
 static NTSTATUS get_file_id( FILE_INTERNAL_INFORMATION *info, const WCHAR *root, const WCHAR *name )
 {
     OBJECT_ATTRIBUTES attr;
@@ -1157,5 +1256,6 @@ START_TEST(directory)
     test_directory_sort( sysdir );
     test_NtQueryDirectoryFile();
     test_NtQueryDirectoryFile_case();
+    test_case_insensitive_lookup();
     test_redirection();
 }
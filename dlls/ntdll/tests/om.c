@@ -3850,9 +3850,88 @@ static void test_NtAllocateReserveObject(void)
     }
 }
 
+static DWORD server_load_client( DWORD duration )
+{
+    UNICODE_STRING key_name = RTL_CONSTANT_STRING( L"\\Registry\\Machine\\Software\\Microsoft\\Windows NT\\CurrentVersion" );
+    UNICODE_STRING value_name = RTL_CONSTANT_STRING( L"ProductName" );
+    char buffer[sizeof(KEY_VALUE_PARTIAL_INFORMATION) + 256];
+    OBJECT_BASIC_INFORMATION info;
+    OBJECT_ATTRIBUTES attr;
+    HANDLE key, event, dup;
+    DWORD end, cycles = 0;
+    ULONG len;
+
+    InitializeObjectAttributes( &attr, &key_name, OBJ_CASE_INSENSITIVE, NULL, NULL );
+    if (NtOpenKey( &key, KEY_READ, &attr )) return 0;
+    event = CreateEventW( NULL, TRUE, FALSE, NULL );
+
+    /* a mix of registry, handle table and object requests, all served by the server */
+    for (end = GetTickCount() + duration; (LONG)(end - GetTickCount()) > 0; cycles++)
+    {
+        NtQueryValueKey( key, &value_name, KeyValuePartialInformation, buffer, sizeof(buffer), &len );
+        NtDuplicateObject( GetCurrentProcess(), event, GetCurrentProcess(), &dup, 0, 0, DUPLICATE_SAME_ACCESS );
+        NtQueryObject( dup, ObjectBasicInformation, &info, sizeof(info), &len );
+        NtClose( dup );
+        NtSetEvent( event, NULL );
+        NtResetEvent( event, NULL );
+    }
+
+    NtClose( event );
+    NtClose( key );
+    return cycles;
+}
+
+static double run_server_load( char **argv, unsigned int clients, DWORD duration )
+{
+    PROCESS_INFORMATION info[MAXIMUM_WAIT_OBJECTS];
+    STARTUPINFOA si = { sizeof(si) };
+    unsigned int i, started = 0;
+    char cmdline[MAX_PATH * 2];
+    DWORD code, total = 0;
+
+    sprintf( cmdline, "\"%s\" om server_load %lu", argv[0], duration );
+    for (i = 0; i < clients; i++)
+        if (CreateProcessA( NULL, cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &si, &info[started] )) started++;
+    ok( started == clients, "started %u clients out of %u\n", started, clients );
+
+    for (i = 0; i < started; i++)
+    {
+        WaitForSingleObject( info[i].hProcess, INFINITE );
+        GetExitCodeProcess( info[i].hProcess, &code );
+        total += code;
+        CloseHandle( info[i].hThread );
+        CloseHandle( info[i].hProcess );
+    }
+    return total * 6000.0 / duration;  /* six requests per cycle */
+}
+
+static void test_server_load( char **argv )
+{
+    static const unsigned int clients[] = { 1, 2, 4, 8, 16 };
+    const DWORD duration = 2000;
+    double base = 0, rate;
+    unsigned int i;
+
+    if (!winetest_interactive)
+    {
+        skip( "server load benchmark, set WINETEST_INTERACTIVE to run it\n" );
+        return;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(clients); i++)
+    {
+        rate = run_server_load( argv, clients[i], duration );
+        if (!i) base = rate;
+        trace( "%2u clients: %.0f requests/s, %.2fx the single client rate\n", clients[i], rate,
+               base ? rate / base : 0.0 );
+    }
+}
+
 START_TEST(om)
 {
     HMODULE hntdll = GetModuleHandleA("ntdll.dll");
+    char **argv;
+    int argc;
 
     pNtAllocateReserveObject= (void *)GetProcAddress(hntdll, "NtAllocateReserveObject");
     pNtCreateEvent          = (void *)GetProcAddress(hntdll, "NtCreateEvent");
@@ -3897,6 +3976,13 @@ START_TEST(om)
     pNtCompareObjects       =  (void *)GetProcAddress(hntdll, "NtCompareObjects");
     pNtOpenThread           =  (void *)GetProcAddress(hntdll, "NtOpenThread");
 
+    argc = winetest_get_mainargs( &argv );
+    if (argc >= 4 && !strcmp( argv[2], "server_load" ))
+    {
+        ExitProcess( server_load_client( atoi( argv[3] )));
+        return;
+    }
+
     test_null_in_object_name();
     test_case_sensitive();
     test_namespace_pipe();
@@ -3918,4 +4004,5 @@ START_TEST(om)
     test_object_permanence();
     test_zero_access();
     test_NtAllocateReserveObject();
+    test_server_load( argv );
 }
@@ -2429,6 +2429,107 @@ static void test_NtRenameKey(void)
     pNtClose(key);
 }
 
+static DWORD _get_cached_dword( int line, HANDLE key, NTSTATUS expect )
+{
+    char buffer[sizeof(KEY_VALUE_PARTIAL_INFORMATION) + sizeof(DWORD)];
+    KEY_VALUE_PARTIAL_INFORMATION *info = (KEY_VALUE_PARTIAL_INFORMATION *)buffer;
+    UNICODE_STRING str;
+    NTSTATUS status;
+    DWORD size;
+
+    pRtlInitUnicodeString( &str, L"value" );
+    status = pNtQueryValueKey( key, &str, KeyValuePartialInformation, buffer, sizeof(buffer), &size );
+    ok_(__FILE__, line)( status == expect, "got %#lx\n", status );
+    if (status) return 0;
+    ok_(__FILE__, line)( info->Type == REG_DWORD, "got type %lu\n", info->Type );
+    ok_(__FILE__, line)( info->DataLength == sizeof(DWORD), "got length %lu\n", info->DataLength );
+    return *(DWORD *)info->Data;
+}
+#define get_cached_dword(key,expect) _get_cached_dword( __LINE__, key, expect )
+
+static void test_cached_values(void)
+{
+    UNICODE_STRING str, str2, value_str;
+    OBJECT_ATTRIBUTES attr;
+    HANDLE root, key, key2;
+    NTSTATUS status;
+    DWORD data;
+
+    InitializeObjectAttributes( &attr, &winetestpath, 0, 0, 0 );
+    status = pNtCreateKey( &root, KEY_ALL_ACCESS, &attr, 0, 0, 0, 0 );
+    ok( !status, "got %#lx\n", status );
+
+    attr.RootDirectory = root;
+    attr.ObjectName = &str;
+    pRtlInitUnicodeString( &value_str, L"value" );
+    for (data = 1; data <= 2; data++)
+    {
+        pRtlInitUnicodeString( &str, data == 1 ? L"cached_a" : L"cached_b" );
+        status = pNtCreateKey( &key, KEY_ALL_ACCESS, &attr, 0, 0, 0, 0 );
+        ok( !status, "got %#lx\n", status );
+        status = pNtSetValueKey( key, &value_str, 0, REG_DWORD, &data, sizeof(data) );
+        ok( !status, "got %#lx\n", status );
+        pNtClose( key );
+    }
+
+    /* wineserver only shares the values of keys left unmodified for a few seconds */
+    Sleep( 5500 );
+
+    pRtlInitUnicodeString( &str, L"Cached_A" );
+    status = pNtOpenKey( &key, KEY_READ, &attr );
+    ok( !status, "got %#lx\n", status );
+    data = get_cached_dword( key, STATUS_SUCCESS );
+    ok( data == 1, "got %lu\n", data );
+
+    status = pNtOpenKey( &key2, KEY_ALL_ACCESS, &attr );
+    ok( !status, "got %#lx\n", status );
+    data = 3;
+    status = pNtSetValueKey( key2, &value_str, 0, REG_DWORD, &data, sizeof(data) );
+    ok( !status, "got %#lx\n", status );
+    data = get_cached_dword( key, STATUS_SUCCESS );
+    ok( data == 3, "got %lu\n", data );
+
+    status = pNtDeleteKey( key2 );
+    ok( !status, "got %#lx\n", status );
+    pNtClose( key2 );
+    get_cached_dword( key, STATUS_KEY_DELETED );
+    pNtClose( key );
+
+    status = pNtOpenKey( &key, KEY_READ, &attr );
+    ok( status == STATUS_OBJECT_NAME_NOT_FOUND, "got %#lx\n", status );
+
+    /* the new handle may reuse the value of the closed one */
+    pRtlInitUnicodeString( &str, L"CACHED_B" );
+    status = pNtOpenKey( &key, KEY_READ, &attr );
+    ok( !status, "got %#lx\n", status );
+    data = get_cached_dword( key, STATUS_SUCCESS );
+    ok( data == 2, "got %lu\n", data );
+
+    status = pNtOpenKey( &key2, KEY_WRITE | DELETE, &attr );
+    ok( !status, "got %#lx\n", status );
+    pRtlInitUnicodeString( &str2, L"cached_c" );
+    status = NtRenameKey( key2, &str2 );
+    ok( !status, "got %#lx\n", status );
+    data = get_cached_dword( key, STATUS_SUCCESS );
+    ok( data == 2, "got %lu\n", data );
+    pNtClose( key );
+
+    status = pNtOpenKey( &key, KEY_READ, &attr );
+    ok( status == STATUS_OBJECT_NAME_NOT_FOUND, "got %#lx\n", status );
+
+    attr.ObjectName = &str2;
+    status = pNtOpenKey( &key, KEY_READ, &attr );
+    ok( !status, "got %#lx\n", status );
+    data = get_cached_dword( key, STATUS_SUCCESS );
+    ok( data == 2, "got %lu\n", data );
+    pNtClose( key );
+
+    pNtDeleteKey( key2 );
+    pNtClose( key2 );
+    pNtDeleteKey( root );
+    pNtClose( root );
+}
+
 static BOOL set_privileges(LPCSTR privilege, BOOL set)
 {
     TOKEN_PRIVILEGES tp;
@@ -3104,6 +3205,7 @@ START_TEST(reg)
     test_symlinks();
     test_redirection();
     test_NtRenameKey();
+    test_cached_values();
     test_NtRegLoadKeyEx();
     test_RtlQueryRegistryValues();
 
@@ -1030,6 +1030,213 @@ static void test_completion_port_scheduling(void)
     }
 }
 
+struct inproc_sync_param
+{
+    HANDLE object;
+    HANDLE ready;
+    DWORD  timeout;
+    DWORD  result;
+};
+
+static DWORD WINAPI inproc_sync_wait_thread( void *arg )
+{
+    struct inproc_sync_param *param = arg;
+
+    SetEvent( param->ready );
+    param->result = WaitForSingleObject( param->object, param->timeout );
+    return 0;
+}
+
+static DWORD WINAPI inproc_sync_abandon_thread( void *arg )
+{
+    struct inproc_sync_param *param = arg;
+
+    param->result = WaitForSingleObject( param->object, 0 );
+    SetEvent( param->ready );
+    Sleep( 100 );
+    return 0;
+}
+
+static HANDLE start_inproc_sync_waiter( struct inproc_sync_param *param, HANDLE object, DWORD timeout )
+{
+    HANDLE thread;
+    DWORD ret;
+
+    param->object = object;
+    param->timeout = timeout;
+    param->result = 0xdeadbeef;
+    thread = CreateThread( NULL, 0, inproc_sync_wait_thread, param, 0, NULL );
+    ret = WaitForSingleObject( param->ready, 1000 );
+    ok( ret == WAIT_OBJECT_0, "got %lu\n", ret );
+    /* give the thread time to go to sleep on the object */
+    Sleep( 100 );
+    return thread;
+}
+
+static void inproc_sync_child(void)
+{
+    HANDLE event, reply, mutant;
+    DWORD ret;
+
+    event = OpenEventA( SYNCHRONIZE | EVENT_MODIFY_STATE, FALSE, "test_inproc_sync_event" );
+    ok( !!event, "OpenEvent failed %lu\n", GetLastError() );
+    reply = OpenEventA( EVENT_MODIFY_STATE, FALSE, "test_inproc_sync_reply" );
+    ok( !!reply, "OpenEvent failed %lu\n", GetLastError() );
+    mutant = OpenMutexA( SYNCHRONIZE, FALSE, "test_inproc_sync_mutant" );
+    ok( !!mutant, "OpenMutex failed %lu\n", GetLastError() );
+
+    /* the parent signals its event in process while we wait in the server */
+    SetEvent( reply );
+    ret = WaitForSingleObject( event, 5000 );
+    ok( ret == WAIT_OBJECT_0, "got %lu\n", ret );
+
+    /* and waits in process while we signal it through the server */
+    SetEvent( reply );
+
+    /* exit while owning the mutex */
+    ret = WaitForSingleObject( mutant, 5000 );
+    ok( ret == WAIT_OBJECT_0, "got %lu\n", ret );
+
+    CloseHandle( event );
+    CloseHandle( reply );
+}
+
+/* exercise the paths that WINEINPROCSYNC moves out of the server */
+static void test_inproc_sync( char **argv )
+{
+    struct inproc_sync_param param, param2;
+    SEMAPHORE_BASIC_INFORMATION info;
+    STARTUPINFOA si = {sizeof(si)};
+    HANDLE event, reply, mutant, semaphore, objects[2];
+    HANDLE thread, thread2;
+    PROCESS_INFORMATION pi;
+    char cmdline[MAX_PATH];
+    NTSTATUS status;
+    ULONG prev;
+    DWORD ret;
+
+    param.ready = CreateEventA( NULL, FALSE, FALSE, NULL );
+    param2.ready = CreateEventA( NULL, FALSE, FALSE, NULL );
+
+    /* pulsing an event releases all the waiters of a manual-reset event, a single one otherwise */
+    event = CreateEventA( NULL, TRUE, FALSE, NULL );
+    thread = start_inproc_sync_waiter( &param, event, 5000 );
+    thread2 = start_inproc_sync_waiter( &param2, event, 5000 );
+    status = pNtPulseEvent( event, NULL );
+    ok( !status, "got %#lx\n", status );
+    ret = WaitForSingleObject( thread, 1000 );
+    ok( ret == WAIT_OBJECT_0, "got %lu\n", ret );
+    ok( param.result == WAIT_OBJECT_0, "got %lu\n", param.result );
+    ret = WaitForSingleObject( thread2, 1000 );
+    ok( ret == WAIT_OBJECT_0, "got %lu\n", ret );
+    ok( param2.result == WAIT_OBJECT_0, "got %lu\n", param2.result );
+    ret = WaitForSingleObject( event, 0 );
+    ok( ret == WAIT_TIMEOUT, "got %lu\n", ret );
+    CloseHandle( thread );
+    CloseHandle( thread2 );
+    CloseHandle( event );
+
+    event = CreateEventA( NULL, FALSE, FALSE, NULL );
+    thread = start_inproc_sync_waiter( &param, event, 1000 );
+    thread2 = start_inproc_sync_waiter( &param2, event, 1000 );
+    status = pNtPulseEvent( event, NULL );
+    ok( !status, "got %#lx\n", status );
+    ret = WaitForSingleObject( thread, 2000 );
+    ok( ret == WAIT_OBJECT_0, "got %lu\n", ret );
+    ret = WaitForSingleObject( thread2, 2000 );
+    ok( ret == WAIT_OBJECT_0, "got %lu\n", ret );
+    ok( (param.result == WAIT_OBJECT_0 && param2.result == WAIT_TIMEOUT) ||
+        (param.result == WAIT_TIMEOUT && param2.result == WAIT_OBJECT_0),
+        "got %lu, %lu\n", param.result, param2.result );
+    CloseHandle( thread );
+    CloseHandle( thread2 );
+
+    /* wait-all only takes the objects once all of them are signaled */
+    semaphore = CreateSemaphoreA( NULL, 1, 2, NULL );
+    objects[0] = event;
+    objects[1] = semaphore;
+    ret = WaitForMultipleObjects( 2, objects, TRUE, 0 );
+    ok( ret == WAIT_TIMEOUT, "got %lu\n", ret );
+    status = pNtQuerySemaphore( semaphore, SemaphoreBasicInformation, &info, sizeof(info), NULL );
+    ok( !status, "got %#lx\n", status );
+    ok( info.CurrentCount == 1, "got %ld\n", info.CurrentCount );
+    SetEvent( event );
+    ret = WaitForMultipleObjects( 2, objects, TRUE, 0 );
+    ok( ret == WAIT_OBJECT_0, "got %lu\n", ret );
+    status = pNtQuerySemaphore( semaphore, SemaphoreBasicInformation, &info, sizeof(info), NULL );
+    ok( !status, "got %#lx\n", status );
+    ok( info.CurrentCount == 0, "got %ld\n", info.CurrentCount );
+    ret = WaitForSingleObject( event, 0 );
+    ok( ret == WAIT_TIMEOUT, "got %lu\n", ret );
+
+    /* the semaphore limit holds while threads wait on it */
+    thread = start_inproc_sync_waiter( &param, semaphore, 5000 );
+    thread2 = start_inproc_sync_waiter( &param2, semaphore, 5000 );
+    status = pNtReleaseSemaphore( semaphore, 3, &prev );
+    ok( status == STATUS_SEMAPHORE_LIMIT_EXCEEDED, "got %#lx\n", status );
+    status = pNtReleaseSemaphore( semaphore, 2, &prev );
+    ok( !status, "got %#lx\n", status );
+    ok( !prev, "got %lu\n", prev );
+    ret = WaitForSingleObject( thread, 1000 );
+    ok( ret == WAIT_OBJECT_0, "got %lu\n", ret );
+    ok( param.result == WAIT_OBJECT_0, "got %lu\n", param.result );
+    ret = WaitForSingleObject( thread2, 1000 );
+    ok( ret == WAIT_OBJECT_0, "got %lu\n", ret );
+    ok( param2.result == WAIT_OBJECT_0, "got %lu\n", param2.result );
+    CloseHandle( thread );
+    CloseHandle( thread2 );
+    status = pNtReleaseSemaphore( semaphore, 2, &prev );
+    ok( !status, "got %#lx\n", status );
+    status = pNtReleaseSemaphore( semaphore, 1, &prev );
+    ok( status == STATUS_SEMAPHORE_LIMIT_EXCEEDED, "got %#lx\n", status );
+    status = pNtQuerySemaphore( semaphore, SemaphoreBasicInformation, &info, sizeof(info), NULL );
+    ok( !status, "got %#lx\n", status );
+    ok( info.CurrentCount == 2, "got %ld\n", info.CurrentCount );
+    CloseHandle( semaphore );
+    CloseHandle( event );
+
+    /* a thread waiting on a mutex is woken up when its owner dies */
+    mutant = CreateMutexA( NULL, FALSE, NULL );
+    thread = CreateThread( NULL, 0, inproc_sync_abandon_thread, &param, 0, NULL );
+    ret = WaitForSingleObject( param.ready, 1000 );
+    ok( ret == WAIT_OBJECT_0, "got %lu\n", ret );
+    ok( param.result == WAIT_OBJECT_0, "got %lu\n", param.result );
+    ret = WaitForSingleObject( mutant, 5000 );
+    ok( ret == WAIT_ABANDONED_0, "got %lu\n", ret );
+    ReleaseMutex( mutant );
+    WaitForSingleObject( thread, 1000 );
+    CloseHandle( thread );
+    CloseHandle( mutant );
+
+    /* another process waits and signals through the server */
+    event = CreateEventA( NULL, FALSE, FALSE, "test_inproc_sync_event" );
+    reply = CreateEventA( NULL, FALSE, FALSE, "test_inproc_sync_reply" );
+    mutant = CreateMutexA( NULL, FALSE, "test_inproc_sync_mutant" );
+    sprintf( cmdline, "%s %s inproc_sync", argv[0], argv[1] );
+    ret = CreateProcessA( NULL, cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi );
+    ok( ret, "failed to create process, error %lu\n", GetLastError() );
+
+    ret = WaitForSingleObject( reply, 5000 );
+    ok( ret == WAIT_OBJECT_0, "got %lu\n", ret );
+    Sleep( 100 );
+    SetEvent( event );
+    ret = WaitForSingleObject( reply, 5000 );
+    ok( ret == WAIT_OBJECT_0, "got %lu\n", ret );
+
+    wait_child_process( pi.hProcess );
+    ret = WaitForSingleObject( mutant, 1000 );
+    ok( ret == WAIT_ABANDONED_0, "got %lu\n", ret );
+    ReleaseMutex( mutant );
+
+    CloseHandle( pi.hProcess );
+    CloseHandle( pi.hThread );
+    CloseHandle( mutant );
+    CloseHandle( reply );
+    CloseHandle( event );
+    CloseHandle( param.ready );
+    CloseHandle( param2.ready );
+}
+
 START_TEST(sync)
 {
     HMODULE module = GetModuleHandleA("ntdll.dll");
@@ -1038,7 +1245,11 @@ START_TEST(sync)
 
     argc = winetest_get_mainargs( &argv );
 
-    if (argc > 2) return;
+    if (argc > 2)
+    {
+        if (!strcmp( argv[2], "inproc_sync" )) inproc_sync_child();
+        return;
+    }
 
     pNtAlertThreadByThreadId        = (void *)GetProcAddress(module, "NtAlertThreadByThreadId");
     pNtClose                        = (void *)GetProcAddress(module, "NtClose");
@@ -1078,4 +1289,5 @@ START_TEST(sync)
     test_resource();
     test_tid_alert( argv );
     test_completion_port_scheduling();
+    test_inproc_sync( argv );
 }
@@ -52,6 +52,10 @@
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <sys/ioctl.h>
+#ifdef HAVE_LINUX_IO_URING_H
+# include <sys/mman.h>
+# include <linux/io_uring.h>
+#endif
 #ifdef HAVE_SYS_ATTR_H
 #include <sys/attr.h>
 #endif
@@ -124,6 +128,7 @@
 
 WINE_DEFAULT_DEBUG_CHANNEL(file);
 WINE_DECLARE_DEBUG_CHANNEL(winediag);
+WINE_DECLARE_DEBUG_CHANNEL(dircache);
 
 #define MAX_DOS_DRIVES 26
 
@@ -217,6 +222,14 @@ struct dir_data_names
     const char  *unix_name;          /* Unix file name in host encoding */
 };
 
+struct dir_data_info
+{
+    struct stat             st;      /* file stat info */
+    ULONG                   attributes; /* file attributes */
+    int                     ret;     /* result of read_file_info */
+    int                     xattr_error; /* error reading the DOS attributes */
+};
+
 struct dir_data
 {
     unsigned int            size;    /* size of the names array */
@@ -225,6 +238,20 @@ struct dir_data
     struct file_identity    id;      /* directory file identity */
     struct dir_data_names  *names;   /* directory file names */
     struct dir_data_buffer *buffer;  /* head of data buffers list */
+    struct dir_snapshot    *snapshot; /* shared snapshot holding the names, if any */
+    struct dir_data_info   *info;    /* file info fetched ahead for the current query */
+    unsigned int            info_size;  /* size of the info array */
+    unsigned int            info_start; /* index of the name of the first info entry */
+    unsigned int            info_count; /* count of valid entries in the info array */
+};
+
+/* sorted contents of a directory, shared by all the handles listing it */
+struct dir_snapshot
+{
+    struct list             entry;   /* entry in the snapshot cache, most recently used first */
+    unsigned int            refcount; /* references from the cache and from directory handles */
+    ULONGLONG               mtime;   /* directory modification time when it was read */
+    struct dir_data        *data;    /* complete directory contents */
 };
 
 static const unsigned int dir_data_buffer_initial_size = 4096;
@@ -234,6 +261,68 @@ static const unsigned int dir_data_names_initial_size  = 64;
 static struct dir_data **dir_data_cache;
 static unsigned int dir_data_cache_size;
 
+#define MAX_DIR_SNAPSHOTS      16
+#define MAX_DIR_SNAPSHOT_NAMES 262144
+
+static struct list dir_snapshots = LIST_INIT( dir_snapshots );
+static unsigned int dir_snapshot_count;
+static unsigned int dir_snapshot_names;
+
+/* threads fetching the file info of directory entries ahead of NtQueryDirectoryFile */
+#define DIR_INFO_THREADS      4
+#define DIR_INFO_MIN_BATCH    32
+#define DIR_INFO_IDLE_TIMEOUT 10  /* seconds before an idle thread exits */
+
+static struct
+{
+    pthread_mutex_t               mutex;
+    pthread_cond_t                start_cond;  /* signaled when a new batch is posted */
+    pthread_cond_t                done_cond;   /* signaled when all threads are done with a batch */
+    unsigned int                  threads;     /* count of running threads */
+    unsigned int                  pending;     /* threads still working on the batch */
+    unsigned int                  generation;  /* incremented for each batch */
+    LONG                          next;        /* next entry to fetch */
+    unsigned int                  count;       /* count of entries in the batch */
+    const struct dir_data_names  *names;       /* names of the batch */
+    struct dir_data_info         *info;        /* info of the batch */
+} dir_info_pool = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER };
+
+/* directory listings kept for case-insensitive lookups */
+struct dir_lookup_name
+{
+    unsigned int            hash;    /* hash of the case-folded long name */
+    unsigned int            next;    /* next name in the hash chain, ~0u at the end */
+    unsigned int            len;     /* length of the long name in chars */
+    const WCHAR            *long_name; /* long file name in Unicode */
+    const char             *unix_name; /* Unix file name in host encoding */
+};
+
+struct dir_lookup
+{
+    struct list             entry;   /* entry in the lookup cache, most recently used first */
+    struct file_identity    id;      /* directory file identity */
+    ULONGLONG               mtime;   /* directory modification time when it was read */
+    unsigned int            count;   /* count of names */
+    unsigned int            hash_size; /* size of the hash table, a power of 2 */
+    unsigned int           *hash;    /* first name of each hash chain */
+    struct dir_lookup_name *names;   /* directory file names */
+    char                   *data;    /* storage for the names */
+};
+
+#define MAX_DIR_LOOKUP_CACHE 32
+
+static struct list dir_lookup_cache = LIST_INIT( dir_lookup_cache );
+static unsigned int dir_lookup_cache_count;
+static unsigned int dir_lookup_hits, dir_lookup_misses, dir_lookup_reads, dir_lookup_stale;
+
+/* per handle cache of whether a completion port is bound to the file, for the io_uring path;
+ * a bound port can't be removed, but an unbound entry is stale once a port is bound in the process */
+#define IO_URING_PORT_CACHE_BLOCK_SIZE  (65536 / sizeof(LONG))
+#define IO_URING_PORT_CACHE_ENTRIES     128
+
+static LONG *io_uring_port_cache[IO_URING_PORT_CACHE_ENTRIES];
+static LONG io_uring_port_generation;
+
 static BOOL show_dot_files;
 static mode_t start_umask;
 
@@ -242,6 +331,7 @@ static const BOOL is_case_sensitive = FALSE;
 
 static pthread_mutex_t dir_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_mutex_t mnt_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t dir_lookup_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 /* check if a given Unicode char is OK in a DOS short name */
 static inline BOOL is_invalid_dos_char( WCHAR ch )
@@ -552,6 +642,8 @@ static BOOL add_dir_data_names( struct dir_data *data, const WCHAR *long_name,
     return TRUE;
 }
 
+static void release_dir_snapshot( struct dir_snapshot *snapshot );
+
 /* free the complete directory data structure */
 static void free_dir_data( struct dir_data *data )
 {
@@ -564,10 +656,32 @@ static void free_dir_data( struct dir_data *data )
         next = buffer->next;
         free( buffer );
     }
+    if (data->snapshot) release_dir_snapshot( data->snapshot );
+    free( data->info );
     free( data->names );
     free( data );
 }
 
+/* release a reference to a shared directory snapshot */
+static void release_dir_snapshot( struct dir_snapshot *snapshot )
+{
+    if (--snapshot->refcount) return;
+    free_dir_data( snapshot->data );
+    free( snapshot );
+}
+
+/* get the modification time of a directory, used to check that its cached contents are still valid */
+static ULONGLONG get_dir_mtime( const struct stat *st )
+{
+    ULONGLONG mtime = ticks_from_time_t( st->st_mtime );
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    mtime += st->st_mtim.tv_nsec / 100;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+    mtime += st->st_mtimespec.tv_nsec / 100;
+#endif
+    return mtime;
+}
+
 
 /* support for a directory queue for filesystem searches */
 
@@ -1731,14 +1845,16 @@ static NTSTATUS fd_set_file_info( int fd, UINT attr, BOOL force_set_xattr )
 }
 
 
-/* get the stat info and file attributes for a file (by name) */
-static int get_file_info( const char *path, struct stat *st, ULONG *attr )
+/* get the stat info and file attributes for a file (by name), without any debug output;
+ * a failure to read the DOS attributes is returned in xattr_error */
+static int read_file_info( const char *path, struct stat *st, ULONG *attr, int *xattr_error )
 {
     char *parent_path;
     char attr_data[65];
     int attr_len, ret;
 
     *attr = 0;
+    *xattr_error = 0;
     ret = lstat( path, st );
     if (ret == -1) return ret;
     if (S_ISLNK( st->st_mode ))
@@ -1777,12 +1893,26 @@ static int get_file_info( const char *path, struct stat *st, ULONG *attr )
 #ifdef ENOATTR
         if (errno == ENOATTR) return ret;
 #endif
-        WARN( "Failed to get extended attribute " SAMBA_XATTR_DOS_ATTRIB " from %s. errno %d (%s)\n",
-              debugstr_a(path), errno, strerror( errno ) );
+        *xattr_error = errno;
     }
     return ret;
 }
 
+static void warn_file_info_xattr( const char *path, int xattr_error )
+{
+    WARN( "Failed to get extended attribute " SAMBA_XATTR_DOS_ATTRIB " from %s. errno %d (%s)\n",
+          debugstr_a(path), xattr_error, strerror( xattr_error ) );
+}
+
+/* get the stat info and file attributes for a file (by name) */
+static int get_file_info( const char *path, struct stat *st, ULONG *attr )
+{
+    int xattr_error, ret = read_file_info( path, st, attr, &xattr_error );
+
+    if (xattr_error) warn_file_info_xattr( path, xattr_error );
+    return ret;
+}
+
 
 #if defined(__ANDROID__) && !defined(HAVE_FUTIMENS)
 static int futimens( int fd, const struct timespec spec[2] )
@@ -2312,8 +2442,20 @@ static NTSTATUS get_dir_data_entry( struct dir_data *dir_data, void *info_ptr, I
     union file_directory_info *info;
     struct stat st;
     ULONG name_len, start, dir_size, attributes;
+    int ret;
 
-    if (get_file_info( names->unix_name, &st, &attributes ) == -1)
+    if (dir_data->pos - dir_data->info_start < dir_data->info_count)
+    {
+        const struct dir_data_info *file_info = &dir_data->info[dir_data->pos - dir_data->info_start];
+
+        st = file_info->st;
+        attributes = file_info->attributes;
+        ret = file_info->ret;
+        if (file_info->xattr_error) warn_file_info_xattr( names->unix_name, file_info->xattr_error );
+    }
+    else ret = get_file_info( names->unix_name, &st, &attributes );
+
+    if (ret == -1)
     {
         TRACE( "file no longer exists %s\n", debugstr_a(names->unix_name) );
         return STATUS_SUCCESS;
@@ -2543,6 +2685,131 @@ done:
 }
 
 
+/* compare file names for directory sorting */
+static int name_compare( const void *a, const void *b )
+{
+    const struct dir_data_names *file_a = (const struct dir_data_names *)a;
+    const struct dir_data_names *file_b = (const struct dir_data_names *)b;
+    int ret = wcsicmp( file_a->long_name, file_b->long_name );
+    if (!ret) ret = wcscmp( file_a->long_name, file_b->long_name );
+    return ret;
+}
+
+
+/* sort filenames, but not "." and ".." */
+static void sort_dir_data_names( struct dir_data *data )
+{
+    unsigned int i = 0;
+
+    if (i < data->count && !strcmp( data->names[i].unix_name, "." )) i++;
+    if (i < data->count && !strcmp( data->names[i].unix_name, ".." )) i++;
+    if (i < data->count) qsort( data->names + i, data->count - i, sizeof(*data->names), name_compare );
+}
+
+
+/***********************************************************************
+ *           get_dir_snapshot
+ *
+ * Get the shared snapshot of the current directory, reading it if necessary.
+ */
+static struct dir_snapshot *get_dir_snapshot( int fd, const struct stat *st )
+{
+    struct dir_snapshot *snapshot;
+    struct stat after;
+
+    LIST_FOR_EACH_ENTRY( snapshot, &dir_snapshots, struct dir_snapshot, entry )
+    {
+        if (snapshot->data->id.dev != st->st_dev || snapshot->data->id.ino != st->st_ino) continue;
+        list_remove( &snapshot->entry );
+        if (snapshot->mtime == get_dir_mtime( st ))
+        {
+            TRACE( "reusing %u files\n", snapshot->data->count );
+            list_add_head( &dir_snapshots, &snapshot->entry );
+            snapshot->refcount++;
+            return snapshot;
+        }
+        dir_snapshot_count--;
+        dir_snapshot_names -= snapshot->data->count;
+        release_dir_snapshot( snapshot );
+        break;
+    }
+
+    /* a directory modified within the timestamp granularity may change again without a new mtime */
+    if (st->st_mtime >= time( NULL ) - 1) return NULL;
+
+    if (!(snapshot = calloc( 1, sizeof(*snapshot) ))) return NULL;
+    if (!(snapshot->data = calloc( 1, sizeof(*snapshot->data) ))) goto error;
+    if (read_directory_data_readdir( snapshot->data, NULL )) goto error;
+
+    /* the directory changed while we were reading it */
+    if (fstat( fd, &after ) == -1 || get_dir_mtime( &after ) != get_dir_mtime( st )) goto error;
+
+    sort_dir_data_names( snapshot->data );
+    snapshot->data->id.dev = st->st_dev;
+    snapshot->data->id.ino = st->st_ino;
+    snapshot->mtime = get_dir_mtime( st );
+    snapshot->refcount = 2;
+
+    list_add_head( &dir_snapshots, &snapshot->entry );
+    dir_snapshot_count++;
+    dir_snapshot_names += snapshot->data->count;
+    while (dir_snapshot_count > 1 && (dir_snapshot_count > MAX_DIR_SNAPSHOTS ||
+                                      dir_snapshot_names > MAX_DIR_SNAPSHOT_NAMES))
+    {
+        struct dir_snapshot *oldest = LIST_ENTRY( list_tail( &dir_snapshots ), struct dir_snapshot, entry );
+
+        list_remove( &oldest->entry );
+        dir_snapshot_count--;
+        dir_snapshot_names -= oldest->data->count;
+        release_dir_snapshot( oldest );
+    }
+    return snapshot;
+
+error:
+    free_dir_data( snapshot->data );
+    free( snapshot );
+    return NULL;
+}
+
+
+/***********************************************************************
+ *           read_directory_data_snapshot
+ *
+ * Get the directory contents from the shared snapshot; helper for NtQueryDirectoryFile.
+ */
+static NTSTATUS read_directory_data_snapshot( struct dir_data *data, int fd, const UNICODE_STRING *mask )
+{
+    struct dir_snapshot *snapshot;
+    struct stat st;
+    unsigned int i;
+
+    if (fstat( fd, &st ) == -1) return STATUS_NOT_SUPPORTED;
+    if (!(snapshot = get_dir_snapshot( fd, &st ))) return STATUS_NOT_SUPPORTED;
+
+    /* the names stay in the snapshot, only the entries matching the mask are referenced */
+    if (!(data->names = malloc( max( snapshot->data->count, 1 ) * sizeof(*data->names) )))
+    {
+        release_dir_snapshot( snapshot );
+        return STATUS_NO_MEMORY;
+    }
+    data->size = max( snapshot->data->count, 1 );
+    data->snapshot = snapshot;
+
+    for (i = 0; i < snapshot->data->count; i++)
+    {
+        const struct dir_data_names *names = &snapshot->data->names[i];
+
+        if (mask && !match_filename( names->long_name, wcslen( names->long_name ), mask ))
+        {
+            if (!names->short_name[0]) continue;  /* no short name to match */
+            if (!match_filename( names->short_name, wcslen( names->short_name ), mask )) continue;
+        }
+        data->names[data->count++] = *names;
+    }
+    return STATUS_SUCCESS;
+}
+
+
 /***********************************************************************
  *           read_directory_data
  *
@@ -2572,21 +2839,11 @@ static NTSTATUS read_directory_data( struct dir_data *data, int fd, const UNICOD
         }
     }
 
+    if (!(status = read_directory_data_snapshot( data, fd, mask ))) return status;
     return read_directory_data_readdir( data, mask );
 }
 
 
-/* compare file names for directory sorting */
-static int name_compare( const void *a, const void *b )
-{
-    const struct dir_data_names *file_a = (const struct dir_data_names *)a;
-    const struct dir_data_names *file_b = (const struct dir_data_names *)b;
-    int ret = wcsicmp( file_a->long_name, file_b->long_name );
-    if (!ret) ret = wcscmp( file_a->long_name, file_b->long_name );
-    return ret;
-}
-
-
 /***********************************************************************
  *           init_cached_dir_data
  *
@@ -2607,11 +2864,8 @@ static NTSTATUS init_cached_dir_data( struct dir_data **data_ret, int fd, const
         return status;
     }
 
-    /* sort filenames, but not "." and ".." */
-    i = 0;
-    if (i < data->count && !strcmp( data->names[i].unix_name, "." )) i++;
-    if (i < data->count && !strcmp( data->names[i].unix_name, ".." )) i++;
-    if (i < data->count) qsort( data->names + i, data->count - i, sizeof(*data->names), name_compare );
+    /* snapshot names are already sorted */
+    if (!data->snapshot) sort_dir_data_names( data );
 
     if (data->count)
     {
@@ -2683,6 +2937,139 @@ static unsigned int get_cached_dir_data( HANDLE handle, struct dir_data **data_r
 }
 
 
+/* fetch the file info of the entries of the current batch, until there are none left */
+static void fetch_dir_info_batch(void)
+{
+    unsigned int i;
+
+    while ((i = InterlockedIncrement( &dir_info_pool.next ) - 1) < dir_info_pool.count)
+    {
+        struct dir_data_info *info = &dir_info_pool.info[i];
+        info->ret = read_file_info( dir_info_pool.names[i].unix_name, &info->st,
+                                    &info->attributes, &info->xattr_error );
+    }
+}
+
+/* thread fetching file info; it has no TEB, so it must not use debug output or anything else needing one.
+ * It exits once it has been idle for DIR_INFO_IDLE_TIMEOUT seconds. */
+static void *dir_info_thread( void *arg )
+{
+    unsigned int generation = (UINT_PTR)arg;
+    struct timespec timeout;
+
+    for (;;)
+    {
+        pthread_mutex_lock( &dir_info_pool.mutex );
+        clock_gettime( CLOCK_REALTIME, &timeout );
+        timeout.tv_sec += DIR_INFO_IDLE_TIMEOUT;
+        while (dir_info_pool.generation == generation)
+        {
+            if (pthread_cond_timedwait( &dir_info_pool.start_cond, &dir_info_pool.mutex, &timeout ) == ETIMEDOUT &&
+                dir_info_pool.generation == generation)
+            {
+                dir_info_pool.threads--;
+                pthread_mutex_unlock( &dir_info_pool.mutex );
+                return NULL;
+            }
+        }
+        generation = dir_info_pool.generation;
+        pthread_mutex_unlock( &dir_info_pool.mutex );
+
+        fetch_dir_info_batch();
+
+        pthread_mutex_lock( &dir_info_pool.mutex );
+        if (!--dir_info_pool.pending) pthread_cond_signal( &dir_info_pool.done_cond );
+        pthread_mutex_unlock( &dir_info_pool.mutex );
+    }
+}
+
+/* start the missing info threads; must be called with the pool mutex held */
+static void start_dir_info_threads(void)
+{
+    static unsigned int max_threads = ~0u;
+    pthread_attr_t attr;
+    pthread_t thread;
+    sigset_t sigset, old_sigset;
+
+    if (max_threads == ~0u)
+    {
+        long cpus = sysconf( _SC_NPROCESSORS_ONLN );
+        max_threads = cpus > 1 ? min( cpus - 1, DIR_INFO_THREADS ) : 0;
+    }
+    if (dir_info_pool.threads >= max_threads) return;
+
+    /* keep all signals blocked in the threads, our handlers need a TEB */
+    sigfillset( &sigset );
+    pthread_sigmask( SIG_SETMASK, &sigset, &old_sigset );
+    pthread_attr_init( &attr );
+    pthread_attr_setstacksize( &attr, 0x40000 );
+    pthread_attr_setdetachstate( &attr, PTHREAD_CREATE_DETACHED );
+    /* the threads wait for the batch following the current generation */
+    while (dir_info_pool.threads < max_threads &&
+           !pthread_create( &thread, &attr, dir_info_thread, (void *)(UINT_PTR)dir_info_pool.generation ))
+        dir_info_pool.threads++;
+    pthread_attr_destroy( &attr );
+    pthread_sigmask( SIG_SETMASK, &old_sigset, NULL );
+}
+
+
+/***********************************************************************
+ *           prefetch_dir_data_info
+ *
+ * Fetch in parallel the file info of the entries that fit in the caller's buffer,
+ * instead of reading them one at a time in get_dir_data_entry.
+ * Must be called with dir_mutex held, the names are relative to the current directory;
+ * the threads are done with the batch before it returns, so before the directory is restored.
+ */
+static void prefetch_dir_data_info( struct dir_data *data, ULONG length, FILE_INFORMATION_CLASS class )
+{
+    unsigned int count, size = 0;
+
+    data->info_count = 0;
+
+    for (count = 0; data->pos + count < data->count; count++)
+    {
+        const struct dir_data_names *names = &data->names[data->pos + count];
+        size += dir_info_align( dir_info_size( class, wcslen( names->long_name ) ));
+        if (size > length) break;
+    }
+    if (count < DIR_INFO_MIN_BATCH) return;
+
+    if (count > data->info_size)
+    {
+        struct dir_data_info *info = realloc( data->info, count * sizeof(*info) );
+        if (!info) return;
+        data->info = info;
+        data->info_size = count;
+    }
+
+    pthread_mutex_lock( &dir_info_pool.mutex );
+    start_dir_info_threads();
+    if (!dir_info_pool.threads)
+    {
+        pthread_mutex_unlock( &dir_info_pool.mutex );
+        return;
+    }
+    dir_info_pool.names   = data->names + data->pos;
+    dir_info_pool.info    = data->info;
+    dir_info_pool.count   = count;
+    dir_info_pool.next    = 0;
+    dir_info_pool.pending = dir_info_pool.threads;
+    dir_info_pool.generation++;
+    pthread_cond_broadcast( &dir_info_pool.start_cond );
+    pthread_mutex_unlock( &dir_info_pool.mutex );
+
+    fetch_dir_info_batch();
+
+    pthread_mutex_lock( &dir_info_pool.mutex );
+    while (dir_info_pool.pending) pthread_cond_wait( &dir_info_pool.done_cond, &dir_info_pool.mutex );
+    pthread_mutex_unlock( &dir_info_pool.mutex );
+
+    data->info_start = data->pos;
+    data->info_count = count;
+}
+
+
 /******************************************************************************
  *              NtQueryDirectoryFile   (NTDLL.@)
  */
@@ -2752,6 +3139,7 @@ NTSTATUS WINAPI NtQueryDirectoryFile( HANDLE handle, HANDLE event, PIO_APC_ROUTI
             union file_directory_info *last_info = NULL;
 
             if (restart_scan) data->pos = 0;
+            if (!single_entry) prefetch_dir_data_info( data, length, info_class );
 
             while (!status && data->pos < data->count)
             {
@@ -2760,6 +3148,9 @@ NTSTATUS WINAPI NtQueryDirectoryFile( HANDLE handle, HANDLE event, PIO_APC_ROUTI
                 if (single_entry && last_info) break;
             }
 
+            /* the file info may change before the next call */
+            data->info_count = 0;
+
             if (!last_info) status = STATUS_NO_MORE_FILES;
             else if (status == STATUS_MORE_ENTRIES) status = STATUS_SUCCESS;
 
@@ -2778,6 +3169,231 @@ NTSTATUS WINAPI NtQueryDirectoryFile( HANDLE handle, HANDLE event, PIO_APC_ROUTI
 }
 
 
+/* names that wcsnicmp finds equal must hash the same; in ntdll.so it is
+ * ntdll_wcsnicmp, which compares the towupper of each char, so fold the same way */
+static unsigned int hash_dir_lookup_name( const WCHAR *name, unsigned int len )
+{
+    unsigned int i, hash = 0;
+
+    for (i = 0; i < len; i++) hash = hash * 65599 + towupper( name[i] );
+    return hash;
+}
+
+static void free_dir_lookup( struct dir_lookup *lookup )
+{
+    free( lookup->hash );
+    free( lookup->names );
+    free( lookup->data );
+    free( lookup );
+}
+
+
+/***********************************************************************
+ *           read_dir_lookup
+ *
+ * Read a whole directory into a new lookup cache entry.
+ * Returns NULL if the listing cannot be trusted to stay valid while the mtime is unchanged.
+ */
+static struct dir_lookup *read_dir_lookup( const char *unix_name, const struct stat *st )
+{
+    WCHAR buffer[MAX_DIR_ENTRY_LEN];
+    struct dir_lookup *lookup;
+    struct dir_lookup_name *names = NULL, *new_names;
+    char *data = NULL, *new_data;
+    unsigned int i, size = 0, data_size = 0, data_pos = 0, count = 0;
+    struct stat after;
+    struct dirent *de;
+    DIR *dir;
+    int len, ret;
+
+    /* a directory modified within the timestamp granularity may change again without a new mtime */
+    if (st->st_mtime >= time( NULL ) - 1) return NULL;
+
+    if (!(dir = opendir( unix_name ))) return NULL;
+
+    while ((de = readdir( dir )))
+    {
+        len = strlen( de->d_name );
+        ret = ntdll_umbstowcs( de->d_name, len, buffer, MAX_DIR_ENTRY_LEN );
+
+        if (count == size)
+        {
+            size = size ? size * 2 : 64;
+            if (!(new_names = realloc( names, size * sizeof(*names) ))) goto error;
+            names = new_names;
+        }
+        if (data_pos + (ret + 1) * sizeof(WCHAR) + len + 1 > data_size)
+        {
+            data_size = max( data_size * 2, data_pos + (ret + 1) * sizeof(WCHAR) + len + 1 + 4096 );
+            if (!(new_data = realloc( data, data_size ))) goto error;
+            data = new_data;
+        }
+
+        /* store offsets for now, the data buffer may still move */
+        names[count].len = ret;
+        names[count].long_name = (const WCHAR *)(UINT_PTR)data_pos;
+        memcpy( data + data_pos, buffer, ret * sizeof(WCHAR) );
+        data_pos += (ret + 1) * sizeof(WCHAR);
+        names[count].unix_name = (const char *)(UINT_PTR)data_pos;
+        memcpy( data + data_pos, de->d_name, len + 1 );
+        data_pos = (data_pos + len + 1 + sizeof(WCHAR) - 1) & ~(sizeof(WCHAR) - 1);
+        count++;
+    }
+
+    /* the directory changed while we were reading it */
+    if (fstat( dirfd( dir ), &after ) || get_dir_mtime( &after ) != get_dir_mtime( st ))
+        goto error;
+    closedir( dir );
+
+    if (!(lookup = calloc( 1, sizeof(*lookup) ))) goto failed;
+    lookup->id.dev = st->st_dev;
+    lookup->id.ino = st->st_ino;
+    lookup->mtime = get_dir_mtime( st );
+    lookup->count = count;
+    lookup->names = names;
+    lookup->data = data;
+    for (lookup->hash_size = 16; lookup->hash_size < count; lookup->hash_size *= 2) ;
+    if (!(lookup->hash = malloc( lookup->hash_size * sizeof(*lookup->hash) )))
+    {
+        free_dir_lookup( lookup );
+        return NULL;
+    }
+    memset( lookup->hash, 0xff, lookup->hash_size * sizeof(*lookup->hash) );
+
+    /* chains are built backwards, so that they keep readdir order and find the same entry as a scan */
+    for (i = count; i-- > 0; )
+    {
+        struct dir_lookup_name *entry = &names[i];
+        unsigned int bucket;
+
+        entry->long_name = (const WCHAR *)(data + (UINT_PTR)entry->long_name);
+        entry->unix_name = data + (UINT_PTR)entry->unix_name;
+        entry->hash = hash_dir_lookup_name( entry->long_name, entry->len );
+        bucket = entry->hash & (lookup->hash_size - 1);
+        entry->next = lookup->hash[bucket];
+        lookup->hash[bucket] = i;
+    }
+    return lookup;
+
+error:
+    closedir( dir );
+failed:
+    free( names );
+    free( data );
+    return NULL;
+}
+
+
+/***********************************************************************
+ *           search_dir_lookup
+ *
+ * Look for a name in a cached directory listing. Must be called with dir_lookup_mutex held.
+ */
+static const char *search_dir_lookup( const struct dir_lookup *lookup, const WCHAR *name, int length,
+                                      BOOLEAN is_name_8_dot_3 )
+{
+    unsigned int i, hash = hash_dir_lookup_name( name, length );
+    WCHAR short_nameW[12];
+    int ret;
+
+    for (i = lookup->hash[hash & (lookup->hash_size - 1)]; i != ~0u; i = lookup->names[i].next)
+    {
+        const struct dir_lookup_name *entry = &lookup->names[i];
+        if (entry->hash == hash && entry->len == length && !wcsnicmp( entry->long_name, name, length ))
+            return entry->unix_name;
+    }
+
+    if (!is_name_8_dot_3) return NULL;
+
+    for (i = 0; i < lookup->count; i++)
+    {
+        const struct dir_lookup_name *entry = &lookup->names[i];
+
+        if (is_legal_8dot3_name( entry->long_name, entry->len )) continue;
+        ret = hash_short_file_name( entry->long_name, entry->len, short_nameW );
+        if (ret == length && !wcsnicmp( short_nameW, name, length )) return entry->unix_name;
+    }
+    return NULL;
+}
+
+
+/***********************************************************************
+ *           find_file_in_dir_cache
+ *
+ * Look for a file through the cached listing of the directory in unix_name.
+ * Returns FALSE if the directory could not be cached, and the caller has to read it.
+ */
+static BOOL find_file_in_dir_cache( char *unix_name, int pos, const WCHAR *name, int length,
+                                    BOOLEAN is_name_8_dot_3, NTSTATUS *status )
+{
+    struct dir_lookup *lookup, *new_lookup = NULL;
+    const char *found;
+    struct stat st;
+
+    if (stat( unix_name, &st ) || !S_ISDIR( st.st_mode )) return FALSE;
+
+    mutex_lock( &dir_lookup_mutex );
+    for (;;)
+    {
+        LIST_FOR_EACH_ENTRY( lookup, &dir_lookup_cache, struct dir_lookup, entry )
+        {
+            if (lookup->id.dev != st.st_dev || lookup->id.ino != st.st_ino) continue;
+            if (lookup->mtime == get_dir_mtime( &st )) goto found;
+
+            dir_lookup_stale++;
+            TRACE_( dircache )( "%s changed, dropping %u names (%u stale)\n",
+                                debugstr_a(unix_name), lookup->count, dir_lookup_stale );
+            list_remove( &lookup->entry );
+            dir_lookup_cache_count--;
+            free_dir_lookup( lookup );
+            break;
+        }
+        if ((lookup = new_lookup)) break;
+
+        /* don't hold the mutex while reading the directory, another thread may add it in the meantime */
+        mutex_unlock( &dir_lookup_mutex );
+        if (!(new_lookup = read_dir_lookup( unix_name, &st ))) return FALSE;
+        mutex_lock( &dir_lookup_mutex );
+    }
+
+    dir_lookup_reads++;
+    TRACE_( dircache )( "read %u names from %s (%u reads)\n",
+                        lookup->count, debugstr_a(unix_name), dir_lookup_reads );
+    list_add_head( &dir_lookup_cache, &lookup->entry );
+    new_lookup = NULL;
+    if (++dir_lookup_cache_count > MAX_DIR_LOOKUP_CACHE)
+    {
+        struct dir_lookup *oldest = LIST_ENTRY( list_tail( &dir_lookup_cache ), struct dir_lookup, entry );
+        list_remove( &oldest->entry );
+        dir_lookup_cache_count--;
+        free_dir_lookup( oldest );
+    }
+
+found:
+    list_remove( &lookup->entry );
+    list_add_head( &dir_lookup_cache, &lookup->entry );
+
+    if ((found = search_dir_lookup( lookup, name, length, is_name_8_dot_3 )))
+    {
+        dir_lookup_hits++;
+        unix_name[pos - 1] = '/';
+        strcpy( unix_name + pos, found );
+        *status = STATUS_SUCCESS;
+    }
+    else
+    {
+        dir_lookup_misses++;
+        *status = STATUS_OBJECT_NAME_NOT_FOUND;
+    }
+    TRACE_( dircache )( "%s in %s: %s (%u hits, %u misses)\n", debugstr_wn(name, length),
+                        debugstr_a(unix_name), found ? "hit" : "miss", dir_lookup_hits, dir_lookup_misses );
+    mutex_unlock( &dir_lookup_mutex );
+
+    if (new_lookup) free_dir_lookup( new_lookup );
+    return TRUE;
+}
+
+
 /***********************************************************************
  *           find_file_in_dir
  *
@@ -2790,6 +3406,7 @@ static NTSTATUS find_file_in_dir( char *unix_name, int pos, const WCHAR *name, i
 {
     WCHAR buffer[MAX_DIR_ENTRY_LEN];
     BOOLEAN is_name_8_dot_3;
+    NTSTATUS status;
     DIR *dir;
     struct dirent *de;
     struct stat st;
@@ -2868,6 +3485,8 @@ static NTSTATUS find_file_in_dir( char *unix_name, int pos, const WCHAR *name, i
     }
 #endif /* VFAT_IOCTL_READDIR_BOTH */
 
+    if (find_file_in_dir_cache( unix_name, pos, name, length, is_name_8_dot_3, &status )) return status;
+
     if (!(dir = opendir( unix_name ))) return errno_to_status( errno );
 
     unix_name[pos - 1] = '/';
@@ -4751,6 +5370,8 @@ NTSTATUS WINAPI NtSetInformationFile( HANDLE handle, IO_STATUS_BLOCK *io,
                 status = wine_server_call( req );
             }
             SERVER_END_REQ;
+            /* the file may have other handles, invalidate all the cached unbound entries */
+            if (!status) InterlockedIncrement( &io_uring_port_generation );
         }
         else status = STATUS_INVALID_PARAMETER_3;
         break;
@@ -5421,6 +6042,402 @@ static void add_completion( HANDLE handle, ULONG_PTR value, NTSTATUS status, ULO
     SERVER_END_REQ;
 }
 
+static inline unsigned int io_uring_port_handle_to_index( HANDLE handle, unsigned int *entry )
+{
+    unsigned int idx = (wine_server_obj_handle( handle ) >> 2) - 1;
+    *entry = idx / IO_URING_PORT_CACHE_BLOCK_SIZE;
+    return idx % IO_URING_PORT_CACHE_BLOCK_SIZE;
+}
+
+/***********************************************************************
+ *           io_uring_remove_from_cache
+ *
+ * Called with fd_cache_mutex held when a handle is closed.
+ */
+void io_uring_remove_from_cache( HANDLE handle )
+{
+    unsigned int entry, idx = io_uring_port_handle_to_index( handle, &entry );
+
+    if (entry < IO_URING_PORT_CACHE_ENTRIES && io_uring_port_cache[entry])
+        InterlockedExchange( &io_uring_port_cache[entry][idx], 0 );
+}
+
+#if defined(HAVE_LINUX_IO_URING_H) && defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+
+/*
+ * Overlapped reads and writes at an explicit offset on regular files can be submitted to an
+ * io_uring instead of being done synchronously by the caller, so that many of them can be in
+ * flight at once. A dedicated thread waits for their completion, and signals it through the
+ * event and the completion port like the synchronous path does. Requests with an APC have to
+ * complete in the calling thread, and requests with neither an event nor a completion port
+ * are waited on through the file handle, which the server signals; both keep using the
+ * synchronous path, as do reads at or past the end of the file, which fail right away.
+ * The request holds its own handles to the event and the file, so that the application may
+ * close or reuse its handles while the I/O is in flight.
+ * Pending requests are kept in a list so that NtCancelIoFile can cancel them.
+ * This is only enabled with WINEIOURING=1.
+ */
+
+#define IO_URING_ENTRIES 256
+
+struct io_uring_request
+{
+    struct list       entry;      /* entry in the list of pending requests */
+    HANDLE            handle;     /* file handle of the caller, for NtCancelIoFile */
+    HANDLE            file;       /* duplicated file handle for the completion port, or 0 */
+    HANDLE            event;      /* duplicated event to signal on completion, or 0 */
+    int               fd;         /* duplicated Unix file descriptor, to retry a read that faulted */
+    IO_STATUS_BLOCK  *io;         /* I/O status block to fill */
+    DWORD             tid;        /* thread that started the request, for NtCancelIoFile */
+    ULONG_PTR         cvalue;     /* completion port value, 0 if no port is associated */
+    void             *buffer;     /* read buffer, to retry a read that faulted */
+    ULONG             length;     /* request length */
+    off_t             offset;     /* request offset */
+    BOOL              write;      /* whether this is a write */
+};
+
+static struct
+{
+    int                  fd;          /* io_uring file descriptor, -1 if unavailable */
+    unsigned int         sq_mask;
+    unsigned int         cq_mask;
+    unsigned int         cq_entries;
+    unsigned int        *sq_head;
+    unsigned int        *sq_tail;
+    unsigned int        *sq_array;
+    unsigned int        *cq_head;
+    unsigned int        *cq_tail;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    LONG                 inflight;    /* count of submitted requests not yet completed */
+} io_uring = { -1 };
+
+static pthread_mutex_t io_uring_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct list io_uring_requests = LIST_INIT( io_uring_requests );
+
+static BOOL init_io_uring(void)
+{
+    static BOOL initialized;
+    struct io_uring_params params;
+    const char *env;
+    char *sq_ring, *cq_ring;
+    size_t sq_size, cq_size;
+    HANDLE thread;
+    int fd;
+
+    if (initialized) return io_uring.fd != -1;
+    initialized = TRUE;
+
+    if (!(env = getenv( "WINEIOURING" )) || !atoi( env )) return FALSE;
+    /* completions are delivered in the 64-bit I/O status block layout */
+    if (is_wow64() || !p__wine_io_uring_routine) return FALSE;
+
+    memset( &params, 0, sizeof(params) );
+    if ((fd = syscall( __NR_io_uring_setup, IO_URING_ENTRIES, &params )) == -1)
+    {
+        WARN( "io_uring not available, errno %d\n", errno );
+        return FALSE;
+    }
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP))
+    {
+        WARN( "io_uring too old, features %#x\n", params.features );
+        close( fd );
+        return FALSE;
+    }
+
+    sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    sq_ring = mmap( NULL, max( sq_size, cq_size ), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    fd, IORING_OFF_SQ_RING );
+    if (sq_ring == MAP_FAILED) goto failed;
+    cq_ring = sq_ring;
+    io_uring.sqes = mmap( NULL, params.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES );
+    if (io_uring.sqes == MAP_FAILED)
+    {
+        munmap( sq_ring, max( sq_size, cq_size ));
+        goto failed;
+    }
+
+    io_uring.sq_head    = (unsigned int *)(sq_ring + params.sq_off.head);
+    io_uring.sq_tail    = (unsigned int *)(sq_ring + params.sq_off.tail);
+    io_uring.sq_mask    = *(unsigned int *)(sq_ring + params.sq_off.ring_mask);
+    io_uring.sq_array   = (unsigned int *)(sq_ring + params.sq_off.array);
+    io_uring.cq_head    = (unsigned int *)(cq_ring + params.cq_off.head);
+    io_uring.cq_tail    = (unsigned int *)(cq_ring + params.cq_off.tail);
+    io_uring.cq_mask    = *(unsigned int *)(cq_ring + params.cq_off.ring_mask);
+    io_uring.cqes       = (struct io_uring_cqe *)(cq_ring + params.cq_off.cqes);
+    io_uring.cq_entries = params.cq_entries;
+    io_uring.fd = fd;
+
+    if (NtCreateThreadEx( &thread, THREAD_ALL_ACCESS, NULL, NtCurrentProcess(), p__wine_io_uring_routine, NULL,
+                          THREAD_CREATE_FLAGS_SKIP_THREAD_ATTACH | THREAD_CREATE_FLAGS_HIDE_FROM_DEBUGGER,
+                          0, 0, 0, NULL ))
+    {
+        /* keep the ring mapped, nothing will be submitted to it */
+        io_uring.fd = -1;
+        close( fd );
+        return FALSE;
+    }
+    NtClose( thread );
+
+    TRACE( "using io_uring with %u entries\n", params.sq_entries );
+    return TRUE;
+
+failed:
+    WARN( "failed to map io_uring, errno %d\n", errno );
+    close( fd );
+    return FALSE;
+}
+
+/* check whether a completion port is associated with a file */
+static BOOL has_completion_port( HANDLE handle )
+{
+    unsigned int entry, idx = io_uring_port_handle_to_index( handle, &entry );
+    LONG cache = 0, generation;
+    unsigned int status;
+    sigset_t sigset;
+    BOOL ret = FALSE;
+
+    /* the cached value is the generation plus one shifted left, with the low bit set if a port is bound */
+    if (entry < IO_URING_PORT_CACHE_ENTRIES && io_uring_port_cache[entry])
+        cache = ReadNoFence( &io_uring_port_cache[entry][idx] );
+    if (cache & 1) return TRUE;
+    generation = ReadNoFence( &io_uring_port_generation );
+    if (cache && (cache >> 1) == (generation & 0x1fffffff) + 1) return FALSE;
+
+    /* the cache is updated under fd_cache_mutex, so that the handle can't be closed meanwhile */
+    server_enter_uninterrupted_section( &fd_cache_mutex, &sigset );
+    SERVER_START_REQ( get_fd_completion )
+    {
+        req->handle = wine_server_obj_handle( handle );
+        if (!(status = wine_server_call( req ))) ret = reply->bound;
+    }
+    SERVER_END_REQ;
+    if (!status && entry < IO_URING_PORT_CACHE_ENTRIES)
+    {
+        if (!io_uring_port_cache[entry])
+        {
+            void *ptr = anon_mmap_alloc( IO_URING_PORT_CACHE_BLOCK_SIZE * sizeof(LONG), PROT_READ | PROT_WRITE );
+            if (ptr != MAP_FAILED) io_uring_port_cache[entry] = ptr;
+        }
+        if (io_uring_port_cache[entry])
+            InterlockedExchange( &io_uring_port_cache[entry][idx],
+                                 (((generation & 0x1fffffff) + 1) << 1) | ret );
+    }
+    server_leave_uninterrupted_section( &fd_cache_mutex, &sigset );
+    return ret;
+}
+
+/* queue a submission entry, called with io_uring_mutex held */
+static BOOL io_uring_queue( const struct io_uring_sqe *entry )
+{
+    unsigned int tail = *io_uring.sq_tail, index = tail & io_uring.sq_mask;
+    int ret;
+
+    io_uring.sqes[index] = *entry;
+    io_uring.sq_array[index] = index;
+    __atomic_store_n( io_uring.sq_tail, tail + 1, __ATOMIC_RELEASE );
+
+    while ((ret = syscall( __NR_io_uring_enter, io_uring.fd, 1, 0, 0, NULL, 0 )) == -1 && errno == EINTR);
+    if (ret != 1)
+    {
+        WARN( "io_uring submission failed, ret %d errno %d\n", ret, errno );
+        __atomic_store_n( io_uring.sq_tail, tail, __ATOMIC_RELEASE );
+        return FALSE;
+    }
+    InterlockedIncrement( &io_uring.inflight );
+    return TRUE;
+}
+
+static void io_uring_free_request( struct io_uring_request *op )
+{
+    if (op->fd != -1) close( op->fd );
+    if (op->event) NtClose( op->event );
+    if (op->file) NtClose( op->file );
+    free( op );
+}
+
+/* submit a read or write to the io_uring, return FALSE to use the synchronous path instead */
+static BOOL io_uring_submit( HANDLE handle, int fd, HANDLE event, IO_STATUS_BLOCK *io, ULONG_PTR cvalue,
+                             void *buffer, ULONG length, off_t offset, BOOL write )
+{
+    struct io_uring_request *op;
+    struct io_uring_sqe sqe;
+    struct stat st;
+    int ret;
+
+    mutex_lock( &io_uring_mutex );
+    ret = init_io_uring() && io_uring.inflight < io_uring.cq_entries;
+    mutex_unlock( &io_uring_mutex );
+    if (!ret) return FALSE;
+
+    /* the completion value is the OVERLAPPED pointer, it is only used if there is a port */
+    if (cvalue && !has_completion_port( handle )) cvalue = 0;
+    if (!event && !cvalue) return FALSE;
+
+    /* reading at the end of the file doesn't go async, it fails synchronously */
+    if (!write && (fstat( fd, &st ) == -1 || offset >= st.st_size)) return FALSE;
+
+    if (!(op = malloc( sizeof(*op) ))) return FALSE;
+
+    op->file  = 0;
+    op->event = 0;
+    op->fd    = -1;
+    if ((!write && (op->fd = dup( fd )) == -1) ||
+        (event && NtDuplicateObject( NtCurrentProcess(), event, NtCurrentProcess(), &op->event,
+                                     0, 0, DUPLICATE_SAME_ACCESS )) ||
+        (cvalue && NtDuplicateObject( NtCurrentProcess(), handle, NtCurrentProcess(), &op->file,
+                                      0, 0, DUPLICATE_SAME_ACCESS )))
+    {
+        io_uring_free_request( op );
+        return FALSE;
+    }
+
+    op->handle = handle;
+    op->io     = io;
+    op->tid    = HandleToULong( NtCurrentTeb()->ClientId.UniqueThread );
+    op->cvalue = cvalue;
+    op->buffer = buffer;
+    op->length = length;
+    op->offset = offset;
+    op->write  = write;
+
+    /* the event is reset when the I/O is started, like the server does for its asyncs */
+    if (event) NtResetEvent( event, NULL );
+
+    memset( &sqe, 0, sizeof(sqe) );
+    sqe.opcode    = write ? IORING_OP_WRITE : IORING_OP_READ;
+    sqe.fd        = fd;
+    sqe.addr      = (ULONG_PTR)buffer;
+    sqe.len       = length;
+    sqe.off       = offset;
+    sqe.user_data = (ULONG_PTR)op;
+
+    /* the kernel holds its own reference to the file once the request is submitted */
+    mutex_lock( &io_uring_mutex );
+    if (io_uring.inflight >= io_uring.cq_entries || !io_uring_queue( &sqe ))
+    {
+        mutex_unlock( &io_uring_mutex );
+        io_uring_free_request( op );
+        return FALSE;
+    }
+    list_add_tail( &io_uring_requests, &op->entry );
+    mutex_unlock( &io_uring_mutex );
+    return TRUE;
+}
+
+/* cancel the pending requests on a handle, optionally only those of the current thread or using io */
+static BOOL io_uring_cancel( HANDLE handle, IO_STATUS_BLOCK *io, BOOL only_thread )
+{
+    DWORD tid = HandleToULong( NtCurrentTeb()->ClientId.UniqueThread );
+    struct io_uring_request *op;
+    struct io_uring_sqe sqe;
+    BOOL found = FALSE;
+
+    mutex_lock( &io_uring_mutex );
+    LIST_FOR_EACH_ENTRY( op, &io_uring_requests, struct io_uring_request, entry )
+    {
+        if (op->handle != handle) continue;
+        if (io && op->io != io) continue;
+        if (only_thread && op->tid != tid) continue;
+        found = TRUE;
+        /* the request completes with -ECANCELED if the kernel could still stop it */
+        memset( &sqe, 0, sizeof(sqe) );
+        sqe.opcode = IORING_OP_ASYNC_CANCEL;
+        sqe.addr   = (ULONG_PTR)op;
+        if (io_uring.inflight >= io_uring.cq_entries || !io_uring_queue( &sqe )) break;
+    }
+    mutex_unlock( &io_uring_mutex );
+    return found;
+}
+
+static void io_uring_complete( struct io_uring_request *op, int res )
+{
+    NTSTATUS status;
+    ULONG_PTR info = 0;
+
+    /* reads in buffers with write watches fault, they have to be redone with the watches updated */
+    if (res == -EFAULT && !op->write)
+    {
+        while ((res = virtual_locked_pread( op->fd, op->buffer, op->length, op->offset )) == -1 && errno == EINTR);
+        if (res == -1) res = -errno;
+    }
+
+    if (res >= 0)
+    {
+        info = res;
+        status = (res || !op->length || op->write) ? STATUS_SUCCESS : STATUS_END_OF_FILE;
+    }
+    else if (res == -ECANCELED) status = STATUS_CANCELLED;
+    else if (res == -EFAULT) status = STATUS_INVALID_USER_BUFFER;
+    else status = errno_to_status( -res );
+
+    TRACE( "handle %p io %p => %#x (%lu)\n", op->handle, op->io, (int)status, info );
+
+    set_async_iosb( iosb_client_ptr( op->io ), status, info );
+    if (op->event) NtSetEvent( op->event, NULL );
+    if (op->cvalue) add_completion( op->file, op->cvalue, status, info, TRUE );
+    io_uring_free_request( op );
+}
+
+/* runs in the completion thread, on the Unix side */
+NTSTATUS io_uring_completions( void *args )
+{
+    unsigned int head, tail;
+    int ret;
+
+    for (;;)
+    {
+        ret = syscall( __NR_io_uring_enter, io_uring.fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0 );
+        if (ret == -1 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+        {
+            ERR( "io_uring wait failed, errno %d\n", errno );
+            return errno_to_status( errno );
+        }
+
+        head = *io_uring.cq_head;
+        tail = __atomic_load_n( io_uring.cq_tail, __ATOMIC_ACQUIRE );
+        while (head != tail)
+        {
+            struct io_uring_cqe *cqe = &io_uring.cqes[head & io_uring.cq_mask];
+            struct io_uring_request *op = (struct io_uring_request *)(ULONG_PTR)cqe->user_data;
+            int res = cqe->res;
+
+            /* release the entry first, completing the request may take a while */
+            __atomic_store_n( io_uring.cq_head, ++head, __ATOMIC_RELEASE );
+            InterlockedDecrement( &io_uring.inflight );
+            /* cancel requests have no user data, their result is the one of the request they cancel */
+            if (!op) continue;
+            mutex_lock( &io_uring_mutex );
+            list_remove( &op->entry );
+            mutex_unlock( &io_uring_mutex );
+            io_uring_complete( op, res );
+            tail = __atomic_load_n( io_uring.cq_tail, __ATOMIC_ACQUIRE );
+        }
+    }
+}
+
+#else  /* HAVE_LINUX_IO_URING_H */
+
+static BOOL io_uring_submit( HANDLE handle, int fd, HANDLE event, IO_STATUS_BLOCK *io, ULONG_PTR cvalue,
+                             void *buffer, ULONG length, off_t offset, BOOL write )
+{
+    return FALSE;
+}
+
+static BOOL io_uring_cancel( HANDLE handle, IO_STATUS_BLOCK *io, BOOL only_thread )
+{
+    return FALSE;
+}
+
+NTSTATUS io_uring_completions( void *args )
+{
+    return STATUS_NOT_SUPPORTED;
+}
+
+#endif  /* HAVE_LINUX_IO_URING_H */
+
 /* notify direct completion of async and close the wait handle if it is no longer needed */
 void set_async_direct_result( HANDLE *async_handle, unsigned int options, IO_STATUS_BLOCK *io,
                               NTSTATUS status, ULONG_PTR information, BOOL mark_pending )
@@ -5521,7 +6538,15 @@ NTSTATUS WINAPI NtReadFile( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, vo
 
         if (offset && offset->QuadPart != FILE_USE_FILE_POINTER_POSITION)
         {
-            /* async I/O doesn't make sense on regular files */
+            if (async_read && !apc && length &&
+                io_uring_submit( handle, unix_handle, event, io, cvalue, buffer, length, offset->QuadPart, FALSE ))
+            {
+                if (needs_close) close( unix_handle );
+                TRACE( "= PENDING (io_uring)\n" );
+                return STATUS_PENDING;
+            }
+
+            /* other async I/O doesn't make sense on regular files */
             while ((result = virtual_locked_pread( unix_handle, buffer, length, offset->QuadPart )) == -1)
             {
                 if (errno != EINTR)
@@ -5837,7 +6862,15 @@ NTSTATUS WINAPI NtWriteFile( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, v
                 goto done;
             }
 
-            /* async I/O doesn't make sense on regular files */
+            if (async_write && !apc && length && offset->QuadPart >= 0 &&
+                io_uring_submit( handle, unix_handle, event, io, cvalue, (void *)buffer, length, off, TRUE ))
+            {
+                if (needs_close) close( unix_handle );
+                TRACE( "= PENDING (io_uring)\n" );
+                return STATUS_PENDING;
+            }
+
+            /* other async I/O doesn't make sense on regular files */
             while ((result = pwrite( unix_handle, buffer, length, off )) == -1)
             {
                 if (errno != EINTR)
@@ -6342,6 +7375,8 @@ NTSTATUS WINAPI NtCancelIoFile( HANDLE handle, IO_STATUS_BLOCK *io_status )
 
     TRACE( "%p %p\n", handle, io_status );
 
+    io_uring_cancel( handle, NULL, TRUE );
+
     SERVER_START_REQ( cancel_async )
     {
         req->handle      = wine_server_obj_handle( handle );
@@ -6364,21 +7399,28 @@ NTSTATUS WINAPI NtCancelIoFile( HANDLE handle, IO_STATUS_BLOCK *io_status )
 NTSTATUS WINAPI NtCancelIoFileEx( HANDLE handle, IO_STATUS_BLOCK *io, IO_STATUS_BLOCK *io_status )
 {
     unsigned int status;
+    BOOL found;
 
     TRACE( "%p %p %p\n", handle, io, io_status );
 
+    found = io_uring_cancel( handle, io, FALSE );
+
     SERVER_START_REQ( cancel_async )
     {
         req->handle = wine_server_obj_handle( handle );
         req->iosb   = wine_server_client_ptr( io );
-        if (!(status = wine_server_call( req )))
-        {
-            io_status->Status = status;
-            io_status->Information = 0;
-        }
+        status = wine_server_call( req );
     }
     SERVER_END_REQ;
 
+    /* requests submitted to the io_uring are not known to the server */
+    if (status == STATUS_NOT_FOUND && found) status = STATUS_SUCCESS;
+    if (!status)
+    {
+        io_status->Status = status;
+        io_status->Information = 0;
+    }
+
     return status;
 }
 
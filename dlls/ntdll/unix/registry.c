@@ -25,8 +25,10 @@
 #pragma makedep unix
 #endif
 
+#include <signal.h>
 #include <stdarg.h>
 #include <string.h>
+#include <sys/mman.h>
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
@@ -39,6 +41,207 @@ WINE_DEFAULT_DEBUG_CHANNEL(reg);
 /* maximum length of a value name in bytes (without terminating null) */
 #define MAX_VALUE_LENGTH (16383 * sizeof(WCHAR))
 
+#if defined(__i386__) || defined(__x86_64__)
+/* this prevents compilers from incorrectly reordering non-volatile reads (e.g., memcpy) from shared memory */
+#define __SHARED_READ_FENCE do { __asm__ __volatile__( "" ::: "memory" ); } while (0)
+#else
+#define __SHARED_READ_FENCE __atomic_thread_fence( __ATOMIC_ACQUIRE )
+#endif
+
+/* location of the shared record of an open key */
+union registry_cache_entry
+{
+    LONG64 data;
+    struct
+    {
+        unsigned int offset;      /* offset of the record, 0 if the key isn't published */
+        unsigned int generation;  /* generation of the chunk holding the record */
+    } s;
+};
+
+#define REGISTRY_CACHE_BLOCK_SIZE  (65536 / sizeof(union registry_cache_entry))
+#define REGISTRY_CACHE_ENTRIES     128
+#define REGISTRY_CLOSED_HANDLES    64
+
+static const registry_shm_t *registry_shm;
+static union registry_cache_entry *registry_cache[REGISTRY_CACHE_ENTRIES];
+
+/* the last handles closed, a record returned by the server is only cached if its handle
+ * wasn't closed during the call, it could have been reused for another key meanwhile */
+static HANDLE registry_closed[REGISTRY_CLOSED_HANDLES];
+static LONG registry_closed_count;
+
+static inline unsigned int registry_handle_to_index( HANDLE handle, unsigned int *entry )
+{
+    unsigned int idx = (wine_server_obj_handle( handle ) >> 2) - 1;
+    *entry = idx / REGISTRY_CACHE_BLOCK_SIZE;
+    return idx % REGISTRY_CACHE_BLOCK_SIZE;
+}
+
+/***********************************************************************
+ *           registry_shm_init
+ *
+ * Map the section where the server publishes the values of read-mostly keys.
+ */
+void registry_shm_init(void)
+{
+    static const WCHAR nameW[] =
+    {
+        '\\','K','e','r','n','e','l','O','b','j','e','c','t','s','\\',
+        '_','_','w','i','n','e','_','r','e','g','i','s','t','r','y',0
+    };
+    UNICODE_STRING name = RTL_CONSTANT_STRING( nameW );
+    OBJECT_ATTRIBUTES attr;
+    SIZE_T size = 0;
+    void *ptr = NULL;
+    HANDLE handle;
+
+    InitializeObjectAttributes( &attr, &name, 0, NULL, NULL );
+    if (NtOpenSection( &handle, SECTION_MAP_READ, &attr )) return;
+    if (!NtMapViewOfSection( handle, NtCurrentProcess(), &ptr, 0, 0, NULL, &size, ViewUnmap, 0, PAGE_READONLY ))
+    {
+        const registry_shm_t *shm = ptr;
+
+        /* only use the section if it carries the server lowercase table */
+        if (shm->size == REGISTRY_SHM_SIZE && shm->casemap_size >= 256 * sizeof(USHORT) &&
+            shm->casemap_offset < shm->size && shm->casemap_size <= shm->size - shm->casemap_offset)
+            registry_shm = shm;
+        else NtUnmapViewOfSection( NtCurrentProcess(), ptr );
+    }
+    NtClose( handle );
+}
+
+/***********************************************************************
+ *           registry_remove_from_cache
+ *
+ * Caller must hold fd_cache_mutex.
+ */
+void registry_remove_from_cache( HANDLE handle )
+{
+    unsigned int entry, idx = registry_handle_to_index( handle, &entry );
+
+    if (entry < REGISTRY_CACHE_ENTRIES && registry_cache[entry])
+        interlocked_xchg64( &registry_cache[entry][idx].data, 0 );
+
+    registry_closed[registry_closed_count % REGISTRY_CLOSED_HANDLES] = handle;
+    WriteRelease( &registry_closed_count, registry_closed_count + 1 );
+}
+
+/* caller must hold fd_cache_mutex */
+static void add_registry_to_cache( HANDLE handle, union registry_cache_entry cache )
+{
+    unsigned int entry, idx = registry_handle_to_index( handle, &entry );
+
+    if (entry >= REGISTRY_CACHE_ENTRIES) return;
+    if (!registry_cache[entry])
+    {
+        void *ptr;
+
+        if (!cache.s.offset) return;
+        ptr = anon_mmap_alloc( REGISTRY_CACHE_BLOCK_SIZE * sizeof(union registry_cache_entry),
+                                     PROT_READ | PROT_WRITE );
+        if (ptr == MAP_FAILED) return;
+        registry_cache[entry] = ptr;
+    }
+    interlocked_xchg64( &registry_cache[entry][idx].data, cache.data );
+}
+
+/* cache a record returned by the server, closed is the count of closed handles before the call */
+static void update_registry_cache( HANDLE handle, union registry_cache_entry cache, LONG closed )
+{
+    sigset_t sigset;
+    LONG i;
+
+    server_enter_uninterrupted_section( &fd_cache_mutex, &sigset );
+    if (registry_closed_count - closed <= REGISTRY_CLOSED_HANDLES)
+    {
+        for (i = closed; i != registry_closed_count; i++)
+            if (registry_closed[i % REGISTRY_CLOSED_HANDLES] == handle) break;
+        if (i == registry_closed_count) add_registry_to_cache( handle, cache );
+    }
+    server_leave_uninterrupted_section( &fd_cache_mutex, &sigset );
+}
+
+/* lowercase a character with the server table, which may differ from the one loaded by ntdll */
+static WCHAR shm_towlower( WCHAR ch )
+{
+    const USHORT *table = (const USHORT *)((const char *)registry_shm + registry_shm->casemap_offset);
+    return ch + table[table[table[ch >> 8] + ((ch >> 4) & 0x0f)] + (ch & 0x0f)];
+}
+
+/* compare a value name with a name in the shared record, the same way the server sorts them */
+static int compare_value_name( const WCHAR *name, unsigned int len, const volatile WCHAR *shm_name,
+                               unsigned int shm_len )
+{
+    unsigned int i;
+    int ret;
+
+    for (i = 0; i < min( len, shm_len ) / sizeof(WCHAR); i++)
+        if ((ret = shm_towlower( shm_name[i] ) - shm_towlower( name[i] ))) return ret;
+    return (int)shm_len - (int)len;
+}
+
+/* look up a value in the shared record of a key, return FALSE if the server has to be asked */
+static BOOL get_value_shm( HANDLE handle, const UNICODE_STRING *name, void *data, unsigned int size,
+                           int *type, unsigned int *total, unsigned int *status )
+{
+    unsigned int entry, idx = registry_handle_to_index( handle, &entry );
+    const registry_key_shm_t *record;
+    union registry_cache_entry cache;
+    const volatile unsigned int *generation;
+    unsigned int seq, record_size, nb_values, name_offset, name_len, data_offset, data_len;
+    int min, max, i, res;
+
+    if (!registry_shm || !handle) return FALSE;
+    if (entry >= REGISTRY_CACHE_ENTRIES || !registry_cache[entry]) return FALSE;
+    cache.data = ReadNoFence64( &registry_cache[entry][idx].data );
+    if (!cache.s.offset) return FALSE;
+
+    if (cache.s.offset > registry_shm->size - sizeof(*record)) return FALSE;
+    generation = &registry_shm->generation[cache.s.offset / REGISTRY_SHM_CHUNK];
+    if (ReadAcquire( (LONG *)generation ) != cache.s.generation) return FALSE;
+    record = (const registry_key_shm_t *)((const char *)registry_shm + cache.s.offset);
+    if ((seq = ReadAcquire( (LONG *)&record->seq )) & 1) return FALSE;
+    __SHARED_READ_FENCE;
+
+    /* the server may recycle the record while we read it, so validate everything we use */
+    record_size = record->size;
+    nb_values = record->nb_values;
+    if (record_size > registry_shm->size - cache.s.offset) return FALSE;
+    if (nb_values > (record_size - offsetof( registry_key_shm_t, values )) / sizeof(record->values[0]))
+        return FALSE;
+
+    *status = STATUS_OBJECT_NAME_NOT_FOUND;
+    min = 0;
+    max = nb_values - 1;
+    while (min <= max)
+    {
+        i = (min + max) / 2;
+        name_offset = record->values[i].name_offset;
+        name_len = record->values[i].namelen;
+        if (name_offset > record_size || name_len > record_size - name_offset) return FALSE;
+        res = compare_value_name( name->Buffer, name->Length,
+                                  (const volatile WCHAR *)((const char *)record + name_offset), name_len );
+        if (res > 0) max = i - 1;
+        else if (res < 0) min = i + 1;
+        else
+        {
+            data_offset = record->values[i].data_offset;
+            data_len = record->values[i].datalen;
+            if (data_offset > record_size || data_len > record_size - data_offset) return FALSE;
+            *type = record->values[i].type;
+            *total = data_len;
+            if (data) memcpy( data, (const char *)record + data_offset, min( data_len, size ));
+            *status = STATUS_SUCCESS;
+            break;
+        }
+    }
+
+    __SHARED_READ_FENCE;
+    return ReadNoFence( (LONG *)&record->seq ) == seq &&
+           ReadNoFence( (LONG *)generation ) == cache.s.generation;
+}
+
 
 NTSTATUS open_hkcu_key( const char *path, HANDLE *key )
 {
@@ -133,8 +336,10 @@ NTSTATUS WINAPI NtCreateKeyTransacted( HANDLE *key, ACCESS_MASK access, const OB
  */
 NTSTATUS WINAPI NtOpenKeyEx( HANDLE *key, ACCESS_MASK access, const OBJECT_ATTRIBUTES *attr, ULONG options )
 {
+    union registry_cache_entry cache;
     unsigned int ret;
     ULONG attributes;
+    LONG closed = 0;
 
     *key = 0;
     if (attr->Length != sizeof(*attr)) return STATUS_INVALID_PARAMETER;
@@ -146,6 +351,8 @@ NTSTATUS WINAPI NtOpenKeyEx( HANDLE *key, ACCESS_MASK access, const OBJECT_ATTRI
 
     attributes = attr->Attributes | OBJ_CASE_INSENSITIVE;
 
+    if (registry_shm) closed = ReadAcquire( &registry_closed_count );
+
     SERVER_START_REQ( open_key )
     {
         req->parent     = wine_server_obj_handle( attr->RootDirectory );
@@ -154,8 +361,12 @@ NTSTATUS WINAPI NtOpenKeyEx( HANDLE *key, ACCESS_MASK access, const OBJECT_ATTRI
         wine_server_add_data( req, attr->ObjectName->Buffer, attr->ObjectName->Length );
         ret = wine_server_call( req );
         *key = wine_server_ptr_handle( reply->hkey );
+        cache.s.offset     = reply->shm_offset;
+        cache.s.generation = reply->generation;
     }
     SERVER_END_REQ;
+
+    if (registry_shm && !ret && cache.s.offset) update_registry_cache( *key, cache, closed );
     TRACE("<- %p\n", *key);
     return ret;
 }
@@ -491,9 +702,12 @@ NTSTATUS WINAPI NtQueryValueKey( HANDLE handle, const UNICODE_STRING *name,
                                  KEY_VALUE_INFORMATION_CLASS info_class,
                                  void *info, DWORD length, DWORD *result_len )
 {
-    unsigned int ret;
+    union registry_cache_entry cache;
+    unsigned int ret, total = 0;
     UCHAR *data_ptr;
     unsigned int fixed_size, min_size;
+    int type = 0;
+    LONG closed = 0;
 
     TRACE( "(%p,%s,%d,%p,%d)\n", handle, debugstr_us(name), info_class, info, (int)length );
 
@@ -539,21 +753,37 @@ NTSTATUS WINAPI NtQueryValueKey( HANDLE handle, const UNICODE_STRING *name,
         return STATUS_INVALID_PARAMETER;
     }
 
-    SERVER_START_REQ( get_key_value )
+    if (!get_value_shm( handle, name, length > fixed_size ? data_ptr : NULL,
+                        length > fixed_size ? length - fixed_size : 0, &type, &total, &ret ))
     {
-        req->hkey = wine_server_obj_handle( handle );
-        wine_server_add_data( req, name->Buffer, name->Length );
-        if (length > fixed_size && data_ptr) wine_server_set_reply( req, data_ptr, length - fixed_size );
-        if (!(ret = wine_server_call( req )))
+        if (registry_shm) closed = ReadAcquire( &registry_closed_count );
+
+        SERVER_START_REQ( get_key_value )
         {
-            copy_key_value_info( info_class, info, length, reply->type,
-                                 name->Length, reply->total );
-            *result_len = fixed_size + (info_class == KeyValueBasicInformation ? 0 : reply->total);
-            if (length < min_size) ret = STATUS_BUFFER_TOO_SMALL;
-            else if (length < *result_len) ret = STATUS_BUFFER_OVERFLOW;
+            req->hkey = wine_server_obj_handle( handle );
+            wine_server_add_data( req, name->Buffer, name->Length );
+            if (length > fixed_size && data_ptr) wine_server_set_reply( req, data_ptr, length - fixed_size );
+            if (!(ret = wine_server_call( req )))
+            {
+                type  = reply->type;
+                total = reply->total;
+            }
+            cache.s.offset     = reply->shm_offset;
+            cache.s.generation = reply->generation;
         }
+        SERVER_END_REQ;
+
+        /* the record was recycled or rewritten since the key was opened, use the new one */
+        if (registry_shm && cache.s.offset) update_registry_cache( handle, cache, closed );
+    }
+
+    if (!ret)
+    {
+        copy_key_value_info( info_class, info, length, type, name->Length, total );
+        *result_len = fixed_size + (info_class == KeyValueBasicInformation ? 0 : total);
+        if (length < min_size) ret = STATUS_BUFFER_TOO_SMALL;
+        else if (length < *result_len) ret = STATUS_BUFFER_OVERFLOW;
     }
-    SERVER_END_REQ;
     return ret;
 }
 
@@ -103,19 +103,7 @@ sigset_t server_block_set;  /* signals to block during server calls */
 static int fd_socket = -1;  /* socket to exchange file descriptors with the server */
 static int initial_cwd = -1;
 static pid_t server_pid;
-static pthread_mutex_t fd_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
-
-/* atomically exchange a 64-bit value */
-static inline LONG64 interlocked_xchg64( LONG64 *dest, LONG64 val )
-{
-#ifdef _WIN64
-    return (LONG64)InterlockedExchangePointer( (void **)dest, (void *)val );
-#else
-    LONG64 tmp = *dest;
-    while (InterlockedCompareExchange64( dest, val, tmp ) != tmp) tmp = *dest;
-    return tmp;
-#endif
-}
+pthread_mutex_t fd_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 #ifdef __GNUC__
 static void fatal_error( const char *err, ... ) __attribute__((noreturn, format(printf,1,2)));
@@ -1686,6 +1674,9 @@ void server_init_process_done(void)
      * is sent by init_process_done */
     signal_init_process();
 
+    inproc_sync_init();
+    registry_shm_init();
+
     /* always send the native TEB */
     if (!(teb = NtCurrentTeb64())) teb = NtCurrentTeb();
 
@@ -1798,7 +1789,12 @@ NTSTATUS WINAPI NtDuplicateObject( HANDLE source_process, HANDLE source, HANDLE
     /* always remove the cached fd; if the server request fails we'll just
      * retrieve it again */
     if (options & DUPLICATE_CLOSE_SOURCE)
+    {
         fd = remove_fd_from_cache( source );
+        inproc_sync_remove_from_cache( source );
+        registry_remove_from_cache( source );
+        io_uring_remove_from_cache( source );
+    }
 
     SERVER_START_REQ( dup_handle )
     {
@@ -1869,6 +1865,9 @@ NTSTATUS WINAPI NtClose( HANDLE handle )
     /* always remove the cached fd; if the server request fails we'll just
      * retrieve it again */
     fd = remove_fd_from_cache( handle );
+    inproc_sync_remove_from_cache( handle );
+    registry_remove_from_cache( handle );
+    io_uring_remove_from_cache( handle );
 
     SERVER_START_REQ( close_handle )
     {
@@ -192,6 +192,437 @@ static inline int futex_wake_one( const LONG *addr )
 
 #endif /* __APPLE__ */
 
+#ifdef __linux__
+
+/* in-process synchronization objects, see server/inproc_sync.c */
+
+#ifndef __NR_futex_waitv
+#define __NR_futex_waitv 449
+#endif
+
+struct inproc_futex_waitv
+{
+    ULONG64 val;
+    ULONG64 uaddr;
+    UINT    flags;
+    UINT    reserved;
+};
+
+struct inproc_kernel_timespec
+{
+    LONGLONG tv_sec;
+    LONGLONG tv_nsec;
+};
+
+#define INPROC_FUTEX_32  2
+
+union inproc_sync_cache_entry
+{
+    LONG64 data;
+    struct
+    {
+        unsigned int   access;
+        unsigned short index;
+        unsigned char  type;   /* INPROC_SYNC_NONE if the object has to be waited on in the server */
+        unsigned char  cached;
+    } s;
+};
+
+C_ASSERT( sizeof(union inproc_sync_cache_entry) == sizeof(LONG64) );
+
+#define INPROC_SYNC_CACHE_BLOCK_SIZE  (65536 / sizeof(union inproc_sync_cache_entry))
+#define INPROC_SYNC_CACHE_ENTRIES     128
+
+static inproc_sync_shm_t *inproc_syncs;
+static union inproc_sync_cache_entry *inproc_sync_cache[INPROC_SYNC_CACHE_ENTRIES];
+static BOOL futex_waitv_supported = TRUE;
+
+static inline unsigned int inproc_sync_handle_to_index( HANDLE handle, unsigned int *entry )
+{
+    unsigned int idx = (wine_server_obj_handle( handle ) >> 2) - 1;
+    *entry = idx / INPROC_SYNC_CACHE_BLOCK_SIZE;
+    return idx % INPROC_SYNC_CACHE_BLOCK_SIZE;
+}
+
+/***********************************************************************
+ *           inproc_sync_init
+ *
+ * Map the shared section if the server keeps synchronization objects in it.
+ */
+void inproc_sync_init(void)
+{
+    SIZE_T size = 0;
+    void *ptr = NULL;
+    HANDLE handle = 0;
+
+    SERVER_START_REQ( get_inproc_sync_section )
+    {
+        if (!wine_server_call( req )) handle = wine_server_ptr_handle( reply->handle );
+    }
+    SERVER_END_REQ;
+    if (!handle) return;
+
+    if (!NtMapViewOfSection( handle, NtCurrentProcess(), &ptr, 0, 0, NULL, &size, ViewUnmap, 0, PAGE_READWRITE ))
+    {
+        TRACE( "using in-process synchronization objects\n" );
+        inproc_syncs = ptr;
+    }
+    NtClose( handle );
+}
+
+/***********************************************************************
+ *           inproc_sync_remove_from_cache
+ *
+ * Caller must hold fd_cache_mutex.
+ */
+void inproc_sync_remove_from_cache( HANDLE handle )
+{
+    unsigned int entry, idx = inproc_sync_handle_to_index( handle, &entry );
+
+    if (entry < INPROC_SYNC_CACHE_ENTRIES && inproc_sync_cache[entry])
+        interlocked_xchg64( &inproc_sync_cache[entry][idx].data, 0 );
+}
+
+/* caller must hold fd_cache_mutex */
+static void add_inproc_sync_to_cache( HANDLE handle, union inproc_sync_cache_entry cache )
+{
+    unsigned int entry, idx = inproc_sync_handle_to_index( handle, &entry );
+
+    if (entry >= INPROC_SYNC_CACHE_ENTRIES) return;
+    if (!inproc_sync_cache[entry])
+    {
+        void *ptr = anon_mmap_alloc( INPROC_SYNC_CACHE_BLOCK_SIZE * sizeof(union inproc_sync_cache_entry),
+                                     PROT_READ | PROT_WRITE );
+        if (ptr == MAP_FAILED) return;
+        inproc_sync_cache[entry] = ptr;
+    }
+    interlocked_xchg64( &inproc_sync_cache[entry][idx].data, cache.data );
+}
+
+/* return the shared slot of an event, mutex or semaphore, or NULL if the server has to handle it */
+static inproc_sync_shm_t *get_inproc_sync( HANDLE handle, unsigned int *type, unsigned int *access )
+{
+    unsigned int entry, idx = inproc_sync_handle_to_index( handle, &entry );
+    union inproc_sync_cache_entry cache;
+    sigset_t sigset;
+    NTSTATUS status;
+
+    if (!inproc_syncs) return NULL;
+    if (!handle || (HandleToLong( handle ) >= ~5 && HandleToLong( handle ) <= ~0)) return NULL;
+
+    if (entry < INPROC_SYNC_CACHE_ENTRIES && inproc_sync_cache[entry])
+        cache.data = InterlockedCompareExchange64( &inproc_sync_cache[entry][idx].data, 0, 0 );
+    else
+        cache.data = 0;
+
+    if (!cache.s.cached)
+    {
+        server_enter_uninterrupted_section( &fd_cache_mutex, &sigset );
+        SERVER_START_REQ( get_inproc_sync )
+        {
+            req->handle = wine_server_obj_handle( handle );
+            if (!(status = wine_server_call( req )))
+            {
+                cache.s.index  = reply->index;
+                cache.s.type   = reply->type;
+                cache.s.access = reply->access;
+            }
+        }
+        SERVER_END_REQ;
+        /* invalid handles are not cached, the server returns the right error for them */
+        if (!status || status == STATUS_OBJECT_TYPE_MISMATCH)
+        {
+            cache.s.cached = 1;
+            add_inproc_sync_to_cache( handle, cache );
+        }
+        server_leave_uninterrupted_section( &fd_cache_mutex, &sigset );
+        if (!cache.s.cached) return NULL;
+    }
+
+    if (cache.s.type == INPROC_SYNC_NONE) return NULL;
+    *type = cache.s.type;
+    *access = cache.s.access;
+    return &inproc_syncs[cache.s.index];
+}
+
+/* wake up the threads sleeping on a slot after the state has been changed in process */
+static void signal_inproc_sync( HANDLE handle, inproc_sync_shm_t *sync )
+{
+    InterlockedIncrement( (LONG *)&sync->serial );
+    if (ReadNoFence( (LONG *)&sync->waiters ))
+        syscall( __NR_futex, &sync->serial, FUTEX_WAKE, INT_MAX, NULL, 0, 0 );
+
+    if (!ReadNoFence( (LONG *)&sync->server_waiters )) return;
+
+    SERVER_START_REQ( signal_inproc_sync )
+    {
+        req->handle = wine_server_obj_handle( handle );
+        wine_server_call( req );
+    }
+    SERVER_END_REQ;
+}
+
+/* get the slot listing the mutexes owned by the current thread, so that the server can abandon them */
+static inproc_sync_shm_t *get_inproc_owned_list(void)
+{
+    struct ntdll_thread_data *thread_data = ntdll_get_thread_data();
+
+    if (!thread_data->inproc_sync)
+    {
+        SERVER_START_REQ( get_inproc_sync_thread )
+        {
+            if (!wine_server_call( req )) thread_data->inproc_sync = reply->index;
+        }
+        SERVER_END_REQ;
+        if (!thread_data->inproc_sync) return NULL;
+    }
+    return &inproc_syncs[thread_data->inproc_sync];
+}
+
+/* link a mutex just grabbed by the current thread to its list of owned mutexes */
+static void add_inproc_owned_mutex( inproc_sync_shm_t *sync )
+{
+    inproc_sync_shm_t *list = &inproc_syncs[ntdll_get_thread_data()->inproc_sync];
+
+    sync->next_owned = list->next_owned;
+    WriteRelease( (LONG *)&list->next_owned, sync - inproc_syncs );
+}
+
+/* unlink a mutex about to be released by the current thread */
+static void remove_inproc_owned_mutex( inproc_sync_shm_t *sync )
+{
+    unsigned int index = sync - inproc_syncs, slot = ntdll_get_thread_data()->inproc_sync;
+
+    /* mutexes grabbed through the server are tracked by the server instead */
+    while (slot)
+    {
+        if (inproc_syncs[slot].next_owned == index)
+        {
+            WriteRelease( (LONG *)&inproc_syncs[slot].next_owned, sync->next_owned );
+            sync->next_owned = 0;
+            return;
+        }
+        slot = inproc_syncs[slot].next_owned;
+    }
+}
+
+/* try to satisfy a wait on a slot, return STATUS_PENDING if it isn't signaled */
+static NTSTATUS acquire_inproc_sync( inproc_sync_shm_t *sync, unsigned int type )
+{
+    thread_id_t tid = HandleToULong( NtCurrentTeb()->ClientId.UniqueThread );
+    LONG64 state = ReadNoFence64( &sync->state ), new_state;
+
+    for (;;)
+    {
+        unsigned int count = INPROC_SYNC_COUNT( state );
+
+        switch (type)
+        {
+        case INPROC_SYNC_EVENT:
+            if (!count) return STATUS_PENDING;
+            if (sync->flags & INPROC_SYNC_MANUAL_RESET) return STATUS_SUCCESS;
+            new_state = 0;
+            break;
+        case INPROC_SYNC_SEMAPHORE:
+            if (!count) return STATUS_PENDING;
+            new_state = state - 1;
+            break;
+        case INPROC_SYNC_MUTEX:
+            if (count && INPROC_SYNC_OWNER( state ) != tid) return STATUS_PENDING;
+            if (count == MAXLONG) return STATUS_MUTANT_LIMIT_EXCEEDED;
+            new_state = INPROC_SYNC_STATE( count + 1, tid );
+            break;
+        default:
+            return STATUS_OBJECT_TYPE_MISMATCH;
+        }
+
+        if (InterlockedCompareExchange64( &sync->state, new_state, state ) == state) break;
+        state = ReadNoFence64( &sync->state );
+    }
+
+    if (type != INPROC_SYNC_MUTEX || INPROC_SYNC_COUNT( state )) return STATUS_SUCCESS;
+    add_inproc_owned_mutex( sync );
+    if (InterlockedAnd( (LONG *)&sync->flags, ~INPROC_SYNC_ABANDONED ) & INPROC_SYNC_ABANDONED)
+        return STATUS_ABANDONED;
+    return STATUS_SUCCESS;
+}
+
+/* check if an event was pulsed since the thread started waiting on it */
+static BOOL acquire_inproc_pulse( inproc_sync_shm_t *sync, unsigned int pulse )
+{
+    unsigned int current = ReadAcquire( (LONG *)&sync->pulse );
+
+    if ((current & ~1) == (pulse & ~1)) return FALSE;
+    if (sync->flags & INPROC_SYNC_MANUAL_RESET) return TRUE;
+    /* only one thread gets an auto-reset pulse */
+    return (current & 1) && InterlockedCompareExchange( (LONG *)&sync->pulse, current & ~1, current ) == current;
+}
+
+static ULONGLONG inproc_monotonic_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec * (ULONGLONG)TICKSPERSEC + ts.tv_nsec / 100;
+}
+
+/* sleep until the serial of one of the slots changes, or the monotonic deadline expires */
+static int inproc_futex_wait( inproc_sync_shm_t **syncs, const unsigned int *serials, DWORD count,
+                              ULONGLONG deadline )
+{
+    struct inproc_futex_waitv waitv[MAXIMUM_WAIT_OBJECTS];
+    struct inproc_kernel_timespec end;
+    struct timespec timeout;
+    ULONGLONG now;
+    DWORD i;
+
+    if (count == 1)
+    {
+        if (deadline == TIMEOUT_INFINITE)
+            return syscall( __NR_futex, &syncs[0]->serial, FUTEX_WAIT, serials[0], NULL, 0, 0 );
+        if ((now = inproc_monotonic_time()) >= deadline)
+        {
+            errno = ETIMEDOUT;
+            return -1;
+        }
+        timeout.tv_sec = (deadline - now) / TICKSPERSEC;
+        timeout.tv_nsec = (deadline - now) % TICKSPERSEC * 100;
+#if (defined(__i386__) || defined(__arm__)) && _TIME_BITS==64
+        if (sizeof(timeout.tv_sec) != sizeof(long))
+        {
+            struct
+            {
+                long tv_sec;
+                long tv_nsec;
+            } timeout32 = { timeout.tv_sec, timeout.tv_nsec };
+
+            return syscall( __NR_futex, &syncs[0]->serial, FUTEX_WAIT, serials[0], &timeout32, 0, 0 );
+        }
+#endif
+        return syscall( __NR_futex, &syncs[0]->serial, FUTEX_WAIT, serials[0], &timeout, 0, 0 );
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        waitv[i].val      = serials[i];
+        waitv[i].uaddr    = (ULONG_PTR)&syncs[i]->serial;
+        waitv[i].flags    = INPROC_FUTEX_32;
+        waitv[i].reserved = 0;
+    }
+    if (deadline == TIMEOUT_INFINITE)
+        return syscall( __NR_futex_waitv, waitv, count, 0, NULL, CLOCK_MONOTONIC );
+    end.tv_sec = deadline / TICKSPERSEC;
+    end.tv_nsec = deadline % TICKSPERSEC * 100;
+    return syscall( __NR_futex_waitv, waitv, count, 0, &end, CLOCK_MONOTONIC );
+}
+
+/***********************************************************************
+ *           inproc_wait
+ *
+ * Wait for any of the objects without going through the server, return
+ * STATUS_NOT_IMPLEMENTED if the server has to handle the wait.
+ */
+static NTSTATUS inproc_wait( DWORD count, const HANDLE *handles, const LARGE_INTEGER *timeout )
+{
+    inproc_sync_shm_t *syncs[MAXIMUM_WAIT_OBJECTS];
+    unsigned int types[MAXIMUM_WAIT_OBJECTS], serials[MAXIMUM_WAIT_OBJECTS], pulses[MAXIMUM_WAIT_OBJECTS], access;
+    ULONGLONG deadline = TIMEOUT_INFINITE;
+    LARGE_INTEGER now;
+    NTSTATUS status;
+    DWORD i, j;
+    int err;
+
+    if (count > 1 && !futex_waitv_supported) return STATUS_NOT_IMPLEMENTED;
+
+    for (i = 0; i < count; i++)
+    {
+        if (!(syncs[i] = get_inproc_sync( handles[i], &types[i], &access ))) return STATUS_NOT_IMPLEMENTED;
+        if (!(access & SYNCHRONIZE)) return STATUS_NOT_IMPLEMENTED;
+        if (types[i] == INPROC_SYNC_MUTEX && !get_inproc_owned_list()) return STATUS_NOT_IMPLEMENTED;
+    }
+
+    if (timeout && timeout->QuadPart != TIMEOUT_INFINITE)
+    {
+        LONGLONG remaining = -timeout->QuadPart;
+
+        if (timeout->QuadPart > 0)
+        {
+            NtQuerySystemTime( &now );
+            remaining = timeout->QuadPart - now.QuadPart;
+        }
+        deadline = inproc_monotonic_time() + max( remaining, 0 );
+    }
+
+    for (;;)
+    {
+        for (i = 0; i < count; i++)
+        {
+            if ((status = acquire_inproc_sync( syncs[i], types[i] )) == STATUS_PENDING) continue;
+            if (status == STATUS_ABANDONED) return STATUS_ABANDONED_WAIT_0 + i;
+            return status ? status : STATUS_WAIT_0 + i;
+        }
+        if (timeout && !timeout->QuadPart) return STATUS_TIMEOUT;
+
+        /* register as a waiter before checking again, so that a signal in between bumps the serial */
+        for (i = 0; i < count; i++)
+        {
+            InterlockedIncrement( (LONG *)&syncs[i]->waiters );
+            pulses[i] = ReadAcquire( (LONG *)&syncs[i]->pulse );
+            serials[i] = ReadAcquire( (LONG *)&syncs[i]->serial );
+        }
+        for (i = 0; i < count; i++)
+            if ((status = acquire_inproc_sync( syncs[i], types[i] )) != STATUS_PENDING) break;
+        if (i == count && inproc_futex_wait( syncs, serials, count, deadline ) == -1) err = errno;
+        else err = 0;
+        /* the server resets a pulsed event right away, the sleeping threads only see the pulse count */
+        if (i == count)
+        {
+            for (i = 0; i < count; i++)
+                if (types[i] == INPROC_SYNC_EVENT && acquire_inproc_pulse( syncs[i], pulses[i] )) break;
+            status = STATUS_SUCCESS;
+        }
+        for (j = 0; j < count; j++) InterlockedDecrement( (LONG *)&syncs[j]->waiters );
+
+        if (i < count)
+        {
+            if (status == STATUS_ABANDONED) return STATUS_ABANDONED_WAIT_0 + i;
+            return status ? status : STATUS_WAIT_0 + i;
+        }
+        if (err == ETIMEDOUT) return STATUS_TIMEOUT;
+        if (err == ENOSYS)
+        {
+            futex_waitv_supported = FALSE;
+            return STATUS_NOT_IMPLEMENTED;
+        }
+    }
+}
+
+#else  /* __linux__ */
+
+void inproc_sync_init(void)
+{
+}
+
+void inproc_sync_remove_from_cache( HANDLE handle )
+{
+}
+
+static inline inproc_sync_shm_t *get_inproc_sync( HANDLE handle, unsigned int *type, unsigned int *access )
+{
+    return NULL;
+}
+
+static inline void signal_inproc_sync( HANDLE handle, inproc_sync_shm_t *sync )
+{
+}
+
+static inline NTSTATUS inproc_wait( DWORD count, const HANDLE *handles, const LARGE_INTEGER *timeout )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+#endif  /* __linux__ */
+
 /* create a struct security_descriptor and contained information in one contiguous piece of memory */
 unsigned int alloc_object_attributes( const OBJECT_ATTRIBUTES *attr, struct object_attributes **ret,
                                       data_size_t *ret_len )
@@ -362,8 +793,9 @@ NTSTATUS WINAPI NtOpenSemaphore( HANDLE *handle, ACCESS_MASK access, const OBJEC
 NTSTATUS WINAPI NtQuerySemaphore( HANDLE handle, SEMAPHORE_INFORMATION_CLASS class,
                                   void *info, ULONG len, ULONG *ret_len )
 {
-    unsigned int ret;
+    unsigned int ret, type, access;
     SEMAPHORE_BASIC_INFORMATION *out = info;
+    inproc_sync_shm_t *sync;
 
     TRACE("(%p, %u, %p, %u, %p)\n", handle, class, info, (int)len, ret_len);
 
@@ -375,6 +807,15 @@ NTSTATUS WINAPI NtQuerySemaphore( HANDLE handle, SEMAPHORE_INFORMATION_CLASS cla
 
     if (len != sizeof(SEMAPHORE_BASIC_INFORMATION)) return STATUS_INFO_LENGTH_MISMATCH;
 
+    if ((sync = get_inproc_sync( handle, &type, &access )) && type == INPROC_SYNC_SEMAPHORE)
+    {
+        if (!(access & SEMAPHORE_QUERY_STATE)) return STATUS_ACCESS_DENIED;
+        out->CurrentCount = INPROC_SYNC_COUNT( ReadNoFence64( &sync->state ));
+        out->MaximumCount = sync->max;
+        if (ret_len) *ret_len = sizeof(SEMAPHORE_BASIC_INFORMATION);
+        return STATUS_SUCCESS;
+    }
+
     SERVER_START_REQ( query_semaphore )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -395,7 +836,23 @@ NTSTATUS WINAPI NtQuerySemaphore( HANDLE handle, SEMAPHORE_INFORMATION_CLASS cla
  */
 NTSTATUS WINAPI NtReleaseSemaphore( HANDLE handle, ULONG count, ULONG *previous )
 {
-    unsigned int ret;
+    unsigned int ret, type, access, current;
+    inproc_sync_shm_t *sync;
+    LONG64 state, prev;
+
+    if ((sync = get_inproc_sync( handle, &type, &access )) && type == INPROC_SYNC_SEMAPHORE)
+    {
+        if (!(access & SEMAPHORE_MODIFY_STATE)) return STATUS_ACCESS_DENIED;
+        for (state = ReadNoFence64( &sync->state );; state = prev)
+        {
+            current = INPROC_SYNC_COUNT( state );
+            if (current + count < current || current + count > sync->max) return STATUS_SEMAPHORE_LIMIT_EXCEEDED;
+            if ((prev = InterlockedCompareExchange64( &sync->state, state + count, state )) == state) break;
+        }
+        if (previous) *previous = current;
+        signal_inproc_sync( handle, sync );
+        return STATUS_SUCCESS;
+    }
 
     SERVER_START_REQ( release_semaphore )
     {
@@ -471,7 +928,18 @@ NTSTATUS WINAPI NtOpenEvent( HANDLE *handle, ACCESS_MASK access, const OBJECT_AT
  */
 NTSTATUS WINAPI NtSetEvent( HANDLE handle, LONG *prev_state )
 {
-    unsigned int ret;
+    unsigned int ret, type, access;
+    inproc_sync_shm_t *sync;
+    LONG64 prev;
+
+    if ((sync = get_inproc_sync( handle, &type, &access )) && type == INPROC_SYNC_EVENT)
+    {
+        if (!(access & EVENT_MODIFY_STATE)) return STATUS_ACCESS_DENIED;
+        prev = interlocked_xchg64( (LONG64 *)&sync->state, INPROC_SYNC_STATE( 1, 0 ));
+        if (prev_state) *prev_state = INPROC_SYNC_COUNT( prev );
+        if (!prev) signal_inproc_sync( handle, sync );
+        return STATUS_SUCCESS;
+    }
 
     SERVER_START_REQ( event_op )
     {
@@ -490,7 +958,17 @@ NTSTATUS WINAPI NtSetEvent( HANDLE handle, LONG *prev_state )
  */
 NTSTATUS WINAPI NtResetEvent( HANDLE handle, LONG *prev_state )
 {
-    unsigned int ret;
+    unsigned int ret, type, access;
+    inproc_sync_shm_t *sync;
+    LONG64 prev;
+
+    if ((sync = get_inproc_sync( handle, &type, &access )) && type == INPROC_SYNC_EVENT)
+    {
+        if (!(access & EVENT_MODIFY_STATE)) return STATUS_ACCESS_DENIED;
+        prev = interlocked_xchg64( (LONG64 *)&sync->state, 0 );
+        if (prev_state) *prev_state = INPROC_SYNC_COUNT( prev );
+        return STATUS_SUCCESS;
+    }
 
     SERVER_START_REQ( event_op )
     {
@@ -539,8 +1017,9 @@ NTSTATUS WINAPI NtPulseEvent( HANDLE handle, LONG *prev_state )
 NTSTATUS WINAPI NtQueryEvent( HANDLE handle, EVENT_INFORMATION_CLASS class,
                               void *info, ULONG len, ULONG *ret_len )
 {
-    unsigned int ret;
+    unsigned int ret, type, access;
     EVENT_BASIC_INFORMATION *out = info;
+    inproc_sync_shm_t *sync;
 
     TRACE("(%p, %u, %p, %u, %p)\n", handle, class, info, (int)len, ret_len);
 
@@ -552,6 +1031,15 @@ NTSTATUS WINAPI NtQueryEvent( HANDLE handle, EVENT_INFORMATION_CLASS class,
 
     if (len != sizeof(EVENT_BASIC_INFORMATION)) return STATUS_INFO_LENGTH_MISMATCH;
 
+    if ((sync = get_inproc_sync( handle, &type, &access )) && type == INPROC_SYNC_EVENT)
+    {
+        if (!(access & EVENT_QUERY_STATE)) return STATUS_ACCESS_DENIED;
+        out->EventType  = (sync->flags & INPROC_SYNC_MANUAL_RESET) ? NotificationEvent : SynchronizationEvent;
+        out->EventState = INPROC_SYNC_COUNT( ReadNoFence64( &sync->state ));
+        if (ret_len) *ret_len = sizeof(EVENT_BASIC_INFORMATION);
+        return STATUS_SUCCESS;
+    }
+
     SERVER_START_REQ( query_event )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -625,7 +1113,28 @@ NTSTATUS WINAPI NtOpenMutant( HANDLE *handle, ACCESS_MASK access, const OBJECT_A
  */
 NTSTATUS WINAPI NtReleaseMutant( HANDLE handle, LONG *prev_count )
 {
-    unsigned int ret;
+    thread_id_t tid = HandleToULong( NtCurrentTeb()->ClientId.UniqueThread );
+    unsigned int ret, type, access, count;
+    inproc_sync_shm_t *sync;
+    LONG64 state, prev;
+
+    if ((sync = get_inproc_sync( handle, &type, &access )) && type == INPROC_SYNC_MUTEX)
+    {
+        for (state = ReadNoFence64( &sync->state );; state = prev)
+        {
+            if (!(count = INPROC_SYNC_COUNT( state )) || INPROC_SYNC_OWNER( state ) != tid)
+            {
+                if (prev_count) *prev_count = 1;
+                return STATUS_MUTANT_NOT_OWNED;
+            }
+            /* nobody else can change the state of an owned mutex, it is safe to unlink it first */
+            if (count == 1) remove_inproc_owned_mutex( sync );
+            if ((prev = InterlockedCompareExchange64( &sync->state, count > 1 ? state - 1 : 0, state )) == state) break;
+        }
+        if (prev_count) *prev_count = 1 - count;
+        if (count == 1) signal_inproc_sync( handle, sync );
+        return STATUS_SUCCESS;
+    }
 
     SERVER_START_REQ( release_mutex )
     {
@@ -644,8 +1153,10 @@ NTSTATUS WINAPI NtReleaseMutant( HANDLE handle, LONG *prev_count )
 NTSTATUS WINAPI NtQueryMutant( HANDLE handle, MUTANT_INFORMATION_CLASS class,
                                void *info, ULONG len, ULONG *ret_len )
 {
-    unsigned int ret;
+    unsigned int ret, type, access;
     MUTANT_BASIC_INFORMATION *out = info;
+    inproc_sync_shm_t *sync;
+    LONG64 state;
 
     TRACE("(%p, %u, %p, %u, %p)\n", handle, class, info, (int)len, ret_len);
 
@@ -657,6 +1168,18 @@ NTSTATUS WINAPI NtQueryMutant( HANDLE handle, MUTANT_INFORMATION_CLASS class,
 
     if (len != sizeof(MUTANT_BASIC_INFORMATION)) return STATUS_INFO_LENGTH_MISMATCH;
 
+    if ((sync = get_inproc_sync( handle, &type, &access )) && type == INPROC_SYNC_MUTEX)
+    {
+        if (!(access & MUTANT_QUERY_STATE)) return STATUS_ACCESS_DENIED;
+        state = ReadNoFence64( &sync->state );
+        out->CurrentCount   = 1 - INPROC_SYNC_COUNT( state );
+        out->OwnedByCaller  = INPROC_SYNC_COUNT( state ) &&
+                              INPROC_SYNC_OWNER( state ) == HandleToULong( NtCurrentTeb()->ClientId.UniqueThread );
+        out->AbandonedState = !!(sync->flags & INPROC_SYNC_ABANDONED);
+        if (ret_len) *ret_len = sizeof(MUTANT_BASIC_INFORMATION);
+        return STATUS_SUCCESS;
+    }
+
     SERVER_START_REQ( query_mutex )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -1574,9 +2097,15 @@ NTSTATUS WINAPI NtWaitForMultipleObjects( DWORD count, const HANDLE *handles, BO
 {
     union select_op select_op;
     UINT i, flags = SELECT_INTERRUPTIBLE;
+    NTSTATUS status;
 
     if (!count || count > MAXIMUM_WAIT_OBJECTS) return STATUS_INVALID_PARAMETER_1;
 
+    /* alertable and wait-all waits need the server to deliver APCs or grab all objects atomically */
+    if (!alertable && (wait_any || count == 1) &&
+        (status = inproc_wait( count, handles, timeout )) != STATUS_NOT_IMPLEMENTED)
+        return status;
+
     if (alertable) flags |= SELECT_ALERTABLE;
     select_op.wait.op = wait_any ? SELECT_WAIT : SELECT_WAIT_ALL;
     for (i = 0; i < count; i++) select_op.wait.handles[i] = wine_server_obj_handle( handles[i] );
@@ -3658,6 +3658,16 @@ NTSTATUS WINAPI NtQuerySystemInformation( SYSTEM_INFORMATION_CLASS class,
         break;
     }
 
+    case SystemWineLargePageMinimum:  /* 1001 */
+        len = sizeof(ULONG);
+        if (size >= len)
+        {
+            if (!info) ret = STATUS_ACCESS_VIOLATION;
+            else *(ULONG *)info = virtual_get_large_page_size();
+        }
+        else ret = STATUS_INFO_LENGTH_MISMATCH;
+        break;
+
     default:
 	FIXME( "(0x%08x,%p,0x%08x,%p) stub\n", class, info, (int)size, ret_size );
 
@@ -210,6 +210,8 @@ static void *preload_reserve_start;
 static void *preload_reserve_end;
 static BOOL force_exec_prot;  /* whether to force PROT_EXEC on all PROT_READ mmaps */
 static BOOL enable_write_exceptions;  /* raise exception on writes to executable memory */
+static size_t large_page_size = 2 * 1024 * 1024;  /* size of MEM_LARGE_PAGES pages */
+static size_t huge_page_threshold;  /* minimum size of regions given transparent huge pages, 0 if disabled */
 
 struct range_entry
 {
@@ -1777,6 +1779,8 @@ static NTSTATUS set_protection( struct file_view *view, void *base, SIZE_T size,
     NTSTATUS status;
 
     if ((status = get_vprot_flags( protect, &vprot, view->protect & SEC_IMAGE ))) return status;
+    if ((view->protect & SEC_LARGE_PAGES) && (((char *)base - (char *)view->base) | size) & (large_page_size - 1))
+        return STATUS_INVALID_PARAMETER;
     if (is_view_valloc( view ))
     {
         if (vprot & VPROT_WRITECOPY) return STATUS_INVALID_PAGE_PROTECTION;
@@ -3315,6 +3319,38 @@ static void *alloc_virtual_heap( SIZE_T size )
 /***********************************************************************
  *           virtual_init
  */
+/* find the size of the large pages and whether transparent huge pages are wanted */
+static void init_large_pages(void)
+{
+#ifdef __linux__
+    unsigned long value;
+    const char *env;
+    char buffer[64];
+    FILE *f;
+
+    if ((f = fopen( "/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", "r" )))
+    {
+        if (fscanf( f, "%lu", &value ) != 1) value = 0;
+        fclose( f );
+    }
+    else if ((f = fopen( "/proc/meminfo", "r" )))
+    {
+        value = 0;
+        while (fgets( buffer, sizeof(buffer), f ))
+            if (sscanf( buffer, "Hugepagesize: %lu kB", &value ) == 1) break;
+        value *= 1024;
+        fclose( f );
+    }
+    else value = 0;
+
+    if (value > granularity_mask && !(value & (value - 1))) large_page_size = value;
+
+    if ((env = getenv( "WINEHUGEPAGES" )) && atoi( env ))
+        huge_page_threshold = max( 32 * 1024 * 1024, 16 * large_page_size );
+    TRACE( "large page size %#zx, huge page threshold %#zx\n", large_page_size, huge_page_threshold );
+#endif
+}
+
 void virtual_init(void)
 {
     const struct preload_info **preload_info = dlsym( RTLD_DEFAULT, "wine_main_preload_info" );
@@ -3340,6 +3376,7 @@ void virtual_init(void)
             mmap_add_reserved_area( (*preload_info)[i].addr, (*preload_info)[i].size );
 
     mmap_init( preload_info ? *preload_info : NULL );
+    init_large_pages();
 
     if ((preload = getenv("WINEPRELOADRESERVE")))
     {
@@ -3389,6 +3426,15 @@ ULONG_PTR get_system_affinity_mask(void)
     return ((ULONG_PTR)1 << num_cpus) - 1;
 }
 
+/***********************************************************************
+ *           virtual_get_large_page_size
+ */
+SIZE_T virtual_get_large_page_size(void)
+{
+    return large_page_size;
+}
+
+
 /***********************************************************************
  *           virtual_get_system_info
  */
@@ -4526,6 +4572,59 @@ void virtual_set_large_address_space(void)
 }
 
 
+/***********************************************************************
+ *             has_lock_memory_privilege
+ *
+ * MEM_LARGE_PAGES needs SeLockMemoryPrivilege to be enabled in the caller's token.
+ */
+static BOOL has_lock_memory_privilege(void)
+{
+    PRIVILEGE_SET privs;
+    BOOLEAN ret = FALSE;
+    HANDLE token;
+
+    if (NtOpenThreadTokenEx( NtCurrentThread(), TOKEN_QUERY, TRUE, 0, &token ) &&
+        NtOpenProcessTokenEx( NtCurrentProcess(), TOKEN_QUERY, 0, &token ))
+        return FALSE;
+
+    privs.PrivilegeCount = 1;
+    privs.Control = PRIVILEGE_SET_ALL_NECESSARY;
+    privs.Privilege[0].Luid.LowPart = SE_LOCK_MEMORY_PRIVILEGE;
+    privs.Privilege[0].Luid.HighPart = 0;
+    privs.Privilege[0].Attributes = 0;
+    if (NtPrivilegeCheck( token, &privs, &ret )) ret = FALSE;
+    NtClose( token );
+    return ret;
+}
+
+
+/***********************************************************************
+ *             map_large_pages
+ *
+ * Back a MEM_LARGE_PAGES view with huge pages, if the system has any left.
+ * virtual_mutex must be held by caller.
+ */
+static void map_large_pages( struct file_view *view, unsigned int vprot )
+{
+#ifdef MAP_HUGETLB
+    int unix_prot = get_unix_prot( vprot );
+
+    if (anon_mmap_fixed( view->base, view->size, unix_prot, MAP_HUGETLB ) != MAP_FAILED)
+    {
+        TRACE( "mapped %p-%p with huge pages\n", view->base, (char *)view->base + view->size );
+        view->protect |= SEC_LARGE_PAGES;
+        return;
+    }
+    WARN( "no huge pages for %p-%p, errno %d\n", view->base, (char *)view->base + view->size, errno );
+    /* a failed fixed mapping may have removed the previous one */
+    anon_mmap_fixed( view->base, view->size, unix_prot, 0 );
+#endif
+#ifdef MADV_HUGEPAGE
+    madvise( view->base, view->size, MADV_HUGEPAGE );
+#endif
+}
+
+
 /***********************************************************************
  *             allocate_virtual_memory
  *
@@ -4583,6 +4682,24 @@ static NTSTATUS allocate_virtual_memory( void **ret, SIZE_T *size_ptr, ULONG typ
     if (type & MEM_RESERVE_PLACEHOLDER && (protect != PAGE_NOACCESS)) return STATUS_INVALID_PARAMETER;
     if (!arm64ec_view && (attributes & MEM_EXTENDED_PARAMETER_EC_CODE)) return STATUS_INVALID_PARAMETER;
 
+    if (type & MEM_LARGE_PAGES)
+    {
+        /* large pages are always reserved and committed at once, in whole pages */
+        if ((type & (MEM_RESERVE | MEM_COMMIT)) != (MEM_RESERVE | MEM_COMMIT)) return STATUS_INVALID_PARAMETER;
+        if (type & (MEM_WRITE_WATCH | MEM_RESERVE_PLACEHOLDER | MEM_REPLACE_PLACEHOLDER))
+            return STATUS_INVALID_PARAMETER;
+        if (is_dos_memory || ((UINT_PTR)base | size) & (large_page_size - 1)) return STATUS_INVALID_PARAMETER;
+        if (!has_lock_memory_privilege()) return STATUS_PRIVILEGE_NOT_HELD;
+        if (align < large_page_size) align = large_page_size;
+    }
+    else if (huge_page_threshold && size >= huge_page_threshold && !base && !align &&
+             (type & (MEM_RESERVE | MEM_COMMIT)) == (MEM_RESERVE | MEM_COMMIT) &&
+             !(type & (MEM_WRITE_WATCH | MEM_RESERVE_PLACEHOLDER)))
+    {
+        /* align big heaps so that the kernel can use transparent huge pages for them */
+        align = large_page_size;
+    }
+
     /* Reserve the memory */
 
     server_enter_uninterrupted_section( &virtual_mutex, &sigset );
@@ -4601,7 +4718,15 @@ static NTSTATUS allocate_virtual_memory( void **ret, SIZE_T *size_ptr, ULONG typ
             else status = map_view( &view, base, size, type, vprot, limit_low, limit_high,
                                     align ? align - 1 : granularity_mask );
 
-            if (status == STATUS_SUCCESS) base = view->base;
+            if (status == STATUS_SUCCESS)
+            {
+                base = view->base;
+                if (type & MEM_LARGE_PAGES) map_large_pages( view, vprot );
+#ifdef MADV_HUGEPAGE
+                else if (align == large_page_size && huge_page_threshold && size >= huge_page_threshold)
+                    madvise( base, size, MADV_HUGEPAGE );
+#endif
+            }
         }
     }
     else if (type & MEM_RESET)
@@ -4656,7 +4781,8 @@ static NTSTATUS allocate_virtual_memory( void **ret, SIZE_T *size_ptr, ULONG typ
 NTSTATUS WINAPI NtAllocateVirtualMemory( HANDLE process, PVOID *ret, ULONG_PTR zero_bits,
                                          SIZE_T *size_ptr, ULONG type, ULONG protect )
 {
-    static const ULONG type_mask = MEM_COMMIT | MEM_RESERVE | MEM_TOP_DOWN | MEM_WRITE_WATCH | MEM_RESET;
+    static const ULONG type_mask = MEM_COMMIT | MEM_RESERVE | MEM_TOP_DOWN | MEM_WRITE_WATCH | MEM_RESET
+                                   | MEM_LARGE_PAGES;
     ULONG_PTR limit;
 
     TRACE("%p %p %08lx %x %08x\n", process, *ret, *size_ptr, (int)type, (int)protect );
@@ -4796,7 +4922,8 @@ NTSTATUS WINAPI NtAllocateVirtualMemoryEx( HANDLE process, PVOID *ret, SIZE_T *s
                                            ULONG count )
 {
     static const ULONG type_mask = MEM_COMMIT | MEM_RESERVE | MEM_TOP_DOWN | MEM_WRITE_WATCH
-                                   | MEM_RESET | MEM_RESERVE_PLACEHOLDER | MEM_REPLACE_PLACEHOLDER;
+                                   | MEM_RESET | MEM_RESERVE_PLACEHOLDER | MEM_REPLACE_PLACEHOLDER
+                                   | MEM_LARGE_PAGES;
     ULONG_PTR limit_low = 0;
     ULONG_PTR limit_high = 0;
     ULONG_PTR align = 0;
@@ -4906,6 +5033,8 @@ NTSTATUS WINAPI NtFreeVirtualMemory( HANDLE process, PVOID *addr_ptr, SIZE_T *si
     else if (!size && base != view->base) status = STATUS_FREE_VM_NOT_AT_BASE;
     else if ((char *)view->base + view->size - base < size && !(type & MEM_COALESCE_PLACEHOLDERS))
              status = STATUS_UNABLE_TO_FREE_VM;
+    else if ((view->protect & SEC_LARGE_PAGES) && ((base - (char *)view->base) | size) & (large_page_size - 1))
+        status = STATUS_INVALID_PARAMETER;  /* huge pages cannot be split */
     else switch (type)
     {
     case MEM_DECOMMIT:
@@ -5275,6 +5404,7 @@ static void fill_working_set_info( struct fill_working_set_info_data *d, struct
             p->VirtualAttributes.ShareCount = 1; /* FIXME */
         if (p->VirtualAttributes.Valid)
             p->VirtualAttributes.Win32Protection = get_win32_prot( vprot, view->protect );
+        p->VirtualAttributes.LargePage = p->VirtualAttributes.Valid && (view->protect & SEC_LARGE_PAGES);
     }
 }
 #else
@@ -5348,6 +5478,7 @@ static void fill_working_set_info( struct fill_working_set_info_data *d, struct
             p->VirtualAttributes.ShareCount = 1; /* FIXME */
         if (p->VirtualAttributes.Valid)
             p->VirtualAttributes.Win32Protection = get_win32_prot( vprot, view->protect );
+        p->VirtualAttributes.LargePage = p->VirtualAttributes.Valid && (view->protect & SEC_LARGE_PAGES);
     }
 }
 #endif
@@ -76,6 +76,7 @@ enum ntdll_unix_funcs
     unix_wine_server_handle_to_fd,
     unix_wine_spawnvp,
     unix_system_time_precise,
+    unix_io_uring_completions,
 };
 
 extern unixlib_handle_t __wine_unixlib_handle;
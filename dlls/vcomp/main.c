@@ -45,6 +45,7 @@ static int     vcomp_max_threads;
 static int     vcomp_num_threads;
 static int     vcomp_num_procs;
 static BOOL    vcomp_nested_fork = FALSE;
+static unsigned int vcomp_spin_count = 20000;
 
 static RTL_CRITICAL_SECTION vcomp_section;
 static RTL_CRITICAL_SECTION_DEBUG critsect_debug =
@@ -70,7 +71,7 @@ struct vcomp_thread_data
 
     /* only used for concurrent tasks */
     struct list             entry;
-    CONDITION_VARIABLE      cond;
+    LONG                    wake;
 
     /* single */
     unsigned int            single;
@@ -87,9 +88,8 @@ struct vcomp_thread_data
 
 struct vcomp_team_data
 {
-    CONDITION_VARIABLE      cond;
     int                     num_threads;
-    int                     finished_threads;
+    LONG                    finished_threads;
 
     /* callback arguments */
     int                     nargs;
@@ -97,27 +97,39 @@ struct vcomp_team_data
     va_list                 valist;
 
     /* barrier */
-    unsigned int            barrier;
-    int                     barrier_count;
+    LONG                    barrier;
+    LONG                    barrier_count;
 };
 
+struct vcomp_dynamic_loop
+{
+    unsigned int            first;
+    unsigned int            last;
+    unsigned int            iterations;
+    int                     step;
+    unsigned int            chunksize;
+};
+
+/* Sections and dynamic loops are handed out without locking: the first thread
+ * reaching a construct claims it, fills the parameters in the slot for its
+ * parity and publishes a state holding the construct number in the high and
+ * the amount of work already taken in the low 32 bits. The other threads then
+ * take their share with a compare and swap on that state, which fails as soon
+ * as a later construct replaces it. */
 struct vcomp_task_data
 {
     /* single */
-    unsigned int            single;
+    LONG                    single;
 
     /* section */
-    unsigned int            section;
-    int                     num_sections;
-    int                     section_index;
+    LONG                    section;
+    LONG64 DECLSPEC_ALIGN(8) section_state;
+    int                     num_sections[2];
 
     /* dynamic */
-    unsigned int            dynamic;
-    unsigned int            dynamic_first;
-    unsigned int            dynamic_last;
-    unsigned int            dynamic_iterations;
-    int                     dynamic_step;
-    unsigned int            dynamic_chunksize;
+    LONG                    dynamic;
+    LONG64 DECLSPEC_ALIGN(8) dynamic_state;
+    struct vcomp_dynamic_loop dynamic_loop[2];
 };
 
 extern void CDECL _vcomp_fork_call_wrapper(void *wrapper, int nargs, void **args);
@@ -231,6 +243,77 @@ static short interlocked_xchg_add16(short *dest, short incr)
 
 #endif  /* __GNUC__ */
 
+/* 64-bit counterpart of ReadAcquire, a torn read on i386 is caught by the
+ * compare and swap that always follows it */
+static inline LONG64 read_acquire64(LONG64 volatile *src)
+{
+    LONG64 value = ReadNoFence64(src);
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+    __asm__ __volatile__( "" ::: "memory" );
+#else
+    MemoryBarrier();
+#endif
+    return value;
+}
+
+/* wait until the value changes, spinning first as allowed by OMP_WAIT_POLICY */
+static BOOL vcomp_wait_value(LONG volatile *addr, LONG value, const LARGE_INTEGER *timeout)
+{
+    unsigned int spin;
+
+    for (spin = 0; spin < vcomp_spin_count; spin++)
+    {
+        if (ReadAcquire(addr) != value) return TRUE;
+        YieldProcessor();
+    }
+    while (ReadAcquire(addr) == value)
+    {
+        if (RtlWaitOnAddress((const void *)addr, &value, sizeof(value), timeout) == STATUS_TIMEOUT)
+            return ReadAcquire(addr) != value;
+    }
+    return TRUE;
+}
+
+/* claim a construct for the calling thread, returns TRUE if it is the first one to get there */
+static BOOL vcomp_claim(LONG volatile *last, unsigned int num)
+{
+    LONG cur = ReadAcquire(last), prev;
+
+    while ((int)(num - cur) > 0)
+    {
+        if ((prev = InterlockedCompareExchange(last, num, cur)) == cur) return TRUE;
+        cur = prev;
+    }
+    return FALSE;
+}
+
+/* publish a construct once its parameters are filled in */
+static void vcomp_set_state(LONG64 volatile *state, unsigned int num)
+{
+    LONG64 value = read_acquire64(state), prev;
+
+    while ((prev = InterlockedCompareExchange64(state, (LONG64)num << 32, value)) != value)
+        value = prev;
+}
+
+/* get the state of a construct, waiting for the thread which claimed it to publish it */
+static BOOL vcomp_get_state(LONG64 volatile *state, unsigned int num, LONG64 *ret)
+{
+    for (;;)
+    {
+        LONG64 value = read_acquire64(state);
+        int diff = (unsigned int)(value >> 32) - num;
+
+        if (!diff)
+        {
+            *ret = value;
+            return TRUE;
+        }
+        if (diff > 0) return FALSE;
+        YieldProcessor();
+    }
+}
+
 static inline struct vcomp_thread_data *vcomp_get_thread_data(void)
 {
     return (struct vcomp_thread_data *)TlsGetValue(vcomp_context_tls);
@@ -906,26 +989,22 @@ void CDECL _vcomp_flush(void)
 void CDECL _vcomp_barrier(void)
 {
     struct vcomp_team_data *team_data = vcomp_init_thread_data()->team;
+    LONG barrier;
 
     TRACE("()\n");
 
     if (!team_data)
         return;
 
-    EnterCriticalSection(&vcomp_section);
-    if (++team_data->barrier_count >= team_data->num_threads)
+    /* the barrier counter flips to a new value each time the whole team got there */
+    barrier = ReadAcquire(&team_data->barrier);
+    if (InterlockedIncrement(&team_data->barrier_count) >= team_data->num_threads)
     {
-        team_data->barrier++;
-        team_data->barrier_count = 0;
-        WakeAllConditionVariable(&team_data->cond);
+        WriteNoFence(&team_data->barrier_count, 0);
+        InterlockedIncrement(&team_data->barrier);
+        RtlWakeAddressAll((const void *)&team_data->barrier);
     }
-    else
-    {
-        unsigned int barrier = team_data->barrier;
-        while (team_data->barrier == barrier)
-            SleepConditionVariableCS(&team_data->cond, &vcomp_section, INFINITE);
-    }
-    LeaveCriticalSection(&vcomp_section);
+    else vcomp_wait_value(&team_data->barrier, barrier, NULL);
 }
 
 void CDECL _vcomp_set_num_threads(int num_threads)
@@ -955,14 +1034,8 @@ int CDECL _vcomp_single_begin(int flags)
 
     TRACE("(%x): semi-stub\n", flags);
 
-    EnterCriticalSection(&vcomp_section);
     thread_data->single++;
-    if ((int)(thread_data->single - task_data->single) > 0)
-    {
-        task_data->single = thread_data->single;
-        ret = TRUE;
-    }
-    LeaveCriticalSection(&vcomp_section);
+    ret = vcomp_claim(&task_data->single, thread_data->single);
 
     return ret;
 }
@@ -980,33 +1053,35 @@ void CDECL _vcomp_sections_init(int n)
 
     TRACE("(%d)\n", n);
 
-    EnterCriticalSection(&vcomp_section);
     thread_data->section++;
-    if ((int)(thread_data->section - task_data->section) > 0)
+    if (vcomp_claim(&task_data->section, thread_data->section))
     {
-        task_data->section       = thread_data->section;
-        task_data->num_sections  = n;
-        task_data->section_index = 0;
+        task_data->num_sections[thread_data->section & 1] = n;
+        vcomp_set_state(&task_data->section_state, thread_data->section);
     }
-    LeaveCriticalSection(&vcomp_section);
 }
 
 int CDECL _vcomp_sections_next(void)
 {
     struct vcomp_thread_data *thread_data = vcomp_init_thread_data();
     struct vcomp_task_data *task_data = thread_data->task;
-    int i = -1;
+    LONG64 state, prev;
+    int i;
 
     TRACE("()\n");
 
-    EnterCriticalSection(&vcomp_section);
-    if (thread_data->section == task_data->section &&
-        task_data->section_index != task_data->num_sections)
+    if (!vcomp_get_state(&task_data->section_state, thread_data->section, &state))
+        return -1;
+
+    for (;;)
     {
-        i = task_data->section_index++;
+        i = (unsigned int)state;
+        if (i >= task_data->num_sections[thread_data->section & 1]) return -1;
+        if ((prev = InterlockedCompareExchange64(&task_data->section_state, state + 1, state)) == state)
+            return i;
+        if ((unsigned int)(prev >> 32) != thread_data->section) return -1;
+        state = prev;
     }
-    LeaveCriticalSection(&vcomp_section);
-    return i;
 }
 
 void CDECL _vcomp_for_static_simple_init(unsigned int first, unsigned int last, int step,
@@ -1316,19 +1391,19 @@ void CDECL _vcomp_for_dynamic_init(unsigned int flags, unsigned int first, unsig
             type = VCOMP_DYNAMIC_FLAGS_GUIDED;
         }
 
-        EnterCriticalSection(&vcomp_section);
         thread_data->dynamic++;
         thread_data->dynamic_type = type;
-        if ((int)(thread_data->dynamic - task_data->dynamic) > 0)
+        if (vcomp_claim(&task_data->dynamic, thread_data->dynamic))
         {
-            task_data->dynamic              = thread_data->dynamic;
-            task_data->dynamic_first        = first;
-            task_data->dynamic_last         = last;
-            task_data->dynamic_iterations   = iterations;
-            task_data->dynamic_step         = step;
-            task_data->dynamic_chunksize    = chunksize;
+            struct vcomp_dynamic_loop *loop = &task_data->dynamic_loop[thread_data->dynamic & 1];
+
+            loop->first         = first;
+            loop->last          = last;
+            loop->iterations    = iterations;
+            loop->step          = step;
+            loop->chunksize     = chunksize;
+            vcomp_set_state(&task_data->dynamic_state, thread_data->dynamic);
         }
-        LeaveCriticalSection(&vcomp_section);
     }
 }
 
@@ -1351,26 +1426,48 @@ int CDECL _vcomp_for_dynamic_next(unsigned int *begin, unsigned int *end)
     else if (thread_data->dynamic_type == VCOMP_DYNAMIC_FLAGS_CHUNKED ||
              thread_data->dynamic_type == VCOMP_DYNAMIC_FLAGS_GUIDED)
     {
-        unsigned int iterations = 0;
-        EnterCriticalSection(&vcomp_section);
-        if (thread_data->dynamic == task_data->dynamic &&
-            task_data->dynamic_iterations != 0)
+        struct vcomp_dynamic_loop *loop = &task_data->dynamic_loop[thread_data->dynamic & 1];
+        unsigned int first, last, total, chunksize, iterations, remaining, done;
+        LONG64 state, prev;
+        int step;
+
+        if (!vcomp_get_state(&task_data->dynamic_state, thread_data->dynamic, &state))
+            return 0;
+
+        /* once the state moves on, a thread running two nowait loops ahead may
+         * refill the slot, so only parameters read before a successful swap are
+         * known to belong to this loop */
+        first       = loop->first;
+        last        = loop->last;
+        total       = loop->iterations;
+        step        = loop->step;
+        chunksize   = loop->chunksize;
+
+        for (;;)
         {
-            iterations = min(task_data->dynamic_iterations, task_data->dynamic_chunksize);
+            done = (unsigned int)state;
+            if (done >= total) return 0;
+
+            remaining  = total - done;
+            iterations = min(remaining, chunksize);
             if (thread_data->dynamic_type == VCOMP_DYNAMIC_FLAGS_GUIDED &&
-                task_data->dynamic_iterations > num_threads * task_data->dynamic_chunksize)
+                remaining > num_threads * chunksize)
             {
-                iterations = (task_data->dynamic_iterations + num_threads - 1) / num_threads;
+                iterations = (remaining + num_threads - 1) / num_threads;
             }
-            *begin = task_data->dynamic_first;
-            *end   = task_data->dynamic_first + (iterations - 1) * task_data->dynamic_step;
-            task_data->dynamic_iterations -= iterations;
-            task_data->dynamic_first      += iterations * task_data->dynamic_step;
-            if (!task_data->dynamic_iterations)
-                *end = task_data->dynamic_last;
+            if (!iterations) return 0;
+
+            if ((prev = InterlockedCompareExchange64(&task_data->dynamic_state, state + iterations, state)) == state)
+                break;
+            if ((unsigned int)(prev >> 32) != thread_data->dynamic) return 0;
+            state = prev;
         }
-        LeaveCriticalSection(&vcomp_section);
-        return iterations != 0;
+
+        *begin = first + done * step;
+        *end   = *begin + (iterations - 1) * step;
+        if (done + iterations == total)
+            *end = last;
+        return 1;
     }
 
     return 0;
@@ -1385,35 +1482,44 @@ int CDECL omp_in_parallel(void)
 static DWORD WINAPI _vcomp_fork_worker(void *param)
 {
     struct vcomp_thread_data *thread_data = param;
+    LARGE_INTEGER timeout;
+    LONG wake = 0;
+
     vcomp_set_thread_data(thread_data);
 
     TRACE("starting worker thread for %p\n", thread_data);
 
-    EnterCriticalSection(&vcomp_section);
+    timeout.QuadPart = (ULONGLONG)5000 * -10000;
     for (;;)
     {
-        struct vcomp_team_data *team = thread_data->team;
-        if (team != NULL)
+        struct vcomp_team_data *team;
+        int num_threads;
+
+        if (!vcomp_wait_value(&thread_data->wake, wake, &timeout))
         {
-            LeaveCriticalSection(&vcomp_section);
-            _vcomp_fork_call_wrapper(team->wrapper, team->nargs, ptr_from_va_list(team->valist));
-            EnterCriticalSection(&vcomp_section);
+            BOOL idle;
 
-            thread_data->team = NULL;
-            list_remove(&thread_data->entry);
-            list_add_tail(&vcomp_idle_threads, &thread_data->entry);
-            if (++team->finished_threads >= team->num_threads)
-                WakeAllConditionVariable(&team->cond);
+            EnterCriticalSection(&vcomp_section);
+            if ((idle = !thread_data->team)) list_remove(&thread_data->entry);
+            LeaveCriticalSection(&vcomp_section);
+            if (idle) break;
+            continue;
         }
 
-        if (!SleepConditionVariableCS(&thread_data->cond, &vcomp_section, 5000) &&
-            GetLastError() == ERROR_TIMEOUT && !thread_data->team)
-        {
-            break;
-        }
+        wake = ReadAcquire(&thread_data->wake);
+        team = thread_data->team;
+        num_threads = team->num_threads;
+        _vcomp_fork_call_wrapper(team->wrapper, team->nargs, ptr_from_va_list(team->valist));
+
+        EnterCriticalSection(&vcomp_section);
+        thread_data->team = NULL;
+        list_remove(&thread_data->entry);
+        list_add_tail(&vcomp_idle_threads, &thread_data->entry);
+        LeaveCriticalSection(&vcomp_section);
+
+        if (InterlockedIncrement(&team->finished_threads) >= num_threads)
+            RtlWakeAddressAll((const void *)&team->finished_threads);
     }
-    list_remove(&thread_data->entry);
-    LeaveCriticalSection(&vcomp_section);
 
     TRACE("terminating worker thread for %p\n", thread_data);
 
@@ -1443,7 +1549,6 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
     else
         num_threads = vcomp_num_threads;
 
-    InitializeConditionVariable(&team_data.cond);
     team_data.num_threads       = 1;
     team_data.finished_threads  = 0;
     team_data.nargs             = nargs;
@@ -1454,7 +1559,9 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
 
     task_data.single            = 0;
     task_data.section           = 0;
+    task_data.section_state     = 0;
     task_data.dynamic           = 0;
+    task_data.dynamic_state     = 0;
 
     thread_data.team            = &team_data;
     thread_data.task            = &task_data;
@@ -1466,10 +1573,10 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
     thread_data.dynamic         = 1;
     thread_data.dynamic_type    = 0;
     list_init(&thread_data.entry);
-    InitializeConditionVariable(&thread_data.cond);
 
     if (num_threads > 1)
     {
+        struct vcomp_thread_data *worker;
         struct list *ptr;
         EnterCriticalSection(&vcomp_section);
 
@@ -1488,7 +1595,6 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
             data->dynamic_type  = 0;
             list_remove(&data->entry);
             list_add_tail(&thread_data.entry, &data->entry);
-            WakeAllConditionVariable(&data->cond);
         }
 
         /* spawn additional threads */
@@ -1510,7 +1616,7 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
             data->section       = 1;
             data->dynamic       = 1;
             data->dynamic_type  = 0;
-            InitializeConditionVariable(&data->cond);
+            data->wake          = 0;
 
             thread = CreateThread(NULL, 0, _vcomp_fork_worker, data, 0, NULL);
             if (!thread)
@@ -1526,6 +1632,13 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
             CloseHandle(thread);
         }
 
+        /* start the threads only once the size of the team is final */
+        LIST_FOR_EACH_ENTRY(worker, &thread_data.entry, struct vcomp_thread_data, entry)
+        {
+            InterlockedIncrement(&worker->wake);
+            RtlWakeAddressAll((const void *)&worker->wake);
+        }
+
         LeaveCriticalSection(&vcomp_section);
     }
 
@@ -1536,13 +1649,13 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
 
     if (team_data.num_threads > 1)
     {
-        EnterCriticalSection(&vcomp_section);
-
-        team_data.finished_threads++;
-        while (team_data.finished_threads < team_data.num_threads)
-            SleepConditionVariableCS(&team_data.cond, &vcomp_section, INFINITE);
+        LONG finished = InterlockedIncrement(&team_data.finished_threads);
 
-        LeaveCriticalSection(&vcomp_section);
+        while (finished < team_data.num_threads)
+        {
+            vcomp_wait_value(&team_data.finished_threads, finished, NULL);
+            finished = ReadAcquire(&team_data.finished_threads);
+        }
         assert(list_empty(&thread_data.entry));
     }
 
@@ -1807,6 +1920,7 @@ BOOL WINAPI DllMain(HINSTANCE instance, DWORD reason, LPVOID reserved)
         case DLL_PROCESS_ATTACH:
         {
             SYSTEM_INFO sysinfo;
+            char policy[16];
 
             if ((vcomp_context_tls = TlsAlloc()) == TLS_OUT_OF_INDEXES)
             {
@@ -1819,6 +1933,14 @@ BOOL WINAPI DllMain(HINSTANCE instance, DWORD reason, LPVOID reserved)
             vcomp_max_threads = sysinfo.dwNumberOfProcessors;
             vcomp_num_threads = sysinfo.dwNumberOfProcessors;
             vcomp_num_procs   = sysinfo.dwNumberOfProcessors;
+
+            /* spinning only helps when other processors can make progress meanwhile */
+            if (vcomp_num_procs == 1) vcomp_spin_count = 0;
+            if (GetEnvironmentVariableA("OMP_WAIT_POLICY", policy, sizeof(policy)) < sizeof(policy))
+            {
+                if (!lstrcmpiA(policy, "ACTIVE")) vcomp_spin_count = ~0u;
+                else if (!lstrcmpiA(policy, "PASSIVE")) vcomp_spin_count = 0;
+            }
             break;
         }
 
@@ -2612,6 +2612,182 @@ static void test_reduction_float_double(void)
     }
 }
 
+#define NOWAIT_ROUNDS       64
+#define NOWAIT_ITERATIONS   97
+#define NOWAIT_SECTIONS     7
+
+static LONG nowait_chunked[NOWAIT_ROUNDS][NOWAIT_ITERATIONS];
+static LONG nowait_guided[NOWAIT_ROUNDS][NOWAIT_ITERATIONS];
+static LONG nowait_sections[NOWAIT_ROUNDS][NOWAIT_SECTIONS];
+static LONG nowait_errors;
+
+static void nowait_record(LONG *counts, unsigned int first, int step, unsigned int begin, unsigned int end)
+{
+    unsigned int i = begin;
+    int offset;
+
+    for (;;)
+    {
+        offset = i - first;
+        if (offset % step || offset / step < 0 || offset / step >= NOWAIT_ITERATIONS)
+        {
+            InterlockedIncrement(&nowait_errors);
+            return;
+        }
+        InterlockedIncrement(&counts[offset / step]);
+        if (i == end) return;
+        i += step;
+    }
+}
+
+static void CDECL nowait_cb(void)
+{
+    unsigned int begin, end, first;
+    int r, i, step;
+
+    /* no barrier between the constructs, fast threads run ahead into the next
+     * ones while the others still take chunks of the previous loops */
+    for (r = 0; r < NOWAIT_ROUNDS; r++)
+    {
+        first = 3 * r;
+        step  = 1 + r % 4;
+        p_vcomp_for_dynamic_init(VCOMP_DYNAMIC_FLAGS_CHUNKED | VCOMP_DYNAMIC_FLAGS_INCREMENT,
+                                 first, first + (NOWAIT_ITERATIONS - 1) * step, step, 1 + r % 5);
+        while (p_vcomp_for_dynamic_next(&begin, &end))
+            nowait_record(nowait_chunked[r], first, step, begin, end);
+
+        first = 1000 + r;
+        step  = 1 + r % 3;
+        p_vcomp_for_dynamic_init(VCOMP_DYNAMIC_FLAGS_GUIDED, first, first - (NOWAIT_ITERATIONS - 1) * step, step, 1 + r % 2);
+        while (p_vcomp_for_dynamic_next(&begin, &end))
+            nowait_record(nowait_guided[r], first, -step, begin, end);
+
+        p_vcomp_sections_init(NOWAIT_SECTIONS);
+        while ((i = p_vcomp_sections_next()) != -1)
+        {
+            if (i < 0 || i >= NOWAIT_SECTIONS) InterlockedIncrement(&nowait_errors);
+            else InterlockedIncrement(&nowait_sections[r][i]);
+        }
+    }
+}
+
+static void test_vcomp_nowait(void)
+{
+    int max_threads = pomp_get_max_threads();
+    int i, r, j, wrong;
+
+    for (i = 2; i <= 8; i *= 2)
+    {
+        pomp_set_num_threads(i);
+
+        memset(nowait_chunked, 0, sizeof(nowait_chunked));
+        memset(nowait_guided, 0, sizeof(nowait_guided));
+        memset(nowait_sections, 0, sizeof(nowait_sections));
+        nowait_errors = 0;
+
+        p_vcomp_fork(TRUE, 0, nowait_cb);
+
+        ok(!nowait_errors, "%d threads: got %ld chunks outside of their loop\n", i, nowait_errors);
+        wrong = 0;
+        for (r = 0; r < NOWAIT_ROUNDS; r++)
+        {
+            for (j = 0; j < NOWAIT_ITERATIONS; j++)
+            {
+                if (nowait_chunked[r][j] != 1) wrong++;
+                if (nowait_guided[r][j] != 1) wrong++;
+            }
+            for (j = 0; j < NOWAIT_SECTIONS; j++)
+                if (nowait_sections[r][j] != 1) wrong++;
+        }
+        ok(!wrong, "%d threads: %d iterations did not run exactly once\n", i, wrong);
+    }
+
+    pomp_set_num_threads(max_threads);
+}
+
+static void CDECL scaling_for_cb(unsigned int flags, unsigned int count, double *result)
+{
+    unsigned int begin, end, i;
+    double sum = 0.0;
+
+    p_vcomp_for_dynamic_init(flags | VCOMP_DYNAMIC_FLAGS_INCREMENT, 0, count - 1, 1, 64);
+    while (p_vcomp_for_dynamic_next(&begin, &end))
+    {
+        for (i = begin; i <= end; i++)
+            sum += 1.0 / (1.0 + (double)i * i);
+    }
+    p_vcomp_reduction_r8(VCOMP_REDUCTION_FLAGS_ADD, result, sum);
+}
+
+static void CDECL scaling_barrier_cb(unsigned int count)
+{
+    unsigned int i;
+
+    for (i = 0; i < count; i++)
+        p_vcomp_barrier();
+}
+
+static void test_vcomp_scaling(void)
+{
+    static const unsigned int count = 4 * 1024 * 1024;
+    int max_threads = pomp_get_max_threads();
+    LARGE_INTEGER freq, start, stop;
+    double base_for = 0.0, base_guided = 0.0, result, ms;
+    int i, j;
+
+    if (!winetest_interactive)
+    {
+        skip("vcomp scaling benchmark, set WINETEST_INTERACTIVE to run it\n");
+        return;
+    }
+
+    QueryPerformanceFrequency(&freq);
+
+    for (i = 1;; i = min(i * 2, max_threads))
+    {
+        pomp_set_num_threads(i);
+
+        QueryPerformanceCounter(&start);
+        for (j = 0; j < 10; j++)
+        {
+            result = 0.0;
+            p_vcomp_fork(TRUE, 3, scaling_for_cb, VCOMP_DYNAMIC_FLAGS_CHUNKED, count, &result);
+        }
+        QueryPerformanceCounter(&stop);
+        ms = (stop.QuadPart - start.QuadPart) * 1000.0 / freq.QuadPart;
+        if (i == 1) base_for = ms;
+        trace("%2d threads: chunked for + reduction %8.2f ms, speedup %5.2f (result %f)\n", i, ms, base_for / ms, result);
+
+        QueryPerformanceCounter(&start);
+        for (j = 0; j < 10; j++)
+        {
+            result = 0.0;
+            p_vcomp_fork(TRUE, 3, scaling_for_cb, VCOMP_DYNAMIC_FLAGS_GUIDED, count, &result);
+        }
+        QueryPerformanceCounter(&stop);
+        ms = (stop.QuadPart - start.QuadPart) * 1000.0 / freq.QuadPart;
+        if (i == 1) base_guided = ms;
+        trace("%2d threads: guided for + reduction  %8.2f ms, speedup %5.2f\n", i, ms, base_guided / ms);
+
+        QueryPerformanceCounter(&start);
+        p_vcomp_fork(TRUE, 1, scaling_barrier_cb, 100000);
+        QueryPerformanceCounter(&stop);
+        ms = (stop.QuadPart - start.QuadPart) * 1000.0 / freq.QuadPart;
+        trace("%2d threads: 100000 barriers         %8.2f ms\n", i, ms);
+
+        QueryPerformanceCounter(&start);
+        for (j = 0; j < 10000; j++)
+            p_vcomp_fork(TRUE, 1, scaling_barrier_cb, 0);
+        QueryPerformanceCounter(&stop);
+        ms = (stop.QuadPart - start.QuadPart) * 1000.0 / freq.QuadPart;
+        trace("%2d threads: 10000 empty forks       %8.2f ms\n", i, ms);
+
+        if (i == max_threads) break;
+    }
+
+    pomp_set_num_threads(max_threads);
+}
+
 static void test_omp_get_num_procs(void)
 {
     SYSTEM_INFO sysinfo;
@@ -2637,6 +2813,7 @@ START_TEST(vcomp)
     test_vcomp_for_static_simple_init();
     test_vcomp_for_static_init();
     test_vcomp_for_dynamic_init();
+    test_vcomp_nowait();
     test_vcomp_master_begin();
     test_vcomp_single_begin();
     test_vcomp_enter_critsect();
@@ -2654,6 +2831,7 @@ START_TEST(vcomp)
     test_reduction_integer32();
     test_reduction_integer64();
     test_reduction_float_double();
+    test_vcomp_scaling();
 
     release_vcomp();
 }
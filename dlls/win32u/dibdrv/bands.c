@@ -0,0 +1,388 @@
+/*
+ * DIB driver rendering in row bands
+ *
+ * Copyright 2026 the Wine project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * Large fills, blends, gradients and stretches can be split into bands of
+ * rows that are rendered in parallel by a pool of worker threads, with the
+ * calling thread taking bands as well. This is only enabled when
+ * WINEDIBTHREADS is set to the number of threads to use, it is read from
+ * the process environment so that a child process can be started with it.
+ * Every row is computed by the same primitive as on the single threaded
+ * path and bands never share destination rows, so the result is the same
+ * bit for bit.
+ *
+ * The workers are plain host threads without a TEB, the band callbacks must
+ * only run pixel code and must not log anything. They can't recover from a
+ * fault either, so they must only be given bits that GDI allocated itself;
+ * bits passed by the application are always rendered on the calling thread.
+ */
+
+#if 0
+#pragma makedep unix
+#endif
+
+#include <pthread.h>
+#include <signal.h>
+
+#include "ntgdi_private.h"
+#include "dibdrv.h"
+#include "wine/list.h"
+
+#include "wine/debug.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(dib);
+
+#define MAX_BAND_THREADS 32
+#define BAND_MIN_PIXELS  (256 * 256)  /* smaller operations are done on the calling thread */
+#define BAND_MIN_ROWS    16           /* minimum height of a band */
+
+struct band_job
+{
+    struct list entry;
+    void      (*proc)( void *arg, int band );
+    void       *arg;
+    int         count;    /* number of bands */
+    int         next;     /* next band to hand out */
+    int         pending;  /* bands not finished yet */
+};
+
+static pthread_mutex_t band_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t band_queued = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t band_finished = PTHREAD_COND_INITIALIZER;
+static struct list band_jobs = LIST_INIT( band_jobs );
+static int band_threads;          /* threads taking part in an operation, including the caller */
+static BOOL band_workers_started;
+
+void init_dib_bands(void)
+{
+    static const WCHAR nameW[] = {'W','I','N','E','D','I','B','T','H','R','E','A','D','S','='};
+    const WCHAR *env = NtCurrentTeb()->Peb->ProcessParameters->Environment;
+
+    for ( ; *env; env += wcslen( env ) + 1)
+        if (!wcsnicmp( env, nameW, ARRAY_SIZE(nameW) )) break;
+    if (!*env) return;
+    band_threads = min( max( wcstol( env + ARRAY_SIZE(nameW), NULL, 10 ), 0 ), MAX_BAND_THREADS );
+    if (band_threads > 1) TRACE( "rendering large operations with %u threads\n", band_threads );
+}
+
+/* take the next band of a job, removing the job from the queue once all bands are handed out */
+static int take_band( struct band_job *job )
+{
+    int band = job->next++;
+
+    if (job->next == job->count) list_remove( &job->entry );
+    return band;
+}
+
+static void *band_worker( void *arg )
+{
+    struct band_job *job;
+    int band;
+
+    pthread_mutex_lock( &band_mutex );
+    for (;;)
+    {
+        while (list_empty( &band_jobs )) pthread_cond_wait( &band_queued, &band_mutex );
+        job = LIST_ENTRY( list_head( &band_jobs ), struct band_job, entry );
+        band = take_band( job );
+        pthread_mutex_unlock( &band_mutex );
+
+        job->proc( job->arg, band );
+
+        pthread_mutex_lock( &band_mutex );
+        if (!--job->pending) pthread_cond_broadcast( &band_finished );
+    }
+    return NULL;
+}
+
+/* start the worker threads, called with band_mutex held */
+static void start_band_workers(void)
+{
+    sigset_t sigset, old_sigset;
+    pthread_attr_t attr;
+    pthread_t thread;
+    int i;
+
+    band_workers_started = TRUE;
+
+    /* the workers must never run a signal handler, they don't have a TEB */
+    sigfillset( &sigset );
+    pthread_sigmask( SIG_BLOCK, &sigset, &old_sigset );
+    pthread_attr_init( &attr );
+    pthread_attr_setdetachstate( &attr, PTHREAD_CREATE_DETACHED );
+    for (i = 1; i < band_threads; i++)
+    {
+        if (pthread_create( &thread, &attr, band_worker, NULL ))
+        {
+            WARN( "failed to start band worker %u\n", i );
+            break;
+        }
+    }
+    pthread_attr_destroy( &attr );
+    pthread_sigmask( SIG_SETMASK, &old_sigset, NULL );
+}
+
+/* number of bands to split an operation of the given height and number of pixels into */
+int get_band_count( int height, INT64 pixels )
+{
+    if (band_threads <= 1 || pixels < BAND_MIN_PIXELS) return 1;
+    return max( 1, min( 2 * band_threads, height / BAND_MIN_ROWS ));
+}
+
+/* call proc for bands 0 to count - 1, in parallel if possible */
+void run_bands( int count, void (*proc)( void *arg, int band ), void *arg )
+{
+    struct band_job job;
+    int band;
+
+    if (count <= 1)
+    {
+        for (band = 0; band < count; band++) proc( arg, band );
+        return;
+    }
+
+    job.proc    = proc;
+    job.arg     = arg;
+    job.count   = count;
+    job.next    = 0;
+    job.pending = count;
+
+    pthread_mutex_lock( &band_mutex );
+    if (!band_workers_started) start_band_workers();
+    list_add_tail( &band_jobs, &job.entry );
+    pthread_cond_broadcast( &band_queued );
+
+    /* help with our own job, this also gets it done if no worker could be started */
+    while (job.next < job.count)
+    {
+        band = take_band( &job );
+        pthread_mutex_unlock( &band_mutex );
+        proc( arg, band );
+        pthread_mutex_lock( &band_mutex );
+        job.pending--;
+    }
+    while (job.pending) pthread_cond_wait( &band_finished, &band_mutex );
+    pthread_mutex_unlock( &band_mutex );
+}
+
+static void get_dib_bits_range( const dib_info *dib, const char **start, const char **end )
+{
+    const char *ptr = dib->bits.ptr;
+
+    if (dib->stride > 0)
+    {
+        *start = ptr;
+        *end   = ptr + dib->stride * dib->height;
+    }
+    else
+    {
+        *start = ptr + dib->stride * (dib->height - 1);
+        *end   = ptr - dib->stride;
+    }
+}
+
+/* check if rendering from src to dst in parallel could read rows written by another band */
+BOOL dib_bits_overlap( const dib_info *dst, const dib_info *src )
+{
+    const char *dst_start, *dst_end, *src_start, *src_end;
+
+    get_dib_bits_range( dst, &dst_start, &dst_end );
+    get_dib_bits_range( src, &src_start, &src_end );
+    return dst_start < src_end && src_start < dst_end;
+}
+
+struct rect_bands
+{
+    const RECT *rects;
+    int         num;
+    int         top;
+    int         height;
+    int         count;
+};
+
+static int init_rect_bands( struct rect_bands *bands, int num, const RECT *rects )
+{
+    INT64 pixels = 0;
+    int i, bottom;
+
+    bands->rects = rects;
+    bands->num   = num;
+    bands->count = 1;
+    if (!num) return 1;
+
+    bands->top = rects[0].top;
+    bottom = rects[0].bottom;
+    for (i = 0; i < num; i++)
+    {
+        bands->top = min( bands->top, rects[i].top );
+        bottom = max( bottom, rects[i].bottom );
+        pixels += (INT64)(rects[i].right - rects[i].left) * (rects[i].bottom - rects[i].top);
+    }
+    bands->height = bottom - bands->top;
+    return bands->count = get_band_count( bands->height, pixels );
+}
+
+/* clip a rectangle to the rows of a band, return FALSE if nothing is left */
+static BOOL get_band_rect( const struct rect_bands *bands, int band, int i, RECT *rc )
+{
+    *rc = bands->rects[i];
+    rc->top    = max( rc->top, bands->top + bands->height * band / bands->count );
+    rc->bottom = min( rc->bottom, bands->top + bands->height * (band + 1) / bands->count );
+    return rc->top < rc->bottom;
+}
+
+struct solid_bands
+{
+    struct rect_bands bands;
+    const dib_info   *dib;
+    DWORD             and, xor;
+};
+
+static void solid_band_proc( void *arg, int band )
+{
+    const struct solid_bands *args = arg;
+    RECT rc;
+    int i;
+
+    for (i = 0; i < args->bands.num; i++)
+        if (get_band_rect( &args->bands, band, i, &rc ))
+            args->dib->funcs->solid_rects( args->dib, 1, &rc, args->and, args->xor );
+}
+
+void solid_rects_banded( const dib_info *dib, int num, const RECT *rects, DWORD and, DWORD xor )
+{
+    struct solid_bands args;
+
+    if (init_rect_bands( &args.bands, num, rects ) <= 1)
+    {
+        dib->funcs->solid_rects( dib, num, rects, and, xor );
+        return;
+    }
+    args.dib = dib;
+    args.and = and;
+    args.xor = xor;
+    run_bands( args.bands.count, solid_band_proc, &args );
+}
+
+struct pattern_bands
+{
+    struct rect_bands    bands;
+    const dib_info      *dib;
+    const POINT         *origin;
+    const dib_info      *brush;
+    const rop_mask_bits *bits;
+};
+
+static void pattern_band_proc( void *arg, int band )
+{
+    const struct pattern_bands *args = arg;
+    RECT rc;
+    int i;
+
+    for (i = 0; i < args->bands.num; i++)
+        if (get_band_rect( &args->bands, band, i, &rc ))
+            args->dib->funcs->pattern_rects( args->dib, 1, &rc, args->origin, args->brush, args->bits );
+}
+
+void pattern_rects_banded( const dib_info *dib, int num, const RECT *rects, const POINT *origin,
+                           const dib_info *brush, const rop_mask_bits *bits )
+{
+    struct pattern_bands args;
+
+    if (init_rect_bands( &args.bands, num, rects ) <= 1)
+    {
+        dib->funcs->pattern_rects( dib, num, rects, origin, brush, bits );
+        return;
+    }
+    args.dib    = dib;
+    args.origin = origin;
+    args.brush  = brush;
+    args.bits   = bits;
+    run_bands( args.bands.count, pattern_band_proc, &args );
+}
+
+struct blend_bands
+{
+    struct rect_bands bands;
+    const dib_info   *dst;
+    const dib_info   *src;
+    const POINT      *offset;
+    BLENDFUNCTION     blend;
+};
+
+static void blend_band_proc( void *arg, int band )
+{
+    const struct blend_bands *args = arg;
+    RECT rc;
+    int i;
+
+    for (i = 0; i < args->bands.num; i++)
+        if (get_band_rect( &args->bands, band, i, &rc ))
+            args->dst->funcs->blend_rects( args->dst, 1, &rc, args->src, args->offset, args->blend );
+}
+
+void blend_rects_banded( const dib_info *dst, int num, const RECT *rects,
+                         const dib_info *src, const POINT *offset, BLENDFUNCTION blend )
+{
+    struct blend_bands args;
+
+    if (init_rect_bands( &args.bands, num, rects ) <= 1 || dib_bits_overlap( dst, src ))
+    {
+        dst->funcs->blend_rects( dst, num, rects, src, offset, blend );
+        return;
+    }
+    args.dst    = dst;
+    args.src    = src;
+    args.offset = offset;
+    args.blend  = blend;
+    run_bands( args.bands.count, blend_band_proc, &args );
+}
+
+struct gradient_bands
+{
+    struct rect_bands bands;
+    const dib_info   *dib;
+    const TRIVERTEX  *v;
+    int               mode;
+    BOOL              ret;
+};
+
+static void gradient_band_proc( void *arg, int band )
+{
+    struct gradient_bands *args = arg;
+    RECT rc;
+
+    if (get_band_rect( &args->bands, band, 0, &rc ) &&
+        !args->dib->funcs->gradient_rect( args->dib, &rc, args->v, args->mode ))
+        __atomic_store_n( &args->ret, FALSE, __ATOMIC_RELAXED );
+}
+
+BOOL gradient_rect_banded( const dib_info *dib, const RECT *rc, const TRIVERTEX *v, int mode )
+{
+    struct gradient_bands args;
+
+    if (init_rect_bands( &args.bands, 1, rc ) <= 1) return dib->funcs->gradient_rect( dib, rc, v, mode );
+    args.dib  = dib;
+    args.v    = v;
+    args.mode = mode;
+    args.ret  = TRUE;
+    run_bands( args.bands.count, gradient_band_proc, &args );
+    return args.ret;
+}
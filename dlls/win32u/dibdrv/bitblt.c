@@ -595,7 +595,7 @@ static DWORD blend_rect( dib_info *dst, const RECT *dst_rect, const dib_info *sr
 
     offset.x = src_rect->left - dst_rect->left;
     offset.y = src_rect->top  - dst_rect->top;
-    dst->funcs->blend_rects( dst, clipped_rects.count, clipped_rects.rects, src, &offset, blend );
+    blend_rects_banded( dst, clipped_rects.count, clipped_rects.rects, src, &offset, blend );
 
     free_clipped_rects( &clipped_rects );
     return ERROR_SUCCESS;
@@ -689,7 +689,7 @@ static BOOL gradient_rect( dib_info *dib, TRIVERTEX *v, int mode, HRGN clip, con
     if (!get_clipped_rects( dib, bounds, clip, &clipped_rects )) return TRUE;
     for (i = 0; i < clipped_rects.count; i++)
     {
-        if (!(ret = dib->funcs->gradient_rect( dib, &clipped_rects.rects[i], v, mode ))) break;
+        if (!(ret = gradient_rect_banded( dib, &clipped_rects.rects[i], v, mode ))) break;
     }
     free_clipped_rects( &clipped_rects );
     return ret;
@@ -1198,20 +1198,139 @@ static DWORD calc_1d_stretch_params( INT dst_start, INT dst_length, INT dst_vis_
 }
 
 
+struct stretch_band
+{
+    POINT        dst_start;
+    POINT        src_start;
+    int          err;
+    unsigned int length;
+};
+
+struct stretch_bands
+{
+    dib_info                    *dst_dib;
+    const dib_info              *src_dib;
+    const struct stretch_params *v_params;
+    const struct stretch_params *h_params;
+    int                          width;
+    int                          mode;
+    BOOL                         vstretch;
+    void (* row_fn)(const dib_info *dst_dib, const POINT *dst_start,
+                    const dib_info *src_dib, const POINT *src_start,
+                    const struct stretch_params *params, int mode, BOOL keep_dst);
+    struct stretch_band         *bands;
+};
+
+/* advance to the next row, return TRUE if it starts a new destination row (vstretch: a new source row) */
+static BOOL step_stretch_band( struct stretch_band *band, const struct stretch_params *v_params, BOOL vstretch )
+{
+    BOOL next = band->err > 0;
+
+    if (next) band->err += v_params->err_add_1;
+    else band->err += v_params->err_add_2;
+
+    if (vstretch)
+    {
+        if (next) band->src_start.y += v_params->src_inc;
+        band->dst_start.y += v_params->dst_inc;
+    }
+    else
+    {
+        if (next) band->dst_start.y += v_params->dst_inc;
+        band->src_start.y += v_params->src_inc;
+    }
+    return next;
+}
+
+static void stretch_band_rows( const struct stretch_bands *args, struct stretch_band *band )
+{
+    const struct stretch_params *v_params = args->v_params;
+
+    if (args->vstretch)
+    {
+        BOOL need_row = TRUE;
+        RECT last_row, this_row;
+        last_row.left = 0;
+        last_row.right = args->width;
+
+        while (band->length--)
+        {
+            if (need_row)
+                args->row_fn( args->dst_dib, &band->dst_start, args->src_dib, &band->src_start,
+                              args->h_params, args->mode, FALSE );
+            else
+            {
+                last_row.top = band->dst_start.y - v_params->dst_inc;
+                last_row.bottom = last_row.top + 1;
+                this_row = last_row;
+                OffsetRect( &this_row, 0, v_params->dst_inc );
+                copy_rect( args->dst_dib, &this_row, args->dst_dib, &last_row, NULL, R2_COPYPEN );
+            }
+            need_row = step_stretch_band( band, v_params, TRUE );
+        }
+    }
+    else
+    {
+        int merged_rows = 0;
+
+        while (band->length--)
+        {
+            if (args->mode != STRETCH_DELETESCANS || !merged_rows)
+                args->row_fn( args->dst_dib, &band->dst_start, args->src_dib, &band->src_start,
+                              args->h_params, args->mode, merged_rows != 0 );
+            if (step_stretch_band( band, v_params, FALSE )) merged_rows = 0;
+            else merged_rows++;
+        }
+    }
+}
+
+static void stretch_band_proc( void *arg, int band )
+{
+    const struct stretch_bands *args = arg;
+
+    stretch_band_rows( args, &args->bands[band] );
+}
+
+/* split the rows into bands that each start on a fresh destination row, so that
+ * no band depends on a row written by another one; return the number of bands */
+static int split_stretch_bands( struct stretch_band *bands, int count, const struct stretch_band *start,
+                                const struct stretch_params *v_params, BOOL vstretch )
+{
+    struct stretch_band pos = *start;
+    unsigned int k, band_start = 0;
+    BOOL fresh = TRUE;
+    int n = 1, target = 1;
+
+    bands[0] = pos;
+    for (k = 0; k < start->length; k++)
+    {
+        if (fresh && target < count && k >= (UINT64)start->length * target / count)
+        {
+            bands[n - 1].length = k - band_start;
+            bands[n] = pos;
+            band_start = k;
+            n++;
+            while (target < count && k >= (UINT64)start->length * target / count) target++;
+        }
+        fresh = step_stretch_band( &pos, v_params, vstretch );
+    }
+    bands[n - 1].length = start->length - band_start;
+    return n;
+}
+
 DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bitblt_coords *src,
                           const BITMAPINFO *dst_info, void *dst_bits, struct bitblt_coords *dst,
-                          INT mode )
+                          INT mode, BOOL app_bits )
 {
     dib_info src_dib, dst_dib;
     POINT dst_start, src_start, dst_end, src_end;
     RECT rect;
     BOOL hstretch, vstretch;
     struct stretch_params v_params, h_params;
-    int err;
+    struct stretch_bands bands;
+    struct stretch_band rows;
+    int count;
     DWORD ret;
-    void (* row_fn)(const dib_info *dst_dib, const POINT *dst_start,
-                    const dib_info *src_dib, const POINT *src_start,
-                    const struct stretch_params *params, int mode, BOOL keep_dst);
 
     TRACE("dst %d, %d - %d x %d visrect %s src %d, %d - %d x %d visrect %s\n",
           dst->x, dst->y, dst->width, dst->height, wine_dbgstr_rect(&dst->visrect),
@@ -1251,64 +1370,31 @@ DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bit
     dst_start.x -= dst->visrect.left;
     dst_start.y -= dst->visrect.top;
 
-    err = v_params.err_start;
-
-    row_fn = hstretch ? dst_dib.funcs->stretch_row : dst_dib.funcs->shrink_row;
-
-    if (vstretch)
+    bands.dst_dib  = &dst_dib;
+    bands.src_dib  = &src_dib;
+    bands.v_params = &v_params;
+    bands.h_params = &h_params;
+    bands.width    = dst->visrect.right - dst->visrect.left;
+    bands.mode     = (vstretch && hstretch) ? STRETCH_DELETESCANS : mode;
+    bands.vstretch = vstretch;
+    bands.row_fn   = hstretch ? dst_dib.funcs->stretch_row : dst_dib.funcs->shrink_row;
+
+    rows.dst_start = dst_start;
+    rows.src_start = src_start;
+    rows.err       = v_params.err_start;
+    rows.length    = v_params.length;
+
+    count = get_band_count( dst->visrect.bottom - dst->visrect.top,
+                            (INT64)bands.width * (dst->visrect.bottom - dst->visrect.top) );
+    /* bits passed by the app may fault, that can only be handled on the calling thread */
+    if (count > 1 && !app_bits && dst_dib.funcs != &funcs_null && !dib_bits_overlap( &dst_dib, &src_dib ) &&
+        (bands.bands = malloc( count * sizeof(*bands.bands) )))
     {
-        BOOL need_row = TRUE;
-        RECT last_row, this_row;
-        if (hstretch) mode = STRETCH_DELETESCANS;
-        last_row.left = 0;
-        last_row.right = dst->visrect.right - dst->visrect.left;
-
-        while (v_params.length--)
-        {
-            if (need_row)
-            {
-                row_fn( &dst_dib, &dst_start, &src_dib, &src_start, &h_params, mode, FALSE );
-                need_row = FALSE;
-            }
-            else
-            {
-                last_row.top = dst_start.y - v_params.dst_inc;
-                last_row.bottom = last_row.top + 1;
-                this_row = last_row;
-                OffsetRect( &this_row, 0, v_params.dst_inc );
-                copy_rect( &dst_dib, &this_row, &dst_dib, &last_row, NULL, R2_COPYPEN );
-            }
-
-            if (err > 0)
-            {
-                src_start.y += v_params.src_inc;
-                need_row = TRUE;
-                err += v_params.err_add_1;
-            }
-            else err += v_params.err_add_2;
-            dst_start.y += v_params.dst_inc;
-        }
-    }
-    else
-    {
-        int merged_rows = 0;
-
-        while (v_params.length--)
-        {
-            if (mode != STRETCH_DELETESCANS || !merged_rows)
-                row_fn( &dst_dib, &dst_start, &src_dib, &src_start, &h_params, mode, merged_rows != 0 );
-            merged_rows++;
-
-            if (err > 0)
-            {
-                dst_start.y += v_params.dst_inc;
-                merged_rows = 0;
-                err += v_params.err_add_1;
-            }
-            else err += v_params.err_add_2;
-            src_start.y += v_params.src_inc;
-        }
+        count = split_stretch_bands( bands.bands, count, &rows, &v_params, vstretch );
+        run_bands( count, stretch_band_proc, &bands );
+        free( bands.bands );
     }
+    else stretch_band_rows( &bands, &rows );
 
 done:
     /* update coordinates, the destination rectangle is always stored at 0,0 */
@@ -265,6 +265,17 @@ extern int clip_line(const POINT *start, const POINT *end, const RECT *clip,
 extern void release_cached_font( struct cached_font *font );
 extern BOOL fill_with_pixel( DC *dc, dib_info *dib, DWORD pixel, int num, const RECT *rects, INT rop );
 
+/* bands.c */
+extern int get_band_count( int height, INT64 pixels );
+extern void run_bands( int count, void (*proc)( void *arg, int band ), void *arg );
+extern BOOL dib_bits_overlap( const dib_info *dst, const dib_info *src );
+extern void solid_rects_banded( const dib_info *dib, int num, const RECT *rects, DWORD and, DWORD xor );
+extern void pattern_rects_banded( const dib_info *dib, int num, const RECT *rects, const POINT *origin,
+                                  const dib_info *brush, const rop_mask_bits *bits );
+extern void blend_rects_banded( const dib_info *dst, int num, const RECT *rects,
+                                const dib_info *src, const POINT *offset, BLENDFUNCTION blend );
+extern BOOL gradient_rect_banded( const dib_info *dib, const RECT *rc, const TRIVERTEX *v, int mode );
+
 static inline void init_clipped_rects( struct clipped_rects *clip_rects )
 {
     clip_rects->count = 0;
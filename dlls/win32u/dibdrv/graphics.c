@@ -1286,7 +1286,7 @@ BOOL dibdrv_PatBlt( PHYSDEV dev, struct bitblt_coords *dst, DWORD rop )
     case R2_WHITE: xor = ~0u;
         /* fall through */
     case R2_BLACK:
-        pdev->dib.funcs->solid_rects( &pdev->dib, clipped_rects.count, clipped_rects.rects, and, xor );
+        solid_rects_banded( &pdev->dib, clipped_rects.count, clipped_rects.rects, and, xor );
         /* fall through */
     case R2_NOP:
         break;
@@ -23,6 +23,10 @@
 #endif
 
 #include <assert.h>
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#include <immintrin.h>
+#define HAVE_SIMD_PRIMITIVES
+#endif
 
 #include "ntgdi_private.h"
 #include "dibdrv.h"
@@ -176,24 +180,410 @@ static inline void do_rop_codes_mask_8(BYTE *dst, BYTE src, struct rop_codes *co
     do_rop_mask_8( dst, (src & codes->a1) ^ codes->a2, (src & codes->x1) ^ codes->x2, mask );
 }
 
+#ifdef HAVE_SIMD_PRIMITIVES
+
+/* The SSE2 and AVX2 kernels below give the same results as the C loops bit for bit.
+ * They return how much of the line they did, the caller finishes the rest in C. */
+
+static BOOL sse2_supported, avx2_supported;
+
+static inline __m128i __attribute__((target("sse2"))) div255_sse2( __m128i val )
+{
+    /* exact val / 255 for val <= 255 * 255 + 127 */
+    val = _mm_add_epi16( _mm_add_epi16( val, _mm_set1_epi16( 1 )), _mm_srli_epi16( val, 8 ));
+    return _mm_srli_epi16( val, 8 );
+}
+
+static inline __m256i __attribute__((target("avx2"))) div255_avx2( __m256i val )
+{
+    val = _mm256_add_epi16( _mm256_add_epi16( val, _mm256_set1_epi16( 1 )), _mm256_srli_epi16( val, 8 ));
+    return _mm256_srli_epi16( val, 8 );
+}
+
+/* dst = (dst & and) ^ xor with a pattern of one dword, len in bytes */
+static int __attribute__((target("sse2"))) solid_line_sse2( BYTE *ptr, int len, DWORD and, DWORD xor )
+{
+    __m128i and_vec = _mm_set1_epi32( and ), xor_vec = _mm_set1_epi32( xor ), val;
+    int i;
+
+    for (i = 0; i + 16 <= len; i += 16)
+    {
+        val = _mm_loadu_si128( (const __m128i *)(ptr + i) );
+        _mm_storeu_si128( (__m128i *)(ptr + i), _mm_xor_si128( _mm_and_si128( val, and_vec ), xor_vec ));
+    }
+    return i;
+}
+
+static int __attribute__((target("avx2"))) solid_line_avx2( BYTE *ptr, int len, DWORD and, DWORD xor )
+{
+    __m256i and_vec = _mm256_set1_epi32( and ), xor_vec = _mm256_set1_epi32( xor ), val;
+    int i;
+
+    for (i = 0; i + 32 <= len; i += 32)
+    {
+        val = _mm256_loadu_si256( (const __m256i *)(ptr + i) );
+        _mm256_storeu_si256( (__m256i *)(ptr + i), _mm256_xor_si256( _mm256_and_si256( val, and_vec ), xor_vec ));
+    }
+    return i;
+}
+
+/* same with the three dword pattern of 24 bpp pixels, count in dwords */
+static int __attribute__((target("sse2"))) solid_line_24_sse2( DWORD *ptr, int count,
+                                                               const DWORD *and, const DWORD *xor )
+{
+    __m128i and_vec[3], xor_vec[3], val;
+    int i, j;
+
+    and_vec[0] = _mm_setr_epi32( and[0], and[1], and[2], and[0] );
+    and_vec[1] = _mm_setr_epi32( and[1], and[2], and[0], and[1] );
+    and_vec[2] = _mm_setr_epi32( and[2], and[0], and[1], and[2] );
+    xor_vec[0] = _mm_setr_epi32( xor[0], xor[1], xor[2], xor[0] );
+    xor_vec[1] = _mm_setr_epi32( xor[1], xor[2], xor[0], xor[1] );
+    xor_vec[2] = _mm_setr_epi32( xor[2], xor[0], xor[1], xor[2] );
+
+    for (i = 0; i + 12 <= count; i += 12)
+    {
+        for (j = 0; j < 3; j++)
+        {
+            val = _mm_loadu_si128( (const __m128i *)(ptr + i + 4 * j) );
+            val = _mm_xor_si128( _mm_and_si128( val, and_vec[j] ), xor_vec[j] );
+            _mm_storeu_si128( (__m128i *)(ptr + i + 4 * j), val );
+        }
+    }
+    return i;
+}
+
+static int __attribute__((target("avx2"))) solid_line_24_avx2( DWORD *ptr, int count,
+                                                               const DWORD *and, const DWORD *xor )
+{
+    __m256i and_vec[3], xor_vec[3], val;
+    int i, j;
+
+    and_vec[0] = _mm256_setr_epi32( and[0], and[1], and[2], and[0], and[1], and[2], and[0], and[1] );
+    and_vec[1] = _mm256_setr_epi32( and[2], and[0], and[1], and[2], and[0], and[1], and[2], and[0] );
+    and_vec[2] = _mm256_setr_epi32( and[1], and[2], and[0], and[1], and[2], and[0], and[1], and[2] );
+    xor_vec[0] = _mm256_setr_epi32( xor[0], xor[1], xor[2], xor[0], xor[1], xor[2], xor[0], xor[1] );
+    xor_vec[1] = _mm256_setr_epi32( xor[2], xor[0], xor[1], xor[2], xor[0], xor[1], xor[2], xor[0] );
+    xor_vec[2] = _mm256_setr_epi32( xor[1], xor[2], xor[0], xor[1], xor[2], xor[0], xor[1], xor[2] );
+
+    for (i = 0; i + 24 <= count; i += 24)
+    {
+        for (j = 0; j < 3; j++)
+        {
+            val = _mm256_loadu_si256( (const __m256i *)(ptr + i + 8 * j) );
+            val = _mm256_xor_si256( _mm256_and_si256( val, and_vec[j] ), xor_vec[j] );
+            _mm256_storeu_si256( (__m256i *)(ptr + i + 8 * j), val );
+        }
+    }
+    return i;
+}
+
+/* do_rop_codes on a line of bytes, starting from the end of the line if rev is set.
+ * Each block is loaded before it is stored, so overlapping lines behave like the C loops. */
+static int __attribute__((target("sse2"))) rop_codes_line_sse2( BYTE *dst, const BYTE *src,
+                                                                const struct rop_codes *codes, int len, BOOL rev )
+{
+    __m128i a1 = _mm_set1_epi32( codes->a1 ), a2 = _mm_set1_epi32( codes->a2 );
+    __m128i x1 = _mm_set1_epi32( codes->x1 ), x2 = _mm_set1_epi32( codes->x2 );
+    __m128i s, d;
+    int i, pos;
+
+    for (i = 0; i + 16 <= len; i += 16)
+    {
+        pos = rev ? len - i - 16 : i;
+        s = _mm_loadu_si128( (const __m128i *)(src + pos) );
+        d = _mm_loadu_si128( (const __m128i *)(dst + pos) );
+        d = _mm_xor_si128( _mm_and_si128( d, _mm_xor_si128( _mm_and_si128( s, a1 ), a2 )),
+                           _mm_xor_si128( _mm_and_si128( s, x1 ), x2 ));
+        _mm_storeu_si128( (__m128i *)(dst + pos), d );
+    }
+    return i;
+}
+
+static int __attribute__((target("avx2"))) rop_codes_line_avx2( BYTE *dst, const BYTE *src,
+                                                                const struct rop_codes *codes, int len, BOOL rev )
+{
+    __m256i a1 = _mm256_set1_epi32( codes->a1 ), a2 = _mm256_set1_epi32( codes->a2 );
+    __m256i x1 = _mm256_set1_epi32( codes->x1 ), x2 = _mm256_set1_epi32( codes->x2 );
+    __m256i s, d;
+    int i, pos;
+
+    for (i = 0; i + 32 <= len; i += 32)
+    {
+        pos = rev ? len - i - 32 : i;
+        s = _mm256_loadu_si256( (const __m256i *)(src + pos) );
+        d = _mm256_loadu_si256( (const __m256i *)(dst + pos) );
+        d = _mm256_xor_si256( _mm256_and_si256( d, _mm256_xor_si256( _mm256_and_si256( s, a1 ), a2 )),
+                              _mm256_xor_si256( _mm256_and_si256( s, x1 ), x2 ));
+        _mm256_storeu_si256( (__m256i *)(dst + pos), d );
+    }
+    return i;
+}
+
+/* Alpha blending of a line of 8888 pixels. With src_alpha this is blend_argb_alpha (blend_argb
+ * when alpha is 255), otherwise blend_argb_constant_alpha on the source or'ed with src_bits.
+ * Blue and red are processed in the even words and green and alpha in the odd words of each
+ * pixel, recombining them with a dword shift carries overflows exactly like the C code does. */
+static int __attribute__((target("sse2"))) blend_line_sse2( DWORD *dst, const DWORD *src, int len,
+                                                            DWORD alpha, BOOL src_alpha, DWORD src_bits )
+{
+    const __m128i mask = _mm_set1_epi32( 0x00ff00ff ), bits = _mm_set1_epi32( src_bits );
+    const __m128i c127 = _mm_set1_epi16( 127 ), c255 = _mm_set1_epi16( 255 );
+    const __m128i const_alpha = _mm_set1_epi16( alpha ), inv_alpha = _mm_set1_epi16( 255 - alpha );
+    __m128i s, d, s_even, s_odd, d_even, d_odd, a;
+    int x;
+
+    for (x = 0; x + 4 <= len; x += 4)
+    {
+        s = _mm_or_si128( _mm_loadu_si128( (const __m128i *)(src + x) ), bits );
+        d = _mm_loadu_si128( (const __m128i *)(dst + x) );
+        s_even = _mm_and_si128( s, mask );
+        s_odd  = _mm_srli_epi16( s, 8 );
+        d_even = _mm_and_si128( d, mask );
+        d_odd  = _mm_srli_epi16( d, 8 );
+
+        if (src_alpha)
+        {
+            if (alpha != 255)
+            {
+                s_even = div255_sse2( _mm_add_epi16( _mm_mullo_epi16( s_even, const_alpha ), c127 ));
+                s_odd  = div255_sse2( _mm_add_epi16( _mm_mullo_epi16( s_odd, const_alpha ), c127 ));
+            }
+            a = _mm_srli_epi32( s_odd, 16 );
+            a = _mm_sub_epi16( c255, _mm_or_si128( a, _mm_slli_epi32( a, 16 )));
+            s_even = _mm_add_epi16( s_even, div255_sse2( _mm_add_epi16( _mm_mullo_epi16( d_even, a ), c127 )));
+            s_odd  = _mm_add_epi16( s_odd, div255_sse2( _mm_add_epi16( _mm_mullo_epi16( d_odd, a ), c127 )));
+        }
+        else
+        {
+            s_even = _mm_add_epi16( _mm_mullo_epi16( s_even, const_alpha ), _mm_mullo_epi16( d_even, inv_alpha ));
+            s_odd  = _mm_add_epi16( _mm_mullo_epi16( s_odd, const_alpha ), _mm_mullo_epi16( d_odd, inv_alpha ));
+            s_even = div255_sse2( _mm_add_epi16( s_even, c127 ));
+            s_odd  = div255_sse2( _mm_add_epi16( s_odd, c127 ));
+        }
+        _mm_storeu_si128( (__m128i *)(dst + x), _mm_or_si128( s_even, _mm_slli_epi32( s_odd, 8 )));
+    }
+    return x;
+}
+
+static int __attribute__((target("avx2"))) blend_line_avx2( DWORD *dst, const DWORD *src, int len,
+                                                            DWORD alpha, BOOL src_alpha, DWORD src_bits )
+{
+    const __m256i mask = _mm256_set1_epi32( 0x00ff00ff ), bits = _mm256_set1_epi32( src_bits );
+    const __m256i c127 = _mm256_set1_epi16( 127 ), c255 = _mm256_set1_epi16( 255 );
+    const __m256i const_alpha = _mm256_set1_epi16( alpha ), inv_alpha = _mm256_set1_epi16( 255 - alpha );
+    __m256i s, d, s_even, s_odd, d_even, d_odd, a;
+    int x;
+
+    for (x = 0; x + 8 <= len; x += 8)
+    {
+        s = _mm256_or_si256( _mm256_loadu_si256( (const __m256i *)(src + x) ), bits );
+        d = _mm256_loadu_si256( (const __m256i *)(dst + x) );
+        s_even = _mm256_and_si256( s, mask );
+        s_odd  = _mm256_srli_epi16( s, 8 );
+        d_even = _mm256_and_si256( d, mask );
+        d_odd  = _mm256_srli_epi16( d, 8 );
+
+        if (src_alpha)
+        {
+            if (alpha != 255)
+            {
+                s_even = div255_avx2( _mm256_add_epi16( _mm256_mullo_epi16( s_even, const_alpha ), c127 ));
+                s_odd  = div255_avx2( _mm256_add_epi16( _mm256_mullo_epi16( s_odd, const_alpha ), c127 ));
+            }
+            a = _mm256_srli_epi32( s_odd, 16 );
+            a = _mm256_sub_epi16( c255, _mm256_or_si256( a, _mm256_slli_epi32( a, 16 )));
+            s_even = _mm256_add_epi16( s_even, div255_avx2( _mm256_add_epi16( _mm256_mullo_epi16( d_even, a ), c127 )));
+            s_odd  = _mm256_add_epi16( s_odd, div255_avx2( _mm256_add_epi16( _mm256_mullo_epi16( d_odd, a ), c127 )));
+        }
+        else
+        {
+            s_even = _mm256_add_epi16( _mm256_mullo_epi16( s_even, const_alpha ), _mm256_mullo_epi16( d_even, inv_alpha ));
+            s_odd  = _mm256_add_epi16( _mm256_mullo_epi16( s_odd, const_alpha ), _mm256_mullo_epi16( d_odd, inv_alpha ));
+            s_even = div255_avx2( _mm256_add_epi16( s_even, c127 ));
+            s_odd  = div255_avx2( _mm256_add_epi16( s_odd, c127 ));
+        }
+        _mm256_storeu_si256( (__m256i *)(dst + x), _mm256_or_si256( s_even, _mm256_slli_epi32( s_odd, 8 )));
+    }
+    return x;
+}
+
+/* 32 bpp with 8 bit fields to 8888 */
+static int __attribute__((target("sse2"))) convert_line_8888_from_32_sse2( DWORD *dst, const DWORD *src, int len,
+                                                                           int red_shift, int green_shift, int blue_shift )
+{
+    const __m128i mask = _mm_set1_epi32( 0xff );
+    const __m128i red = _mm_cvtsi32_si128( red_shift ), green = _mm_cvtsi32_si128( green_shift );
+    const __m128i blue = _mm_cvtsi32_si128( blue_shift );
+    __m128i val, r, g, b;
+    int x;
+
+    for (x = 0; x + 4 <= len; x += 4)
+    {
+        val = _mm_loadu_si128( (const __m128i *)(src + x) );
+        r = _mm_and_si128( _mm_srl_epi32( val, red ), mask );
+        g = _mm_and_si128( _mm_srl_epi32( val, green ), mask );
+        b = _mm_and_si128( _mm_srl_epi32( val, blue ), mask );
+        val = _mm_or_si128( _mm_or_si128( _mm_slli_epi32( r, 16 ), _mm_slli_epi32( g, 8 )), b );
+        _mm_storeu_si128( (__m128i *)(dst + x), val );
+    }
+    return x;
+}
+
+static inline __m128i __attribute__((target("sse2"))) expand_555_sse2( __m128i val )
+{
+    return _mm_or_si128(
+        _mm_or_si128( _mm_or_si128( _mm_and_si128( _mm_slli_epi32( val, 9 ), _mm_set1_epi32( 0xf80000 )),
+                                    _mm_and_si128( _mm_slli_epi32( val, 4 ), _mm_set1_epi32( 0x070000 ))),
+                      _mm_or_si128( _mm_and_si128( _mm_slli_epi32( val, 6 ), _mm_set1_epi32( 0x00f800 )),
+                                    _mm_and_si128( _mm_slli_epi32( val, 1 ), _mm_set1_epi32( 0x000700 )))),
+        _mm_or_si128( _mm_and_si128( _mm_slli_epi32( val, 3 ), _mm_set1_epi32( 0x0000f8 )),
+                      _mm_and_si128( _mm_srli_epi32( val, 2 ), _mm_set1_epi32( 0x000007 ))));
+}
+
+static int __attribute__((target("sse2"))) convert_line_8888_from_555_sse2( DWORD *dst, const WORD *src, int len )
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i val;
+    int x;
+
+    for (x = 0; x + 8 <= len; x += 8)
+    {
+        val = _mm_loadu_si128( (const __m128i *)(src + x) );
+        _mm_storeu_si128( (__m128i *)(dst + x), expand_555_sse2( _mm_unpacklo_epi16( val, zero )));
+        _mm_storeu_si128( (__m128i *)(dst + x + 4), expand_555_sse2( _mm_unpackhi_epi16( val, zero )));
+    }
+    return x;
+}
+
+static inline __m128i __attribute__((target("sse2"))) reduce_555_sse2( __m128i val )
+{
+    return _mm_or_si128( _mm_or_si128( _mm_and_si128( _mm_srli_epi32( val, 9 ), _mm_set1_epi32( 0x7c00 )),
+                                       _mm_and_si128( _mm_srli_epi32( val, 6 ), _mm_set1_epi32( 0x03e0 ))),
+                         _mm_and_si128( _mm_srli_epi32( val, 3 ), _mm_set1_epi32( 0x001f )));
+}
+
+static int __attribute__((target("sse2"))) convert_line_555_from_8888_sse2( WORD *dst, const DWORD *src, int len )
+{
+    __m128i lo, hi;
+    int x;
+
+    for (x = 0; x + 8 <= len; x += 8)
+    {
+        lo = reduce_555_sse2( _mm_loadu_si128( (const __m128i *)(src + x) ));
+        hi = reduce_555_sse2( _mm_loadu_si128( (const __m128i *)(src + x + 4) ));
+        /* the values fit in 15 bits, so the signed saturation never kicks in */
+        _mm_storeu_si128( (__m128i *)(dst + x), _mm_packs_epi32( lo, hi ));
+    }
+    return x;
+}
+
+static inline int solid_line_simd( void *ptr, int len, DWORD and, DWORD xor )
+{
+    if (avx2_supported) return solid_line_avx2( ptr, len, and, xor );
+    if (sse2_supported) return solid_line_sse2( ptr, len, and, xor );
+    return 0;
+}
+
+static inline int solid_line_24_simd( DWORD *ptr, int count, const DWORD *and, const DWORD *xor )
+{
+    if (avx2_supported) return solid_line_24_avx2( ptr, count, and, xor );
+    if (sse2_supported) return solid_line_24_sse2( ptr, count, and, xor );
+    return 0;
+}
+
+static inline int rop_codes_line_simd( BYTE *dst, const BYTE *src, const struct rop_codes *codes, int len, BOOL rev )
+{
+    if (avx2_supported) return rop_codes_line_avx2( dst, src, codes, len, rev );
+    if (sse2_supported) return rop_codes_line_sse2( dst, src, codes, len, rev );
+    return 0;
+}
+
+static inline int blend_line_simd( DWORD *dst, const DWORD *src, int len, DWORD alpha, BOOL src_alpha, DWORD src_bits )
+{
+    if (avx2_supported) return blend_line_avx2( dst, src, len, alpha, src_alpha, src_bits );
+    if (sse2_supported) return blend_line_sse2( dst, src, len, alpha, src_alpha, src_bits );
+    return 0;
+}
+
+static inline int convert_line_8888_from_32_simd( DWORD *dst, const DWORD *src, int len,
+                                                  int red_shift, int green_shift, int blue_shift )
+{
+    if (sse2_supported) return convert_line_8888_from_32_sse2( dst, src, len, red_shift, green_shift, blue_shift );
+    return 0;
+}
+
+static inline int convert_line_8888_from_555_simd( DWORD *dst, const WORD *src, int len )
+{
+    if (sse2_supported) return convert_line_8888_from_555_sse2( dst, src, len );
+    return 0;
+}
+
+static inline int convert_line_555_from_8888_simd( WORD *dst, const DWORD *src, int len )
+{
+    if (sse2_supported) return convert_line_555_from_8888_sse2( dst, src, len );
+    return 0;
+}
+
+#else  /* HAVE_SIMD_PRIMITIVES */
+
+static inline int solid_line_simd( void *ptr, int len, DWORD and, DWORD xor ) { return 0; }
+static inline int solid_line_24_simd( DWORD *ptr, int count, const DWORD *and, const DWORD *xor ) { return 0; }
+static inline int rop_codes_line_simd( BYTE *dst, const BYTE *src, const struct rop_codes *codes,
+                                       int len, BOOL rev ) { return 0; }
+static inline int blend_line_simd( DWORD *dst, const DWORD *src, int len, DWORD alpha,
+                                   BOOL src_alpha, DWORD src_bits ) { return 0; }
+static inline int convert_line_8888_from_32_simd( DWORD *dst, const DWORD *src, int len, int red_shift,
+                                                  int green_shift, int blue_shift ) { return 0; }
+static inline int convert_line_8888_from_555_simd( DWORD *dst, const WORD *src, int len ) { return 0; }
+static inline int convert_line_555_from_8888_simd( WORD *dst, const DWORD *src, int len ) { return 0; }
+
+#endif  /* HAVE_SIMD_PRIMITIVES */
+
+void init_dib_primitives(void)
+{
+#ifdef HAVE_SIMD_PRIMITIVES
+    static const WCHAR nameW[] = {'W','I','N','E','D','I','B','S','I','M','D','='};
+    const WCHAR *env = NtCurrentTeb()->Peb->ProcessParameters->Environment;
+    int level = 2;
+
+    /* WINEDIBSIMD caps the kernels used: 0 for none, 1 for SSE2, 2 for AVX2 too.
+     * It is read from the process environment so that a child process can be started with it. */
+    for ( ; *env; env += wcslen( env ) + 1)
+        if (!wcsnicmp( env, nameW, ARRAY_SIZE(nameW) )) break;
+    if (*env) level = wcstol( env + ARRAY_SIZE(nameW), NULL, 10 );
+
+    __builtin_cpu_init();
+    sse2_supported = level >= 1 && __builtin_cpu_supports( "sse2" );
+    avx2_supported = level >= 2 && __builtin_cpu_supports( "avx2" );
+    TRACE( "level %d sse2 %u avx2 %u\n", level, sse2_supported, avx2_supported );
+#endif
+}
+
 static inline void do_rop_codes_line_16(WORD *dst, const WORD *src, struct rop_codes *codes, int len)
 {
-    for (; len > 0; len--, src++, dst++) do_rop_codes_16( dst, *src, codes );
+    int done = rop_codes_line_simd( (BYTE *)dst, (const BYTE *)src, codes, len * 2, FALSE ) / 2;
+
+    for (src += done, dst += done, len -= done; len > 0; len--, src++, dst++) do_rop_codes_16( dst, *src, codes );
 }
 
 static inline void do_rop_codes_line_rev_16(WORD *dst, const WORD *src, struct rop_codes *codes, int len)
 {
+    len -= rop_codes_line_simd( (BYTE *)dst, (const BYTE *)src, codes, len * 2, TRUE ) / 2;
     for (src += len - 1, dst += len - 1; len > 0; len--, src--, dst--)
         do_rop_codes_16( dst, *src, codes );
 }
 
 static inline void do_rop_codes_line_8(BYTE *dst, const BYTE *src, struct rop_codes *codes, int len)
 {
-    for (; len > 0; len--, src++, dst++) do_rop_codes_8( dst, *src, codes );
+    int done = rop_codes_line_simd( dst, src, codes, len, FALSE );
+
+    for (src += done, dst += done, len -= done; len > 0; len--, src++, dst++) do_rop_codes_8( dst, *src, codes );
 }
 
 static inline void do_rop_codes_line_rev_8(BYTE *dst, const BYTE *src, struct rop_codes *codes, int len)
 {
+    len -= rop_codes_line_simd( dst, src, codes, len, TRUE );
     for (src += len - 1, dst += len - 1; len > 0; len--, src--, dst--)
         do_rop_codes_8( dst, *src, codes );
 }
@@ -280,8 +670,11 @@ static void solid_rects_32(const dib_info *dib, int num, const RECT *rc, DWORD a
         start = get_pixel_ptr_32(dib, rc->left, rc->top);
         if (and)
             for(y = rc->top; y < rc->bottom; y++, start += dib->stride / 4)
-                for(x = rc->left, ptr = start; x < rc->right; x++)
+            {
+                x = solid_line_simd( start, (rc->right - rc->left) * 4, and, xor ) / 4;
+                for(ptr = start + x, x += rc->left; x < rc->right; x++)
                     do_rop_32(ptr++, and, xor);
+            }
         else
             for(y = rc->top; y < rc->bottom; y++, start += dib->stride / 4)
                 memset_32( start, xor, rc->right - rc->left );
@@ -292,8 +685,9 @@ static void solid_rects_24(const dib_info *dib, int num, const RECT *rc, DWORD a
 {
     DWORD *ptr, *start;
     BYTE *byte_ptr, *byte_start;
-    int x, y, i;
+    int x, y, i, done;
     DWORD and_masks[3], xor_masks[3];
+    static const DWORD zero_masks[3];
 
     and_masks[0] = ( and        & 0x00ffffff) | ((and << 24) & 0xff000000);
     and_masks[1] = ((and >>  8) & 0x0000ffff) | ((and << 16) & 0xffff0000);
@@ -345,7 +739,9 @@ static void solid_rects_24(const dib_info *dib, int num, const RECT *rc, DWORD a
                     break;
                 }
 
-                for(x = (left + 3) & ~3; x < (right & ~3); x += 4)
+                x = (left + 3) & ~3;
+                done = solid_line_24_simd( ptr, ((right & ~3) - x) / 4 * 3, and_masks, xor_masks );
+                for(ptr += done, x += done / 3 * 4; x < (right & ~3); x += 4)
                 {
                     do_rop_32(ptr++, and_masks[0], xor_masks[0]);
                     do_rop_32(ptr++, and_masks[1], xor_masks[1]);
@@ -392,7 +788,9 @@ static void solid_rects_24(const dib_info *dib, int num, const RECT *rc, DWORD a
                     break;
                 }
 
-                for(x = (left + 3) & ~3; x < (right & ~3); x += 4)
+                x = (left + 3) & ~3;
+                done = solid_line_24_simd( ptr, ((right & ~3) - x) / 4 * 3, zero_masks, xor_masks );
+                for(ptr += done, x += done / 3 * 4; x < (right & ~3); x += 4)
                 {
                     *ptr++ = xor_masks[0];
                     *ptr++ = xor_masks[1];
@@ -431,8 +829,12 @@ static void solid_rects_16(const dib_info *dib, int num, const RECT *rc, DWORD a
         start = get_pixel_ptr_16(dib, rc->left, rc->top);
         if (and)
             for(y = rc->top; y < rc->bottom; y++, start += dib->stride / 2)
-                for(x = rc->left, ptr = start; x < rc->right; x++)
+            {
+                x = solid_line_simd( start, (rc->right - rc->left) * 2,
+                                     (WORD)and * 0x10001, (WORD)xor * 0x10001 ) / 2;
+                for(ptr = start + x, x += rc->left; x < rc->right; x++)
                     do_rop_16(ptr++, and, xor);
+            }
         else
             for(y = rc->top; y < rc->bottom; y++, start += dib->stride / 2)
                 memset_16( start, xor, rc->right - rc->left );
@@ -1408,6 +1810,23 @@ static void copy_rect_32(const dib_info *dst, const RECT *rc,
         return;
     }
 
+#ifdef HAVE_SIMD_PRIMITIVES
+    if (sse2_supported)
+    {
+        struct rop_codes codes;
+
+        get_rop_codes( rop2, &codes );
+        for (y = rc->top; y < rc->bottom; y++, dst_start += dst_stride, src_start += src_stride)
+        {
+            if (overlap & OVERLAP_RIGHT)
+                do_rop_codes_line_rev_8( (BYTE *)dst_start, (BYTE *)src_start, &codes, (rc->right - rc->left) * 4 );
+            else
+                do_rop_codes_line_8( (BYTE *)dst_start, (BYTE *)src_start, &codes, (rc->right - rc->left) * 4 );
+        }
+        return;
+    }
+#endif
+
     size.cx = rc->right - rc->left;
     size.cy = rc->bottom - rc->top;
 
@@ -2222,7 +2641,7 @@ static inline BOOL bit_fields_match(const dib_info *d1, const dib_info *d2)
 static void convert_to_8888(dib_info *dst, const dib_info *src, const RECT *src_rect, BOOL dither)
 {
     DWORD *dst_start = get_pixel_ptr_32(dst, 0, 0), *dst_pixel, src_val;
-    int x, y, pad_size = (dst->width - (src_rect->right - src_rect->left)) * 4;
+    int x, y, done, pad_size = (dst->width - (src_rect->right - src_rect->left)) * 4;
 
     switch(src->bit_count)
     {
@@ -2248,9 +2667,11 @@ static void convert_to_8888(dib_info *dst, const dib_info *src, const RECT *src_
         {
             for(y = src_rect->top; y < src_rect->bottom; y++)
             {
-                dst_pixel = dst_start;
-                src_pixel = src_start;
-                for(x = src_rect->left; x < src_rect->right; x++)
+                done = convert_line_8888_from_32_simd( dst_start, src_start, src_rect->right - src_rect->left,
+                                                       src->red_shift, src->green_shift, src->blue_shift );
+                dst_pixel = dst_start + done;
+                src_pixel = src_start + done;
+                for(x = src_rect->left + done; x < src_rect->right; x++)
                 {
                     src_val = *src_pixel++;
                     *dst_pixel++ = (((src_val >> src->red_shift)   & 0xff) << 16) |
@@ -2314,9 +2735,10 @@ static void convert_to_8888(dib_info *dst, const dib_info *src, const RECT *src_
         {
             for(y = src_rect->top; y < src_rect->bottom; y++)
             {
-                dst_pixel = dst_start;
-                src_pixel = src_start;
-                for(x = src_rect->left; x < src_rect->right; x++)
+                done = convert_line_8888_from_555_simd( dst_start, src_start, src_rect->right - src_rect->left );
+                dst_pixel = dst_start + done;
+                src_pixel = src_start + done;
+                for(x = src_rect->left + done; x < src_rect->right; x++)
                 {
                     src_val = *src_pixel++;
                     *dst_pixel++ = ((src_val << 9) & 0xf80000) | ((src_val << 4) & 0x070000) |
@@ -2981,7 +3403,7 @@ static void convert_to_24(dib_info *dst, const dib_info *src, const RECT *src_re
 static void convert_to_555(dib_info *dst, const dib_info *src, const RECT *src_rect, BOOL dither)
 {
     WORD *dst_start = get_pixel_ptr_16(dst, 0, 0), *dst_pixel;
-    INT x, y, pad_size = ((dst->width + 1) & ~1) * 2 - (src_rect->right - src_rect->left) * 2;
+    INT x, y, done, pad_size = ((dst->width + 1) & ~1) * 2 - (src_rect->right - src_rect->left) * 2;
     DWORD src_val;
 
     switch(src->bit_count)
@@ -2994,9 +3416,10 @@ static void convert_to_555(dib_info *dst, const dib_info *src, const RECT *src_r
         {
             for(y = src_rect->top; y < src_rect->bottom; y++)
             {
-                dst_pixel = dst_start;
-                src_pixel = src_start;
-                for(x = src_rect->left; x < src_rect->right; x++)
+                done = convert_line_555_from_8888_simd( dst_start, src_start, src_rect->right - src_rect->left );
+                dst_pixel = dst_start + done;
+                src_pixel = src_start + done;
+                for(x = src_rect->left + done; x < src_rect->right; x++)
                 {
                     src_val = *src_pixel++;
                     *dst_pixel++ = ((src_val >> 9) & 0x7c00) |
@@ -4692,24 +5115,29 @@ static void blend_rects_8888(const dib_info *dst, int num, const RECT *rc,
         DWORD *src_ptr = get_pixel_ptr_32( src, rc->left + offset->x, rc->top + offset->y );
         DWORD *dst_ptr = get_pixel_ptr_32( dst, rc->left, rc->top );
 
+        int width = rc->right - rc->left;
+
         if (blend.AlphaFormat & AC_SRC_ALPHA)
         {
             if (blend.SourceConstantAlpha == 255)
                 for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-                    for (x = 0; x < rc->right - rc->left; x++)
+                    for (x = blend_line_simd( dst_ptr, src_ptr, width, 255, TRUE, 0 ); x < width; x++)
                         dst_ptr[x] = blend_argb( dst_ptr[x], src_ptr[x] );
             else
                 for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-                    for (x = 0; x < rc->right - rc->left; x++)
+                    for (x = blend_line_simd( dst_ptr, src_ptr, width, blend.SourceConstantAlpha, TRUE, 0 );
+                         x < width; x++)
                         dst_ptr[x] = blend_argb_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
         }
         else if (src->compression == BI_RGB)
             for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-                for (x = 0; x < rc->right - rc->left; x++)
+                for (x = blend_line_simd( dst_ptr, src_ptr, width, blend.SourceConstantAlpha, FALSE, 0 );
+                     x < width; x++)
                     dst_ptr[x] = blend_argb_constant_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
         else
             for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-                for (x = 0; x < rc->right - rc->left; x++)
+                for (x = blend_line_simd( dst_ptr, src_ptr, width, blend.SourceConstantAlpha, FALSE, 0xff000000 );
+                     x < width; x++)
                     dst_ptr[x] = blend_argb_no_src_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
     }
 }
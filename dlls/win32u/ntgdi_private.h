@@ -151,7 +151,7 @@ extern DWORD convert_bits( const BITMAPINFO *src_info, struct bitblt_coords *src
 extern BOOL intersect_vis_rectangles( struct bitblt_coords *dst, struct bitblt_coords *src );
 extern DWORD stretch_bits( const BITMAPINFO *src_info, struct bitblt_coords *src,
                            BITMAPINFO *dst_info, struct bitblt_coords *dst,
-                           struct gdi_image_bits *bits, int mode );
+                           struct gdi_image_bits *bits, int mode, BOOL app_bits );
 extern void get_mono_dc_colors( DC *dc, int color_table_size, BITMAPINFO *info, int count );
 
 /* brush.c */
@@ -199,7 +199,7 @@ extern DWORD convert_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, str
 
 extern DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bitblt_coords *src,
                                  const BITMAPINFO *dst_info, void *dst_bits, struct bitblt_coords *dst,
-                                 INT mode );
+                                 INT mode, BOOL app_bits );
 extern DWORD blend_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bitblt_coords *src,
                                const BITMAPINFO *dst_info, void *dst_bits, struct bitblt_coords *dst,
                                BLENDFUNCTION blend );
@@ -220,6 +220,8 @@ extern UINT set_dib_dc_color_table( HDC hdc, UINT startpos, UINT entries,
                                     const RGBQUAD *colors );
 extern void dibdrv_set_window_surface( DC *dc, struct window_surface *surface );
 extern struct opengl_funcs *dibdrv_get_wgl_driver(void);
+extern void init_dib_primitives(void);
+extern void init_dib_bands(void);
 
 /* driver.c */
 extern const struct gdi_dc_funcs null_driver;
@@ -70,6 +70,8 @@ static NTSTATUS init( void *args )
     }
 #endif
     KeAddSystemServiceTable( syscalls, NULL, ARRAY_SIZE(syscalls), arguments, 1 );
+    init_dib_primitives();
+    init_dib_bands();
     return STATUS_SUCCESS;
 }
 
@@ -23,6 +23,7 @@
 #include "windef.h"
 #include "winbase.h"
 #include "winstring.h"
+#include "bcrypt.h"
 
 #include "roapi.h"
 
@@ -538,6 +539,552 @@ skip_tests:
     ok( ref == 1, "got ref %ld.\n", ref );
 }
 
+#define BENCHMARK_BLOCK_SIZE 0x10000
+#define BENCHMARK_FILE_COUNT 16
+#define BENCHMARK_FILE_SIZE  (64 * 1024 * 1024)
+
+struct package_item
+{
+    char name[64];
+    UINT16 method;
+    UINT64 offset;
+    UINT64 size;
+    UINT64 compressed_size;  /* only used for deflated items */
+    UINT32 crc;
+};
+
+static UINT32 package_crc32( UINT32 crc, const BYTE *data, UINT32 size )
+{
+    UINT32 i, j;
+
+    crc = ~crc;
+    for (i = 0; i < size; i++)
+    {
+        crc ^= data[i];
+        for (j = 0; j < 8; j++) crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+    }
+    return ~crc;
+}
+
+static void package_base64( const BYTE *data, UINT32 size, char *output )
+{
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    UINT32 i, value;
+
+    for (i = 0; i < size; i += 3)
+    {
+        value = data[i] << 16 | (i + 1 < size ? data[i + 1] << 8 : 0) | (i + 2 < size ? data[i + 2] : 0);
+        *output++ = alphabet[(value >> 18) & 0x3f];
+        *output++ = alphabet[(value >> 12) & 0x3f];
+        *output++ = i + 1 < size ? alphabet[(value >> 6) & 0x3f] : '=';
+        *output++ = i + 2 < size ? alphabet[value & 0x3f] : '=';
+    }
+    *output = 0;
+}
+
+static void package_write( HANDLE file, const void *data, DWORD size, UINT64 *offset )
+{
+    DWORD written;
+    BOOL ret;
+
+    ret = WriteFile( file, data, size, &written, NULL );
+    ok( ret && written == size, "WriteFile failed, error %lu\n", GetLastError() );
+    *offset += size;
+}
+
+static UINT64 package_item_data_size( const struct package_item *item )
+{
+    return item->method ? item->compressed_size : item->size;
+}
+
+/* Items have ZIP64 sizes in the local headers like packages written by makeappx, data is
+ * already compressed for deflated items. */
+static void package_write_item( HANDLE file, struct package_item *item, const BYTE *data, UINT64 *offset )
+{
+    UINT16 name_length = strlen( item->name );
+    BYTE header[30 + 20] = {0};
+
+    item->offset = *offset;
+    *(UINT32 *)(header + 0) = 0x04034b50;
+    *(UINT16 *)(header + 4) = 45;
+    *(UINT16 *)(header + 8) = item->method;
+    *(UINT32 *)(header + 14) = item->crc;
+    *(UINT32 *)(header + 18) = 0xffffffff;
+    *(UINT32 *)(header + 22) = 0xffffffff;
+    *(UINT16 *)(header + 26) = name_length;
+    *(UINT16 *)(header + 28) = 20;
+    *(UINT16 *)(header + 30) = 0x0001;
+    *(UINT16 *)(header + 32) = 16;
+    *(UINT64 *)(header + 34) = item->size;
+    *(UINT64 *)(header + 42) = package_item_data_size( item );
+
+    package_write( file, header, 30, offset );
+    package_write( file, item->name, name_length, offset );
+    package_write( file, header + 30, 20, offset );
+    if (data) package_write( file, data, package_item_data_size( item ), offset );
+}
+
+static void package_write_directory( HANDLE file, struct package_item *items, UINT32 count, UINT64 *offset )
+{
+    UINT64 directory_offset = *offset, end_offset;
+    BYTE header[46 + 28], end64[56 + 20] = {0}, end[22] = {0};
+    UINT16 name_length;
+    UINT32 i;
+
+    for (i = 0; i < count; i++)
+    {
+        name_length = strlen( items[i].name );
+        memset( header, 0, sizeof(header) );
+        *(UINT32 *)(header + 0) = 0x02014b50;
+        *(UINT16 *)(header + 4) = 45;
+        *(UINT16 *)(header + 6) = 45;
+        *(UINT16 *)(header + 10) = items[i].method;
+        *(UINT32 *)(header + 16) = items[i].crc;
+        *(UINT32 *)(header + 20) = 0xffffffff;
+        *(UINT32 *)(header + 24) = 0xffffffff;
+        *(UINT16 *)(header + 28) = name_length;
+        *(UINT16 *)(header + 30) = 28;
+        *(UINT32 *)(header + 42) = 0xffffffff;
+        *(UINT16 *)(header + 46) = 0x0001;
+        *(UINT16 *)(header + 48) = 24;
+        *(UINT64 *)(header + 50) = items[i].size;
+        *(UINT64 *)(header + 58) = package_item_data_size( &items[i] );
+        *(UINT64 *)(header + 66) = items[i].offset;
+
+        package_write( file, header, 46, offset );
+        package_write( file, items[i].name, name_length, offset );
+        package_write( file, header + 46, 28, offset );
+    }
+
+    end_offset = *offset;
+    *(UINT32 *)(end64 + 0) = 0x06064b50;
+    *(UINT64 *)(end64 + 4) = 44;
+    *(UINT16 *)(end64 + 12) = 45;
+    *(UINT16 *)(end64 + 14) = 45;
+    *(UINT64 *)(end64 + 24) = count;
+    *(UINT64 *)(end64 + 32) = count;
+    *(UINT64 *)(end64 + 40) = end_offset - directory_offset;
+    *(UINT64 *)(end64 + 48) = directory_offset;
+    *(UINT32 *)(end64 + 56) = 0x07064b50;
+    *(UINT64 *)(end64 + 64) = end_offset;
+    *(UINT32 *)(end64 + 72) = 1;
+    package_write( file, end64, sizeof(end64), offset );
+
+    *(UINT32 *)(end + 0) = 0x06054b50;
+    *(UINT16 *)(end + 8) = 0xffff;
+    *(UINT16 *)(end + 10) = 0xffff;
+    *(UINT32 *)(end + 12) = 0xffffffff;
+    *(UINT32 *)(end + 16) = 0xffffffff;
+    package_write( file, end, sizeof(end), offset );
+}
+
+struct deflate_bits
+{
+    BYTE *output;
+    UINT32 size;
+    UINT32 bits;
+    UINT32 count;
+};
+
+static void deflate_put_bits( struct deflate_bits *stream, UINT32 value, UINT32 count )
+{
+    stream->bits |= value << stream->count;
+    stream->count += count;
+    while (stream->count >= 8)
+    {
+        stream->output[stream->size++] = stream->bits;
+        stream->bits >>= 8;
+        stream->count -= 8;
+    }
+}
+
+/* Huffman codes are stored starting from their most significant bit. */
+static void deflate_put_code( struct deflate_bits *stream, UINT32 code, UINT32 length )
+{
+    while (length--) deflate_put_bits( stream, (code >> length) & 1, 1 );
+}
+
+/* Compresses data as a single block with the fixed Huffman codes, using literals only. */
+static UINT32 deflate_fixed( const BYTE *data, UINT32 size, BYTE *output )
+{
+    struct deflate_bits stream = {output};
+    UINT32 i;
+
+    deflate_put_bits( &stream, 1, 1 );
+    deflate_put_bits( &stream, 1, 2 );
+    for (i = 0; i < size; i++)
+    {
+        if (data[i] < 144) deflate_put_code( &stream, 0x30 + data[i], 8 );
+        else deflate_put_code( &stream, 0x190 + data[i] - 144, 9 );
+    }
+    deflate_put_code( &stream, 0, 7 );
+    if (stream.count) deflate_put_bits( &stream, 0, 8 - stream.count );
+    return stream.size;
+}
+
+#define DEPLOY_PAYLOAD_SIZE 3000
+
+static void deploy_payload( BYTE *data )
+{
+    UINT32 i;
+
+    for (i = 0; i < DEPLOY_PAYLOAD_SIZE; i++) data[i] = "Wine deployment test payload\r\n"[i % 30] + (i / 30) % 3;
+}
+
+/* Writes a package with a deflated payload file, optionally with a wrong block hash. */
+static BOOL deploy_create_package( const WCHAR *path, const char *package_name, const char *item_name, BOOL bad_hash )
+{
+    static const char manifest_format[] =
+        "<?xml version=\"1.0\" encoding=\"utf-8\"?>\r\n"
+        "<Package xmlns=\"http://schemas.microsoft.com/appx/manifest/foundation/windows10\">\r\n"
+        "  <Identity Name=\"%s\" Publisher=\"CN=Wine, O=The Wine Project, C=US\" Version=\"1.0.0.0\" ProcessorArchitecture=\"neutral\" />\r\n"
+        "</Package>\r\n";
+    struct package_item items[3] = {{{0}}};
+    char manifest[512], block_map[1024], *cursor, hash_text[48];
+    BYTE data[DEPLOY_PAYLOAD_SIZE], compressed[2 * DEPLOY_PAYLOAD_SIZE], hash[32];
+    BCRYPT_ALG_HANDLE sha256;
+    NTSTATUS status;
+    UINT64 offset = 0;
+    HANDLE file;
+
+    file = CreateFileW( path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL );
+    ok( file != INVALID_HANDLE_VALUE, "failed to create %s, error %lu\n", debugstr_w(path), GetLastError() );
+    if (file == INVALID_HANDLE_VALUE) return FALSE;
+
+    sprintf( manifest, manifest_format, package_name );
+    strcpy( items[0].name, "AppxManifest.xml" );
+    items[0].size = strlen( manifest );
+    items[0].crc = package_crc32( 0, (const BYTE *)manifest, items[0].size );
+    package_write_item( file, &items[0], (const BYTE *)manifest, &offset );
+
+    deploy_payload( data );
+    strcpy( items[1].name, item_name );
+    items[1].method = 8;
+    items[1].size = DEPLOY_PAYLOAD_SIZE;
+    items[1].compressed_size = deflate_fixed( data, DEPLOY_PAYLOAD_SIZE, compressed );
+    items[1].crc = package_crc32( 0, data, DEPLOY_PAYLOAD_SIZE );
+    package_write_item( file, &items[1], compressed, &offset );
+
+    status = BCryptOpenAlgorithmProvider( &sha256, BCRYPT_SHA256_ALGORITHM, NULL, 0 );
+    ok( !status, "BCryptOpenAlgorithmProvider returned %#lx\n", status );
+    BCryptHash( sha256, NULL, 0, data, DEPLOY_PAYLOAD_SIZE, hash, sizeof(hash) );
+    BCryptCloseAlgorithmProvider( sha256, 0 );
+    if (bad_hash) hash[0] ^= 0xff;
+    package_base64( hash, sizeof(hash), hash_text );
+
+    /* an unsafe item name is rejected before the block map is looked at, it doesn't list it */
+    cursor = block_map + sprintf( block_map, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\r\n"
+                                  "<BlockMap xmlns=\"http://schemas.microsoft.com/appx/2010/blockmap\" HashMethod=\"http://www.w3.org/2001/04/xmlenc#sha256\">\r\n" );
+    if (!strcmp( item_name, "payload/hello.txt" ))
+        cursor += sprintf( cursor, "<File Name=\"payload\\hello.txt\" Size=\"%u\" LfhSize=\"%u\">\r\n"
+                           "<Block Hash=\"%s\"/>\r\n</File>\r\n", DEPLOY_PAYLOAD_SIZE,
+                           30 + (UINT32)strlen( item_name ) + 20, hash_text );
+    cursor += sprintf( cursor, "</BlockMap>\r\n" );
+    strcpy( items[2].name, "AppxBlockMap.xml" );
+    items[2].size = cursor - block_map;
+    items[2].crc = package_crc32( 0, (const BYTE *)block_map, items[2].size );
+    package_write_item( file, &items[2], (const BYTE *)block_map, &offset );
+
+    package_write_directory( file, items, ARRAY_SIZE(items), &offset );
+    CloseHandle( file );
+    return TRUE;
+}
+
+static BOOL benchmark_create_package( const WCHAR *path )
+{
+    static const char manifest[] =
+        "<?xml version=\"1.0\" encoding=\"utf-8\"?>\r\n"
+        "<Package xmlns=\"http://schemas.microsoft.com/appx/manifest/foundation/windows10\">\r\n"
+        "  <Identity Name=\"WineBenchmark\" Publisher=\"CN=Wine, O=The Wine Project, C=US\" Version=\"1.0.0.0\" ProcessorArchitecture=\"neutral\" />\r\n"
+        "</Package>\r\n";
+    struct package_item items[BENCHMARK_FILE_COUNT + 2] = {{{0}}};
+    char *block_map, *cursor, hash_text[48];
+    BCRYPT_ALG_HANDLE sha256;
+    UINT64 offset = 0;
+    BYTE *data, hash[32];
+    UINT32 i, j, k;
+    HANDLE file;
+    NTSTATUS status;
+
+    file = CreateFileW( path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+    ok( file != INVALID_HANDLE_VALUE, "failed to create %s, error %lu\n", debugstr_w(path), GetLastError() );
+    if (file == INVALID_HANDLE_VALUE) return FALSE;
+
+    status = BCryptOpenAlgorithmProvider( &sha256, BCRYPT_SHA256_ALGORITHM, NULL, 0 );
+    ok( !status, "BCryptOpenAlgorithmProvider returned %#lx\n", status );
+
+    data = malloc( BENCHMARK_FILE_SIZE );
+    cursor = block_map = malloc( BENCHMARK_FILE_COUNT * (BENCHMARK_FILE_SIZE / BENCHMARK_BLOCK_SIZE) * 64 + 4096 );
+    cursor += sprintf( cursor, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\r\n"
+                       "<BlockMap xmlns=\"http://schemas.microsoft.com/appx/2010/blockmap\" HashMethod=\"http://www.w3.org/2001/04/xmlenc#sha256\">\r\n" );
+
+    strcpy( items[0].name, "AppxManifest.xml" );
+    items[0].size = strlen( manifest );
+    items[0].crc = package_crc32( 0, (const BYTE *)manifest, items[0].size );
+    package_write_item( file, &items[0], (const BYTE *)manifest, &offset );
+
+    for (i = 1; i <= BENCHMARK_FILE_COUNT; i++)
+    {
+        sprintf( items[i].name, "payload/data%02u.bin", i );
+        items[i].size = BENCHMARK_FILE_SIZE;
+        for (j = 0; j < BENCHMARK_FILE_SIZE / sizeof(UINT32); j++) ((UINT32 *)data)[j] = j * 2654435761u + i;
+        items[i].crc = package_crc32( 0, data, BENCHMARK_FILE_SIZE );
+
+        cursor += sprintf( cursor, "<File Name=\"payload\\data%02u.bin\" Size=\"%u\" LfhSize=\"%u\">\r\n", i,
+                           BENCHMARK_FILE_SIZE, 30 + (UINT32)strlen( items[i].name ) + 20 );
+        for (k = 0; k < BENCHMARK_FILE_SIZE; k += BENCHMARK_BLOCK_SIZE)
+        {
+            BCryptHash( sha256, NULL, 0, data + k, BENCHMARK_BLOCK_SIZE, hash, sizeof(hash) );
+            package_base64( hash, sizeof(hash), hash_text );
+            cursor += sprintf( cursor, "<Block Hash=\"%s\"/>\r\n", hash_text );
+        }
+        cursor += sprintf( cursor, "</File>\r\n" );
+
+        package_write_item( file, &items[i], data, &offset );
+    }
+    cursor += sprintf( cursor, "</BlockMap>\r\n" );
+
+    strcpy( items[i].name, "AppxBlockMap.xml" );
+    items[i].size = cursor - block_map;
+    items[i].crc = package_crc32( 0, (const BYTE *)block_map, items[i].size );
+    package_write_item( file, &items[i], (const BYTE *)block_map, &offset );
+
+    package_write_directory( file, items, ARRAY_SIZE(items), &offset );
+
+    BCryptCloseAlgorithmProvider( sha256, 0 );
+    free( block_map );
+    free( data );
+    CloseHandle( file );
+    return TRUE;
+}
+
+static void package_delete_tree( const WCHAR *path )
+{
+    WCHAR child[MAX_PATH];
+    WIN32_FIND_DATAW data;
+    HANDLE find;
+
+    swprintf( child, MAX_PATH, L"%s\\*", path );
+    if ((find = FindFirstFileW( child, &data )) == INVALID_HANDLE_VALUE) return;
+    do
+    {
+        if (!wcscmp( data.cFileName, L"." ) || !wcscmp( data.cFileName, L".." )) continue;
+        swprintf( child, MAX_PATH, L"%s\\%s", path, data.cFileName );
+        if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+        {
+            package_delete_tree( child );
+            RemoveDirectoryW( child );
+        }
+        else DeleteFileW( child );
+    } while (FindNextFileW( find, &data ));
+    FindClose( find );
+}
+
+static void test_deployment_benchmark(void)
+{
+    static const WCHAR *statics_name = RuntimeClass_Windows_Management_Deployment_PackageManager;
+    IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress *operation;
+    WCHAR temp[MAX_PATH], path[MAX_PATH + 7], installed[MAX_PATH];
+    LARGE_INTEGER frequency, start, end;
+    WIN32_FIND_DATAW data;
+    IDeploymentResult *result;
+    IInspectable *inspectable;
+    IPackageManager *manager;
+    IUriRuntimeClass *uri;
+    HRESULT hr, async_hr;
+    HANDLE find;
+    double seconds;
+    HSTRING str;
+    DWORD ret;
+
+    hr = WindowsCreateString( statics_name, wcslen( statics_name ), &str );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    hr = RoActivateInstance( str, &inspectable );
+    WindowsDeleteString( str );
+    if (FAILED(hr))
+    {
+        win_skip( "%s runtimeclass not registered, skipping benchmark.\n", wine_dbgstr_w( statics_name ) );
+        return;
+    }
+    hr = IInspectable_QueryInterface( inspectable, &IID_IPackageManager, (void **)&manager );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    IInspectable_Release( inspectable );
+
+    GetTempPathW( ARRAY_SIZE(temp), temp );
+    GetTempFileNameW( temp, L"winetest-winrt", 0, temp );
+    DeleteFileW( temp );
+    CreateDirectoryW( temp, NULL );
+    swprintf( path, MAX_PATH, L"%s\\%s", temp, L"benchmark.msix" );
+
+    if (benchmark_create_package( path ))
+    {
+        swprintf( path, ARRAY_SIZE(path), L"file://%s\\%s", temp, L"benchmark.msix" );
+        hr = uri_create( path, &uri );
+        ok( hr == S_OK, "got hr %#lx.\n", hr );
+
+        QueryPerformanceFrequency( &frequency );
+        QueryPerformanceCounter( &start );
+
+        hr = IPackageManager_AddPackageAsync( manager, uri, NULL, DeploymentOptions_None, &operation );
+        ok( hr == S_OK, "got hr %#lx.\n", hr );
+        IUriRuntimeClass_Release( uri );
+
+        ret = await_IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress( operation, 600000 );
+        QueryPerformanceCounter( &end );
+        ok( ret == 0, "await_IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress returned %#lx\n", ret );
+
+        hr = IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress_GetResults( operation, &result );
+        ok( hr == S_OK, "GetResults returned %#lx\n", hr );
+        hr = IDeploymentResult_get_ExtendedErrorCode( result, &async_hr );
+        ok( hr == S_OK, "get_ExtendedErrorCode returned %#lx\n", hr );
+        ok( async_hr == S_OK, "got error %#lx\n", async_hr );
+        IDeploymentResult_Release( result );
+        IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress_Release( operation );
+
+        seconds = (double)(end.QuadPart - start.QuadPart) / frequency.QuadPart;
+        trace( "deployed %u MiB in %.2f s, %.1f MiB/s\n", BENCHMARK_FILE_COUNT * (BENCHMARK_FILE_SIZE >> 20), seconds,
+               BENCHMARK_FILE_COUNT * (BENCHMARK_FILE_SIZE >> 20) / seconds );
+
+        GetEnvironmentVariableW( L"ProgramFiles", installed, ARRAY_SIZE(installed) );
+        swprintf( path, ARRAY_SIZE(path), L"%s\\WindowsApps\\WineBenchmark_*", installed );
+        if ((find = FindFirstFileW( path, &data )) != INVALID_HANDLE_VALUE)
+        {
+            swprintf( path, ARRAY_SIZE(path), L"%s\\WindowsApps\\%s", installed, data.cFileName );
+            package_delete_tree( path );
+            RemoveDirectoryW( path );
+            FindClose( find );
+        }
+    }
+
+    package_delete_tree( temp );
+    RemoveDirectoryW( temp );
+    IPackageManager_Release( manager );
+}
+
+/* Deploys a package and returns the extended error code, the installed directory is left in installed. */
+static HRESULT deploy_test_package( IPackageManager *manager, const WCHAR *temp, const char *package_name,
+                                    const char *item_name, BOOL bad_hash, WCHAR *installed )
+{
+    IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress *operation;
+    WCHAR path[MAX_PATH + 7], program_files[MAX_PATH];
+    IDeploymentResult *result;
+    WIN32_FIND_DATAW data;
+    IUriRuntimeClass *uri;
+    HRESULT hr, async_hr;
+    HANDLE find;
+    DWORD ret;
+
+    *installed = 0;
+    swprintf( path, MAX_PATH, L"%s\\%S.msix", temp, package_name );
+    if (!deploy_create_package( path, package_name, item_name, bad_hash )) return E_FAIL;
+
+    swprintf( path, ARRAY_SIZE(path), L"file://%s\\%S.msix", temp, package_name );
+    hr = uri_create( path, &uri );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    hr = IPackageManager_AddPackageAsync( manager, uri, NULL, DeploymentOptions_None, &operation );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    IUriRuntimeClass_Release( uri );
+    if (FAILED(hr)) return hr;
+
+    ret = await_IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress( operation, 60000 );
+    ok( ret == 0, "await_IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress returned %#lx\n", ret );
+    hr = IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress_GetResults( operation, &result );
+    ok( hr == S_OK, "GetResults returned %#lx\n", hr );
+    hr = IDeploymentResult_get_ExtendedErrorCode( result, &async_hr );
+    ok( hr == S_OK, "get_ExtendedErrorCode returned %#lx\n", hr );
+    IDeploymentResult_Release( result );
+    IAsyncOperationWithProgress_DeploymentResult_DeploymentProgress_Release( operation );
+
+    GetEnvironmentVariableW( L"ProgramFiles", program_files, ARRAY_SIZE(program_files) );
+    swprintf( path, ARRAY_SIZE(path), L"%s\\WindowsApps\\%S_*", program_files, package_name );
+    if ((find = FindFirstFileW( path, &data )) != INVALID_HANDLE_VALUE)
+    {
+        swprintf( installed, MAX_PATH, L"%s\\WindowsApps\\%s", program_files, data.cFileName );
+        FindClose( find );
+    }
+    return async_hr;
+}
+
+static void deploy_remove_installed( const WCHAR *installed )
+{
+    if (!installed[0]) return;
+    package_delete_tree( installed );
+    RemoveDirectoryW( installed );
+}
+
+static void test_deployment(void)
+{
+    static const WCHAR *statics_name = RuntimeClass_Windows_Management_Deployment_PackageManager;
+    WCHAR temp[MAX_PATH], installed[MAX_PATH], path[MAX_PATH];
+    BYTE expect[DEPLOY_PAYLOAD_SIZE], data[DEPLOY_PAYLOAD_SIZE + 1];
+    IInspectable *inspectable;
+    IPackageManager *manager;
+    HRESULT hr, async_hr;
+    HSTRING str;
+    HANDLE file;
+    DWORD size;
+    BOOL ret;
+
+    hr = WindowsCreateString( statics_name, wcslen( statics_name ), &str );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    hr = RoActivateInstance( str, &inspectable );
+    WindowsDeleteString( str );
+    if (FAILED(hr))
+    {
+        win_skip( "%s runtimeclass not registered, skipping deployment tests.\n", wine_dbgstr_w( statics_name ) );
+        return;
+    }
+    hr = IInspectable_QueryInterface( inspectable, &IID_IPackageManager, (void **)&manager );
+    ok( hr == S_OK, "got hr %#lx.\n", hr );
+    IInspectable_Release( inspectable );
+
+    GetTempPathW( ARRAY_SIZE(temp), temp );
+    GetTempFileNameW( temp, L"winetest-winrt", 0, temp );
+    DeleteFileW( temp );
+    CreateDirectoryW( temp, NULL );
+
+    /* Windows refuses unsigned packages */
+    async_hr = deploy_test_package( manager, temp, "WineDeployTest", "payload/hello.txt", FALSE, installed );
+    ok( async_hr == S_OK || broken( FAILED(async_hr) ), "got error %#lx\n", async_hr );
+    if (async_hr == S_OK)
+    {
+        ok( installed[0] != 0, "package not installed\n" );
+        swprintf( path, ARRAY_SIZE(path), L"%s\\payload\\hello.txt", installed );
+        file = CreateFileW( path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL );
+        ok( file != INVALID_HANDLE_VALUE, "failed to open %s, error %lu\n", debugstr_w(path), GetLastError() );
+        if (file != INVALID_HANDLE_VALUE)
+        {
+            deploy_payload( expect );
+            ret = ReadFile( file, data, sizeof(data), &size, NULL );
+            ok( ret, "ReadFile failed, error %lu\n", GetLastError() );
+            ok( size == DEPLOY_PAYLOAD_SIZE, "got size %lu\n", size );
+            ok( !memcmp( data, expect, DEPLOY_PAYLOAD_SIZE ), "wrong payload data\n" );
+            CloseHandle( file );
+        }
+    }
+    deploy_remove_installed( installed );
+
+    async_hr = deploy_test_package( manager, temp, "WineDeployBadHash", "payload/hello.txt", TRUE, installed );
+    ok( FAILED(async_hr), "got error %#lx\n", async_hr );
+    ok( !installed[0], "package installed at %s\n", debugstr_w(installed) );
+    deploy_remove_installed( installed );
+
+    /* encoded separators must not let an item escape the package directory */
+    async_hr = deploy_test_package( manager, temp, "WineDeployTraversal", "payload/..%2F..%2F..%2Fwinetest-escape.txt",
+                                    FALSE, installed );
+    ok( FAILED(async_hr), "got error %#lx\n", async_hr );
+    ok( !installed[0], "package installed at %s\n", debugstr_w(installed) );
+    deploy_remove_installed( installed );
+    GetEnvironmentVariableW( L"ProgramFiles", path, ARRAY_SIZE(path) );
+    wcscat( path, L"\\winetest-escape.txt" );
+    ok( GetFileAttributesW( path ) == INVALID_FILE_ATTRIBUTES, "item written to %s\n", debugstr_w(path) );
+    DeleteFileW( path );
+
+    package_delete_tree( temp );
+    RemoveDirectoryW( temp );
+    IPackageManager_Release( manager );
+}
+
 static void test_PackageStatics(void)
 {
     static const WCHAR *package_statics_name = L"Windows.ApplicationModel.Package";
@@ -588,6 +1135,8 @@ START_TEST(model)
 
     test_PackageManager();
     test_PackageStatics();
+    test_deployment();
+    if (winetest_interactive) test_deployment_benchmark();
 
     RoUninitialize();
 }
@@ -42,17 +42,19 @@ HRESULT WINAPI app_data_paths_GetKnownFolder(IAppDataPaths *iface, const char *
     PathRemoveFileSpecW(manifestPath);
     PathAppendW(manifestPath, L"AppxManifest.xml");
 
-    registerAppxPackage( manifestPath, &package );
+    loadAppxPackage( manifestPath, &package );
 
     AppName = package.Package.Identity.Name;
 
     if (!GetUserNameW(username, &username_len)) {
+        freeAppxPackage(&package);
         return E_UNEXPECTED;
     }
 
     PathAppendW(path, username);
     PathAppendW(path, L"AppData\\Local\\Packages");
     PathAppendW(path, AppName); // Assuming AppName now holds the correct package name
+    freeAppxPackage(&package);
 
     if (!strcmp(FOLDERID, "cookies")) {
         PathAppendW(path, L"AC\\INetCookies");
@@ -0,0 +1,121 @@
+/* WinRT IWineAsync Completion Queue
+ *
+ * Written by Weather
+ *
+ * This is a reverse engineered implementation of Microsoft's OneCoreUAP binaries.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "AsyncQueueInternal.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(wineasync);
+
+//Indexed by APTTYPE
+static struct async_queue async_queues[] =
+{
+    { SRWLOCK_INIT, LIST_INIT( async_queues[0].pending ) },
+    { SRWLOCK_INIT, LIST_INIT( async_queues[1].pending ) },
+    { SRWLOCK_INIT, LIST_INIT( async_queues[2].pending ) },
+    { SRWLOCK_INIT, LIST_INIT( async_queues[3].pending ) },
+};
+
+static struct async_queue *async_queue_Get( void )
+{
+    APTTYPEQUALIFIER qualifier;
+    APTTYPE type;
+
+    //Threads that never joined an apartment belong to the implicit MTA.
+    if ( FAILED( CoGetApartmentType( &type, &qualifier ) ) || type < 0 || type >= ARRAY_SIZE(async_queues) )
+        type = APTTYPE_MTA;
+
+    return &async_queues[type];
+}
+
+static void CALLBACK async_queue_callback( TP_CALLBACK_INSTANCE *instance, void *context, TP_WORK *work )
+{
+    struct async_queue *queue = (struct async_queue *)context;
+    struct async_queue_entry *entry;
+    struct list *head;
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER now;
+    UINT64 latency;
+    UINT32 count;
+
+    AcquireSRWLockExclusive( &queue->lock );
+    queue->submitted--;
+
+    for ( count = 0; count < ASYNC_QUEUE_BATCH && (head = list_head( &queue->pending )); count++ )
+    {
+        entry = LIST_ENTRY( head, struct async_queue_entry, entry );
+        list_remove( &entry->entry );
+        queue->depth--;
+
+        QueryPerformanceCounter( &now );
+        latency = now.QuadPart - entry->queued.QuadPart;
+        queue->totalLatency += latency;
+        if ( latency > queue->maxLatency ) queue->maxLatency = latency;
+        ReleaseSRWLockExclusive( &queue->lock );
+
+        //The entry belongs to the operation, it may be gone once this returns.
+        entry->run( entry );
+
+        AcquireSRWLockExclusive( &queue->lock );
+        queue->completed++;
+    }
+
+    //Latency is accounted when an entry leaves the queue, a drained queue has seen all of it.
+    if ( !queue->depth && queue->queued && TRACE_ON(winrt_storage) )
+    {
+        QueryPerformanceFrequency( &frequency );
+        TRACE( "queue %p drained, max depth %u, %llu queued, %llu wakeups, %llu completed, latency %llu us average, %llu us max.\n",
+               queue, queue->maxDepth, queue->queued, queue->wakeups, queue->completed,
+               queue->totalLatency * 1000000 / frequency.QuadPart / queue->queued, queue->maxLatency * 1000000 / frequency.QuadPart );
+    }
+
+    ReleaseSRWLockExclusive( &queue->lock );
+}
+
+HRESULT WINAPI async_queue_Submit( struct async_queue_entry *entry )
+{
+    struct async_queue *queue = async_queue_Get();
+    BOOL wake;
+
+    QueryPerformanceCounter( &entry->queued );
+
+    AcquireSRWLockExclusive( &queue->lock );
+
+    if ( !queue->work && !(queue->work = CreateThreadpoolWork( async_queue_callback, queue, NULL )) )
+    {
+        ReleaseSRWLockExclusive( &queue->lock );
+        return HRESULT_FROM_WIN32( GetLastError() );
+    }
+
+    list_add_tail( &queue->pending, &entry->entry );
+    queue->queued++;
+    if ( ++queue->depth > queue->maxDepth ) queue->maxDepth = queue->depth;
+
+    //Only wake the pool when the callbacks already on their way cannot cover this entry.
+    if ( (wake = queue->submitted < queue->depth) )
+    {
+        queue->submitted++;
+        queue->wakeups++;
+    }
+
+    ReleaseSRWLockExclusive( &queue->lock );
+
+    if ( wake ) SubmitThreadpoolWork( queue->work );
+    return S_OK;
+}
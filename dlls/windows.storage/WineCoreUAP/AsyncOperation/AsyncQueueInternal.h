@@ -0,0 +1,66 @@
+/* WinRT IWineAsync Completion Queue
+ *
+ * Written by Weather
+ *
+ * This is a reverse engineered implementation of Microsoft's OneCoreUAP binaries.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef ASYNC_QUEUE_INTERNAL_H
+#define ASYNC_QUEUE_INTERNAL_H
+
+#include "../../private.h"
+#include "wine/debug.h"
+#include "wine/list.h"
+
+//How many callbacks a worker runs back to back before handing the queue over.
+#define ASYNC_QUEUE_BATCH 32
+//Released async infos kept around for reuse, per implementation.
+#define ASYNC_INFO_POOL_MAX 256
+
+struct async_queue_entry
+{
+    struct list entry;
+    void (*run)( struct async_queue_entry *entry );
+    LARGE_INTEGER queued;
+};
+
+/**
+ * Developer notes: There is one queue per caller apartment type, each backed by a single TP_WORK.
+ * Every queued entry is covered by at least one submitted, not yet started, work callback,
+ * so a callback blocking on another operation can never starve the queue. Workers that finish
+ * early pick up the following entries themselves, which lets later submissions skip the wakeup.
+ */
+struct async_queue
+{
+    SRWLOCK lock;
+    struct list pending;
+    TP_WORK *work;
+    UINT32 depth;
+    UINT32 submitted;
+
+    //Counters
+    UINT32 maxDepth;
+    UINT64 queued;
+    UINT64 wakeups;
+    UINT64 completed;
+    UINT64 totalLatency;
+    UINT64 maxLatency;
+};
+
+HRESULT WINAPI async_queue_Submit( struct async_queue_entry *entry );
+
+#endif
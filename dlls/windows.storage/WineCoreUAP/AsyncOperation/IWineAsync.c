@@ -20,6 +20,7 @@
 
 #include "../../private.h"
 #include "provider.h"
+#include "AsyncQueueInternal.h"
 
 #include "wine/debug.h"
 
@@ -36,7 +37,8 @@ struct async_info
     LONG ref;
 
     async_operation_callback callback;
-    TP_WORK *async_run_work;
+    struct async_queue_entry queueEntry;
+    SLIST_ENTRY poolEntry;
     IUnknown *invoker;
     IUnknown *param;
 
@@ -47,6 +49,41 @@ struct async_info
     HRESULT hr;
 };
 
+static SLIST_HEADER async_info_pool;
+static LONG async_info_pool_size;
+
+static struct async_info *async_info_alloc( void )
+{
+    struct async_info *impl;
+    SLIST_ENTRY *entry;
+
+    if ((entry = InterlockedPopEntrySList( &async_info_pool )))
+    {
+        InterlockedDecrement( &async_info_pool_size );
+        return CONTAINING_RECORD( entry, struct async_info, poolEntry );
+    }
+
+    if (!(impl = calloc( 1, sizeof(*impl) ))) return NULL;
+    InitializeCriticalSectionEx( &impl->cs, 0, RTL_CRITICAL_SECTION_FLAG_FORCE_DEBUG_INFO );
+    impl->cs.DebugInfo->Spare[0] = (DWORD_PTR)( __FILE__ ": async_info.cs" );
+    return impl;
+}
+
+static void async_info_free( struct async_info *impl )
+{
+    /* pooled blocks keep their critical section */
+    if (InterlockedIncrement( &async_info_pool_size ) <= ASYNC_INFO_POOL_MAX)
+    {
+        InterlockedPushEntrySList( &async_info_pool, &impl->poolEntry );
+        return;
+    }
+
+    InterlockedDecrement( &async_info_pool_size );
+    impl->cs.DebugInfo->Spare[0] = 0;
+    DeleteCriticalSection( &impl->cs );
+    free( impl );
+}
+
 static inline struct async_info *impl_from_IWineAsyncInfoImpl( IWineAsyncInfoImpl *iface )
 {
     return CONTAINING_RECORD( iface, struct async_info, IWineAsyncInfoImpl_iface );
@@ -98,9 +135,8 @@ static ULONG WINAPI async_impl_Release( IWineAsyncInfoImpl *iface )
         IAsyncInfo_Close( &impl->IAsyncInfo_iface );
         if (impl->param) IUnknown_Release( impl->param );
         if (impl->invoker) IUnknown_Release( impl->invoker );
-        impl->cs.DebugInfo->Spare[0] = 0;
-        DeleteCriticalSection( &impl->cs );
-        free( impl );
+        PropVariantClear( &impl->result );
+        async_info_free( impl );
     }
 
     return ref;
@@ -175,14 +211,15 @@ static HRESULT WINAPI async_impl_get_Result( IWineAsyncInfoImpl *iface, PROPVARI
 static HRESULT WINAPI async_impl_Start( IWineAsyncInfoImpl *iface )
 {
     struct async_info *impl = impl_from_IWineAsyncInfoImpl( iface );
+    HRESULT hr;
 
     TRACE( "iface %p.\n", iface );
 
     /* keep the async alive in the callback */
     IInspectable_AddRef( impl->IInspectable_outer );
-    SubmitThreadpoolWork( impl->async_run_work );
+    if (FAILED(hr = async_queue_Submit( &impl->queueEntry ))) IInspectable_Release( impl->IInspectable_outer );
 
-    return S_OK;
+    return hr;
 }
 
 static const struct IWineAsyncInfoImplVtbl async_impl_vtbl =
@@ -271,11 +308,7 @@ static HRESULT WINAPI async_info_Close( IAsyncInfo *iface )
     if (impl->status == Started)
         hr = E_ILLEGAL_STATE_CHANGE;
     else if (impl->status != Closed)
-    {
-        CloseThreadpoolWork( impl->async_run_work );
-        impl->async_run_work = NULL;
         impl->status = Closed;
-    }
     LeaveCriticalSection( &impl->cs );
 
     return hr;
@@ -299,17 +332,24 @@ const struct IAsyncInfoVtbl async_info_vtbl =
     async_info_Close,
 };
 
-static void CALLBACK async_info_callback( TP_CALLBACK_INSTANCE *instance, void *iface, TP_WORK *work )
+static void async_info_run( struct async_queue_entry *entry )
 {
-    struct async_info *impl = impl_from_IWineAsyncInfoImpl( iface );
+    struct async_info *impl = CONTAINING_RECORD( entry, struct async_info, queueEntry );
     IInspectable *operation = impl->IInspectable_outer;
     PROPVARIANT result;
+    BOOL canceled;
     HRESULT hr;
 
-    hr = impl->callback( impl->invoker, impl->param, &result );
+    /* operations canceled while still queued are never run */
+    EnterCriticalSection( &impl->cs );
+    canceled = impl->status == Canceled;
+    LeaveCriticalSection( &impl->cs );
+
+    PropVariantInit( &result );
+    hr = canceled ? E_ABORT : impl->callback( impl->invoker, impl->param, &result );
 
     EnterCriticalSection( &impl->cs );
-    if (impl->status != Closed) impl->status = FAILED(hr) ? Error : Completed;
+    if (impl->status == Started) impl->status = FAILED(hr) ? Error : Completed;
     PropVariantCopy( &impl->result, &result );
     impl->hr = hr;
 
@@ -335,32 +375,25 @@ HRESULT async_info_create( IUnknown *invoker, IUnknown *param, async_operation_c
                                   IInspectable *outer, IWineAsyncInfoImpl **out )
 {
     struct async_info *impl;
-    HRESULT hr;
 
-    if (!(impl = calloc( 1, sizeof(struct async_info) ))) return E_OUTOFMEMORY;
+    /* blocks may come back from the pool, every field is set here */
+    if (!(impl = async_info_alloc())) return E_OUTOFMEMORY;
     impl->IWineAsyncInfoImpl_iface.lpVtbl = &async_impl_vtbl;
     impl->IAsyncInfo_iface.lpVtbl = &async_info_vtbl;
     impl->IInspectable_outer = outer;
     impl->ref = 1;
 
     impl->callback = callback;
+    impl->queueEntry.run = async_info_run;
     impl->handler = HANDLER_NOT_SET;
+    PropVariantInit( &impl->result );
     impl->status = Started;
-
-    if (!(impl->async_run_work = CreateThreadpoolWork( async_info_callback, &impl->IWineAsyncInfoImpl_iface, NULL )))
-    {
-        hr = HRESULT_FROM_WIN32( GetLastError() );
-        free( impl );
-        return hr;
-    }
+    impl->hr = S_OK;
 
     if ((impl->invoker = invoker)) IUnknown_AddRef( impl->invoker );
     //Broken. if ((impl->param = param)) IUnknown_AddRef( impl->param ); 
     impl->param = param;
 
-    InitializeCriticalSectionEx( &impl->cs, 0, RTL_CRITICAL_SECTION_FLAG_FORCE_DEBUG_INFO );
-    impl->cs.DebugInfo->Spare[0] = (DWORD_PTR)( __FILE__ ": async_info.cs" );
-    
     *out = &impl->IWineAsyncInfoImpl_iface;
     return S_OK;
 }
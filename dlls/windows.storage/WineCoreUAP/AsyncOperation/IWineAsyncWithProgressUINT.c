@@ -20,6 +20,7 @@
 
 #include "../../private.h"
 #include "provider.h"
+#include "AsyncQueueInternal.h"
 
 #include "wine/debug.h"
 
@@ -38,19 +39,57 @@ struct async_info_with_progress
     LONG ref;
 
     async_operation_with_progress_callback callback;
-    TP_WORK *async_run_work;
+    struct async_queue_entry queueEntry;
+    SLIST_ENTRY poolEntry;
     IUnknown *invoker;
     IUnknown *param;
 
+    /* IAsyncInfo is shared with struct async_info, the fields above and up to hr must line up */
     CRITICAL_SECTION cs;
     IWineAsyncOperationCompletedHandler *handler;
-    IWineAsyncOperationProgressHandler *progress;
     PROPVARIANT result;
-    UINT64 progressReport;
     AsyncStatus status;
     HRESULT hr;
+
+    IWineAsyncOperationProgressHandler *progress;
+    UINT64 progressReport;
 };
 
+static SLIST_HEADER async_info_with_progress_pool;
+static LONG async_info_with_progress_pool_size;
+
+static struct async_info_with_progress *async_info_with_progress_alloc( void )
+{
+    struct async_info_with_progress *impl;
+    SLIST_ENTRY *entry;
+
+    if ((entry = InterlockedPopEntrySList( &async_info_with_progress_pool )))
+    {
+        InterlockedDecrement( &async_info_with_progress_pool_size );
+        return CONTAINING_RECORD( entry, struct async_info_with_progress, poolEntry );
+    }
+
+    if (!(impl = calloc( 1, sizeof(*impl) ))) return NULL;
+    InitializeCriticalSectionEx( &impl->cs, 0, RTL_CRITICAL_SECTION_FLAG_FORCE_DEBUG_INFO );
+    impl->cs.DebugInfo->Spare[0] = (DWORD_PTR)( __FILE__ ": async_info_with_progress.cs" );
+    return impl;
+}
+
+static void async_info_with_progress_free( struct async_info_with_progress *impl )
+{
+    /* pooled blocks keep their critical section */
+    if (InterlockedIncrement( &async_info_with_progress_pool_size ) <= ASYNC_INFO_POOL_MAX)
+    {
+        InterlockedPushEntrySList( &async_info_with_progress_pool, &impl->poolEntry );
+        return;
+    }
+
+    InterlockedDecrement( &async_info_with_progress_pool_size );
+    impl->cs.DebugInfo->Spare[0] = 0;
+    DeleteCriticalSection( &impl->cs );
+    free( impl );
+}
+
 static inline struct async_info_with_progress *impl_from_IWineAsyncInfoWithProgressImpl( IWineAsyncInfoWithProgressImpl *iface )
 {
     return CONTAINING_RECORD( iface, struct async_info_with_progress, IWineAsyncInfoWithProgressImpl_iface );
@@ -99,12 +138,12 @@ static ULONG WINAPI async_impl_Release( IWineAsyncInfoWithProgressImpl *iface )
     if (!ref)
     {
         if (impl->handler && impl->handler != HANDLER_NOT_SET) IWineAsyncOperationCompletedHandler_Release( impl->handler );
+        if (impl->progress && impl->progress != HANDLER_NOT_SET) IWineAsyncOperationProgressHandler_Release( impl->progress );
         IAsyncInfo_Close( &impl->IAsyncInfo_iface );
         if (impl->param) IUnknown_Release( impl->param );
         if (impl->invoker) IUnknown_Release( impl->invoker );
-        impl->cs.DebugInfo->Spare[0] = 0;
-        DeleteCriticalSection( &impl->cs );
-        free( impl );
+        PropVariantClear( &impl->result );
+        async_info_with_progress_free( impl );
     }
 
     return ref;
@@ -231,14 +270,15 @@ static HRESULT WINAPI async_impl_get_Progress( IWineAsyncInfoWithProgressImpl *i
 static HRESULT WINAPI async_impl_Start( IWineAsyncInfoWithProgressImpl *iface )
 {
     struct async_info_with_progress *impl = impl_from_IWineAsyncInfoWithProgressImpl( iface );
+    HRESULT hr;
 
     TRACE( "iface %p.\n", iface );
 
     /* keep the async alive in the callback */
     IInspectable_AddRef( impl->IInspectable_outer );
-    SubmitThreadpoolWork( impl->async_run_work );
+    if (FAILED(hr = async_queue_Submit( &impl->queueEntry ))) IInspectable_Release( impl->IInspectable_outer );
 
-    return S_OK;
+    return hr;
 }
 
 static const struct IWineAsyncInfoWithProgressImplVtbl async_impl_vtbl =
@@ -256,17 +296,26 @@ static const struct IWineAsyncInfoWithProgressImplVtbl async_impl_vtbl =
     async_impl_Start,
 };
 
-static void CALLBACK async_info_with_progress_callback( TP_CALLBACK_INSTANCE *instance, void *iface, TP_WORK *work )
+static void async_info_with_progress_run( struct async_queue_entry *entry )
 {
-    struct async_info_with_progress *impl = impl_from_IWineAsyncInfoWithProgressImpl( iface );
+    struct async_info_with_progress *impl = CONTAINING_RECORD( entry, struct async_info_with_progress, queueEntry );
     IInspectable *operation = impl->IInspectable_outer;
+    IWineAsyncOperationProgressHandler *progress;
     PROPVARIANT result;
+    BOOL canceled;
     HRESULT hr;
 
-    hr = impl->callback( impl->invoker, impl->param, &result, impl->progress );
+    /* operations canceled while still queued are never run */
+    EnterCriticalSection( &impl->cs );
+    canceled = impl->status == Canceled;
+    progress = impl->progress == HANDLER_NOT_SET ? NULL : impl->progress;
+    LeaveCriticalSection( &impl->cs );
+
+    PropVariantInit( &result );
+    hr = canceled ? E_ABORT : impl->callback( impl->invoker, impl->param, &result, progress );
 
     EnterCriticalSection( &impl->cs );
-    if (impl->status != Closed) impl->status = FAILED(hr) ? Error : Completed;
+    if (impl->status == Started) impl->status = FAILED(hr) ? Error : Completed;
     PropVariantCopy( &impl->result, &result );
     impl->hr = hr;
 
@@ -292,32 +341,27 @@ HRESULT async_info_with_progress_create( IUnknown *invoker, IUnknown *param, asy
                                   IInspectable *outer, IWineAsyncInfoWithProgressImpl **out )
 {
     struct async_info_with_progress *impl;
-    HRESULT hr;
 
-    if (!(impl = calloc( 1, sizeof(struct async_info_with_progress) ))) return E_OUTOFMEMORY;
+    /* blocks may come back from the pool, every field is set here */
+    if (!(impl = async_info_with_progress_alloc())) return E_OUTOFMEMORY;
     impl->IWineAsyncInfoWithProgressImpl_iface.lpVtbl = &async_impl_vtbl;
     impl->IAsyncInfo_iface.lpVtbl = &async_info_vtbl;
     impl->IInspectable_outer = outer;
     impl->ref = 1;
 
     impl->callback = callback;
+    impl->queueEntry.run = async_info_with_progress_run;
     impl->handler = HANDLER_NOT_SET;
+    impl->progress = HANDLER_NOT_SET;
+    impl->progressReport = 0;
+    PropVariantInit( &impl->result );
     impl->status = Started;
-
-    if (!(impl->async_run_work = CreateThreadpoolWork( async_info_with_progress_callback, &impl->IWineAsyncInfoWithProgressImpl_iface, NULL )))
-    {
-        hr = HRESULT_FROM_WIN32( GetLastError() );
-        free( impl );
-        return hr;
-    }
+    impl->hr = S_OK;
 
     if ((impl->invoker = invoker)) IUnknown_AddRef( impl->invoker );
     //Broken. if ((impl->param = param)) IUnknown_AddRef( impl->param ); 
     impl->param = param;
 
-    InitializeCriticalSectionEx( &impl->cs, 0, RTL_CRITICAL_SECTION_FLAG_FORCE_DEBUG_INFO );
-    impl->cs.DebugInfo->Spare[0] = (DWORD_PTR)( __FILE__ ": async_info_with_progress.cs" );
-    
     *out = &impl->IWineAsyncInfoWithProgressImpl_iface;
     return S_OK;
 }
@@ -249,272 +249,54 @@ static HRESULT WINAPI file_io_statics_ReadLinesWithEncodingAsync( IFileIOStatics
     return hr;
 }
 
-static HRESULT WINAPI file_io_statics_WriteLinesAsync( IFileIOStatics *iface, IStorageFile *file, IIterable_HSTRING *lines, IAsyncAction **operation )
+/**
+ * The lines are only walked once the action runs, straight into the file.
+ */
+static HRESULT file_io_statics_CreateWriteLinesAction( IFileIOStatics *iface, IStorageFile *file, IIterable_HSTRING *lines, UnicodeEncoding encoding, BOOL append, IAsyncAction **operation )
 {
-    //Convert IIterable_HSTRING to HSTRING
     HRESULT hr;
-    HSTRING *strings;
-    LPWSTR combinedString = NULL;
-    LPWSTR tmpStr;
-    UINT32 vectorSize = 0;
-    UINT32 totalSize = 0;
-    UINT32 i;
-    boolean strExists;
-    IIterator_HSTRING *hstringIterator;
-
-    struct file_io_write_text_options *write_text_options;
+    struct file_io_write_lines_options *write_lines_options;
 
-    TRACE( "iface %p, operation %p\n", iface, operation );
+    if (!(write_lines_options = calloc( 1, sizeof(*write_lines_options) ))) return E_OUTOFMEMORY;
 
-    if (!(write_text_options = calloc( 1, sizeof(*write_text_options) ))) return E_OUTOFMEMORY;
+    write_lines_options->file = file;
+    write_lines_options->lines = lines;
+    write_lines_options->encoding = encoding;
+    write_lines_options->append = append;
+    IIterable_HSTRING_AddRef( lines );
 
-    hr = IIterable_HSTRING_First( lines, &hstringIterator );
-    if ( SUCCEEDED( hr ) )
+    hr = async_action_create( (IUnknown *)iface, (IUnknown *)write_lines_options, file_io_statics_WriteLines, operation );
+    if ( FAILED( hr ) )
     {
-        IIterator_HSTRING_get_HasCurrent( hstringIterator, &strExists );
-        while ( strExists )
-        {
-            vectorSize++;
-            IIterator_HSTRING_MoveNext( hstringIterator, &strExists );
-        }
-
-        strings = (HSTRING *)malloc( vectorSize * sizeof( HSTRING ) );
-        IIterable_HSTRING_First( lines, &hstringIterator );
-        
-        for ( i = 0; i < vectorSize; i++ )
-        {
-            IIterator_HSTRING_get_Current( hstringIterator, &strings[i] );
-            IIterator_HSTRING_MoveNext( hstringIterator, &strExists );
-        }
-
-        for ( i = 0; i < vectorSize; i++ ) 
-        {
-            totalSize += WindowsGetStringLen( strings[i] ) + 1; 
-        }
-
-        combinedString = (LPWSTR)malloc( ( totalSize + 1 ) * sizeof( WCHAR ) );
-        combinedString[0] = L'\0';
-
-        for ( i = 0; i < vectorSize; i++ )
-        {
-            tmpStr = (LPWSTR)malloc( ( WindowsGetStringLen( strings[i] ) + 1 ) * sizeof( WCHAR ) );
-            wcscpy( tmpStr, WindowsGetStringRawBuffer( strings[i], NULL ) );
-            wcscat( tmpStr, L"\n" );
-            wcscat( combinedString, tmpStr );
-        }
+        //The action never ran, nothing else releases the lines.
+        IIterable_HSTRING_Release( lines );
+        free( write_lines_options );
     }
+    return hr;
+}
 
-    //Remove trailing nextspace
-    combinedString[ wcslen(combinedString) - 1 ] = L'\0'; 
-
-    write_text_options->encoding = UnicodeEncoding_Utf8;
-    write_text_options->file = file;
-    if ( combinedString )
-        WindowsCreateString( combinedString, wcslen( combinedString ), &write_text_options->contents );
-
-    hr = async_action_create( (IUnknown *)iface, (IUnknown *)write_text_options, file_io_statics_WriteText, operation );
-    return S_OK;
+static HRESULT WINAPI file_io_statics_WriteLinesAsync( IFileIOStatics *iface, IStorageFile *file, IIterable_HSTRING *lines, IAsyncAction **operation )
+{
+    TRACE( "iface %p, operation %p\n", iface, operation );
+    return file_io_statics_CreateWriteLinesAction( iface, file, lines, UnicodeEncoding_Utf8, FALSE, operation );
 }
 
 static HRESULT WINAPI file_io_statics_WriteLinesWithEncodingAsync( IFileIOStatics *iface, IStorageFile *file, IIterable_HSTRING *lines, UnicodeEncoding encoding, IAsyncAction **operation )
 {
-    //Convert IIterable_HSTRING to HSTRING
-    HRESULT hr;
-    HSTRING *strings;
-    LPWSTR combinedString = NULL;
-    LPWSTR tmpStr;
-    UINT32 vectorSize = 0;
-    UINT32 totalSize = 0;
-    UINT32 i;
-    boolean strExists;
-    IIterator_HSTRING *hstringIterator;
-
-    struct file_io_write_text_options *write_text_options;
-
     TRACE( "iface %p, operation %p\n", iface, operation );
-
-    if (!(write_text_options = calloc( 1, sizeof(*write_text_options) ))) return E_OUTOFMEMORY;
-
-    hr = IIterable_HSTRING_First( lines, &hstringIterator );
-    if ( SUCCEEDED( hr ) )
-    {
-        IIterator_HSTRING_get_HasCurrent( hstringIterator, &strExists );
-        while ( strExists )
-        {
-            vectorSize++;
-            IIterator_HSTRING_MoveNext( hstringIterator, &strExists );
-        }
-
-        strings = (HSTRING *)malloc( vectorSize * sizeof( HSTRING ) );
-        IIterable_HSTRING_First( lines, &hstringIterator );
-        
-        for ( i = 0; i < vectorSize; i++ )
-        {
-            IIterator_HSTRING_get_Current( hstringIterator, &strings[i] );
-            IIterator_HSTRING_MoveNext( hstringIterator, &strExists );
-        }
-
-        for ( i = 0; i < vectorSize; i++ ) 
-        {
-            totalSize += WindowsGetStringLen( strings[i] ) + 1; 
-        }
-
-        combinedString = (LPWSTR)malloc( ( totalSize + 1 ) * sizeof( WCHAR ) );
-        combinedString[0] = L'\0';
-
-        for ( i = 0; i < vectorSize; i++ )
-        {
-            tmpStr = (LPWSTR)malloc( ( WindowsGetStringLen( strings[i] ) + 1 ) * sizeof( WCHAR ) );
-            wcscpy( tmpStr, WindowsGetStringRawBuffer( strings[i], NULL ) );
-            wcscat( tmpStr, L"\n" );
-            wcscat( combinedString, tmpStr );
-        }
-    }
-
-    //Remove trailing nextspace
-    combinedString[ wcslen(combinedString) - 1 ] = L'\0'; 
-
-    write_text_options->encoding = encoding;
-    write_text_options->file = file;
-    if ( combinedString )
-        WindowsCreateString( combinedString, wcslen( combinedString ), &write_text_options->contents );
-
-    hr = async_action_create( (IUnknown *)iface, (IUnknown *)write_text_options, file_io_statics_WriteText, operation );
-    return S_OK;
+    return file_io_statics_CreateWriteLinesAction( iface, file, lines, encoding, FALSE, operation );
 }
 
 static HRESULT WINAPI file_io_statics_AppendLinesAsync( IFileIOStatics *iface, IStorageFile *file, IIterable_HSTRING *lines, IAsyncAction **operation )
 {
-    //Convert IIterable_HSTRING to HSTRING
-    HRESULT hr;
-    HSTRING *strings;
-    LPWSTR combinedString = NULL;
-    LPWSTR tmpStr;
-    UINT32 vectorSize = 0;
-    UINT32 totalSize = 0;
-    UINT32 i;
-    boolean strExists;
-    IIterator_HSTRING *hstringIterator;
-
-    struct file_io_write_text_options *write_text_options;
-
     TRACE( "iface %p, operation %p\n", iface, operation );
-
-    if (!(write_text_options = calloc( 1, sizeof(*write_text_options) ))) return E_OUTOFMEMORY;
-
-    hr = IIterable_HSTRING_First( lines, &hstringIterator );
-    if ( SUCCEEDED( hr ) )
-    {
-        IIterator_HSTRING_get_HasCurrent( hstringIterator, &strExists );
-        while ( strExists )
-        {
-            vectorSize++;
-            IIterator_HSTRING_MoveNext( hstringIterator, &strExists );
-        }
-
-        strings = (HSTRING *)malloc( vectorSize * sizeof( HSTRING ) );
-        IIterable_HSTRING_First( lines, &hstringIterator );
-        
-        for ( i = 0; i < vectorSize; i++ )
-        {
-            IIterator_HSTRING_get_Current( hstringIterator, &strings[i] );
-            IIterator_HSTRING_MoveNext( hstringIterator, &strExists );
-        }
-
-        for ( i = 0; i < vectorSize; i++ ) 
-        {
-            totalSize += WindowsGetStringLen( strings[i] ) + 1; 
-        }
-
-        combinedString = (LPWSTR)malloc( ( totalSize + 1 ) * sizeof( WCHAR ) );
-        combinedString[0] = L'\0';
-
-        for ( i = 0; i < vectorSize; i++ )
-        {
-            tmpStr = (LPWSTR)malloc( ( WindowsGetStringLen( strings[i] ) + 1 ) * sizeof( WCHAR ) );
-            wcscpy( tmpStr, WindowsGetStringRawBuffer( strings[i], NULL ) );
-            wcscat( tmpStr, L"\n" );
-            wcscat( combinedString, tmpStr );
-        }
-    }
-
-    //Remove trailing nextspace
-    combinedString[ wcslen(combinedString) - 1 ] = L'\0'; 
-
-    write_text_options->encoding = UnicodeEncoding_Utf8;
-    write_text_options->file = file;
-    if ( combinedString )
-        WindowsCreateString( combinedString, wcslen( combinedString ), &write_text_options->contents );
-
-    hr = async_action_create( (IUnknown *)iface, (IUnknown *)write_text_options, file_io_statics_AppendText, operation );
-    return S_OK;
+    return file_io_statics_CreateWriteLinesAction( iface, file, lines, UnicodeEncoding_Utf8, TRUE, operation );
 }
 
 static HRESULT WINAPI file_io_statics_AppendLinesWithEncodingAsync( IFileIOStatics *iface, IStorageFile *file, IIterable_HSTRING *lines, UnicodeEncoding encoding, IAsyncAction **operation )
 {
-    //Convert IIterable_HSTRING to HSTRING
-    HRESULT hr;
-    HSTRING *strings;
-    LPWSTR combinedString = NULL;
-    LPWSTR tmpStr;
-    UINT32 vectorSize = 0;
-    UINT32 totalSize = 0;
-    UINT32 i;
-    boolean strExists;
-    IIterator_HSTRING *hstringIterator;
-
-    struct file_io_write_text_options *write_text_options;
-
     TRACE( "iface %p, operation %p\n", iface, operation );
-
-    if (!(write_text_options = calloc( 1, sizeof(*write_text_options) ))) return E_OUTOFMEMORY;
-
-    hr = IIterable_HSTRING_First( lines, &hstringIterator );
-    if ( SUCCEEDED( hr ) )
-    {
-        IIterator_HSTRING_get_HasCurrent( hstringIterator, &strExists );
-        while ( strExists )
-        {
-            vectorSize++;
-            IIterator_HSTRING_MoveNext( hstringIterator, &strExists );
-        }
-
-        strings = (HSTRING *)malloc( vectorSize * sizeof( HSTRING ) );
-        IIterable_HSTRING_First( lines, &hstringIterator );
-        
-        for ( i = 0; i < vectorSize; i++ )
-        {
-            IIterator_HSTRING_get_Current( hstringIterator, &strings[i] );
-            IIterator_HSTRING_MoveNext( hstringIterator, &strExists );
-        }
-
-        for ( i = 0; i < vectorSize; i++ ) 
-        {
-            totalSize += WindowsGetStringLen( strings[i] ) + 1; 
-        }
-
-        combinedString = (LPWSTR)malloc( ( totalSize + 1 ) * sizeof( WCHAR ) );
-        combinedString[0] = L'\0';
-
-        for ( i = 0; i < vectorSize; i++ )
-        {
-            tmpStr = (LPWSTR)malloc( ( WindowsGetStringLen( strings[i] ) + 1 ) * sizeof( WCHAR ) );
-            wcscpy( tmpStr, WindowsGetStringRawBuffer( strings[i], NULL ) );
-            wcscat( tmpStr, L"\n" );
-            wcscat( combinedString, tmpStr );
-        }
-    }
-
-    //Remove trailing nextspace
-    combinedString[ wcslen(combinedString) - 1 ] = L'\0'; 
-
-    write_text_options->encoding = encoding;
-    write_text_options->file = file;
-    if ( combinedString )
-        WindowsCreateString( combinedString, wcslen( combinedString ), &write_text_options->contents );
-
-    hr = async_action_create( (IUnknown *)iface, (IUnknown *)write_text_options, file_io_statics_AppendText, operation );
-    return S_OK;
+    return file_io_statics_CreateWriteLinesAction( iface, file, lines, encoding, TRUE, operation );
 }
 
 static HRESULT WINAPI file_io_statics_ReadBufferAsync( IFileIOStatics *iface, IStorageFile* file, IAsyncOperation_IBuffer **operation )
@@ -21,127 +21,168 @@
 
 #include "FileIOInternal.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 _ENABLE_DEBUGGING_
 
-HRESULT WINAPI file_io_statics_ReadText( IUnknown *invoker, IUnknown *param, PROPVARIANT *result )
+HRESULT WINAPI file_io_text_reader_Open( IStorageFile *file, UnicodeEncoding encoding, struct file_io_text_reader *reader )
 {
     IStorageItem *item = NULL;
     HRESULT status = S_OK;
     HSTRING filePath;
-    HANDLE fileHandle;
-    LPCSTR fileBufferChar;
-    LPWSTR fileBufferWChar;
-    LPWSTR outputBuffer;
-    DWORD fileSize;
-    DWORD bytesRead;
-    ULONG i;
-    BOOL readResult;
-
-    struct file_io_read_text_options *read_text_options = (struct file_io_read_text_options *)param;
-
-    //Parameters    
-    UnicodeEncoding unicodeEncoding = read_text_options->encoding;
-    IStorageFile_QueryInterface( read_text_options->file, &IID_IStorageItem, (void **)&item );
-    IStorageItem_get_Path( item, &filePath );
-
-    TRACE( "iface %p, value %p\n", invoker, result );
+    LARGE_INTEGER fileSize;
 
-    fileHandle = CreateFileW( WindowsGetStringRawBuffer( filePath, NULL ), GENERIC_READ, 0 , NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+    memset( reader, 0, sizeof(*reader) );
+    reader->encoding = encoding;
 
-    fileSize = GetFileSize( fileHandle, NULL );
-
-    if ( fileSize == INVALID_FILE_SIZE )
-    {
-        CloseHandle( fileHandle );
-        status = E_INVALIDARG;
-    }
+    if ( encoding != UnicodeEncoding_Utf8 && encoding != UnicodeEncoding_Utf16LE && encoding != UnicodeEncoding_Utf16BE )
+        return E_INVALIDARG;
 
-    if ( FAILED( status ) )
-        return status;
+    IStorageFile_QueryInterface( file, &IID_IStorageItem, (void **)&item );
+    IStorageItem_get_Path( item, &filePath );
+    IStorageItem_Release( item );
 
-    outputBuffer = (LPWSTR)malloc( fileSize );
+    reader->file = CreateFileW( WindowsGetStringRawBuffer( filePath, NULL ), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+    WindowsDeleteString( filePath );
+    if ( reader->file == INVALID_HANDLE_VALUE ) return HRESULT_FROM_WIN32( GetLastError() );
 
-    if ( !outputBuffer )
-    {
-        CloseHandle( fileHandle );
-        status = E_OUTOFMEMORY;
-    }
+    if ( !GetFileSizeEx( reader->file, &fileSize ) ) status = HRESULT_FROM_WIN32( GetLastError() );
+    else if ( fileSize.QuadPart > 0x7fffffff ) status = E_INVALIDARG;
+    else if ( encoding != UnicodeEncoding_Utf8 && fileSize.QuadPart % sizeof(WCHAR) ) status = E_INVALIDARG;
 
-    if ( FAILED( status ) )
-        return status;
-
-    if ( unicodeEncoding == UnicodeEncoding_Utf8 )
+    if ( SUCCEEDED( status ) && (reader->size = fileSize.QuadPart) )
     {
-        fileBufferChar = (LPCSTR)malloc( fileSize );
-        if ( !fileBufferChar )
-        {
-            CloseHandle( fileHandle );
-            status = E_OUTOFMEMORY;
-        }
-        readResult = ReadFile( fileHandle, (LPVOID)fileBufferChar, fileSize, &bytesRead, NULL );
-    } else
-    {
-        fileBufferWChar = (LPWSTR)malloc( fileSize );
-        if ( !fileBufferWChar )
-        {
-            CloseHandle( fileHandle );
-            status = E_OUTOFMEMORY;
-        }
-        readResult = ReadFile( fileHandle, (LPVOID)fileBufferWChar, fileSize, &bytesRead, NULL );
+        if (!(reader->mapping = CreateFileMappingW( reader->file, NULL, PAGE_READONLY, 0, 0, NULL )))
+            status = HRESULT_FROM_WIN32( GetLastError() );
+        else if (!(reader->view = MapViewOfFile( reader->mapping, FILE_MAP_READ, 0, 0, 0 )))
+            status = HRESULT_FROM_WIN32( GetLastError() );
     }
 
-    if ( !readResult || bytesRead != fileSize )
-    {
-        CloseHandle( fileHandle );
-        status = E_UNEXPECTED;
-    }
+    //UTF-16LE is handed out straight from the view, the others need somewhere to decode to.
+    if ( SUCCEEDED( status ) && reader->size && encoding != UnicodeEncoding_Utf16LE )
+        if (!(reader->chunk = malloc( FILE_IO_CHUNK_SIZE * sizeof(WCHAR) ))) status = E_OUTOFMEMORY;
 
-    if ( unicodeEncoding != UnicodeEncoding_Utf8 )
-    {
-        if ( fileSize % 2 != 0 )
-        {
-            CloseHandle( fileHandle );
-            status = E_INVALIDARG;
-        }
-    }
+    if ( FAILED( status ) ) file_io_text_reader_Close( reader );
+    return status;
+}
 
-    if ( FAILED( status ) )
-        return status;
+/**
+ * Returns the next run of decoded text, S_FALSE once the whole file has been returned.
+ * The text stays valid until the next call.
+ */
+HRESULT WINAPI file_io_text_reader_Next( struct file_io_text_reader *reader, LPCWSTR *text, UINT32 *length )
+{
+    const BYTE *source = reader->view + reader->offset;
+    UINT32 remaining = reader->size - reader->offset;
+    UINT32 count = min( remaining, FILE_IO_CHUNK_SIZE );
+    UINT32 trail = 0;
+    UINT32 needed;
+    UINT32 i;
+    BYTE lead;
 
-    CloseHandle( fileHandle );
+    if ( !remaining ) return S_FALSE;
 
-    switch ( unicodeEncoding )
+    switch ( reader->encoding )
     {
         case UnicodeEncoding_Utf8:
-            MultiByteToWideChar( CP_UTF8, 0, fileBufferChar, -1, outputBuffer, fileSize );
-            if ( !outputBuffer )
-                status = E_OUTOFMEMORY;
+            //Never split a sequence between two chunks, leave the partial one for the next call.
+            if ( count < remaining )
+            {
+                while ( trail < 3 && trail + 1 < count && (source[count - 1 - trail] & 0xc0) == 0x80 ) trail++;
+                lead = source[count - 1 - trail];
+                needed = lead >= 0xf0 ? 4 : lead >= 0xe0 ? 3 : lead >= 0xc0 ? 2 : 1;
+                if ( trail + 1 < needed ) count -= trail + 1;
+            }
+
+            *length = MultiByteToWideChar( CP_UTF8, 0, (LPCSTR)source, count, reader->chunk, FILE_IO_CHUNK_SIZE );
+            if ( !*length ) return HRESULT_FROM_WIN32( GetLastError() );
+            *text = reader->chunk;
             break;
 
         case UnicodeEncoding_Utf16LE:
-            wcscpy( outputBuffer, fileBufferWChar );
+            *text = (LPCWSTR)source;
+            *length = count / sizeof(WCHAR);
             break;
 
         case UnicodeEncoding_Utf16BE:
-            for ( i = 0; i < fileSize / sizeof( WCHAR ); i++ )
-                fileBufferWChar[i] = ( fileBufferWChar[i] >> 8 ) | ( fileBufferWChar[i] << 8 );
-
-            wcscpy( outputBuffer, fileBufferWChar );
+            *length = count / sizeof(WCHAR);
+            for ( i = 0; i < *length; i++ )
+                reader->chunk[i] = (source[i * 2] << 8) | source[i * 2 + 1];
+            *text = reader->chunk;
             break;
 
         default:
-            status = E_INVALIDARG;
+            return E_INVALIDARG;
     }
 
-    outputBuffer[ fileSize ] = '\0';
+    reader->offset += count;
+    return S_OK;
+}
 
-    if ( SUCCEEDED ( status ) )
+/**
+ * Upper bound of the decoded length, every byte yields at most one UTF-16 unit.
+ */
+UINT32 WINAPI file_io_text_reader_GetMaxLength( struct file_io_text_reader *reader )
+{
+    return reader->encoding == UnicodeEncoding_Utf8 ? reader->size : reader->size / sizeof(WCHAR);
+}
+
+VOID WINAPI file_io_text_reader_Close( struct file_io_text_reader *reader )
+{
+    if ( reader->view ) UnmapViewOfFile( reader->view );
+    if ( reader->mapping ) CloseHandle( reader->mapping );
+    if ( reader->file && reader->file != INVALID_HANDLE_VALUE ) CloseHandle( reader->file );
+    free( reader->chunk );
+    memset( reader, 0, sizeof(*reader) );
+}
+
+HRESULT WINAPI file_io_statics_ReadText( IUnknown *invoker, IUnknown *param, PROPVARIANT *result )
+{
+    struct file_io_text_reader reader;
+    HRESULT status = S_OK;
+    LPWSTR outputBuffer;
+    LPWSTR shrunk;
+    LPCWSTR text;
+    UINT32 outputLength = 0;
+    UINT32 length;
+
+    struct file_io_read_text_options *read_text_options = (struct file_io_read_text_options *)param;
+
+    TRACE( "iface %p, value %p\n", invoker, result );
+
+    status = file_io_text_reader_Open( read_text_options->file, read_text_options->encoding, &reader );
+    if ( FAILED( status ) ) return status;
+
+    //Decoded straight into the result, the file content itself is never copied to the heap.
+    if (!(outputBuffer = malloc( (file_io_text_reader_GetMaxLength( &reader ) + 1) * sizeof(WCHAR) )))
     {
-        result->vt = VT_LPWSTR;
-        result->pwszVal = outputBuffer;
+        file_io_text_reader_Close( &reader );
+        return E_OUTOFMEMORY;
     }
 
-    return status;
+    while ( (status = file_io_text_reader_Next( &reader, &text, &length )) == S_OK )
+    {
+        memcpy( outputBuffer + outputLength, text, length * sizeof(WCHAR) );
+        outputLength += length;
+    }
+
+    file_io_text_reader_Close( &reader );
+
+    if ( FAILED( status ) )
+    {
+        free( outputBuffer );
+        return status;
+    }
+
+    outputBuffer[ outputLength ] = '\0';
+    if ( (shrunk = realloc( outputBuffer, (outputLength + 1) * sizeof(WCHAR) )) ) outputBuffer = shrunk;
+
+    result->vt = VT_LPWSTR;
+    result->pwszVal = outputBuffer;
+
+    return S_OK;
 }
 
 HRESULT WINAPI file_io_statics_WriteText( IUnknown *invoker, IUnknown *param, PROPVARIANT *result )
@@ -357,169 +398,347 @@ HRESULT WINAPI file_io_statics_AppendText( IUnknown *invoker, IUnknown *param, P
 
 //I only managed to hit my head against the wall twice while writing this function
 
-HRESULT WINAPI file_io_statics_ReadLines( IUnknown *invoker, IUnknown *param, PROPVARIANT *result )
+/**
+ * Encoding kernels, they assume the output has room for the worst case expansion.
+ */
+static UINT32 file_io_EncodeUtf8( LPCWSTR source, UINT32 length, BYTE *output )
 {
-    IVector_HSTRING *vector = NULL;
-    IStorageItem *item = NULL;
-    HRESULT status = S_OK;
-    HSTRING filePath;
-    HSTRING vectorElement;
-    HANDLE fileHandle;
-    LPCSTR fileBufferChar;
-    LPWSTR fileBufferWChar;
-    LPWSTR outputBuffer;
-    LPWSTR tmpBuffer;
-    DWORD fileSize;
-    DWORD bytesRead;
-    ULONG i;
-    ULONG currChar;
-    BOOL readResult;
-    size_t INITIAL_BUFFER_SIZE = 100;
-
-    struct file_io_read_text_options *read_text_options = (struct file_io_read_text_options *)param;
+    BYTE *cursor = output;
+    UINT32 i = 0;
+    UINT32 codePoint;
+    WCHAR unit;
 
-    //Parameters    
-    UnicodeEncoding unicodeEncoding = read_text_options->encoding;
-    IStorageFile_QueryInterface( read_text_options->file, &IID_IStorageItem, (void **)&item );
-    IStorageItem_get_Path( item, &filePath );
+    while ( i < length )
+    {
+#ifdef __SSE2__
+        //Plain ASCII runs are narrowed eight units at a time.
+        while ( i + 8 <= length )
+        {
+            __m128i units = _mm_loadu_si128( (const __m128i *)(source + i) );
+            if ( _mm_movemask_epi8( _mm_cmpeq_epi16( _mm_and_si128( units, _mm_set1_epi16( (short)0xff80 ) ), _mm_setzero_si128() ) ) != 0xffff ) break;
+            _mm_storel_epi64( (__m128i *)cursor, _mm_packus_epi16( units, units ) );
+            cursor += 8;
+            i += 8;
+        }
+        if ( i == length ) break;
+#endif
 
-    TRACE( "iface %p, value %p\n", invoker, result );
+        unit = source[i++];
+        if ( unit < 0x80 )
+        {
+            *cursor++ = unit;
+        }
+        else if ( unit < 0x800 )
+        {
+            *cursor++ = 0xc0 | (unit >> 6);
+            *cursor++ = 0x80 | (unit & 0x3f);
+        }
+        else if ( IS_HIGH_SURROGATE( unit ) && i < length && IS_LOW_SURROGATE( source[i] ) )
+        {
+            codePoint = 0x10000 + (((unit & 0x3ff) << 10) | (source[i++] & 0x3ff));
+            *cursor++ = 0xf0 | (codePoint >> 18);
+            *cursor++ = 0x80 | ((codePoint >> 12) & 0x3f);
+            *cursor++ = 0x80 | ((codePoint >> 6) & 0x3f);
+            *cursor++ = 0x80 | (codePoint & 0x3f);
+        }
+        else
+        {
+            //Unpaired surrogates become U+FFFD, like WideCharToMultiByte does.
+            if ( IS_SURROGATE( unit ) ) unit = 0xfffd;
+            *cursor++ = 0xe0 | (unit >> 12);
+            *cursor++ = 0x80 | ((unit >> 6) & 0x3f);
+            *cursor++ = 0x80 | (unit & 0x3f);
+        }
+    }
 
-    status = hstring_vector_create( &vector );
-    if ( FAILED( status ) ) return status;
+    return cursor - output;
+}
 
-    fileHandle = CreateFileW( WindowsGetStringRawBuffer( filePath, NULL ), GENERIC_READ, 0 , NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+static UINT32 file_io_EncodeUtf16BE( LPCWSTR source, UINT32 length, BYTE *output )
+{
+    UINT32 i = 0;
 
-    fileSize = GetFileSize( fileHandle, NULL );
+#ifdef __SSE2__
+    for ( ; i + 8 <= length; i += 8 )
+    {
+        __m128i units = _mm_loadu_si128( (const __m128i *)(source + i) );
+        _mm_storeu_si128( (__m128i *)(output + i * 2), _mm_or_si128( _mm_slli_epi16( units, 8 ), _mm_srli_epi16( units, 8 ) ) );
+    }
+#endif
 
-    if ( fileSize == INVALID_FILE_SIZE )
+    for ( ; i < length; i++ )
     {
-        CloseHandle( fileHandle );
-        status = E_INVALIDARG;
+        output[i * 2] = source[i] >> 8;
+        output[i * 2 + 1] = source[i] & 0xff;
     }
 
-    if ( FAILED( status ) )
-        return status;
+    return length * sizeof(WCHAR);
+}
 
-    outputBuffer = (LPWSTR)malloc( fileSize );
+static HRESULT file_io_text_writer_Flush( struct file_io_text_writer *writer )
+{
+    DWORD bytesWritten;
+
+    if ( !writer->used ) return S_OK;
+    if ( !WriteFile( writer->file, writer->buffer, writer->used, &bytesWritten, NULL ) || bytesWritten != writer->used )
+        return E_UNEXPECTED;
+
+    writer->used = 0;
+    return S_OK;
+}
+
+HRESULT WINAPI file_io_text_writer_Open( IStorageFile *file, UnicodeEncoding encoding, BOOL append, struct file_io_text_writer *writer )
+{
+    static const BYTE UTF16LEBOM[] = { 0xFF, 0xFE };
+    static const BYTE UTF16BEBOM[] = { 0xFE, 0xFF };
+
+    IStorageItem *item = NULL;
+    HSTRING filePath;
+
+    memset( writer, 0, sizeof(*writer) );
+    writer->encoding = encoding;
+
+    if ( encoding != UnicodeEncoding_Utf8 && encoding != UnicodeEncoding_Utf16LE && encoding != UnicodeEncoding_Utf16BE )
+        return E_INVALIDARG;
+
+    IStorageFile_QueryInterface( file, &IID_IStorageItem, (void **)&item );
+    IStorageItem_get_Path( item, &filePath );
+    IStorageItem_Release( item );
+
+    writer->file = CreateFileW( WindowsGetStringRawBuffer( filePath, NULL ), append ? FILE_APPEND_DATA : GENERIC_WRITE, 0, NULL,
+                                append ? OPEN_EXISTING : CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+    WindowsDeleteString( filePath );
+    if ( writer->file == INVALID_HANDLE_VALUE ) return HRESULT_FROM_WIN32( GetLastError() );
 
-    if ( !outputBuffer )
+    if (!(writer->buffer = malloc( FILE_IO_WRITE_BUFFER_SIZE )))
     {
-        CloseHandle( fileHandle );
-        status = E_OUTOFMEMORY;
+        CloseHandle( writer->file );
+        return E_OUTOFMEMORY;
     }
 
-    tmpBuffer = (LPWSTR)malloc( sizeof(wchar_t) * INITIAL_BUFFER_SIZE );
-
-    if ( !tmpBuffer )
+    //Appended text continues the existing file, it does not get another byte order mark.
+    if ( !append && encoding == UnicodeEncoding_Utf16LE )
     {
-        CloseHandle( fileHandle );
-        status = E_OUTOFMEMORY;
+        memcpy( writer->buffer, UTF16LEBOM, sizeof(UTF16LEBOM) );
+        writer->used = sizeof(UTF16LEBOM);
+    }
+    else if ( !append && encoding == UnicodeEncoding_Utf16BE )
+    {
+        memcpy( writer->buffer, UTF16BEBOM, sizeof(UTF16BEBOM) );
+        writer->used = sizeof(UTF16BEBOM);
     }
 
-    if ( FAILED( status ) )
-        return status;
+    return S_OK;
+}
 
-    if ( unicodeEncoding == UnicodeEncoding_Utf8 )
+HRESULT WINAPI file_io_text_writer_Write( struct file_io_text_writer *writer, LPCWSTR text, UINT32 length )
+{
+    //Worst case output size of a single UTF-16 unit.
+    UINT32 unitSize = writer->encoding == UnicodeEncoding_Utf8 ? 3 : sizeof(WCHAR);
+    HRESULT status;
+    UINT32 count;
+
+    while ( length )
     {
-        fileBufferChar = (LPCSTR)malloc( fileSize );
-        if ( !fileBufferChar )
+        count = min( length, (FILE_IO_WRITE_BUFFER_SIZE - writer->used) / unitSize );
+
+        //Keep surrogate pairs within one slice.
+        if ( count && count < length && IS_HIGH_SURROGATE( text[count - 1] ) ) count--;
+
+        if ( !count )
         {
-            CloseHandle( fileHandle );
-            status = E_OUTOFMEMORY;
+            status = file_io_text_writer_Flush( writer );
+            if ( FAILED( status ) ) return status;
+            continue;
         }
-        readResult = ReadFile( fileHandle, (LPVOID)fileBufferChar, fileSize, &bytesRead, NULL );
-    } else
-    {
-        fileBufferWChar = (LPWSTR)malloc( fileSize );
-        if ( !fileBufferWChar )
+
+        switch ( writer->encoding )
         {
-            CloseHandle( fileHandle );
-            status = E_OUTOFMEMORY;
+            case UnicodeEncoding_Utf8:
+                writer->used += file_io_EncodeUtf8( text, count, writer->buffer + writer->used );
+                break;
+            case UnicodeEncoding_Utf16LE:
+                memcpy( writer->buffer + writer->used, text, count * sizeof(WCHAR) );
+                writer->used += count * sizeof(WCHAR);
+                break;
+            default:
+                writer->used += file_io_EncodeUtf16BE( text, count, writer->buffer + writer->used );
+                break;
         }
-        readResult = ReadFile( fileHandle, (LPVOID)fileBufferWChar, fileSize, &bytesRead, NULL );
-    }
 
-    if ( !readResult || bytesRead != fileSize )
-    {
-        CloseHandle( fileHandle );
-        status = E_UNEXPECTED;
+        text += count;
+        length -= count;
     }
 
-    if ( unicodeEncoding != UnicodeEncoding_Utf8 )
+    return S_OK;
+}
+
+HRESULT WINAPI file_io_text_writer_Close( struct file_io_text_writer *writer )
+{
+    HRESULT status = S_OK;
+
+    if ( writer->buffer ) status = file_io_text_writer_Flush( writer );
+    if ( writer->file && writer->file != INVALID_HANDLE_VALUE ) CloseHandle( writer->file );
+    free( writer->buffer );
+    memset( writer, 0, sizeof(*writer) );
+
+    return status;
+}
+
+HRESULT WINAPI file_io_statics_WriteLines( IUnknown *invoker, IUnknown *param, PROPVARIANT *result )
+{
+    struct file_io_text_writer writer;
+    IIterator_HSTRING *iterator = NULL;
+    HRESULT status;
+    HRESULT closeStatus;
+    HSTRING line;
+    LPCWSTR text;
+    UINT32 length;
+    boolean hasCurrent = FALSE;
+    BOOL first = TRUE;
+
+    struct file_io_write_lines_options *write_lines_options = (struct file_io_write_lines_options *)param;
+
+    TRACE( "iface %p, value %p\n", invoker, result );
+
+    status = file_io_text_writer_Open( write_lines_options->file, write_lines_options->encoding, write_lines_options->append, &writer );
+    if ( SUCCEEDED( status ) ) status = IIterable_HSTRING_First( write_lines_options->lines, &iterator );
+    if ( SUCCEEDED( status ) ) status = IIterator_HSTRING_get_HasCurrent( iterator, &hasCurrent );
+
+    //Lines are separated, not terminated, by a line feed.
+    while ( SUCCEEDED( status ) && hasCurrent )
     {
-        if ( fileSize % 2 != 0 )
-        {
-            CloseHandle( fileHandle );
-            status = E_INVALIDARG;
-        }
+        status = IIterator_HSTRING_get_Current( iterator, &line );
+        if ( FAILED( status ) ) break;
+
+        text = WindowsGetStringRawBuffer( line, &length );
+        if ( !first ) status = file_io_text_writer_Write( &writer, L"\n", 1 );
+        if ( SUCCEEDED( status ) ) status = file_io_text_writer_Write( &writer, text, length );
+        WindowsDeleteString( line );
+        first = FALSE;
+
+        if ( SUCCEEDED( status ) ) status = IIterator_HSTRING_MoveNext( iterator, &hasCurrent );
     }
 
-    if ( FAILED( status ) )
-        return status;
+    if ( iterator ) IIterator_HSTRING_Release( iterator );
+    closeStatus = file_io_text_writer_Close( &writer );
+    if ( SUCCEEDED( status ) ) status = closeStatus;
 
-    CloseHandle( fileHandle );
+    IIterable_HSTRING_Release( write_lines_options->lines );
+    write_lines_options->lines = NULL;
 
-    switch ( unicodeEncoding )
-    {
-        case UnicodeEncoding_Utf8:
-            MultiByteToWideChar( CP_UTF8, 0, fileBufferChar, -1, outputBuffer, fileSize );
-            if ( !outputBuffer )
-                status = E_OUTOFMEMORY;
-            break;
+    return status;
+}
 
-        case UnicodeEncoding_Utf16LE:
-            wcscpy( outputBuffer, fileBufferWChar );
-            break;
+static HRESULT file_io_AppendLine( IVector_HSTRING *vector, LPCWSTR line, UINT32 length )
+{
+    HSTRING vectorElement;
+    HRESULT status;
 
-        case UnicodeEncoding_Utf16BE:
-            for ( i = 0; i < fileSize / sizeof( WCHAR ); i++ )
-                fileBufferWChar[i] = ( fileBufferWChar[i] >> 8 ) | ( fileBufferWChar[i] << 8 );
+    if ( length && line[length - 1] == '\r' ) length--;
 
-            wcscpy( outputBuffer, fileBufferWChar );
-            break;
+    status = WindowsCreateString( line, length, &vectorElement );
+    if ( FAILED( status ) ) return status;
 
-        default:
-            status = E_INVALIDARG;
-    }
+    status = IVector_HSTRING_Append( vector, vectorElement );
+    WindowsDeleteString( vectorElement );
+    return status;
+}
 
-    outputBuffer[ fileSize ] = L'\0';
-    tmpBuffer[0] = L'\0';
+HRESULT WINAPI file_io_statics_ReadLines( IUnknown *invoker, IUnknown *param, PROPVARIANT *result )
+{
+    struct file_io_text_reader reader;
+    IVector_HSTRING *vector = NULL;
+    HRESULT status = S_OK;
+    LPWSTR carry = NULL;
+    LPWSTR tmp;
+    LPCWSTR text;
+    LPCWSTR end;
+    LPCWSTR lineStart;
+    LPCWSTR lineEnd;
+    UINT32 carryLength = 0;
+    UINT32 carryCapacity = 0;
+    UINT32 length;
+
+    struct file_io_read_text_options *read_text_options = (struct file_io_read_text_options *)param;
+
+    TRACE( "iface %p, value %p\n", invoker, result );
+
+    status = hstring_vector_create( &vector );
+    if ( FAILED( status ) ) return status;
 
-    for ( currChar = 0; currChar < wcslen( outputBuffer ); currChar++ )
+    status = file_io_text_reader_Open( read_text_options->file, read_text_options->encoding, &reader );
+    if ( FAILED( status ) )
     {
-        if ( outputBuffer[ currChar ] == L'\n' )
-        {
-            WindowsCreateString( tmpBuffer, wcslen( tmpBuffer ), &vectorElement );
-            IVector_HSTRING_Append( vector, vectorElement );
-            tmpBuffer = (LPWSTR)malloc(sizeof(wchar_t) * INITIAL_BUFFER_SIZE);
-        } else
+        IVector_HSTRING_Release( vector );
+        return status;
+    }
+
+    while ( (status = file_io_text_reader_Next( &reader, &text, &length )) == S_OK )
+    {
+        end = text + length;
+
+        for ( lineStart = text; lineStart < end && SUCCEEDED( status ); lineStart = lineEnd + 1 )
         {
-            //Append the current character to tmpBuffer. We'll use tmpBuffer once control reaches line break.
-            size_t tmpBufferLen = wcslen(tmpBuffer);
-            if (tmpBufferLen + 1 >= INITIAL_BUFFER_SIZE) {
-                // Grow the buffer if necessary.
-                INITIAL_BUFFER_SIZE *= 2;
-                tmpBuffer = (LPWSTR)realloc(tmpBuffer, sizeof(wchar_t) * INITIAL_BUFFER_SIZE);
+            if (!(lineEnd = wmemchr( lineStart, '\n', end - lineStart )))
+            {
+                //The line continues in the next chunk, only this tail is ever copied.
+                if ( carryLength + (end - lineStart) > carryCapacity )
+                {
+                    carryCapacity = max( carryCapacity * 2, carryLength + (end - lineStart) );
+                    if (!(tmp = realloc( carry, carryCapacity * sizeof(WCHAR) )))
+                    {
+                        status = E_OUTOFMEMORY;
+                        break;
+                    }
+                    carry = tmp;
+                }
+                memcpy( carry + carryLength, lineStart, (end - lineStart) * sizeof(WCHAR) );
+                carryLength += end - lineStart;
+                break;
+            }
+
+            if ( carryLength )
+            {
+                if ( carryLength + (lineEnd - lineStart) > carryCapacity )
+                {
+                    carryCapacity = carryLength + (lineEnd - lineStart);
+                    if (!(tmp = realloc( carry, carryCapacity * sizeof(WCHAR) )))
+                    {
+                        status = E_OUTOFMEMORY;
+                        break;
+                    }
+                    carry = tmp;
+                }
+                memcpy( carry + carryLength, lineStart, (lineEnd - lineStart) * sizeof(WCHAR) );
+                status = file_io_AppendLine( vector, carry, carryLength + (lineEnd - lineStart) );
+                carryLength = 0;
+            }
+            else
+            {
+                status = file_io_AppendLine( vector, lineStart, lineEnd - lineStart );
             }
-            tmpBuffer[ tmpBufferLen ] = outputBuffer[ currChar ];
-            tmpBuffer[ tmpBufferLen + 1 ] = L'\0';
         }
-    }
 
-    if ( tmpBuffer )
-    {
-        WindowsCreateString( tmpBuffer, wcslen( tmpBuffer ), &vectorElement );
-        IVector_HSTRING_Append( vector, vectorElement );
+        if ( FAILED( status ) ) break;
     }
 
-    if ( SUCCEEDED ( status ) )
+    //The last line has no line break.
+    if ( SUCCEEDED( status ) && carryLength ) status = file_io_AppendLine( vector, carry, carryLength );
+
+    free( carry );
+    file_io_text_reader_Close( &reader );
+
+    if ( FAILED( status ) )
     {
-        result->vt = VT_UNKNOWN;
-        result->punkVal = (IUnknown *)vector;
+        IVector_HSTRING_Release( vector );
+        return status;
     }
 
-    return status;
+    result->vt = VT_UNKNOWN;
+    result->punkVal = (IUnknown *)vector;
+
+    return S_OK;
 }
 
 HRESULT WINAPI file_io_statics_ReadBuffer( IUnknown *invoker, IUnknown *param, PROPVARIANT *result )
@@ -529,41 +748,28 @@ HRESULT WINAPI file_io_statics_ReadBuffer( IUnknown *invoker, IUnknown *param, P
     HRESULT status = S_OK;
     HSTRING filePath;
     HANDLE fileHandle;
-    BYTE *outputBuffer;
-    DWORD fileSize;
-    DWORD bytesRead;
-    BOOL readResult;
+    LARGE_INTEGER fileSize;
 
     //Parameters
     IStorageFile_QueryInterface( (IStorageFile *)param, &IID_IStorageItem, (void **)&item );
     IStorageItem_get_Path( item, &filePath );
+    IStorageItem_Release( item );
 
     TRACE( "iface %p, value %p\n", invoker, result );
 
-    fileHandle = CreateFileW( WindowsGetStringRawBuffer( filePath, NULL ), GENERIC_READ, 0 , NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
-
-    fileSize = GetFileSize( fileHandle, NULL );
+    fileHandle = CreateFileW( WindowsGetStringRawBuffer( filePath, NULL ), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+    WindowsDeleteString( filePath );
+    if ( fileHandle == INVALID_HANDLE_VALUE ) return HRESULT_FROM_WIN32( GetLastError() );
 
-    if ( fileSize == INVALID_FILE_SIZE )
+    if ( !GetFileSizeEx( fileHandle, &fileSize ) || fileSize.QuadPart > 0x7fffffff )
     {
         CloseHandle( fileHandle );
         return E_INVALIDARG;
     }
 
-    status = buffer_Create( fileSize, &buffer );
-
-    if ( FAILED( status ) )
-        return status;
-    
-    outputBuffer = impl_from_IBuffer( buffer )->Buffer;
-    
-    readResult = ReadFile( fileHandle, (LPVOID)outputBuffer, fileSize, &bytesRead, NULL );
-
-    if ( !readResult || bytesRead != fileSize )
-    {
-        CloseHandle( fileHandle );
-        status = E_UNEXPECTED;
-    }
+    //The buffer holds a copy of the contents, the file is not kept open.
+    status = buffer_CreateFromFile( fileHandle, fileSize.QuadPart, &buffer );
+    CloseHandle( fileHandle );
 
     if ( SUCCEEDED ( status ) )
     {
@@ -571,8 +777,6 @@ HRESULT WINAPI file_io_statics_ReadBuffer( IUnknown *invoker, IUnknown *param, P
         result->punkVal = (IUnknown *)buffer;
     }
 
-    CloseHandle( fileHandle );
-
     return status;
 }
 
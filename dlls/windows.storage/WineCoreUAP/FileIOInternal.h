@@ -30,6 +30,10 @@
 #include "wine/debug.h"
 
 #define MAX_BUFFER 4096
+//Amount of text decoded at once by the text reader.
+#define FILE_IO_CHUNK_SIZE 0x100000
+//Size of the encoded output batched into a single WriteFile by the text writer.
+#define FILE_IO_WRITE_BUFFER_SIZE 0x40000
 
 struct file_io_statics
 {
@@ -54,6 +58,14 @@ struct file_io_write_text_options
     UnicodeEncoding encoding;
 };
 
+struct file_io_write_lines_options
+{
+    IStorageFile *file;
+    IIterable_HSTRING *lines;
+    UnicodeEncoding encoding;
+    BOOL append;
+};
+
 struct file_io_write_buffer_options
 {    
     IStorageFile *file;
@@ -67,10 +79,45 @@ struct file_io_write_bytes_options
     UINT32 bufferSize;
 };
 
+/**
+ * Decodes a file into UTF-16 one chunk at a time. The file is mapped rather than read,
+ * so the only heap allocation is the chunk the decoded text lands in.
+ */
+struct file_io_text_reader
+{
+    HANDLE file;
+    HANDLE mapping;
+    const BYTE *view;
+    UINT32 size;
+    UINT32 offset;
+    UnicodeEncoding encoding;
+    WCHAR *chunk;
+};
+
+HRESULT WINAPI file_io_text_reader_Open( IStorageFile *file, UnicodeEncoding encoding, struct file_io_text_reader *reader );
+HRESULT WINAPI file_io_text_reader_Next( struct file_io_text_reader *reader, LPCWSTR *text, UINT32 *length );
+UINT32 WINAPI file_io_text_reader_GetMaxLength( struct file_io_text_reader *reader );
+VOID WINAPI file_io_text_reader_Close( struct file_io_text_reader *reader );
+
+/**
+ * Encodes UTF-16 text into a fixed output buffer that is flushed to the file as it fills up.
+ */
+struct file_io_text_writer
+{
+    HANDLE file;
+    UnicodeEncoding encoding;
+    BYTE *buffer;
+    UINT32 used;
+};
+
+HRESULT WINAPI file_io_text_writer_Open( IStorageFile *file, UnicodeEncoding encoding, BOOL append, struct file_io_text_writer *writer );
+HRESULT WINAPI file_io_text_writer_Write( struct file_io_text_writer *writer, LPCWSTR text, UINT32 length );
+HRESULT WINAPI file_io_text_writer_Close( struct file_io_text_writer *writer );
 
 HRESULT WINAPI file_io_statics_ReadText( IUnknown *invoker, IUnknown *param, PROPVARIANT *result );
 HRESULT WINAPI file_io_statics_WriteText( IUnknown *invoker, IUnknown *param, PROPVARIANT *result );
 HRESULT WINAPI file_io_statics_AppendText( IUnknown *invoker, IUnknown *param, PROPVARIANT *result );
+HRESULT WINAPI file_io_statics_WriteLines( IUnknown *invoker, IUnknown *param, PROPVARIANT *result );
 HRESULT WINAPI file_io_statics_ReadLines( IUnknown *invoker, IUnknown *param, PROPVARIANT *result );
 HRESULT WINAPI file_io_statics_ReadBuffer( IUnknown *invoker, IUnknown *param, PROPVARIANT *result );
 HRESULT WINAPI file_io_statics_WriteBuffer( IUnknown *invoker, IUnknown *param, PROPVARIANT *result );
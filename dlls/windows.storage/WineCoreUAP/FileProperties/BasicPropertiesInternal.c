@@ -0,0 +1,356 @@
+/* WinRT Windows.Storage.FileProperties.BasicProperties Implementation
+ *
+ * Written by Weather
+ *
+ * This is a reverse engineered implementation of Microsoft's OneCoreUAP binaries.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "BasicPropertiesInternal.h"
+
+_ENABLE_DEBUGGING_
+
+static struct basic_properties_cache_shard cacheShards[BASIC_PROPERTIES_CACHE_SHARDS];
+static INIT_ONCE cacheShardsOnce = INIT_ONCE_STATIC_INIT;
+
+struct basic_properties_cache_key
+{
+    LPCWSTR Path;
+    UINT32 pathLength;
+};
+
+static int basic_properties_cache_CompareRecords( const void *key, const struct rb_entry *entry )
+{
+    return wcsicmp( key, RB_ENTRY_VALUE( entry, struct basic_properties_cache_record, entry )->Name );
+}
+
+static int basic_properties_cache_CompareFolders( const void *key, const struct rb_entry *entry )
+{
+    const struct basic_properties_cache_folder *folder = RB_ENTRY_VALUE( entry, struct basic_properties_cache_folder, entry );
+    const struct basic_properties_cache_key *folderKey = key;
+
+    return CompareStringOrdinal( folderKey->Path, folderKey->pathLength, folder->Path, folder->pathLength, TRUE ) - CSTR_EQUAL;
+}
+
+static BOOL CALLBACK basic_properties_cache_InitShards( INIT_ONCE *once, void *param, void **context )
+{
+    UINT32 iterator;
+
+    for ( iterator = 0; iterator < BASIC_PROPERTIES_CACHE_SHARDS; iterator++ )
+    {
+        InitializeSRWLock( &cacheShards[iterator].lock );
+        rb_init( &cacheShards[iterator].folders, basic_properties_cache_CompareFolders );
+        InitializeSRWLock( &cacheShards[iterator].lruLock );
+        list_init( &cacheShards[iterator].lru );
+    }
+
+    return TRUE;
+}
+
+static struct basic_properties_cache_shard *basic_properties_cache_GetShard( const struct basic_properties_cache_key *key )
+{
+    UINT32 hash = 0x811c9dc5;
+    UINT32 iterator;
+
+    InitOnceExecuteOnce( &cacheShardsOnce, basic_properties_cache_InitShards, NULL, NULL );
+
+    for ( iterator = 0; iterator < key->pathLength; iterator++ )
+    {
+        hash ^= towupper( key->Path[iterator] );
+        hash *= 0x01000193;
+    }
+
+    return &cacheShards[hash % BASIC_PROPERTIES_CACHE_SHARDS];
+}
+
+static void basic_properties_cache_FreeRecord( struct rb_entry *entry, void *context )
+{
+    free( RB_ENTRY_VALUE( entry, struct basic_properties_cache_record, entry ) );
+}
+
+/**
+ * The folder must not be reachable from a shard anymore.
+ */
+static VOID basic_properties_cache_FreeFolder( struct basic_properties_cache_folder *folder )
+{
+    if ( folder->notification != INVALID_HANDLE_VALUE ) FindCloseChangeNotification( folder->notification );
+    rb_destroy( &folder->records, basic_properties_cache_FreeRecord, NULL );
+    free( folder );
+}
+
+/**
+ * Unlinks a folder from its shard, the shard lock is held exclusively.
+ */
+static VOID basic_properties_cache_DetachFolder( struct basic_properties_cache_shard *shard, struct basic_properties_cache_folder *folder, struct list *freed )
+{
+    rb_remove( &shard->folders, &folder->entry );
+    list_remove( &folder->lruEntry );
+    shard->recordCount -= folder->recordCount;
+    shard->folderCount--;
+    list_add_tail( freed, &folder->freeEntry );
+}
+
+/**
+ * Links a folder to its shard, the shard lock is held exclusively.
+ */
+static VOID basic_properties_cache_AttachFolder( struct basic_properties_cache_shard *shard, const struct basic_properties_cache_key *key, struct basic_properties_cache_folder *folder )
+{
+    rb_put( &shard->folders, key, &folder->entry );
+    list_add_head( &shard->lru, &folder->lruEntry );
+    shard->folderCount++;
+}
+
+/**
+ * Moves a folder to the front of the LRU list, the shard lock is held in either mode.
+ */
+static VOID basic_properties_cache_TouchFolder( struct basic_properties_cache_shard *shard, struct basic_properties_cache_folder *folder )
+{
+    LONG now = GetTickCount();
+
+    //Once per tick at most, lookups in a hot folder mostly skip the LRU lock.
+    if ( ReadNoFence( &folder->lastUse ) == now ) return;
+    WriteNoFence( &folder->lastUse, now );
+
+    AcquireSRWLockExclusive( &shard->lruLock );
+    list_remove( &folder->lruEntry );
+    list_add_head( &shard->lru, &folder->lruEntry );
+    ReleaseSRWLockExclusive( &shard->lruLock );
+}
+
+static VOID basic_properties_cache_FreeFolders( struct list *freed )
+{
+    struct basic_properties_cache_folder *folder, *next;
+
+    LIST_FOR_EACH_ENTRY_SAFE( folder, next, freed, struct basic_properties_cache_folder, freeEntry )
+        basic_properties_cache_FreeFolder( folder );
+}
+
+/**
+ * Finds a folder that did not change since it was cached, the shard lock is held in either mode.
+ */
+static struct basic_properties_cache_folder *basic_properties_cache_FindFolder( struct basic_properties_cache_shard *shard, const struct basic_properties_cache_key *key, BOOL *stale )
+{
+    struct basic_properties_cache_folder *folder;
+    struct rb_entry *entry;
+
+    *stale = FALSE;
+    if (!(entry = rb_get( &shard->folders, key ))) return NULL;
+    folder = RB_ENTRY_VALUE( entry, struct basic_properties_cache_folder, entry );
+
+    if ( WaitForSingleObject( folder->notification, 0 ) == WAIT_OBJECT_0 )
+    {
+        *stale = TRUE;
+        return NULL;
+    }
+
+    basic_properties_cache_TouchFolder( shard, folder );
+    return folder;
+}
+
+/**
+ * Drops a folder that was signaled, unless somebody already replaced it.
+ */
+static VOID basic_properties_cache_DropStale( struct basic_properties_cache_shard *shard, const struct basic_properties_cache_key *key )
+{
+    struct basic_properties_cache_folder *folder;
+    struct rb_entry *entry;
+    struct list freed = LIST_INIT( freed );
+
+    AcquireSRWLockExclusive( &shard->lock );
+    if ( (entry = rb_get( &shard->folders, key )) )
+    {
+        folder = RB_ENTRY_VALUE( entry, struct basic_properties_cache_folder, entry );
+        if ( WaitForSingleObject( folder->notification, 0 ) == WAIT_OBJECT_0 )
+        {
+            TRACE( "folder %s changed, dropping its records\n", debugstr_wn( key->Path, key->pathLength ) );
+            basic_properties_cache_DetachFolder( shard, folder, &freed );
+        }
+    }
+    ReleaseSRWLockExclusive( &shard->lock );
+
+    basic_properties_cache_FreeFolders( &freed );
+}
+
+static BOOL basic_properties_cache_IsOverBudget( struct basic_properties_cache_shard *shard )
+{
+    return ReadNoFence( &shard->recordCount ) > BASIC_PROPERTIES_CACHE_SHARD_RECORDS
+        || ReadNoFence( &shard->folderCount ) > BASIC_PROPERTIES_CACHE_SHARD_FOLDERS;
+}
+
+/**
+ * Drops the least recently used folders until the shard is back within its budget.
+ */
+static VOID basic_properties_cache_Trim( struct basic_properties_cache_shard *shard )
+{
+    struct list freed = LIST_INIT( freed );
+    struct list *oldest;
+
+    AcquireSRWLockExclusive( &shard->lock );
+    while ( basic_properties_cache_IsOverBudget( shard ) && (oldest = list_tail( &shard->lru )) )
+        basic_properties_cache_DetachFolder( shard, LIST_ENTRY( oldest, struct basic_properties_cache_folder, lruEntry ), &freed );
+    ReleaseSRWLockExclusive( &shard->lock );
+
+    basic_properties_cache_FreeFolders( &freed );
+}
+
+/**
+ * Creates a folder along with its change notification, without holding any lock.
+ */
+static struct basic_properties_cache_folder *basic_properties_cache_CreateFolder( const struct basic_properties_cache_key *key, LPCWSTR directory )
+{
+    struct basic_properties_cache_folder *folder;
+
+    if (!(folder = malloc( offsetof( struct basic_properties_cache_folder, Path[key->pathLength + 1] ) ))) return NULL;
+
+    //The watch only starts now, the records were read just before and are taken as current.
+    folder->notification = FindFirstChangeNotificationW( directory, FALSE, BASIC_PROPERTIES_CACHE_NOTIFY_FILTER );
+    if ( folder->notification == INVALID_HANDLE_VALUE )
+    {
+        free( folder );
+        return NULL;
+    }
+
+    InitializeSRWLock( &folder->lock );
+    rb_init( &folder->records, basic_properties_cache_CompareRecords );
+    folder->recordCount = 0;
+    folder->lastUse = GetTickCount();
+    memcpy( folder->Path, key->Path, key->pathLength * sizeof(WCHAR) );
+    folder->Path[key->pathLength] = 0;
+    folder->pathLength = key->pathLength;
+    return folder;
+}
+
+/**
+ * Puts the record in the folder, the caller holds the folder lock or the shard lock exclusively.
+ */
+static VOID basic_properties_cache_PutRecord( struct basic_properties_cache_shard *shard, struct basic_properties_cache_folder *folder,
+                                              struct basic_properties_cache_record *record )
+{
+    struct rb_entry *existing;
+
+    if ( (existing = rb_get( &folder->records, record->Name )) )
+    {
+        rb_remove( &folder->records, existing );
+        basic_properties_cache_FreeRecord( existing, NULL );
+    }
+    else
+    {
+        folder->recordCount++;
+        InterlockedIncrement( &shard->recordCount );
+    }
+    rb_put( &folder->records, record->Name, &record->entry );
+}
+
+VOID WINAPI basic_properties_cache_Add( const struct storage_enumeration_entry *entry )
+{
+    struct basic_properties_cache_folder *folder, *created;
+    struct basic_properties_cache_record *record;
+    struct basic_properties_cache_shard *shard;
+    struct basic_properties_cache_key key;
+    struct rb_entry *existing;
+    struct list freed = LIST_INIT( freed );
+    BOOL stale;
+
+    key.Path = entry->Directory;
+    key.pathLength = wcslen( entry->Directory );
+    shard = basic_properties_cache_GetShard( &key );
+
+    if (!(record = malloc( offsetof( struct basic_properties_cache_record, Name[entry->NameLength + 1] ) ))) return;
+
+    record->Attributes = entry->Attributes;
+    record->Size = entry->Size.QuadPart;
+    record->CreationTime = entry->CreationTime;
+    record->LastWriteTime = entry->LastWriteTime;
+    memcpy( record->Name, entry->Name, entry->NameLength * sizeof(WCHAR) );
+    record->Name[entry->NameLength] = '\0';
+
+    //Workers filling folders that are already cached only contend on the folder itself.
+    AcquireSRWLockShared( &shard->lock );
+    if ( (folder = basic_properties_cache_FindFolder( shard, &key, &stale )) )
+    {
+        AcquireSRWLockExclusive( &folder->lock );
+        basic_properties_cache_PutRecord( shard, folder, record );
+        ReleaseSRWLockExclusive( &folder->lock );
+    }
+    ReleaseSRWLockShared( &shard->lock );
+
+    if ( !folder )
+    {
+        if (!(created = basic_properties_cache_CreateFolder( &key, entry->Directory )))
+        {
+            free( record );
+            return;
+        }
+
+        AcquireSRWLockExclusive( &shard->lock );
+        if ( (existing = rb_get( &shard->folders, &key )) )
+        {
+            folder = RB_ENTRY_VALUE( existing, struct basic_properties_cache_folder, entry );
+            if ( WaitForSingleObject( folder->notification, 0 ) == WAIT_OBJECT_0 )
+            {
+                basic_properties_cache_DetachFolder( shard, folder, &freed );
+                folder = NULL;
+            }
+        }
+        //Another worker may have cached the folder in the meantime, keep theirs.
+        if ( folder ) list_add_tail( &freed, &created->freeEntry );
+        else basic_properties_cache_AttachFolder( shard, &key, (folder = created) );
+        basic_properties_cache_PutRecord( shard, folder, record );
+        ReleaseSRWLockExclusive( &shard->lock );
+
+        basic_properties_cache_FreeFolders( &freed );
+    }
+
+    if ( basic_properties_cache_IsOverBudget( shard ) ) basic_properties_cache_Trim( shard );
+}
+
+BOOL WINAPI basic_properties_cache_Lookup( LPCWSTR path, struct basic_properties_cache_record *record )
+{
+    struct basic_properties_cache_folder *folder;
+    struct basic_properties_cache_record *cached = NULL;
+    struct basic_properties_cache_shard *shard;
+    struct basic_properties_cache_key key;
+    struct rb_entry *entry;
+    LPCWSTR name;
+    BOOL stale;
+
+    if (!(name = wcsrchr( path, '\\' ))) return FALSE;
+
+    key.Path = path;
+    key.pathLength = name - path;
+    shard = basic_properties_cache_GetShard( &key );
+
+    AcquireSRWLockShared( &shard->lock );
+
+    if ( (folder = basic_properties_cache_FindFolder( shard, &key, &stale )) )
+    {
+        AcquireSRWLockShared( &folder->lock );
+        if ( (entry = rb_get( &folder->records, name + 1 )) )
+        {
+            cached = RB_ENTRY_VALUE( entry, struct basic_properties_cache_record, entry );
+            record->Attributes = cached->Attributes;
+            record->Size = cached->Size;
+            record->CreationTime = cached->CreationTime;
+            record->LastWriteTime = cached->LastWriteTime;
+        }
+        ReleaseSRWLockShared( &folder->lock );
+    }
+
+    ReleaseSRWLockShared( &shard->lock );
+
+    if ( stale ) basic_properties_cache_DropStale( shard, &key );
+    return cached != NULL;
+}
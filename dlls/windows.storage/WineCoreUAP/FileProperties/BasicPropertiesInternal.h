@@ -24,6 +24,19 @@
 
 #include "../../private.h"
 #include "wine/debug.h"
+#include "wine/list.h"
+#include "wine/rbtree.h"
+
+#include "../Search/StorageEnumerationInternal.h"
+
+//The cache is split by folder path, queries walking different folders rarely share a lock.
+#define BASIC_PROPERTIES_CACHE_SHARDS 16
+//Records kept per shard, the least recently used folders are dropped beyond that.
+#define BASIC_PROPERTIES_CACHE_SHARD_RECORDS 0x4000
+//Folders kept per shard, each of them holds a change notification handle.
+#define BASIC_PROPERTIES_CACHE_SHARD_FOLDERS 64
+#define BASIC_PROPERTIES_CACHE_NOTIFY_FILTER ( FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_ATTRIBUTES | \
+                                               FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_CREATION )
 
 struct basic_properties
 {
@@ -38,4 +51,57 @@ struct basic_properties
     LONG ref;
 };
 
+/**
+ * Developer notes: Queries already read the size, times and attributes of every item from
+ * the directory records, the cache keeps them per folder so that creating the items and
+ * their BasicProperties does not have to open each file again. Every cached folder holds a
+ * change notification, a folder that was signaled is dropped on its next use.
+ * The cache is bounded by records, so a deep query over many small folders stays cached as
+ * a whole instead of evicting its own first folders, and by folders, so that it does not
+ * hold an unbounded number of notifications. Either way the least recently used folders
+ * go first, along with their notification.
+ */
+struct basic_properties_cache_record
+{
+    struct rb_entry entry;
+
+    DWORD Attributes;
+    UINT64 Size;
+    LARGE_INTEGER CreationTime;
+    LARGE_INTEGER LastWriteTime;
+
+    WCHAR Name[1];
+};
+
+struct basic_properties_cache_folder
+{
+    struct rb_entry entry;
+    struct list freeEntry;
+    struct list lruEntry;
+    //Guards the records, taken under the shard lock held shared.
+    SRWLOCK lock;
+    struct rb_tree records;
+    UINT32 recordCount;
+    HANDLE notification;
+    LONG lastUse;
+
+    UINT32 pathLength;
+    WCHAR Path[1];
+};
+
+struct basic_properties_cache_shard
+{
+    //Held shared to use the folders, exclusively to add or drop one.
+    SRWLOCK lock;
+    struct rb_tree folders;
+    LONG recordCount;
+    LONG folderCount;
+    //Most recently used folder first, reordered under the shard lock held shared.
+    SRWLOCK lruLock;
+    struct list lru;
+};
+
+VOID WINAPI basic_properties_cache_Add( const struct storage_enumeration_entry *entry );
+BOOL WINAPI basic_properties_cache_Lookup( LPCWSTR path, struct basic_properties_cache_record *record );
+
 #endif
\ No newline at end of file
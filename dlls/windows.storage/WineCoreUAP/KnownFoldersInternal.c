@@ -54,37 +54,23 @@ HRESULT WINAPI known_folders_statics_GetKnownFolder( KnownFolderId folderId, HST
     PathRemoveFileSpecW(manifestPath);
     PathAppendW(manifestPath, L"AppxManifest.xml");
 
-    if ( !OK( registerAppxPackage( manifestPath, &package ) ) )
+    if ( !OK( loadAppxPackage( manifestPath, &package ) ) )
     {
+        freeAppxPackage( &package );
         status = E_UNEXPECTED;
     }
 
-    for ( xmlNode *capabilityNode = package.Package.Capabilities; capabilityNode; capabilityNode = capabilityNode->next )
+    if ( SUCCEEDED( status ) )
     {
-        if ( capabilityNode->type == XML_ELEMENT_NODE
-            && !xmlStrcmp( capabilityNode->name, (const xmlChar*)"Capability" ) )
-        {
-            if ( !xmlStrcmp( xmlGetProp( capabilityNode, (const xmlChar *)"Name" ), (const xmlChar*)"musicLibrary" ) )
-                musicLibraryAllowed = TRUE;
-            
-            if ( !xmlStrcmp( xmlGetProp( capabilityNode, (const xmlChar *)"Name" ), (const xmlChar*)"picturesLibrary" ) )
-                picturesLibraryAllowed = TRUE;
-
-            if ( !xmlStrcmp( xmlGetProp( capabilityNode, (const xmlChar *)"Name" ), (const xmlChar*)"videosLibrary" ) )
-                videosLibraryAllowed = TRUE;
-
-            if ( !xmlStrcmp( xmlGetProp( capabilityNode, (const xmlChar *)"Name" ), (const xmlChar*)"documentsLibrary" ) )
-                documentsLibraryAllowed = TRUE;
-
-            if ( !xmlStrcmp( xmlGetProp( capabilityNode, (const xmlChar *)"Name" ), (const xmlChar*)"removableStorage" ) )
-                removableDevicesAllowed = TRUE;
-
-            if ( !xmlStrcmp( xmlGetProp( capabilityNode, (const xmlChar *)"Name" ), (const xmlChar*)"internetClient" ) )
-                mediaServerAllowed = TRUE;
-        }
+        musicLibraryAllowed = appxHasCapability( &package, L"musicLibrary" );
+        picturesLibraryAllowed = appxHasCapability( &package, L"picturesLibrary" );
+        videosLibraryAllowed = appxHasCapability( &package, L"videosLibrary" );
+        documentsLibraryAllowed = appxHasCapability( &package, L"documentsLibrary" );
+        removableDevicesAllowed = appxHasCapability( &package, L"removableStorage" );
+        mediaServerAllowed = appxHasCapability( &package, L"internetClient" );
+        freeAppxPackage( &package );
     }
 
-
     if ( SUCCEEDED( status ) )
     {
         switch ( folderId )
@@ -210,7 +196,7 @@ HRESULT WINAPI known_folders_statics_RequestAccess( IUnknown *invoker, IUnknown
     PathRemoveFileSpecW(manifestPath);
     PathAppendW(manifestPath, L"AppxManifest.xml");
 
-    if ( !OK( registerAppxPackage( manifestPath, &package ) ) )
+    if ( !OK( loadAppxPackage( manifestPath, &package ) ) )
     {
         status = E_UNEXPECTED;
     }
@@ -220,6 +206,7 @@ HRESULT WINAPI known_folders_statics_RequestAccess( IUnknown *invoker, IUnknown
     {
         result->vt = VT_UI4;
         result->ulVal = (ULONG)KnownFoldersAccessStatus_NotDeclaredByApp;
+        freeAppxPackage( &package );
         return status;
     }
 
@@ -270,5 +257,6 @@ HRESULT WINAPI known_folders_statics_RequestAccess( IUnknown *invoker, IUnknown
         }
     }
 
+    freeAppxPackage( &package );
     return status;
 }
\ No newline at end of file
@@ -0,0 +1,541 @@
+/* WinRT Windows.Storage.Search Directory Enumeration Engine
+ *
+ * Written by Weather
+ *
+ * This is a reverse engineered implementation of Microsoft's OneCoreUAP binaries.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "ntstatus.h"
+#define WIN32_NO_STATUS
+#include "StorageEnumerationInternal.h"
+
+_ENABLE_DEBUGGING_
+
+struct storage_enumeration_task
+{
+    struct storage_enumeration *enumeration;
+    BOOL isRoot;
+    WCHAR Path[1];
+};
+
+static INIT_ONCE enumeration_pool_once = INIT_ONCE_STATIC_INIT;
+static TP_CALLBACK_ENVIRON enumeration_environment;
+
+static BOOL CALLBACK storage_enumeration_InitPool( INIT_ONCE *once, void *param, void **context )
+{
+    SYSTEM_INFO systemInfo;
+    DWORD threads;
+
+    memset( &enumeration_environment, 0, sizeof(enumeration_environment) );
+    enumeration_environment.Version = 1;
+
+    if (!(enumeration_environment.Pool = CreateThreadpool( NULL ))) return FALSE;
+
+    //Directory walks are I/O bound, but there is no point in having more walkers than cores.
+    GetSystemInfo( &systemInfo );
+    threads = min( max( systemInfo.dwNumberOfProcessors, 1 ), ENUMERATION_MAX_THREADS );
+    SetThreadpoolThreadMaximum( enumeration_environment.Pool, threads );
+
+    TRACE( "enumeration pool %p with %lu threads\n", enumeration_environment.Pool, threads );
+    return TRUE;
+}
+
+static BOOL storage_enumeration_IsCancelled( struct storage_enumeration *enumeration )
+{
+    return ReadNoFence( (LONG *)&enumeration->cancelled );
+}
+
+static VOID storage_enumeration_Fail( struct storage_enumeration *enumeration, HRESULT status )
+{
+    EnterCriticalSection( &enumeration->cs );
+    if ( SUCCEEDED( enumeration->status ) ) enumeration->status = status;
+    enumeration->cancelled = TRUE;
+    LeaveCriticalSection( &enumeration->cs );
+}
+
+static void CALLBACK storage_enumeration_Worker( TP_CALLBACK_INSTANCE *instance, void *context );
+static NTSTATUS storage_enumeration_frame_Read( struct storage_enumeration_frame *frame, HANDLE handle );
+static VOID storage_enumeration_frame_Clear( struct storage_enumeration_frame *frame );
+
+static HRESULT storage_enumeration_Submit( struct storage_enumeration *enumeration, LPCWSTR path, BOOL isRoot )
+{
+    struct storage_enumeration_task *task;
+    SIZE_T length = wcslen( path );
+
+    if (!(task = malloc( offsetof( struct storage_enumeration_task, Path[length + 1] ) ))) return E_OUTOFMEMORY;
+    task->enumeration = enumeration;
+    task->isRoot = isRoot;
+    memcpy( task->Path, path, (length + 1) * sizeof(WCHAR) );
+
+    //The task keeps the enumeration alive until it has been walked.
+    InterlockedIncrement( &enumeration->ref );
+    EnterCriticalSection( &enumeration->cs );
+    enumeration->pendingDirectories++;
+    LeaveCriticalSection( &enumeration->cs );
+
+    if ( !TrySubmitThreadpoolCallback( storage_enumeration_Worker, task, &enumeration_environment ) )
+    {
+        //Walk it synchronously rather than losing a subtree.
+        WARN( "failed to submit %s, walking inline\n", debugstr_w( path ) );
+        storage_enumeration_Worker( NULL, task );
+    }
+
+    return S_OK;
+}
+
+/**
+ * Reports the entries of one directory sorted by name, the same order as the cursor walk.
+ * A directory that could only be read in part still reports what was read before failing.
+ */
+static HRESULT storage_enumeration_WalkDirectory( struct storage_enumeration *enumeration, LPCWSTR directory )
+{
+    struct storage_enumeration_frame frame = { 0 };
+    FILE_ID_BOTH_DIRECTORY_INFORMATION *info;
+    struct storage_enumeration_entry entry;
+    NTSTATUS ntStatus;
+    HRESULT status = S_OK;
+    HANDLE handle;
+    UINT32 directoryLength = wcslen( directory );
+    UINT32 pathCapacity = 0;
+    UINT32 nameLength;
+    UINT32 iterator;
+    LPWSTR fullPath = NULL;
+    LPWSTR tmp;
+
+    handle = CreateFileW( directory, FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+                          OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL );
+    if ( handle == INVALID_HANDLE_VALUE ) return HRESULT_FROM_WIN32( GetLastError() );
+
+    ntStatus = storage_enumeration_frame_Read( &frame, handle );
+    CloseHandle( handle );
+    if ( ntStatus == STATUS_NO_MEMORY ) return E_OUTOFMEMORY;
+
+    entry.Directory = directory;
+
+    for ( iterator = 0; iterator < frame.count && !storage_enumeration_IsCancelled( enumeration ); iterator++ )
+    {
+        info = frame.entries[iterator];
+        nameLength = info->FileNameLength / sizeof(WCHAR);
+        if ( nameLength >= MAX_PATH ) continue;
+
+        //The name is reported from the full path, which is also what subdirectories are submitted with.
+        if ( directoryLength + nameLength + 2 > pathCapacity )
+        {
+            if (!(tmp = realloc( fullPath, (directoryLength + nameLength + 2) * sizeof(WCHAR) )))
+            {
+                status = E_OUTOFMEMORY;
+                break;
+            }
+            fullPath = tmp;
+            pathCapacity = directoryLength + nameLength + 2;
+            memcpy( fullPath, directory, directoryLength * sizeof(WCHAR) );
+            fullPath[directoryLength] = '\\';
+        }
+        memcpy( fullPath + directoryLength + 1, info->FileName, info->FileNameLength );
+        fullPath[directoryLength + 1 + nameLength] = 0;
+
+        entry.Name = fullPath + directoryLength + 1;
+        entry.NameLength = nameLength;
+        entry.Attributes = info->FileAttributes;
+        entry.Size = info->EndOfFile;
+        entry.CreationTime = info->CreationTime;
+        entry.LastWriteTime = info->LastWriteTime;
+        entry.FileId = info->FileId;
+
+        status = enumeration->callback( enumeration->context, &entry );
+        if ( FAILED( status ) ) break;
+        status = S_OK;
+
+        if ( enumeration->Deep && (info->FileAttributes & FILE_ATTRIBUTE_DIRECTORY) && !(info->FileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) )
+        {
+            status = storage_enumeration_Submit( enumeration, fullPath, FALSE );
+            if ( FAILED( status ) ) break;
+        }
+    }
+
+    storage_enumeration_frame_Clear( &frame );
+    free( fullPath );
+
+    if ( SUCCEEDED( status ) && ntStatus != STATUS_SUCCESS ) status = HRESULT_FROM_NT( ntStatus );
+    return status;
+}
+
+static void CALLBACK storage_enumeration_Worker( TP_CALLBACK_INSTANCE *instance, void *context )
+{
+    struct storage_enumeration_task *task = context;
+    struct storage_enumeration *enumeration = task->enumeration;
+    HRESULT status;
+    BOOL finished;
+
+    status = storage_enumeration_WalkDirectory( enumeration, task->Path );
+
+    if ( FAILED( status ) )
+    {
+        //Unreadable subdirectories are skipped, an unreadable root fails the query.
+        if ( task->isRoot || status == E_OUTOFMEMORY )
+            storage_enumeration_Fail( enumeration, task->isRoot ? E_ABORT : status );
+        else
+            WARN( "skipping %s, status %#lx\n", debugstr_w( task->Path ), status );
+    }
+
+    EnterCriticalSection( &enumeration->cs );
+    finished = !--enumeration->pendingDirectories;
+    LeaveCriticalSection( &enumeration->cs );
+    if ( finished ) WakeAllConditionVariable( &enumeration->finished );
+
+    free( task );
+    storage_enumeration_Release( enumeration );
+}
+
+HRESULT WINAPI storage_enumeration_Create( HSTRING root, BOOL deep, storage_enumeration_callback callback, void *context, struct storage_enumeration **out )
+{
+    struct storage_enumeration *enumeration;
+
+    TRACE( "root %s, deep %d, callback %p, context %p\n", debugstr_hstring( root ), deep, callback, context );
+
+    if ( !InitOnceExecuteOnce( &enumeration_pool_once, storage_enumeration_InitPool, NULL, NULL ) ) return E_FAIL;
+    if (!(enumeration = calloc( 1, sizeof(*enumeration) ))) return E_OUTOFMEMORY;
+
+    WindowsDuplicateString( root, &enumeration->Root );
+    enumeration->Deep = deep;
+    enumeration->callback = callback;
+    enumeration->context = context;
+    enumeration->status = S_OK;
+    enumeration->ref = 1;
+
+    InitializeCriticalSectionEx( &enumeration->cs, 0, RTL_CRITICAL_SECTION_FLAG_FORCE_DEBUG_INFO );
+    enumeration->cs.DebugInfo->Spare[0] = (DWORD_PTR)( __FILE__ ": storage_enumeration.cs" );
+    InitializeConditionVariable( &enumeration->finished );
+
+    *out = enumeration;
+    return S_OK;
+}
+
+HRESULT WINAPI storage_enumeration_Start( struct storage_enumeration *enumeration )
+{
+    TRACE( "enumeration %p\n", enumeration );
+    return storage_enumeration_Submit( enumeration, WindowsGetStringRawBuffer( enumeration->Root, NULL ), TRUE );
+}
+
+/**
+ * Waits for the whole walk. The workers finish directories in any order, so callers that
+ * need sorted results can't use any of them before every directory has been walked.
+ */
+HRESULT WINAPI storage_enumeration_Wait( struct storage_enumeration *enumeration )
+{
+    HRESULT status;
+
+    EnterCriticalSection( &enumeration->cs );
+    while ( enumeration->pendingDirectories )
+        SleepConditionVariableCS( &enumeration->finished, &enumeration->cs, INFINITE );
+    status = enumeration->status;
+    LeaveCriticalSection( &enumeration->cs );
+
+    return status;
+}
+
+VOID WINAPI storage_enumeration_Cancel( struct storage_enumeration *enumeration )
+{
+    TRACE( "enumeration %p\n", enumeration );
+
+    EnterCriticalSection( &enumeration->cs );
+    enumeration->cancelled = TRUE;
+    LeaveCriticalSection( &enumeration->cs );
+}
+
+VOID WINAPI storage_enumeration_Release( struct storage_enumeration *enumeration )
+{
+    if ( InterlockedDecrement( &enumeration->ref ) ) return;
+
+    enumeration->cs.DebugInfo->Spare[0] = 0;
+    DeleteCriticalSection( &enumeration->cs );
+    WindowsDeleteString( enumeration->Root );
+    free( enumeration );
+}
+
+/**
+ * Orders names case insensitively, names only differing in case are ordered by their exact spelling.
+ */
+INT WINAPI storage_enumeration_CompareNames( LPCWSTR name1, UINT32 length1, LPCWSTR name2, UINT32 length2 )
+{
+    INT result = CompareStringOrdinal( name1, length1, name2, length2, TRUE );
+
+    if ( result == CSTR_EQUAL ) result = CompareStringOrdinal( name1, length1, name2, length2, FALSE );
+    return result - CSTR_EQUAL;
+}
+
+/**
+ * Orders full paths component by component, a folder comes right before its own contents.
+ * This is the order of a depth first walk that visits every folder sorted by name.
+ */
+INT WINAPI storage_enumeration_ComparePaths( LPCWSTR path1, LPCWSTR path2 )
+{
+    UINT32 length1, length2;
+    INT result;
+
+    for (;;)
+    {
+        length1 = wcscspn( path1, L"\\" );
+        length2 = wcscspn( path2, L"\\" );
+
+        result = storage_enumeration_CompareNames( path1, length1, path2, length2 );
+        if ( result ) return result;
+
+        path1 += length1;
+        path2 += length2;
+        if ( !*path1 || !*path2 ) return *path1 ? 1 : *path2 ? -1 : 0;
+        path1++;
+        path2++;
+    }
+}
+
+static int __cdecl storage_enumeration_CompareInfo( const void *a, const void *b )
+{
+    const FILE_ID_BOTH_DIRECTORY_INFORMATION *info1 = *(FILE_ID_BOTH_DIRECTORY_INFORMATION *const *)a;
+    const FILE_ID_BOTH_DIRECTORY_INFORMATION *info2 = *(FILE_ID_BOTH_DIRECTORY_INFORMATION *const *)b;
+
+    return storage_enumeration_CompareNames( info1->FileName, info1->FileNameLength / sizeof(WCHAR),
+                                             info2->FileName, info2->FileNameLength / sizeof(WCHAR) );
+}
+
+static VOID storage_enumeration_frame_Clear( struct storage_enumeration_frame *frame )
+{
+    while ( frame->count ) free( frame->entries[--frame->count] );
+    free( frame->entries );
+    frame->entries = NULL;
+}
+
+/**
+ * Lists a whole directory and sorts it, a failed batch keeps whatever was read before it.
+ */
+static NTSTATUS storage_enumeration_frame_Read( struct storage_enumeration_frame *frame, HANDLE handle )
+{
+    FILE_ID_BOTH_DIRECTORY_INFORMATION *info, **tmp;
+    UINT32 capacity = 0;
+    IO_STATUS_BLOCK io;
+    NTSTATUS ntStatus;
+    BOOLEAN restart = TRUE;
+    ULONG offset, size;
+    BYTE *buffer;
+
+    if (!(buffer = malloc( ENUMERATION_BUFFER_SIZE ))) return STATUS_NO_MEMORY;
+
+    for (;;)
+    {
+        ntStatus = NtQueryDirectoryFile( handle, NULL, NULL, NULL, &io, buffer, ENUMERATION_BUFFER_SIZE,
+                                         FileIdBothDirectoryInformation, FALSE, NULL, restart );
+        restart = FALSE;
+        if ( ntStatus != STATUS_SUCCESS ) break;
+
+        for ( offset = 0;; offset += info->NextEntryOffset )
+        {
+            info = (FILE_ID_BOTH_DIRECTORY_INFORMATION *)(buffer + offset);
+
+            if ( !(info->FileName[0] == '.' && (info->FileNameLength == sizeof(WCHAR) ||
+                   (info->FileNameLength == 2 * sizeof(WCHAR) && info->FileName[1] == '.'))) )
+            {
+                if ( frame->count == capacity )
+                {
+                    if (!(tmp = realloc( frame->entries, (capacity + 64) * sizeof(*tmp) ))) goto oom;
+                    frame->entries = tmp;
+                    capacity += 64;
+                }
+
+                size = offsetof( FILE_ID_BOTH_DIRECTORY_INFORMATION, FileName[0] ) + info->FileNameLength;
+                if (!(frame->entries[frame->count] = malloc( size ))) goto oom;
+                memcpy( frame->entries[frame->count], info, size );
+                frame->entries[frame->count++]->NextEntryOffset = 0;
+            }
+
+            if ( !info->NextEntryOffset ) break;
+        }
+    }
+
+    free( buffer );
+    qsort( frame->entries, frame->count, sizeof(*frame->entries), storage_enumeration_CompareInfo );
+    return ntStatus == STATUS_NO_MORE_FILES ? STATUS_SUCCESS : ntStatus;
+
+oom:
+    free( buffer );
+    storage_enumeration_frame_Clear( frame );
+    return STATUS_NO_MEMORY;
+}
+
+static HRESULT storage_enumeration_cursor_Push( struct storage_enumeration_cursor *cursor, LPCWSTR name )
+{
+    struct storage_enumeration_frame *frame;
+    struct storage_enumeration_frame *tmp;
+    UINT32 parentLength = cursor->pathLength;
+    UINT32 nameLength;
+    NTSTATUS ntStatus;
+    HANDLE handle;
+    LPWSTR path;
+
+    if ( cursor->depth == cursor->capacity )
+    {
+        if (!(tmp = realloc( cursor->frames, (cursor->capacity + 8) * sizeof(*tmp) ))) return E_OUTOFMEMORY;
+        cursor->frames = tmp;
+        cursor->capacity += 8;
+    }
+
+    //The path grows like the ones of the parallel walk, deep trees go past MAX_PATH.
+    if ( name )
+    {
+        nameLength = wcslen( name );
+        if ( parentLength + nameLength + 2 > cursor->pathCapacity )
+        {
+            if (!(path = realloc( cursor->Path, (parentLength + nameLength + 2) * sizeof(WCHAR) ))) return E_OUTOFMEMORY;
+            cursor->Path = path;
+            cursor->pathCapacity = parentLength + nameLength + 2;
+        }
+        cursor->Path[parentLength] = '\\';
+        memcpy( cursor->Path + parentLength + 1, name, (nameLength + 1) * sizeof(WCHAR) );
+        cursor->pathLength += nameLength + 1;
+    }
+
+    handle = CreateFileW( cursor->Path, FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+                          OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL );
+    if ( handle == INVALID_HANDLE_VALUE )
+    {
+        cursor->Path[cursor->pathLength = parentLength] = 0;
+        return HRESULT_FROM_WIN32( GetLastError() );
+    }
+
+    frame = &cursor->frames[cursor->depth];
+    memset( frame, 0, sizeof(*frame) );
+    ntStatus = storage_enumeration_frame_Read( frame, handle );
+    CloseHandle( handle );
+
+    //Same policy as the parallel walk, only an unreadable root is fatal.
+    if ( ntStatus == STATUS_NO_MEMORY || (ntStatus && !cursor->depth) )
+    {
+        storage_enumeration_frame_Clear( frame );
+        cursor->Path[cursor->pathLength = parentLength] = 0;
+        return ntStatus == STATUS_NO_MEMORY ? E_OUTOFMEMORY : HRESULT_FROM_NT( ntStatus );
+    }
+
+    frame->parentLength = parentLength;
+    cursor->depth++;
+    return S_OK;
+}
+
+static VOID storage_enumeration_cursor_Pop( struct storage_enumeration_cursor *cursor )
+{
+    struct storage_enumeration_frame *frame = &cursor->frames[--cursor->depth];
+
+    storage_enumeration_frame_Clear( frame );
+    cursor->Path[cursor->pathLength = frame->parentLength] = 0;
+}
+
+HRESULT WINAPI storage_enumeration_cursor_Create( HSTRING root, BOOL deep, struct storage_enumeration_cursor **out )
+{
+    struct storage_enumeration_cursor *cursor;
+    LPCWSTR rootPath;
+    UINT32 rootLength;
+    HRESULT status;
+
+    TRACE( "root %s, deep %d\n", debugstr_hstring( root ), deep );
+
+    rootPath = WindowsGetStringRawBuffer( root, &rootLength );
+    if (!(cursor = calloc( 1, sizeof(*cursor) ))) return E_OUTOFMEMORY;
+    if (!(cursor->Path = malloc( (rootLength + 1) * sizeof(WCHAR) )))
+    {
+        free( cursor );
+        return E_OUTOFMEMORY;
+    }
+
+    cursor->Deep = deep;
+    memcpy( cursor->Path, rootPath, rootLength * sizeof(WCHAR) );
+    cursor->Path[rootLength] = 0;
+    cursor->pathLength = rootLength;
+    cursor->pathCapacity = rootLength + 1;
+
+    status = storage_enumeration_cursor_Push( cursor, NULL );
+    if ( FAILED( status ) )
+    {
+        free( cursor->frames );
+        free( cursor->Path );
+        free( cursor );
+        return status;
+    }
+
+    *out = cursor;
+    return S_OK;
+}
+
+/**
+ * Returns the next entry in storage_enumeration_ComparePaths order, S_FALSE once the walk is over.
+ * The entry strings are owned by the cursor and stay valid until the next call.
+ */
+HRESULT WINAPI storage_enumeration_cursor_Next( struct storage_enumeration_cursor *cursor, struct storage_enumeration_entry *entry )
+{
+    FILE_ID_BOTH_DIRECTORY_INFORMATION *info;
+    struct storage_enumeration_frame *frame;
+    HRESULT status;
+    UINT32 nameLength;
+
+    //Descend into the folder returned last, now that the caller is done with its entry.
+    if ( cursor->descend )
+    {
+        cursor->descend = FALSE;
+        status = storage_enumeration_cursor_Push( cursor, cursor->Name );
+        if ( status == E_OUTOFMEMORY ) return status;
+        if ( FAILED( status ) ) WARN( "skipping %s, status %#lx\n", debugstr_w( cursor->Name ), status );
+    }
+
+    while ( cursor->depth )
+    {
+        frame = &cursor->frames[cursor->depth - 1];
+
+        if ( frame->next == frame->count )
+        {
+            storage_enumeration_cursor_Pop( cursor );
+            continue;
+        }
+
+        info = frame->entries[frame->next++];
+        nameLength = info->FileNameLength / sizeof(WCHAR);
+        if ( nameLength >= MAX_PATH ) continue;
+
+        memcpy( cursor->Name, info->FileName, info->FileNameLength );
+        cursor->Name[nameLength] = 0;
+
+        entry->Directory = cursor->Path;
+        entry->Name = cursor->Name;
+        entry->NameLength = nameLength;
+        entry->Attributes = info->FileAttributes;
+        entry->Size = info->EndOfFile;
+        entry->CreationTime = info->CreationTime;
+        entry->LastWriteTime = info->LastWriteTime;
+        entry->FileId = info->FileId;
+
+        cursor->descend = cursor->Deep && (info->FileAttributes & FILE_ATTRIBUTE_DIRECTORY) && !(info->FileAttributes & FILE_ATTRIBUTE_REPARSE_POINT);
+        return S_OK;
+    }
+
+    return S_FALSE;
+}
+
+VOID WINAPI storage_enumeration_cursor_Release( struct storage_enumeration_cursor *cursor )
+{
+    if ( !cursor ) return;
+
+    while ( cursor->depth ) storage_enumeration_cursor_Pop( cursor );
+    free( cursor->frames );
+    free( cursor->Path );
+    free( cursor );
+}
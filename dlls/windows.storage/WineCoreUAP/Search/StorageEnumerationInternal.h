@@ -0,0 +1,111 @@
+/* WinRT Windows.Storage.Search Directory Enumeration Engine
+ *
+ * Written by Weather
+ *
+ * This is a reverse engineered implementation of Microsoft's OneCoreUAP binaries.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef STORAGE_ENUMERATION_INTERNAL_H
+#define STORAGE_ENUMERATION_INTERNAL_H
+
+#include "../../private.h"
+#include "wine/debug.h"
+
+#include "winternl.h"
+
+//Size of a single NtQueryDirectoryFile batch.
+#define ENUMERATION_BUFFER_SIZE 0x10000
+//Upper bound for the amount of directories walked concurrently.
+#define ENUMERATION_MAX_THREADS 8
+
+struct storage_enumeration_entry
+{
+    LPCWSTR Directory;
+    LPCWSTR Name;
+    UINT32 NameLength;
+    DWORD Attributes;
+    LARGE_INTEGER Size;
+    LARGE_INTEGER CreationTime;
+    LARGE_INTEGER LastWriteTime;
+    LARGE_INTEGER FileId;
+};
+
+/**
+ * Invoked concurrently from the enumeration workers for every entry of the walk.
+ * Return S_OK when the entry was accepted, S_FALSE when it was filtered out and
+ * a failure code to abort the walk.
+ */
+typedef HRESULT (WINAPI *storage_enumeration_callback)( void *context, const struct storage_enumeration_entry *entry );
+
+struct storage_enumeration
+{
+    HSTRING Root;
+    BOOL Deep;
+    storage_enumeration_callback callback;
+    void *context;
+
+    CRITICAL_SECTION cs;
+    CONDITION_VARIABLE finished;
+    LONG pendingDirectories;
+    BOOL cancelled;
+    HRESULT status;
+
+    LONG ref;
+};
+
+/**
+ * Sequential, resumable walk of a tree, one entry at a time.
+ * Every directory on the way down is listed once and sorted by name, so the walk
+ * visits the tree in storage_enumeration_ComparePaths order and can be paused
+ * between pages without holding any handle.
+ */
+struct storage_enumeration_frame
+{
+    FILE_ID_BOTH_DIRECTORY_INFORMATION **entries;
+    UINT32 count;
+    UINT32 next;
+    UINT32 parentLength;
+};
+
+struct storage_enumeration_cursor
+{
+    BOOL Deep;
+    struct storage_enumeration_frame *frames;
+    UINT32 depth;
+    UINT32 capacity;
+    BOOL descend;
+
+    LPWSTR Path;
+    UINT32 pathLength;
+    UINT32 pathCapacity;
+    WCHAR Name[MAX_PATH];
+};
+
+HRESULT WINAPI storage_enumeration_Create( HSTRING root, BOOL deep, storage_enumeration_callback callback, void *context, struct storage_enumeration **out );
+HRESULT WINAPI storage_enumeration_Start( struct storage_enumeration *enumeration );
+HRESULT WINAPI storage_enumeration_Wait( struct storage_enumeration *enumeration );
+VOID WINAPI storage_enumeration_Cancel( struct storage_enumeration *enumeration );
+VOID WINAPI storage_enumeration_Release( struct storage_enumeration *enumeration );
+
+INT WINAPI storage_enumeration_CompareNames( LPCWSTR name1, UINT32 length1, LPCWSTR name2, UINT32 length2 );
+INT WINAPI storage_enumeration_ComparePaths( LPCWSTR path1, LPCWSTR path2 );
+
+HRESULT WINAPI storage_enumeration_cursor_Create( HSTRING root, BOOL deep, struct storage_enumeration_cursor **out );
+HRESULT WINAPI storage_enumeration_cursor_Next( struct storage_enumeration_cursor *cursor, struct storage_enumeration_entry *entry );
+VOID WINAPI storage_enumeration_cursor_Release( struct storage_enumeration_cursor *cursor );
+
+#endif
@@ -25,10 +25,12 @@ _ENABLE_DEBUGGING_
 
 HRESULT WINAPI storage_folder_query_operations_GetIndexedState( IUnknown *invoker, IUnknown *param, PROPVARIANT *result )
 {
-    //Unix has no concept of "Indexed States"
-    FIXME( "iface %p, param %p stub!\n", invoker, param );
+    struct storage_folder *inheritedFolder = CONTAINING_RECORD( (IStorageFolderQueryOperations *)invoker, struct storage_folder, IStorageFolderQueryOperations_iface );
+
+    TRACE( "iface %p, param %p\n", invoker, param );
+
     result->vt = VT_UI4;
-    result->ulVal = (ULONG)IndexedState_Unknown;
+    result->ulVal = (ULONG)storage_index_GetState( WindowsGetStringRawBuffer( inheritedFolder->Path, NULL ) );
     return S_OK;
 }
 
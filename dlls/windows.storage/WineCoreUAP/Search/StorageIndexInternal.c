@@ -0,0 +1,980 @@
+/* WinRT Windows.Storage.Search Persistent Query Index
+ *
+ * Written by Weather
+ *
+ * This is a reverse engineered implementation of Microsoft's OneCoreUAP binaries.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "StorageIndexInternal.h"
+
+#include <stdlib.h>
+#include <winnls.h>
+#include <shlobj.h>
+#include <knownfolders.h>
+
+_ENABLE_DEBUGGING_
+
+struct storage_index_builder
+{
+    struct storage_index *index;
+    struct storage_enumeration *enumeration;
+    CRITICAL_SECTION cs;
+    struct storage_index_entry *entries;
+    UINT32 size;
+    UINT32 capacity;
+};
+
+static const KNOWNFOLDERID *indexed_known_folders[] =
+{
+    &FOLDERID_Documents,
+    &FOLDERID_Music,
+    &FOLDERID_Pictures,
+    &FOLDERID_Videos,
+};
+
+static LPWSTR indexed_roots[ARRAY_SIZE(indexed_known_folders)];
+static UINT32 indexed_root_count;
+static INIT_ONCE indexed_roots_once = INIT_ONCE_STATIC_INIT;
+
+static struct list storage_indexes = LIST_INIT( storage_indexes );
+static SRWLOCK storage_indexes_lock = SRWLOCK_INIT;
+
+static BOOL CALLBACK storage_index_InitRoots( INIT_ONCE *once, void *param, void **context )
+{
+    PWSTR knownPath;
+    UINT32 iterator;
+
+    for ( iterator = 0; iterator < ARRAY_SIZE(indexed_known_folders); iterator++ )
+    {
+        if ( FAILED( SHGetKnownFolderPath( indexed_known_folders[iterator], 0, NULL, &knownPath ) ) ) continue;
+        indexed_roots[indexed_root_count++] = wcsdup( knownPath );
+        CoTaskMemFree( knownPath );
+    }
+
+    return TRUE;
+}
+
+static LPCWSTR storage_index_FindRoot( LPCWSTR folderPath )
+{
+    LPCWSTR root = NULL;
+    UINT32 rootLength = 0;
+    UINT32 iterator;
+    UINT32 length;
+
+    InitOnceExecuteOnce( &indexed_roots_once, storage_index_InitRoots, NULL, NULL );
+
+    //Nested roots resolve to the innermost one.
+    for ( iterator = 0; iterator < indexed_root_count; iterator++ )
+    {
+        if ( !indexed_roots[iterator] ) continue;
+        length = wcslen( indexed_roots[iterator] );
+        if ( length <= rootLength || wcsnicmp( folderPath, indexed_roots[iterator], length ) ) continue;
+        if ( folderPath[length] && folderPath[length] != '\\' ) continue;
+
+        root = indexed_roots[iterator];
+        rootLength = length;
+    }
+
+    return root;
+}
+
+/**
+ * Orders paths component by component like storage_enumeration_ComparePaths, so that queries
+ * get the entries in the order their results are sorted in and a folder is directly followed
+ * by its contents. Case is ignored, a path is indexed once whatever its spelling.
+ */
+static int storage_index_Compare( LPCWSTR a, UINT32 aLength, LPCWSTR b, UINT32 bLength )
+{
+    UINT32 length1, length2;
+    int result;
+
+    for (;;)
+    {
+        for ( length1 = 0; length1 < aLength && a[length1] != '\\'; length1++ ) ;
+        for ( length2 = 0; length2 < bLength && b[length2] != '\\'; length2++ ) ;
+
+        result = CompareStringOrdinal( a, length1, b, length2, TRUE ) - CSTR_EQUAL;
+        if ( result ) return result;
+
+        if ( length1 == aLength || length2 == bLength ) return length1 < aLength ? 1 : length2 < bLength ? -1 : 0;
+        a += length1 + 1;
+        b += length2 + 1;
+        aLength -= length1 + 1;
+        bLength -= length2 + 1;
+    }
+}
+
+static int __cdecl storage_index_CompareEntries( const void *a, const void *b )
+{
+    const struct storage_index_entry *entryA = a, *entryB = b;
+    return storage_index_Compare( entryA->Path, entryA->PathLength, entryB->Path, entryB->PathLength );
+}
+
+static BOOL storage_index_HasPrefix( const struct storage_index_entry *entry, LPCWSTR prefix, UINT32 length )
+{
+    return entry->PathLength >= length && !storage_index_Compare( entry->Path, length, prefix, length );
+}
+
+static UINT32 storage_index_LowerBound( struct storage_index *index, LPCWSTR path, UINT32 length )
+{
+    UINT32 low = 0, high = index->size, middle;
+
+    while ( low < high )
+    {
+        middle = low + (high - low) / 2;
+        if ( storage_index_Compare( index->entries[middle].Path, index->entries[middle].PathLength, path, length ) < 0 )
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return low;
+}
+
+static BOOL storage_index_Reserve( struct storage_index_entry **entries, UINT32 *capacity, UINT32 count )
+{
+    struct storage_index_entry *tmp;
+    UINT32 newCapacity;
+
+    if ( count <= *capacity ) return TRUE;
+
+    newCapacity = max( 32, max( count, *capacity * 3 / 2 ) );
+    if (!(tmp = realloc( *entries, newCapacity * sizeof(**entries) ))) return FALSE;
+
+    *entries = tmp;
+    *capacity = newCapacity;
+    return TRUE;
+}
+
+static VOID storage_index_FreeEntries( struct storage_index_entry *entries, UINT32 size )
+{
+    UINT32 iterator;
+
+    for ( iterator = 0; iterator < size; iterator++ ) free( entries[iterator].Path );
+    free( entries );
+}
+
+static BOOL storage_index_FillEntry( struct storage_index_entry *entry, LPCWSTR path, UINT32 length, DWORD attributes,
+                                     UINT64 size, LONGLONG creationTime, LONGLONG lastWriteTime )
+{
+    UINT32 iterator;
+
+    if (!(entry->Path = malloc( (length + 1) * sizeof(WCHAR) ))) return FALSE;
+    memcpy( entry->Path, path, length * sizeof(WCHAR) );
+    entry->Path[length] = 0;
+    entry->PathLength = length;
+
+    entry->NameOffset = 0;
+    for ( iterator = length; iterator; iterator-- )
+    {
+        if ( path[iterator - 1] != '\\' ) continue;
+        entry->NameOffset = iterator;
+        break;
+    }
+
+    entry->Attributes = attributes;
+    entry->Size = size;
+    entry->CreationTime.QuadPart = creationTime;
+    entry->LastWriteTime.QuadPart = lastWriteTime;
+    return TRUE;
+}
+
+/**
+ * Index mutation, the caller holds the index lock exclusively.
+ */
+static BOOL storage_index_Insert( struct storage_index *index, struct storage_index_entry *entry )
+{
+    UINT32 position = storage_index_LowerBound( index, entry->Path, entry->PathLength );
+
+    if ( position < index->size && !storage_index_Compare( index->entries[position].Path, index->entries[position].PathLength, entry->Path, entry->PathLength ) )
+    {
+        free( index->entries[position].Path );
+        index->entries[position] = *entry;
+        return TRUE;
+    }
+
+    if ( !storage_index_Reserve( &index->entries, &index->capacity, index->size + 1 ) )
+    {
+        free( entry->Path );
+        return FALSE;
+    }
+
+    memmove( &index->entries[position + 1], &index->entries[position], (index->size - position) * sizeof(*index->entries) );
+    index->entries[position] = *entry;
+    index->size++;
+    return TRUE;
+}
+
+static VOID storage_index_RemoveRange( struct storage_index *index, UINT32 start, UINT32 end )
+{
+    UINT32 iterator;
+
+    if ( start >= end ) return;
+    for ( iterator = start; iterator < end; iterator++ ) free( index->entries[iterator].Path );
+    memmove( &index->entries[start], &index->entries[end], (index->size - end) * sizeof(*index->entries) );
+    index->size -= end - start;
+}
+
+static VOID storage_index_RemoveTree( struct storage_index *index, LPCWSTR path, UINT32 length )
+{
+    WCHAR prefix[MAX_PATH];
+    UINT32 start;
+    UINT32 end;
+
+    //The children directly follow the folder, they go in the same range.
+    start = end = storage_index_LowerBound( index, path, length );
+    if ( end < index->size && !storage_index_Compare( index->entries[end].Path, index->entries[end].PathLength, path, length ) )
+        end++;
+
+    if ( length + 1 < MAX_PATH )
+    {
+        memcpy( prefix, path, length * sizeof(WCHAR) );
+        prefix[length] = '\\';
+        while ( end < index->size && storage_index_HasPrefix( &index->entries[end], prefix, length + 1 ) ) end++;
+    }
+
+    storage_index_RemoveRange( index, start, end );
+}
+
+/**
+ * Index building, through the enumeration engine.
+ */
+static HRESULT WINAPI storage_index_AddEntry( void *context, const struct storage_enumeration_entry *entry )
+{
+    struct storage_index_builder *builder = context;
+    LPCWSTR directory = entry->Directory + builder->index->RootLength;
+    HRESULT status = S_OK;
+    WCHAR path[MAX_PATH];
+    int length;
+
+    //The index is being closed, drop the walk rather than finishing it.
+    if ( ReadNoFence( &builder->index->stopping ) )
+    {
+        storage_enumeration_Cancel( builder->enumeration );
+        return E_ABORT;
+    }
+
+    if ( *directory == '\\' ) directory++;
+    if ( *directory ) length = swprintf( path, ARRAY_SIZE(path), L"%s\\%s", directory, entry->Name );
+    else length = swprintf( path, ARRAY_SIZE(path), L"%s", entry->Name );
+    if ( length < 0 ) return S_FALSE;
+
+    EnterCriticalSection( &builder->cs );
+    if ( storage_index_Reserve( &builder->entries, &builder->capacity, builder->size + 1 )
+      && storage_index_FillEntry( &builder->entries[builder->size], path, length, entry->Attributes, entry->Size.QuadPart,
+                                  entry->CreationTime.QuadPart, entry->LastWriteTime.QuadPart ) )
+        builder->size++;
+    else
+        status = E_OUTOFMEMORY;
+    LeaveCriticalSection( &builder->cs );
+
+    return status;
+}
+
+static HRESULT storage_index_Walk( struct storage_index *index, LPCWSTR directory, struct storage_index_builder *builder )
+{
+    HSTRING directoryPath;
+    HRESULT status;
+
+    memset( builder, 0, sizeof(*builder) );
+    builder->index = index;
+    InitializeCriticalSection( &builder->cs );
+
+    status = WindowsCreateString( directory, wcslen( directory ), &directoryPath );
+    if ( SUCCEEDED( status ) )
+    {
+        status = storage_enumeration_Create( directoryPath, TRUE, storage_index_AddEntry, builder, &builder->enumeration );
+        WindowsDeleteString( directoryPath );
+    }
+    if ( SUCCEEDED( status ) )
+    {
+        status = storage_enumeration_Start( builder->enumeration );
+        if ( SUCCEEDED( status ) ) status = storage_enumeration_Wait( builder->enumeration );
+        storage_enumeration_Release( builder->enumeration );
+        builder->enumeration = NULL;
+    }
+    //A cancelled walk is incomplete, it must not replace the index.
+    if ( SUCCEEDED( status ) && ReadNoFence( &index->stopping ) ) status = E_ABORT;
+
+    DeleteCriticalSection( &builder->cs );
+
+    if ( FAILED( status ) )
+    {
+        storage_index_FreeEntries( builder->entries, builder->size );
+        builder->entries = NULL;
+        builder->size = builder->capacity = 0;
+    }
+
+    return status;
+}
+
+static BOOL storage_index_GetLastWriteTime( LPCWSTR path, LARGE_INTEGER *lastWriteTime )
+{
+    WIN32_FILE_ATTRIBUTE_DATA data;
+
+    if ( !GetFileAttributesExW( path, GetFileExInfoStandard, &data ) ) return FALSE;
+    lastWriteTime->u.LowPart = data.ftLastWriteTime.dwLowDateTime;
+    lastWriteTime->u.HighPart = data.ftLastWriteTime.dwHighDateTime;
+    return TRUE;
+}
+
+static HRESULT storage_index_Refresh( struct storage_index *index )
+{
+    struct storage_index_builder builder;
+    struct storage_index_entry *oldEntries;
+    LARGE_INTEGER rootLastWriteTime;
+    HRESULT status;
+    UINT32 oldSize;
+
+    TRACE( "rebuilding index of %s\n", debugstr_w( index->Root ) );
+
+    //Taken before the walk, a change racing with it makes the saved index fail validation rather than go unnoticed.
+    if ( !storage_index_GetLastWriteTime( index->Root, &rootLastWriteTime ) ) return HRESULT_FROM_WIN32( GetLastError() );
+
+    status = storage_index_Walk( index, index->Root, &builder );
+    if ( FAILED( status ) )
+    {
+        WARN( "failed to walk %s, status %#lx\n", debugstr_w( index->Root ), status );
+        return status;
+    }
+
+    qsort( builder.entries, builder.size, sizeof(*builder.entries), storage_index_CompareEntries );
+
+    AcquireSRWLockExclusive( &index->lock );
+    oldEntries = index->entries;
+    oldSize = index->size;
+    index->entries = builder.entries;
+    index->size = builder.size;
+    index->capacity = builder.capacity;
+    index->RootLastWriteTime = rootLastWriteTime;
+    index->State = IndexedState_FullyIndexed;
+    index->dirty = TRUE;
+    ReleaseSRWLockExclusive( &index->lock );
+
+    storage_index_FreeEntries( oldEntries, oldSize );
+
+    TRACE( "indexed %u entries under %s\n", builder.size, debugstr_w( index->Root ) );
+    return S_OK;
+}
+
+static VOID storage_index_Merge( struct storage_index *index, LPCWSTR directory )
+{
+    struct storage_index_builder builder;
+    UINT32 iterator;
+
+    if ( FAILED( storage_index_Walk( index, directory, &builder ) ) ) return;
+
+    AcquireSRWLockExclusive( &index->lock );
+    for ( iterator = 0; iterator < builder.size; iterator++ )
+        storage_index_Insert( index, &builder.entries[iterator] );
+    index->dirty = TRUE;
+    ReleaseSRWLockExclusive( &index->lock );
+
+    //The paths are owned by the index now.
+    free( builder.entries );
+}
+
+/**
+ * Persistence
+ */
+static HRESULT storage_index_Save( struct storage_index *index )
+{
+    struct storage_index_header header;
+    struct storage_index_record record;
+    struct storage_index_entry *entry;
+
+    WCHAR tempPath[MAX_PATH];
+    SIZE_T bufferSize;
+    HANDLE file;
+    DWORD written;
+    BYTE *buffer;
+    BYTE *cursor;
+    UINT32 iterator;
+    BOOL success;
+
+    AcquireSRWLockShared( &index->lock );
+
+    bufferSize = sizeof(header) + index->RootLength * sizeof(WCHAR);
+    for ( iterator = 0; iterator < index->size; iterator++ )
+        bufferSize += sizeof(record) + index->entries[iterator].PathLength * sizeof(WCHAR);
+
+    if (!(buffer = malloc( bufferSize )))
+    {
+        ReleaseSRWLockShared( &index->lock );
+        return E_OUTOFMEMORY;
+    }
+
+    header.Magic = INDEX_MAGIC;
+    header.Version = INDEX_VERSION;
+    header.Count = index->size;
+    header.RootLength = index->RootLength;
+    header.RootLastWriteTime = index->RootLastWriteTime.QuadPart;
+
+    cursor = buffer;
+    memcpy( cursor, &header, sizeof(header) );
+    cursor += sizeof(header);
+    memcpy( cursor, index->Root, index->RootLength * sizeof(WCHAR) );
+    cursor += index->RootLength * sizeof(WCHAR);
+
+    for ( iterator = 0; iterator < index->size; iterator++ )
+    {
+        entry = &index->entries[iterator];
+        record.Attributes = entry->Attributes;
+        record.PathLength = entry->PathLength;
+        record.Size = entry->Size;
+        record.CreationTime = entry->CreationTime.QuadPart;
+        record.LastWriteTime = entry->LastWriteTime.QuadPart;
+
+        memcpy( cursor, &record, sizeof(record) );
+        cursor += sizeof(record);
+        memcpy( cursor, entry->Path, entry->PathLength * sizeof(WCHAR) );
+        cursor += entry->PathLength * sizeof(WCHAR);
+    }
+
+    index->dirty = FALSE;
+    ReleaseSRWLockShared( &index->lock );
+
+    //Write a temporary copy first so a crash never leaves a truncated index behind.
+    swprintf( tempPath, ARRAY_SIZE(tempPath), L"%s.tmp", index->FilePath );
+    file = CreateFileW( tempPath, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+    if ( file == INVALID_HANDLE_VALUE )
+    {
+        free( buffer );
+        return HRESULT_FROM_WIN32( GetLastError() );
+    }
+
+    success = WriteFile( file, buffer, bufferSize, &written, NULL ) && written == bufferSize;
+    CloseHandle( file );
+    free( buffer );
+
+    if ( success ) success = MoveFileExW( tempPath, index->FilePath, MOVEFILE_REPLACE_EXISTING );
+    if ( !success )
+    {
+        DeleteFileW( tempPath );
+        return E_FAIL;
+    }
+
+    TRACE( "saved %u entries to %s\n", header.Count, debugstr_w( index->FilePath ) );
+    return S_OK;
+}
+
+/**
+ * A folder's last write time changes whenever an entry is added, removed or renamed in it.
+ * Comparing the root and every indexed folder against the disk catches changes made while
+ * nobody was watching, without walking the tree.
+ */
+static BOOL storage_index_Validate( struct storage_index *index, const struct storage_index_entry *entries, UINT32 count,
+                                    LONGLONG rootLastWriteTime )
+{
+    LARGE_INTEGER lastWriteTime;
+    WCHAR path[MAX_PATH];
+    UINT32 iterator;
+
+    if ( !storage_index_GetLastWriteTime( index->Root, &lastWriteTime ) || lastWriteTime.QuadPart != rootLastWriteTime ) return FALSE;
+
+    for ( iterator = 0; iterator < count; iterator++ )
+    {
+        if ( !(entries[iterator].Attributes & FILE_ATTRIBUTE_DIRECTORY) ) continue;
+        if ( swprintf( path, ARRAY_SIZE(path), L"%s\\%s", index->Root, entries[iterator].Path ) < 0 ) return FALSE;
+        if ( !storage_index_GetLastWriteTime( path, &lastWriteTime ) ) return FALSE;
+        if ( lastWriteTime.QuadPart != entries[iterator].LastWriteTime.QuadPart ) return FALSE;
+    }
+
+    return TRUE;
+}
+
+static HRESULT storage_index_Load( struct storage_index *index )
+{
+    struct storage_index_header header;
+    struct storage_index_record record;
+    struct storage_index_entry *entries;
+
+    LARGE_INTEGER fileSize;
+    HRESULT status = E_FAIL;
+    HANDLE file;
+    DWORD bytesRead;
+    BYTE *buffer;
+    BYTE *cursor;
+    BYTE *end;
+    UINT32 count = 0;
+
+    file = CreateFileW( index->FilePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+    if ( file == INVALID_HANDLE_VALUE ) return HRESULT_FROM_WIN32( GetLastError() );
+
+    if ( !GetFileSizeEx( file, &fileSize ) || fileSize.QuadPart < sizeof(header) || fileSize.QuadPart > MAXDWORD )
+    {
+        CloseHandle( file );
+        return E_FAIL;
+    }
+
+    if (!(buffer = malloc( fileSize.QuadPart )))
+    {
+        CloseHandle( file );
+        return E_OUTOFMEMORY;
+    }
+
+    if ( !ReadFile( file, buffer, fileSize.QuadPart, &bytesRead, NULL ) || bytesRead != fileSize.QuadPart )
+    {
+        CloseHandle( file );
+        free( buffer );
+        return E_FAIL;
+    }
+    CloseHandle( file );
+
+    cursor = buffer;
+    end = buffer + bytesRead;
+    memcpy( &header, cursor, sizeof(header) );
+    cursor += sizeof(header);
+
+    if ( header.Magic != INDEX_MAGIC || header.Version != INDEX_VERSION || header.RootLength != index->RootLength
+      || end - cursor < header.RootLength * sizeof(WCHAR)
+      || storage_index_Compare( (LPCWSTR)cursor, header.RootLength, index->Root, index->RootLength ) )
+        goto done;
+    cursor += header.RootLength * sizeof(WCHAR);
+
+    if (!(entries = calloc( max( header.Count, 1 ), sizeof(*entries) )))
+    {
+        status = E_OUTOFMEMORY;
+        goto done;
+    }
+
+    for ( count = 0; count < header.Count; count++ )
+    {
+        if ( end - cursor < sizeof(record) ) break;
+        memcpy( &record, cursor, sizeof(record) );
+        cursor += sizeof(record);
+
+        if ( (end - cursor) / sizeof(WCHAR) < record.PathLength || !record.PathLength || record.PathLength >= MAX_PATH ) break;
+        if ( !storage_index_FillEntry( &entries[count], (LPCWSTR)cursor, record.PathLength, record.Attributes,
+                                       record.Size, record.CreationTime, record.LastWriteTime ) )
+            break;
+        cursor += record.PathLength * sizeof(WCHAR);
+    }
+
+    if ( count != header.Count )
+    {
+        WARN( "corrupted index %s, ignoring it\n", debugstr_w( index->FilePath ) );
+        storage_index_FreeEntries( entries, count );
+        goto done;
+    }
+
+    if ( !storage_index_Validate( index, entries, count, header.RootLastWriteTime ) )
+    {
+        TRACE( "stale index %s, waiting for the rebuild\n", debugstr_w( index->FilePath ) );
+        storage_index_FreeEntries( entries, count );
+        goto done;
+    }
+
+    index->entries = entries;
+    index->size = index->capacity = count;
+    index->RootLastWriteTime.QuadPart = header.RootLastWriteTime;
+    index->State = IndexedState_FullyIndexed;
+    status = S_OK;
+
+    TRACE( "loaded %u entries from %s\n", count, debugstr_w( index->FilePath ) );
+
+done:
+    free( buffer );
+    return status;
+}
+
+/**
+ * Change tracking
+ */
+static VOID storage_index_ApplyChanges( struct storage_index *index, const BYTE *buffer )
+{
+    const FILE_NOTIFY_INFORMATION *info;
+    struct storage_index_entry entry;
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    LARGE_INTEGER creationTime;
+    LARGE_INTEGER lastWriteTime;
+
+    WCHAR fullPath[MAX_PATH];
+    WCHAR path[MAX_PATH];
+    UINT32 length;
+    BOOL exists;
+
+    for ( info = (const FILE_NOTIFY_INFORMATION *)buffer; ; info = (const FILE_NOTIFY_INFORMATION *)((const BYTE *)info + info->NextEntryOffset) )
+    {
+        length = info->FileNameLength / sizeof(WCHAR);
+        if ( length && length < MAX_PATH - index->RootLength - 1 )
+        {
+            memcpy( path, info->FileName, info->FileNameLength );
+            path[length] = 0;
+            swprintf( fullPath, ARRAY_SIZE(fullPath), L"%s\\%s", index->Root, path );
+            exists = GetFileAttributesExW( fullPath, GetFileExInfoStandard, &data );
+
+            TRACE( "action %lu on %s\n", info->Action, debugstr_w( path ) );
+
+            AcquireSRWLockExclusive( &index->lock );
+            if ( exists && info->Action != FILE_ACTION_REMOVED && info->Action != FILE_ACTION_RENAMED_OLD_NAME )
+            {
+                creationTime.u.LowPart = data.ftCreationTime.dwLowDateTime;
+                creationTime.u.HighPart = data.ftCreationTime.dwHighDateTime;
+                lastWriteTime.u.LowPart = data.ftLastWriteTime.dwLowDateTime;
+                lastWriteTime.u.HighPart = data.ftLastWriteTime.dwHighDateTime;
+
+                if ( storage_index_FillEntry( &entry, path, length, data.dwFileAttributes, ((UINT64)data.nFileSizeHigh << 32) | data.nFileSizeLow,
+                                              creationTime.QuadPart, lastWriteTime.QuadPart ) )
+                    storage_index_Insert( index, &entry );
+            }
+            else
+            {
+                storage_index_RemoveTree( index, path, length );
+            }
+            index->dirty = TRUE;
+            ReleaseSRWLockExclusive( &index->lock );
+
+            //A directory moved into the tree brings its whole content along.
+            if ( exists && (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+              && (info->Action == FILE_ACTION_ADDED || info->Action == FILE_ACTION_RENAMED_NEW_NAME) )
+                storage_index_Merge( index, fullPath );
+        }
+
+        if ( !info->NextEntryOffset ) break;
+    }
+}
+
+static BOOL storage_index_Arm( HANDLE directory, BYTE *buffer, OVERLAPPED *overlapped )
+{
+    return ReadDirectoryChangesW( directory, buffer, INDEX_NOTIFY_BUFFER_SIZE, TRUE,
+                                  FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_ATTRIBUTES |
+                                  FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_CREATION,
+                                  NULL, overlapped, NULL );
+}
+
+static DWORD WINAPI storage_index_Watch( void *param )
+{
+    struct storage_index *index = param;
+    OVERLAPPED overlapped = { 0 };
+    HANDLE events[2];
+    HANDLE directory;
+    BYTE *buffer = NULL;
+    BYTE *changes = NULL;
+    DWORD bytes;
+    DWORD wait;
+    BOOL armed = FALSE;
+
+    directory = CreateFileW( index->Root, FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+                             OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL );
+    overlapped.hEvent = CreateEventW( NULL, TRUE, FALSE, NULL );
+    buffer = malloc( INDEX_NOTIFY_BUFFER_SIZE );
+    changes = malloc( INDEX_NOTIFY_BUFFER_SIZE );
+
+    if ( directory != INVALID_HANDLE_VALUE && overlapped.hEvent && buffer && changes )
+        armed = storage_index_Arm( directory, buffer, &overlapped );
+
+    if ( armed )
+    {
+        //Changes made while the tree is being walked are queued by the armed watch and applied afterwards.
+        if ( SUCCEEDED( storage_index_Refresh( index ) ) ) storage_index_Save( index );
+        else armed = FALSE;
+    }
+
+    events[0] = overlapped.hEvent;
+    events[1] = index->stop;
+
+    while ( armed )
+    {
+        wait = WaitForMultipleObjects( ARRAY_SIZE(events), events, FALSE, INDEX_SAVE_INTERVAL );
+        if ( wait == WAIT_TIMEOUT )
+        {
+            if ( index->dirty ) storage_index_Save( index );
+            continue;
+        }
+        if ( wait == WAIT_OBJECT_0 + 1 )
+        {
+            if ( index->dirty ) storage_index_Save( index );
+            break;
+        }
+        if ( wait != WAIT_OBJECT_0 || !GetOverlappedResult( directory, &overlapped, &bytes, FALSE ) ) break;
+
+        //Re-arm right away and work on a copy, so nothing is missed while the index is updated.
+        memcpy( changes, buffer, bytes );
+        ResetEvent( overlapped.hEvent );
+        armed = storage_index_Arm( directory, buffer, &overlapped );
+
+        //An empty notification means the buffer overflowed, the only safe thing to do is to start over.
+        if ( !bytes ) storage_index_Refresh( index );
+        else storage_index_ApplyChanges( index, changes );
+    }
+
+    //Without change notifications the index would go stale, stop serving queries from it.
+    if ( !ReadNoFence( &index->stopping ) ) WARN( "no longer watching %s, index disabled\n", debugstr_w( index->Root ) );
+    AcquireSRWLockExclusive( &index->lock );
+    index->State = IndexedState_NotIndexed;
+    ReleaseSRWLockExclusive( &index->lock );
+
+    if ( directory != INVALID_HANDLE_VALUE )
+    {
+        CancelIoEx( directory, &overlapped );
+        CloseHandle( directory );
+    }
+    if ( overlapped.hEvent ) CloseHandle( overlapped.hEvent );
+    free( buffer );
+    free( changes );
+    return 0;
+}
+
+static UINT32 storage_index_Hash( LPCWSTR path )
+{
+    UINT32 hash = 0x811c9dc5;
+
+    while ( *path )
+    {
+        hash ^= towupper( *path++ );
+        hash *= 0x01000193;
+    }
+
+    return hash;
+}
+
+/**
+ * Returns a new reference to the index of root if it is already open.
+ */
+static struct storage_index *storage_index_Find( LPCWSTR root )
+{
+    struct storage_index *index;
+
+    AcquireSRWLockShared( &storage_indexes_lock );
+    LIST_FOR_EACH_ENTRY( index, &storage_indexes, struct storage_index, entry )
+    {
+        if ( wcsicmp( index->Root, root ) ) continue;
+        InterlockedIncrement( &index->ref );
+        ReleaseSRWLockShared( &storage_indexes_lock );
+        return index;
+    }
+    ReleaseSRWLockShared( &storage_indexes_lock );
+
+    return NULL;
+}
+
+static VOID storage_index_Free( struct storage_index *index )
+{
+    storage_index_FreeEntries( index->entries, index->size );
+    if ( index->stop ) CloseHandle( index->stop );
+    free( index->Root );
+    free( index );
+}
+
+/**
+ * Returns a reference to the index covering folderPath, or NULL if no indexed root contains it.
+ * Loading and validating a saved index reads the disk, it is done before the index is published
+ * so that other folders' queries are not held up.
+ */
+struct storage_index *WINAPI storage_index_Open( LPCWSTR folderPath )
+{
+    struct storage_index *index;
+    struct storage_index *existing;
+    WCHAR indexDirectory[MAX_PATH];
+    PWSTR localAppData;
+    LPCWSTR root;
+
+    if (!(root = storage_index_FindRoot( folderPath ))) return NULL;
+    if ( (index = storage_index_Find( root )) ) return index;
+
+    if (!(index = calloc( 1, sizeof(*index) ))) return NULL;
+
+    index->ref = 1;
+    index->Root = wcsdup( root );
+    index->RootLength = wcslen( root );
+    index->State = IndexedState_PartiallyIndexed;
+    InitializeSRWLock( &index->lock );
+
+    if ( !index->Root || !(index->stop = CreateEventW( NULL, TRUE, FALSE, NULL )) )
+    {
+        storage_index_Free( index );
+        return NULL;
+    }
+
+    if ( SUCCEEDED( SHGetKnownFolderPath( &FOLDERID_LocalAppData, 0, NULL, &localAppData ) ) )
+    {
+        swprintf( indexDirectory, ARRAY_SIZE(indexDirectory), L"%s\\Microsoft\\Windows\\WineCoreUAP\\Indexes", localAppData );
+        CoTaskMemFree( localAppData );
+        SHCreateDirectoryExW( NULL, indexDirectory, NULL );
+        swprintf( index->FilePath, ARRAY_SIZE(index->FilePath), L"%s\\%08x.idx", indexDirectory, storage_index_Hash( root ) );
+
+        //A previous session's index is served right away, the watcher reconciles it with the disk.
+        if ( FAILED( storage_index_Load( index ) ) )
+            TRACE( "no usable index for %s yet\n", debugstr_w( root ) );
+    }
+
+    AcquireSRWLockExclusive( &storage_indexes_lock );
+    LIST_FOR_EACH_ENTRY( existing, &storage_indexes, struct storage_index, entry )
+    {
+        if ( wcsicmp( existing->Root, root ) ) continue;
+
+        //Another query opened the same root meanwhile, use theirs.
+        InterlockedIncrement( &existing->ref );
+        ReleaseSRWLockExclusive( &storage_indexes_lock );
+        storage_index_Free( index );
+        return existing;
+    }
+    list_add_tail( &storage_indexes, &index->entry );
+    ReleaseSRWLockExclusive( &storage_indexes_lock );
+
+    if ( !(index->watcher = CreateThread( NULL, 0, storage_index_Watch, index, 0, NULL )) )
+    {
+        AcquireSRWLockExclusive( &index->lock );
+        index->State = IndexedState_NotIndexed;
+        ReleaseSRWLockExclusive( &index->lock );
+    }
+
+    return index;
+}
+
+/**
+ * The last release closes the index, its watcher saves pending changes before it exits.
+ */
+VOID WINAPI storage_index_Release( struct storage_index *index )
+{
+    if ( !index ) return;
+
+    //References are only taken under the list lock, an index dropping to zero here can no longer be found.
+    AcquireSRWLockExclusive( &storage_indexes_lock );
+    if ( InterlockedDecrement( &index->ref ) )
+    {
+        ReleaseSRWLockExclusive( &storage_indexes_lock );
+        return;
+    }
+    list_remove( &index->entry );
+    ReleaseSRWLockExclusive( &storage_indexes_lock );
+
+    TRACE( "closing index of %s\n", debugstr_w( index->Root ) );
+
+    if ( index->watcher )
+    {
+        InterlockedExchange( &index->stopping, TRUE );
+        SetEvent( index->stop );
+        WaitForSingleObject( index->watcher, INFINITE );
+        CloseHandle( index->watcher );
+    }
+
+    storage_index_Free( index );
+}
+
+/**
+ * Feeds the entries of folderPath (and of its subfolders for deep queries) to the callback.
+ * Returns S_FALSE when the folder is not covered by a usable index, the caller has to walk the disk then.
+ * The matching entries are copied out first, the callback never runs under the index lock.
+ */
+HRESULT WINAPI storage_index_Query( struct storage_index *index, LPCWSTR folderPath, BOOL deep, storage_enumeration_callback callback, void *context )
+{
+    struct storage_enumeration_entry result;
+    struct storage_index_entry *entries = NULL;
+    struct storage_index_entry *entry;
+
+    HRESULT status = S_OK;
+    WCHAR directory[MAX_PATH];
+    WCHAR prefix[MAX_PATH];
+    UINT32 prefixLength;
+    UINT32 capacity = 0;
+    UINT32 count = 0;
+    UINT32 iterator;
+    LPCWSTR relative;
+
+    TRACE( "index %p, folderPath %s, deep %d\n", index, debugstr_w( folderPath ), deep );
+
+    if ( !index ) return S_FALSE;
+
+    relative = folderPath + index->RootLength;
+    while ( *relative == '\\' ) relative++;
+    prefixLength = wcslen( relative );
+    while ( prefixLength && relative[prefixLength - 1] == '\\' ) prefixLength--;
+    if ( prefixLength + 1 >= MAX_PATH ) return S_FALSE;
+
+    memcpy( prefix, relative, prefixLength * sizeof(WCHAR) );
+    if ( prefixLength ) prefix[prefixLength++] = '\\';
+
+    AcquireSRWLockShared( &index->lock );
+
+    if ( index->State != IndexedState_FullyIndexed )
+    {
+        ReleaseSRWLockShared( &index->lock );
+        return S_FALSE;
+    }
+
+    for ( iterator = storage_index_LowerBound( index, prefix, prefixLength ); iterator < index->size; iterator++ )
+    {
+        entry = &index->entries[iterator];
+        if ( !storage_index_HasPrefix( entry, prefix, prefixLength ) ) break;
+
+        //Shallow queries only want the direct children.
+        if ( !deep && entry->NameOffset != prefixLength ) continue;
+
+        if ( !storage_index_Reserve( &entries, &capacity, count + 1 )
+          || !storage_index_FillEntry( &entries[count], entry->Path, entry->PathLength, entry->Attributes, entry->Size,
+                                       entry->CreationTime.QuadPart, entry->LastWriteTime.QuadPart ) )
+        {
+            status = E_OUTOFMEMORY;
+            break;
+        }
+        count++;
+    }
+
+    ReleaseSRWLockShared( &index->lock );
+
+    memset( &result, 0, sizeof(result) );
+    result.Directory = directory;
+
+    for ( iterator = 0; SUCCEEDED( status ) && iterator < count; iterator++ )
+    {
+        entry = &entries[iterator];
+
+        if ( entry->NameOffset ) swprintf( directory, ARRAY_SIZE(directory), L"%s\\%.*s", index->Root, entry->NameOffset - 1, entry->Path );
+        else wcscpy( directory, index->Root );
+
+        result.Name = entry->Path + entry->NameOffset;
+        result.NameLength = entry->PathLength - entry->NameOffset;
+        result.Attributes = entry->Attributes;
+        result.Size.QuadPart = entry->Size;
+        result.CreationTime = entry->CreationTime;
+        result.LastWriteTime = entry->LastWriteTime;
+
+        status = callback( context, &result );
+    }
+
+    storage_index_FreeEntries( entries, count );
+
+    return FAILED( status ) ? status : S_OK;
+}
+
+/**
+ * Only reports on indexes a query result holds open, asking for the state never starts indexing a folder.
+ */
+IndexedState WINAPI storage_index_GetState( LPCWSTR folderPath )
+{
+    IndexedState state = IndexedState_NotIndexed;
+    struct storage_index *index;
+    LPCWSTR root;
+
+    if (!(root = storage_index_FindRoot( folderPath ))) return state;
+
+    //A listed index is only closed under the exclusive list lock, it stays valid while its state is read.
+    AcquireSRWLockShared( &storage_indexes_lock );
+    LIST_FOR_EACH_ENTRY( index, &storage_indexes, struct storage_index, entry )
+    {
+        if ( wcsicmp( index->Root, root ) ) continue;
+        AcquireSRWLockShared( &index->lock );
+        state = index->State;
+        ReleaseSRWLockShared( &index->lock );
+        break;
+    }
+    ReleaseSRWLockShared( &storage_indexes_lock );
+
+    return state;
+}
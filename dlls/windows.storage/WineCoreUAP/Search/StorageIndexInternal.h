@@ -0,0 +1,103 @@
+/* WinRT Windows.Storage.Search Persistent Query Index
+ *
+ * Written by Weather
+ *
+ * This is a reverse engineered implementation of Microsoft's OneCoreUAP binaries.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef STORAGE_INDEX_INTERNAL_H
+#define STORAGE_INDEX_INTERNAL_H
+
+#include "../../private.h"
+#include "wine/debug.h"
+#include "wine/list.h"
+
+#include "StorageEnumerationInternal.h"
+
+#define INDEX_MAGIC 0x58444955 /* UIDX */
+#define INDEX_VERSION 3
+//How often a changed index is written back to disk.
+#define INDEX_SAVE_INTERVAL 30000
+#define INDEX_NOTIFY_BUFFER_SIZE 0x10000
+
+/**
+ * Developer notes: The index mirrors the folders the application is most likely to query,
+ * the known libraries. Paths are stored relative to the indexed root and kept sorted
+ * (ordinal, case insensitive) so that every folder is a contiguous range.
+ * An index is opened by the query results of a folder it covers and watched as long as one of them holds it.
+ */
+struct storage_index_entry
+{
+    LPWSTR Path;
+    UINT32 PathLength;
+    UINT32 NameOffset;
+    DWORD Attributes;
+    UINT64 Size;
+    LARGE_INTEGER CreationTime;
+    LARGE_INTEGER LastWriteTime;
+};
+
+struct storage_index
+{
+    struct list entry;
+    LONG ref;
+    LPWSTR Root;
+    UINT32 RootLength;
+    WCHAR FilePath[MAX_PATH];
+
+    SRWLOCK lock;
+    struct storage_index_entry *entries;
+    UINT32 size;
+    UINT32 capacity;
+    IndexedState State;
+    BOOL dirty;
+    //Last write time of the root when it was walked, a saved index is only trusted if it still matches.
+    LARGE_INTEGER RootLastWriteTime;
+
+    HANDLE watcher;
+    //Set by the last release, the watcher saves the index and exits and a rebuild in progress is dropped.
+    HANDLE stop;
+    LONG stopping;
+};
+
+/**
+ * On disk layout: header, root path, then one record per entry followed by its path.
+ */
+struct storage_index_header
+{
+    DWORD Magic;
+    DWORD Version;
+    UINT32 Count;
+    UINT32 RootLength;
+    LONGLONG RootLastWriteTime;
+};
+
+struct storage_index_record
+{
+    DWORD Attributes;
+    UINT32 PathLength;
+    UINT64 Size;
+    LONGLONG CreationTime;
+    LONGLONG LastWriteTime;
+};
+
+struct storage_index *WINAPI storage_index_Open( LPCWSTR folderPath );
+VOID WINAPI storage_index_Release( struct storage_index *index );
+HRESULT WINAPI storage_index_Query( struct storage_index *index, LPCWSTR folderPath, BOOL deep, storage_enumeration_callback callback, void *context );
+IndexedState WINAPI storage_index_GetState( LPCWSTR folderPath );
+
+#endif
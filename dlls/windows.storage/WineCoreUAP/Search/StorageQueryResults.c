@@ -66,7 +66,13 @@ static ULONG WINAPI query_result_base_Release( IStorageQueryResultBase *iface )
 
     TRACE( "iface %p decreasing refcount to %lu.\n", iface, ref );
 
-    if (!ref) free( impl );
+    if (!ref)
+    {
+        query_result_search_Release( impl->Search );
+        query_result_cursor_Release( impl->Cursor );
+        storage_index_Release( impl->Index );
+        free( impl );
+    }
     return ref;
 }
 
@@ -185,6 +191,9 @@ static HRESULT WINAPI query_result_base_ApplyNewQueryOptions( IStorageQueryResul
     TRACE( "iface %p, newQueryOptions %p\n", iface, newQueryOptions );
     impl->Options = newQueryOptions;
 
+    //Results of the previous options are stale now.
+    query_result_base_ResetSearch( iface );
+
     for ( eventIterator = 0; eventIterator < impl->handlerSize; eventIterator++ )
     {
         if ( impl->optionsChangedEventHandlers[eventIterator]->isStillAvailable )
@@ -263,7 +272,13 @@ static ULONG WINAPI folder_query_result_Release( IStorageFolderQueryResult *ifac
 
     TRACE( "iface %p decreasing refcount to %lu.\n", iface, ref );
 
-    if (!ref) free( impl );
+    if (!ref)
+    {
+        query_result_search_Release( impl->Search );
+        query_result_cursor_Release( impl->Cursor );
+        storage_index_Release( impl->Index );
+        free( impl );
+    }
     return ref;
 }
 
@@ -377,7 +392,13 @@ static ULONG WINAPI file_query_result_Release( IStorageFileQueryResult *iface )
 
     TRACE( "iface %p decreasing refcount to %lu.\n", iface, ref );
 
-    if (!ref) free( impl );
+    if (!ref)
+    {
+        query_result_search_Release( impl->Search );
+        query_result_cursor_Release( impl->Cursor );
+        storage_index_Release( impl->Index );
+        free( impl );
+    }
     return ref;
 }
 
@@ -491,7 +512,13 @@ static ULONG WINAPI item_query_result_Release( IStorageItemQueryResult *iface )
 
     TRACE( "iface %p decreasing refcount to %lu.\n", iface, ref );
 
-    if (!ref) free( impl );
+    if (!ref)
+    {
+        query_result_search_Release( impl->Search );
+        query_result_cursor_Release( impl->Cursor );
+        storage_index_Release( impl->Index );
+        free( impl );
+    }
     return ref;
 }
 
@@ -25,114 +25,792 @@ _ENABLE_DEBUGGING_
 
 DEFINE_ASYNC_COMPLETED_HANDLER( storage_item_vector_view, IAsyncOperationCompletedHandler_IVectorView_IStorageItem, IAsyncOperation_IVectorView_IStorageItem );
 
-HRESULT WINAPI query_result_base_ConductSearch( IStorageQueryResultBase *iface, IVector_IStorageItem **items )
+static SRWLOCK query_result_search_lock = SRWLOCK_INIT;
+
+struct query_result_window
 {
-    struct query_result_base *impl = impl_from_IStorageQueryResultBase( iface );
-    struct storage_file *file;
-    struct storage_folder *queryFolder;
+    struct query_result_filter *filter;
+    struct query_result_matches matches;
+};
 
-    IQueryOptions *options = impl->Options;
-    IStorageFolder *folder = impl->Folder;
-    IStorageItem *queryItem = NULL;
-    FolderDepth depth;
+struct query_result_count
+{
+    struct query_result_filter *filter;
+    LONG count;
+};
 
+static HRESULT query_result_filter_Init( struct query_result_base *impl, struct query_result_filter *filter )
+{
+    IVector_HSTRING *fileTypes = NULL;
+    IQueryOptions *options = impl->Options;
     HRESULT status = S_OK;
-    HSTRING folderPath;
-    HSTRING filePath;
-    HSTRING ApplicationFilter;
-    HSTRING UserFilter;
-    WIN32_FIND_DATAW findFileData;
-    HANDLE hFind;
-    WCHAR searchPath[MAX_PATH];
-    WCHAR fullPath[MAX_PATH];
+    UINT32 iterator;
+
+    filter->searchType = impl->searchType;
+    filter->depth = FolderDepth_Shallow;
+    filter->indexerOption = IndexerOption_DoNotUseIndexer;
+
+    if ( options )
+    {
+        IQueryOptions_get_FolderDepth( options, &filter->depth );
+        IQueryOptions_get_IndexerOption( options, &filter->indexerOption );
+        IQueryOptions_get_ApplicationSearchFilter( options, &filter->ApplicationFilter );
+        IQueryOptions_get_UserSearchFilter( options, &filter->UserFilter );
+        IQueryOptions_get_FileTypeFilter( options, &fileTypes );
+    }
+
+    if ( fileTypes && SUCCEEDED( IVector_HSTRING_get_Size( fileTypes, &filter->fileTypeCount ) ) && filter->fileTypeCount )
+    {
+        if (!(filter->FileTypes = calloc( filter->fileTypeCount, sizeof(*filter->FileTypes) ))) return E_OUTOFMEMORY;
+        for ( iterator = 0; SUCCEEDED( status ) && iterator < filter->fileTypeCount; iterator++ )
+            status = IVector_HSTRING_GetAt( fileTypes, iterator, &filter->FileTypes[iterator] );
+    }
+    else
+    {
+        filter->fileTypeCount = 0;
+    }
+
+    return status;
+}
+
+static VOID query_result_filter_Clear( struct query_result_filter *filter )
+{
+    UINT32 iterator;
+
+    for ( iterator = 0; filter->FileTypes && iterator < filter->fileTypeCount; iterator++ )
+        WindowsDeleteString( filter->FileTypes[iterator] );
+    free( filter->FileTypes );
+    WindowsDeleteString( filter->ApplicationFilter );
+    WindowsDeleteString( filter->UserFilter );
+}
+
+static BOOL query_result_filter_MatchesFileType( struct query_result_filter *filter, const struct storage_enumeration_entry *entry )
+{
+    LPCWSTR extension;
+    LPCWSTR fileType;
+    UINT32 iterator;
+
+    if ( !filter->fileTypeCount ) return TRUE;
+    extension = wcsrchr( entry->Name, '.' );
+
+    for ( iterator = 0; iterator < filter->fileTypeCount; iterator++ )
+    {
+        fileType = WindowsGetStringRawBuffer( filter->FileTypes[iterator], NULL );
+        if ( !wcscmp( fileType, L"*" ) ) return TRUE;
+        if ( extension && !wcsicmp( fileType, extension ) ) return TRUE;
+    }
+
+    return FALSE;
+}
+
+static BOOL query_result_filter_Matches( struct query_result_filter *filter, const struct storage_enumeration_entry *entry )
+{
+    BOOL isFolder = !!(entry->Attributes & FILE_ATTRIBUTE_DIRECTORY);
+
+    if ( isFolder && filter->searchType == StorageItemTypes_File ) return FALSE;
+    if ( !isFolder && filter->searchType == StorageItemTypes_Folder ) return FALSE;
+    if ( !isFolder && !query_result_filter_MatchesFileType( filter, entry ) ) return FALSE;
+
+    //AQS is not supported yet.
+    return wcsstr( entry->Name, WindowsGetStringRawBuffer( filter->ApplicationFilter, NULL ) )
+        && wcsstr( entry->Name, WindowsGetStringRawBuffer( filter->UserFilter, NULL ) );
+}
+
+/**
+ * Returns S_FALSE when the item vanished between the directory read and the open.
+ */
+static HRESULT query_result_CreateItem( const struct storage_enumeration_entry *entry, IStorageItem **item )
+{
+    struct storage_folder *folder;
+    struct storage_file *file;
+
+    HRESULT status;
+    HSTRING itemPath;
+    UINT32 directoryLength = wcslen( entry->Directory );
+    UINT32 pathLength = directoryLength + 1 + entry->NameLength;
+    LPWSTR fullPath;
+
+    //Deep walks go past MAX_PATH, the path is sized to fit.
+    if (!(fullPath = malloc( pathLength * sizeof(WCHAR) ))) return E_OUTOFMEMORY;
+    memcpy( fullPath, entry->Directory, directoryLength * sizeof(WCHAR) );
+    fullPath[directoryLength] = '\\';
+    memcpy( fullPath + directoryLength + 1, entry->Name, entry->NameLength * sizeof(WCHAR) );
+    status = WindowsCreateString( fullPath, pathLength, &itemPath );
+    free( fullPath );
+    if ( FAILED( status ) ) return status;
+
+    //Creating the item and its BasicProperties can then skip opening the file.
+    basic_properties_cache_Add( entry );
+
+    if ( entry->Attributes & FILE_ATTRIBUTE_DIRECTORY )
+    {
+        if (!(folder = calloc( 1, sizeof(*folder) ))) status = E_OUTOFMEMORY;
+        else status = storage_folder_AssignFolder( itemPath, &folder->IStorageFolder_iface );
+        if ( SUCCEEDED( status ) ) *item = &folder->IStorageItem_iface;
+        else free( folder );
+    }
+    else
+    {
+        if (!(file = calloc( 1, sizeof(*file) ))) status = E_OUTOFMEMORY;
+        else status = storage_file_AssignFile( itemPath, &file->IStorageFile_iface );
+        if ( SUCCEEDED( status ) ) *item = &file->IStorageItem_iface;
+        else free( file );
+    }
+    WindowsDeleteString( itemPath );
+
+    if ( status == E_OUTOFMEMORY ) return status;
+    return FAILED( status ) ? S_FALSE : S_OK;
+}
+
+static HRESULT query_result_match_Init( struct query_result_match *match, const struct storage_enumeration_entry *entry )
+{
+    UINT32 directoryLength = wcslen( entry->Directory );
+    UINT32 pathLength = directoryLength + 1 + entry->NameLength;
+    LPWSTR buffer;
+
+    if (!(buffer = malloc( (pathLength + directoryLength + 2) * sizeof(WCHAR) ))) return E_OUTOFMEMORY;
+
+    memcpy( buffer, entry->Directory, directoryLength * sizeof(WCHAR) );
+    buffer[directoryLength] = '\\';
+    memcpy( buffer + directoryLength + 1, entry->Name, entry->NameLength * sizeof(WCHAR) );
+    buffer[pathLength] = 0;
+    memcpy( buffer + pathLength + 1, entry->Directory, (directoryLength + 1) * sizeof(WCHAR) );
+
+    match->Path = buffer;
+    match->Entry = *entry;
+    match->Entry.Directory = buffer + pathLength + 1;
+    match->Entry.Name = buffer + directoryLength + 1;
+    match->Item = NULL;
+    return S_OK;
+}
+
+static HRESULT query_result_matches_Add( struct query_result_matches *matches, struct query_result_match *match )
+{
+    struct query_result_match *tmp;
+    SIZE_T capacity;
+
+    if ( matches->count == matches->capacity )
+    {
+        capacity = max( matches->capacity * 2, 64 );
+        if (!(tmp = realloc( matches->elements, capacity * sizeof(*tmp) ))) return E_OUTOFMEMORY;
+        matches->elements = tmp;
+        matches->capacity = capacity;
+    }
+
+    matches->elements[matches->count++] = *match;
+    return S_OK;
+}
+
+static int __cdecl query_result_CompareMatches( const void *a, const void *b )
+{
+    const struct query_result_match *match1 = a, *match2 = b;
+    return storage_enumeration_ComparePaths( match1->Path, match2->Path );
+}
+
+/**
+ * Every window is cut out of this order, whether it comes from the cursor, the index or a full search.
+ */
+static VOID query_result_matches_Sort( struct query_result_matches *matches )
+{
+    qsort( matches->elements, matches->count, sizeof(*matches->elements), query_result_CompareMatches );
+}
+
+static VOID query_result_matches_Clear( struct query_result_matches *matches )
+{
+    SIZE_T iterator;
+
+    for ( iterator = 0; iterator < matches->count; iterator++ )
+    {
+        if ( matches->elements[iterator].Item ) IStorageItem_Release( matches->elements[iterator].Item );
+        free( matches->elements[iterator].Path );
+    }
+    free( matches->elements );
+    memset( matches, 0, sizeof(*matches) );
+}
+
+static HRESULT WINAPI query_result_search_AddEntry( void *context, const struct storage_enumeration_entry *entry )
+{
+    struct query_result_search *search = context;
+    struct query_result_match match;
+    HRESULT status;
+
+    if ( !query_result_filter_Matches( &search->filter, entry ) ) return S_FALSE;
+
+    status = query_result_match_Init( &match, entry );
+    if ( FAILED( status ) ) return status;
+
+    //Items are built outside of the lock, several workers may be doing this at once.
+    status = query_result_CreateItem( entry, &match.Item );
+    if ( status != S_OK )
+    {
+        free( match.Path );
+        return status;
+    }
+
+    EnterCriticalSection( &search->cs );
+    status = query_result_matches_Add( &search->matches, &match );
+    LeaveCriticalSection( &search->cs );
+
+    if ( FAILED( status ) )
+    {
+        IStorageItem_Release( match.Item );
+        free( match.Path );
+        return status;
+    }
+    return S_OK;
+}
+
+static HRESULT WINAPI query_result_window_AddEntry( void *context, const struct storage_enumeration_entry *entry )
+{
+    struct query_result_window *window = context;
+    struct query_result_match match;
+    HRESULT status;
+
+    if ( !query_result_filter_Matches( window->filter, entry ) ) return S_FALSE;
+
+    //The index hands out entries in its own order, the page can only be cut once they are sorted.
+    status = query_result_match_Init( &match, entry );
+    if ( FAILED( status ) ) return status;
+
+    status = query_result_matches_Add( &window->matches, &match );
+    if ( FAILED( status ) ) free( match.Path );
+    return status;
+}
+
+static HRESULT WINAPI query_result_count_AddEntry( void *context, const struct storage_enumeration_entry *entry )
+{
+    struct query_result_count *count = context;
+
+    if ( !query_result_filter_Matches( count->filter, entry ) ) return S_FALSE;
+    InterlockedIncrement( &count->count );
+    return S_OK;
+}
+
+/**
+ * Opens the index of the queried folder on first use, the query result keeps it until it goes away.
+ * Returns NULL if the folder is not covered by an index.
+ */
+static struct storage_index *query_result_base_GetIndex( struct query_result_base *impl )
+{
+    HSTRING folderPath = impl_from_IStorageFolder( impl->Folder )->Path;
+    struct storage_index *index;
+
+    AcquireSRWLockShared( &query_result_search_lock );
+    index = impl->Index;
+    ReleaseSRWLockShared( &query_result_search_lock );
+    if ( index ) return index;
+
+    if (!(index = storage_index_Open( WindowsGetStringRawBuffer( folderPath, NULL ) ))) return NULL;
+
+    AcquireSRWLockExclusive( &query_result_search_lock );
+    if ( !impl->Index )
+    {
+        impl->Index = index;
+        index = NULL;
+    }
+    ReleaseSRWLockExclusive( &query_result_search_lock );
+
+    //Another fetch opened it meanwhile, ours is just a second reference to the same index.
+    storage_index_Release( index );
+    return impl->Index;
+}
+
+static HRESULT query_result_search_Create( struct query_result_base *impl, struct query_result_search **out )
+{
+    struct query_result_search *search;
+    HSTRING folderPath = impl_from_IStorageFolder( impl->Folder )->Path;
+    HRESULT status;
 
     //non-runtime class require redefinition
     #undef IStorageItem
     DEFINE_VECTOR_IIDS( IStorageItem )
     #define IStorageItem __x_ABI_CWindows_CStorage_CIStorageItem
 
-    if (!(file = calloc( 1, sizeof(*file) ))) return E_OUTOFMEMORY;
-    if (!(queryFolder = calloc( 1, sizeof(*queryFolder) ))) return E_OUTOFMEMORY;
+    if (!(search = calloc( 1, sizeof(*search) ))) return E_OUTOFMEMORY;
+
+    search->ref = 1;
+    InitializeCriticalSectionEx( &search->cs, 0, RTL_CRITICAL_SECTION_FLAG_FORCE_DEBUG_INFO );
+    search->cs.DebugInfo->Spare[0] = (DWORD_PTR)( __FILE__ ": query_result_search.cs" );
+
+    status = query_result_filter_Init( impl, &search->filter );
+    if ( SUCCEEDED( status ) )
+        status = vector_create( &IStorageItem_iids, (void **)&search->items );
+
+    //Folders covered by the index are answered from memory, everything else is walked.
+    if ( SUCCEEDED( status ) && search->filter.indexerOption != IndexerOption_DoNotUseIndexer )
+    {
+        status = storage_index_Query( query_result_base_GetIndex( impl ), WindowsGetStringRawBuffer( folderPath, NULL ),
+                                      search->filter.depth == FolderDepth_Deep, query_result_search_AddEntry, search );
+        if ( status == S_OK )
+        {
+            *out = search;
+            return S_OK;
+        }
+        if ( status == S_FALSE ) status = S_OK;
+    }
+
+    if ( SUCCEEDED( status ) )
+        status = storage_enumeration_Create( folderPath, search->filter.depth == FolderDepth_Deep,
+                                             query_result_search_AddEntry, search, &search->enumeration );
+    if ( SUCCEEDED( status ) )
+        status = storage_enumeration_Start( search->enumeration );
+
+    if ( FAILED( status ) )
+    {
+        query_result_search_Release( search );
+        return status;
+    }
+
+    *out = search;
+    return S_OK;
+}
+
+static HRESULT query_result_base_BeginSearch( IStorageQueryResultBase *iface, struct query_result_search **out )
+{
+    struct query_result_base *impl = impl_from_IStorageQueryResultBase( iface );
+    struct query_result_search *search;
+    struct query_result_search *published;
+
+    HRESULT status;
+
+    AcquireSRWLockShared( &query_result_search_lock );
+    if ( (search = impl->Search) ) InterlockedIncrement( &search->ref );
+    ReleaseSRWLockShared( &query_result_search_lock );
+
+    if ( search )
+    {
+        *out = search;
+        return S_OK;
+    }
 
-    status = vector_create( &IStorageItem_iids, (void **)items );
+    //Answering from the index runs the callbacks synchronously, so the search is built outside of the lock.
+    status = query_result_search_Create( impl, &search );
     if ( FAILED( status ) ) return status;
 
-    IQueryOptions_get_FolderDepth( options, &depth );
-    IQueryOptions_get_ApplicationSearchFilter( options, &ApplicationFilter );
-    IQueryOptions_get_UserSearchFilter( options, &UserFilter );
+    AcquireSRWLockExclusive( &query_result_search_lock );
+    if ( (published = impl->Search) )
+    {
+        //Somebody else won the race, use theirs.
+        InterlockedIncrement( &published->ref );
+    }
+    else
+    {
+        //One reference for the query result, one for the caller.
+        search->ref++;
+        impl->Search = search;
+    }
+    ReleaseSRWLockExclusive( &query_result_search_lock );
+
+    if ( published )
+    {
+        query_result_search_Release( search );
+        search = published;
+    }
+
+    *out = search;
+    return S_OK;
+}
+
+VOID WINAPI query_result_search_Release( struct query_result_search *search )
+{
+    if ( !search || InterlockedDecrement( &search->ref ) ) return;
 
-    swprintf( searchPath, sizeof(searchPath), L"%s\\*.*", WindowsGetStringRawBuffer( impl_from_IStorageFolder( folder )->Path, NULL ) );
-    hFind = FindFirstFileW( searchPath, &findFileData );
+    if ( search->enumeration )
+    {
+        //The workers reference the search as their context, let them drain first.
+        storage_enumeration_Cancel( search->enumeration );
+        storage_enumeration_Wait( search->enumeration );
+        storage_enumeration_Release( search->enumeration );
+    }
+    if ( search->items ) IVector_IStorageItem_Release( search->items );
+    query_result_matches_Clear( &search->matches );
+    query_result_filter_Clear( &search->filter );
+    search->cs.DebugInfo->Spare[0] = 0;
+    DeleteCriticalSection( &search->cs );
+    free( search );
+}
 
-    if (hFind == INVALID_HANDLE_VALUE) 
+static HRESULT query_result_base_GetCursor( IStorageQueryResultBase *iface, struct query_result_cursor **out )
+{
+    struct query_result_base *impl = impl_from_IStorageQueryResultBase( iface );
+    struct query_result_cursor *cursor;
+    HRESULT status;
+
+    AcquireSRWLockExclusive( &query_result_search_lock );
+
+    if ( (cursor = impl->Cursor) )
     {
-        return E_ABORT;
+        InterlockedIncrement( &cursor->ref );
+        ReleaseSRWLockExclusive( &query_result_search_lock );
+        *out = cursor;
+        return S_OK;
     }
 
-    while ( FindNextFileW( hFind, &findFileData ) != 0 )
+    //The walk itself is only opened by the first page.
+    if (!(cursor = calloc( 1, sizeof(*cursor) )))
     {
-        if ( wcscmp( findFileData.cFileName, L"." ) != 0 && wcscmp( findFileData.cFileName, L".." ) != 0 ) 
+        ReleaseSRWLockExclusive( &query_result_search_lock );
+        return E_OUTOFMEMORY;
+    }
+
+    cursor->ref = 2;
+    InitializeCriticalSectionEx( &cursor->cs, 0, RTL_CRITICAL_SECTION_FLAG_FORCE_DEBUG_INFO );
+    cursor->cs.DebugInfo->Spare[0] = (DWORD_PTR)( __FILE__ ": query_result_cursor.cs" );
+
+    status = query_result_filter_Init( impl, &cursor->filter );
+    if ( FAILED( status ) )
+    {
+        ReleaseSRWLockExclusive( &query_result_search_lock );
+        cursor->ref = 1;
+        query_result_cursor_Release( cursor );
+        return status;
+    }
+
+    impl->Cursor = cursor;
+    ReleaseSRWLockExclusive( &query_result_search_lock );
+
+    *out = cursor;
+    return S_OK;
+}
+
+VOID WINAPI query_result_cursor_Release( struct query_result_cursor *cursor )
+{
+    if ( !cursor || InterlockedDecrement( &cursor->ref ) ) return;
+
+    storage_enumeration_cursor_Release( cursor->cursor );
+    query_result_matches_Clear( &cursor->matches );
+    query_result_filter_Clear( &cursor->filter );
+    cursor->cs.DebugInfo->Spare[0] = 0;
+    DeleteCriticalSection( &cursor->cs );
+    free( cursor );
+}
+
+VOID WINAPI query_result_base_ResetSearch( IStorageQueryResultBase *iface )
+{
+    struct query_result_base *impl = impl_from_IStorageQueryResultBase( iface );
+    struct query_result_search *search;
+    struct query_result_cursor *cursor;
+
+    AcquireSRWLockExclusive( &query_result_search_lock );
+    search = impl->Search;
+    cursor = impl->Cursor;
+    impl->Search = NULL;
+    impl->Cursor = NULL;
+    ReleaseSRWLockExclusive( &query_result_search_lock );
+
+    query_result_search_Release( search );
+    query_result_cursor_Release( cursor );
+}
+
+/**
+ * Waits for the walk to be over and publishes the matches to items, sorted by path.
+ */
+static HRESULT query_result_search_Finish( struct query_result_search *search )
+{
+    HRESULT status = S_OK;
+    SIZE_T iterator;
+
+    //Index answered searches are complete from the start.
+    if ( search->enumeration ) status = storage_enumeration_Wait( search->enumeration );
+    if ( FAILED( status ) ) return status;
+
+    EnterCriticalSection( &search->cs );
+
+    if ( !search->sorted )
+    {
+        //The workers finish folders in any order, so a window can only be cut once everything is in.
+        query_result_matches_Sort( &search->matches );
+        for ( iterator = 0; SUCCEEDED( status ) && iterator < search->matches.count; iterator++ )
+            status = IVector_IStorageItem_Append( search->items, search->matches.elements[iterator].Item );
+
+        if ( SUCCEEDED( status ) )
         {
-            swprintf( fullPath, sizeof(fullPath), L"%s\\%s", WindowsGetStringRawBuffer( impl_from_IStorageFolder( folder )->Path, NULL), findFileData.cFileName );
-            if ( findFileData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY ) 
-            {                    
-                WindowsCreateString( fullPath, wcslen( fullPath ), &folderPath );
-                status = storage_folder_AssignFolder( folderPath, &queryFolder->IStorageFolder_iface );
-                if ( FAILED( status ) ) return status;
-
-                if ( impl->searchType == StorageItemTypes_Folder || impl->searchType == StorageItemTypes_None )
-                {
-                    //AQS is not supported yet.
-                    if ( wcsstr( WindowsGetStringRawBuffer( impl_from_IStorageFolder( &queryFolder->IStorageFolder_iface )->Name, NULL), WindowsGetStringRawBuffer( ApplicationFilter, NULL ) ) 
-                         && wcsstr( WindowsGetStringRawBuffer( impl_from_IStorageFolder( &queryFolder->IStorageFolder_iface )->Name, NULL), WindowsGetStringRawBuffer( UserFilter, NULL ) ) )
-                    {
-                        status = IStorageFolder_QueryInterface( &queryFolder->IStorageFolder_iface, &IID_IStorageItem, (void **)&queryItem );
-                        if ( FAILED( status ) ) return status;
-                        status = IVector_IStorageItem_Append( *items, queryItem );
-                        if ( FAILED( status ) ) return status;
-                    }
-                }
-                if ( depth == FolderDepth_Deep )
-                    query_result_base_ConductSearch( iface, items );
-            } 
-            else 
-            {
-                WindowsCreateString( fullPath, wcslen( fullPath ), &filePath );
-                status = storage_file_AssignFile( filePath, &file->IStorageFile_iface );
-                if ( FAILED( status ) ) return status;
-
-                if ( impl->searchType == StorageItemTypes_File || impl->searchType == StorageItemTypes_None )
-                {                
-                    //AQS is not supported yet.
-                    if ( wcsstr( WindowsGetStringRawBuffer( impl_from_IStorageFile( &file->IStorageFile_iface )->Name, NULL), WindowsGetStringRawBuffer( ApplicationFilter, NULL ) ) 
-                         && wcsstr( WindowsGetStringRawBuffer( impl_from_IStorageFile( &file->IStorageFile_iface )->Name, NULL), WindowsGetStringRawBuffer( UserFilter, NULL ) ) )
-                    {
-                        status = IStorageFile_QueryInterface( &file->IStorageFile_iface, &IID_IStorageItem, (void **)&queryItem );
-                        if ( FAILED( status ) ) return status;
-                        status = IVector_IStorageItem_Append( *items, queryItem );
-                        if ( FAILED( status ) ) return status;
-                    }
-                }
-            }
+            query_result_matches_Clear( &search->matches );
+            search->sorted = TRUE;
         }
+        else IVector_IStorageItem_Clear( search->items );
     }
-    FindClose( hFind );
 
+    LeaveCriticalSection( &search->cs );
     return status;
 }
 
-HRESULT WINAPI query_result_base_SearchCountAsync( IUnknown *invoker, IUnknown *param, PROPVARIANT *result )
-{    
-    IVector_IStorageItem *items;
+static HRESULT query_result_base_WaitForItems( IStorageQueryResultBase *iface, struct query_result_search **out )
+{
+    struct query_result_search *search;
+    HRESULT status;
 
-    HRESULT status = S_OK;
+    status = query_result_base_BeginSearch( iface, &search );
+    if ( FAILED( status ) ) return status;
+
+    status = query_result_search_Finish( search );
+    if ( FAILED( status ) )
+    {
+        query_result_search_Release( search );
+        return status;
+    }
+
+    *out = search;
+    return S_OK;
+}
+
+HRESULT WINAPI query_result_base_ConductSearch( IStorageQueryResultBase *iface, IVector_IStorageItem **items )
+{
+    struct query_result_search *search;
+    HRESULT status;
+
+    status = query_result_base_WaitForItems( iface, &search );
+    if ( FAILED( status ) ) return status;
+
+    //The walk is over, nobody appends to the vector anymore.
+    IVector_IStorageItem_AddRef( (*items = search->items) );
+    query_result_search_Release( search );
+
+    return status;
+}
+
+/**
+ * Copies a window out of the shared search once it is complete.
+ */
+static HRESULT query_result_base_FetchFromSearch( IStorageQueryResultBase *iface, UINT32 startIndex, UINT32 maxNumberOfItems, IVector_IStorageItem *items )
+{
+    struct query_result_search *search;
+    IStorageItem *currentItem;
+
+    HRESULT status;
+    UINT32 iterator;
     UINT32 size;
 
-    status = query_result_base_ConductSearch( (IStorageQueryResultBase *)invoker, &items );
+    status = query_result_base_WaitForItems( iface, &search );
+    if ( FAILED( status ) ) return status;
+
+    EnterCriticalSection( &search->cs );
+
+    IVector_IStorageItem_get_Size( search->items, &size );
+
+    if ( startIndex >= size ) status = E_BOUNDS;
+
+    for ( iterator = startIndex; SUCCEEDED( status ) && iterator < size && iterator - startIndex < maxNumberOfItems; iterator++ )
+    {
+        IVector_IStorageItem_GetAt( search->items, iterator, &currentItem );
+        status = IVector_IStorageItem_Append( items, currentItem );
+        IStorageItem_Release( currentItem );
+    }
+
+    LeaveCriticalSection( &search->cs );
+    query_result_search_Release( search );
+
+    return status;
+}
+
+/**
+ * Materializes the window by resuming the paged walk.
+ * Paging backwards restarts the walk, paging forwards only skips the entries in between.
+ * The cursor walks in the same path order the full search is sorted in, so windows can
+ * be served by either without items being repeated or skipped.
+ */
+static HRESULT query_result_base_FetchFromCursor( IStorageQueryResultBase *iface, UINT32 startIndex, UINT32 maxNumberOfItems, IVector_IStorageItem *items )
+{
+    struct query_result_base *impl = impl_from_IStorageQueryResultBase( iface );
+    struct storage_enumeration_entry entry;
+    struct query_result_cursor *cursor;
+    struct query_result_window window;
+    IStorageItem *item;
+
+    HSTRING folderPath = impl_from_IStorageFolder( impl->Folder )->Path;
+    HRESULT status;
+    UINT32 remaining;
+    SIZE_T iterator;
+
+    status = query_result_base_GetCursor( iface, &cursor );
+    if ( FAILED( status ) ) return status;
+
+    EnterCriticalSection( &cursor->cs );
+
+    //Index covered folders are scanned in memory once, a walk that already started keeps going.
+    if ( !cursor->indexed && !cursor->cursor && cursor->filter.indexerOption != IndexerOption_DoNotUseIndexer )
+    {
+        memset( &window, 0, sizeof(window) );
+        window.filter = &cursor->filter;
+
+        status = storage_index_Query( query_result_base_GetIndex( impl ), WindowsGetStringRawBuffer( folderPath, NULL ),
+                                      cursor->filter.depth == FolderDepth_Deep, query_result_window_AddEntry, &window );
+        if ( status == S_OK )
+        {
+            //The index is already in path order but for names only differing in case.
+            query_result_matches_Sort( &window.matches );
+            cursor->matches = window.matches;
+            cursor->indexed = TRUE;
+        }
+        else
+        {
+            query_result_matches_Clear( &window.matches );
+            if ( FAILED( status ) ) goto done;
+        }
+    }
+
+    if ( cursor->indexed )
+    {
+        status = S_OK;
+        for ( iterator = startIndex, remaining = maxNumberOfItems; iterator < cursor->matches.count && remaining; iterator++ )
+        {
+            status = query_result_CreateItem( &cursor->matches.elements[iterator].Entry, &item );
+            if ( FAILED( status ) ) break;
+            if ( status == S_FALSE ) continue;
+
+            status = IVector_IStorageItem_Append( items, item );
+            IStorageItem_Release( item );
+            if ( FAILED( status ) ) break;
+            remaining--;
+        }
+        if ( SUCCEEDED( status ) ) status = remaining == maxNumberOfItems ? E_BOUNDS : S_OK;
+        goto done;
+    }
+
+    if ( cursor->cursor && startIndex < cursor->position )
+    {
+        TRACE( "cursor %p rewinding from %u to %u\n", cursor, cursor->position, startIndex );
+        storage_enumeration_cursor_Release( cursor->cursor );
+        cursor->cursor = NULL;
+    }
+
+    if ( !cursor->cursor )
+    {
+        cursor->position = 0;
+        status = storage_enumeration_cursor_Create( folderPath, cursor->filter.depth == FolderDepth_Deep, &cursor->cursor );
+        if ( FAILED( status ) ) goto done;
+    }
+
+    for ( remaining = maxNumberOfItems; remaining; )
+    {
+        status = storage_enumeration_cursor_Next( cursor->cursor, &entry );
+        if ( status != S_OK ) break;
+        if ( !query_result_filter_Matches( &cursor->filter, &entry ) ) continue;
+
+        //Entries before the window are only counted, never opened.
+        if ( cursor->position < startIndex )
+        {
+            cursor->position++;
+            continue;
+        }
+
+        status = query_result_CreateItem( &entry, &item );
+        if ( FAILED( status ) ) break;
+        if ( status == S_FALSE ) continue;
+
+        status = IVector_IStorageItem_Append( items, item );
+        IStorageItem_Release( item );
+        if ( FAILED( status ) ) break;
+
+        cursor->position++;
+        remaining--;
+    }
+
+    if ( SUCCEEDED( status ) ) status = remaining == maxNumberOfItems ? E_BOUNDS : S_OK;
+
+done:
+    LeaveCriticalSection( &cursor->cs );
+    query_result_cursor_Release( cursor );
+    return status;
+}
+
+static HRESULT query_result_base_FetchWindow( IStorageQueryResultBase *iface, UINT32 startIndex, UINT32 maxNumberOfItems, IVector_IStorageItem **out )
+{
+    struct query_result_base *impl = impl_from_IStorageQueryResultBase( iface );
+    IVector_IStorageItem *items;
+    HRESULT status;
+    BOOL searching;
+
+    //non-runtime class require redefinition
+    #undef IStorageItem
+    DEFINE_VECTOR_IIDS( IStorageItem )
+    #define IStorageItem __x_ABI_CWindows_CStorage_CIStorageItem
+
+    status = vector_create( &IStorageItem_iids, (void **)&items );
     if ( FAILED( status ) ) return status;
 
-    status = IVector_IStorageItem_get_Size( items, &size );
+    //An empty window is valid anywhere, there is nothing to walk for it.
+    if ( !maxNumberOfItems )
+    {
+        *out = items;
+        return S_OK;
+    }
+
+    AcquireSRWLockShared( &query_result_search_lock );
+    searching = !!impl->Search;
+    ReleaseSRWLockShared( &query_result_search_lock );
+
+    //Bounded pages walk only as far as needed, unless a full search is already underway.
+    if ( maxNumberOfItems != INFINITE && !searching )
+        status = query_result_base_FetchFromCursor( iface, startIndex, maxNumberOfItems, items );
+    else
+        status = query_result_base_FetchFromSearch( iface, startIndex, maxNumberOfItems, items );
+
+    if ( FAILED( status ) )
+    {
+        IVector_IStorageItem_Release( items );
+        return status;
+    }
+
+    *out = items;
+    return S_OK;
+}
+
+/**
+ * Counts the matching entries without opening any of them.
+ */
+HRESULT WINAPI query_result_base_SearchCountAsync( IUnknown *invoker, IUnknown *param, PROPVARIANT *result )
+{
+    struct query_result_base *impl = impl_from_IStorageQueryResultBase( (IStorageQueryResultBase *)invoker );
+    struct query_result_count count = { 0 };
+    struct query_result_filter filter = { 0 };
+    struct storage_enumeration *enumeration;
+    struct query_result_search *search;
+
+    HSTRING folderPath = impl_from_IStorageFolder( impl->Folder )->Path;
+    HRESULT status = S_OK;
+    UINT32 size = 0;
+
+    AcquireSRWLockShared( &query_result_search_lock );
+    if ( (search = impl->Search) ) InterlockedIncrement( &search->ref );
+    ReleaseSRWLockShared( &query_result_search_lock );
+
+    //The items are being materialized anyway, count those.
+    if ( search )
+    {
+        status = query_result_search_Finish( search );
+        EnterCriticalSection( &search->cs );
+        if ( SUCCEEDED( status ) ) status = IVector_IStorageItem_get_Size( search->items, &size );
+        LeaveCriticalSection( &search->cs );
+        query_result_search_Release( search );
+        goto done;
+    }
+
+    status = query_result_filter_Init( impl, &filter );
+    count.filter = &filter;
+
+    if ( SUCCEEDED( status ) && filter.indexerOption != IndexerOption_DoNotUseIndexer )
+    {
+        status = storage_index_Query( query_result_base_GetIndex( impl ), WindowsGetStringRawBuffer( folderPath, NULL ),
+                                      filter.depth == FolderDepth_Deep, query_result_count_AddEntry, &count );
+        if ( status == S_OK ) goto counted;
+        if ( status == S_FALSE ) status = S_OK;
+    }
+
+    if ( SUCCEEDED( status ) )
+        status = storage_enumeration_Create( folderPath, filter.depth == FolderDepth_Deep, query_result_count_AddEntry, &count, &enumeration );
+    if ( SUCCEEDED( status ) )
+    {
+        status = storage_enumeration_Start( enumeration );
+        if ( SUCCEEDED( status ) ) status = storage_enumeration_Wait( enumeration );
+        storage_enumeration_Release( enumeration );
+    }
+
+counted:
+    size = count.count;
+    query_result_filter_Clear( &filter );
 
+done:
     if ( SUCCEEDED( status ) )
     {
         result->vt = VT_UI4;
@@ -208,7 +886,6 @@ HRESULT WINAPI query_result_base_FetchFoldersAsync( IUnknown *invoker, IUnknown
     struct folder_query_result *query_result = impl_from_IStorageFolderQueryResult( (IStorageFolderQueryResult *)invoker );
 
     HRESULT status = S_OK;
-    UINT32 currentSize = 0;
     UINT32 iterator;
     UINT32 size;
 
@@ -219,27 +896,27 @@ HRESULT WINAPI query_result_base_FetchFoldersAsync( IUnknown *invoker, IUnknown
 
     DEFINE_VECTOR_IIDS( StorageFolder )
     status = vector_create( &StorageFolder_iids, (void **)&folders );
+    if ( FAILED( status ) ) return status;
 
-    status = query_result_base_ConductSearch( &query_result->IStorageQueryResultBase_iface, &items );
+    status = query_result_base_FetchWindow( &query_result->IStorageQueryResultBase_iface, startIndex, maxNumberOfItems, &items );
     if ( FAILED( status ) ) return status;
 
     IVector_IStorageItem_get_Size( items, &size );
 
-    if ( startIndex >= size ) return E_BOUNDS;
-
-    for ( iterator = startIndex; iterator < size; iterator++ )
+    for ( iterator = 0; SUCCEEDED( status ) && iterator < size; iterator++ )
     {
-        if ( currentSize == maxNumberOfItems ) break;
         IVector_IStorageItem_GetAt( items, iterator, &currentItem );
-        
+
         status = IStorageItem_QueryInterface( currentItem, &IID_IStorageFolder, (void **)&currentFolder );
-        if ( FAILED( status ) ) return status;
+        IStorageItem_Release( currentItem );
+        if ( FAILED( status ) ) break;
         status = IVector_StorageFolder_Append( folders, currentFolder );
-        if ( FAILED( status ) ) return status;
-
-        currentSize++;
+        IStorageFolder_Release( currentFolder );
     }
 
+    IVector_IStorageItem_Release( items );
+    if ( FAILED( status ) ) return status;
+
     status = IVector_StorageFolder_GetView( folders, &foldersView );
 
     if ( SUCCEEDED( status ) )
@@ -262,7 +939,6 @@ HRESULT WINAPI query_result_base_FetchFilesAsync( IUnknown *invoker, IUnknown *p
     struct file_query_result *query_result = impl_from_IStorageFileQueryResult( (IStorageFileQueryResult *)invoker );
 
     HRESULT status = S_OK;
-    UINT32 currentSize = 0;
     UINT32 iterator;
     UINT32 size;
 
@@ -273,27 +949,27 @@ HRESULT WINAPI query_result_base_FetchFilesAsync( IUnknown *invoker, IUnknown *p
 
     DEFINE_VECTOR_IIDS( StorageFile )
     status = vector_create( &StorageFile_iids, (void **)&files );
+    if ( FAILED( status ) ) return status;
 
-    status = query_result_base_ConductSearch( &query_result->IStorageQueryResultBase_iface, &items );
+    status = query_result_base_FetchWindow( &query_result->IStorageQueryResultBase_iface, startIndex, maxNumberOfItems, &items );
     if ( FAILED( status ) ) return status;
 
     IVector_IStorageItem_get_Size( items, &size );
 
-    if ( startIndex >= size ) return E_BOUNDS;
-
-    for ( iterator = startIndex; iterator < size; iterator++ )
+    for ( iterator = 0; SUCCEEDED( status ) && iterator < size; iterator++ )
     {
-        if ( currentSize == maxNumberOfItems ) break;
         IVector_IStorageItem_GetAt( items, iterator, &currentItem );
-        
+
         status = IStorageItem_QueryInterface( currentItem, &IID_IStorageFile, (void **)&currentFile );
-        if ( FAILED( status ) ) return status;
+        IStorageItem_Release( currentItem );
+        if ( FAILED( status ) ) break;
         status = IVector_StorageFile_Append( files, currentFile );
-        if ( FAILED( status ) ) return status;
-
-        currentSize++;
+        IStorageFile_Release( currentFile );
     }
 
+    IVector_IStorageItem_Release( items );
+    if ( FAILED( status ) ) return status;
+
     status = IVector_StorageFile_GetView( files, &filesView );
 
     if ( SUCCEEDED( status ) )
@@ -307,50 +983,23 @@ HRESULT WINAPI query_result_base_FetchFilesAsync( IUnknown *invoker, IUnknown *p
 
 HRESULT WINAPI query_result_base_FetchItemsAsync( IUnknown *invoker, IUnknown *param, PROPVARIANT *result )
 {
-    IStorageItem *currentItem = NULL;
     IVector_IStorageItem *items = NULL;
-    IVector_IStorageItem *fetchedItems = NULL;
     IVectorView_IStorageItem *itemsView = NULL;
 
     struct item_query_result *query_result = impl_from_IStorageItemQueryResult( (IStorageItemQueryResult *)invoker );
 
     HRESULT status = S_OK;
-    UINT32 currentSize = 0;
-    UINT32 iterator;
-    UINT32 size;
 
     //Parameters
     struct storage_query_options *options = (struct storage_query_options *)param;
     UINT32 startIndex = options->startIndex;
     UINT32 maxNumberOfItems = options->maxNumberOfItems;
 
-    //non-runtime class require redefinition
-    #undef IStorageItem
-    DEFINE_VECTOR_IIDS( IStorageItem )
-    #define IStorageItem __x_ABI_CWindows_CStorage_CIStorageItem
-
-    status = vector_create( &IStorageItem_iids, (void **)fetchedItems );
+    status = query_result_base_FetchWindow( &query_result->IStorageQueryResultBase_iface, startIndex, maxNumberOfItems, &items );
     if ( FAILED( status ) ) return status;
 
-    status = query_result_base_ConductSearch( &query_result->IStorageQueryResultBase_iface, &items );
-    if ( FAILED( status ) ) return status;
-
-    IVector_IStorageItem_get_Size( items, &size );
-
-    if ( startIndex >= size ) return E_BOUNDS;
-
-    for ( iterator = startIndex; iterator < size; iterator++ )
-    {
-        if ( currentSize == maxNumberOfItems ) break;
-        IVector_IStorageItem_GetAt( items, iterator, &currentItem );
-
-        status = IVector_IStorageItem_Append( fetchedItems, currentItem );
-        if ( FAILED( status ) ) return status;
-
-        currentSize++;
-    }
-
-    status = IVector_IStorageItem_GetView( fetchedItems, &itemsView );
+    status = IVector_IStorageItem_GetView( items, &itemsView );
+    IVector_IStorageItem_Release( items );
 
     if ( SUCCEEDED( status ) )
     {
@@ -359,4 +1008,4 @@ HRESULT WINAPI query_result_base_FetchItemsAsync( IUnknown *invoker, IUnknown *p
     }
 
     return status;
-}
\ No newline at end of file
+}
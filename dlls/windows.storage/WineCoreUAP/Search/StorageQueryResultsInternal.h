@@ -28,6 +28,9 @@
 #include "../StorageFolderInternal.h"
 #include "../StorageFileInternal.h"
 
+#include "StorageEnumerationInternal.h"
+#include "StorageIndexInternal.h"
+
 extern const struct IStorageQueryResultBaseVtbl query_result_base_vtbl;
 extern const struct IStorageFileQueryResultVtbl file_query_result_vtbl;
 extern const struct IStorageFolderQueryResultVtbl folder_query_result_vtbl;
@@ -40,6 +43,72 @@ struct options_changed_event_handler
     BOOL isStillAvailable;
 };
 
+/**
+ * Snapshot of the query options an entry has to satisfy.
+ */
+struct query_result_filter
+{
+    StorageItemTypes searchType;
+    FolderDepth depth;
+    IndexerOption indexerOption;
+    HSTRING ApplicationFilter;
+    HSTRING UserFilter;
+    HSTRING *FileTypes;
+    UINT32 fileTypeCount;
+};
+
+/**
+ * Copy of a matching entry, the strings share the allocation of the full path.
+ */
+struct query_result_match
+{
+    LPWSTR Path;
+    struct storage_enumeration_entry Entry;
+    IStorageItem *Item;
+};
+
+struct query_result_matches
+{
+    struct query_result_match *elements;
+    SIZE_T count;
+    SIZE_T capacity;
+};
+
+/**
+ * Results of a running (or finished) directory walk, shared by all fetches of a query result.
+ * The enumeration workers collect matches in completion order, they are published to items
+ * sorted by path once the walk is over.
+ */
+struct query_result_search
+{
+    struct storage_enumeration *enumeration;
+    IVector_IStorageItem *items;
+    CRITICAL_SECTION cs;
+    struct query_result_filter filter;
+    struct query_result_matches matches;
+    BOOL sorted;
+
+    LONG ref;
+};
+
+/**
+ * Position of a paged walk. Consecutive pages resume where the previous one stopped,
+ * only the requested window is turned into storage items.
+ * Index covered folders are queried and sorted once by the first page, the following
+ * pages are cut out of the same matches.
+ */
+struct query_result_cursor
+{
+    struct storage_enumeration_cursor *cursor;
+    CRITICAL_SECTION cs;
+    struct query_result_filter filter;
+    UINT32 position;
+    struct query_result_matches matches;
+    BOOL indexed;
+
+    LONG ref;
+};
+
 struct query_result_base
 {
     //Derivatives
@@ -51,6 +120,10 @@ struct query_result_base
     struct options_changed_event_handler **optionsChangedEventHandlers;
     UINT32 handlerSize;
     UINT32 handlerCapacity;
+    struct query_result_search *Search;
+    struct query_result_cursor *Cursor;
+    //Keeps the folder's index open and watched for later queries.
+    struct storage_index *Index;
 
     LONG ref;
 };
@@ -68,6 +141,9 @@ struct folder_query_result
         struct options_changed_event_handler **optionsChangedEventHandlers;
         UINT32 handlerSize;
         UINT32 handlerCapacity;
+        struct query_result_search *Search;
+        struct query_result_cursor *Cursor;
+        struct storage_index *Index;
         LONG storageQueryResultBaseRef;
 
     LONG ref;
@@ -86,6 +162,9 @@ struct file_query_result
         struct options_changed_event_handler **optionsChangedEventHandlers;
         UINT32 handlerSize;
         UINT32 handlerCapacity;
+        struct query_result_search *Search;
+        struct query_result_cursor *Cursor;
+        struct storage_index *Index;
         LONG storageQueryResultBaseRef;
 
     LONG ref;
@@ -104,6 +183,9 @@ struct item_query_result
         struct options_changed_event_handler **optionsChangedEventHandlers;
         UINT32 handlerSize;
         UINT32 handlerCapacity;
+        struct query_result_search *Search;
+        struct query_result_cursor *Cursor;
+        struct storage_index *Index;
         LONG storageQueryResultBaseRef;
 
     LONG ref;
@@ -123,6 +205,10 @@ struct folder_query_result *impl_from_IStorageFolderQueryResult( IStorageFolderQ
 struct file_query_result *impl_from_IStorageFileQueryResult( IStorageFileQueryResult *iface );
 struct item_query_result *impl_from_IStorageItemQueryResult( IStorageItemQueryResult *iface );
 
+VOID WINAPI query_result_search_Release( struct query_result_search *search );
+VOID WINAPI query_result_cursor_Release( struct query_result_cursor *cursor );
+VOID WINAPI query_result_base_ResetSearch( IStorageQueryResultBase *iface );
+
 HRESULT WINAPI query_result_base_SearchCountAsync( IUnknown *invoker, IUnknown *param, PROPVARIANT *result );
 HRESULT WINAPI query_result_base_FindFirstAsync( IUnknown *invoker, IUnknown *param, PROPVARIANT *result );
 HRESULT WINAPI query_result_base_FetchFoldersAsync( IUnknown *invoker, IUnknown *param, PROPVARIANT *result );
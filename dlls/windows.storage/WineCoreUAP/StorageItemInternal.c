@@ -99,8 +99,10 @@ HRESULT WINAPI storage_item_Internal_CreateNew( HSTRING itemPath, IStorageItem *
     HSTRING tempName;
     HRESULT status;
     FILETIME itemFileCreatedTime;
+    BOOL cached;
 
     struct storage_item *item;
+    struct basic_properties_cache_record record;
 
     TRACE( "iface %p, value %p\n", itemPath, result );
     if (!result) return E_INVALIDARG;
@@ -111,24 +113,38 @@ HRESULT WINAPI storage_item_Internal_CreateNew( HSTRING itemPath, IStorageItem *
     if ( PathIsURLW( WindowsGetStringRawBuffer( itemPath, NULL ) ) )
         status = E_INVALIDARG;
     
-    attributes = GetFileAttributesW( WindowsGetStringRawBuffer( itemPath, NULL ) );
+    //Items that came from a query already had their directory record read.
+    if ( (cached = basic_properties_cache_Lookup( WindowsGetStringRawBuffer( itemPath, NULL ), &record )) )
+        attributes = record.Attributes;
+    else
+        attributes = GetFileAttributesW( WindowsGetStringRawBuffer( itemPath, NULL ) );
+
     if ( attributes == INVALID_FILE_ATTRIBUTES ) 
     {
         status = E_INVALIDARG;
     } else 
     {
         //File Time
-        itemFile = CreateFileW( WindowsGetStringRawBuffer( itemPath, NULL ), GENERIC_READ, FILE_SHARE_READ, NULL,
-                       OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL );
-        if (itemFile == INVALID_HANDLE_VALUE) 
+        if ( cached )
         {
-            return E_ABORT;
+            itemFile = NULL;
+            itemFileCreatedTime.dwLowDateTime = record.CreationTime.u.LowPart;
+            itemFileCreatedTime.dwHighDateTime = record.CreationTime.u.HighPart;
         }
-
-        if ( !GetFileTime( itemFile, &itemFileCreatedTime, NULL, NULL ) ) 
+        else
         {
-            CloseHandle( itemFile );
-            return E_ABORT;
+            itemFile = CreateFileW( WindowsGetStringRawBuffer( itemPath, NULL ), GENERIC_READ, FILE_SHARE_READ, NULL,
+                           OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL );
+            if (itemFile == INVALID_HANDLE_VALUE) 
+            {
+                return E_ABORT;
+            }
+
+            if ( !GetFileTime( itemFile, &itemFileCreatedTime, NULL, NULL ) ) 
+            {
+                CloseHandle( itemFile );
+                return E_ABORT;
+            }
         }
 
         item->DateCreated.UniversalTime = FileTimeToUnixTime( &itemFileCreatedTime );
@@ -163,7 +179,7 @@ HRESULT WINAPI storage_item_Internal_CreateNew( HSTRING itemPath, IStorageItem *
         WindowsCreateString( itemName + 1, wcslen( itemName + 1 ), &tempName );
         WindowsDuplicateString( tempName, &item->Name );
 
-        CloseHandle( itemFile );
+        if ( itemFile ) CloseHandle( itemFile );
 
         status = S_OK;
     }
@@ -304,19 +320,31 @@ HRESULT WINAPI storage_item_GetProperties( IUnknown *invoker, IUnknown *param, P
     HRESULT status = S_OK;
     HANDLE file;
     FILETIME lastWrite;
-    DWORD fileSize;
+    LARGE_INTEGER fileSize;
     
     struct basic_properties *properties;
+    struct basic_properties_cache_record record;
     struct storage_item *item;
     
     item = impl_from_IStorageItem( (IStorageItem *)invoker );
 
-    file = CreateFileW( WindowsGetStringRawBuffer( item->Path, NULL ), GENERIC_READ, FILE_SHARE_READ, NULL,
-                    OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL );
-
-    fileSize = GetFileSize( file, NULL );
+    //Served from the directory record while the folder has not changed.
+    if ( basic_properties_cache_Lookup( WindowsGetStringRawBuffer( item->Path, NULL ), &record ) )
+    {
+        fileSize.QuadPart = record.Size;
+        lastWrite.dwLowDateTime = record.LastWriteTime.u.LowPart;
+        lastWrite.dwHighDateTime = record.LastWriteTime.u.HighPart;
+    }
+    else
+    {
+        file = CreateFileW( WindowsGetStringRawBuffer( item->Path, NULL ), GENERIC_READ, FILE_SHARE_READ, NULL,
+                        OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL );
+        if ( file == INVALID_HANDLE_VALUE ) return HRESULT_FROM_WIN32( GetLastError() );
 
-    GetFileTime(file, NULL, NULL, &lastWrite);
+        if ( !GetFileSizeEx( file, &fileSize ) ) fileSize.QuadPart = 0;
+        GetFileTime( file, NULL, NULL, &lastWrite );
+        CloseHandle( file );
+    }
 
     TRACE( "iface %p, value %p\n", invoker, result );
     if (!result) return E_INVALIDARG;
@@ -327,7 +355,7 @@ HRESULT WINAPI storage_item_GetProperties( IUnknown *invoker, IUnknown *param, P
 
     properties->DateModified.UniversalTime = FileTimeToUnixTime( &lastWrite );
     properties->ItemDate = item->DateCreated;
-    properties->size = fileSize;
+    properties->size = fileSize.QuadPart;
     properties->ref = 1;
 
     result->vt = VT_UNKNOWN;
@@ -166,7 +166,11 @@ static ULONG WINAPI buffer_Release( IBuffer *iface )
 
     TRACE( "iface %p decreasing refcount to %lu.\n", iface, ref );
 
-    if (!ref) free( impl );
+    if (!ref)
+    {
+        free( impl->Buffer );
+        free( impl );
+    }
     return ref;
 }
 
@@ -40,4 +40,55 @@ HRESULT WINAPI buffer_Create( UINT32 capacity, IBuffer **value )
     *value = &newBuffer->IBuffer_iface;
 
     return hr;
-}
\ No newline at end of file
+}
+
+/**
+ * Reads the file into private memory in one go, unlike the text readers which decode
+ * from a mapping. The buffer is handed to the caller and can live for any amount of
+ * time, a view backing it would keep the file locked against deletion or truncation
+ * for as long, and its untouched pages would still follow later writes to the file.
+ */
+HRESULT WINAPI buffer_CreateFromFile( HANDLE file, UINT32 size, IBuffer **value )
+{
+    struct buffer *newBuffer;
+    LARGE_INTEGER start = {0};
+    DWORD read;
+    UINT32 done;
+    BYTE *contents;
+
+    if ( size > 0x7fffffffu ) return E_INVALIDARG;
+    if ( !size ) return buffer_Create( 0, value );
+
+    if (!(contents = malloc( size ))) return E_OUTOFMEMORY;
+    if ( !SetFilePointerEx( file, start, NULL, FILE_BEGIN ) )
+    {
+        free( contents );
+        return HRESULT_FROM_WIN32( GetLastError() );
+    }
+    for (done = 0; done < size; done += read)
+    {
+        if ( !ReadFile( file, contents + done, size - done, &read, NULL ) )
+        {
+            free( contents );
+            return HRESULT_FROM_WIN32( GetLastError() );
+        }
+        //The file shrank since its size was queried.
+        if ( !read ) break;
+    }
+
+    if (!(newBuffer = calloc( 1, sizeof(*newBuffer) )))
+    {
+        free( contents );
+        return E_OUTOFMEMORY;
+    }
+
+    newBuffer->IBuffer_iface.lpVtbl = &buffer_vtbl;
+    newBuffer->IBufferByteAccess_iface.lpVtbl = &bufferaccess_vtbl;
+    newBuffer->Buffer = contents;
+    newBuffer->Capacity = size;
+    newBuffer->Length = done;
+
+    *value = &newBuffer->IBuffer_iface;
+
+    return S_OK;
+}
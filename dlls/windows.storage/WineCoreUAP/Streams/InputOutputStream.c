@@ -109,14 +109,14 @@ static HRESULT WINAPI closable_stream_Close( IClosable *iface )
 
     if ( inheritedInput->IInputStream_iface.lpVtbl == &input_stream_vtbl )
     {
-        CloseHandle( inheritedInput->stream );
+        stream_file_Release( stream_file_Detach( &inheritedInput->file ) );
         IInputStream_Release( &inheritedInput->IInputStream_iface );
         return S_OK;
     }
 
     if ( inheritedOutput->IOutputStream_iface.lpVtbl == &output_stream_vtbl )
     {
-        CloseHandle( inheritedOutput->stream );
+        stream_file_Release( stream_file_Detach( &inheritedOutput->file ) );
         IOutputStream_Release( &inheritedOutput->IOutputStream_iface );
         return S_OK;
     }
@@ -185,7 +185,11 @@ static ULONG WINAPI input_stream_Release( IInputStream *iface )
 
     TRACE( "iface %p decreasing refcount to %lu.\n", iface, ref );
 
-    if (!ref) free( impl );
+    if (!ref)
+    {
+        stream_file_Release( impl->file );
+        free( impl );
+    }
     return ref;
 }
 
@@ -287,7 +291,11 @@ static ULONG WINAPI output_stream_Release( IOutputStream *iface )
 
     TRACE( "iface %p decreasing refcount to %lu.\n", iface, ref );
 
-    if (!ref) free( impl );
+    if (!ref)
+    {
+        stream_file_Release( impl->file );
+        free( impl );
+    }
     return ref;
 }
 
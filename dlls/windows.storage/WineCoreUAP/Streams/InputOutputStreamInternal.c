@@ -21,61 +21,346 @@
 
 #include "InputOutputStreamInternal.h"
 
+#include <winreg.h>
+
 DEFINE_ASYNC_COMPLETED_HANDLER( currentOperation_async, IAsyncOperationWithProgressCompletedHandler_UINT32_UINT32, IAsyncOperationWithProgress_UINT32_UINT32 )
 
+//Guards the file pointer of every stream against Close, reads and writes take their own reference under it.
+static SRWLOCK stream_close_lock = SRWLOCK_INIT;
+
+static INIT_ONCE readAheadOnce = INIT_ONCE_STATIC_INIT;
+static UINT32 readAheadMax = STREAM_READ_AHEAD_DEFAULT_MAX;
+
+static BOOL CALLBACK stream_file_InitReadAhead( INIT_ONCE *once, void *param, void **context )
+{
+    DWORD value, size = sizeof(value);
+
+    if ( !RegGetValueW( HKEY_CURRENT_USER, L"Software\\Wine\\WineCoreUAP", L"StreamReadAheadMax", RRF_RT_REG_DWORD, NULL, &value, &size ) )
+        readAheadMax = max( STREAM_READ_AHEAD_MIN, min( value, STREAM_READ_AHEAD_LIMIT ) );
+
+    TRACE( "read-ahead window up to %#x bytes.\n", readAheadMax );
+    return TRUE;
+}
+
+static void CALLBACK stream_file_ReadComplete( PTP_CALLBACK_INSTANCE instance, void *context, void *overlapped, ULONG result, ULONG_PTR bytes, PTP_IO io )
+{
+    struct stream_file *file = (struct stream_file *)context;
+
+    EnterCriticalSection( &file->cs );
+    file->pendingResult = result == ERROR_HANDLE_EOF ? ERROR_SUCCESS : result;
+    file->pendingLength = bytes;
+    file->pendingActive = FALSE;
+    file->pendingReady = TRUE;
+    LeaveCriticalSection( &file->cs );
+
+    WakeAllConditionVariable( &file->completed );
+}
+
+/**
+ * Queues a read of the next window, must be called with the lock held.
+ */
+static HRESULT stream_file_Issue( struct stream_file *file, UINT64 offset, UINT32 length )
+{
+    DWORD error;
+    BYTE *tmp;
+
+    if ( length > file->pendingCapacity )
+    {
+        if (!(tmp = realloc( file->pending, length ))) return E_OUTOFMEMORY;
+        file->pending = tmp;
+        file->pendingCapacity = length;
+    }
+
+    memset( &file->overlapped, 0, sizeof(file->overlapped) );
+    file->overlapped.Offset = (DWORD)offset;
+    file->overlapped.OffsetHigh = (DWORD)(offset >> 32);
+    file->pendingOffset = offset;
+    file->pendingLength = 0;
+    file->pendingResult = ERROR_SUCCESS;
+    file->pendingReady = FALSE;
+    file->pendingActive = TRUE;
+
+    StartThreadpoolIo( file->io );
+    if ( !ReadFile( file->handle, file->pending, length, NULL, &file->overlapped ) && (error = GetLastError()) != ERROR_IO_PENDING )
+    {
+        //Nothing was queued, so no completion will ever arrive for it.
+        CancelThreadpoolIo( file->io );
+        file->pendingResult = error == ERROR_HANDLE_EOF ? ERROR_SUCCESS : error;
+        file->pendingActive = FALSE;
+        file->pendingReady = TRUE;
+    }
+
+    return S_OK;
+}
+
+/**
+ * Synchronous transfer that bypasses the completion port, used for writes and reads too large to cache.
+ */
+static HRESULT stream_file_Transfer( struct stream_file *file, UINT64 offset, BYTE *data, UINT32 count, BOOL write, UINT32 *transferred )
+{
+    OVERLAPPED overlapped = { 0 };
+    HANDLE event;
+    DWORD bytes = 0;
+    DWORD error = ERROR_SUCCESS;
+    BOOL success;
+
+    if (!(event = CreateEventW( NULL, TRUE, FALSE, NULL ))) return HRESULT_FROM_WIN32( GetLastError() );
+
+    overlapped.Offset = (DWORD)offset;
+    overlapped.OffsetHigh = (DWORD)(offset >> 32);
+    overlapped.hEvent = (HANDLE)((ULONG_PTR)event | 1);
+
+    success = write ? WriteFile( file->handle, data, count, NULL, &overlapped ) : ReadFile( file->handle, data, count, NULL, &overlapped );
+    if ( success || GetLastError() == ERROR_IO_PENDING ) success = GetOverlappedResult( file->handle, &overlapped, &bytes, TRUE );
+    if ( !success ) error = GetLastError();
+    CloseHandle( event );
+
+    *transferred = bytes;
+    if ( error != ERROR_SUCCESS && error != ERROR_HANDLE_EOF ) return HRESULT_FROM_WIN32( error );
+    return S_OK;
+}
+
+HRESULT WINAPI stream_file_Open( LPCWSTR path, DWORD access, struct stream_file **out )
+{
+    struct stream_file *file;
+    HRESULT status;
+
+    if (!(file = calloc( 1, sizeof(*file) ))) return E_OUTOFMEMORY;
+
+    file->handle = CreateFileW( path, access, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, NULL );
+    if ( file->handle == INVALID_HANDLE_VALUE )
+    {
+        status = HRESULT_FROM_WIN32( GetLastError() );
+        free( file );
+        return status;
+    }
+
+    if (!(file->io = CreateThreadpoolIo( file->handle, stream_file_ReadComplete, file, NULL )))
+    {
+        status = HRESULT_FROM_WIN32( GetLastError() );
+        CloseHandle( file->handle );
+        free( file );
+        return status;
+    }
+
+    InitializeCriticalSectionEx( &file->cs, 0, RTL_CRITICAL_SECTION_FLAG_FORCE_DEBUG_INFO );
+    file->cs.DebugInfo->Spare[0] = (DWORD_PTR)( __FILE__ ": stream_file.cs" );
+    InitializeConditionVariable( &file->completed );
+
+    //The first read is never treated as sequential, a single small read does not pay for a window.
+    InitOnceExecuteOnce( &readAheadOnce, stream_file_InitReadAhead, NULL, NULL );
+
+    file->nextOffset = ~(UINT64)0;
+    file->window = STREAM_READ_AHEAD_MIN;
+    file->ref = 1;
+
+    *out = file;
+    return S_OK;
+}
+
+struct stream_file *WINAPI stream_file_AddRef( struct stream_file *file )
+{
+    if ( file ) InterlockedIncrement( &file->ref );
+    return file;
+}
+
+/**
+ * Takes a reference to the file of a stream, NULL once the stream is closed.
+ */
+struct stream_file *WINAPI stream_file_Acquire( struct stream_file **slot )
+{
+    struct stream_file *file;
+
+    AcquireSRWLockShared( &stream_close_lock );
+    file = stream_file_AddRef( *slot );
+    ReleaseSRWLockShared( &stream_close_lock );
+    return file;
+}
+
+/**
+ * Takes the file out of a stream being closed, the caller releases it.
+ * Reads and writes in progress keep their own reference until they are done.
+ */
+struct stream_file *WINAPI stream_file_Detach( struct stream_file **slot )
+{
+    struct stream_file *file;
+
+    AcquireSRWLockExclusive( &stream_close_lock );
+    file = *slot;
+    *slot = NULL;
+    ReleaseSRWLockExclusive( &stream_close_lock );
+    return file;
+}
+
+VOID WINAPI stream_file_Release( struct stream_file *file )
+{
+    if ( !file || InterlockedDecrement( &file->ref ) ) return;
+
+    EnterCriticalSection( &file->cs );
+    if ( file->pendingActive ) CancelIoEx( file->handle, &file->overlapped );
+    while ( file->pendingActive ) SleepConditionVariableCS( &file->completed, &file->cs, INFINITE );
+    LeaveCriticalSection( &file->cs );
+
+    WaitForThreadpoolIoCallbacks( file->io, FALSE );
+    CloseThreadpoolIo( file->io );
+    CloseHandle( file->handle );
+
+    file->cs.DebugInfo->Spare[0] = 0;
+    DeleteCriticalSection( &file->cs );
+
+    free( file->cache );
+    free( file->pending );
+    free( file );
+}
+
+HRESULT WINAPI stream_file_Read( struct stream_file *file, UINT64 offset, BYTE *data, UINT32 count, InputStreamOptions options, UINT32 *bytesRead )
+{
+    HRESULT status = S_OK;
+    BOOL sequential;
+    UINT64 next;
+    UINT32 copied;
+    UINT32 capacity;
+    BYTE *tmp;
+
+    *bytesRead = 0;
+
+    EnterCriticalSection( &file->cs );
+
+    //Sequential readers get a growing window, anything else starts over from the smallest one.
+    sequential = offset == file->nextOffset;
+    file->window = sequential ? min( file->window * 2, readAheadMax ) : STREAM_READ_AHEAD_MIN;
+
+    while ( count )
+    {
+        if ( offset >= file->cacheOffset && offset < file->cacheOffset + file->cacheLength )
+        {
+            copied = min( count, file->cacheOffset + file->cacheLength - offset );
+            memcpy( data, file->cache + (offset - file->cacheOffset), copied );
+            data += copied;
+            offset += copied;
+            count -= copied;
+            *bytesRead += copied;
+            continue;
+        }
+
+        //Partial readers take what is already in memory rather than waiting on the disk.
+        if ( (options & InputStreamOptions_Partial) && *bytesRead ) break;
+
+        if ( file->pendingActive )
+        {
+            SleepConditionVariableCS( &file->completed, &file->cs, INFINITE );
+            continue;
+        }
+
+        if ( file->pendingReady && offset >= file->pendingOffset &&
+             (offset - file->pendingOffset < file->pendingLength || (offset == file->pendingOffset && !file->pendingLength)) )
+        {
+            file->pendingReady = FALSE;
+            if ( file->pendingResult != ERROR_SUCCESS )
+            {
+                status = HRESULT_FROM_WIN32( file->pendingResult );
+                break;
+            }
+
+            tmp = file->cache;
+            file->cache = file->pending;
+            file->pending = tmp;
+            capacity = file->cacheCapacity;
+            file->cacheCapacity = file->pendingCapacity;
+            file->pendingCapacity = capacity;
+            file->cacheOffset = file->pendingOffset;
+            file->cacheLength = file->pendingLength;
+
+            //End of file
+            if ( !file->cacheLength ) break;
+            continue;
+        }
+
+        if ( count >= file->window )
+        {
+            //Reads larger than the window go straight to the caller's buffer.
+            status = stream_file_Transfer( file, offset, data, count, FALSE, &copied );
+            offset += copied;
+            *bytesRead += copied;
+            break;
+        }
+
+        status = stream_file_Issue( file, offset, file->window );
+        if ( FAILED( status ) ) break;
+    }
+
+    file->nextOffset = offset;
+
+    //Keep the next window in flight while the caller consumes this one.
+    if ( SUCCEEDED( status ) && (sequential || (options & InputStreamOptions_ReadAhead)) && !file->pendingActive && file->cacheLength )
+    {
+        next = file->cacheOffset + file->cacheLength;
+        if ( offset >= file->cacheOffset && offset <= next && !(file->pendingReady && file->pendingOffset == next) )
+            stream_file_Issue( file, next, file->window );
+    }
+
+    LeaveCriticalSection( &file->cs );
+
+    return status;
+}
+
+HRESULT WINAPI stream_file_Write( struct stream_file *file, UINT64 offset, const BYTE *data, UINT32 count, UINT32 *bytesWritten )
+{
+    HRESULT status;
+
+    EnterCriticalSection( &file->cs );
+
+    //Whatever was read ahead may be stale after this.
+    while ( file->pendingActive ) SleepConditionVariableCS( &file->completed, &file->cs, INFINITE );
+    file->pendingReady = FALSE;
+    file->cacheLength = 0;
+
+    status = stream_file_Transfer( file, offset, (BYTE *)data, count, TRUE, bytesWritten );
+
+    LeaveCriticalSection( &file->cs );
+
+    return status;
+}
+
 HRESULT WINAPI input_stream_Read( IUnknown *invoker, IUnknown *param, PROPVARIANT *result, IWineAsyncOperationProgressHandler *progress )
 {
-    HRESULT status = S_OK;    
-    UINT32 totalBytesRead = 0;
+    HRESULT status = S_OK;
     UINT32 bufferCapacity;
-    DWORD bytesRead;    
+    UINT32 bytesRead = 0;
     BYTE *buffer;
-    BYTE tmpBuffer[BUFFER_SIZE];
-    BOOL readResult;
 
     IBufferByteAccess *bufferByteAccess;
+    struct stream_file *file;
 
     struct input_stream *stream = impl_from_IInputStream( (IInputStream *)invoker );
 
     /**
      * Paramteres
      */
-    struct input_stream_options *options = (struct input_stream_options *)result;
-
-    if ( stream->streamSize <= 0 )
-        return E_BOUNDS;
-
-    if ( options->count >= stream->streamSize )
-        return E_BOUNDS;
+    struct input_stream_options *options = (struct input_stream_options *)param;
 
     IBuffer_get_Capacity( options->buffer, &bufferCapacity );
 
-    if ( bufferCapacity <= options->count )
-        return E_BOUNDS;
-    
+    if ( bufferCapacity < options->count )
+        return E_INVALIDARG;
+
     status = IBuffer_QueryInterface( options->buffer, &IID_IBufferByteAccess, (void **)&bufferByteAccess );
     if ( FAILED( status ) ) return status;
 
     IBufferByteAccess_get_Buffer( bufferByteAccess, &buffer );
+    IBufferByteAccess_Release( bufferByteAccess );
 
-    while ( totalBytesRead < stream->streamSize )
-    {
-        readResult = ReadFile( stream->stream, tmpBuffer, BUFFER_SIZE, &bytesRead, NULL );
-
-        if ( !readResult )
-            return E_ABORT;
-
-        if ( bytesRead == 0 ) break;
-
-        memcpy( buffer + totalBytesRead, tmpBuffer, bytesRead );
-
-        totalBytesRead += bytesRead;
+    //The stream may be closed while the read is running.
+    if (!(file = stream_file_Acquire( &stream->file )))
+        return RO_E_CLOSED;
+    status = stream_file_Read( file, stream->position, buffer, options->count, options->options, &bytesRead );
+    stream_file_Release( file );
+    if ( FAILED( status ) ) return status;
 
-        status = IWineAsyncOperationProgressHandler_Invoke( progress, (IInspectable *)invoker, totalBytesRead );
-        if ( FAILED( status ) ) return status;
-    }
+    stream->position += bytesRead;
+    IBuffer_put_Length( options->buffer, bytesRead );
 
-    IBuffer_put_Length( options->buffer, totalBytesRead );
+    if ( progress ) status = IWineAsyncOperationProgressHandler_Invoke( progress, (IInspectable *)invoker, bytesRead );
 
     if ( SUCCEEDED( status ) )
     {
@@ -91,12 +376,11 @@ HRESULT WINAPI output_stream_Write( IUnknown *invoker, IUnknown *param, PROPVARI
     HRESULT status = S_OK;
     UINT32 totalBytesWritten = 0;
     UINT32 totalBytesToWrite = 0;
-    DWORD bytesWritten;
     BYTE *buffer;
-    BOOL writeResult;
 
     IBuffer *bufferToWrite = (IBuffer *)param;
     IBufferByteAccess *bufferByteAccess;
+    struct stream_file *file;
 
     struct output_stream *stream = impl_from_IOutputStream( (IOutputStream *)invoker );
 
@@ -104,26 +388,21 @@ HRESULT WINAPI output_stream_Write( IUnknown *invoker, IUnknown *param, PROPVARI
     if ( FAILED( status ) ) return status;
 
     IBufferByteAccess_get_Buffer( bufferByteAccess, &buffer );
+    IBufferByteAccess_Release( bufferByteAccess );
 
     IBuffer_get_Length( bufferToWrite, &totalBytesToWrite );
 
-    while ( totalBytesWritten < totalBytesToWrite )
-    {
-        writeResult = WriteFile( stream->stream, buffer + totalBytesWritten, BUFFER_SIZE, &bytesWritten, NULL );
-
-        if ( !writeResult )
-            return E_ABORT;
-
-        if ( bytesWritten == 0 ) break;
-
-        totalBytesWritten += bytesWritten;
-
-        status = IWineAsyncOperationProgressHandler_Invoke( progress, (IInspectable *)invoker, totalBytesWritten );
-        if ( FAILED( status ) ) return status;
-    }
+    if (!(file = stream_file_Acquire( &stream->file )))
+        return RO_E_CLOSED;
+    status = stream_file_Write( file, stream->position, buffer, totalBytesToWrite, &totalBytesWritten );
+    stream_file_Release( file );
+    if ( FAILED( status ) ) return status;
 
+    stream->position += totalBytesWritten;
     stream->streamSize = totalBytesWritten;
 
+    if ( progress ) status = IWineAsyncOperationProgressHandler_Invoke( progress, (IInspectable *)invoker, totalBytesWritten );
+
     if ( SUCCEEDED( status ) )
     {
         result->vt = VT_UI4;
@@ -29,15 +29,54 @@
 
 #define BUFFER_SIZE 4096
 
+//Read-ahead window, doubled on every sequential read up to the maximum outstanding window.
+//The maximum can be set in bytes with the StreamReadAheadMax value of HKCU\Software\Wine\WineCoreUAP.
+#define STREAM_READ_AHEAD_MIN 0x10000
+#define STREAM_READ_AHEAD_DEFAULT_MAX 0x400000
+#define STREAM_READ_AHEAD_LIMIT 0x4000000
+
 extern const struct IInputStreamVtbl input_stream_vtbl;
 extern const struct IOutputStreamVtbl output_stream_vtbl;
 extern const struct IClosableVtbl closable_stream_vtbl;
 
+/**
+ * Overlapped file shared by a random access stream and every stream taken from it.
+ * Reads complete through the threadpool, one window is served from memory while the next is in flight.
+ */
+struct stream_file
+{
+    HANDLE handle;
+    PTP_IO io;
+    CRITICAL_SECTION cs;
+    CONDITION_VARIABLE completed;
+
+    //Window being served
+    BYTE *cache;
+    UINT32 cacheCapacity;
+    UINT64 cacheOffset;
+    UINT32 cacheLength;
+
+    //Window in flight
+    BYTE *pending;
+    UINT32 pendingCapacity;
+    UINT64 pendingOffset;
+    UINT32 pendingLength;
+    ULONG pendingResult;
+    BOOL pendingActive;
+    BOOL pendingReady;
+    OVERLAPPED overlapped;
+
+    UINT64 nextOffset;
+    UINT32 window;
+
+    LONG ref;
+};
+
 struct closable_stream
 {
     //Derivates
     IClosable IClosable_iface;
-    HANDLE stream;
+    struct stream_file *file;
     UINT64 streamSize;
 
     LONG ref;
@@ -50,10 +89,12 @@ struct input_stream
 
     //IClosable Derivatives
     IClosable IClosable_iface;
-        HANDLE stream;
+        struct stream_file *file;
         UINT64 streamSize;
         LONG closableRef;
 
+    UINT64 position;
+
     LONG ref;
 };
 
@@ -64,10 +105,12 @@ struct output_stream
 
     //IClosable Derivatives
     IClosable IClosable_iface;
-        HANDLE stream;
+        struct stream_file *file;
         UINT64 streamSize;
         LONG closableRef;
 
+    UINT64 position;
+
     IAsyncOperationWithProgress_UINT32_UINT32 *currentOperation; //Flushing purposes
     
     LONG ref;
@@ -83,6 +126,14 @@ struct input_stream_options
 struct input_stream *impl_from_IInputStream( IInputStream *iface );
 struct output_stream *impl_from_IOutputStream( IOutputStream *iface );
 
+HRESULT WINAPI stream_file_Open( LPCWSTR path, DWORD access, struct stream_file **out );
+struct stream_file *WINAPI stream_file_AddRef( struct stream_file *file );
+VOID WINAPI stream_file_Release( struct stream_file *file );
+struct stream_file *WINAPI stream_file_Acquire( struct stream_file **slot );
+struct stream_file *WINAPI stream_file_Detach( struct stream_file **slot );
+HRESULT WINAPI stream_file_Read( struct stream_file *file, UINT64 offset, BYTE *data, UINT32 count, InputStreamOptions options, UINT32 *bytesRead );
+HRESULT WINAPI stream_file_Write( struct stream_file *file, UINT64 offset, const BYTE *data, UINT32 count, UINT32 *bytesWritten );
+
 HRESULT WINAPI input_stream_Read( IUnknown *invoker, IUnknown *param, PROPVARIANT *result, IWineAsyncOperationProgressHandler *progress );
 HRESULT WINAPI output_stream_Write( IUnknown *invoker, IUnknown *param, PROPVARIANT *result, IWineAsyncOperationProgressHandler *progress );
 HRESULT WINAPI output_stream_Flush( IUnknown *invoker, IUnknown *param, PROPVARIANT *result );
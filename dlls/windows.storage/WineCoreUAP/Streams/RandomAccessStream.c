@@ -197,7 +197,11 @@ static ULONG WINAPI closable_random_access_stream_Release( IClosable *iface )
 
     TRACE( "iface %p decreasing refcount to %lu.\n", iface, ref );
 
-    if (!ref) free( impl );
+    if (!ref)
+    {
+        stream_file_Release( impl->file );
+        free( impl );
+    }
     return ref;
 }
 
@@ -223,7 +227,7 @@ static HRESULT WINAPI closable_random_access_stream_Close( IClosable *iface )
 {
     struct random_access_stream *impl = impl_from_IClosable( iface );
 
-    CloseHandle( impl->stream );
+    stream_file_Release( stream_file_Detach( &impl->file ) );
     IRandomAccessStream_Release( &impl->IRandomAccessStream_iface );
 
     return S_OK;
@@ -304,7 +308,11 @@ static ULONG WINAPI random_access_stream_Release( IRandomAccessStream *iface )
 
     TRACE( "iface %p decreasing refcount to %lu.\n", iface, ref );
 
-    if (!ref) free( impl );
+    if (!ref)
+    {
+        stream_file_Release( impl->file );
+        free( impl );
+    }
     return ref;
 }
 
@@ -344,23 +352,19 @@ static HRESULT WINAPI random_access_stream_put_Size( IRandomAccessStream *iface,
 
 static HRESULT WINAPI random_access_stream_GetInputStreamAt( IRandomAccessStream *iface, UINT64 position, IInputStream **stream )
 {
-    DWORD moveResult;    
     struct random_access_stream *impl = impl_from_IRandomAccessStream( iface );
     struct input_stream *input;
 
     TRACE( "iface %p, position %llu, stream %p\n", iface, position, stream );
 
     if (!(input = calloc( 1, sizeof(*input) ))) return E_OUTOFMEMORY;
-    
-    moveResult = SetFilePointer( impl->stream, position, NULL, FILE_BEGIN );
-    if ( moveResult == INVALID_SET_FILE_POINTER )
-        return E_BOUNDS;
 
     input->IInputStream_iface.lpVtbl = &input_stream_vtbl;
     input->IClosable_iface.lpVtbl = &closable_stream_vtbl;
-    input->stream = impl->stream;
+    input->file = stream_file_Acquire( &impl->file );
     input->streamSize = impl->streamSize - position;
     input->closableRef = 1;
+    input->position = position;
     input->ref = 1;
 
     impl->Position = position;
@@ -372,23 +376,19 @@ static HRESULT WINAPI random_access_stream_GetInputStreamAt( IRandomAccessStream
 
 static HRESULT WINAPI random_access_stream_GetOutputStreamAt( IRandomAccessStream *iface, UINT64 position, IOutputStream **stream )
 {
-    DWORD moveResult;    
     struct random_access_stream *impl = impl_from_IRandomAccessStream( iface );
     struct output_stream *output;
 
     TRACE( "iface %p, position %llu, stream %p\n", iface, position, stream );
 
     if (!(output = calloc( 1, sizeof(*output) ))) return E_OUTOFMEMORY;
-    
-    moveResult = SetFilePointer( impl->stream, position, NULL, FILE_BEGIN );
-    if ( moveResult == INVALID_SET_FILE_POINTER )
-        return E_BOUNDS;
 
     output->IOutputStream_iface.lpVtbl = &output_stream_vtbl;
     output->IClosable_iface.lpVtbl = &closable_stream_vtbl;
-    output->stream = impl->stream;
+    output->file = stream_file_Acquire( &impl->file );
     output->streamSize = impl->streamSize - position;
     output->closableRef = 1;
+    output->position = position;
     output->ref = 1;
     output->currentOperation = NULL;
 
@@ -412,7 +412,6 @@ static HRESULT WINAPI random_access_stream_Seek( IRandomAccessStream *iface, UIN
     //According to MSDN, Checking position validation is handled by the application itself.
     struct random_access_stream *impl = impl_from_IRandomAccessStream( iface );
     TRACE( "iface %p, position %llu\n", iface, position );
-    SetFilePointer( impl->stream, position, NULL, FILE_BEGIN );
     impl->Position = position;
     return S_OK;
 }
@@ -428,7 +427,7 @@ static HRESULT WINAPI random_access_stream_CloneStream( IRandomAccessStream *ifa
 
     cloned_stream->IRandomAccessStream_iface.lpVtbl = &random_access_stream_vtbl;
     cloned_stream->IClosable_iface.lpVtbl = &closable_random_access_stream_vtbl;
-    cloned_stream->stream = impl->stream;
+    cloned_stream->file = stream_file_Acquire( &impl->file );
     cloned_stream->streamSize = impl->streamSize;
     cloned_stream->closableRef = impl->closableRef;
     cloned_stream->Position = 0;
@@ -46,7 +46,7 @@ struct random_access_stream
 
     //IClosable Derivatives
     IClosable IClosable_iface;
-        HANDLE stream;
+        struct stream_file *file;
         UINT64 streamSize;
         LONG closableRef;
 
@@ -44,15 +44,11 @@ HRESULT WINAPI random_access_stream_reference_CreateStream( IUnknown *invoker, I
     stream->CanWrite = reference->canWrite;
     stream->ref = 1;
 
-    if ( reference->canRead && reference->canWrite )
+    if ( reference->canRead || reference->canWrite )
     {
-        stream->stream = CreateFileW( WindowsGetStringRawBuffer( reference->handlePath, NULL ), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
-    } else if ( reference->canRead )
-    {
-        stream->stream = CreateFileW( WindowsGetStringRawBuffer( reference->handlePath, NULL ), GENERIC_READ, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
-    } else if ( reference->canWrite )
-    {
-        stream->stream = CreateFileW( WindowsGetStringRawBuffer( reference->handlePath, NULL ), GENERIC_WRITE, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+        status = stream_file_Open( WindowsGetStringRawBuffer( reference->handlePath, NULL ),
+                                   (reference->canRead ? GENERIC_READ : 0) | (reference->canWrite ? GENERIC_WRITE : 0), &stream->file );
+        if ( FAILED( status ) ) free( stream );
     }
 
     if ( SUCCEEDED( status ) ) 
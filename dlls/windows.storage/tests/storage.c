@@ -758,6 +758,191 @@ void test_StorageFile( const wchar_t* path )
     
 }
 
+/**
+ * Cached BasicProperties
+ */
+
+static void write_cache_test_file( const WCHAR *path, DWORD disposition, DWORD length )
+{
+    static const char data[16] = "cachetestcontent";
+    HANDLE file;
+    DWORD written;
+    BOOL ret;
+
+    file = CreateFileW( path, GENERIC_WRITE, 0, NULL, disposition, FILE_ATTRIBUTE_NORMAL, NULL );
+    ok( file != INVALID_HANDLE_VALUE, "CreateFileW failed, error %lu\n", GetLastError() );
+    SetFilePointer( file, 0, NULL, FILE_END );
+    ret = WriteFile( file, data, length, &written, NULL );
+    ok( ret && written == length, "WriteFile failed, error %lu\n", GetLastError() );
+    CloseHandle( file );
+
+    //Give the change notifications time to be signaled.
+    Sleep( 200 );
+}
+
+static UINT64 get_cached_file_size( IStorageFile *file )
+{
+    IAsyncOperation_BasicProperties *properties_operation = NULL;
+    IBasicProperties *properties = NULL;
+    IStorageItem *item = NULL;
+    UINT64 size = 0;
+    DWORD asyncRes;
+    HRESULT hr;
+
+    hr = IStorageFile_QueryInterface( file, &IID_IStorageItem, (void **)&item );
+    CHECK_HR( hr );
+
+    hr = IStorageItem_GetBasicPropertiesAsync( item, &properties_operation );
+    CHECK_HR( hr );
+    asyncRes = await_IAsyncOperation_BasicProperties( properties_operation, INFINITE );
+    ok( !asyncRes, "got asyncRes %#lx\n", asyncRes );
+    hr = IAsyncOperation_BasicProperties_GetResults( properties_operation, &properties );
+    CHECK_HR( hr );
+
+    hr = IBasicProperties_get_Size( properties, &size );
+    CHECK_HR( hr );
+
+    IBasicProperties_Release( properties );
+    IAsyncOperation_BasicProperties_Release( properties_operation );
+    IStorageItem_Release( item );
+    return size;
+}
+
+static IStorageFile *query_cache_test_file( IStorageFolderQueryOperations *query_operations )
+{
+    IAsyncOperation_IVectorView_StorageFile *storage_file_vector_view_operation = NULL;
+    IVectorView_StorageFile *storage_file_vector_view = NULL;
+    IStorageFile *storage_file = NULL;
+    DWORD asyncRes;
+    UINT32 size;
+    HRESULT hr;
+
+    hr = IStorageFolderQueryOperations_GetFilesAsyncOverloadDefaultStartAndCount( query_operations, CommonFileQuery_DefaultQuery, &storage_file_vector_view_operation );
+    CHECK_HR( hr );
+    asyncRes = await_IAsyncOperation_IVectorView_StorageFile( storage_file_vector_view_operation, INFINITE );
+    ok( !asyncRes, "got asyncRes %#lx\n", asyncRes );
+    hr = IAsyncOperation_IVectorView_StorageFile_GetResults( storage_file_vector_view_operation, &storage_file_vector_view );
+    CHECK_HR( hr );
+
+    hr = IVectorView_StorageFile_get_Size( storage_file_vector_view, &size );
+    CHECK_HR( hr );
+    ok( size == 1u, "unexpected size of %u\n", size );
+    hr = IVectorView_StorageFile_GetAt( storage_file_vector_view, 0, &storage_file );
+    CHECK_HR( hr );
+
+    IVectorView_StorageFile_Release( storage_file_vector_view );
+    IAsyncOperation_IVectorView_StorageFile_Release( storage_file_vector_view_operation );
+    return storage_file;
+}
+
+static IStorageFile *open_cache_test_file( IStorageFileStatics *storage_file_statics, const WCHAR *path )
+{
+    IAsyncOperation_StorageFile *storage_file_operation = NULL;
+    IStorageFile *storage_file = NULL;
+    HSTRING pathString;
+    DWORD asyncRes;
+    HRESULT hr;
+
+    WindowsCreateString( path, wcslen( path ), &pathString );
+    hr = IStorageFileStatics_GetFileFromPathAsync( storage_file_statics, pathString, &storage_file_operation );
+    CHECK_HR( hr );
+    asyncRes = await_IAsyncOperation_StorageFile( storage_file_operation, INFINITE );
+    ok( !asyncRes, "got asyncRes %#lx\n", asyncRes );
+    hr = IAsyncOperation_StorageFile_GetResults( storage_file_operation, &storage_file );
+    CHECK_HR( hr );
+
+    IAsyncOperation_StorageFile_Release( storage_file_operation );
+    WindowsDeleteString( pathString );
+    return storage_file;
+}
+
+void test_BasicPropertiesCache( const wchar_t* path )
+{
+    static const WCHAR *storage_folder_statics_name = L"Windows.Storage.StorageFolder";
+    static const WCHAR *storage_file_statics_name = L"Windows.Storage.StorageFile";
+
+    IStorageFolderStatics *storage_folder_statics = NULL;
+    IStorageFileStatics *storage_file_statics = NULL;
+
+    IStorageFolder *storage_folder = NULL;
+    IAsyncOperation_StorageFolder *storage_folder_operation = NULL;
+    IStorageFolderQueryOperations *storage_folder_query_operations = NULL;
+    IStorageFile *queried_file = NULL;
+    IStorageFile *opened_file = NULL;
+
+    WCHAR folderPath[MAX_PATH];
+    WCHAR filePath[MAX_PATH];
+    HSTRING pathString;
+
+    HRESULT hr;
+    DWORD asyncRes;
+    UINT64 size;
+
+    ACTIVATE_INSTANCE( storage_folder_statics_name, storage_folder_statics, IID_IStorageFolderStatics );
+    hr = WindowsCreateString( storage_file_statics_name, wcslen( storage_file_statics_name ), &pathString );
+    CHECK_HR( hr );
+    hr = RoGetActivationFactory( pathString, &IID_IStorageFileStatics, (void **)&storage_file_statics );
+    WindowsDeleteString( pathString );
+    CHECK_HR( hr );
+
+    wcscpy( folderPath, path );
+    PathAppendW( folderPath, L"CacheTestFolder" );
+    CreateDirectoryW( folderPath, NULL );
+    wcscpy( filePath, folderPath );
+    PathAppendW( filePath, L"CacheTestFile.tmp" );
+    write_cache_test_file( filePath, CREATE_ALWAYS, 4 );
+
+    WindowsCreateString( folderPath, wcslen( folderPath ), &pathString );
+    hr = IStorageFolderStatics_GetFolderFromPathAsync( storage_folder_statics, pathString, &storage_folder_operation );
+    CHECK_HR( hr );
+    asyncRes = await_IAsyncOperation_StorageFolder( storage_folder_operation, INFINITE );
+    ok( !asyncRes, "got asyncRes %#lx\n", asyncRes );
+    hr = IAsyncOperation_StorageFolder_GetResults( storage_folder_operation, &storage_folder );
+    CHECK_HR( hr );
+    WindowsDeleteString( pathString );
+
+    hr = IStorageFolder_QueryInterface( storage_folder, &IID_IStorageFolderQueryOperations, (void **)&storage_folder_query_operations );
+    CHECK_HR( hr );
+
+    //The query caches the properties of the folder items.
+    queried_file = query_cache_test_file( storage_folder_query_operations );
+    size = get_cached_file_size( queried_file );
+    ok( size == 4, "got size %I64u\n", size );
+    opened_file = open_cache_test_file( storage_file_statics, filePath );
+    size = get_cached_file_size( opened_file );
+    ok( size == 4, "got size %I64u\n", size );
+    IStorageFile_Release( opened_file );
+
+    //Growing the file invalidates the cached folder.
+    write_cache_test_file( filePath, OPEN_EXISTING, 6 );
+    opened_file = open_cache_test_file( storage_file_statics, filePath );
+    size = get_cached_file_size( opened_file );
+    ok( size == 10, "got size %I64u\n", size );
+    IStorageFile_Release( opened_file );
+    size = get_cached_file_size( queried_file );
+    ok( size == 10, "got size %I64u\n", size );
+    IStorageFile_Release( queried_file );
+
+    //So does replacing it once the folder was cached again.
+    queried_file = query_cache_test_file( storage_folder_query_operations );
+    IStorageFile_Release( queried_file );
+    DeleteFileW( filePath );
+    write_cache_test_file( filePath, CREATE_NEW, 2 );
+    opened_file = open_cache_test_file( storage_file_statics, filePath );
+    size = get_cached_file_size( opened_file );
+    ok( size == 2, "got size %I64u\n", size );
+    IStorageFile_Release( opened_file );
+
+    IStorageFolderQueryOperations_Release( storage_folder_query_operations );
+    IStorageFolder_Release( storage_folder );
+    IAsyncOperation_StorageFolder_Release( storage_folder_operation );
+    IStorageFileStatics_Release( storage_file_statics );
+    IStorageFolderStatics_Release( storage_folder_statics );
+
+    DeleteFileW( filePath );
+    RemoveDirectoryW( folderPath );
+}
+
 START_TEST(storage)
 {
     HRESULT hr;
@@ -774,6 +959,7 @@ START_TEST(storage)
     test_AppDataPathsStatics( &apppath );
     test_StorageFolder( apppath, &returnedItem, &returnedFile );
     test_StorageFile( apppath );
+    test_BasicPropertiesCache( apppath );
 
     RoUninitialize();
 }
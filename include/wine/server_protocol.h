@@ -1014,6 +1014,74 @@ struct obj_locator
 
 
 
+enum inproc_sync_type
+{
+    INPROC_SYNC_NONE,
+    INPROC_SYNC_EVENT,
+    INPROC_SYNC_MUTEX,
+    INPROC_SYNC_SEMAPHORE,
+    INPROC_SYNC_THREAD,
+};
+
+#define INPROC_SYNC_MANUAL_RESET  0x01
+#define INPROC_SYNC_ABANDONED     0x02
+
+typedef volatile struct
+{
+    unsigned int         type;
+    unsigned int         flags;
+    LONG64               state;
+    unsigned int         max;
+    unsigned int         serial;
+    unsigned int         waiters;
+    unsigned int         server_waiters;
+    unsigned int         next_owned;
+    unsigned int         pulse;
+} inproc_sync_shm_t;
+
+#define INPROC_SYNC_COUNT(state)         ((unsigned int)(state))
+#define INPROC_SYNC_OWNER(state)         ((thread_id_t)((unsigned __int64)(state) >> 32))
+#define INPROC_SYNC_STATE(count,owner)   ((LONG64)(((unsigned __int64)(owner) << 32) | (unsigned int)(count)))
+
+#define INPROC_SYNC_SLOTS  16384
+
+
+
+
+#define REGISTRY_SHM_SIZE    (4 * 1024 * 1024)
+#define REGISTRY_SHM_CHUNK   (64 * 1024)
+#define REGISTRY_SHM_CHUNKS  (REGISTRY_SHM_SIZE / REGISTRY_SHM_CHUNK)
+
+typedef volatile struct
+{
+    unsigned int         size;
+    unsigned int         casemap_offset;
+    unsigned int         casemap_size;
+    unsigned int         __pad;
+    unsigned int         generation[REGISTRY_SHM_CHUNKS];
+} registry_shm_t;
+
+typedef volatile struct
+{
+    unsigned int         type;
+    unsigned int         namelen;
+    unsigned int         name_offset;
+    unsigned int         datalen;
+    unsigned int         data_offset;
+} registry_value_shm_t;
+
+typedef volatile struct
+{
+    unsigned int         seq;
+    unsigned int         size;
+    unsigned int         nb_values;
+    unsigned int         __pad;
+    registry_value_shm_t values[1];
+} registry_key_shm_t;
+
+
+
+
 
 struct new_process_request
 {
@@ -1770,6 +1838,62 @@ struct open_semaphore_reply
 
 
 
+struct get_inproc_sync_request
+{
+    struct request_header __header;
+    obj_handle_t handle;
+};
+struct get_inproc_sync_reply
+{
+    struct reply_header __header;
+    unsigned int index;
+    unsigned int type;
+    unsigned int access;
+    char __pad_20[4];
+};
+
+
+
+struct get_inproc_sync_section_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+};
+struct get_inproc_sync_section_reply
+{
+    struct reply_header __header;
+    obj_handle_t handle;
+    char __pad_12[4];
+};
+
+
+
+struct get_inproc_sync_thread_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+};
+struct get_inproc_sync_thread_reply
+{
+    struct reply_header __header;
+    unsigned int index;
+    char __pad_12[4];
+};
+
+
+
+struct signal_inproc_sync_request
+{
+    struct request_header __header;
+    obj_handle_t handle;
+};
+struct signal_inproc_sync_reply
+{
+    struct reply_header __header;
+};
+
+
+
 struct create_file_request
 {
     struct request_header __header;
@@ -2512,7 +2636,9 @@ struct open_key_reply
 {
     struct reply_header __header;
     obj_handle_t hkey;
-    char __pad_12[4];
+    unsigned int generation;
+    unsigned int shm_offset;
+    char __pad_20[4];
 };
 
 
@@ -2593,6 +2719,8 @@ struct get_key_value_reply
     struct reply_header __header;
     int          type;
     data_size_t  total;
+    unsigned int generation;
+    unsigned int shm_offset;
     /* VARARG(data,bytes); */
 };
 
@@ -5517,6 +5645,20 @@ struct add_fd_completion_reply
 
 
 
+struct get_fd_completion_request
+{
+    struct request_header __header;
+    obj_handle_t   handle;
+};
+struct get_fd_completion_reply
+{
+    struct reply_header __header;
+    int            bound;
+    char __pad_12[4];
+};
+
+
+
 struct set_fd_completion_mode_request
 {
     struct request_header __header;
@@ -5929,6 +6071,10 @@ enum request
     REQ_release_semaphore,
     REQ_query_semaphore,
     REQ_open_semaphore,
+    REQ_get_inproc_sync,
+    REQ_get_inproc_sync_section,
+    REQ_get_inproc_sync_thread,
+    REQ_signal_inproc_sync,
     REQ_create_file,
     REQ_open_file_object,
     REQ_alloc_file_handle,
@@ -6153,6 +6299,7 @@ enum request
     REQ_query_completion,
     REQ_set_completion_info,
     REQ_add_fd_completion,
+    REQ_get_fd_completion,
     REQ_set_fd_completion_mode,
     REQ_set_fd_disp_info,
     REQ_set_fd_name_info,
@@ -6228,6 +6375,10 @@ union generic_request
     struct release_semaphore_request release_semaphore_request;
     struct query_semaphore_request query_semaphore_request;
     struct open_semaphore_request open_semaphore_request;
+    struct get_inproc_sync_request get_inproc_sync_request;
+    struct get_inproc_sync_section_request get_inproc_sync_section_request;
+    struct get_inproc_sync_thread_request get_inproc_sync_thread_request;
+    struct signal_inproc_sync_request signal_inproc_sync_request;
     struct create_file_request create_file_request;
     struct open_file_object_request open_file_object_request;
     struct alloc_file_handle_request alloc_file_handle_request;
@@ -6452,6 +6603,7 @@ union generic_request
     struct query_completion_request query_completion_request;
     struct set_completion_info_request set_completion_info_request;
     struct add_fd_completion_request add_fd_completion_request;
+    struct get_fd_completion_request get_fd_completion_request;
     struct set_fd_completion_mode_request set_fd_completion_mode_request;
     struct set_fd_disp_info_request set_fd_disp_info_request;
     struct set_fd_name_info_request set_fd_name_info_request;
@@ -6525,6 +6677,10 @@ union generic_reply
     struct release_semaphore_reply release_semaphore_reply;
     struct query_semaphore_reply query_semaphore_reply;
     struct open_semaphore_reply open_semaphore_reply;
+    struct get_inproc_sync_reply get_inproc_sync_reply;
+    struct get_inproc_sync_section_reply get_inproc_sync_section_reply;
+    struct get_inproc_sync_thread_reply get_inproc_sync_thread_reply;
+    struct signal_inproc_sync_reply signal_inproc_sync_reply;
     struct create_file_reply create_file_reply;
     struct open_file_object_reply open_file_object_reply;
     struct alloc_file_handle_reply alloc_file_handle_reply;
@@ -6749,6 +6905,7 @@ union generic_reply
     struct query_completion_reply query_completion_reply;
     struct set_completion_info_reply set_completion_info_reply;
     struct add_fd_completion_reply add_fd_completion_reply;
+    struct get_fd_completion_reply get_fd_completion_reply;
     struct set_fd_completion_mode_reply set_fd_completion_mode_reply;
     struct set_fd_disp_info_reply set_fd_disp_info_reply;
     struct set_fd_name_info_reply set_fd_name_info_reply;
@@ -6775,6 +6932,6 @@ union generic_reply
     struct set_keyboard_repeat_reply set_keyboard_repeat_reply;
 };
 
-#define SERVER_PROTOCOL_VERSION 854
+#define SERVER_PROTOCOL_VERSION 861
 
 #endif /* __WINE_WINE_SERVER_PROTOCOL_H */
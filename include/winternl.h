@@ -2155,6 +2155,7 @@ typedef enum _SYSTEM_INFORMATION_CLASS {
     SystemOriginalImageFeatureInformation = 238,
 #ifdef __WINESRC__
     SystemWineVersionInformation = 1000,
+    SystemWineLargePageMinimum = 1001,
 #endif
 } SYSTEM_INFORMATION_CLASS, *PSYSTEM_INFORMATION_CLASS;
 
@@ -0,0 +1,273 @@
+/**
+ * WineCoreUAP Appx Package Cache.
+ * 
+ * Written by Weather
+ * 
+ * This module keeps parsed appx manifests in a binary store.
+ */
+
+#include <windows.h>
+#include <wchar.h>
+
+#include "include/cache.h"
+
+#define APPX_CACHE_STRINGS 6
+
+static bool getCacheRecordPath( const wchar_t * manifestPath, wchar_t *recordPath, size_t recordPathSize, bool create );
+static bool readCacheString( const BYTE **cursor, const BYTE *end, const wchar_t **string );
+static void storeAppxPackage( const wchar_t * manifestPath, const WIN32_FILE_ATTRIBUTE_DATA *manifestData, const struct appx_package *package );
+
+/**
+ * loadAppxPackage
+ *
+ * Same as registerAppxPackage, but a manifest that did not change since it was last parsed
+ * is served from the store with a single mapped read. Packages served from the store carry
+ * no DOM, manifest, Resources and Capabilities are NULL and CapabilityNames has to be used.
+ */
+appxstatus
+loadAppxPackage( const wchar_t * manifestPath, struct appx_package *package )
+{
+    WIN32_FILE_ATTRIBUTE_DATA manifestData;
+    const struct appx_cache_header *header;
+    const wchar_t *strings[APPX_CACHE_STRINGS];
+    const BYTE *cursor;
+    const BYTE *end;
+    wchar_t recordPath[MAX_PATH];
+    LARGE_INTEGER recordSize;
+    HANDLE record;
+    HANDLE mapping;
+    BYTE *view = NULL;
+    BYTE *copy = NULL;
+    uint32_t i;
+
+    memset( package, 0, sizeof(*package) );
+    if ( !GetFileAttributesExW( manifestPath, GetFileExInfoStandard, &manifestData ) )
+        return registerAppxPackage( manifestPath, package );
+
+    if ( !getCacheRecordPath( manifestPath, recordPath, MAX_PATH, false ) )
+        return registerAppxPackage( manifestPath, package );
+
+    record = CreateFileW( recordPath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, 0, NULL );
+    if ( record != INVALID_HANDLE_VALUE )
+    {
+        if ( GetFileSizeEx( record, &recordSize ) && recordSize.QuadPart >= sizeof(*header) && recordSize.QuadPart < 0x100000
+            && (mapping = CreateFileMappingW( record, NULL, PAGE_READONLY, 0, 0, NULL )) )
+        {
+            view = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+            CloseHandle( mapping );
+        }
+        CloseHandle( record );
+    }
+
+    if ( view )
+    {
+        header = (const struct appx_cache_header *)view;
+        cursor = view + sizeof(*header);
+        end = view + recordSize.QuadPart;
+
+        if ( header->magic != APPX_CACHE_MAGIC || header->version != APPX_CACHE_VERSION || header->recordSize != recordSize.QuadPart
+            || header->manifestWriteTime != (((uint64_t)manifestData.ftLastWriteTime.dwHighDateTime << 32) | manifestData.ftLastWriteTime.dwLowDateTime)
+            || header->manifestSize != (((uint64_t)manifestData.nFileSizeHigh << 32) | manifestData.nFileSizeLow)
+            || header->capabilityCount > (end - cursor) / sizeof(uint32_t) )
+            goto miss;
+
+        //The strings point into a private copy, the record can be replaced once it is unmapped.
+        copy = malloc( header->capabilityCount * sizeof(wchar_t *) + (end - cursor) );
+        if ( copy == NULL ) goto miss;
+        memcpy( copy + header->capabilityCount * sizeof(wchar_t *), cursor, end - cursor );
+        cursor = copy + header->capabilityCount * sizeof(wchar_t *);
+        end = cursor + (recordSize.QuadPart - sizeof(*header));
+
+        for ( i = 0; i < APPX_CACHE_STRINGS; i++ )
+            if ( !readCacheString( &cursor, end, &strings[i] ) ) goto miss;
+
+        //Hash collisions are told apart by the path stored in the record.
+        if ( !strings[0] || _wcsicmp( strings[0], manifestPath ) ) goto miss;
+
+        memset( package, 0, sizeof(*package) );
+        package->manifestPath = manifestPath;
+        package->cacheRecord = copy;
+        package->Package.Identity.Name = strings[1];
+        package->Package.Identity.Publisher = strings[2];
+        package->Package.Identity.Version = header->packageVersion;
+        package->Package.Identity.Architecture = header->architecture;
+        package->Package.Properties.DisplayName = strings[3];
+        package->Package.Properties.PublisherDisplayName = strings[4];
+        package->Package.Properties.Logo = strings[5];
+
+        package->Package.CapabilityNames.Names = (const wchar_t **)copy;
+        for ( i = 0; i < header->capabilityCount; i++ )
+            if ( !readCacheString( &cursor, end, &package->Package.CapabilityNames.Names[i] ) ) goto miss;
+        package->Package.CapabilityNames.Count = header->capabilityCount;
+
+        UnmapViewOfFile( view );
+        return STATUS_SUCCESS;
+    }
+
+miss:
+    if ( view ) UnmapViewOfFile( view );
+    free( copy );
+    package->cacheRecord = NULL;
+    memset( &package->Package, 0, sizeof(package->Package) );
+
+    if ( !OK( registerAppxPackage( manifestPath, package ) ) )
+        return STATUS_FAIL;
+
+    storeAppxPackage( manifestPath, &manifestData, package );
+    return STATUS_SUCCESS;
+}
+
+static bool
+getCacheRecordPath( const wchar_t * manifestPath, wchar_t *recordPath, size_t recordPathSize, bool create )
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    DWORD length;
+
+    //FNV-1a over the lower cased path, paths are case insensitive.
+    for ( const wchar_t *c = manifestPath; *c; c++ )
+    {
+        hash ^= towlower( *c );
+        hash *= 0x100000001b3ull;
+    }
+
+    length = GetEnvironmentVariableW( L"ProgramData", recordPath, recordPathSize );
+    if ( !length || length + 40 > recordPathSize ) return false;
+
+    wcscat( recordPath, L"\\WineCoreUAP" );
+    if ( create ) CreateDirectoryW( recordPath, NULL );
+    wcscat( recordPath, L"\\AppxCache" );
+    if ( create ) CreateDirectoryW( recordPath, NULL );
+
+    length = wcslen( recordPath );
+    swprintf( recordPath + length, recordPathSize - length, L"\\%08x%08x.bin", (unsigned int)(hash >> 32), (unsigned int)hash );
+    return true;
+}
+
+/**
+ * freeAppxPackage
+ *
+ * Releases what loadAppxPackage allocated, the record of a package served from the store
+ * or the capability names of a parsed one. Also safe after loadAppxPackage failed.
+ */
+void
+freeAppxPackage( struct appx_package *package )
+{
+    //Served from the store, the names point into the record.
+    if ( package->cacheRecord )
+    {
+        free( package->cacheRecord );
+        package->cacheRecord = NULL;
+    }
+    else
+    {
+        for ( size_t i = 0; i < package->Package.CapabilityNames.Count; i++ )
+            free( (wchar_t *)package->Package.CapabilityNames.Names[i] );
+        free( (void *)package->Package.CapabilityNames.Names );
+    }
+
+    package->Package.CapabilityNames.Names = NULL;
+    package->Package.CapabilityNames.Count = 0;
+}
+
+static bool
+readCacheString( const BYTE **cursor, const BYTE *end, const wchar_t **string )
+{
+    uint32_t length;
+
+    if ( end - *cursor < sizeof(length) ) return false;
+    memcpy( &length, *cursor, sizeof(length) );
+    *cursor += sizeof(length);
+
+    if ( length == APPX_CACHE_NULL_STRING )
+    {
+        *string = NULL;
+        return true;
+    }
+
+    if ( !length || (end - *cursor) / sizeof(wchar_t) < length ) return false;
+    *string = (const wchar_t *)*cursor;
+    if ( (*string)[length - 1] ) return false;
+
+    *cursor += length * sizeof(wchar_t);
+    return true;
+}
+
+static BYTE *
+writeCacheString( BYTE *cursor, const wchar_t *string )
+{
+    uint32_t length = string ? wcslen( string ) + 1 : APPX_CACHE_NULL_STRING;
+
+    memcpy( cursor, &length, sizeof(length) );
+    cursor += sizeof(length);
+    if ( !string ) return cursor;
+
+    memcpy( cursor, string, length * sizeof(wchar_t) );
+    return cursor + length * sizeof(wchar_t);
+}
+
+/**
+ * storeAppxPackage
+ *
+ * Failing to store a record is not an error, the manifest is just parsed again next time.
+ */
+static void
+storeAppxPackage( const wchar_t * manifestPath, const WIN32_FILE_ATTRIBUTE_DATA *manifestData, const struct appx_package *package )
+{
+    const wchar_t *strings[APPX_CACHE_STRINGS];
+    struct appx_cache_header *header;
+    wchar_t recordPath[MAX_PATH];
+    wchar_t temporaryPath[MAX_PATH];
+    size_t recordSize = sizeof(*header);
+    BYTE *buffer;
+    BYTE *cursor;
+    HANDLE record;
+    DWORD written = 0;
+    size_t i;
+
+    strings[0] = manifestPath;
+    strings[1] = package->Package.Identity.Name;
+    strings[2] = package->Package.Identity.Publisher;
+    strings[3] = package->Package.Properties.DisplayName;
+    strings[4] = package->Package.Properties.PublisherDisplayName;
+    strings[5] = package->Package.Properties.Logo;
+
+    for ( i = 0; i < APPX_CACHE_STRINGS; i++ )
+        recordSize += sizeof(uint32_t) + ( strings[i] ? ( wcslen( strings[i] ) + 1 ) * sizeof(wchar_t) : 0 );
+    for ( i = 0; i < package->Package.CapabilityNames.Count; i++ )
+        recordSize += sizeof(uint32_t) + ( wcslen( package->Package.CapabilityNames.Names[i] ) + 1 ) * sizeof(wchar_t);
+
+    if ( !getCacheRecordPath( manifestPath, recordPath, MAX_PATH, true ) ) return;
+
+    buffer = calloc( 1, recordSize );
+    if ( buffer == NULL ) return;
+
+    header = (struct appx_cache_header *)buffer;
+    header->magic = APPX_CACHE_MAGIC;
+    header->version = APPX_CACHE_VERSION;
+    header->manifestWriteTime = ((uint64_t)manifestData->ftLastWriteTime.dwHighDateTime << 32) | manifestData->ftLastWriteTime.dwLowDateTime;
+    header->manifestSize = ((uint64_t)manifestData->nFileSizeHigh << 32) | manifestData->nFileSizeLow;
+    header->packageVersion = package->Package.Identity.Version;
+    header->architecture = package->Package.Identity.Architecture;
+    header->capabilityCount = package->Package.CapabilityNames.Count;
+    header->recordSize = recordSize;
+
+    cursor = buffer + sizeof(*header);
+    for ( i = 0; i < APPX_CACHE_STRINGS; i++ )
+        cursor = writeCacheString( cursor, strings[i] );
+    for ( i = 0; i < package->Package.CapabilityNames.Count; i++ )
+        cursor = writeCacheString( cursor, package->Package.CapabilityNames.Names[i] );
+
+    //Written aside and moved in place, concurrent readers only ever see whole records.
+    swprintf( temporaryPath, MAX_PATH, L"%s.%lx", recordPath, GetCurrentProcessId() );
+    record = CreateFileW( temporaryPath, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_TEMPORARY, NULL );
+    if ( record != INVALID_HANDLE_VALUE )
+    {
+        WriteFile( record, buffer, recordSize, &written, NULL );
+        CloseHandle( record );
+
+        if ( written != recordSize || !MoveFileExW( temporaryPath, recordPath, MOVEFILE_REPLACE_EXISTING ) )
+            DeleteFileW( temporaryPath );
+    }
+
+    free( buffer );
+}
@@ -1,3 +1,4 @@
+#include "cache.h"
 #include "package.h"
 #include "read.h"
 #include "util.h"
@@ -0,0 +1,42 @@
+/**
+ * WineCoreUAP Appx Package Cache.
+ * 
+ * Written by Weather
+ * 
+ * This module keeps parsed appx manifests in a binary store.
+ */
+
+#ifndef _CACHE_H_
+#define _CACHE_H_
+
+#include <stdint.h>
+
+#include "package.h"
+
+#define APPX_CACHE_MAGIC 0x43585041 /* APXC */
+#define APPX_CACHE_VERSION 2
+/* Stored in place of the length of a string that is NULL, no characters follow it. */
+#define APPX_CACHE_NULL_STRING 0xffffffff
+
+/**
+ * A cached record is a single file under %ProgramData%\WineCoreUAP\AppxCache, named after
+ * a hash of the manifest path. The header is followed by the strings, each one stored as
+ * its length in characters and the characters themselves, terminator included, or just
+ * APPX_CACHE_NULL_STRING for a string that is NULL:
+ * the manifest path, the identity and properties strings, then the capability names.
+ */
+struct appx_cache_header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t manifestWriteTime;
+    uint64_t manifestSize;
+    struct app_version packageVersion;
+    uint32_t architecture;
+    uint32_t capabilityCount;
+    uint32_t recordSize;
+};
+
+appxstatus loadAppxPackage( const wchar_t * manifestPath, struct appx_package *package );
+void freeAppxPackage( struct appx_package *package );
+
+#endif
@@ -30,20 +30,29 @@ struct appx_identity {
     enum Architecture Architecture;
 };
 
+struct appx_capability_names {
+    size_t Count;
+    const wchar_t ** Names;
+};
+
 struct appx {
     struct appx_identity Identity;
     struct appx_properties Properties;
     appxResourceList Resources;
     appxCapabilityList Capabilities;
+    struct appx_capability_names CapabilityNames;
 };
 
 struct appx_package {
     const wchar_t* manifestPath;
     xmlNode* manifest;
+    /* Backs the strings of a package served from the store, see freeAppxPackage. */
+    void* cacheRecord;
 
     struct appx Package;
 };
 
 appxstatus registerAppxPackage( const wchar_t * manifestPath, struct appx_package *package );
+bool appxHasCapability( const struct appx_package *package, const wchar_t * name );
 
 #endif
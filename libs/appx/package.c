@@ -12,6 +12,7 @@ static appxstatus assignAppxIdentity( xmlNode * manifest, struct appx_identity *
 static appxstatus assignAppxProperties( xmlNode * manifest, struct appx_properties *Properties );
 static appxstatus assignAppxCapabilities( xmlNode * manifest, appxCapabilityList *List );
 static appxstatus assignAppxResources( xmlNode * manifest, appxResourceList *List );
+static appxstatus assignAppxCapabilityNames( appxCapabilityList List, struct appx_capability_names *Names );
 
 /**
  * registerAppxPackage
@@ -36,6 +37,7 @@ registerAppxPackage( const wchar_t * manifestPath, struct appx_package *package
 
     wcstombs(manifestPathStr, manifestPath, len);
 
+    memset( &package->Package, 0, sizeof(package->Package) );
     package->manifestPath = manifestPath;
     status = readManifest( manifestPathStr, &package->manifest );
     if ( !OK( status ) ) return STATUS_FAIL;
@@ -52,6 +54,9 @@ registerAppxPackage( const wchar_t * manifestPath, struct appx_package *package
     status = assignAppxCapabilities( package->manifest, &package->Package.Capabilities );
     if ( !OK( status ) ) return STATUS_FAIL;
 
+    status = assignAppxCapabilityNames( package->Package.Capabilities, &package->Package.CapabilityNames );
+    if ( !OK( status ) ) return STATUS_FAIL;
+
     status = assignAppxResources( package->manifest, &package->Package.Resources );
 
     return status;
@@ -211,4 +216,56 @@ assignAppxResources( xmlNode * manifest, appxResourceList *List )
     }
 
     return STATUS_SUCCESS;
+}
+
+static appxstatus
+assignAppxCapabilityNames( appxCapabilityList List, struct appx_capability_names *Names )
+{
+    xmlChar* Name;
+    size_t count = 0;
+
+    for ( xmlNode *capabilityNode = List; capabilityNode; capabilityNode = capabilityNode->next )
+    {
+        if ( capabilityNode->type == XML_ELEMENT_NODE
+            && !xmlStrcmp( capabilityNode->name, (const xmlChar*)"Capability" ) )
+            count++;
+    }
+
+    Names->Count = 0;
+    Names->Names = NULL;
+    if ( !count ) return STATUS_SUCCESS;
+
+    Names->Names = malloc( count * sizeof(*Names->Names) );
+    if ( Names->Names == NULL ) return STATUS_FAIL;
+
+    for ( xmlNode *capabilityNode = List; capabilityNode; capabilityNode = capabilityNode->next )
+    {
+        if ( capabilityNode->type == XML_ELEMENT_NODE
+            && !xmlStrcmp( capabilityNode->name, (const xmlChar*)"Capability" ) )
+        {
+            Name = xmlGetProp( capabilityNode, (const xmlChar *)"Name" );
+            if ( !Name ) continue;
+
+            Names->Names[Names->Count] = charToWChar( (const char *)Name );
+            xmlFree( Name );
+            if ( Names->Names[Names->Count] ) Names->Count++;
+        }
+    }
+
+    return STATUS_SUCCESS;
+}
+
+/**
+ * appxHasCapability
+ */
+bool
+appxHasCapability( const struct appx_package *package, const wchar_t * name )
+{
+    for ( size_t i = 0; i < package->Package.CapabilityNames.Count; i++ )
+    {
+        if ( !wcscmp( package->Package.CapabilityNames.Names[i], name ) )
+            return true;
+    }
+
+    return false;
 }
\ No newline at end of file
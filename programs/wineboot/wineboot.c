@@ -390,6 +390,7 @@ static void create_user_shared_data(void)
     RTL_OSVERSIONINFOEXW version;
     SYSTEM_CPU_INFORMATION sci;
     SYSTEM_BASIC_INFORMATION sbi;
+    ULONG large_page_size = 2 * 1024 * 1024;
     BOOLEAN *features;
     OBJECT_ATTRIBUTES attr = {sizeof(attr)};
     UNICODE_STRING name = RTL_CONSTANT_STRING( L"\\KernelObjects\\__wine_user_shared_data" );
@@ -416,9 +417,11 @@ static void create_user_shared_data(void)
     RtlGetVersion( &version );
     NtQuerySystemInformation( SystemBasicInformation, &sbi, sizeof(sbi), NULL );
     NtQuerySystemInformation( SystemCpuInformation, &sci, sizeof(sci), NULL );
+    /* the size ntdll actually uses for MEM_LARGE_PAGES */
+    NtQuerySystemInformation( SystemWineLargePageMinimum, &large_page_size, sizeof(large_page_size), NULL );
 
     data->TickCountMultiplier         = 1 << 24;
-    data->LargePageMinimum            = 2 * 1024 * 1024;
+    data->LargePageMinimum            = large_page_size;
     data->NtBuildNumber               = version.dwBuildNumber;
     data->NtProductType               = version.wProductType;
     data->ProductTypeIsValid          = TRUE;
@@ -499,6 +499,8 @@ void init_directories( struct fd *intl_fd )
     session_mapping = create_session_mapping( &dir_kernel->obj, &session_str, OBJ_PERMANENT, NULL );
     set_session_mapping( session_mapping );
     release_object( session_mapping );
+    init_inproc_sync();
+    init_registry_shm( &dir_kernel->obj );
 
     release_object( named_pipe_device );
     release_object( mailslot_device );
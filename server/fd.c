@@ -326,14 +326,33 @@ static file_pos_t max_unix_offset = OFF_T_MAX;
 
 struct timeout_user
 {
-    struct list           entry;      /* entry in sorted timeout list */
+    struct list           entry;      /* entry in expired timeout list */
+    int                   index;      /* index in the timeout heap, -1 once expired */
     abstime_t             when;       /* timeout expiry */
     timeout_callback      callback;   /* callback function */
     void                 *private;    /* callback private data */
 };
 
-static struct list abs_timeout_list = LIST_INIT(abs_timeout_list); /* sorted absolute timeouts list */
-static struct list rel_timeout_list = LIST_INIT(rel_timeout_list); /* sorted relative timeouts list */
+/* binary min-heap of timeouts, ordered by expiry */
+struct timeout_heap
+{
+    struct timeout_user **users;      /* heap array */
+    int                   count;      /* number of pending timeouts */
+    int                   size;       /* allocated size of the array */
+};
+
+static struct timeout_heap abs_timeouts;  /* absolute timeouts, earliest when first */
+static struct timeout_heap rel_timeouts;  /* relative timeouts, largest (negative) when first */
+
+/* timeout statistics, dumped on SIGHUP */
+static struct
+{
+    unsigned int max_pending;         /* highest number of pending timeouts */
+    unsigned long long added;         /* timeouts added */
+    unsigned long long removed;       /* timeouts removed before expiring */
+    unsigned long long expired;       /* timeouts expired */
+    unsigned long long steps;         /* heap levels walked by all operations */
+} timeout_stats;
 timeout_t current_time;
 timeout_t monotonic_time;
 
@@ -410,46 +429,135 @@ void set_current_time(void)
     if (user_shared_data) set_user_shared_data_time();
 }
 
+/* absolute timeouts expire in increasing order, relative ones are negative and expire in decreasing order */
+static inline int timeout_before( const struct timeout_user *a, const struct timeout_user *b )
+{
+    return a->when > 0 ? a->when < b->when : a->when > b->when;
+}
+
+static inline struct timeout_heap *get_timeout_heap( const struct timeout_user *user )
+{
+    return user->when > 0 ? &abs_timeouts : &rel_timeouts;
+}
+
+static inline void set_heap_entry( struct timeout_heap *heap, int index, struct timeout_user *user )
+{
+    heap->users[index] = user;
+    user->index = index;
+}
+
+static void timeout_heap_sift_up( struct timeout_heap *heap, int index )
+{
+    struct timeout_user *user = heap->users[index];
+
+    while (index > 0)
+    {
+        int parent = (index - 1) / 2;
+        if (!timeout_before( user, heap->users[parent] )) break;
+        set_heap_entry( heap, index, heap->users[parent] );
+        index = parent;
+        timeout_stats.steps++;
+    }
+    set_heap_entry( heap, index, user );
+}
+
+static void timeout_heap_sift_down( struct timeout_heap *heap, int index )
+{
+    struct timeout_user *user = heap->users[index];
+
+    for (;;)
+    {
+        int child = 2 * index + 1;
+        if (child >= heap->count) break;
+        if (child + 1 < heap->count && timeout_before( heap->users[child + 1], heap->users[child] )) child++;
+        if (!timeout_before( heap->users[child], user )) break;
+        set_heap_entry( heap, index, heap->users[child] );
+        index = child;
+        timeout_stats.steps++;
+    }
+    set_heap_entry( heap, index, user );
+}
+
+static int timeout_heap_insert( struct timeout_heap *heap, struct timeout_user *user )
+{
+    unsigned int pending;
+
+    if (heap->count == heap->size)
+    {
+        int new_size = max( heap->size * 2, 64 );
+        struct timeout_user **new_users = realloc( heap->users, new_size * sizeof(*new_users) );
+
+        if (!new_users)
+        {
+            set_error( STATUS_NO_MEMORY );
+            return 0;
+        }
+        heap->users = new_users;
+        heap->size  = new_size;
+    }
+    heap->users[heap->count] = user;
+    timeout_heap_sift_up( heap, heap->count++ );
+
+    pending = abs_timeouts.count + rel_timeouts.count;
+    if (pending > timeout_stats.max_pending) timeout_stats.max_pending = pending;
+    return 1;
+}
+
+static void timeout_heap_remove( struct timeout_heap *heap, struct timeout_user *user )
+{
+    int index = user->index;
+    struct timeout_user *last = heap->users[--heap->count];
+
+    user->index = -1;
+    if (last == user) return;
+
+    set_heap_entry( heap, index, last );
+    if (index > 0 && timeout_before( last, heap->users[(index - 1) / 2] ))
+        timeout_heap_sift_up( heap, index );
+    else
+        timeout_heap_sift_down( heap, index );
+}
+
 /* add a timeout user */
 struct timeout_user *add_timeout_user( timeout_t when, timeout_callback func, void *private )
 {
     struct timeout_user *user;
-    struct list *ptr;
 
     if (!(user = mem_alloc( sizeof(*user) ))) return NULL;
     user->when     = timeout_to_abstime( when );
     user->callback = func;
     user->private  = private;
 
-    /* Now insert it in the linked list */
-
-    if (user->when > 0)
-    {
-        LIST_FOR_EACH( ptr, &abs_timeout_list )
-        {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
-            if (timeout->when >= user->when) break;
-        }
-    }
-    else
+    if (!timeout_heap_insert( get_timeout_heap( user ), user ))
     {
-        LIST_FOR_EACH( ptr, &rel_timeout_list )
-        {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
-            if (timeout->when <= user->when) break;
-        }
+        free( user );
+        return NULL;
     }
-    list_add_before( ptr, &user->entry );
+    timeout_stats.added++;
     return user;
 }
 
 /* remove a timeout user */
 void remove_timeout_user( struct timeout_user *user )
 {
-    list_remove( &user->entry );
+    /* expired timeouts are still in the expired list until their callback runs */
+    if (user->index == -1) list_remove( &user->entry );
+    else timeout_heap_remove( get_timeout_heap( user ), user );
+    timeout_stats.removed++;
     free( user );
 }
 
+/* dump the timeout statistics */
+void dump_timeout_stats(void)
+{
+    unsigned long long ops = timeout_stats.added + timeout_stats.removed + timeout_stats.expired;
+
+    fprintf( stderr, "wineserver: timeouts pending=%u (abs=%u rel=%u) max=%u added=%llu removed=%llu "
+             "expired=%llu steps/op=%.2f\n", abs_timeouts.count + rel_timeouts.count, abs_timeouts.count,
+             rel_timeouts.count, timeout_stats.max_pending, timeout_stats.added, timeout_stats.removed,
+             timeout_stats.expired, ops ? (double)timeout_stats.steps / ops : 0.0 );
+}
+
 /* return a text description of a timeout for debugging purposes */
 const char *get_timeout_str( timeout_t timeout )
 {
@@ -881,34 +989,26 @@ static int get_next_timeout(void)
 {
     int ret = user_shared_data ? user_shared_data_timeout : -1;
 
-    if (!list_empty( &abs_timeout_list ) || !list_empty( &rel_timeout_list ))
+    if (abs_timeouts.count || rel_timeouts.count)
     {
         struct list expired_list, *ptr;
 
-        /* first remove all expired timers from the list */
+        /* first remove all expired timers from the heaps */
 
         list_init( &expired_list );
-        while ((ptr = list_head( &abs_timeout_list )) != NULL)
+        while (abs_timeouts.count && abs_timeouts.users[0]->when <= current_time)
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
-
-            if (timeout->when <= current_time)
-            {
-                list_remove( &timeout->entry );
-                list_add_tail( &expired_list, &timeout->entry );
-            }
-            else break;
+            struct timeout_user *timeout = abs_timeouts.users[0];
+            timeout_heap_remove( &abs_timeouts, timeout );
+            list_add_tail( &expired_list, &timeout->entry );
+            timeout_stats.expired++;
         }
-        while ((ptr = list_head( &rel_timeout_list )) != NULL)
+        while (rel_timeouts.count && -rel_timeouts.users[0]->when <= monotonic_time)
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
-
-            if (-timeout->when <= monotonic_time)
-            {
-                list_remove( &timeout->entry );
-                list_add_tail( &expired_list, &timeout->entry );
-            }
-            else break;
+            struct timeout_user *timeout = rel_timeouts.users[0];
+            timeout_heap_remove( &rel_timeouts, timeout );
+            list_add_tail( &expired_list, &timeout->entry );
+            timeout_stats.expired++;
         }
 
         /* now call the callback for all the removed timers */
@@ -921,18 +1021,18 @@ static int get_next_timeout(void)
             free( timeout );
         }
 
-        if ((ptr = list_head( &abs_timeout_list )) != NULL)
+        if (abs_timeouts.count)
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
+            struct timeout_user *timeout = abs_timeouts.users[0];
             timeout_t diff = (timeout->when - current_time + 9999) / 10000;
             if (diff > INT_MAX) diff = INT_MAX;
             else if (diff < 0) diff = 0;
             if (ret == -1 || diff < ret) ret = diff;
         }
 
-        if ((ptr = list_head( &rel_timeout_list )) != NULL)
+        if (rel_timeouts.count)
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
+            struct timeout_user *timeout = rel_timeouts.users[0];
             timeout_t diff = (-timeout->when - monotonic_time + 9999) / 10000;
             if (diff > INT_MAX) diff = INT_MAX;
             else if (diff < 0) diff = 0;
@@ -2940,6 +3040,17 @@ DECL_HANDLER(add_fd_completion)
     }
 }
 
+/* check whether a completion port is associated with a file */
+DECL_HANDLER(get_fd_completion)
+{
+    struct fd *fd = get_handle_fd_obj( current->process, req->handle, 0 );
+    if (fd)
+    {
+        reply->bound = fd->completion != NULL;
+        release_object( fd );
+    }
+}
+
 /* set fd completion information */
 DECL_HANDLER(set_fd_completion_mode)
 {
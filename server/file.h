@@ -157,6 +157,7 @@ static inline timeout_t abstime_to_timeout( abstime_t abstime )
 extern void set_current_time( void );
 extern struct timeout_user *add_timeout_user( timeout_t when, timeout_callback func, void *private );
 extern void remove_timeout_user( struct timeout_user *user );
+extern void dump_timeout_stats(void);
 extern const char *get_timeout_str( timeout_t timeout );
 
 /* file functions */
@@ -192,6 +193,9 @@ extern struct object *create_user_data_mapping( struct object *root, const struc
 extern struct mapping *create_session_mapping( struct object *root, const struct unicode_str *name,
                                                unsigned int attr, const struct security_descriptor *sd );
 extern void set_session_mapping( struct mapping *mapping );
+extern void *create_shared_mapping( struct object *root, const struct unicode_str *name, mem_size_t size,
+                                    const struct security_descriptor *sd );
+extern struct object *create_private_shared_mapping( mem_size_t size, void **ptr );
 
 extern const volatile void *alloc_shared_object(void);
 extern void free_shared_object( const volatile void *object_shm );
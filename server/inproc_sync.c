@@ -0,0 +1,459 @@
+/*
+ * Server-side in-process synchronization objects
+ *
+ * Copyright (C) 2026 the Wine project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * Events, mutexes and semaphores can keep their state in a section shared
+ * with the clients, so that ntdll can signal and wait on them with atomic
+ * operations and futexes instead of a server round-trip. The server stays
+ * the owner of the objects: it allocates the slots, still serves the waits
+ * that the clients cannot do themselves, and is told by the clients when
+ * one of its own waiters needs to be woken up.
+ *
+ * Every process gets its own unnamed section, holding the objects it
+ * created. Other processes using the same objects go through the server,
+ * so a process can only ever tamper with the state of its own objects.
+ *
+ * The clients can change the state at any time, so the server takes an
+ * object atomically when it satisfies a wait on it, and puts the waiter
+ * back to sleep when a client got there first.
+ */
+
+#include "config.h"
+
+#include <assert.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+#include "ntstatus.h"
+#define WIN32_NO_STATUS
+#include "windef.h"
+#include "winternl.h"
+
+#include "file.h"
+#include "handle.h"
+#include "thread.h"
+#include "process.h"
+#include "request.h"
+#include "security.h"
+
+struct inproc_sync_section
+{
+    unsigned int        refcount;        /* owning process and allocated slots */
+    struct object      *mapping;         /* section object mapped by the process */
+    inproc_sync_shm_t  *syncs;           /* server view of the slots */
+    struct object     **objects;         /* object owning each slot */
+    unsigned int       *free;            /* stack of free slot indices */
+    unsigned int        free_count;
+    unsigned int        used;            /* highest slot ever allocated + 1 */
+    unsigned int        size;            /* size of the objects and free arrays */
+};
+
+static int inproc_sync_enabled;
+
+/* enable the shared sections, only when requested through WINEINPROCSYNC */
+void init_inproc_sync(void)
+{
+#ifdef __linux__
+    const char *env = getenv( "WINEINPROCSYNC" );
+
+    if (!env || !strcmp( env, "0" )) return;
+    inproc_sync_enabled = 1;
+    if (debug_level) fprintf( stderr, "wineserver: in-process synchronization enabled\n" );
+#endif
+}
+
+static void release_inproc_sync_section( struct inproc_sync_section *section )
+{
+    if (--section->refcount) return;
+    munmap( (void *)section->syncs, INPROC_SYNC_SLOTS * sizeof(*section->syncs) );
+    release_object( section->mapping );
+    free( section->objects );
+    free( section->free );
+    free( section );
+}
+
+/* get the section of a process, creating it on first use */
+static struct inproc_sync_section *get_inproc_sync_section( struct process *process )
+{
+    struct inproc_sync_section *section;
+    void *ptr;
+
+    if (!inproc_sync_enabled) return NULL;
+    if (process->inproc_sync) return process->inproc_sync;
+    if (process->is_terminating || list_empty( &process->thread_list )) return NULL;
+
+    if (!(section = mem_alloc( sizeof(*section) ))) return NULL;
+    if (!(section->mapping = create_private_shared_mapping( INPROC_SYNC_SLOTS * sizeof(*section->syncs), &ptr )))
+    {
+        free( section );
+        return NULL;
+    }
+    section->refcount   = 1;
+    section->syncs      = ptr;
+    section->objects    = NULL;
+    section->free       = NULL;
+    section->free_count = 0;
+    section->used       = 1;  /* slot 0 is never handed out, so that a zero index can mean no slot */
+    section->size       = 0;
+    process->inproc_sync = section;
+    return section;
+}
+
+static unsigned int alloc_inproc_sync_slot( struct inproc_sync_section *section )
+{
+    unsigned int size;
+    void *ptr;
+
+    if (section->free_count) return section->free[--section->free_count];
+    if (section->used == INPROC_SYNC_SLOTS) return 0;
+    if (section->used == section->size)
+    {
+        size = min( max( section->size * 2, 64 ), INPROC_SYNC_SLOTS );
+        if (!(ptr = realloc( section->objects, size * sizeof(*section->objects) ))) return 0;
+        section->objects = ptr;
+        if (!(ptr = realloc( section->free, size * sizeof(*section->free) ))) return 0;
+        section->free = ptr;
+        section->size = size;
+    }
+    return section->used++;
+}
+
+struct inproc_sync *alloc_inproc_sync( struct object *obj, enum inproc_sync_type type, unsigned int count,
+                                       thread_id_t owner, unsigned int max, unsigned int flags )
+{
+    struct inproc_sync_section *section;
+    struct inproc_sync *sync;
+    inproc_sync_shm_t *shm;
+    unsigned int index;
+
+    if (!current || !(section = get_inproc_sync_section( current->process ))) return NULL;
+    if (!(index = alloc_inproc_sync_slot( section ))) return NULL;  /* the object is simply served by the server */
+    if (!(sync = mem_alloc( sizeof(*sync) )))
+    {
+        section->free[section->free_count++] = index;
+        return NULL;
+    }
+
+    shm = &section->syncs[index];
+    shm->flags          = flags;
+    shm->state          = INPROC_SYNC_STATE( count, owner );
+    shm->max            = max;
+    shm->waiters        = 0;
+    shm->server_waiters = 0;
+    shm->next_owned     = 0;
+    __atomic_store_n( &shm->type, type, __ATOMIC_RELEASE );
+    section->objects[index] = obj;
+    section->refcount++;
+
+    sync->section = section;
+    sync->shm     = shm;
+    sync->index   = index;
+    return sync;
+}
+
+void free_inproc_sync( struct inproc_sync *sync )
+{
+    struct inproc_sync_section *section = sync->section;
+
+    __atomic_store_n( &sync->shm->type, INPROC_SYNC_NONE, __ATOMIC_RELEASE );
+    sync->shm->state = 0;
+    section->objects[sync->index] = NULL;
+    section->free[section->free_count++] = sync->index;
+    release_inproc_sync_section( section );
+    free( sync );
+}
+
+static void wake_inproc_sync_shm( inproc_sync_shm_t *shm )
+{
+    __atomic_add_fetch( &shm->serial, 1, __ATOMIC_SEQ_CST );
+#ifdef __linux__
+    if (__atomic_load_n( &shm->waiters, __ATOMIC_SEQ_CST ))
+        syscall( __NR_futex, &shm->serial, FUTEX_WAKE, INT_MAX, NULL, 0, 0 );
+#endif
+}
+
+/* wake up the client threads sleeping on the slot after the server changed its state */
+void wake_inproc_sync( struct inproc_sync *sync )
+{
+    wake_inproc_sync_shm( sync->shm );
+}
+
+/* reset an event after the server waiters got its pulse, and release the client threads sleeping on it */
+void pulse_inproc_sync( struct inproc_sync *sync )
+{
+    inproc_sync_shm_t *shm = sync->shm;
+    LONG64 state = __atomic_exchange_n( &shm->state, 0, __ATOMIC_SEQ_CST );
+    unsigned int pulse = (shm->pulse & ~1) + 2;
+
+    /* an auto-reset pulse releases a single thread, unless a server waiter already took it */
+    if (!(shm->flags & INPROC_SYNC_MANUAL_RESET) && INPROC_SYNC_COUNT( state )) pulse |= 1;
+    __atomic_store_n( &shm->pulse, pulse, __ATOMIC_SEQ_CST );
+    wake_inproc_sync_shm( shm );
+}
+
+int add_inproc_sync_queue( struct object *obj, struct inproc_sync *sync, struct wait_queue_entry *entry )
+{
+    if (!add_queue( obj, entry )) return 0;
+    if (sync) __atomic_add_fetch( &sync->shm->server_waiters, 1, __ATOMIC_SEQ_CST );
+    return 1;
+}
+
+void remove_inproc_sync_queue( struct object *obj, struct inproc_sync *sync, struct wait_queue_entry *entry )
+{
+    if (sync) __atomic_sub_fetch( &sync->shm->server_waiters, 1, __ATOMIC_SEQ_CST );
+    remove_queue( obj, entry );
+}
+
+static struct inproc_sync *get_obj_inproc_sync( struct object *obj )
+{
+    struct inproc_sync *sync;
+
+    if ((sync = event_get_inproc_sync( obj ))) return sync;
+    if ((sync = mutex_get_inproc_sync( obj ))) return sync;
+    return semaphore_get_inproc_sync( obj );
+}
+
+/* take an object for a thread whose wait on it is satisfied, return 0 if a client got there first */
+int grab_inproc_sync( struct object *obj, struct thread *thread )
+{
+    struct inproc_sync *sync = get_obj_inproc_sync( obj );
+    LONG64 state, new_state;
+    unsigned int count;
+
+    if (!sync) return 1;
+
+    state = sync->shm->state;
+    do
+    {
+        count = INPROC_SYNC_COUNT( state );
+        switch (sync->shm->type)
+        {
+        case INPROC_SYNC_EVENT:
+            if (!count) return 0;
+            if (sync->shm->flags & INPROC_SYNC_MANUAL_RESET) return 1;
+            new_state = 0;
+            break;
+        case INPROC_SYNC_SEMAPHORE:
+            if (!count) return 0;
+            new_state = state - 1;
+            break;
+        case INPROC_SYNC_MUTEX:
+            if (count && INPROC_SYNC_OWNER( state ) != thread->id) return 0;
+            new_state = INPROC_SYNC_STATE( count + 1, thread->id );
+            break;
+        default:
+            return 0;
+        }
+    } while (!__atomic_compare_exchange_n( &sync->shm->state, &state, new_state, 0,
+                                           __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ));
+    return 1;
+}
+
+/* give back an object taken by grab_inproc_sync for a wait that could not be satisfied after all */
+void ungrab_inproc_sync( struct object *obj, struct thread *thread )
+{
+    struct inproc_sync *sync = get_obj_inproc_sync( obj );
+    LONG64 state, new_state;
+    unsigned int count;
+
+    if (!sync) return;
+
+    state = sync->shm->state;
+    do
+    {
+        count = INPROC_SYNC_COUNT( state );
+        switch (sync->shm->type)
+        {
+        case INPROC_SYNC_EVENT:
+            if (sync->shm->flags & INPROC_SYNC_MANUAL_RESET) return;
+            new_state = INPROC_SYNC_STATE( 1, 0 );
+            break;
+        case INPROC_SYNC_SEMAPHORE:
+            /* a client may have released it to the maximum meanwhile, the count is capped like the release would have been */
+            if (count >= sync->shm->max) return;
+            new_state = state + 1;
+            break;
+        case INPROC_SYNC_MUTEX:
+            /* the thread is waiting in the server, nobody else can change the state */
+            new_state = count > 1 ? state - 1 : 0;
+            break;
+        default:
+            return;
+        }
+    } while (!__atomic_compare_exchange_n( &sync->shm->state, &state, new_state, 0,
+                                           __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ));
+    wake_inproc_sync( sync );
+}
+
+/* abandon a mutex slot if it is still owned by the given thread */
+static void abandon_inproc_sync_slot( struct inproc_sync_section *section, unsigned int index, thread_id_t tid )
+{
+    inproc_sync_shm_t *shm = &section->syncs[index];
+    struct object *obj = section->objects[index];
+    LONG64 state = shm->state;
+
+    if (!obj || shm->type != INPROC_SYNC_MUTEX) return;
+    if (!INPROC_SYNC_COUNT( state ) || INPROC_SYNC_OWNER( state ) != tid) return;
+    if (!__atomic_compare_exchange_n( &shm->state, &state, 0, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST )) return;
+
+    __atomic_or_fetch( &shm->flags, INPROC_SYNC_ABANDONED, __ATOMIC_SEQ_CST );
+    wake_inproc_sync_shm( shm );
+    wake_up( obj, 0 );
+}
+
+/* abandon an in-process mutex grabbed through the server */
+void abandon_inproc_sync( struct inproc_sync *sync, struct thread *thread )
+{
+    abandon_inproc_sync_slot( sync->section, sync->index, thread->id );
+}
+
+/* abandon the mutexes a section holds for threads that are gone */
+static void abandon_dead_owner_mutexes( struct inproc_sync_section *section, thread_id_t tid )
+{
+    struct thread *owner;
+    unsigned int i;
+
+    for (i = 1; i < section->used; i++)
+    {
+        inproc_sync_shm_t *shm = &section->syncs[i];
+        thread_id_t id = INPROC_SYNC_OWNER( shm->state );
+
+        if (shm->type != INPROC_SYNC_MUTEX || !INPROC_SYNC_COUNT( shm->state )) continue;
+        if (tid)
+        {
+            if (id == tid) abandon_inproc_sync_slot( section, i, tid );
+            continue;
+        }
+        if ((owner = get_thread_from_id( id )))
+        {
+            int alive = owner->state != TERMINATED;
+            release_object( owner );
+            if (alive) continue;
+        }
+        abandon_inproc_sync_slot( section, i, id );
+    }
+}
+
+/* release the mutexes grabbed in process by a terminating thread */
+void abandon_inproc_sync_mutexes( struct thread *thread, int violent_death )
+{
+    struct inproc_sync *sync = thread->inproc_sync;
+    struct inproc_sync_section *section;
+    unsigned int index, next, steps;
+
+    if (!sync) return;
+    thread->inproc_sync = NULL;
+    section = sync->section;
+
+    /* a thread killed at a random point may have grabbed a mutex without linking it yet */
+    if (violent_death) abandon_dead_owner_mutexes( section, thread->id );
+    else
+    {
+        /* the list lives in client memory, don't trust it any further than the slots it may point to */
+        for (index = sync->shm->next_owned, steps = 0; index && steps < section->used; index = next, steps++)
+        {
+            if (index >= section->used) break;
+            next = section->syncs[index].next_owned;
+            abandon_inproc_sync_slot( section, index, thread->id );
+        }
+    }
+    free_inproc_sync( sync );
+}
+
+/* release the section of a process whose last thread is gone */
+void release_process_inproc_sync( struct process *process )
+{
+    struct inproc_sync_section *section = process->inproc_sync;
+
+    if (!section) return;
+    process->inproc_sync = NULL;
+    /* the threads may have died anywhere, including between grabbing a mutex and linking it */
+    abandon_dead_owner_mutexes( section, 0 );
+    release_inproc_sync_section( section );
+}
+
+/* retrieve the slot of an object */
+DECL_HANDLER(get_inproc_sync)
+{
+    struct inproc_sync *sync;
+    struct object *obj;
+
+    if (!(obj = get_handle_obj( current->process, req->handle, 0, NULL ))) return;
+
+    /* objects of other processes live in sections this process doesn't see */
+    if ((sync = get_obj_inproc_sync( obj )) && sync->section == current->process->inproc_sync)
+    {
+        reply->index  = sync->index;
+        reply->type   = sync->shm->type;
+        reply->access = get_handle_access( current->process, req->handle );
+    }
+    else set_error( STATUS_OBJECT_TYPE_MISMATCH );
+
+    release_object( obj );
+}
+
+/* retrieve the section holding the in-process synchronization objects of the current process */
+DECL_HANDLER(get_inproc_sync_section)
+{
+    struct inproc_sync_section *section;
+
+    if (!(section = get_inproc_sync_section( current->process )))
+    {
+        set_error( STATUS_NOT_SUPPORTED );
+        return;
+    }
+    reply->handle = alloc_handle_no_access_check( current->process, section->mapping,
+                                                  SECTION_MAP_READ | SECTION_MAP_WRITE, 0 );
+}
+
+/* retrieve the slot holding the list of mutexes owned in process by the current thread */
+DECL_HANDLER(get_inproc_sync_thread)
+{
+    if (!current->inproc_sync &&
+        !(current->inproc_sync = alloc_inproc_sync( NULL, INPROC_SYNC_THREAD, 0, current->id, 0, 0 )))
+    {
+        set_error( STATUS_NOT_SUPPORTED );
+        return;
+    }
+    reply->index = current->inproc_sync->index;
+}
+
+/* wake up the server waiters of an object signaled by a client */
+DECL_HANDLER(signal_inproc_sync)
+{
+    struct object *obj;
+
+    if (!(obj = get_handle_obj( current->process, req->handle, 0, NULL ))) return;
+
+    if (get_obj_inproc_sync( obj )) wake_up( obj, 0 );
+    else set_error( STATUS_OBJECT_TYPE_MISMATCH );
+
+    release_object( obj );
+}
@@ -1298,6 +1298,41 @@ struct mapping *create_session_mapping( struct object *root, const struct unicod
     return create_mapping( root, name, attr, size, SEC_COMMIT, 0, access, sd );
 }
 
+/* create a permanent section shared with the clients and map it in the server */
+void *create_shared_mapping( struct object *root, const struct unicode_str *name, mem_size_t size,
+                             const struct security_descriptor *sd )
+{
+    static const unsigned int access = FILE_READ_DATA | FILE_WRITE_DATA;
+    struct mapping *mapping;
+    void *ptr;
+
+    /* there is no current thread yet, so the security can't be set through the object ops */
+    if (!(mapping = create_mapping( root, name, OBJ_PERMANENT, size, SEC_COMMIT, 0, access, NULL )))
+        return NULL;
+    if (sd && !set_sd_defaults_from_token( &mapping->obj, sd, OWNER_SECURITY_INFORMATION |
+                                           GROUP_SECURITY_INFORMATION | DACL_SECURITY_INFORMATION, NULL ))
+    {
+        release_object( mapping );
+        return NULL;
+    }
+    ptr = mmap( NULL, mapping->size, PROT_READ | PROT_WRITE, MAP_SHARED, get_unix_fd( mapping->fd ), 0 );
+    release_object( mapping );
+    return ptr == MAP_FAILED ? NULL : ptr;
+}
+
+/* create an unnamed section to be shared with a single client and map it in the server */
+struct object *create_private_shared_mapping( mem_size_t size, void **ptr )
+{
+    static const unsigned int access = FILE_READ_DATA | FILE_WRITE_DATA;
+    struct mapping *mapping;
+
+    if (!(mapping = create_mapping( NULL, NULL, 0, size, SEC_COMMIT, 0, access, NULL ))) return NULL;
+    *ptr = mmap( NULL, mapping->size, PROT_READ | PROT_WRITE, MAP_SHARED, get_unix_fd( mapping->fd ), 0 );
+    if (*ptr != MAP_FAILED) return &mapping->obj;
+    release_object( mapping );
+    return NULL;
+}
+
 void set_session_mapping( struct mapping *mapping )
 {
     int unix_fd = get_unix_fd( mapping->fd );
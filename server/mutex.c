@@ -57,9 +57,12 @@ struct mutex
     unsigned int   count;           /* recursion count */
     int            abandoned;       /* has it been abandoned? */
     struct list    entry;           /* entry in owner thread mutex list */
+    struct inproc_sync *sync;       /* in-process synchronization slot */
 };
 
 static void mutex_dump( struct object *obj, int verbose );
+static int mutex_add_queue( struct object *obj, struct wait_queue_entry *entry );
+static void mutex_remove_queue( struct object *obj, struct wait_queue_entry *entry );
 static int mutex_signaled( struct object *obj, struct wait_queue_entry *entry );
 static void mutex_satisfied( struct object *obj, struct wait_queue_entry *entry );
 static void mutex_destroy( struct object *obj );
@@ -70,8 +73,8 @@ static const struct object_ops mutex_ops =
     sizeof(struct mutex),      /* size */
     &mutex_type,               /* type */
     mutex_dump,                /* dump */
-    add_queue,                 /* add_queue */
-    remove_queue,              /* remove_queue */
+    mutex_add_queue,           /* add_queue */
+    mutex_remove_queue,        /* remove_queue */
     mutex_signaled,            /* signaled */
     mutex_satisfied,           /* satisfied */
     mutex_signal,              /* signal */
@@ -103,6 +106,15 @@ static void do_grab( struct mutex *mutex, struct thread *thread )
     }
 }
 
+/* remember the last thread that grabbed an in-process mutex through the server, to abandon it if needed */
+static void track_inproc_owner( struct mutex *mutex, struct thread *thread )
+{
+    if (mutex->owner == thread) return;
+    if (mutex->owner) list_remove( &mutex->entry );
+    mutex->owner = thread;
+    if (thread) list_add_head( &thread->mutex_list, &mutex->entry );
+}
+
 /* release a mutex once the recursion count is 0 */
 static void do_release( struct mutex *mutex )
 {
@@ -126,7 +138,10 @@ static struct mutex *create_mutex( struct object *root, const struct unicode_str
             mutex->count = 0;
             mutex->owner = NULL;
             mutex->abandoned = 0;
-            if (owned) do_grab( mutex, current );
+            mutex->sync = alloc_inproc_sync( &mutex->obj, INPROC_SYNC_MUTEX, owned ? 1 : 0,
+                                             owned ? current->id : 0, 0, 0 );
+            if (owned && mutex->sync) track_inproc_owner( mutex, current );
+            else if (owned) do_grab( mutex, current );
         }
     }
     return mutex;
@@ -140,6 +155,13 @@ void abandon_mutexes( struct thread *thread )
     {
         struct mutex *mutex = LIST_ENTRY( ptr, struct mutex, entry );
         assert( mutex->owner == thread );
+        if (mutex->sync)
+        {
+            /* it may have been released in process since, then it's simply forgotten */
+            track_inproc_owner( mutex, NULL );
+            abandon_inproc_sync( mutex->sync, thread );
+            continue;
+        }
         mutex->count = 0;
         mutex->abandoned = 1;
         do_release( mutex );
@@ -150,13 +172,37 @@ static void mutex_dump( struct object *obj, int verbose )
 {
     struct mutex *mutex = (struct mutex *)obj;
     assert( obj->ops == &mutex_ops );
-    fprintf( stderr, "Mutex count=%u owner=%p\n", mutex->count, mutex->owner );
+    if (mutex->sync)
+        fprintf( stderr, "Mutex count=%u owner=%04x\n", INPROC_SYNC_COUNT( mutex->sync->shm->state ),
+                 INPROC_SYNC_OWNER( mutex->sync->shm->state ) );
+    else
+        fprintf( stderr, "Mutex count=%u owner=%p\n", mutex->count, mutex->owner );
+}
+
+static int mutex_add_queue( struct object *obj, struct wait_queue_entry *entry )
+{
+    struct mutex *mutex = (struct mutex *)obj;
+    assert( obj->ops == &mutex_ops );
+    return add_inproc_sync_queue( obj, mutex->sync, entry );
+}
+
+static void mutex_remove_queue( struct object *obj, struct wait_queue_entry *entry )
+{
+    struct mutex *mutex = (struct mutex *)obj;
+    assert( obj->ops == &mutex_ops );
+    remove_inproc_sync_queue( obj, mutex->sync, entry );
 }
 
 static int mutex_signaled( struct object *obj, struct wait_queue_entry *entry )
 {
     struct mutex *mutex = (struct mutex *)obj;
     assert( obj->ops == &mutex_ops );
+
+    if (mutex->sync)
+    {
+        LONG64 state = mutex->sync->shm->state;
+        return (!INPROC_SYNC_COUNT( state ) || INPROC_SYNC_OWNER( state ) == get_wait_queue_thread( entry )->id);
+    }
     return (!mutex->count || (mutex->owner == get_wait_queue_thread( entry )));
 }
 
@@ -165,28 +211,74 @@ static void mutex_satisfied( struct object *obj, struct wait_queue_entry *entry
     struct mutex *mutex = (struct mutex *)obj;
     assert( obj->ops == &mutex_ops );
 
+    if (mutex->sync)
+    {
+        /* already grabbed by grab_inproc_sync */
+        track_inproc_owner( mutex, get_wait_queue_thread( entry ));
+        if (mutex->sync->shm->flags & INPROC_SYNC_ABANDONED) make_wait_abandoned( entry );
+        __atomic_and_fetch( &mutex->sync->shm->flags, ~INPROC_SYNC_ABANDONED, __ATOMIC_SEQ_CST );
+        return;
+    }
     do_grab( mutex, get_wait_queue_thread( entry ));
     if (mutex->abandoned) make_wait_abandoned( entry );
     mutex->abandoned = 0;
 }
 
-static int mutex_signal( struct object *obj, unsigned int access )
+/* release a mutex owned by the current thread, return the previous count */
+static unsigned int release_mutex( struct mutex *mutex )
 {
-    struct mutex *mutex = (struct mutex *)obj;
-    assert( obj->ops == &mutex_ops );
+    unsigned int count;
 
-    if (!(access & SYNCHRONIZE))
+    if (mutex->sync)
     {
-        set_error( STATUS_ACCESS_DENIED );
-        return 0;
+        LONG64 state = mutex->sync->shm->state, new_state;
+
+        do
+        {
+            if (!(count = INPROC_SYNC_COUNT( state )) || INPROC_SYNC_OWNER( state ) != current->id)
+            {
+                set_error( STATUS_MUTANT_NOT_OWNED );
+                return 0;
+            }
+            new_state = count > 1 ? state - 1 : 0;
+        } while (!__atomic_compare_exchange_n( &mutex->sync->shm->state, &state, new_state, 0,
+                                               __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ));
+        if (!new_state)
+        {
+            track_inproc_owner( mutex, NULL );
+            wake_inproc_sync( mutex->sync );
+            wake_up( &mutex->obj, 0 );
+        }
+        return count;
     }
+
     if (!mutex->count || (mutex->owner != current))
     {
         set_error( STATUS_MUTANT_NOT_OWNED );
         return 0;
     }
+    count = mutex->count;
     if (!--mutex->count) do_release( mutex );
-    return 1;
+    return count;
+}
+
+struct inproc_sync *mutex_get_inproc_sync( struct object *obj )
+{
+    if (obj->ops != &mutex_ops) return NULL;
+    return ((struct mutex *)obj)->sync;
+}
+
+static int mutex_signal( struct object *obj, unsigned int access )
+{
+    struct mutex *mutex = (struct mutex *)obj;
+    assert( obj->ops == &mutex_ops );
+
+    if (!(access & SYNCHRONIZE))
+    {
+        set_error( STATUS_ACCESS_DENIED );
+        return 0;
+    }
+    return release_mutex( mutex ) != 0;
 }
 
 static void mutex_destroy( struct object *obj )
@@ -194,6 +286,12 @@ static void mutex_destroy( struct object *obj )
     struct mutex *mutex = (struct mutex *)obj;
     assert( obj->ops == &mutex_ops );
 
+    if (mutex->sync)
+    {
+        track_inproc_owner( mutex, NULL );
+        free_inproc_sync( mutex->sync );
+        return;
+    }
     if (!mutex->count) return;
     mutex->count = 0;
     do_release( mutex );
@@ -240,12 +338,7 @@ DECL_HANDLER(release_mutex)
     if ((mutex = (struct mutex *)get_handle_obj( current->process, req->handle,
                                                  0, &mutex_ops )))
     {
-        if (!mutex->count || (mutex->owner != current)) set_error( STATUS_MUTANT_NOT_OWNED );
-        else
-        {
-            reply->prev_count = mutex->count;
-            if (!--mutex->count) do_release( mutex );
-        }
+        reply->prev_count = release_mutex( mutex );
         release_object( mutex );
     }
 }
@@ -258,9 +351,19 @@ DECL_HANDLER(query_mutex)
     if ((mutex = (struct mutex *)get_handle_obj( current->process, req->handle,
                                                  MUTANT_QUERY_STATE, &mutex_ops )))
     {
-        reply->count = mutex->count;
-        reply->owned = (mutex->owner == current);
-        reply->abandoned = mutex->abandoned;
+        if (mutex->sync)
+        {
+            LONG64 state = mutex->sync->shm->state;
+            reply->count = INPROC_SYNC_COUNT( state );
+            reply->owned = (INPROC_SYNC_COUNT( state ) && INPROC_SYNC_OWNER( state ) == current->id);
+            reply->abandoned = !!(mutex->sync->shm->flags & INPROC_SYNC_ABANDONED);
+        }
+        else
+        {
+            reply->count = mutex->count;
+            reply->owned = (mutex->owner == current);
+            reply->abandoned = mutex->abandoned;
+        }
 
         release_object( mutex );
     }
@@ -223,10 +223,39 @@ extern struct event *get_event_obj( struct process *process, obj_handle_t handle
 extern struct keyed_event *get_keyed_event_obj( struct process *process, obj_handle_t handle, unsigned int access );
 extern void set_event( struct event *event );
 extern void reset_event( struct event *event );
+extern struct inproc_sync *event_get_inproc_sync( struct object *obj );
 
 /* mutex functions */
 
 extern void abandon_mutexes( struct thread *thread );
+extern struct inproc_sync *mutex_get_inproc_sync( struct object *obj );
+
+/* semaphore functions */
+
+extern struct inproc_sync *semaphore_get_inproc_sync( struct object *obj );
+
+/* in-process synchronization functions */
+
+struct inproc_sync
+{
+    struct inproc_sync_section *section; /* section holding the slot */
+    inproc_sync_shm_t          *shm;     /* the slot itself */
+    unsigned int                index;   /* index of the slot in the section */
+};
+
+extern void init_inproc_sync(void);
+extern struct inproc_sync *alloc_inproc_sync( struct object *obj, enum inproc_sync_type type, unsigned int count,
+                                              thread_id_t owner, unsigned int max, unsigned int flags );
+extern void free_inproc_sync( struct inproc_sync *sync );
+extern void wake_inproc_sync( struct inproc_sync *sync );
+extern void pulse_inproc_sync( struct inproc_sync *sync );
+extern int add_inproc_sync_queue( struct object *obj, struct inproc_sync *sync, struct wait_queue_entry *entry );
+extern void remove_inproc_sync_queue( struct object *obj, struct inproc_sync *sync, struct wait_queue_entry *entry );
+extern int grab_inproc_sync( struct object *obj, struct thread *thread );
+extern void ungrab_inproc_sync( struct object *obj, struct thread *thread );
+extern void abandon_inproc_sync( struct inproc_sync *sync, struct thread *thread );
+extern void abandon_inproc_sync_mutexes( struct thread *thread, int violent_death );
+extern void release_process_inproc_sync( struct process *process );
 
 /* serial functions */
 
@@ -248,6 +277,7 @@ extern unsigned int supported_machines_count;
 extern unsigned short supported_machines[8];
 extern unsigned short native_machine;
 extern void init_registry(void);
+extern void init_registry_shm( struct object *root );
 extern void flush_registry(void);
 
 static inline int is_machine_32bit( unsigned short machine )
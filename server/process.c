@@ -676,6 +676,7 @@ struct process *create_process( int fd, struct process *parent, unsigned int fla
     process->peb             = 0;
     process->ldt_copy        = 0;
     process->dir_cache       = NULL;
+    process->inproc_sync     = NULL;
     process->winstation      = 0;
     process->desktop         = 0;
     process->token           = NULL;
@@ -784,6 +785,7 @@ static void process_destroy( struct object *obj )
     free( process->rawinput_devices );
     free( process->dir_cache );
     free( process->image );
+    release_process_inproc_sync( process );
 }
 
 /* dump a process on stdout for debugging purposes */
@@ -970,6 +972,7 @@ static void process_killed( struct process *process )
     close_process_handles( process );
     if (process->idle_event) release_object( process->idle_event );
     process->idle_event = NULL;
+    release_process_inproc_sync( process );
     assert( !process->console );
 
     destroy_process_classes( process );
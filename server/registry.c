@@ -33,6 +33,7 @@
 #include <stdarg.h>
 #include <string.h>
 #include <stdlib.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -90,6 +91,8 @@ struct key
     unsigned int      flags;       /* flags */
     timeout_t         modif;       /* last modification time */
     struct list       notify_list; /* list of notifications */
+    unsigned int      shm_offset;  /* offset of the record in the shared section, 0 if none */
+    unsigned int      shm_gen;     /* generation of the shared section when it was published */
 };
 
 /* key flags */
@@ -99,6 +102,7 @@ struct key
 #define KEY_SYMLINK  0x0008  /* key is a symbolic link */
 #define KEY_WOWSHARE 0x0010  /* key is a Wow64 shared key (used for Software\Classes) */
 #define KEY_PREDEF   0x0020  /* key is marked as predefined */
+#define KEY_JOURNAL  0x0040  /* key has a pending journal record */
 
 #define OBJ_KEY_WOW64 0x100000 /* magic flag added to attributes for WoW64 redirection */
 
@@ -123,6 +127,14 @@ static struct key *root_key;
 
 static const timeout_t ticks_1601_to_1970 = (timeout_t)86400 * (369 * 365 + 89) * TICKS_PER_SEC;
 static const timeout_t save_period = 30 * -TICKS_PER_SEC;  /* delay between periodic saves */
+static const timeout_t shm_delay = 5 * TICKS_PER_SEC;  /* keys modified more recently are not published */
+
+#define MAX_SHM_RECORD 65536  /* max. size of a published key record */
+
+/* records of read-mostly keys, mapped by the clients to query values without a server call */
+static registry_shm_t *registry_shm;
+static unsigned int registry_shm_used;
+static unsigned int registry_shm_start;  /* offset of the first chunk holding records */
 static struct timeout_user *save_timeout_user;  /* saving timer */
 static enum prefix_type { PREFIX_UNKNOWN, PREFIX_32BIT, PREFIX_64BIT } prefix_type;
 
@@ -132,12 +144,22 @@ static const struct unicode_str symlink_str = { symlink_value, sizeof(symlink_va
 
 static void set_periodic_save_timer(void);
 static struct key_value *find_value( const struct key *key, const struct unicode_str *name, int *index );
+static void journal_key( struct key *key );
+static void journal_delete_key( struct key *key );
+static void require_snapshot( struct key *key );
 
 /* information about where to save a registry branch */
 struct save_branch_info
 {
     struct key  *key;
-    const char  *filename;
+    const char  *filename;      /* text file, written as an export on shutdown */
+    char        *hive;          /* binary snapshot */
+    char        *journal;       /* journal of the changes made since the snapshot */
+    timeout_t    serial;        /* serial of the snapshot, recorded in the journal header */
+    file_pos_t   hive_size;     /* size of the snapshot */
+    file_pos_t   journal_size;  /* size of the journal */
+    int          need_snapshot; /* changes can't be journaled, write a new snapshot */
+    struct list  pending;       /* changes not written to the journal yet */
 };
 
 #define MAX_SAVE_BRANCH_INFO 3
@@ -655,6 +677,143 @@ static int key_close_handle( struct object *obj, struct process *process, obj_ha
     return 1;  /* ok to close */
 }
 
+/* check if the shared record of a key hasn't been recycled with its chunk */
+static inline int is_key_shm_valid( struct key *key )
+{
+    return key->shm_offset && key->shm_gen == registry_shm->generation[key->shm_offset / REGISTRY_SHM_CHUNK];
+}
+
+/* mark the shared record of a key as stale, clients then go through the server */
+static void invalidate_key_shm( struct key *key )
+{
+    registry_key_shm_t *record;
+
+    if (!key->shm_offset) return;
+    if (is_key_shm_valid( key ))
+    {
+        record = (registry_key_shm_t *)((char *)registry_shm + key->shm_offset);
+        __atomic_store_n( &record->seq, record->seq + 1, __ATOMIC_SEQ_CST );
+    }
+    key->shm_offset = 0;
+}
+
+/* publish the values of a key that hasn't been modified recently, return the record offset or 0 */
+static unsigned int publish_key_shm( struct key *key )
+{
+    registry_key_shm_t *record;
+    unsigned int size, pos, chunk;
+    char *ptr;
+    int i;
+
+    if (!registry_shm) return 0;
+    if (is_key_shm_valid( key )) return key->shm_offset;
+    if (key->flags & (KEY_DELETED | KEY_PREDEF)) return 0;
+    /* the section can only be mapped by the processes that can read keys with the default security */
+    if (key->obj.sd) return 0;
+    if (current_time - key->modif < shm_delay) return 0;
+
+    size = offsetof( registry_key_shm_t, values ) + (key->last_value + 1) * sizeof(registry_value_shm_t);
+    for (i = 0; i <= key->last_value; i++)
+    {
+        size += (key->values[i].namelen + 7) & ~7;
+        size += (key->values[i].len + 7) & ~7;
+        if (size > MAX_SHM_RECORD) return 0;
+    }
+
+    /* records don't cross chunks; the oldest chunk is recycled when all of them are used, so
+     * only its keys go back to the server, clients notice the change of its generation */
+    if ((registry_shm_used & (REGISTRY_SHM_CHUNK - 1)) + size > REGISTRY_SHM_CHUNK)
+        registry_shm_used = (registry_shm_used | (REGISTRY_SHM_CHUNK - 1)) + 1;
+    if (registry_shm_used >= registry_shm->size) registry_shm_used = registry_shm_start;
+    if (!(registry_shm_used & (REGISTRY_SHM_CHUNK - 1)))
+    {
+        chunk = registry_shm_used / REGISTRY_SHM_CHUNK;
+        __atomic_store_n( &registry_shm->generation[chunk], registry_shm->generation[chunk] + 1, __ATOMIC_SEQ_CST );
+    }
+
+    record = (registry_key_shm_t *)((char *)registry_shm + registry_shm_used);
+    ptr = (char *)record;
+    pos = offsetof( registry_key_shm_t, values ) + (key->last_value + 1) * sizeof(registry_value_shm_t);
+    for (i = 0; i <= key->last_value; i++)
+    {
+        const struct key_value *value = &key->values[i];
+
+        record->values[i].type        = value->type;
+        record->values[i].namelen     = value->namelen;
+        record->values[i].name_offset = pos;
+        memcpy( ptr + pos, value->name, value->namelen );
+        pos += (value->namelen + 7) & ~7;
+        record->values[i].datalen     = value->len;
+        record->values[i].data_offset = pos;
+        if (value->len) memcpy( ptr + pos, value->data, value->len );
+        pos += (value->len + 7) & ~7;
+    }
+    record->size      = size;
+    record->nb_values = key->last_value + 1;
+    __atomic_store_n( &record->seq, 0, __ATOMIC_SEQ_CST );
+
+    key->shm_offset = registry_shm_used;
+    key->shm_gen    = registry_shm->generation[registry_shm_used / REGISTRY_SHM_CHUNK];
+    registry_shm_used += size;
+    return key->shm_offset;
+}
+
+/* security of the section, mirroring the access granted by the default key security */
+static struct security_descriptor *get_registry_shm_sd(void)
+{
+    struct security_descriptor *sd;
+    struct acl *dacl;
+    struct ace *ace;
+    struct sid *sid;
+    size_t admins_sid_len = sid_len( &builtin_admins_sid );
+    size_t dacl_len = sizeof(*dacl) + sizeof(*ace) + admins_sid_len;
+
+    if (!(sd = mem_alloc( sizeof(*sd) + 2 * admins_sid_len + dacl_len ))) return NULL;
+    sd->control   = SE_DACL_PRESENT;
+    sd->owner_len = admins_sid_len;
+    sd->group_len = admins_sid_len;
+    sd->sacl_len  = 0;
+    sd->dacl_len  = dacl_len;
+    sid = (struct sid *)(sd + 1);
+    sid = copy_sid( sid, &builtin_admins_sid );
+    copy_sid( sid, &builtin_admins_sid );
+
+    dacl = (struct acl *)((char *)(sd + 1) + 2 * admins_sid_len);
+    dacl->revision = ACL_REVISION;
+    dacl->pad1     = 0;
+    dacl->size     = dacl_len;
+    dacl->count    = 1;
+    dacl->pad2     = 0;
+    set_ace( ace_first( dacl ), &builtin_admins_sid, ACCESS_ALLOWED_ACE_TYPE, 0,
+             SECTION_QUERY | SECTION_MAP_READ );
+    return sd;
+}
+
+/* create the section holding the published keys */
+void init_registry_shm( struct object *root )
+{
+    static const WCHAR nameW[] = {'_','_','w','i','n','e','_','r','e','g','i','s','t','r','y'};
+    static const struct unicode_str name = {nameW, sizeof(nameW)};
+    struct security_descriptor *sd;
+    const unsigned short *casemap;
+    data_size_t casemap_size;
+
+    /* keys with their own security are not published, the others can only be read by administrators */
+    if (!(sd = get_registry_shm_sd())) return;
+    registry_shm = create_shared_mapping( root, &name, REGISTRY_SHM_SIZE, sd );
+    free( sd );
+    if (!registry_shm) return;
+
+    /* value names are looked up with the server case mapping, not whatever the client loaded */
+    casemap = get_casemap( &casemap_size );
+    registry_shm->size           = REGISTRY_SHM_SIZE;
+    registry_shm->casemap_offset = (sizeof(*registry_shm) + 7) & ~7;
+    registry_shm->casemap_size   = casemap_size;
+    memcpy( (char *)registry_shm + registry_shm->casemap_offset, casemap, casemap_size );
+    registry_shm_start = (registry_shm->casemap_offset + casemap_size + REGISTRY_SHM_CHUNK - 1) & ~(REGISTRY_SHM_CHUNK - 1);
+    registry_shm_used  = registry_shm_start;
+}
+
 static void key_destroy( struct object *obj )
 {
     int i;
@@ -662,6 +821,7 @@ static void key_destroy( struct object *obj )
     struct key *key = (struct key *)obj;
     assert( obj->ops == &key_ops );
 
+    invalidate_key_shm( key );
     free( key->class );
     for (i = 0; i <= key->last_value; i++)
     {
@@ -708,6 +868,8 @@ static struct key *create_key_object( struct object *parent, const struct unicod
             key->last_value  = -1;
             key->values      = NULL;
             key->modif       = modif;
+            key->shm_offset  = 0;
+            key->shm_gen     = 0;
             list_init( &key->notify_list );
 
             if (options & REG_OPTION_CREATE_LINK) key->flags |= KEY_SYMLINK;
@@ -720,6 +882,7 @@ static struct key *create_key_object( struct object *parent, const struct unicod
                 return NULL;
             }
             else key->flags |= KEY_DIRTY;
+            journal_key( key );
         }
     }
     return key;
@@ -765,6 +928,7 @@ static void touch_key( struct key *key, unsigned int change )
 {
     key->modif = current_time;
     make_dirty( key );
+    journal_key( key );
 
     /* do notifications */
     check_notify( key, change, 1 );
@@ -1048,6 +1212,7 @@ static void rename_key( struct key *key, const struct unicode_str *new_name )
     }
     parent->subkeys[index] = key;
 
+    require_snapshot( key );
     free( key->obj.name );
     key->obj.name = new_name_ptr;
 
@@ -1085,7 +1250,9 @@ static int delete_key( struct key *key, int recurse )
     }
 
     if (debug_level > 1) dump_operation( key, NULL, "Delete" );
+    journal_delete_key( key );
     key->flags |= KEY_DELETED;
+    invalidate_key_shm( key );
     unlink_named_object( &key->obj );
     touch_key( parent, REG_NOTIFY_CHANGE_NAME );
     return 1;
@@ -1218,6 +1385,7 @@ static void set_value( struct key *key, const struct unicode_str *name,
     value->type  = type;
     value->len   = len;
     value->data  = ptr;
+    invalidate_key_shm( key );
     touch_key( key, REG_NOTIFY_CHANGE_LAST_SET );
     if (debug_level > 1) dump_operation( key, value, "Set" );
 }
@@ -1327,6 +1495,7 @@ static void delete_value( struct key *key, const struct unicode_str *name )
     free( value->data );
     for (i = index; i < key->last_value; i++) key->values[i] = key->values[i + 1];
     key->last_value--;
+    invalidate_key_shm( key );
     touch_key( key, REG_NOTIFY_CHANGE_LAST_SET );
 
     /* try to shrink the array */
@@ -1626,6 +1795,7 @@ static int load_value( struct key *key, const char *buffer, struct file_load_inf
     data_size_t maxlen, len;
     struct key_value *value;
 
+    invalidate_key_shm( key );
     if (!(value = parse_value_name( key, buffer, &len, info ))) return 0;
     if (!(res = get_data_type( buffer + len, &type, &parse_type ))) goto error;
     buffer += len + res;
@@ -1755,6 +1925,8 @@ static void load_keys( struct key *key, const char *filename, FILE *f, int prefi
             if (prefix_len == -1) prefix_len = get_prefix_len( key, p + 1, &info );
             if (!(subkey = load_key( key, p + 1, prefix_len, &info, &modif )))
                 file_read_error( "Error creating key", &info );
+            else
+                journal_key( subkey );
             break;
         case '@':   /* default value */
         case '\"':  /* value */
@@ -1805,28 +1977,771 @@ static void load_registry( struct key *key, obj_handle_t handle )
     }
 }
 
-/* load one of the initial registry files */
-static int load_init_registry_from_file( const char *filename, struct key *key )
+/*
+ * The registry branches are persisted in a binary format between shutdowns:
+ * - the snapshot (system.hiv) holds all the non-volatile keys in tree order,
+ *   each key referring to its parent by index, so that it can be loaded
+ *   without any parsing. The header holds a CRC of the keys, a snapshot that
+ *   is truncated or doesn't match it is ignored;
+ * - the journal (system.jnl) holds the keys modified or deleted since the
+ *   snapshot, it is appended to by the periodic saves. Every record ends with
+ *   a trailer holding its CRC, replay stops at the first record that doesn't
+ *   match and the journal is truncated there.
+ * A new snapshot is written when the journal becomes too large. The text
+ * files are only written on shutdown, as an export of the same data; one
+ * that was modified after the snapshot is loaded instead of it.
+ */
+
+#define HIVE_VERSION      2
+#define HIVE_KEY_SYMLINK  0x0001  /* key is a symbolic link */
+
+#define JOURNAL_SET_KEY     1     /* key was created or modified */
+#define JOURNAL_DELETE_KEY  2     /* key was deleted along with its subkeys */
+
+#define MIN_JOURNAL_SIZE  (1024 * 1024)  /* journal size below which no new snapshot is needed */
+
+#define HIVE_ALIGN(len) (((len) + 3) & ~3)
+
+static const char hive_magic[8] = {'W','I','N','E','H','I','V','E'};
+static const char journal_magic[8] = {'W','I','N','E','J','N','L','2'};
+
+struct hive_header
+{
+    char             magic[8];
+    unsigned int     version;     /* HIVE_VERSION */
+    unsigned int     arch;        /* prefix type */
+    timeout_t        serial;      /* serial of the snapshot, the journal has to match it */
+    unsigned __int64 text_mtime;  /* modification time of the text file, if it holds the same keys */
+    unsigned __int64 text_size;   /* size of the text file, if it holds the same keys */
+    unsigned int     nb_keys;     /* number of keys following the header */
+    unsigned int     crc;         /* CRC32 of the keys following the header */
+};
+
+/* a key record, followed by the key name, class and values */
+struct hive_key
+{
+    unsigned int parent;          /* index of the parent key, ~0 for the branch root */
+    unsigned int flags;           /* HIVE_KEY_* flags */
+    timeout_t    modif;           /* last modification time */
+    data_size_t  namelen;         /* length of key name, 0 for the branch root */
+    data_size_t  classlen;        /* length of class name */
+    unsigned int nb_values;       /* number of values */
+    unsigned int reserved;
+};
+
+/* a value record, followed by the value name and data */
+struct hive_value
+{
+    unsigned int type;            /* value type */
+    data_size_t  namelen;         /* length of value name */
+    data_size_t  len;             /* length of value data */
+    unsigned int reserved;
+};
+
+struct journal_header
+{
+    char         magic[8];
+    timeout_t    serial;          /* serial of the snapshot the journal applies to */
+};
+
+/* a journal record, followed by the key path relative to the branch, the key record and the trailer */
+struct journal_record
+{
+    unsigned int size;            /* size of the record, including this header and the trailer */
+    unsigned int op;              /* JOURNAL_* operation */
+    data_size_t  pathlen;         /* length of the key path */
+    unsigned int reserved;
+};
+
+/* ends a journal record, a record whose trailer doesn't match was torn by a crash */
+struct journal_trailer
+{
+    unsigned int size;            /* size of the record, same as in its header */
+    unsigned int crc;             /* CRC32 of the record up to the trailer */
+    timeout_t    serial;          /* serial of the snapshot the journal applies to */
+};
+
+/* output of the hive and journal records */
+struct hive_writer
+{
+    FILE        *f;
+    unsigned int crc;             /* CRC32 of the data written since it was last reset */
+};
+
+/* a change not written to the journal yet */
+struct journal_op
+{
+    struct list  entry;
+    struct key  *key;             /* modified key, NULL for a deletion */
+    WCHAR       *path;            /* path of the deleted key */
+    data_size_t  pathlen;
+};
+
+/* find the saved branch containing a key */
+static struct save_branch_info *get_key_branch( const struct key *key )
+{
+    int i;
+
+    for ( ; key; key = get_parent( key ))
+        for (i = 0; i < save_branch_count; i++)
+            if (save_branch_info[i].key == key) return &save_branch_info[i];
+    return NULL;
+}
+
+/* build the path of a key relative to one of its parents */
+static WCHAR *get_key_path( const struct key *key, const struct key *base, data_size_t *len )
+{
+    const struct key *parent;
+    data_size_t size = 0;
+    WCHAR *path, *p;
+
+    for (parent = key; parent != base; parent = get_parent( parent ))
+        size += parent->obj.name->len + sizeof(WCHAR);
+    if (size) size -= sizeof(WCHAR);
+    if (!(path = malloc( size + sizeof(WCHAR) ))) return NULL;
+
+    p = path + size / sizeof(WCHAR);
+    for (parent = key; parent != base; parent = get_parent( parent ))
+    {
+        p -= parent->obj.name->len / sizeof(WCHAR);
+        memcpy( p, parent->obj.name->name, parent->obj.name->len );
+        if (p > path) *--p = '\\';
+    }
+    *len = size;
+    return path;
+}
+
+/* find an existing key from its path, without following symlinks */
+static struct key *find_key_path( struct key *key, const struct unicode_str *path )
+{
+    struct unicode_str tmp;
+    const WCHAR *str = path->str;
+    data_size_t len = path->len;
+    int index;
+
+    while (len)
+    {
+        tmp.str = str;
+        tmp.len = get_path_element( str, len );
+        if (!(key = find_subkey( key, &tmp, &index ))) return NULL;
+        if (tmp.len >= len) break;
+        tmp.len += sizeof(WCHAR);
+        str += tmp.len / sizeof(WCHAR);
+        len -= tmp.len;
+    }
+    return (struct key *)grab_object( key );
+}
+
+static void free_journal_op( struct journal_op *op )
+{
+    if (op->key)
+    {
+        op->key->flags &= ~KEY_JOURNAL;
+        release_object( op->key );
+    }
+    list_remove( &op->entry );
+    free( op->path );
+    free( op );
+}
+
+/* queue a modified key for the next journal write */
+static void journal_key( struct key *key )
+{
+    struct save_branch_info *branch;
+    struct journal_op *op;
+
+    if (key->flags & (KEY_VOLATILE | KEY_DELETED | KEY_JOURNAL)) return;
+    if (!(branch = get_key_branch( key )) || branch->need_snapshot) return;
+    if (!(op = malloc( sizeof(*op) )))
+    {
+        branch->need_snapshot = 1;
+        return;
+    }
+    op->key     = (struct key *)grab_object( key );
+    op->path    = NULL;
+    op->pathlen = 0;
+    key->flags |= KEY_JOURNAL;
+    list_add_tail( &branch->pending, &op->entry );
+}
+
+/* queue a key deletion for the next journal write, must be called while the key is still linked */
+static void journal_delete_key( struct key *key )
+{
+    struct save_branch_info *branch;
+    struct journal_op *op;
+
+    if (key->flags & KEY_VOLATILE) return;
+    if (!(branch = get_key_branch( key )) || branch->need_snapshot) return;
+    if (!(op = malloc( sizeof(*op) )) || !(op->path = get_key_path( key, branch->key, &op->pathlen )))
+    {
+        free( op );
+        branch->need_snapshot = 1;
+        return;
+    }
+    op->key = NULL;
+    list_add_tail( &branch->pending, &op->entry );
+}
+
+/* the change can't be described by the journal, e.g. a renamed subtree */
+static void require_snapshot( struct key *key )
+{
+    struct save_branch_info *branch;
+
+    if (key->flags & KEY_VOLATILE) return;
+    if ((branch = get_key_branch( key ))) branch->need_snapshot = 1;
+}
+
+static unsigned int hive_crc32( unsigned int crc, const void *data, size_t len )
+{
+    static unsigned int table[256];
+    const unsigned char *ptr = data;
+    unsigned int i, j, val;
+
+    if (!table[1])
+    {
+        for (i = 0; i < 256; i++)
+        {
+            for (j = 0, val = i; j < 8; j++) val = (val >> 1) ^ (val & 1 ? 0xedb88320 : 0);
+            table[i] = val;
+        }
+    }
+
+    crc = ~crc;
+    while (len--) crc = table[(crc ^ *ptr++) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+static void write_hive( struct hive_writer *writer, const void *data, size_t len )
+{
+    fwrite( data, 1, len, writer->f );
+    writer->crc = hive_crc32( writer->crc, data, len );
+}
+
+static void write_hive_data( const void *data, data_size_t len, struct hive_writer *writer )
+{
+    static const char zero[4];
+
+    if (len) write_hive( writer, data, len );
+    write_hive( writer, zero, HIVE_ALIGN( len ) - len );
+}
+
+static data_size_t get_hive_key_size( const struct key *key, int with_name )
+{
+    data_size_t size = sizeof(struct hive_key) + HIVE_ALIGN( key->classlen );
+    int i;
+
+    if (with_name) size += HIVE_ALIGN( key->obj.name->len );
+    for (i = 0; i <= key->last_value; i++)
+        size += sizeof(struct hive_value) + HIVE_ALIGN( key->values[i].namelen ) + HIVE_ALIGN( key->values[i].len );
+    return size;
+}
+
+static void write_hive_key( const struct key *key, unsigned int parent, int with_name, struct hive_writer *writer )
+{
+    struct hive_key hkey;
+    struct hive_value hvalue;
+    int i;
+
+    memset( &hkey, 0, sizeof(hkey) );
+    hkey.parent    = parent;
+    hkey.flags     = (key->flags & KEY_SYMLINK) ? HIVE_KEY_SYMLINK : 0;
+    hkey.modif     = key->modif;
+    hkey.namelen   = with_name ? key->obj.name->len : 0;
+    hkey.classlen  = key->classlen;
+    hkey.nb_values = key->last_value + 1;
+    write_hive( writer, &hkey, sizeof(hkey) );
+    if (with_name) write_hive_data( key->obj.name->name, hkey.namelen, writer );
+    write_hive_data( key->class, key->classlen, writer );
+
+    for (i = 0; i <= key->last_value; i++)
+    {
+        memset( &hvalue, 0, sizeof(hvalue) );
+        hvalue.type    = key->values[i].type;
+        hvalue.namelen = key->values[i].namelen;
+        hvalue.len     = key->values[i].len;
+        write_hive( writer, &hvalue, sizeof(hvalue) );
+        write_hive_data( key->values[i].name, hvalue.namelen, writer );
+        write_hive_data( key->values[i].data, hvalue.len, writer );
+    }
+}
+
+/* write a key and its non-volatile subkeys in tree order, return the number of keys written */
+static unsigned int write_hive_keys( const struct key *key, unsigned int parent, unsigned int index,
+                                     struct hive_writer *writer )
+{
+    unsigned int count = 1;
+    int i;
+
+    write_hive_key( key, parent, parent != ~0u, writer );
+    for (i = 0; i <= key->last_subkey; i++)
+    {
+        if (key->subkeys[i]->flags & KEY_VOLATILE) continue;
+        count += write_hive_keys( key->subkeys[i], index, index + count, writer );
+    }
+    return count;
+}
+
+/* check that a key record is well formed, return its size or 0 if it isn't */
+static data_size_t check_hive_key( const char *data, data_size_t size, struct hive_key *hkey )
+{
+    struct hive_value hvalue;
+    data_size_t pos = sizeof(*hkey);
+    unsigned int i;
+
+    if (size < sizeof(*hkey)) return 0;
+    memcpy( hkey, data, sizeof(*hkey) );
+    if (hkey->namelen > MAX_NAME_LEN * sizeof(WCHAR) || hkey->namelen % sizeof(WCHAR)) return 0;
+    if (HIVE_ALIGN( hkey->namelen ) > size - pos) return 0;
+    pos += HIVE_ALIGN( hkey->namelen );
+    if (hkey->classlen > size - pos || HIVE_ALIGN( hkey->classlen ) > size - pos) return 0;
+    pos += HIVE_ALIGN( hkey->classlen );
+    if (hkey->nb_values > (size - pos) / sizeof(hvalue)) return 0;
+
+    for (i = 0; i < hkey->nb_values; i++)
+    {
+        if (size - pos < sizeof(hvalue)) return 0;
+        memcpy( &hvalue, data + pos, sizeof(hvalue) );
+        pos += sizeof(hvalue);
+        if (hvalue.namelen > MAX_VALUE_LEN * sizeof(WCHAR) || hvalue.namelen % sizeof(WCHAR)) return 0;
+        if (HIVE_ALIGN( hvalue.namelen ) > size - pos) return 0;
+        pos += HIVE_ALIGN( hvalue.namelen );
+        if (hvalue.len > size - pos || HIVE_ALIGN( hvalue.len ) > size - pos) return 0;
+        pos += HIVE_ALIGN( hvalue.len );
+    }
+    return pos;
+}
+
+/* replace the class and values of a key by the ones of a checked key record */
+static void set_hive_key( struct key *key, const struct hive_key *hkey, const char *data )
+{
+    struct key_value *values = NULL;
+    struct hive_value hvalue;
+    WCHAR *class = NULL;
+    unsigned int i;
+
+    data += sizeof(*hkey) + HIVE_ALIGN( hkey->namelen );
+    if (hkey->classlen && !(class = memdup( data, hkey->classlen ))) return;
+    data += HIVE_ALIGN( hkey->classlen );
+    if (hkey->nb_values && !(values = mem_alloc( max( hkey->nb_values, MIN_VALUES ) * sizeof(*values) )))
+    {
+        free( class );
+        return;
+    }
+
+    for (i = 0; i < hkey->nb_values; i++)
+    {
+        memcpy( &hvalue, data, sizeof(hvalue) );
+        data += sizeof(hvalue);
+        values[i].namelen = hvalue.namelen;
+        values[i].name    = hvalue.namelen ? memdup( data, hvalue.namelen ) : NULL;
+        data += HIVE_ALIGN( hvalue.namelen );
+        values[i].type    = hvalue.type;
+        values[i].len     = hvalue.len;
+        values[i].data    = hvalue.len ? memdup( data, hvalue.len ) : NULL;
+        data += HIVE_ALIGN( hvalue.len );
+        if ((hvalue.namelen && !values[i].name) || (hvalue.len && !values[i].data))
+        {
+            for ( ; (int)i >= 0; i--)
+            {
+                free( values[i].name );
+                free( values[i].data );
+            }
+            free( values );
+            free( class );
+            return;
+        }
+    }
+
+    free( key->class );
+    for (i = 0; (int)i <= key->last_value; i++)
+    {
+        free( key->values[i].name );
+        free( key->values[i].data );
+    }
+    free( key->values );
+
+    key->class      = class;
+    key->classlen   = class ? hkey->classlen : 0;
+    key->values     = values;
+    key->nb_values  = values ? max( hkey->nb_values, MIN_VALUES ) : 0;
+    key->last_value = (int)hkey->nb_values - 1;
+    key->modif      = hkey->modif;
+    if (hkey->flags & HIVE_KEY_SYMLINK) key->flags |= KEY_SYMLINK;
+    invalidate_key_shm( key );
+}
+
+/* load a branch from its snapshot, return 0 if the text file has to be loaded instead */
+static int load_hive( struct save_branch_info *info, struct key *base, int *clean )
+{
+    struct hive_header header;
+    struct hive_key hkey;
+    struct stat st, text_st;
+    struct unicode_str name;
+    struct key **keys;
+    const char *data;
+    data_size_t pos, len;
+    unsigned int i;
+    int fd, ret = 0;
+    void *ptr;
+
+    if ((fd = open( info->hive, O_RDONLY )) == -1) return 0;
+    if (fstat( fd, &st ) == -1 || st.st_size < sizeof(header) || st.st_size > INT_MAX)
+    {
+        close( fd );
+        return 0;
+    }
+    ptr = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+    if (ptr == MAP_FAILED) return 0;
+    data = ptr;
+
+    memcpy( &header, data, sizeof(header) );
+    if (memcmp( header.magic, hive_magic, sizeof(header.magic) ) || header.version != HIVE_VERSION) goto done;
+    if (header.arch != PREFIX_32BIT && header.arch != PREFIX_64BIT) goto done;
+    if (prefix_type != PREFIX_UNKNOWN && header.arch != prefix_type) goto done;
+
+    /* a text file modified after the snapshot has been edited by hand */
+    *clean = 0;
+    if (!stat( info->filename, &text_st ))
+    {
+        *clean = (header.text_mtime == text_st.st_mtime && header.text_size == text_st.st_size);
+        if (!*clean && text_st.st_mtime > st.st_mtime) goto done;
+    }
+
+    /* check everything before creating any key */
+    if (!header.nb_keys) goto done;
+    for (i = 0, pos = sizeof(header); i < header.nb_keys; i++, pos += len)
+    {
+        if (!(len = check_hive_key( data + pos, st.st_size - pos, &hkey ))) goto done;
+        if (i ? (hkey.parent >= i || !hkey.namelen) : (hkey.parent != ~0u)) goto done;
+    }
+    if (pos != st.st_size || hive_crc32( 0, data + sizeof(header), pos - sizeof(header) ) != header.crc)
+    {
+        fprintf( stderr, "wineserver: ignoring corrupted registry snapshot %s\n", info->hive );
+        goto done;
+    }
+    if (!(keys = calloc( header.nb_keys, sizeof(*keys) ))) goto done;
+
+    if (prefix_type == PREFIX_UNKNOWN) prefix_type = header.arch;
+    for (i = 0, pos = sizeof(header); i < header.nb_keys; i++, pos += len)
+    {
+        len = check_hive_key( data + pos, st.st_size - pos, &hkey );
+        if (!i) keys[i] = (struct key *)grab_object( base );
+        else if (keys[hkey.parent])
+        {
+            name.str = (const WCHAR *)(data + pos + sizeof(hkey));
+            name.len = hkey.namelen;
+            keys[i] = create_key_recursive( keys[hkey.parent], &name, hkey.modif );
+        }
+        if (keys[i]) set_hive_key( keys[i], &hkey, data + pos );
+    }
+    for (i = 0; i < header.nb_keys; i++) if (keys[i]) release_object( keys[i] );
+    free( keys );
+    clear_error();
+
+    info->serial    = header.serial;
+    info->hive_size = st.st_size;
+    ret = 1;
+
+done:
+    munmap( ptr, st.st_size );
+    return ret;
+}
+
+/* apply a journal record on top of the snapshot, return 0 if it is invalid */
+static int replay_journal_record( struct key *base, const char *data, data_size_t size, timeout_t serial )
+{
+    struct journal_record record;
+    struct journal_trailer trailer;
+    struct hive_key hkey;
+    struct unicode_str path;
+    struct key *key;
+    data_size_t pos, end;
+
+    if (size < sizeof(record)) return 0;
+    memcpy( &record, data, sizeof(record) );
+    if (record.size < sizeof(record) + sizeof(trailer) || record.size > size || record.size % 4) return 0;
+    end = record.size - sizeof(trailer);
+    memcpy( &trailer, data + end, sizeof(trailer) );
+    if (trailer.size != record.size || trailer.serial != serial || trailer.crc != hive_crc32( 0, data, end ))
+        return 0;
+
+    if (record.pathlen % sizeof(WCHAR) || HIVE_ALIGN( record.pathlen ) > end - sizeof(record)) return 0;
+    path.str = (const WCHAR *)(data + sizeof(record));
+    path.len = record.pathlen;
+    pos = sizeof(record) + HIVE_ALIGN( record.pathlen );
+
+    switch (record.op)
+    {
+    case JOURNAL_SET_KEY:
+        if (check_hive_key( data + pos, end - pos, &hkey ) != end - pos) return 0;
+        if (path.len) key = create_key_recursive( base, &path, hkey.modif );
+        else key = (struct key *)grab_object( base );
+        if (!key) break;
+        set_hive_key( key, &hkey, data + pos );
+        release_object( key );
+        break;
+    case JOURNAL_DELETE_KEY:
+        if (!path.len || !(key = find_key_path( base, &path ))) break;
+        delete_key( key, 1 );
+        release_object( key );
+        break;
+    default:
+        return 0;
+    }
+    clear_error();
+    return 1;
+}
+
+/* apply the journal on top of the snapshot, return the number of records applied */
+static unsigned int replay_journal( struct save_branch_info *info, struct key *base )
 {
+    struct journal_header header;
+    unsigned int count = 0;
+    const char *data;
+    data_size_t pos;
+    struct stat st;
+    void *ptr;
+    int fd;
+
+    if ((fd = open( info->journal, O_RDWR )) == -1) return 0;
+    if (fstat( fd, &st ) == -1 || st.st_size < sizeof(header) || st.st_size > INT_MAX ||
+        (ptr = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 )) == MAP_FAILED)
+    {
+        close( fd );
+        return 0;
+    }
+    data = ptr;
+
+    memcpy( &header, data, sizeof(header) );
+    if (!memcmp( header.magic, journal_magic, sizeof(header.magic) ) && header.serial == info->serial)
+    {
+        for (pos = sizeof(header); pos < st.st_size; pos += ((const struct journal_record *)(data + pos))->size)
+        {
+            if (!replay_journal_record( base, data + pos, st.st_size - pos, info->serial )) break;
+            count++;
+        }
+        /* drop everything from the first torn or corrupted record, new records get appended to the valid ones */
+        if (pos < st.st_size && ftruncate( fd, pos ) == -1) pos = 0;
+        info->journal_size = pos;
+    }
+    munmap( ptr, st.st_size );
+    close( fd );
+    return count;
+}
+
+/* write a new snapshot of a branch, which also makes its journal obsolete */
+static int save_hive( struct save_branch_info *info )
+{
+    struct hive_header header;
+    struct hive_writer writer;
+    struct journal_op *op, *next;
+    struct stat st;
+    char tmp[32];
+    int fd, count = 0, ret;
+    FILE *f;
+
+    if (!info->hive || !info->journal) return 0;
+
+    for (;;)
+    {
+        snprintf( tmp, sizeof(tmp), "reg%lx%04x.tmp", (long) getpid(), count++ );
+        if ((fd = open( tmp, O_CREAT | O_EXCL | O_WRONLY, 0666 )) != -1) break;
+        if (errno != EEXIST) return 0;
+    }
+    if (!(f = fdopen( fd, "w" )))
+    {
+        close( fd );
+        unlink( tmp );
+        return 0;
+    }
+
+    memset( &header, 0, sizeof(header) );
+    memcpy( header.magic, hive_magic, sizeof(header.magic) );
+    header.version = HIVE_VERSION;
+    header.arch    = prefix_type;
+    header.serial  = max( current_time, info->serial + 1 );
+    /* the text file is known to be up to date if no key was modified since it was written */
+    if (!(info->key->flags & KEY_DIRTY) && !stat( info->filename, &st ))
+    {
+        header.text_mtime = st.st_mtime;
+        header.text_size  = st.st_size;
+    }
+    fwrite( &header, sizeof(header), 1, f );
+    writer.f = f;
+    writer.crc = 0;
+    header.nb_keys = write_hive_keys( info->key, ~0u, 0, &writer );
+    header.crc     = writer.crc;
+    info->hive_size = ftell( f );
+    rewind( f );
+    fwrite( &header, sizeof(header), 1, f );
+
+    /* the snapshot has to be on disk before it replaces the old one */
+    ret = !fflush( f ) && !fsync( fd );
+    if (ferror( f )) ret = 0;
+    if (fclose( f )) ret = 0;
+    if (ret) ret = !rename( tmp, info->hive );
+    if (!ret)
+    {
+        unlink( tmp );
+        return 0;
+    }
+
+    /* and the rename has to be on disk before the journal is removed; a journal
+     * that is left behind no longer matches the serial and gets truncated by the
+     * next write */
+    if ((fd = open( ".", O_RDONLY | O_DIRECTORY )) != -1)
+    {
+        if (!fsync( fd )) unlink( info->journal );
+        close( fd );
+    }
+    info->serial        = header.serial;
+    info->journal_size  = 0;
+    info->need_snapshot = 0;
+    LIST_FOR_EACH_ENTRY_SAFE( op, next, &info->pending, struct journal_op, entry ) free_journal_op( op );
+    return 1;
+}
+
+/* append the pending changes of a branch to its journal */
+static int write_journal( struct save_branch_info *info )
+{
+    struct journal_header header;
+    struct journal_record record;
+    struct journal_trailer trailer;
+    struct hive_writer writer;
+    struct journal_op *op, *next;
+    WCHAR *path;
+    int fd, ret;
     FILE *f;
 
-    if ((f = fopen( filename, "r" )))
+    if (!info->journal) return 0;
+    if ((fd = open( info->journal, O_WRONLY | O_CREAT | O_APPEND | (info->journal_size ? 0 : O_TRUNC),
+                    0666 )) == -1)
+        return 0;
+    if (!(f = fdopen( fd, "a" )))
+    {
+        close( fd );
+        return 0;
+    }
+
+    if (!info->journal_size)
     {
-        load_keys( key, filename, f, 0 );
-        fclose( f );
-        if (get_error() == STATUS_NOT_REGISTRY_FILE)
+        memcpy( header.magic, journal_magic, sizeof(header.magic) );
+        header.serial = info->serial;
+        fwrite( &header, sizeof(header), 1, f );
+        info->journal_size = sizeof(header);
+    }
+
+    writer.f = f;
+    LIST_FOR_EACH_ENTRY_SAFE( op, next, &info->pending, struct journal_op, entry )
+    {
+        memset( &record, 0, sizeof(record) );
+        writer.crc = 0;
+        if (!op->key)
         {
-            fprintf( stderr, "%s is not a valid registry file\n", filename );
-            return 1;
+            record.op   = JOURNAL_DELETE_KEY;
+            record.size = sizeof(record) + HIVE_ALIGN( op->pathlen ) + sizeof(trailer);
+            record.pathlen = op->pathlen;
+            write_hive( &writer, &record, sizeof(record) );
+            write_hive_data( op->path, op->pathlen, &writer );
         }
+        else if (!(op->key->flags & KEY_DELETED))
+        {
+            if (!(path = get_key_path( op->key, info->key, &record.pathlen )))
+            {
+                info->need_snapshot = 1;
+                break;
+            }
+            record.op   = JOURNAL_SET_KEY;
+            record.size = sizeof(record) + HIVE_ALIGN( record.pathlen ) + get_hive_key_size( op->key, 0 ) +
+                          sizeof(trailer);
+            write_hive( &writer, &record, sizeof(record) );
+            write_hive_data( path, record.pathlen, &writer );
+            write_hive_key( op->key, ~0u, 0, &writer );
+            free( path );
+        }
+        if (record.size)
+        {
+            trailer.size   = record.size;
+            trailer.crc    = writer.crc;
+            trailer.serial = info->serial;
+            fwrite( &trailer, sizeof(trailer), 1, f );
+        }
+        info->journal_size += record.size;
+        free_journal_op( op );
+    }
+
+    ret = !ferror( f );
+    if (fclose( f )) ret = 0;
+    /* the journal may be incomplete now, make sure the next save doesn't rely on it */
+    if (!ret) info->need_snapshot = 1;
+    return ret;
+}
+
+/* save the changes made to a branch since the last save */
+static int save_branch_changes( struct save_branch_info *info )
+{
+    if (info->need_snapshot || info->journal_size > max( MIN_JOURNAL_SIZE, info->hive_size / 2 ))
+        return save_hive( info );
+    if (list_empty( &info->pending )) return 1;
+    return write_journal( info );
+}
+
+static char *get_branch_file_name( const char *filename, const char *ext )
+{
+    size_t len = strlen( filename );
+    char *ret;
+
+    if (len > 4 && !strcmp( filename + len - 4, ".reg" )) len -= 4;
+    if ((ret = malloc( len + strlen( ext ) + 1 )))
+    {
+        memcpy( ret, filename, len );
+        strcpy( ret + len, ext );
     }
+    return ret;
+}
+
+/* load one of the initial registry files */
+static int load_init_registry_from_file( const char *filename, struct key *key )
+{
+    struct save_branch_info *info;
+    int loaded, clean = 0;
+    FILE *f;
 
     assert( save_branch_count < MAX_SAVE_BRANCH_INFO );
 
-    save_branch_info[save_branch_count].filename = filename;
-    save_branch_info[save_branch_count++].key = (struct key *)grab_object( key );
+    info = &save_branch_info[save_branch_count];
+    info->filename = filename;
+    info->hive     = get_branch_file_name( filename, ".hiv" );
+    info->journal  = get_branch_file_name( filename, ".jnl" );
+    list_init( &info->pending );
+
+    if (info->hive && info->journal && load_hive( info, key, &clean ))
+    {
+        if (replay_journal( info, key )) clean = 0;
+        if (clean) make_clean( key );
+        loaded = 1;
+    }
+    else
+    {
+        if ((f = fopen( filename, "r" )))
+        {
+            load_keys( key, filename, f, 0 );
+            fclose( f );
+            if (get_error() == STATUS_NOT_REGISTRY_FILE)
+            {
+                fprintf( stderr, "%s is not a valid registry file\n", filename );
+                return 1;
+            }
+        }
+        info->need_snapshot = 1;
+        loaded = (f != NULL);
+    }
+
+    save_branch_count++;
+    info->key = (struct key *)grab_object( key );
     make_object_permanent( &key->obj );
-    return (f != NULL);
+    return loaded;
 }
 
 static WCHAR *format_user_registry_path( const struct sid *sid, struct unicode_str *path )
@@ -2129,7 +3044,7 @@ static void periodic_save( void *arg )
     if (fchdir( config_dir_fd ) == -1) return;
     save_timeout_user = NULL;
     for (i = 0; i < save_branch_count; i++)
-        save_branch( save_branch_info[i].key, save_branch_info[i].filename );
+        save_branch_changes( &save_branch_info[i] );
     if (fchdir( server_dir_fd ) == -1) fatal_error( "chdir to server dir: %s\n", strerror( errno ));
     set_periodic_save_timer();
 }
@@ -2149,10 +3064,18 @@ void flush_registry(void)
     if (fchdir( config_dir_fd ) == -1) return;
     for (i = 0; i < save_branch_count; i++)
     {
-        if (!save_branch( save_branch_info[i].key, save_branch_info[i].filename ))
+        struct save_branch_info *info = &save_branch_info[i];
+        int dirty = info->key->flags & KEY_DIRTY;
+
+        if (!save_branch( info->key, info->filename ))
+        {
+            fprintf( stderr, "wineserver: could not save registry branch to %s", info->filename );
+            perror( " " );
+        }
+        /* write a new snapshot so that the exported text file is recognized as up to date */
+        if ((dirty || info->need_snapshot || !list_empty( &info->pending )) && !save_hive( info ))
         {
-            fprintf( stderr, "wineserver: could not save registry branch to %s",
-                     save_branch_info[i].filename );
+            fprintf( stderr, "wineserver: could not save registry snapshot to %s", info->hive );
             perror( " " );
         }
     }
@@ -2191,6 +3114,7 @@ DECL_HANDLER(create_key)
         {
             key->classlen = (key->classlen / sizeof(WCHAR)) * sizeof(WCHAR);
             if (!(key->class = memdup( class, key->classlen ))) key->classlen = 0;
+            journal_key( key );
         }
         if (get_error() == STATUS_OBJECT_NAME_EXISTS)
             reply->hkey = alloc_handle( current->process, key, access, objattr->attributes );
@@ -2216,6 +3140,9 @@ DECL_HANDLER(open_key)
     if ((key = open_key( parent, &name, access, req->attributes )))
     {
         reply->hkey = alloc_handle( current->process, key, access, req->attributes );
+        if (reply->hkey && (get_handle_access( current->process, reply->hkey ) & KEY_QUERY_VALUE) &&
+            (reply->shm_offset = publish_key_shm( key )))
+            reply->generation = key->shm_gen;
         release_object( key );
     }
     if (parent) release_object( parent );
@@ -2290,6 +3217,8 @@ DECL_HANDLER(get_key_value)
     if ((key = get_hkey_obj( req->hkey, KEY_QUERY_VALUE )))
     {
         get_value( key, &name, &reply->type, &reply->total );
+        /* let the client pick up a record published or recycled since the key was opened */
+        if ((reply->shm_offset = publish_key_shm( key ))) reply->generation = key->shm_gen;
         release_object( key );
     }
 }
@@ -63,8 +63,21 @@ extern int kill_lock_owner( int sig );
 extern char *server_dir;
 extern int server_dir_fd, config_dir_fd;
 
+/* per request type dispatch statistics */
+struct request_stats
+{
+    unsigned int count;         /* number of requests handled */
+    timeout_t    time;          /* total time spent in the handler */
+    timeout_t    max_time;      /* longest time spent in the handler */
+};
+
+extern struct request_stats req_stats[REQ_NB_REQUESTS];
+extern int req_stats_enabled;
+
 extern void trace_request(void);
 extern void trace_reply( enum request req, const union generic_reply *reply );
+extern void init_request_stats(void);
+extern void dump_request_stats(void);
 
 /* get current tick count to return to client */
 static inline unsigned int get_tick_count(void)
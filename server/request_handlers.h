@@ -51,6 +51,10 @@ DECL_HANDLER(create_semaphore);
 DECL_HANDLER(release_semaphore);
 DECL_HANDLER(query_semaphore);
 DECL_HANDLER(open_semaphore);
+DECL_HANDLER(get_inproc_sync);
+DECL_HANDLER(get_inproc_sync_section);
+DECL_HANDLER(get_inproc_sync_thread);
+DECL_HANDLER(signal_inproc_sync);
 DECL_HANDLER(create_file);
 DECL_HANDLER(open_file_object);
 DECL_HANDLER(alloc_file_handle);
@@ -275,6 +279,7 @@ DECL_HANDLER(get_thread_completion);
 DECL_HANDLER(query_completion);
 DECL_HANDLER(set_completion_info);
 DECL_HANDLER(add_fd_completion);
+DECL_HANDLER(get_fd_completion);
 DECL_HANDLER(set_fd_completion_mode);
 DECL_HANDLER(set_fd_disp_info);
 DECL_HANDLER(set_fd_name_info);
@@ -347,6 +352,10 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_release_semaphore,
     (req_handler)req_query_semaphore,
     (req_handler)req_open_semaphore,
+    (req_handler)req_get_inproc_sync,
+    (req_handler)req_get_inproc_sync_section,
+    (req_handler)req_get_inproc_sync_thread,
+    (req_handler)req_signal_inproc_sync,
     (req_handler)req_create_file,
     (req_handler)req_open_file_object,
     (req_handler)req_alloc_file_handle,
@@ -571,6 +580,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_query_completion,
     (req_handler)req_set_completion_info,
     (req_handler)req_add_fd_completion,
+    (req_handler)req_get_fd_completion,
     (req_handler)req_set_fd_completion_mode,
     (req_handler)req_set_fd_disp_info,
     (req_handler)req_set_fd_name_info,
@@ -925,6 +935,20 @@ C_ASSERT( offsetof(struct open_semaphore_request, rootdir) == 20 );
 C_ASSERT( sizeof(struct open_semaphore_request) == 24 );
 C_ASSERT( offsetof(struct open_semaphore_reply, handle) == 8 );
 C_ASSERT( sizeof(struct open_semaphore_reply) == 16 );
+C_ASSERT( offsetof(struct get_inproc_sync_request, handle) == 12 );
+C_ASSERT( sizeof(struct get_inproc_sync_request) == 16 );
+C_ASSERT( offsetof(struct get_inproc_sync_reply, index) == 8 );
+C_ASSERT( offsetof(struct get_inproc_sync_reply, type) == 12 );
+C_ASSERT( offsetof(struct get_inproc_sync_reply, access) == 16 );
+C_ASSERT( sizeof(struct get_inproc_sync_reply) == 24 );
+C_ASSERT( sizeof(struct get_inproc_sync_section_request) == 16 );
+C_ASSERT( offsetof(struct get_inproc_sync_section_reply, handle) == 8 );
+C_ASSERT( sizeof(struct get_inproc_sync_section_reply) == 16 );
+C_ASSERT( sizeof(struct get_inproc_sync_thread_request) == 16 );
+C_ASSERT( offsetof(struct get_inproc_sync_thread_reply, index) == 8 );
+C_ASSERT( sizeof(struct get_inproc_sync_thread_reply) == 16 );
+C_ASSERT( offsetof(struct signal_inproc_sync_request, handle) == 12 );
+C_ASSERT( sizeof(struct signal_inproc_sync_request) == 16 );
 C_ASSERT( offsetof(struct create_file_request, access) == 12 );
 C_ASSERT( offsetof(struct create_file_request, sharing) == 16 );
 C_ASSERT( offsetof(struct create_file_request, create) == 20 );
@@ -1157,7 +1181,9 @@ C_ASSERT( offsetof(struct open_key_request, access) == 16 );
 C_ASSERT( offsetof(struct open_key_request, attributes) == 20 );
 C_ASSERT( sizeof(struct open_key_request) == 24 );
 C_ASSERT( offsetof(struct open_key_reply, hkey) == 8 );
-C_ASSERT( sizeof(struct open_key_reply) == 16 );
+C_ASSERT( offsetof(struct open_key_reply, generation) == 12 );
+C_ASSERT( offsetof(struct open_key_reply, shm_offset) == 16 );
+C_ASSERT( sizeof(struct open_key_reply) == 24 );
 C_ASSERT( offsetof(struct delete_key_request, hkey) == 12 );
 C_ASSERT( sizeof(struct delete_key_request) == 16 );
 C_ASSERT( offsetof(struct flush_key_request, hkey) == 12 );
@@ -1184,7 +1210,9 @@ C_ASSERT( offsetof(struct get_key_value_request, hkey) == 12 );
 C_ASSERT( sizeof(struct get_key_value_request) == 16 );
 C_ASSERT( offsetof(struct get_key_value_reply, type) == 8 );
 C_ASSERT( offsetof(struct get_key_value_reply, total) == 12 );
-C_ASSERT( sizeof(struct get_key_value_reply) == 16 );
+C_ASSERT( offsetof(struct get_key_value_reply, generation) == 16 );
+C_ASSERT( offsetof(struct get_key_value_reply, shm_offset) == 20 );
+C_ASSERT( sizeof(struct get_key_value_reply) == 24 );
 C_ASSERT( offsetof(struct enum_key_value_request, hkey) == 12 );
 C_ASSERT( offsetof(struct enum_key_value_request, index) == 16 );
 C_ASSERT( offsetof(struct enum_key_value_request, info_class) == 20 );
@@ -2165,6 +2193,10 @@ C_ASSERT( offsetof(struct add_fd_completion_request, information) == 24 );
 C_ASSERT( offsetof(struct add_fd_completion_request, status) == 32 );
 C_ASSERT( offsetof(struct add_fd_completion_request, async) == 36 );
 C_ASSERT( sizeof(struct add_fd_completion_request) == 40 );
+C_ASSERT( offsetof(struct get_fd_completion_request, handle) == 12 );
+C_ASSERT( sizeof(struct get_fd_completion_request) == 16 );
+C_ASSERT( offsetof(struct get_fd_completion_reply, bound) == 8 );
+C_ASSERT( sizeof(struct get_fd_completion_reply) == 16 );
 C_ASSERT( offsetof(struct set_fd_completion_mode_request, handle) == 12 );
 C_ASSERT( offsetof(struct set_fd_completion_mode_request, flags) == 16 );
 C_ASSERT( sizeof(struct set_fd_completion_mode_request) == 24 );
@@ -611,6 +611,41 @@ static void dump_open_semaphore_reply( const struct open_semaphore_reply *req )
     fprintf( stderr, " handle=%04x", req->handle );
 }
 
+static void dump_get_inproc_sync_request( const struct get_inproc_sync_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
+static void dump_get_inproc_sync_reply( const struct get_inproc_sync_reply *req )
+{
+    fprintf( stderr, " index=%08x", req->index );
+    fprintf( stderr, ", type=%08x", req->type );
+    fprintf( stderr, ", access=%08x", req->access );
+}
+
+static void dump_get_inproc_sync_section_request( const struct get_inproc_sync_section_request *req )
+{
+}
+
+static void dump_get_inproc_sync_section_reply( const struct get_inproc_sync_section_reply *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
+static void dump_get_inproc_sync_thread_request( const struct get_inproc_sync_thread_request *req )
+{
+}
+
+static void dump_get_inproc_sync_thread_reply( const struct get_inproc_sync_thread_reply *req )
+{
+    fprintf( stderr, " index=%08x", req->index );
+}
+
+static void dump_signal_inproc_sync_request( const struct signal_inproc_sync_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
 static void dump_create_file_request( const struct create_file_request *req )
 {
     fprintf( stderr, " access=%08x", req->access );
@@ -1090,6 +1125,8 @@ static void dump_open_key_request( const struct open_key_request *req )
 static void dump_open_key_reply( const struct open_key_reply *req )
 {
     fprintf( stderr, " hkey=%04x", req->hkey );
+    fprintf( stderr, ", generation=%08x", req->generation );
+    fprintf( stderr, ", shm_offset=%08x", req->shm_offset );
 }
 
 static void dump_delete_key_request( const struct delete_key_request *req )
@@ -1143,6 +1180,8 @@ static void dump_get_key_value_reply( const struct get_key_value_reply *req )
 {
     fprintf( stderr, " type=%d", req->type );
     fprintf( stderr, ", total=%u", req->total );
+    fprintf( stderr, ", generation=%08x", req->generation );
+    fprintf( stderr, ", shm_offset=%08x", req->shm_offset );
     dump_varargs_bytes( ", data=", cur_size );
 }
 
@@ -3129,6 +3168,16 @@ static void dump_add_fd_completion_request( const struct add_fd_completion_reque
     fprintf( stderr, ", async=%d", req->async );
 }
 
+static void dump_get_fd_completion_request( const struct get_fd_completion_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
+static void dump_get_fd_completion_reply( const struct get_fd_completion_reply *req )
+{
+    fprintf( stderr, " bound=%d", req->bound );
+}
+
 static void dump_set_fd_completion_mode_request( const struct set_fd_completion_mode_request *req )
 {
     fprintf( stderr, " handle=%04x", req->handle );
@@ -3393,6 +3442,10 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] =
     (dump_func)dump_release_semaphore_request,
     (dump_func)dump_query_semaphore_request,
     (dump_func)dump_open_semaphore_request,
+    (dump_func)dump_get_inproc_sync_request,
+    (dump_func)dump_get_inproc_sync_section_request,
+    (dump_func)dump_get_inproc_sync_thread_request,
+    (dump_func)dump_signal_inproc_sync_request,
     (dump_func)dump_create_file_request,
     (dump_func)dump_open_file_object_request,
     (dump_func)dump_alloc_file_handle_request,
@@ -3617,6 +3670,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] =
     (dump_func)dump_query_completion_request,
     (dump_func)dump_set_completion_info_request,
     (dump_func)dump_add_fd_completion_request,
+    (dump_func)dump_get_fd_completion_request,
     (dump_func)dump_set_fd_completion_mode_request,
     (dump_func)dump_set_fd_disp_info_request,
     (dump_func)dump_set_fd_name_info_request,
@@ -3689,6 +3743,10 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] =
     (dump_func)dump_release_semaphore_reply,
     (dump_func)dump_query_semaphore_reply,
     (dump_func)dump_open_semaphore_reply,
+    (dump_func)dump_get_inproc_sync_reply,
+    (dump_func)dump_get_inproc_sync_section_reply,
+    (dump_func)dump_get_inproc_sync_thread_reply,
+    NULL,
     (dump_func)dump_create_file_reply,
     (dump_func)dump_open_file_object_reply,
     (dump_func)dump_alloc_file_handle_reply,
@@ -3913,6 +3971,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] =
     (dump_func)dump_query_completion_reply,
     NULL,
     NULL,
+    (dump_func)dump_get_fd_completion_reply,
     NULL,
     NULL,
     NULL,
@@ -3985,6 +4044,10 @@ static const char * const req_names[REQ_NB_REQUESTS] =
     "release_semaphore",
     "query_semaphore",
     "open_semaphore",
+    "get_inproc_sync",
+    "get_inproc_sync_section",
+    "get_inproc_sync_thread",
+    "signal_inproc_sync",
     "create_file",
     "open_file_object",
     "alloc_file_handle",
@@ -4209,6 +4272,7 @@ static const char * const req_names[REQ_NB_REQUESTS] =
     "query_completion",
     "set_completion_info",
     "add_fd_completion",
+    "get_fd_completion",
     "set_fd_completion_mode",
     "set_fd_disp_info",
     "set_fd_name_info",
@@ -250,6 +250,7 @@ static inline void init_thread_structure( struct thread *thread )
     thread->creation_time = current_time;
     thread->exit_time     = 0;
     thread->completion_wait = NULL;
+    thread->inproc_sync     = NULL;
 
     list_init( &thread->mutex_list );
     list_init( &thread->system_apc );
@@ -831,6 +832,19 @@ static int wait_on_handles( const union select_op *select_op, unsigned int count
     return ret;
 }
 
+/* take all the objects of a wait-all, clients may have taken some of them since they were found signaled */
+static int grab_wait_objects( struct thread *thread )
+{
+    struct thread_wait *wait = thread->wait;
+    int i;
+
+    for (i = 0; i < wait->count; i++)
+        if (!grab_inproc_sync( wait->queues[i].obj, thread )) break;
+    if (i == wait->count) return 1;
+    while (i--) ungrab_inproc_sync( wait->queues[i].obj, thread );
+    return 0;
+}
+
 /* check if the thread waiting condition is satisfied */
 static int check_wait( struct thread *thread )
 {
@@ -853,12 +867,13 @@ static int check_wait( struct thread *thread )
          * want to do something when signaled, even if others are not */
         for (i = 0, entry = wait->queues; i < wait->count; i++, entry++)
             not_ok |= !entry->obj->ops->signaled( entry->obj, entry );
-        if (!not_ok) return STATUS_WAIT_0;
+        if (!not_ok && grab_wait_objects( thread )) return STATUS_WAIT_0;
     }
     else
     {
         for (i = 0, entry = wait->queues; i < wait->count; i++, entry++)
-            if (entry->obj->ops->signaled( entry->obj, entry )) return i;
+            if (entry->obj->ops->signaled( entry->obj, entry ) && grab_inproc_sync( entry->obj, thread ))
+                return i;
     }
 
     if ((wait->flags & SELECT_ALERTABLE) && !list_empty(&thread->user_apc)) return STATUS_USER_APC;
@@ -1291,6 +1306,7 @@ void kill_thread( struct thread *thread, int violent_death )
     }
     kill_console_processes( thread, 0 );
     abandon_mutexes( thread );
+    abandon_inproc_sync_mutexes( thread, violent_death );
     wake_up( &thread->obj, 0 );
     if (violent_death) send_thread_signal( thread, SIGQUIT );
     cleanup_thread( thread );
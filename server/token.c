@@ -42,6 +42,7 @@
 
 #define MAX_SUBAUTH_COUNT 1
 
+const struct luid SeLockMemoryPrivilege           = {  4, 0 };
 const struct luid SeIncreaseQuotaPrivilege        = {  5, 0 };
 const struct luid SeTcbPrivilege                  = {  7, 0 };
 const struct luid SeSecurityPrivilege             = {  8, 0 };
@@ -771,6 +772,7 @@ struct token *token_create_admin( unsigned primary, int impersonation_level, int
         { SeManageVolumePrivilege, 0 },
         { SeImpersonatePrivilege, SE_PRIVILEGE_ENABLED },
         { SeCreateGlobalPrivilege, SE_PRIVILEGE_ENABLED },
+        { SeLockMemoryPrivilege, 0 },
     };
     /* note: we don't include non-builtin groups here for the user -
      * telling us these is the job of a client-side program */
@@ -23,6 +23,7 @@
 #include <ctype.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 
@@ -1558,6 +1559,61 @@ static void dump_varargs_monitor_infos( const char *prefix, data_size_t size )
     remove_data( size );
 }
 
+struct request_stats req_stats[REQ_NB_REQUESTS];
+int req_stats_enabled;
+
+/* time the request handlers, only when requested through WINESERVERSTATS */
+void init_request_stats(void)
+{
+    const char *env = getenv( "WINESERVERSTATS" );
+
+    if (!env || !strcmp( env, "0" )) return;
+    req_stats_enabled = 1;
+    if (debug_level) fprintf( stderr, "wineserver: request statistics enabled\n" );
+}
+
+static int compare_request_stats( const void *a, const void *b )
+{
+    const struct request_stats *stats_a = &req_stats[*(const enum request *)a];
+    const struct request_stats *stats_b = &req_stats[*(const enum request *)b];
+
+    if (stats_a->time != stats_b->time) return stats_a->time < stats_b->time ? 1 : -1;
+    return 0;
+}
+
+/* dump the request types that kept the server busy the longest */
+void dump_request_stats(void)
+{
+    enum request reqs[REQ_NB_REQUESTS];
+    unsigned int i, count = 0;
+    timeout_t total = 0;
+
+    if (!req_stats_enabled)
+    {
+        fprintf( stderr, "wineserver: request statistics are only gathered with WINESERVERSTATS=1\n" );
+        return;
+    }
+
+    for (i = 0; i < REQ_NB_REQUESTS; i++)
+    {
+        if (!req_stats[i].count) continue;
+        total += req_stats[i].time;
+        reqs[count++] = i;
+    }
+    qsort( reqs, count, sizeof(reqs[0]), compare_request_stats );
+
+    fprintf( stderr, "wineserver: %u request types, %u.%03u ms in handlers\n", count,
+             (unsigned int)(total / 10000), (unsigned int)(total % 10000 / 10) );
+    for (i = 0; i < count && i < 20; i++)
+    {
+        const struct request_stats *stats = &req_stats[reqs[i]];
+
+        fprintf( stderr, "  %-32s count=%u total=%u.%03u ms avg=%u us max=%u us\n", req_names[reqs[i]],
+                 stats->count, (unsigned int)(stats->time / 10000), (unsigned int)(stats->time % 10000 / 10),
+                 (unsigned int)(stats->time / stats->count / 10), (unsigned int)(stats->max_time / 10) );
+    }
+}
+
 void trace_request(void)
 {
     enum request req = current->req.request_header.req;
@@ -56,6 +56,7 @@ static const unsigned char utf8_mask[4] = { 0x7f, 0x1f, 0x0f, 0x07 };
 static const unsigned int utf8_minval[4] = { 0x0, 0x80, 0x800, 0x10000 };
 
 static unsigned short *casemap;
+static unsigned int casemap_size;
 
 static inline char to_hex( char ch )
 {
@@ -310,6 +311,13 @@ static char *get_nls_dir(void)
     return ret;
 }
 
+/* return the lowercase table, for clients that need to compare names like the server */
+const unsigned short *get_casemap( data_size_t *size )
+{
+    *size = casemap_size * sizeof(*casemap);
+    return casemap;
+}
+
 /* load the case mapping table */
 struct fd *load_intl_file(void)
 {
@@ -349,6 +357,7 @@ struct fd *load_intl_file(void)
     /* read lowercase table */
     if (!(casemap = malloc( size * 2 ))) goto failed;
     if (pread( unix_fd, casemap, size * 2, offset * 2 ) != size * 2) goto failed;
+    casemap_size = size;
     free( path );
     return fd;
 
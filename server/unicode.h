@@ -32,5 +32,6 @@ extern WCHAR *ascii_to_unicode_str( const char *str, struct unicode_str *ret ) _
 extern int parse_strW( WCHAR *buffer, data_size_t *len, const char *src, char endchar );
 extern int dump_strW( const WCHAR *str, data_size_t len, FILE *f, const char escape[2] );
 extern struct fd *load_intl_file(void);
+extern const unsigned short *get_casemap( data_size_t *size );
 
 #endif  /* __WINE_SERVER_UNICODE_H */